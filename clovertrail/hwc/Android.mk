@@ -31,6 +31,7 @@ LOCAL_COPY_HEADERS := \
     IntelHWComposerDrm.h \
     IntelHWComposerDump.h \
     IntelHWComposerLayer.h \
+    IntelHWComposerPlanner.h \
     IntelOverlayContext.h \
     IntelOverlayHW.h \
     IntelOverlayPlane.h \
@@ -50,6 +51,7 @@ LOCAL_SRC_FILES := IntelHWComposerModule.cpp \
                    IntelHWComposer.cpp \
                    IntelHWComposerLayer.cpp \
                    IntelHWComposerDump.cpp \
+                   IntelHWComposerPlanner.cpp \
                    IntelBufferManager.cpp \
                    IntelDisplayPlaneManager.cpp \
                    IntelHWComposerDrm.cpp \
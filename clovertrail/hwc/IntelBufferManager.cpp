@@ -1253,3 +1253,215 @@ IntelPayloadBuffer::~IntelPayloadBuffer()
         mBufferManager->unmap(mBuffer);
     }
 }
+
+IntelBufferCache::IntelBufferCache(IntelBufferManager *bm, int capacity)
+    : IntelHWComposerDump(),
+      mBufferManager(bm), mEntries(0), mCapacity(capacity), mCount(0),
+      mUseCount(0), mHits(0), mMisses(0), mEvictions(0), mInvalidations(0)
+{
+    if (mCapacity < CACHE_SIZE_MIN)
+        mCapacity = CACHE_SIZE_MIN;
+    else if (mCapacity > CACHE_SIZE_MAX)
+        mCapacity = CACHE_SIZE_MAX;
+
+    mEntries = new Entry[mCapacity];
+    if (!mEntries) {
+        LOGE("%s: failed to allocate %d entries\n", __func__, mCapacity);
+        mCapacity = 0;
+        return;
+    }
+
+    memset(mEntries, 0, mCapacity * sizeof(Entry));
+}
+
+IntelBufferCache::~IntelBufferCache()
+{
+    for (int i = 0; i < mCount; i++)
+        unmap(mEntries[i]);
+
+    delete [] mEntries;
+}
+
+void IntelBufferCache::unmap(Entry& entry)
+{
+    if (entry.bufferType == IntelBufferManager::TTM_BUFFER)
+        mBufferManager->unwrap(entry.buffer);
+    else
+        mBufferManager->unmap(entry.buffer);
+}
+
+void IntelBufferCache::remove(int index)
+{
+    unmap(mEntries[index]);
+    mEntries[index] = mEntries[--mCount];
+}
+
+// unmap the least recently used buffer which no plane holds
+bool IntelBufferCache::evict()
+{
+    int victim = -1;
+
+    for (int i = 0; i < mCount; i++) {
+        if (mEntries[i].refs)
+            continue;
+        if (victim < 0 || mEntries[i].lastUse < mEntries[victim].lastUse)
+            victim = i;
+    }
+
+    if (victim < 0)
+        return false;
+
+    LOGD_IF(ALLOW_BUFFER_PRINT, "%s: unmap handle 0x%x\n",
+            __func__, mEntries[victim].handle);
+    remove(victim);
+    mEvictions++;
+    return true;
+}
+
+int IntelBufferCache::find(IntelDisplayBuffer *buffer)
+{
+    for (int i = 0; i < mCount; i++) {
+        if (mEntries[i].buffer == buffer)
+            return i;
+    }
+
+    return -1;
+}
+
+IntelDisplayBuffer* IntelBufferCache::acquire(uint32_t handle,
+                                              unsigned long long ui64Stamp,
+                                              uint32_t bufferType,
+                                              int planeType)
+{
+    IntelDisplayBuffer *buffer = 0;
+
+    if (!mCapacity)
+        return 0;
+
+    mUseCount++;
+
+    for (int i = 0; i < mCount; i++) {
+        Entry& entry = mEntries[i];
+
+        if (entry.handle != handle || entry.stale)
+            continue;
+
+        if (entry.ui64Stamp == ui64Stamp && entry.bufferType == bufferType) {
+            entry.lastUse = mUseCount;
+            entry.refs++;
+            entry.owners |= (1 << planeType);
+            mHits++;
+            return entry.buffer;
+        }
+
+        // the handle of a freed buffer was reused
+        if (entry.ui64Stamp != ui64Stamp) {
+            LOGD_IF(ALLOW_BUFFER_PRINT, "%s: handle 0x%x was reused\n",
+                    __func__, handle);
+            mInvalidations++;
+            if (entry.refs) {
+                entry.stale = true;
+            } else {
+                remove(i);
+                i--;
+            }
+        }
+    }
+
+    mMisses++;
+
+    if (mCount == mCapacity && !evict()) {
+        LOGE("%s: all %d buffers are in use\n", __func__, mCapacity);
+        return 0;
+    }
+
+    // retry once if GTT space is exhausted
+    for (int tries = 0; !buffer && tries < 2; tries++) {
+        if (tries) {
+            LOGW("%s: Avail memory is low...", __func__);
+            if (!evict())
+                break;
+        }
+
+        if (bufferType == IntelBufferManager::TTM_BUFFER)
+            buffer = mBufferManager->wrap((void *)handle, 0);
+        else
+            buffer = mBufferManager->map(handle);
+    }
+
+    if (!buffer) {
+        LOGE("%s: failed to map handle 0x%x\n", __func__, handle);
+        return 0;
+    }
+
+    Entry& entry = mEntries[mCount++];
+    entry.handle = handle;
+    entry.ui64Stamp = ui64Stamp;
+    entry.bufferType = bufferType;
+    entry.buffer = buffer;
+    entry.lastUse = mUseCount;
+    entry.refs = 1;
+    entry.stale = false;
+    entry.owners = (1 << planeType);
+
+    return buffer;
+}
+
+void IntelBufferCache::release(IntelDisplayBuffer *buffer)
+{
+    if (!buffer)
+        return;
+
+    int index = find(buffer);
+    if (index < 0) {
+        LOGW("%s: unknown buffer %p\n", __func__, buffer);
+        return;
+    }
+
+    Entry& entry = mEntries[index];
+    if (entry.refs > 0)
+        entry.refs--;
+
+    // freed while it was shown
+    if (!entry.refs && entry.stale)
+        remove(index);
+}
+
+void IntelBufferCache::invalidate(int planeType)
+{
+    for (int i = 0; i < mCount; i++) {
+        if (mEntries[i].refs ||
+            mEntries[i].owners != (uint32_t)(1 << planeType))
+            continue;
+
+        mInvalidations++;
+        remove(i);
+        i--;
+    }
+}
+
+bool IntelBufferCache::dump(char *buff, int buff_len, int *cur_len)
+{
+    mDumpBuf = buff;
+    mDumpBuflen = buff_len;
+    mDumpLen = *cur_len;
+
+    dumpPrintf("-------------- Buffer Cache ---------------\n");
+    dumpPrintf("     mapped buffers: %d of %d\n", mCount, mCapacity);
+    dumpPrintf("     hits: %u, misses: %u\n", mHits, mMisses);
+    dumpPrintf("     evictions: %u, invalidations: %u\n",
+               mEvictions, mInvalidations);
+    for (int i = 0; i < mCount; i++) {
+        dumpPrintf("     handle 0x%x, stamp %llu, type %d, owners 0x%x, "
+                   "refs %d%s\n",
+                   mEntries[i].handle, mEntries[i].ui64Stamp,
+                   mEntries[i].bufferType, mEntries[i].owners,
+                   mEntries[i].refs,
+                   mEntries[i].stale ? ", stale" : "");
+    }
+    dumpPrintf("-------------End of Buffer Cache-----------\n");
+
+    *cur_len = mDumpLen;
+
+    return true;
+}
@@ -37,6 +37,7 @@
 #include <pvr2d.h>
 #include <pthread.h>
 #include <services.h>
+#include <IntelHWComposerDump.h>
 
 class IntelDisplayBuffer
 {
@@ -324,4 +325,66 @@ public:
     void* getCpuAddr(){return mPayload;}
 };
 
+// IntelBufferCache: GTT mappings of the gralloc buffers shown by the
+// overlay and sprite planes, shared by all planes. Video players cycle
+// through more buffers than a plane used to keep, mapping a buffer goes
+// through GTT map ioctls, so mappings are kept for the buffer handle and
+// stamp, and the least recently used one is unmapped when the cache is full.
+// Buffers a plane is showing are acquired by the plane and never unmapped.
+// hwc isn't told when gralloc frees a buffer: gralloc reuses the handle of
+// a freed buffer with a new stamp, the mapping of the freed buffer is only
+// dropped then, or when it's evicted.
+class IntelBufferCache : public IntelHWComposerDump {
+public:
+    enum {
+        CACHE_SIZE_MIN = 8,
+        CACHE_SIZE_DEFAULT = 16,
+        CACHE_SIZE_MAX = 64,
+    };
+private:
+    struct Entry {
+        uint32_t handle;
+        unsigned long long ui64Stamp;
+        uint32_t bufferType;
+        IntelDisplayBuffer *buffer;
+        uint32_t lastUse;
+        int refs;
+        bool stale;
+        // plane types which acquired the buffer, (1 << type)
+        uint32_t owners;
+    };
+    IntelBufferManager *mBufferManager;
+    Entry *mEntries;
+    int mCapacity;
+    int mCount;
+    uint32_t mUseCount;
+
+    // statistics
+    uint32_t mHits;
+    uint32_t mMisses;
+    uint32_t mEvictions;
+    uint32_t mInvalidations;
+private:
+    void unmap(Entry& entry);
+    void remove(int index);
+    bool evict();
+    int find(IntelDisplayBuffer *buffer);
+public:
+    IntelBufferCache(IntelBufferManager *bm, int capacity);
+    ~IntelBufferCache();
+    // map a buffer, or get its mapping, and hold it until release()
+    IntelDisplayBuffer* acquire(uint32_t handle,
+                                unsigned long long ui64Stamp,
+                                uint32_t bufferType,
+                                int planeType);
+    void release(IntelDisplayBuffer *buffer);
+    // drop the mappings which are not held and were only acquired by
+    // planes of planeType
+    void invalidate(int planeType);
+    int getCapacity() const { return mCapacity; }
+    uint32_t getHits() const { return mHits; }
+    uint32_t getMisses() const { return mMisses; }
+    bool dump(char *buff, int buff_len, int *cur_len);
+};
+
 #endif /*__INTEL_PVR_BUFFER_MANAGER_H__*/
@@ -37,7 +37,7 @@ IntelDisplayPlaneManager::IntelDisplayPlaneManager(int fd,
       mReclaimedSpritePlanes(0), mReclaimedPrimaryPlanes(0),
       mReclaimedOverlayPlanes(0),
       mDrmFd(fd), mBufferManager(bm), mGrallocBufferManager(gm),
-      mInitialized(false)
+      mBufferCache(0), mInitialized(false)
 {
     int i = 0;
 
@@ -57,6 +57,14 @@ IntelDisplayPlaneManager::IntelDisplayPlaneManager(int fd,
 
     memset(mPlaneContexts, 0, mContextLength);
 
+    // allocate buffer cache
+    mBufferCache = new IntelBufferCache(mGrallocBufferManager,
+                                        cfg.buffer_cache);
+    if (!mBufferCache) {
+        LOGE("%s: failed to allocate buffer cache\n", __func__);
+        goto cache_alloc_err;
+    }
+
     // allocate primary plane pool
     if (mPrimaryPlaneCount) {
         mPrimaryPlanes =
@@ -75,6 +83,7 @@ IntelDisplayPlaneManager::IntelDisplayPlaneManager(int fd,
             }
             // set as primary plane
             mPrimaryPlanes[i]->mType = IntelDisplayPlane::DISPLAY_PLANE_PRIMARY;
+            mPrimaryPlanes[i]->mBufferCache = mBufferCache;
             // reset overlay plane
             mPrimaryPlanes[i]->reset();
         }
@@ -96,6 +105,7 @@ IntelDisplayPlaneManager::IntelDisplayPlaneManager(int fd,
                 LOGE("%s: failed to allocate sprite plane %d\n", __func__, i);
                 goto sprite_init_err;
             }
+            mSpritePlanes[i]->mBufferCache = mBufferCache;
             // reset overlay plane
             mSpritePlanes[i]->reset();
         }
@@ -117,6 +127,7 @@ IntelDisplayPlaneManager::IntelDisplayPlaneManager(int fd,
                 LOGE("%s: failed to allocate overlay plane %d\n", __func__, i);
                 goto overlay_alloc_err;
             }
+            mOverlayPlanes[i]->mBufferCache = mBufferCache;
             // reset overlay plane
             mOverlayPlanes[i]->reset();
         }
@@ -159,6 +170,9 @@ primary_init_err:
     free(mSpritePlanes);
     mSpritePlanes = 0;
 primary_alloc_err:
+    delete mBufferCache;
+    mBufferCache = 0;
+cache_alloc_err:
     free(mPlaneContexts);
     mInitialized = false;
 }
@@ -211,6 +225,10 @@ IntelDisplayPlaneManager::~IntelDisplayPlaneManager()
     if (mWidiPlane)
         delete mWidiPlane;
 
+    // unmap the cached buffers after the planes released them
+    delete mBufferCache;
+    mBufferCache = 0;
+
     mInitialized = false;
 }
 
@@ -362,6 +380,34 @@ bool IntelDisplayPlaneManager::hasFreeOverlays()
     return (mFreeOverlayPlanes || mReclaimedOverlayPlanes) ? true : false;
 }
 
+int IntelDisplayPlaneManager::getFreeSpriteCount()
+{
+    uint32_t mask = mFreeSpritePlanes | mReclaimedSpritePlanes;
+    int count = 0;
+
+    if (!initCheck())
+        return 0;
+
+    for (; mask; mask &= mask - 1)
+        count++;
+
+    return count;
+}
+
+int IntelDisplayPlaneManager::getFreeOverlayCount()
+{
+    uint32_t mask = mFreeOverlayPlanes | mReclaimedOverlayPlanes;
+    int count = 0;
+
+    if (!initCheck())
+        return 0;
+
+    for (; mask; mask &= mask - 1)
+        count++;
+
+    return count;
+}
+
 bool IntelDisplayPlaneManager::hasReclaimedOverlays()
 {
     if (!initCheck())
@@ -568,6 +614,9 @@ bool IntelDisplayPlaneManager::dump(char *buff,
 
     *cur_len = mDumpLen;
 
+    if (mBufferCache)
+        mBufferCache->dump(buff, buff_len, cur_len);
+
     return ret;
 }
 
@@ -89,8 +89,13 @@ protected:
     int mType;
     int mIndex;
     IntelBufferManager *mBufferManager;
+    IntelBufferCache *mBufferCache;
     IntelDisplayPlaneContext *mContext;
 
+    // mappings held for the current and the previous data buffer, the
+    // previous one is scanned out till the flip completes
+    IntelDisplayBuffer *mHeldBuffers[2];
+
     // plane parameters
     IntelDisplayBuffer *mDataBuffer;
     uint32_t mDataBufferHandle;
@@ -102,11 +107,12 @@ public:
     IntelDisplayPlane(int fd, int type,
                       int index, IntelBufferManager *bufferManager)
         : mDrmFd(fd), mType(type), mIndex(index),
-          mBufferManager(bufferManager),
+          mBufferManager(bufferManager), mBufferCache(0),
           mContext(0), mDataBuffer(0), mDataBufferHandle(0),
           mForceBottom(false),
           mInitialized(false) {
 	    memset(&mPosition, 0, sizeof(intel_display_plane_position_t));
+	    memset(mHeldBuffers, 0, sizeof(mHeldBuffers));
     }
     virtual ~IntelDisplayPlane() {}
     virtual bool initCheck() const { return mInitialized; }
@@ -141,6 +147,21 @@ public:
 
     // DRM mode change handler
     virtual uint32_t onDrmModeChange() { return 0; }
+protected:
+    // hold a buffer acquired from the buffer cache
+    void holdBuffer(IntelDisplayBuffer *buffer) {
+        if (mBufferCache)
+            mBufferCache->release(mHeldBuffers[1]);
+        mHeldBuffers[1] = mHeldBuffers[0];
+        mHeldBuffers[0] = buffer;
+    }
+    void releaseBuffers() {
+        if (mBufferCache) {
+            mBufferCache->release(mHeldBuffers[0]);
+            mBufferCache->release(mHeldBuffers[1]);
+        }
+        memset(mHeldBuffers, 0, sizeof(mHeldBuffers));
+    }
 
     friend class IntelDisplayPlaneManager;
 };
@@ -298,21 +319,6 @@ class IntelWidiPlane; // forward declaration
 
 class IntelOverlayPlane : public IntelDisplayPlane {
 private:
-    enum {
-        //BZ 33017. Don't hold too many buffers in GTT for advoiding reach GTT max size(128M).
-        //The final fix should be that video drvier don't need manage GTT anymore and hwc
-        //responsible for map/unmap all display buffers in GTT.
-        OVERLAY_DATA_BUFFER_NUM_MAX = 4,
-    };
-    // overlay mapped data buffers
-    struct {
-        uint32_t handle;
-        unsigned long long ui64Stamp;
-        IntelDisplayBuffer *buffer;
-        uint32_t bufferType;
-        int grallocBuffFd;
-    } mDataBuffers[OVERLAY_DATA_BUFFER_NUM_MAX];
-    int mNextBuffer;
     IntelWidiPlane* mWidiPlane;
 
 public:
@@ -375,17 +381,6 @@ public:
 };
 
 class MedfieldSpritePlane : public IntelSpritePlane {
-private:
-    enum {
-        SPRITE_DATA_BUFFER_NUM_MAX = 3,
-    };
-
-    struct {
-        unsigned long long ui64Stamp;
-        uint32_t handle;
-        IntelDisplayBuffer *buffer;
-    } mDataBuffers[SPRITE_DATA_BUFFER_NUM_MAX];
-    int mNextBuffer;
 protected:
     virtual bool checkPosition(int& left, int& top, int& right, int& bottom);
 public:
@@ -432,6 +427,8 @@ private:
     int mDrmFd;
     IntelBufferManager *mBufferManager;
     IntelBufferManager *mGrallocBufferManager;
+    // GTT mappings of the data buffers shared by the overlay and sprite planes
+    IntelBufferCache *mBufferCache;
 
     // raw data structure of display planes context
     // the length of the plane context should be different for different
@@ -467,6 +464,8 @@ public:
 
     bool hasFreeSprites();
     bool hasFreeOverlays();
+    int getFreeSpriteCount();
+    int getFreeOverlayCount();
     bool hasReclaimedOverlays();
     bool primaryAvailable(int index);
 
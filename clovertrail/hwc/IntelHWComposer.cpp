@@ -258,28 +258,8 @@ bool IntelHWComposer::isOverlayLayer(hwc_layer_list_t *list,
         goto out_check;
     }
 
-    // fall back if YUV Layer is in the middle of
-    // other layers and covers the layers under it.
-    if (!forceOverlay) {
-        for (int i = index - 1; i >= 0; i--) {
-            if (areLayersIntersecting(layer, &list->hwLayers[i])) {
-                useOverlay = false;
-                goto out_check;
-            }
-        }
-    }
-
-    // check whether layer are covered by layers above it
-    // if layer is covered by a layer which needs blending,
-    // clear corresponding region in frame buffer
-    for (size_t i = index + 1; i < list->numHwLayers; i++) {
-        if (areLayersIntersecting(&list->hwLayers[i], layer)) {
-            LOGD_IF(ALLOW_HWC_PRINT,
-                "%s: overlay %d is covered by layer %d\n", __func__, index, i);
-                if (list->hwLayers[i].blending !=  HWC_BLENDING_NONE)
-                    mLayerList->setNeedClearup(index, true);
-        }
-    }
+    // whether the YUV layer covers the layers under it, and the clear up
+    // of FB under blended layers above it, are left to the planner
 
     useOverlay = true;
     needClearFb = true;
@@ -594,10 +574,13 @@ bool IntelHWComposer::isScreenshotActive(hwc_layer_list_t *list)
 //    planes right after geometry is changed since there's no data in FB now,
 //    so we need to wait FB is update then disable these planes.
 // 1) build a new layer list for the changed hwc_layer_list
-// 2) attach planes to these layers which can be handled by HWC
+// 2) find the planes each layer could use, let the planner choose among
+//    them and attach planes to the chosen layers
 void IntelHWComposer::onGeometryChanged(hwc_layer_list_t *list)
 {
     bool firstTime = true;
+    bool forceSwapBuffer;
+    int freeOverlays, freeSprites;
 
     // reclaim all planes
     bool ret = mLayerList->invalidatePlanes();
@@ -617,37 +600,83 @@ void IntelHWComposer::onGeometryChanged(hwc_layer_list_t *list)
         goto out_check;
     }
 
-    for (size_t i = 0; list && i < list->numHwLayers; i++) {
-        // check whether a layer can be handled in general
-        if (!isHWCLayer(&list->hwLayers[i]))
-            continue;
+    if (!list)
+        goto out_check;
 
-        // further check whether a layer can be handle by overlay/sprite
+    freeOverlays = mPlaneManager->getFreeOverlayCount();
+    freeSprites = mPlaneManager->getFreeSpriteCount();
+    forceSwapBuffer = mForceSwapBuffer;
+
+    // collect the planes each layer could use, then let the planner choose
+    mPlanner.reset(freeOverlays, freeSprites);
+    for (size_t i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_t *layer = &list->hwLayers[i];
+        uint32_t candidates = IntelHWComposerPlanner::PLANE_FRAMEBUFFER;
+        uint32_t layerFlags = 0;
         int flags = 0;
-        bool hasOverlay = mPlaneManager->hasFreeOverlays();
-        bool hasSprite = mPlaneManager->hasFreeSprites();
 
-        if (hasOverlay && isOverlayLayer(list, i, &list->hwLayers[i], flags)) {
-            ret = overlayPrepare(i, &list->hwLayers[i], flags);
+        // check whether a layer can be handled in general, then
+        // further check whether a layer can be handle by overlay/sprite
+        if (isHWCLayer(layer)) {
+            if (freeOverlays && isOverlayLayer(list, i, layer, flags))
+                candidates |= IntelHWComposerPlanner::PLANE_OVERLAY;
+            else if (freeSprites && isSpriteLayer(list, i, layer, flags))
+                candidates |= IntelHWComposerPlanner::PLANE_SPRITE;
+        }
+
+        if (mLayerList->getForceOverlay(i))
+            layerFlags |= IntelHWComposerPlanner::LAYER_FORCED;
+        if (layer->blending != HWC_BLENDING_NONE)
+            layerFlags |= IntelHWComposerPlanner::LAYER_BLENDING;
+        if (mLayerList->getLayerType(i) == IntelHWComposerLayer::LAYER_TYPE_YUV)
+            layerFlags |= IntelHWComposerPlanner::LAYER_YUV;
+
+        mPlanner.addLayer(layer->displayFrame, candidates, layerFlags);
+    }
+
+    // checks above set it for every candidate, only the chosen ones count
+    mForceSwapBuffer = forceSwapBuffer;
+
+    mPlanner.plan();
+
+    for (size_t i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_t *layer = &list->hwLayers[i];
+
+        switch (mPlanner.getPlane(i)) {
+        case IntelHWComposerPlanner::PLANE_OVERLAY:
+            mLayerList->setNeedClearup(i, mPlanner.getNeedClearup(i));
+            mForceSwapBuffer = true;
+            ret = overlayPrepare(i, layer, 0);
             if (!ret) {
                 LOGE("%s: failed to prepare overlay\n", __func__);
-                list->hwLayers[i].compositionType = HWC_FRAMEBUFFER;
-                list->hwLayers[i].hints = 0;
+                layer->compositionType = HWC_FRAMEBUFFER;
+                layer->hints = 0;
             }
-        } else if (hasSprite && isSpriteLayer(list, i, &list->hwLayers[i], flags)) {
-            ret = spritePrepare(i, &list->hwLayers[i], flags);
+            break;
+        case IntelHWComposerPlanner::PLANE_SPRITE:
+            mLayerList->setNeedClearup(i, mPlanner.getNeedClearup(i));
+            if (layer->blending == HWC_BLENDING_NONE)
+                mForceSwapBuffer = true;
+            ret = spritePrepare(i, layer, 0);
             if (!ret) {
                 LOGE("%s: failed to prepare sprite\n", __func__);
-                list->hwLayers[i].compositionType = HWC_FRAMEBUFFER;
-                list->hwLayers[i].hints = 0;
+                layer->compositionType = HWC_FRAMEBUFFER;
+                layer->hints = 0;
             }
-        } else {
-            list->hwLayers[i].compositionType = HWC_FRAMEBUFFER;
+            break;
+        default:
+            if (!isHWCLayer(layer))
+                break;
+            // a candidate the planner didn't take
+            if (layer->compositionType == HWC_OVERLAY)
+                layer->hints = 0;
+            layer->compositionType = HWC_FRAMEBUFFER;
             if(firstTime && mPlaneManager->isWidiActive() ) {
                 IntelWidiPlane *p = (IntelWidiPlane *)mPlaneManager->getWidiPlane();
-                p->setOrientation(list->hwLayers[i].transform);
+                p->setOrientation(layer->transform);
                 firstTime = false;
             }
+            break;
         }
     }
 
@@ -834,13 +863,17 @@ bool IntelHWComposer::updateLayersData(hwc_layer_list_t *list)
     } else
          mFBDev->bBypassPost = cfg.bypasspost;
 
+    mFramePlaneUpdates = 0;
+
     for (size_t i=0 ; i<list->numHwLayers ; i++) {
         hwc_layer_t *layer = &list->hwLayers[i];
         intel_gralloc_buffer_handle_t *grallocHandle =
             (intel_gralloc_buffer_handle_t*)layer->handle;
 
+        // an unchanged video buffer was waited for already
         if (grallocHandle &&
-            grallocHandle->format == HAL_PIXEL_FORMAT_INTEL_HWC_NV12) {
+            grallocHandle->format == HAL_PIXEL_FORMAT_INTEL_HWC_NV12 &&
+            mLayerList->isLayerDamaged(i)) {
             // map payload buffer
             IntelPayloadBuffer buffer(mGrallocBufferManager, grallocHandle->fd[GRALLOC_SUB_BUFFER1]);
 
@@ -904,6 +937,28 @@ bool IntelHWComposer::updateLayersData(hwc_layer_list_t *list)
         int format = grallocHandle->format;
         uint32_t transform = layer->transform;
 
+        // the plane shows this buffer with this crop already, skip
+        // reprogramming it. The sprite isn't posted then as its context
+        // has no update, the overlay is posted with the same registers.
+        if (!mLayerList->isLayerDamaged(i) &&
+            mLayerList->isProgrammed(i, plane, layer->handle) &&
+            layer->compositionType == HWC_OVERLAY &&
+            !(mLayerList->getFlags(i) & IntelDisplayPlane::DELAY_DISABLE) &&
+            !(widiplane &&
+              planeType == IntelDisplayPlane::DISPLAY_PLANE_OVERLAY)) {
+            LOGD_IF(ALLOW_HWC_PRINT,
+                    "updateLayersData: layer %d unchanged", i);
+            mSkippedPlaneUpdates++;
+            mStatsSkippedPlaneUpdates++;
+            continue;
+        }
+
+        mPlaneUpdates++;
+        mFramePlaneUpdates++;
+
+        // recorded again once the plane took the new buffer
+        mLayerList->setProgrammed(i, 0, 0);
+
         if (planeType == IntelDisplayPlane::DISPLAY_PLANE_OVERLAY) {
             if (widiplane) {
                widiplane->setOverlayData(grallocHandle, srcWidth, srcHeight);
@@ -989,6 +1044,8 @@ bool IntelHWComposer::updateLayersData(hwc_layer_list_t *list)
                 mLayerList->detachPlane(i, plane);
                 layer->compositionType = HWC_FRAMEBUFFER;
                 handled = false;
+            } else {
+                mLayerList->setProgrammed(i, plane, layer->handle);
             }
         } else if (planeType == IntelDisplayPlane::DISPLAY_PLANE_SPRITE ||
                    planeType == IntelDisplayPlane::DISPLAY_PLANE_PRIMARY) {
@@ -1018,6 +1075,8 @@ bool IntelHWComposer::updateLayersData(hwc_layer_list_t *list)
                 mLayerList->detachPlane(i, plane);
                 layer->compositionType = HWC_FRAMEBUFFER;
                 handled = false;
+            } else {
+                mLayerList->setProgrammed(i, plane, layer->handle);
             }
         } else {
             LOGW("%s: invalid plane type %d\n", __func__, planeType);
@@ -1332,6 +1391,13 @@ bool IntelHWComposer::prepare(hwc_layer_list_t *list)
         }
     }
 
+    // find the layers whose buffer changed since the last frame
+    if (list && mLayerList->updateDamage(list)) {
+        const hwc_rect_t& damage = mLayerList->getDamage();
+        LOGD_IF(ALLOW_HWC_PRINT, "prepare: damage [%d, %d, %d, %d]\n",
+                damage.left, damage.top, damage.right, damage.bottom);
+    }
+
     // handle buffer changing. setup data buffer.
     if (list && !updateLayersData(list)) {
         LOGD_IF(ALLOW_HWC_PRINT, "prepare: revisiting layer list\n");
@@ -1398,6 +1464,29 @@ bool IntelHWComposer::commit(hwc_display_t dpy,
         needSwapBuffer = false;
     }
 
+    mCommits++;
+
+    // nothing was damaged or programmed and FB is unchanged, the planes
+    // keep scanning out the same buffers, skip the flips and Post2
+    if (!needSwapBuffer && list && !mLayerList->hasDamage() &&
+        !mFramePlaneUpdates && !mPlaneManager->isWidiActive()) {
+        bool pending = false;
+        for (size_t i=0 ; i<list->numHwLayers ; i++) {
+            if (mLayerList->getFlags(i) & IntelDisplayPlane::DELAY_DISABLE) {
+                pending = true;
+                break;
+            }
+        }
+
+        if (!pending) {
+            LOGD_IF(ALLOW_HWC_PRINT, "%s: no damage, skip flip\n", __func__);
+            mSkippedCommits++;
+            mStatsSkippedCommits++;
+            updateSkipStats();
+            return true;
+        }
+    }
+
     // check whether eglSwapBuffers is still needed for the given layer list
     if (needSwapBuffer) {
         LOGD_IF(ALLOW_HWC_PRINT, "%s: eglSwapBuffers\n", __func__);
@@ -1485,9 +1574,33 @@ bool IntelHWComposer::commit(hwc_display_t dpy,
             plane->waitForFlipCompletion();
         }
 
+    updateSkipStats();
     return true;
 }
 
+void IntelHWComposer::updateSkipStats()
+{
+    nsecs_t now = systemTime(CLOCK_MONOTONIC);
+    nsecs_t elapsed = now - mStatsTime;
+
+    if (elapsed < seconds(1))
+        return;
+
+    if (mStatsTime) {
+        mSkippedPlaneUpdatesRate =
+            (uint32_t)(mStatsSkippedPlaneUpdates * seconds(1) / elapsed);
+        mSkippedCommitsRate =
+            (uint32_t)(mStatsSkippedCommits * seconds(1) / elapsed);
+        LOGD_IF(ALLOW_HWC_PRINT,
+                "%s: skipped %d plane updates/s, %d commits/s\n", __func__,
+                mSkippedPlaneUpdatesRate, mSkippedCommitsRate);
+    }
+
+    mStatsTime = now;
+    mStatsSkippedPlaneUpdates = 0;
+    mStatsSkippedCommits = 0;
+}
+
 uint32_t IntelHWComposer::disableUnusedVsyncs(uint32_t target)
 {
     uint32_t unusedVsyncs = mActiveVsyncs & (~target);
@@ -1695,9 +1808,20 @@ bool IntelHWComposer::dump(char *buff,
         (mDrm->getOutputConnection(OUTPUT_HDMI) == DRM_MODE_CONNECTED) ? 1 : 0);
        dumpPrintf("  + isWidiActive: %d \n", (widiPlane->isActive()) ? 1 : 0);
        dumpPrintf("  + mActiveVsyncs: 0x%x, mVsyncsEnabled: %d \n", mActiveVsyncs, mVsyncsEnabled);
+
+       const hwc_rect_t& damage = mLayerList->getDamage();
+       dumpPrintf("  + damage: [%d, %d, %d, %d], damaged layers: %d \n",
+                  damage.left, damage.top, damage.right, damage.bottom,
+                  mLayerList->getDamagedLayersCount());
+       dumpPrintf("  + skipped plane updates: %d/s, %d of %d \n",
+                  mSkippedPlaneUpdatesRate, mSkippedPlaneUpdates,
+                  mSkippedPlaneUpdates + mPlaneUpdates);
+       dumpPrintf("  + skipped commits: %d/s, %d of %d \n",
+                  mSkippedCommitsRate, mSkippedCommits, mCommits);
     }
 
     mPlaneManager->dump(mDumpBuf,  mDumpBuflen, &mDumpLen);
+    mPlanner.dump(mDumpBuf,  mDumpBuflen, &mDumpLen);
 
     return ret;
 }
@@ -35,6 +35,7 @@
 #include <IntelBufferManager.h>
 #include <IntelHWComposerLayer.h>
 #include <IntelHWComposerDump.h>
+#include <IntelHWComposerPlanner.h>
 #include <IntelVsyncEventHandler.h>
 #include <IntelFakeVsyncEvent.h>
 #ifdef INTEL_RGB_OVERLAY
@@ -55,6 +56,7 @@ private:
     IntelBufferManager *mGrallocBufferManager;
     IntelDisplayPlaneManager *mPlaneManager;
     IntelHWComposerLayerList *mLayerList;
+    IntelHWComposerPlanner mPlanner;
     hwc_procs_t const *mProcs;
     android::sp<IntelVsyncEventHandler> mVsync;
     android::sp<IntelFakeVsyncEvent> mFakeVsync;
@@ -70,6 +72,22 @@ private:
 #ifdef INTEL_RGB_OVERLAY
     IntelHWCWrapper mWrapper;
 #endif
+
+    // statistics of the plane updates and commits skipped as nothing
+    // changed, totals and per second rates of the last second
+    uint32_t mPlaneUpdates;
+    uint32_t mSkippedPlaneUpdates;
+    uint32_t mCommits;
+    uint32_t mSkippedCommits;
+    nsecs_t mStatsTime;
+    uint32_t mStatsSkippedPlaneUpdates;
+    uint32_t mStatsSkippedCommits;
+    uint32_t mSkippedPlaneUpdatesRate;
+    uint32_t mSkippedCommitsRate;
+
+    // planes programmed by the last prepare, they need a flip even if
+    // no layer was damaged
+    uint32_t mFramePlaneUpdates;
 private:
     void dumpLayerList(hwc_layer_list_t *list);
     void onGeometryChanged(hwc_layer_list_t *list);
@@ -105,6 +123,7 @@ private:
     void handleHotplugEvent();
     uint32_t disableUnusedVsyncs(uint32_t target);
     uint32_t enableVsyncs(uint32_t target);
+    void updateSkipStats();
 public:
     void onUEvent(const char *msg, int msgLen, int msgType);
     bool flipFramebufferContexts(void *contexts);
@@ -127,7 +146,12 @@ public:
           mDrm(0), mBufferManager(0), mGrallocBufferManager(0),
           mPlaneManager(0), mLayerList(0), mProcs(0), mVsync(0), mFakeVsync(0),
           mLastVsync(0), mMonitoringMethod(0), mForceSwapBuffer(false),
-          mHotplugEvent(false), mInitialized(false), mActiveVsyncs(0) {}
+          mHotplugEvent(false), mInitialized(false), mActiveVsyncs(0),
+          mPlaneUpdates(0), mSkippedPlaneUpdates(0),
+          mCommits(0), mSkippedCommits(0), mStatsTime(0),
+          mStatsSkippedPlaneUpdates(0), mStatsSkippedCommits(0),
+          mSkippedPlaneUpdatesRate(0), mSkippedCommitsRate(0),
+          mFramePlaneUpdates(0) {}
     ~IntelHWComposer();
 };
 
@@ -36,6 +36,8 @@ typedef struct {
     unsigned char enable;
     unsigned int log_level;
     unsigned int bypasspost;
+    /* number of buffer mappings kept for the overlay and sprite planes */
+    unsigned int buffer_cache;
 } hwc_cfg;
 
 enum hwc_log_level {
@@ -31,7 +31,8 @@
 #include <IntelHWComposerCfg.h>
 
 IntelHWComposerLayer::IntelHWComposerLayer()
-    : mHWCLayer(0), mPlane(0), mFlags(0)
+    : mHWCLayer(0), mPlane(0), mFlags(0),
+      mProgrammedPlane(0), mProgrammedHandle(0)
 {
 
 }
@@ -40,7 +41,8 @@ IntelHWComposerLayer::IntelHWComposerLayer(hwc_layer_t *layer,
                                            IntelDisplayPlane *plane,
                                            int flags)
     : mHWCLayer(layer), mPlane(plane), mFlags(flags), mForceOverlay(false),
-      mLayerType(0), mFormat(0), mIsProtected(false)
+      mLayerType(0), mFormat(0), mIsProtected(false),
+      mProgrammedPlane(0), mProgrammedHandle(0)
 {
 
 }
@@ -58,8 +60,13 @@ IntelHWComposerLayerList::IntelHWComposerLayerList(IntelDisplayPlaneManager *pm)
       mNumYUVLayers(0),
       mAttachedSpritePlanes(0),
       mAttachedOverlayPlanes(0),
-      mNumAttachedPlanes(0)
+      mNumAttachedPlanes(0),
+      mGeometryHash(0),
+      mNumDamagedLayers(0)
 {
+    memset(&mBounds, 0, sizeof(mBounds));
+    memset(&mDamage, 0, sizeof(mDamage));
+
     if (!mPlaneManager)
         mInitialized = false;
     else
@@ -124,6 +131,12 @@ void IntelHWComposerLayerList::updateLayerList(hwc_layer_list_t *layerList)
         mLayerList[i].mLayerType = IntelHWComposerLayer::LAYER_TYPE_INVALID;
         mLayerList[i].mFormat = 0;
         mLayerList[i].mIsProtected = false;
+        mLayerList[i].mLastHandle = 0;
+        mLayerList[i].mLastStamp = 0;
+        memset(&mLayerList[i].mLastCrop, 0, sizeof(hwc_rect_t));
+        mLayerList[i].mDamaged = true;
+        mLayerList[i].mProgrammedPlane = 0;
+        mLayerList[i].mProgrammedHandle = 0;
 
         // update layer format
         intel_gralloc_buffer_handle_t *grallocHandle =
@@ -211,6 +224,8 @@ void IntelHWComposerLayerList::detachPlane(int index, IntelDisplayPlane *plane)
         mPlaneManager->reclaimPlane(plane);
         mLayerList[index].mPlane = 0;
         mLayerList[index].mFlags = 0;
+        mLayerList[index].mProgrammedPlane = 0;
+        mLayerList[index].mProgrammedHandle = 0;
         if (plane->getPlaneType() == IntelDisplayPlane::DISPLAY_PLANE_SPRITE)
             mAttachedSpritePlanes--;
         else if (plane->getPlaneType() == IntelDisplayPlane::DISPLAY_PLANE_OVERLAY)
@@ -304,6 +319,37 @@ bool IntelHWComposerLayerList::getNeedClearup(int index)
     return false;
 }
 
+void IntelHWComposerLayerList::setProgrammed(int index,
+                                             IntelDisplayPlane *plane,
+                                             buffer_handle_t handle)
+{
+    if (index < 0 || index >= mNumLayers) {
+        LOGE("%s: Invalid parameters\n", __func__);
+        return;
+    }
+
+    if (initCheck()) {
+        mLayerList[index].mProgrammedPlane = plane;
+        mLayerList[index].mProgrammedHandle = handle;
+    }
+}
+
+bool IntelHWComposerLayerList::isProgrammed(int index,
+                                            IntelDisplayPlane *plane,
+                                            buffer_handle_t handle) const
+{
+    if (index < 0 || index >= mNumLayers) {
+        LOGE("%s: Invalid parameters\n", __func__);
+        return false;
+    }
+
+    if (initCheck())
+        return plane && mLayerList[index].mProgrammedPlane == plane &&
+               mLayerList[index].mProgrammedHandle == handle;
+
+    return false;
+}
+
 int IntelHWComposerLayerList::getLayerType(int index) const
 {
     if (!initCheck() || index < 0 || index >= mNumLayers) {
@@ -381,3 +427,111 @@ void IntelHWComposerLayerList::clearWithOpenGL() const
     glVertexPointer(2, GL_FLOAT, 0, vertices);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 }
+
+static void unionRect(hwc_rect_t& dst, const hwc_rect_t& src)
+{
+    if (src.left >= src.right || src.top >= src.bottom)
+        return;
+
+    if (dst.left >= dst.right || dst.top >= dst.bottom) {
+        dst = src;
+        return;
+    }
+
+    if (src.left < dst.left)
+        dst.left = src.left;
+    if (src.top < dst.top)
+        dst.top = src.top;
+    if (src.right > dst.right)
+        dst.right = src.right;
+    if (src.bottom > dst.bottom)
+        dst.bottom = src.bottom;
+}
+
+uint32_t IntelHWComposerLayerList::hashGeometry(hwc_layer_list_t *layerList) const
+{
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+
+    hash = (hash ^ layerList->numHwLayers) * 16777619U;
+    for (size_t i = 0; i < layerList->numHwLayers; i++) {
+        hwc_layer_t *layer = &layerList->hwLayers[i];
+        uint32_t words[] = {
+            (uint32_t)layer->displayFrame.left,
+            (uint32_t)layer->displayFrame.top,
+            (uint32_t)layer->displayFrame.right,
+            (uint32_t)layer->displayFrame.bottom,
+            layer->transform,
+            (uint32_t)layer->blending,
+            layer->flags,
+        };
+
+        for (size_t j = 0; j < sizeof(words) / sizeof(words[0]); j++)
+            hash = (hash ^ words[j]) * 16777619U;
+    }
+
+    return hash;
+}
+
+bool IntelHWComposerLayerList::updateDamage(hwc_layer_list_t *layerList)
+{
+    hwc_rect_t bounds;
+
+    memset(&mDamage, 0, sizeof(mDamage));
+    memset(&bounds, 0, sizeof(bounds));
+    mNumDamagedLayers = 0;
+
+    if (!initCheck() || !layerList)
+        return false;
+
+    uint32_t hash = hashGeometry(layerList);
+    bool geometryChanged = (hash != mGeometryHash);
+    mGeometryHash = hash;
+
+    for (int i = 0; i < mNumLayers && i < (int)layerList->numHwLayers; i++) {
+        IntelHWComposerLayer& layer = mLayerList[i];
+        hwc_layer_t *hwcLayer = &layerList->hwLayers[i];
+        intel_gralloc_buffer_handle_t *grallocHandle =
+            (intel_gralloc_buffer_handle_t*)hwcLayer->handle;
+        unsigned long long stamp = grallocHandle ? grallocHandle->ui64Stamp : 0;
+
+        layer.mDamaged = geometryChanged ||
+                         layer.mLastHandle != hwcLayer->handle ||
+                         layer.mLastStamp != stamp ||
+                         memcmp(&layer.mLastCrop, &hwcLayer->sourceCrop,
+                                sizeof(hwc_rect_t));
+
+        layer.mLastHandle = hwcLayer->handle;
+        layer.mLastStamp = stamp;
+        layer.mLastCrop = hwcLayer->sourceCrop;
+
+        if (layer.mDamaged) {
+            unionRect(mDamage, hwcLayer->displayFrame);
+            mNumDamagedLayers++;
+        }
+        unionRect(bounds, hwcLayer->displayFrame);
+    }
+
+    // layers moved away from the area they covered last frame
+    if (geometryChanged)
+        unionRect(mDamage, mBounds);
+    mBounds = bounds;
+
+    return hasDamage();
+}
+
+bool IntelHWComposerLayerList::isLayerDamaged(int index) const
+{
+    if (!initCheck() || index < 0 || index >= mNumLayers) {
+        LOGE("%s: Invalid parameters\n", __func__);
+        return true;
+    }
+
+    return mLayerList[index].mDamaged;
+}
+
+bool IntelHWComposerLayerList::hasDamage() const
+{
+    return mNumDamagedLayers ||
+           ((mDamage.left < mDamage.right) && (mDamage.top < mDamage.bottom));
+}
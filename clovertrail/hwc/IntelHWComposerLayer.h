@@ -51,6 +51,18 @@ private:
     int mLayerType;
     int mFormat;
     bool mIsProtected;
+
+    // buffer of the last frame, to find the layers which changed
+    buffer_handle_t mLastHandle;
+    unsigned long long mLastStamp;
+    hwc_rect_t mLastCrop;
+    bool mDamaged;
+
+    // plane and buffer the layer was last programmed with. A plane is
+    // attached after the layer data was set up when the list is revisited,
+    // so an undamaged layer isn't necessarily shown by its plane yet
+    IntelDisplayPlane *mProgrammedPlane;
+    buffer_handle_t mProgrammedHandle;
 public:
     IntelHWComposerLayer();
     IntelHWComposerLayer(hwc_layer_t *layer,
@@ -71,7 +83,18 @@ private:
     int mAttachedSpritePlanes;
     int mAttachedOverlayPlanes;
     int mNumAttachedPlanes;
+
+    // damage tracking. A layer is damaged if its buffer or source crop
+    // changed, all layers are if the geometry (hash of the layer frames,
+    // transforms, blending and flags) changed. The damage region is the
+    // union of the frames of the damaged layers.
+    uint32_t mGeometryHash;
+    hwc_rect_t mBounds;
+    hwc_rect_t mDamage;
+    int mNumDamagedLayers;
     bool mInitialized;
+private:
+    uint32_t hashGeometry(hwc_layer_list_t *layerList) const;
 public:
     IntelHWComposerLayerList(IntelDisplayPlaneManager *pm);
     ~IntelHWComposerLayerList();
@@ -87,6 +110,10 @@ public:
     bool getForceOverlay(int index);
     void setNeedClearup(int index, bool needClearup);
     bool getNeedClearup(int index);
+    void setProgrammed(int index, IntelDisplayPlane *plane,
+                       buffer_handle_t handle);
+    bool isProgrammed(int index, IntelDisplayPlane *plane,
+                      buffer_handle_t handle) const;
     int getLayerType(int index) const;
     int getLayerFormat(int index) const;
     bool isProtectedLayer(int index) const;
@@ -97,6 +124,13 @@ public:
     int getAttachedSpriteCount() const { return mAttachedSpritePlanes; }
     int getAttachedOverlayCount() const { return mAttachedOverlayPlanes; }
     void clearWithOpenGL() const;
+
+    // find the damaged layers of a new frame, return true if any
+    bool updateDamage(hwc_layer_list_t *layerList);
+    bool isLayerDamaged(int index) const;
+    bool hasDamage() const;
+    const hwc_rect_t& getDamage() const { return mDamage; }
+    int getDamagedLayersCount() const { return mNumDamagedLayers; }
 };
 
 #endif /*__INTEL_HWCOMPOSER_LAYER_H__*/
@@ -186,6 +186,7 @@ static int hwc_get_cfg(hwc_cfg *cfg)
         cfg->enable = 1;
         cfg->log_level = 0;
         cfg->bypasspost = 1;
+        cfg->buffer_cache = IntelBufferCache::CACHE_SIZE_DEFAULT;
     }
 
     fp = fopen(HWC_CFG_PATH, "r");
@@ -207,9 +208,13 @@ static int hwc_get_cfg(hwc_cfg *cfg)
         if (pch != NULL)
             cfg->bypasspost = atoi(pch+strlen("bypasspost="));
 
+        pch = strstr(cfg_string, "buffer_cache");
+        if (pch != NULL)
+            cfg->buffer_cache = atoi(pch+strlen("buffer_cache="));
 
-        LOGD("%s:get cfg parameter enable_hwc=%d,log_level=%d,bypasspost=%d!\n",
-                     __func__, cfg->enable, cfg->log_level, cfg->bypasspost);
+        LOGD("%s:get cfg parameter enable_hwc=%d,log_level=%d,bypasspost=%d,"
+             "buffer_cache=%d!\n", __func__, cfg->enable, cfg->log_level,
+             cfg->bypasspost, cfg->buffer_cache);
         fclose(fp);
     }
 
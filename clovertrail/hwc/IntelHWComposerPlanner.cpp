@@ -0,0 +1,418 @@
+/*
+ * Copyright © 2012 Intel Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+#include <cutils/log.h>
+#include <string.h>
+
+#include <IntelHWComposerPlanner.h>
+#include <IntelHWComposerCfg.h>
+
+// costs are in composed pixels
+// eglSwapBuffers & GL setup of a frame which uses the frame buffer
+#define PLANNER_COST_SWAP       (256 * 1024)
+// enabling a plane, mostly the power of its fetch
+#define PLANNER_COST_PLANE      (16 * 1024)
+// a forced layer which doesn't get an overlay
+#define PLANNER_COST_FORCED     (1LL << 40)
+
+static bool isIntersecting(const hwc_rect_t& a, const hwc_rect_t& b)
+{
+    // same test as IntelHWComposer::areLayersIntersecting
+    if (b.right <= a.left ||
+        b.left >= a.right ||
+        b.top >= a.bottom ||
+        b.bottom <= a.top)
+        return false;
+
+    return true;
+}
+
+static int64_t getArea(const hwc_rect_t& r)
+{
+    int64_t w = r.right - r.left;
+    int64_t h = r.bottom - r.top;
+
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    return w * h;
+}
+
+IntelHWComposerPlanner::IntelHWComposerPlanner()
+    : IntelHWComposerDump(),
+      mNumLayers(0), mTotalLayers(0), mFreeOverlays(0), mFreeSprites(0),
+      mBestCost(0), mNodes(0), mClearup(0), mAge(0),
+      mCacheHits(0), mCacheMisses(0), mLastNodes(0),
+      mLastCost(0), mLastGreedyCost(0)
+{
+    memset(mPlanes, 0, sizeof(mPlanes));
+    memset(mCache, 0, sizeof(mCache));
+}
+
+IntelHWComposerPlanner::~IntelHWComposerPlanner()
+{
+}
+
+void IntelHWComposerPlanner::reset(int freeOverlays, int freeSprites)
+{
+    mNumLayers = 0;
+    mTotalLayers = 0;
+    mFreeOverlays = freeOverlays;
+    mFreeSprites = freeSprites;
+    mClearup = 0;
+}
+
+void IntelHWComposerPlanner::addLayer(const hwc_rect_t& frame,
+                                      uint32_t candidates,
+                                      uint32_t flags)
+{
+    mTotalLayers++;
+    if (mNumLayers >= PLANNER_MAX_LAYERS)
+        return;
+
+    Layer& layer = mLayers[mNumLayers++];
+    layer.frame = frame;
+    layer.candidates = candidates;
+    layer.flags = flags;
+}
+
+int IntelHWComposerPlanner::getPlane(int index) const
+{
+    if (index < 0 || index >= mNumLayers || mTotalLayers > mNumLayers)
+        return PLANE_FRAMEBUFFER;
+
+    return mPlanes[index];
+}
+
+bool IntelHWComposerPlanner::getNeedClearup(int index) const
+{
+    if (index < 0 || index >= mNumLayers)
+        return false;
+
+    return (mClearup & (1 << index)) ? true : false;
+}
+
+// FNV-1a over everything the decision depends on, a word at a time
+uint64_t IntelHWComposerPlanner::hashInput() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const uint32_t *p = (const uint32_t*)mLayers;
+    size_t words = mNumLayers * sizeof(Layer) / sizeof(uint32_t);
+
+    hash = (hash ^ mNumLayers) * 1099511628211ULL;
+    hash = (hash ^ mFreeOverlays) * 1099511628211ULL;
+    hash = (hash ^ mFreeSprites) * 1099511628211ULL;
+
+    for (size_t i = 0; i < words; i++)
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+
+    return hash;
+}
+
+// sweep the layers by left edge, only the layers whose right edge is past
+// the current left edge are compared, the others are dropped for good
+void IntelHWComposerPlanner::buildOverlaps()
+{
+    int order[PLANNER_MAX_LAYERS];
+    int active[PLANNER_MAX_LAYERS];
+    int numActive = 0;
+    uint32_t blended = 0;
+
+    for (int i = 0; i < mNumLayers; i++) {
+        int left = mLayers[i].frame.left;
+        int j = i;
+
+        // insertion sort, lists are short and mostly sorted already
+        while (j > 0 && mLayers[order[j - 1]].frame.left > left) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+
+        mOverlaps[i] = 0;
+        if (mLayers[i].flags & LAYER_BLENDING)
+            blended |= (1 << i);
+    }
+
+    for (int k = 0; k < mNumLayers; k++) {
+        int index = order[k];
+        const hwc_rect_t& frame = mLayers[index].frame;
+        int n = 0;
+
+        for (int a = 0; a < numActive; a++) {
+            int other = active[a];
+
+            if (mLayers[other].frame.right <= frame.left)
+                continue;
+
+            active[n++] = other;
+            if (isIntersecting(mLayers[other].frame, frame)) {
+                mOverlaps[index] |= (1 << other);
+                mOverlaps[other] |= (1 << index);
+            }
+        }
+
+        numActive = n;
+        active[numActive++] = index;
+    }
+
+    for (int i = 0; i < mNumLayers; i++) {
+        uint32_t lower = (1U << i) - 1;
+        uint32_t upper = ~lower & ~(1U << i);
+
+        mCovering[i] = mOverlaps[i] & upper & blended;
+
+        // planes are under FB, a layer on a plane can't cover lower layers
+        mFeasible[i] = mLayers[i].candidates;
+        if (!(mLayers[i].flags & LAYER_FORCED) && (mOverlaps[i] & lower))
+            mFeasible[i] = PLANE_FRAMEBUFFER;
+    }
+}
+
+int64_t IntelHWComposerPlanner::planeCost(int index) const
+{
+    int64_t cost = PLANNER_COST_PLANE;
+
+    // FB under it has to be cleared for the blended layers over it
+    if (mCovering[index])
+        cost += getArea(mLayers[index].frame);
+
+    return cost;
+}
+
+int64_t IntelHWComposerPlanner::framebufferCost(int index) const
+{
+    uint32_t flags = mLayers[index].flags;
+    int64_t cost = getArea(mLayers[index].frame);
+
+    if (flags & LAYER_BLENDING)
+        cost *= 2;
+    // color conversion in the shader
+    if (flags & LAYER_YUV)
+        cost *= 2;
+    if (flags & LAYER_FORCED)
+        cost += PLANNER_COST_FORCED;
+
+    return cost;
+}
+
+// the order of IntelHWComposer before the planner: bottom up, overlay
+// first, then sprite, otherwise FB
+int64_t IntelHWComposerPlanner::greedy()
+{
+    int overlays = mFreeOverlays;
+    int sprites = mFreeSprites;
+    bool useFramebuffer = false;
+    int64_t cost = 0;
+
+    for (int i = 0; i < mNumLayers; i++) {
+        if (overlays && (mFeasible[i] & PLANE_OVERLAY)) {
+            mBest[i] = PLANE_OVERLAY;
+            overlays--;
+            cost += planeCost(i);
+        } else if (sprites && (mFeasible[i] & PLANE_SPRITE)) {
+            mBest[i] = PLANE_SPRITE;
+            sprites--;
+            cost += planeCost(i);
+        } else {
+            mBest[i] = PLANE_FRAMEBUFFER;
+            useFramebuffer = true;
+            cost += framebufferCost(i);
+        }
+    }
+
+    if (useFramebuffer)
+        cost += PLANNER_COST_SWAP;
+
+    return cost;
+}
+
+void IntelHWComposerPlanner::search(int index, int overlays, int sprites,
+                                    int64_t cost, bool useFramebuffer)
+{
+    if (mNodes++ >= PLANNER_MAX_NODES)
+        return;
+
+    // bound: the remaining layers at their cheapest, ignoring plane count
+    bool needFramebuffer = useFramebuffer || mNeedFramebuffer[index];
+    int64_t bound = cost + mMinCost[index];
+    if (needFramebuffer)
+        bound += PLANNER_COST_SWAP;
+
+    if (bound >= mBestCost)
+        return;
+
+    if (index == mNumLayers) {
+        mBestCost = bound;
+        memcpy(mBest, mCurrent, mNumLayers * sizeof(int));
+        return;
+    }
+
+    // planes first, the cheap plans are found early and bound the rest
+    if (overlays && (mFeasible[index] & PLANE_OVERLAY)) {
+        mCurrent[index] = PLANE_OVERLAY;
+        search(index + 1, overlays - 1, sprites,
+               cost + planeCost(index), useFramebuffer);
+    }
+
+    if (sprites && (mFeasible[index] & PLANE_SPRITE)) {
+        mCurrent[index] = PLANE_SPRITE;
+        search(index + 1, overlays, sprites - 1,
+               cost + planeCost(index), useFramebuffer);
+    }
+
+    mCurrent[index] = PLANE_FRAMEBUFFER;
+    search(index + 1, overlays, sprites,
+           cost + framebufferCost(index), true);
+}
+
+IntelHWComposerPlanner::Decision*
+IntelHWComposerPlanner::lookup(uint64_t hash)
+{
+    for (int i = 0; i < PLANNER_CACHE_SIZE; i++) {
+        if (mCache[i].age && mCache[i].hash == hash) {
+            mCache[i].age = mAge;
+            return &mCache[i];
+        }
+    }
+
+    return 0;
+}
+
+void IntelHWComposerPlanner::store(uint64_t hash)
+{
+    Decision *entry = &mCache[0];
+
+    // replace an empty or the least recently used entry
+    for (int i = 1; i < PLANNER_CACHE_SIZE && entry->age; i++) {
+        if (mCache[i].age < entry->age)
+            entry = &mCache[i];
+    }
+
+    entry->hash = hash;
+    entry->age = mAge;
+    entry->cost = mLastCost;
+    entry->greedyCost = mLastGreedyCost;
+    entry->clearup = mClearup;
+    memcpy(entry->planes, mPlanes, mNumLayers * sizeof(int));
+}
+
+bool IntelHWComposerPlanner::plan()
+{
+    mClearup = 0;
+    mLastNodes = 0;
+
+    // too many layers, GL composes the frame anyway
+    if (mTotalLayers > mNumLayers) {
+        LOGD_IF(ALLOW_HWC_PRINT, "%s: %d layers, use FB\n",
+                __func__, mTotalLayers);
+        memset(mPlanes, 0, sizeof(mPlanes));
+        return false;
+    }
+
+    mAge++;
+
+    uint64_t hash = hashInput();
+    Decision *decision = lookup(hash);
+    if (decision) {
+        memcpy(mPlanes, decision->planes, mNumLayers * sizeof(int));
+        mClearup = decision->clearup;
+        mLastCost = decision->cost;
+        mLastGreedyCost = decision->greedyCost;
+        mCacheHits++;
+        return true;
+    }
+
+    mCacheMisses++;
+
+    buildOverlaps();
+
+    // cheapest cost of each layer suffix, and whether it must use FB
+    mMinCost[mNumLayers] = 0;
+    mNeedFramebuffer[mNumLayers] = false;
+    for (int i = mNumLayers - 1; i >= 0; i--) {
+        int64_t cost = framebufferCost(i);
+        bool needFramebuffer = true;
+
+        if (mFeasible[i] && planeCost(i) < cost) {
+            cost = planeCost(i);
+            needFramebuffer = false;
+        } else if (mFeasible[i]) {
+            needFramebuffer = false;
+        }
+
+        mMinCost[i] = mMinCost[i + 1] + cost;
+        mNeedFramebuffer[i] = mNeedFramebuffer[i + 1] || needFramebuffer;
+    }
+
+    mBestCost = greedy();
+    mLastGreedyCost = mBestCost;
+
+    mNodes = 0;
+    search(0, mFreeOverlays, mFreeSprites, 0, false);
+    mLastNodes = mNodes;
+    mLastCost = mBestCost;
+
+    memcpy(mPlanes, mBest, mNumLayers * sizeof(int));
+    for (int i = 0; i < mNumLayers; i++) {
+        if (mPlanes[i] != PLANE_FRAMEBUFFER && mCovering[i])
+            mClearup |= (1 << i);
+    }
+
+    LOGD_IF(ALLOW_HWC_PRINT, "%s: cost %lld, greedy %lld, %d nodes\n",
+            __func__, (long long)mLastCost, (long long)mLastGreedyCost,
+            mLastNodes);
+
+    store(hash);
+    return false;
+}
+
+bool IntelHWComposerPlanner::dump(char *buff,
+                                  int buff_len, int *cur_len)
+{
+    mDumpBuf = buff;
+    mDumpBuflen = buff_len;
+    mDumpLen = *cur_len;
+
+    dumpPrintf("-------------- Layer Planner ---------------\n");
+    dumpPrintf("     free overlays: %d, free sprites: %d, layers: %d\n",
+               mFreeOverlays, mFreeSprites, mTotalLayers);
+    for (int i = 0; i < mNumLayers; i++) {
+        const hwc_rect_t& frame = mLayers[i].frame;
+        dumpPrintf("     layer %d: frame [%d, %d, %d, %d], "
+                   "candidates 0x%x, flags 0x%x, plane %d, clearup %d\n",
+                   i, frame.left, frame.top, frame.right, frame.bottom,
+                   mLayers[i].candidates, mLayers[i].flags,
+                   getPlane(i), getNeedClearup(i) ? 1 : 0);
+    }
+    dumpPrintf("     cost: %lld, greedy cost: %lld, nodes: %d\n",
+               (long long)mLastCost, (long long)mLastGreedyCost, mLastNodes);
+    dumpPrintf("     cache hits: %u, cache misses: %u\n",
+               mCacheHits, mCacheMisses);
+    dumpPrintf("-------------End of Layer Planner-----------\n");
+
+    *cur_len = mDumpLen;
+
+    return true;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2012 Intel Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+#ifndef __INTEL_HWCOMPOSER_PLANNER_H__
+#define __INTEL_HWCOMPOSER_PLANNER_H__
+
+#include <stdint.h>
+#include <hardware/hwcomposer.h>
+#include <IntelHWComposerDump.h>
+
+// IntelHWComposerPlanner: choose which layers of a geometry go to the
+// overlay/sprite planes and which are composed into the frame buffer.
+//
+// The per layer checks (format, blending, transform, scaling, skip flag)
+// stay in IntelHWComposer and give the candidate planes of each layer.
+// The planner adds the z order constraint: display planes are below the
+// frame buffer, so a layer can only be put on a plane if it covers none
+// of the layers under it (unless it is forced to overlay, e.g. protected
+// video). Overlaps are found once per geometry by a sweep over the layers
+// sorted by their left edge, and kept as one bit mask per layer.
+//
+// Assignments are then searched depth first from the bottom layer with
+// branch and bound: the cost of a plan is the GL composition of the frame
+// buffer layers (pixels, more for blending and YUV), a swap when the
+// frame buffer is used at all, and a small cost per plane plus the clear of
+// the frame buffer under blended layers above it. The search starts from the
+// greedy bottom-up plan, so it never does worse, and gives up after
+// PLANNER_MAX_NODES nodes keeping the best plan found.
+//
+// Geometry changes often toggle between a few layouts (e.g. rotation or a
+// popup), so decisions are cached by a hash of the planner input.
+class IntelHWComposerPlanner : public IntelHWComposerDump {
+public:
+    enum {
+        PLANNER_MAX_LAYERS = 32,
+        PLANNER_CACHE_SIZE = 8,
+        PLANNER_MAX_NODES = 4096,
+    };
+
+    // planes a layer can be put on, PLANE_FRAMEBUFFER is always possible
+    enum {
+        PLANE_FRAMEBUFFER = 0,
+        PLANE_OVERLAY = 1 << 0,
+        PLANE_SPRITE = 1 << 1,
+    };
+
+    // layer flags
+    enum {
+        LAYER_FORCED = 1 << 0,
+        LAYER_BLENDING = 1 << 1,
+        LAYER_YUV = 1 << 2,
+    };
+
+private:
+    struct Layer {
+        hwc_rect_t frame;
+        uint32_t candidates;
+        uint32_t flags;
+    };
+
+    struct Decision {
+        uint64_t hash;
+        uint32_t age;
+        int64_t cost;
+        int64_t greedyCost;
+        int planes[PLANNER_MAX_LAYERS];
+        uint32_t clearup;
+    };
+
+    // planner input
+    Layer mLayers[PLANNER_MAX_LAYERS];
+    int mNumLayers;
+    int mTotalLayers;
+    int mFreeOverlays;
+    int mFreeSprites;
+
+    // bit masks of the overlapping layers, of the blended layers over a
+    // layer, and the planes a layer can use under the z order constraint
+    uint32_t mOverlaps[PLANNER_MAX_LAYERS];
+    uint32_t mCovering[PLANNER_MAX_LAYERS];
+    uint32_t mFeasible[PLANNER_MAX_LAYERS];
+
+    // search state
+    int mCurrent[PLANNER_MAX_LAYERS];
+    int mBest[PLANNER_MAX_LAYERS];
+    int64_t mBestCost;
+    int64_t mMinCost[PLANNER_MAX_LAYERS + 1];
+    bool mNeedFramebuffer[PLANNER_MAX_LAYERS + 1];
+    int mNodes;
+
+    // result
+    int mPlanes[PLANNER_MAX_LAYERS];
+    uint32_t mClearup;
+
+    Decision mCache[PLANNER_CACHE_SIZE];
+    uint32_t mAge;
+
+    // statistics
+    uint32_t mCacheHits;
+    uint32_t mCacheMisses;
+    int mLastNodes;
+    int64_t mLastCost;
+    int64_t mLastGreedyCost;
+private:
+    uint64_t hashInput() const;
+    void buildOverlaps();
+    int64_t planeCost(int index) const;
+    int64_t framebufferCost(int index) const;
+    int64_t greedy();
+    void search(int index, int overlays, int sprites,
+                int64_t cost, bool useFramebuffer);
+    Decision* lookup(uint64_t hash);
+    void store(uint64_t hash);
+public:
+    IntelHWComposerPlanner();
+    ~IntelHWComposerPlanner();
+
+    // start a new geometry with the number of planes which can be used
+    void reset(int freeOverlays, int freeSprites);
+    // add layers bottom up. A list of more than PLANNER_MAX_LAYERS layers
+    // goes to FB as a whole
+    void addLayer(const hwc_rect_t& frame, uint32_t candidates,
+                  uint32_t flags);
+    // return true if the decision came from the cache
+    bool plan();
+
+    int getPlane(int index) const;
+    bool getNeedClearup(int index) const;
+    int getLayersCount() const { return mTotalLayers; }
+    uint32_t getCacheHits() const { return mCacheHits; }
+    uint32_t getCacheMisses() const { return mCacheMisses; }
+    int getLastNodes() const { return mLastNodes; }
+    int64_t getLastCost() const { return mLastCost; }
+    int64_t getLastGreedyCost() const { return mLastGreedyCost; }
+
+    bool dump(char *buff, int buff_len, int *cur_len);
+};
+
+#endif /*__INTEL_HWCOMPOSER_PLANNER_H__*/
@@ -1350,10 +1350,6 @@ IntelOverlayPlane::IntelOverlayPlane(int fd, int index, IntelBufferManager *bm)
         goto overlay_init_err;
     }
 
-    // clear up overlay buffers
-    memset(mDataBuffers, 0, sizeof(mDataBuffers));
-    mNextBuffer = 0;
-
     // initialized successfully
     mDataBuffer = dataBuffer;
     mContext = overlayContext;
@@ -1386,6 +1382,8 @@ IntelOverlayPlane::~IntelOverlayPlane()
         // destroy overlay data buffer;
         delete mDataBuffer;
 
+        releaseBuffers();
+
         mContext = 0;
         mInitialized = false;
     }
@@ -1417,6 +1415,11 @@ bool IntelOverlayPlane::setDataBuffer(uint32_t handle, uint32_t flags,
         return false;
     }
 
+    if (!mBufferCache) {
+        LOGE("%s: no buffer cache\n", __func__);
+        return false;
+    }
+
     ui64Stamp = nHandle->ui64Stamp;
 
     // verify if HW overlay capable for this data buffer
@@ -1475,75 +1478,18 @@ bool IntelOverlayPlane::setDataBuffer(uint32_t handle, uint32_t flags,
     // update data buffer's yuv strides and continue
     overlayDataBuffer->setStride(yStride, uvStride);
 
-    int grallocBuffFd = nHandle->format == HAL_PIXEL_FORMAT_INTEL_HWC_NV12 ?
-        nHandle->fd[GRALLOC_SUB_BUFFER1] : 0;
-
     if (flags)
         bufferType = IntelBufferManager::TTM_BUFFER;
     else
         bufferType = IntelBufferManager::GRALLOC_BUFFER;
 
-    for (int i = 0; i < OVERLAY_DATA_BUFFER_NUM_MAX; i++) {
-        if (mDataBuffers[i].ui64Stamp == ui64Stamp &&
-            mDataBuffers[i].handle == handle &&
-            mDataBuffers[i].bufferType == bufferType) {
-            buffer = mDataBuffers[i].buffer;
-            mNextBuffer = (i + 1) % OVERLAY_DATA_BUFFER_NUM_MAX;
-            break;
-        }
-    }
-
-    LOGD_IF(ALLOW_OVERLAY_PRINT, "%s: next buffer %d\n", __func__, mNextBuffer);
-
-    /** Map the handle if no buffer found **/
-    int tryMapTimes = 0;
-    while (buffer == NULL) {
-        int index = tryMapTimes == 0 ? mNextBuffer : 0;
-
-        if (mDataBuffers[index].buffer ||
-            mDataBuffers[index].handle ||
-            mDataBuffers[index].ui64Stamp)
-        {
-            LOGD_IF(ALLOW_OVERLAY_PRINT,
-                    "%s: releasing buffer %d...\n", __func__, mNextBuffer);
-            if (mDataBuffers[index].bufferType ==
-                IntelBufferManager::TTM_BUFFER)
-                mBufferManager->unwrap(mDataBuffers[index].buffer);
-            else
-                mBufferManager->unmap(mDataBuffers[index].buffer);
-
-            memset(&mDataBuffers[index], 0, sizeof(mDataBuffers[index]));
-        }
-
-        if (bufferType == IntelBufferManager::TTM_BUFFER)
-            buffer = mBufferManager->wrap((void *)handle, 0);
-        else
-            buffer = mBufferManager->map(handle);
-
-        mNextBuffer = index;
-        if (++tryMapTimes > 1) {
-            LOGW("%s: Avail memory is low...", __func__);
-            break;
-        }
-    }
-
+    buffer = mBufferCache->acquire(handle, ui64Stamp, bufferType, mType);
     if (buffer == NULL) {
         LOGE("%s: failed to map handle %x\n", __func__, handle);
         return false;
     }
 
-    if (tryMapTimes > 0) {
-        LOGD_IF(ALLOW_OVERLAY_PRINT,
-               "%s: mapping buffer at %d...\n", __func__, mNextBuffer);
-        mDataBuffers[mNextBuffer].ui64Stamp = ui64Stamp;
-        mDataBuffers[mNextBuffer].handle = handle;
-        mDataBuffers[mNextBuffer].buffer = buffer;
-        mDataBuffers[mNextBuffer].bufferType = bufferType;
-        mDataBuffers[mNextBuffer].grallocBuffFd = grallocBuffFd;
-
-        // move mNextBuffer pointer
-        mNextBuffer = (mNextBuffer + 1) % OVERLAY_DATA_BUFFER_NUM_MAX;
-    }
+    holdBuffer(buffer);
 
     overlayDataBuffer->setBuffer(buffer);
 
@@ -1578,17 +1524,15 @@ bool IntelOverlayPlane::invalidateDataBuffer()
     if (!initCheck())
         return false;
 
-    for (int i = 0; i < OVERLAY_DATA_BUFFER_NUM_MAX; i++) {
-        if (mDataBuffers[i].bufferType == IntelBufferManager::TTM_BUFFER)
-            mBufferManager->unwrap(mDataBuffers[i].buffer);
-        else
-            mBufferManager->unmap(mDataBuffers[i].buffer);
-    }
+    // BZ 33017. Don't hold too many buffers in GTT for avoiding reaching
+    // GTT max size(128M), drop the video mappings nobody shows once video
+    // stops. Mappings the sprite planes acquired are left to them.
+    releaseBuffers();
+    if (mBufferCache)
+        mBufferCache->invalidate(mType);
 
     // clear data buffers
-    memset(mDataBuffers, 0, sizeof(mDataBuffers));
     memset(mDataBuffer, 0, sizeof(*mDataBuffer));
-    mNextBuffer = 0;
     return true;
 }
 
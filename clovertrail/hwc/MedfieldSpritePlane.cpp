@@ -31,13 +31,12 @@
 MedfieldSpritePlane::MedfieldSpritePlane(int fd, int index, IntelBufferManager *bm)
     : IntelSpritePlane(fd, index, bm)
 {
-    memset(mDataBuffers, 0, sizeof(mDataBuffers));
-    mNextBuffer = 0;
+
 }
 
 MedfieldSpritePlane::~MedfieldSpritePlane()
 {
-
+    releaseBuffers();
 }
 
 bool MedfieldSpritePlane::checkPosition(int& left, int& top,
@@ -176,49 +175,28 @@ bool MedfieldSpritePlane::setDataBuffer(uint32_t handle, uint32_t flags, intel_g
 {
     unsigned long long ui64Stamp = nHandle->ui64Stamp;
     IntelDisplayBuffer *buffer = 0;
-    int i;
 
     if (!initCheck()) {
         LOGE("%s: overlay plane wasn't initialized\n", __func__);
         return false;
     }
 
-    LOGD_IF(ALLOW_SPRITE_PRINT, "%s: next buffer %d\n", __func__, mNextBuffer);
-
-    // Notice!!! Maybe handle can be reused, it will cause problem.
-    for (i = 0; i < SPRITE_DATA_BUFFER_NUM_MAX; i++) {
-        if (mDataBuffers[i].ui64Stamp == ui64Stamp) {
-            buffer = mDataBuffers[i].buffer;
-            break;
-        }
+    if (!mBufferCache) {
+        LOGE("%s: no buffer cache\n", __func__);
+        return false;
     }
 
+    // a reused handle comes with a new stamp, the cache drops the old mapping
+    buffer = mBufferCache->acquire(handle, ui64Stamp,
+                                   IntelBufferManager::GRALLOC_BUFFER, mType);
     if (!buffer) {
-            // release the buffer in the next slot
-            if (mDataBuffers[mNextBuffer].ui64Stamp ||
-                            mDataBuffers[mNextBuffer].buffer) {
-                    LOGD_IF(ALLOW_SPRITE_PRINT,
-                            "%s: releasing buffer %d...\n", __func__, mNextBuffer);
-                    mBufferManager->unmap(mDataBuffers[mNextBuffer].buffer);
-                    mDataBuffers[mNextBuffer].ui64Stamp = 0;
-                    mDataBuffers[mNextBuffer].handle = 0;
-                    mDataBuffers[mNextBuffer].buffer = 0;
-            }
-
-            buffer = mBufferManager->map(handle);
-            if (!buffer) {
-                    LOGE("%s: failed to map handle %d\n", __func__, handle);
-                    disable();
-                    return false;
-            }
-
-            mDataBuffers[mNextBuffer].ui64Stamp = ui64Stamp;
-            mDataBuffers[mNextBuffer].handle = handle;
-            mDataBuffers[mNextBuffer].buffer = buffer;
-            // move mNextBuffer pointer
-            mNextBuffer = (mNextBuffer + 1) % SPRITE_DATA_BUFFER_NUM_MAX;
+        LOGE("%s: failed to map handle %d\n", __func__, handle);
+        disable();
+        return false;
     }
 
+    holdBuffer(buffer);
+
     IntelDisplayDataBuffer *spriteDataBuffer =
         reinterpret_cast<IntelDisplayDataBuffer*>(mDataBuffer);
     spriteDataBuffer->setBuffer(buffer);
@@ -296,7 +274,7 @@ bool MedfieldSpritePlane::invalidateDataBuffer()
 {
     LOGD_IF(ALLOW_SPRITE_PRINT, "%s\n", __func__);
 
-    // keep the mapping of sprite data buffers till HWC was unload
+    // keep the mapping of sprite data buffers in the buffer cache,
     // if we unmap them dynamically, post2 may be failed.
     // TODO: improve gralloc buffer manager, to get buffer info from
     // gralloc HAL directly.
@@ -16,3 +16,24 @@ LOCAL_MODULE:= hwc-overlay
 LOCAL_MODULE_TAGS := eng
 
 include $(BUILD_EXECUTABLE)
+
+# host benchmark of the layer planner, replays the planner section of
+# "dumpsys SurfaceFlinger" output
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	planner_bench.cpp \
+	../IntelHWComposerPlanner.cpp \
+	../IntelHWComposerDump.cpp
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/..
+
+LOCAL_STATIC_LIBRARIES := \
+	libcutils \
+	liblog
+
+LOCAL_MODULE:= hwc_planner_bench
+
+LOCAL_MODULE_TAGS := eng
+
+include $(BUILD_HOST_EXECUTABLE)
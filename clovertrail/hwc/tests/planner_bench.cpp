@@ -0,0 +1,483 @@
+/*
+ * Copyright © 2012 Intel Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+// Host benchmark of the layer planner. Replays the layer lists recorded in
+// HWC dumps ("dumpsys SurfaceFlinger" output, the "Layer Planner" section
+// written by IntelHWComposerPlanner::dump) through:
+//  - greedy: the assignment IntelHWComposer did before the planner, bottom
+//    up, with pairwise intersection tests;
+//  - planner: a planner with an empty decision cache for each list;
+//  - cached: one planner for the whole replay, as in the HWC.
+// and reports the time per geometry change, the layers put on planes and
+// the pixels left to GL composition.
+//
+// Without dump files, geometries of a 1024x600 tablet are generated: a
+// wallpaper, applications, status & navigation bars, popups and videos,
+// going back to a few layouts as a user switching between applications.
+//
+// usage: hwc_planner_bench [-n loops] [-o overlays] [-s sprites] [dump...]
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <IntelHWComposerPlanner.h>
+#include <IntelHWComposerCfg.h>
+
+hwc_cfg cfg;
+
+typedef IntelHWComposerPlanner Planner;
+
+enum {
+    BENCH_MAX_GEOMETRIES = 4096,
+    BENCH_SCREEN_WIDTH = 1024,
+    BENCH_SCREEN_HEIGHT = 600,
+    BENCH_LAYOUTS = 12,
+};
+
+struct BenchLayer {
+    hwc_rect_t frame;
+    uint32_t candidates;
+    uint32_t flags;
+};
+
+struct Geometry {
+    int overlays;
+    int sprites;
+    int count;
+    BenchLayer layers[Planner::PLANNER_MAX_LAYERS];
+};
+
+struct Result {
+    const char *name;
+    int64_t ns;
+    int64_t offloaded;
+    int64_t glPixels;
+};
+
+static Geometry *geometries;
+static int numGeometries;
+
+static int64_t now_ns()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: hwc_planner_bench [-n loops] [-o overlays] [-s sprites] [dump...]\n"
+            "  -n  replays of the geometry sequence (default 100)\n"
+            "  -o  overlay planes of generated geometries (default 2)\n"
+            "  -s  sprite planes of generated geometries (default 0)\n");
+    exit(1);
+}
+
+// ------------------------------------------------------------------------
+// dump parsing
+
+static int parseDump(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[512];
+    Geometry *g = 0;
+    int parsed = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        int overlays, sprites, layers;
+        int index;
+        BenchLayer l;
+
+        if (sscanf(line, " free overlays: %d, free sprites: %d, layers: %d",
+                   &overlays, &sprites, &layers) == 3) {
+            if (numGeometries >= BENCH_MAX_GEOMETRIES)
+                break;
+            g = &geometries[numGeometries];
+            g->overlays = overlays;
+            g->sprites = sprites;
+            g->count = 0;
+            continue;
+        }
+
+        if (g && sscanf(line,
+                        " layer %d: frame [%d, %d, %d, %d], candidates 0x%x, flags 0x%x",
+                        &index, &l.frame.left, &l.frame.top,
+                        &l.frame.right, &l.frame.bottom,
+                        &l.candidates, &l.flags) == 7) {
+            if (g->count < Planner::PLANNER_MAX_LAYERS)
+                g->layers[g->count++] = l;
+            continue;
+        }
+
+        if (g && strstr(line, "End of Layer Planner")) {
+            if (g->count) {
+                numGeometries++;
+                parsed++;
+            }
+            g = 0;
+        }
+    }
+
+    fclose(f);
+    return parsed;
+}
+
+// ------------------------------------------------------------------------
+// generated geometries
+
+static void addLayer(Geometry *g, int l, int t, int r, int b,
+                     uint32_t candidates, uint32_t flags)
+{
+    BenchLayer *layer;
+
+    if (g->count >= Planner::PLANNER_MAX_LAYERS)
+        return;
+
+    layer = &g->layers[g->count++];
+    layer->frame.left = l;
+    layer->frame.top = t;
+    layer->frame.right = r;
+    layer->frame.bottom = b;
+    layer->candidates = candidates;
+    layer->flags = flags;
+}
+
+// candidates as IntelHWComposer finds them: YUV layers without blending
+// can use overlays, RGB layers without scaling or transform sprites
+static void addRGB(Geometry *g, int l, int t, int r, int b, bool blending)
+{
+    addLayer(g, l, t, r, b, Planner::PLANE_SPRITE,
+             blending ? Planner::LAYER_BLENDING : 0);
+}
+
+static void addVideo(Geometry *g, int l, int t, int r, int b, bool forced)
+{
+    addLayer(g, l, t, r, b, Planner::PLANE_OVERLAY,
+             Planner::LAYER_YUV | (forced ? Planner::LAYER_FORCED : 0));
+}
+
+static void generateLayout(Geometry *g, int overlays, int sprites)
+{
+    int w = BENCH_SCREEN_WIDTH;
+    int h = BENCH_SCREEN_HEIGHT;
+    int kind = rand() % 6;
+
+    g->overlays = overlays;
+    g->sprites = sprites;
+    g->count = 0;
+
+    // video layers are under the window of their application, which is
+    // transparent over them
+    switch (kind) {
+    case 0:
+        // home screen
+        addRGB(g, 0, 0, w, h, false);
+        addRGB(g, 0, 25, w, h - 48, true);
+        break;
+    case 1:
+        // full screen video with the controls over it
+        addVideo(g, 0, 0, w, h, rand() % 4 == 0);
+        addRGB(g, 0, h - 80, w, h - 48, true);
+        break;
+    case 2:
+        // video in an application window
+        addVideo(g, 100, 80, 100 + 640, 80 + 360, false);
+        addRGB(g, 0, 25, w, h - 48, true);
+        break;
+    case 3:
+        // gallery of video thumbnails, more than there are overlays
+        for (int i = 0; i < 6; i++) {
+            int tw = 160 + 60 * ((i * 2) % 3);
+            int th = tw * 9 / 16;
+            int x = 16 + (i % 3) * 330;
+            int y = 40 + (i / 3) * 260;
+            addVideo(g, x, y, x + tw, y + th, false);
+        }
+        addRGB(g, 0, 25, w, h - 48, true);
+        break;
+    case 4:
+        // application with a popup and a toast
+        addRGB(g, 0, 0, w, h, false);
+        addRGB(g, 0, 25, w, h - 48, false);
+        addRGB(g, 200, 150, 824, 450, true);
+        addRGB(g, 400, 480, 624, 520, true);
+        break;
+    default:
+        // two videos side by side, sometimes a dialog over one
+        addVideo(g, 0, 100, 500, 381, false);
+        addVideo(g, 524, 100, 1024, 381, false);
+        addRGB(g, 0, 25, w, h - 48, true);
+        if (rand() % 2)
+            addRGB(g, 600, 200, 900, 300, true);
+        break;
+    }
+
+    // status & navigation bars on top
+    addRGB(g, 0, 0, w, 25, true);
+    addRGB(g, 0, h - 48, w, h, true);
+}
+
+static void generate(int overlays, int sprites)
+{
+    Geometry layouts[BENCH_LAYOUTS];
+
+    srand(1);
+    for (int i = 0; i < BENCH_LAYOUTS; i++)
+        generateLayout(&layouts[i], overlays, sprites);
+
+    // mostly going back to a recent layout, sometimes a new one
+    for (numGeometries = 0; numGeometries < 512; numGeometries++) {
+        if (rand() % 8 == 0)
+            generateLayout(&layouts[rand() % BENCH_LAYOUTS], overlays, sprites);
+        geometries[numGeometries] = layouts[rand() % BENCH_LAYOUTS];
+    }
+}
+
+// ------------------------------------------------------------------------
+// assignments
+
+static bool isIntersecting(const hwc_rect_t& a, const hwc_rect_t& b)
+{
+    if (b.right <= a.left ||
+        b.left >= a.right ||
+        b.top >= a.bottom ||
+        b.bottom <= a.top)
+        return false;
+
+    return true;
+}
+
+// IntelHWComposer::onGeometryChanged before the planner
+static void greedy(const Geometry *g, int *planes, uint32_t *clearup)
+{
+    int overlays = g->overlays;
+    int sprites = g->sprites;
+
+    *clearup = 0;
+    for (int i = 0; i < g->count; i++) {
+        const BenchLayer& layer = g->layers[i];
+        bool useOverlay = false;
+
+        planes[i] = Planner::PLANE_FRAMEBUFFER;
+
+        if (overlays && (layer.candidates & Planner::PLANE_OVERLAY)) {
+            useOverlay = true;
+            if (!(layer.flags & Planner::LAYER_FORCED)) {
+                for (int j = i - 1; j >= 0; j--) {
+                    if (isIntersecting(layer.frame, g->layers[j].frame)) {
+                        useOverlay = false;
+                        break;
+                    }
+                }
+            }
+
+            for (int j = i + 1; useOverlay && j < g->count; j++) {
+                if (isIntersecting(g->layers[j].frame, layer.frame) &&
+                    (g->layers[j].flags & Planner::LAYER_BLENDING))
+                    *clearup |= (1 << i);
+            }
+        }
+
+        if (useOverlay) {
+            planes[i] = Planner::PLANE_OVERLAY;
+            overlays--;
+        } else if (sprites && (layer.candidates & Planner::PLANE_SPRITE)) {
+            planes[i] = Planner::PLANE_SPRITE;
+            sprites--;
+        }
+    }
+}
+
+static void runPlanner(Planner *planner, const Geometry *g,
+                       int *planes, uint32_t *clearup)
+{
+    planner->reset(g->overlays, g->sprites);
+    for (int i = 0; i < g->count; i++)
+        planner->addLayer(g->layers[i].frame, g->layers[i].candidates,
+                          g->layers[i].flags);
+    planner->plan();
+
+    *clearup = 0;
+    for (int i = 0; i < g->count; i++) {
+        planes[i] = planner->getPlane(i);
+        if (planner->getNeedClearup(i))
+            *clearup |= (1 << i);
+    }
+}
+
+// pixels GL composes: frame buffer layers, twice for blending and for
+// YUV sampling, and clears of FB under planes
+static void account(Result *r, const Geometry *g, const int *planes,
+                    uint32_t clearup)
+{
+    for (int i = 0; i < g->count; i++) {
+        const hwc_rect_t& f = g->layers[i].frame;
+        uint32_t flags = g->layers[i].flags;
+        int64_t area = (int64_t)(f.right - f.left) * (f.bottom - f.top);
+
+        if (planes[i] != Planner::PLANE_FRAMEBUFFER) {
+            r->offloaded++;
+            if (clearup & (1 << i))
+                r->glPixels += area;
+            continue;
+        }
+
+        if (flags & Planner::LAYER_BLENDING)
+            area *= 2;
+        if (flags & Planner::LAYER_YUV)
+            area *= 2;
+        r->glPixels += area;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 100;
+    int overlays = 2;
+    int sprites = 0;
+    int opt;
+    Result results[3] = {
+        { "greedy", 0, 0, 0 },
+        { "planner", 0, 0, 0 },
+        { "cached", 0, 0, 0 },
+    };
+    int planes[Planner::PLANNER_MAX_LAYERS];
+    uint32_t clearup;
+    volatile int sink = 0;
+    int mismatches = 0;
+
+    while ((opt = getopt(argc, argv, "n:o:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            loops = atoi(optarg);
+            break;
+        case 'o':
+            overlays = atoi(optarg);
+            break;
+        case 's':
+            sprites = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (loops <= 0)
+        usage();
+
+    geometries = new Geometry[BENCH_MAX_GEOMETRIES];
+
+    for (int i = optind; i < argc; i++) {
+        int n = parseDump(argv[i]);
+        if (n < 0)
+            return 1;
+        printf("%s: %d layer lists\n", argv[i], n);
+    }
+
+    if (optind >= argc)
+        generate(overlays, sprites);
+
+    if (!numGeometries) {
+        fprintf(stderr, "no layer list found\n");
+        return 1;
+    }
+
+    // plans: one pass, the same for every loop
+    Planner *cached = new Planner();
+    for (int i = 0; i < numGeometries; i++) {
+        const Geometry *g = &geometries[i];
+        int cachedPlanes[Planner::PLANNER_MAX_LAYERS];
+        uint32_t cachedClearup;
+        Planner cold;
+
+        greedy(g, planes, &clearup);
+        account(&results[0], g, planes, clearup);
+
+        runPlanner(&cold, g, planes, &clearup);
+        account(&results[1], g, planes, clearup);
+
+        runPlanner(cached, g, cachedPlanes, &cachedClearup);
+        account(&results[2], g, cachedPlanes, cachedClearup);
+
+        if (memcmp(planes, cachedPlanes, g->count * sizeof(int)) ||
+            clearup != cachedClearup)
+            mismatches++;
+    }
+
+    // timing
+    int64_t start = now_ns();
+    for (int n = 0; n < loops; n++) {
+        for (int i = 0; i < numGeometries; i++) {
+            greedy(&geometries[i], planes, &clearup);
+            sink += planes[0];
+        }
+    }
+    results[0].ns = now_ns() - start;
+
+    start = now_ns();
+    for (int n = 0; n < loops; n++) {
+        for (int i = 0; i < numGeometries; i++) {
+            Planner cold;
+            runPlanner(&cold, &geometries[i], planes, &clearup);
+            sink += planes[0];
+        }
+    }
+    results[1].ns = now_ns() - start;
+
+    start = now_ns();
+    for (int n = 0; n < loops; n++) {
+        for (int i = 0; i < numGeometries; i++) {
+            runPlanner(cached, &geometries[i], planes, &clearup);
+            sink += planes[0];
+        }
+    }
+    results[2].ns = now_ns() - start;
+
+    printf("%d layer lists, %d loops\n", numGeometries, loops);
+    printf("%-10s %14s %12s %16s\n",
+           "", "ns/geometry", "offloaded", "GL Mpixels");
+    for (int i = 0; i < 3; i++) {
+        printf("%-10s %14.0f %12lld %16.2f\n", results[i].name,
+               (double)results[i].ns / loops / numGeometries,
+               (long long)results[i].offloaded,
+               results[i].glPixels / 1e6);
+    }
+    printf("cache: %u hits, %u misses, %d mismatches with uncached plans\n",
+           cached->getCacheHits(), cached->getCacheMisses(), mismatches);
+
+    delete cached;
+    delete [] geometries;
+    return 0;
+}
@@ -22,12 +22,191 @@
  *
  */
 
+/*
+ * The heap is managed as a two-level segregated fit (TLSF) allocator.
+ * Blocks stay on an address-ordered ring (next/prev) so that neighbours
+ * can be coalesced in constant time, while free blocks are additionally
+ * threaded onto one of FL_COUNT * SL_COUNT size-class lists
+ * (next_free/prev_free).  Two levels of bitmaps record which lists are
+ * non-empty, so finding a block that is large enough for a request is a
+ * couple of find-first-set operations instead of a walk of the free list.
+ *
+ * Sizes below SMALL_BLOCK each get an exact list in first level 0.
+ * Larger sizes are split by their most significant bit (first level) and
+ * the next SL_LOG2 bits (second level).
+ */
+
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "xf86drm.h"
 #include "mm.h"
 
+#define SL_LOG2		4
+#define SL_COUNT	(1 << SL_LOG2)
+#define SMALL_BLOCK	(1 << SL_LOG2)
+#define FL_COUNT	(31 - SL_LOG2 + 1)
+
+struct mem_heap {
+   struct mem_block head;	/* must be first, see to_heap() */
+
+   unsigned int fl_bitmap;
+   unsigned int sl_bitmap[FL_COUNT];
+   struct mem_block *free_lists[FL_COUNT][SL_COUNT];
+
+   /* Recycled block descriptors, linked through ->next. */
+   struct mem_block *spare;
+};
+
+static struct mem_heap *
+to_heap(struct mem_block *head)
+{
+   return (struct mem_heap *)head;
+}
+
+/* Index of the most significant set bit, x != 0. */
+static int
+fls_u32(unsigned int x)
+{
+#if defined(__GNUC__)
+   return 31 - __builtin_clz(x);
+#else
+   int r = 0;
+
+   while (x >>= 1)
+      r++;
+   return r;
+#endif
+}
+
+/* Index of the least significant set bit, x != 0. */
+static int
+ffs_u32(unsigned int x)
+{
+#if defined(__GNUC__)
+   return __builtin_ctz(x);
+#else
+   int r = 0;
+
+   while (!(x & 1)) {
+      x >>= 1;
+      r++;
+   }
+   return r;
+#endif
+}
+
+static void
+mapping_insert(unsigned int size, int *fl, int *sl)
+{
+   if (size < SMALL_BLOCK) {
+      *fl = 0;
+      *sl = size;
+   } else {
+      int f = fls_u32(size);
+
+      *sl = (size >> (f - SL_LOG2)) ^ SL_COUNT;
+      *fl = f - SL_LOG2 + 1;
+   }
+}
+
+/* Round the request up so that every block on the resulting list fits. */
+static void
+mapping_search(unsigned int size, int *fl, int *sl)
+{
+   if (size >= SMALL_BLOCK)
+      size += (1U << (fls_u32(size) - SL_LOG2)) - 1;
+
+   mapping_insert(size, fl, sl);
+}
+
+static struct mem_block *
+find_suitable(struct mem_heap *heap, int fl, int sl)
+{
+   unsigned int sl_map, fl_map;
+
+   if (fl >= FL_COUNT)
+      return NULL;
+
+   sl_map = heap->sl_bitmap[fl] & (~0U << sl);
+   if (!sl_map) {
+      if (fl + 1 >= FL_COUNT)
+	 return NULL;
+      fl_map = heap->fl_bitmap & (~0U << (fl + 1));
+      if (!fl_map)
+	 return NULL;
+      fl = ffs_u32(fl_map);
+      sl_map = heap->sl_bitmap[fl];
+   }
+
+   return heap->free_lists[fl][ffs_u32(sl_map)];
+}
+
+static void
+insert_free(struct mem_heap *heap, struct mem_block *b)
+{
+   int fl, sl;
+
+   mapping_insert(b->size, &fl, &sl);
+
+   b->free = 1;
+   b->prev_free = NULL;
+   b->next_free = heap->free_lists[fl][sl];
+   if (b->next_free)
+      b->next_free->prev_free = b;
+   heap->free_lists[fl][sl] = b;
+
+   heap->fl_bitmap |= 1U << fl;
+   heap->sl_bitmap[fl] |= 1U << sl;
+}
+
+static void
+remove_free(struct mem_heap *heap, struct mem_block *b)
+{
+   int fl, sl;
+
+   mapping_insert(b->size, &fl, &sl);
+
+   if (b->next_free)
+      b->next_free->prev_free = b->prev_free;
+   if (b->prev_free)
+      b->prev_free->next_free = b->next_free;
+   else
+      heap->free_lists[fl][sl] = b->next_free;
+
+   if (!heap->free_lists[fl][sl]) {
+      heap->sl_bitmap[fl] &= ~(1U << sl);
+      if (!heap->sl_bitmap[fl])
+	 heap->fl_bitmap &= ~(1U << fl);
+   }
+
+   b->free = 0;
+   b->next_free = NULL;
+   b->prev_free = NULL;
+}
+
+static struct mem_block *
+get_block(struct mem_heap *heap)
+{
+   struct mem_block *b = heap->spare;
+
+   if (b) {
+      heap->spare = b->next;
+      memset(b, 0, sizeof(*b));
+      return b;
+   }
+
+   return (struct mem_block *) calloc(1, sizeof(struct mem_block));
+}
+
+static void
+put_block(struct mem_heap *heap, struct mem_block *b)
+{
+   b->next = heap->spare;
+   heap->spare = b;
+}
+
 void
 mmDumpMemInfo(const struct mem_block *heap)
 {
@@ -35,7 +214,9 @@ mmDumpMemInfo(const struct mem_block *heap)
    if (heap == 0) {
       drmMsg("  heap == 0\n");
    } else {
+      const struct mem_heap *h = (const struct mem_heap *)heap;
       const struct mem_block *p;
+      int fl, sl;
 
       for(p = heap->next; p != heap; p = p->next) {
 	 drmMsg("  Offset:%08x, Size:%08x, %c%c\n",p->ofs,p->size,
@@ -45,10 +226,14 @@ mmDumpMemInfo(const struct mem_block *heap)
 
       drmMsg("\nFree list:\n");
 
-      for(p = heap->next_free; p != heap; p = p->next_free) {
-	 drmMsg(" FREE Offset:%08x, Size:%08x, %c%c\n",p->ofs,p->size,
-		p->free ? 'F':'.',
-		p->reserved ? 'R':'.');
+      for (fl = 0; fl < FL_COUNT; fl++) {
+	 for (sl = 0; sl < SL_COUNT; sl++) {
+	    for (p = h->free_lists[fl][sl]; p; p = p->next_free) {
+	       drmMsg(" FREE Offset:%08x, Size:%08x, %c%c\n",p->ofs,p->size,
+		      p->free ? 'F':'.',
+		      p->reserved ? 'R':'.');
+	    }
+	 }
       }
 
    }
@@ -58,12 +243,13 @@ mmDumpMemInfo(const struct mem_block *heap)
 struct mem_block *
 mmInit(int ofs, int size)
 {
-   struct mem_block *heap, *block;
+   struct mem_heap *heap;
+   struct mem_block *block;
   
    if (size <= 0) 
       return NULL;
 
-   heap = (struct mem_block *) calloc(1, sizeof(struct mem_block));
+   heap = (struct mem_heap *) calloc(1, sizeof(struct mem_heap));
    if (!heap) 
       return NULL;
    
@@ -73,125 +259,153 @@ mmInit(int ofs, int size)
       return NULL;
    }
 
-   heap->next = block;
-   heap->prev = block;
-   heap->next_free = block;
-   heap->prev_free = block;
+   heap->head.next = block;
+   heap->head.prev = block;
 
-   block->heap = heap;
-   block->next = heap;
-   block->prev = heap;
-   block->next_free = heap;
-   block->prev_free = heap;
+   block->heap = &heap->head;
+   block->next = &heap->head;
+   block->prev = &heap->head;
 
    block->ofs = ofs;
    block->size = size;
-   block->free = 1;
+   insert_free(heap, block);
 
-   return heap;
+   return &heap->head;
 }
 
 
+/**
+ * Carve [startofs, startofs + size) out of the free block p, returning the
+ * leftovers on either side to the free lists.
+ */
 static struct mem_block *
 SliceBlock(struct mem_block *p, 
            int startofs, int size, 
            int reserved, int alignment)
 {
+   struct mem_heap *heap = to_heap(p->heap);
    struct mem_block *newblock;
 
+   remove_free(heap, p);
+
    /* break left  [p, newblock, p->next], then p = newblock */
    if (startofs > p->ofs) {
-      newblock = (struct mem_block*) calloc(1, sizeof(struct mem_block));
-      if (!newblock)
+      newblock = get_block(heap);
+      if (!newblock) {
+	 insert_free(heap, p);
 	 return NULL;
+      }
       newblock->ofs = startofs;
       newblock->size = p->size - (startofs - p->ofs);
-      newblock->free = 1;
       newblock->heap = p->heap;
+      newblock->free = 0;
+      newblock->reserved = 0;
 
       newblock->next = p->next;
       newblock->prev = p;
       p->next->prev = newblock;
       p->next = newblock;
 
-      newblock->next_free = p->next_free;
-      newblock->prev_free = p;
-      p->next_free->prev_free = newblock;
-      p->next_free = newblock;
-
       p->size -= newblock->size;
+      insert_free(heap, p);
       p = newblock;
    }
 
    /* break right, also [p, newblock, p->next] */
    if (size < p->size) {
-      newblock = (struct mem_block*) calloc(1, sizeof(struct mem_block));
-      if (!newblock)
-	 return NULL;
-      newblock->ofs = startofs + size;
-      newblock->size = p->size - size;
-      newblock->free = 1;
-      newblock->heap = p->heap;
-
-      newblock->next = p->next;
-      newblock->prev = p;
-      p->next->prev = newblock;
-      p->next = newblock;
-
-      newblock->next_free = p->next_free;
-      newblock->prev_free = p;
-      p->next_free->prev_free = newblock;
-      p->next_free = newblock;
-	 
-      p->size = size;
+      newblock = get_block(heap);
+      if (newblock) {
+	 newblock->ofs = startofs + size;
+	 newblock->size = p->size - size;
+	 newblock->heap = p->heap;
+	 newblock->reserved = 0;
+
+	 newblock->next = p->next;
+	 newblock->prev = p;
+	 p->next->prev = newblock;
+	 p->next = newblock;
+
+	 p->size = size;
+	 insert_free(heap, newblock);
+      }
+      /* Otherwise keep the tail attached to p; it is returned on free. */
    }
 
    /* p = middle block */
    p->free = 0;
+   p->reserved = reserved;
+   return p;
+}
 
-   /* Remove p from the free list: 
-    */
-   p->next_free->prev_free = p->prev_free;
-   p->prev_free->next_free = p->next_free;
 
-   p->next_free = 0;
-   p->prev_free = 0;
+static int
+FitsBlock(const struct mem_block *p, int size, int mask, int startSearch,
+	  int *startofs)
+{
+   int ofs = (p->ofs + mask) & ~mask;
+
+   if (ofs < startSearch)
+      ofs = (startSearch + mask) & ~mask;
+   if (ofs < p->ofs || ofs - p->ofs > p->size - size)
+      return 0;
 
-   p->reserved = reserved;
-   return p;
+   *startofs = ofs;
+   return 1;
 }
 
 
 struct mem_block *
-mmAllocMem(struct mem_block *heap, int size, int align2, int startSearch)
+mmAllocMem(struct mem_block *head, int size, int align2, int startSearch)
 {
-   struct mem_block *p;
-   const int mask = (1 << align2)-1;
+   struct mem_heap *heap;
+   struct mem_block *p = NULL;
+   int mask;
    int startofs = 0;
-   int endofs;
+   int fl, sl;
 
-   if (!heap || align2 < 0 || size <= 0)
+   if (!head || align2 < 0 || align2 > 30 || size <= 0)
       return NULL;
 
-   for (p = heap->next_free; p != heap; p = p->next_free) {
-      assert(p->free);
+   heap = to_heap(head);
+   mask = (1 << align2) - 1;
+
+   /* Fast path: any block on a list at or above size + mask is guaranteed
+    * to hold an aligned range of the requested size.
+    */
+   if (startSearch <= 0 && (unsigned int)size + mask <= 0x7fffffffU) {
+      mapping_search(size + mask, &fl, &sl);
+      p = find_suitable(heap, fl, sl);
+      if (p && !FitsBlock(p, size, mask, 0, &startofs))
+	 p = NULL;
+   }
 
-      startofs = (p->ofs + mask) & ~mask;
-      if ( startofs < startSearch ) {
-	 startofs = startSearch;
+   /* Slow path: the heap is either nearly full or the caller restricted
+    * the range.  Look at every free block that might be large enough so
+    * that we never fail where the old first-fit search would succeed.
+    */
+   if (!p) {
+      mapping_insert(size, &fl, &sl);
+      for (; fl < FL_COUNT && !p; fl++, sl = 0) {
+	 for (; sl < SL_COUNT && !p; sl++) {
+	    struct mem_block *q;
+
+	    if (!(heap->sl_bitmap[fl] & (1U << sl)))
+	       continue;
+	    for (q = heap->free_lists[fl][sl]; q; q = q->next_free) {
+	       if (FitsBlock(q, size, mask, startSearch, &startofs)) {
+		  p = q;
+		  break;
+	       }
+	    }
+	 }
       }
-      endofs = startofs+size;
-      if (endofs <= (p->ofs+p->size))
-	 break;
    }
 
-   if (p == heap) 
+   if (!p)
       return NULL;
 
    assert(p->free);
-   p = SliceBlock(p,startofs,size,0,mask+1);
-
-   return p;
+   return SliceBlock(p, startofs, size, 0, mask + 1);
 }
 
 
@@ -209,34 +423,28 @@ mmFindBlock(struct mem_block *heap, int start)
 }
 
 
-static int
-Join2Blocks(struct mem_block *p)
+/**
+ * Merge p->next into p.  Both must be free and already off the free lists.
+ */
+static void
+Join2Blocks(struct mem_heap *heap, struct mem_block *p)
 {
-   /* XXX there should be some assertions here */
+   struct mem_block *q = p->next;
 
-   /* NOTE: heap->free == 0 */
+   assert(p->ofs + p->size == q->ofs);
+   p->size += q->size;
 
-   if (p->free && p->next->free) {
-      struct mem_block *q = p->next;
+   p->next = q->next;
+   q->next->prev = p;
 
-      assert(p->ofs + p->size == q->ofs);
-      p->size += q->size;
-
-      p->next = q->next;
-      q->next->prev = p;
-
-      q->next_free->prev_free = q->prev_free; 
-      q->prev_free->next_free = q->next_free;
-     
-      free(q);
-      return 1;
-   }
-   return 0;
+   put_block(heap, q);
 }
 
 int
 mmFreeMem(struct mem_block *b)
 {
+   struct mem_heap *heap;
+
    if (!b)
       return 0;
 
@@ -249,33 +457,49 @@ mmFreeMem(struct mem_block *b)
       return -1;
    }
 
-   b->free = 1;
-   b->next_free = b->heap->next_free;
-   b->prev_free = b->heap;
-   b->next_free->prev_free = b;
-   b->prev_free->next_free = b;
+   heap = to_heap(b->heap);
+
+   /* NOTE: heap->head.free == 0, so the sentinel never coalesces. */
+   if (b->next->free) {
+      remove_free(heap, b->next);
+      Join2Blocks(heap, b);
+   }
+   if (b->prev->free) {
+      struct mem_block *prev = b->prev;
+
+      remove_free(heap, prev);
+      Join2Blocks(heap, prev);
+      b = prev;
+   }
 
-   Join2Blocks(b);
-   if (b->prev != b->heap)
-      Join2Blocks(b->prev);
+   insert_free(heap, b);
 
    return 0;
 }
 
 
 void
-mmDestroy(struct mem_block *heap)
+mmDestroy(struct mem_block *head)
 {
+   struct mem_heap *heap;
    struct mem_block *p;
 
-   if (!heap)
+   if (!head)
       return;
 
-   for (p = heap->next; p != heap; ) {
+   heap = to_heap(head);
+
+   for (p = head->next; p != head; ) {
       struct mem_block *next = p->next;
       free(p);
       p = next;
    }
 
+   while (heap->spare) {
+      p = heap->spare;
+      heap->spare = p->next;
+      free(p);
+   }
+
    free(heap);
 }
@@ -25,6 +25,12 @@
 /**
  * Memory manager code.  Primarily used by device drivers to manage texture
  * heaps, etc.
+ *
+ * Free blocks are kept on segregated size-class lists.  Release, and an
+ * allocation served from a list whose blocks all fit, take constant time.
+ * When no such list has a block, or startSearch restricts the range, the
+ * allocation falls back to scanning the free blocks that might fit, which
+ * is linear in their number.
  */
 
 
@@ -63,7 +69,8 @@ extern struct mem_block *mmInit(int ofs, int size);
  * to get better page hits if possible
  * input:	size = size of block
  *       	align2 = 2^align2 bytes alignment
- *		startSearch = linear offset from start of heap to begin search
+ *		startSearch = linear offset from start of heap to begin search,
+ *		              0 selects the constant-time good-fit path
  * return: pointer to the allocated block, 0 if error
  */
 extern struct mem_block *mmAllocMem(struct mem_block *heap, int size,
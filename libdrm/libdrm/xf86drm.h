@@ -663,6 +663,11 @@ extern void drmSLDump(void *l);
 extern int  drmSLLookupNeighbors(void *l, unsigned long key,
 				 unsigned long *prev_key, void **prev_value,
 				 unsigned long *next_key, void **next_value);
+extern int  drmSLBulkLoad(void *l, int count, const unsigned long *keys,
+			  void * const *values);
+extern int  drmSLRange(void *l, unsigned long first, unsigned long last,
+		       int (*func)(unsigned long key, void *value, void *data),
+		       void *data);
 
 extern int drmOpenOnce(void *unused, const char *BusID, int *newlyopened);
 extern void drmCloseOnce(int fd);
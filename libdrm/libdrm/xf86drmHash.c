@@ -27,137 +27,211 @@
  *
  * DESCRIPTION
  *
- * This file contains a straightforward implementation of a fixed-sized
- * hash table using self-organizing linked lists [Knuth73, pp. 398-399] for
- * collision resolution.  There are two potentially interesting things
- * about this implementation:
+ * This file contains a resizable open-addressing hash table for
+ * integer -> pointer mapping.  There are three potentially interesting
+ * things about this implementation:
  *
- * 1) The table is power-of-two sized.  Prime sized tables are more
- * traditional, but do not have a significant advantage over power-of-two
- * sized table, especially when double hashing is not used for collision
- * resolution.
+ * 1) Collisions are resolved with linear probing using Robin Hood
+ * insertion [Celis86]: an entry that is further from its home slot than
+ * the resident steals the slot.  This keeps probe sequences short and
+ * lets a lookup stop as soon as it reaches an entry that is closer to
+ * home than the key being searched for.  Deletion uses backward shifting,
+ * so no tombstones accumulate in the index.
  *
- * 2) The hash computation uses a table of random integers [Hanson97,
- * pp. 39-41].
+ * 2) The probe index only stores a hash and a position into a separate,
+ * densely packed array of entries.  The index stays small and cache
+ * friendly, and iteration walks the entry array in insertion order.
+ * Because entries never move while an iteration is in progress, keys
+ * may be inserted or deleted between drmHashFirst and drmHashNext: every
+ * key that is present for the whole iteration is returned exactly once,
+ * and keys inserted during the iteration are returned at the end.
  *
- * FUTURE ENHANCEMENTS
+ * 3) Both arrays grow geometrically (the index is kept at most 7/8
+ * full), so inserting does not allocate except when the table doubles.
+ * Space left by deleted entries is reclaimed when the entry array would
+ * otherwise grow, unless an iteration is in progress.
  *
- * With a table size of 512, the current implementation is sufficient for a
- * few hundred keys.  Since this is well above the expected size of the
- * tables for which this implementation was designed, the implementation of
- * dynamic hash tables was postponed until the need arises.  A common (and
- * naive) approach to dynamic hash table implementation simply creates a
- * new hash table when necessary, rehashes all the data into the new table,
- * and destroys the old table.  The approach in [Larson88] is superior in
- * two ways: 1) only a portion of the table is expanded when needed,
- * distributing the expansion cost over several insertions, and 2) portions
- * of the table can be locked, enabling a scalable thread-safe
- * implementation.
+ * Define HASH_MAIN to 1 to build a standalone test and benchmark that
+ * compares this table with the fixed-size chained table it replaced.
  *
  * REFERENCES
  *
- * [Hanson97] David R. Hanson.  C Interfaces and Implementations:
- * Techniques for Creating Reusable Software.  Reading, Massachusetts:
- * Addison-Wesley, 1997.
+ * [Celis86] Pedro Celis.  Robin Hood Hashing.  Ph.D. thesis, University
+ * of Waterloo, 1986.
  *
  * [Knuth73] Donald E. Knuth. The Art of Computer Programming.  Volume 3:
  * Sorting and Searching.  Reading, Massachusetts: Addison-Wesley, 1973.
  *
- * [Larson88] Per-Ake Larson. "Dynamic Hash Tables".  CACM 31(4), April
- * 1988, pp. 446-457.
- *
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#ifndef HASH_MAIN
 #define HASH_MAIN 0
+#endif
 
 #if !HASH_MAIN
 # include "xf86drm.h"
+#else
+# include <sys/time.h>
 #endif
 
-#define HASH_MAGIC 0xdeadbeef
-#define HASH_DEBUG 0
-#define HASH_SIZE  512		/* Good for about 100 entries */
-				/* If you change this value, you probably
-                                   have to change the HashHash hashing
-                                   function! */
+#define HASH_MAGIC      0xdeadbeef
+#define HASH_DEBUG      0
+#define HASH_MIN_SLOTS  16	/* Must be a power of two */
+#define HASH_MIN_ENTRIES 8
 
 #if HASH_MAIN
-#define HASH_ALLOC malloc
+#define HASH_ALLOC(size) calloc(1, size)
 #define HASH_FREE  free
-#define HASH_RANDOM_DECL
-#define HASH_RANDOM_INIT(seed)  srandom(seed)
-#define HASH_RANDOM             random()
-#define HASH_RANDOM_DESTROY
 #else
 #define HASH_ALLOC drmMalloc
 #define HASH_FREE  drmFree
-#define HASH_RANDOM_DECL        void *state
-#define HASH_RANDOM_INIT(seed)  state = drmRandomCreate(seed)
-#define HASH_RANDOM             drmRandom(state)
-#define HASH_RANDOM_DESTROY     drmRandomDestroy(state)
-
 #endif
 
-typedef struct HashBucket {
+typedef struct HashEntry {
     unsigned long     key;
     void              *value;
-    struct HashBucket *next;
-} HashBucket, *HashBucketPtr;
+    unsigned int      hash;
+    unsigned int      live;	/* Cleared when deleted */
+} HashEntry, *HashEntryPtr;
+
+typedef struct HashSlot {
+    unsigned int      hash;
+    unsigned int      index;	/* 1-based index into entries, 0 if empty */
+} HashSlot, *HashSlotPtr;
 
 typedef struct HashTable {
     unsigned long    magic;
-    unsigned long    entries;
-    unsigned long    hits;	/* At top of linked list */
-    unsigned long    partials;	/* Not at top of linked list */
+    unsigned long    entries;	/* Live entries */
+    unsigned long    hits;	/* Found in home slot */
+    unsigned long    partials;	/* Found after probing */
     unsigned long    misses;	/* Not in table */
-    HashBucketPtr    buckets[HASH_SIZE];
-    int              p0;
-    HashBucketPtr    p1;
+    HashSlotPtr      slots;
+    unsigned int     mask;	/* Number of slots - 1 */
+    HashEntryPtr     entry;
+    unsigned int     used;	/* Entries used, including deleted ones */
+    unsigned int     size;	/* Entries allocated */
+    unsigned int     p0;	/* Position for iteration */
 } HashTable, *HashTablePtr;
 
 #if HASH_MAIN
 extern void *drmHashCreate(void);
 extern int  drmHashDestroy(void *t);
-extern int  drmHashLookup(void *t, unsigned long key, unsigned long *value);
-extern int  drmHashInsert(void *t, unsigned long key, unsigned long value);
+extern int  drmHashLookup(void *t, unsigned long key, void **value);
+extern int  drmHashInsert(void *t, unsigned long key, void *value);
 extern int  drmHashDelete(void *t, unsigned long key);
+extern int  drmHashFirst(void *t, unsigned long *key, void **value);
+extern int  drmHashNext(void *t, unsigned long *key, void **value);
 #endif
 
-static unsigned long HashHash(unsigned long key)
+static unsigned int HashHash(unsigned long key)
 {
-    unsigned long        hash = 0;
-    unsigned long        tmp  = key;
-    static int           init = 0;
-    static unsigned long scatter[256];
-    int                  i;
+    unsigned long long hash = key;
 
-    if (!init) {
-	HASH_RANDOM_DECL;
-	HASH_RANDOM_INIT(37);
-	for (i = 0; i < 256; i++) scatter[i] = HASH_RANDOM;
-	HASH_RANDOM_DESTROY;
-	++init;
+				/* 64-bit finalizer from MurmurHash3 */
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+#if HASH_DEBUG
+    printf( "Hash(%lu) = %u\n", key, (unsigned int)hash);
+#endif
+    return (unsigned int)hash;
+}
+
+static unsigned int HashDistance(HashTablePtr table, unsigned int slot)
+{
+    return (slot - (table->slots[slot].hash & table->mask)) & table->mask;
+}
+
+static void HashPlace(HashTablePtr table, unsigned int hash, unsigned int index)
+{
+    HashSlot     cur;
+    HashSlot     tmp;
+    unsigned int i    = hash & table->mask;
+    unsigned int dist = 0;
+    unsigned int d;
+
+    cur.hash  = hash;
+    cur.index = index;
+    for (;;) {
+	if (!table->slots[i].index) {
+	    table->slots[i] = cur;
+	    return;
+	}
+	d = HashDistance(table, i);
+	if (d < dist) {
+				/* Rob the rich */
+	    tmp             = table->slots[i];
+	    table->slots[i] = cur;
+	    cur             = tmp;
+	    dist            = d;
+	}
+	i = (i + 1) & table->mask;
+	++dist;
     }
+}
 
-    while (tmp) {
-	hash = (hash << 1) + scatter[tmp & 0xff];
-	tmp >>= 8;
+/* Rebuild the index with nslots slots.  If compact is set, deleted
+   entries are squeezed out of the entry array first, and the iteration
+   position is moved along with them so that a walk in progress neither
+   skips nor repeats an entry.  Nothing has to finish a walk, so callers
+   are free to stop early. */
+
+static int HashRebuild(HashTablePtr table, unsigned int nslots, int compact)
+{
+    HashSlotPtr  slots;
+    unsigned int i, j, p0;
+
+    slots = HASH_ALLOC(nslots * sizeof(*slots));
+    if (!slots) return -1;
+
+    if (compact) {
+	for (i = j = p0 = 0; i < table->used; i++) {
+	    if (i == table->p0) p0 = j;
+	    if (table->entry[i].live) table->entry[j++] = table->entry[i];
+	}
+	if (table->p0 >= table->used) p0 = j;
+	table->used = j;
+	table->p0   = p0;
     }
 
-    hash %= HASH_SIZE;
-#if HASH_DEBUG
-    printf( "Hash(%d) = %d\n", key, hash);
-#endif
-    return hash;
+    HASH_FREE(table->slots);
+    table->slots = slots;
+    table->mask  = nslots - 1;
+    for (i = 0; i < table->used; i++)
+	if (table->entry[i].live) HashPlace(table, table->entry[i].hash, i + 1);
+    return 0;
+}
+
+static int HashGrowEntries(HashTablePtr table)
+{
+    HashEntryPtr entry;
+    unsigned int size;
+
+    if (table->entries <= table->used / 2) {
+				/* Mostly deleted; reuse the space */
+	return HashRebuild(table, table->mask + 1, 1);
+    }
+
+    size  = table->size * 2;
+    entry = HASH_ALLOC(size * sizeof(*entry));
+    if (!entry) return -1;
+    memcpy(entry, table->entry, table->used * sizeof(*entry));
+    HASH_FREE(table->entry);
+    table->entry = entry;
+    table->size  = size;
+    return 0;
 }
 
 void *drmHashCreate(void)
 {
     HashTablePtr table;
-    int          i;
 
     table           = HASH_ALLOC(sizeof(*table));
     if (!table) return NULL;
@@ -166,93 +240,99 @@ void *drmHashCreate(void)
     table->hits     = 0;
     table->partials = 0;
     table->misses   = 0;
-
-    for (i = 0; i < HASH_SIZE; i++) table->buckets[i] = NULL;
+    table->mask     = HASH_MIN_SLOTS - 1;
+    table->slots    = HASH_ALLOC(HASH_MIN_SLOTS * sizeof(*table->slots));
+    table->used     = 0;
+    table->size     = HASH_MIN_ENTRIES;
+    table->entry    = HASH_ALLOC(HASH_MIN_ENTRIES * sizeof(*table->entry));
+    table->p0       = 0;
+
+    if (!table->slots || !table->entry) {
+	HASH_FREE(table->slots);
+	HASH_FREE(table->entry);
+	HASH_FREE(table);
+	return NULL;
+    }
     return table;
 }
 
 int drmHashDestroy(void *t)
 {
     HashTablePtr  table = (HashTablePtr)t;
-    HashBucketPtr bucket;
-    HashBucketPtr next;
-    int           i;
 
     if (table->magic != HASH_MAGIC) return -1; /* Bad magic */
 
-    for (i = 0; i < HASH_SIZE; i++) {
-	for (bucket = table->buckets[i]; bucket;) {
-	    next = bucket->next;
-	    HASH_FREE(bucket);
-	    bucket = next;
-	}
-    }
+    HASH_FREE(table->slots);
+    HASH_FREE(table->entry);
     HASH_FREE(table);
     return 0;
 }
 
-/* Find the bucket and organize the list so that this bucket is at the
-   top. */
+/* Return the index slot holding key, or -1 if it is not in the table. */
 
-static HashBucketPtr HashFind(HashTablePtr table,
-			      unsigned long key, unsigned long *h)
+static long HashFind(HashTablePtr table, unsigned long key, unsigned int *h)
 {
-    unsigned long hash = HashHash(key);
-    HashBucketPtr prev = NULL;
-    HashBucketPtr bucket;
+    unsigned int hash = HashHash(key);
+    unsigned int i    = hash & table->mask;
+    unsigned int dist = 0;
+    HashSlotPtr  slot;
 
     if (h) *h = hash;
 
-    for (bucket = table->buckets[hash]; bucket; bucket = bucket->next) {
-	if (bucket->key == key) {
-	    if (prev) {
-				/* Organize */
-		prev->next           = bucket->next;
-		bucket->next         = table->buckets[hash];
-		table->buckets[hash] = bucket;
-		++table->partials;
-	    } else {
-		++table->hits;
-	    }
-	    return bucket;
+    for (;;) {
+	slot = &table->slots[i];
+	if (!slot->index || HashDistance(table, i) < dist) break;
+	if (slot->hash == hash && table->entry[slot->index - 1].key == key) {
+	    if (dist) ++table->partials;
+	    else      ++table->hits;
+	    return i;
 	}
-	prev = bucket;
+	i = (i + 1) & table->mask;
+	++dist;
     }
     ++table->misses;
-    return NULL;
+    return -1;
 }
 
 int drmHashLookup(void *t, unsigned long key, void **value)
 {
     HashTablePtr  table = (HashTablePtr)t;
-    HashBucketPtr bucket;
+    long          slot;
 
     if (!table || table->magic != HASH_MAGIC) return -1; /* Bad magic */
 
-    bucket = HashFind(table, key, NULL);
-    if (!bucket) return 1;	/* Not found */
-    *value = bucket->value;
+    slot = HashFind(table, key, NULL);
+    if (slot < 0) return 1;	/* Not found */
+    *value = table->entry[table->slots[slot].index - 1].value;
     return 0;			/* Found */
 }
 
 int drmHashInsert(void *t, unsigned long key, void *value)
 {
     HashTablePtr  table = (HashTablePtr)t;
-    HashBucketPtr bucket;
-    unsigned long hash;
+    HashEntryPtr  entry;
+    unsigned int  hash;
 
     if (table->magic != HASH_MAGIC) return -1; /* Bad magic */
 
-    if (HashFind(table, key, &hash)) return 1; /* Already in table */
+    if (HashFind(table, key, &hash) >= 0) return 1; /* Already in table */
 
-    bucket               = HASH_ALLOC(sizeof(*bucket));
-    if (!bucket) return -1;	/* Error */
-    bucket->key          = key;
-    bucket->value        = value;
-    bucket->next         = table->buckets[hash];
-    table->buckets[hash] = bucket;
+    if ((table->entries + 1) * 8 > (table->mask + 1) * 7UL) {
+	if (HashRebuild(table, (table->mask + 1) * 2, 1))
+	    return -1;		/* Error */
+    }
+    if (table->used == table->size && HashGrowEntries(table))
+	return -1;		/* Error */
+
+    entry        = &table->entry[table->used++];
+    entry->key   = key;
+    entry->value = value;
+    entry->hash  = hash;
+    entry->live  = 1;
+    HashPlace(table, hash, table->used);
+    ++table->entries;
 #if HASH_DEBUG
-    printf("Inserted %d at %d/%p\n", key, hash, bucket);
+    printf("Inserted %lu at %u\n", key, table->used - 1);
 #endif
     return 0;			/* Added to table */
 }
@@ -260,33 +340,44 @@ int drmHashInsert(void *t, unsigned long key, void *value)
 int drmHashDelete(void *t, unsigned long key)
 {
     HashTablePtr  table = (HashTablePtr)t;
-    unsigned long hash;
-    HashBucketPtr bucket;
+    long          slot;
+    unsigned int  i, j;
 
     if (table->magic != HASH_MAGIC) return -1; /* Bad magic */
 
-    bucket = HashFind(table, key, &hash);
+    slot = HashFind(table, key, NULL);
 
-    if (!bucket) return 1;	/* Not found */
+    if (slot < 0) return 1;	/* Not found */
 
-    table->buckets[hash] = bucket->next;
-    HASH_FREE(bucket);
+    table->entry[table->slots[slot].index - 1].live = 0;
+    --table->entries;
+
+				/* Shift the rest of the cluster back */
+    i = slot;
+    j = (i + 1) & table->mask;
+    while (table->slots[j].index && HashDistance(table, j)) {
+	table->slots[i] = table->slots[j];
+	i = j;
+	j = (j + 1) & table->mask;
+    }
+    table->slots[i].index = 0;
+
+    if (!table->entries) table->used = table->p0 = 0;
     return 0;
 }
 
 int drmHashNext(void *t, unsigned long *key, void **value)
 {
     HashTablePtr  table = (HashTablePtr)t;
+    HashEntryPtr  entry;
 
-    while (table->p0 < HASH_SIZE) {
-	if (table->p1) {
-	    *key       = table->p1->key;
-	    *value     = table->p1->value;
-	    table->p1  = table->p1->next;
+    while (table->p0 < table->used) {
+	entry = &table->entry[table->p0++];
+	if (entry->live) {
+	    *key   = entry->key;
+	    *value = entry->value;
 	    return 1;
 	}
-	table->p1 = table->buckets[table->p0];
-	++table->p0;
     }
     return 0;
 }
@@ -298,130 +389,350 @@ int drmHashFirst(void *t, unsigned long *key, void **value)
     if (table->magic != HASH_MAGIC) return -1; /* Bad magic */
 
     table->p0 = 0;
-    table->p1 = table->buckets[0];
     return drmHashNext(table, key, value);
 }
 
 #if HASH_MAIN
-#define DIST_LIMIT 10
-static int dist[DIST_LIMIT];
+/* The fixed-size chained table with move-to-front lookup that this file
+   used to implement, kept here for comparison. */
 
-static void clear_dist(void) {
-    int i;
+#define CHAIN_SIZE 512
 
-    for (i = 0; i < DIST_LIMIT; i++) dist[i] = 0;
-}
+typedef struct ChainBucket {
+    unsigned long      key;
+    void               *value;
+    struct ChainBucket *next;
+} ChainBucket, *ChainBucketPtr;
+
+typedef struct ChainTable {
+    ChainBucketPtr     buckets[CHAIN_SIZE];
+} ChainTable, *ChainTablePtr;
 
-static int count_entries(HashBucketPtr bucket)
+static unsigned long ChainHash(unsigned long key)
 {
-    int count = 0;
+    unsigned long        hash = 0;
+    unsigned long        tmp  = key;
+    static int           init = 0;
+    static unsigned long scatter[256];
+    int                  i;
 
-    for (; bucket; bucket = bucket->next) ++count;
-    return count;
+    if (!init) {
+	srandom(37);
+	for (i = 0; i < 256; i++) scatter[i] = random();
+	++init;
+    }
+
+    while (tmp) {
+	hash = (hash << 1) + scatter[tmp & 0xff];
+	tmp >>= 8;
+    }
+
+    return hash % CHAIN_SIZE;
 }
 
-static void update_dist(int count)
+static void *chain_create(void)
 {
-    if (count >= DIST_LIMIT) ++dist[DIST_LIMIT-1];
-    else                     ++dist[count];
+    return calloc(1, sizeof(ChainTable));
 }
 
-static void compute_dist(HashTablePtr table)
+static void chain_destroy(void *t)
 {
-    int           i;
-    HashBucketPtr bucket;
-
-    printf("Entries = %ld, hits = %ld, partials = %ld, misses = %ld\n",
-	   table->entries, table->hits, table->partials, table->misses);
-    clear_dist();
-    for (i = 0; i < HASH_SIZE; i++) {
-	bucket = table->buckets[i];
-	update_dist(count_entries(bucket));
+    ChainTablePtr  table = (ChainTablePtr)t;
+    ChainBucketPtr bucket, next;
+    int            i;
+
+    for (i = 0; i < CHAIN_SIZE; i++) {
+	for (bucket = table->buckets[i]; bucket; bucket = next) {
+	    next = bucket->next;
+	    free(bucket);
+	}
     }
-    for (i = 0; i < DIST_LIMIT; i++) {
-	if (i != DIST_LIMIT-1) printf("%5d %10d\n", i, dist[i]);
-	else                   printf("other %10d\n", dist[i]);
+    free(table);
+}
+
+static ChainBucketPtr chain_find(ChainTablePtr table, unsigned long key,
+				 unsigned long *h)
+{
+    unsigned long  hash = ChainHash(key);
+    ChainBucketPtr prev = NULL;
+    ChainBucketPtr bucket;
+
+    if (h) *h = hash;
+
+    for (bucket = table->buckets[hash]; bucket; bucket = bucket->next) {
+	if (bucket->key == key) {
+	    if (prev) {
+		prev->next           = bucket->next;
+		bucket->next         = table->buckets[hash];
+		table->buckets[hash] = bucket;
+	    }
+	    return bucket;
+	}
+	prev = bucket;
     }
+    return NULL;
+}
+
+static int chain_lookup(void *t, unsigned long key, void **value)
+{
+    ChainBucketPtr bucket = chain_find(t, key, NULL);
+
+    if (!bucket) return 1;
+    *value = bucket->value;
+    return 0;
+}
+
+static int chain_insert(void *t, unsigned long key, void *value)
+{
+    ChainTablePtr  table = (ChainTablePtr)t;
+    ChainBucketPtr bucket;
+    unsigned long  hash;
+
+    if (chain_find(table, key, &hash)) return 1;
+
+    bucket               = malloc(sizeof(*bucket));
+    if (!bucket) return -1;
+    bucket->key          = key;
+    bucket->value        = value;
+    bucket->next         = table->buckets[hash];
+    table->buckets[hash] = bucket;
+    return 0;
+}
+
+static int chain_delete(void *t, unsigned long key)
+{
+    ChainTablePtr  table = (ChainTablePtr)t;
+    ChainBucketPtr bucket;
+    unsigned long  hash;
+
+    bucket = chain_find(table, key, &hash);
+    if (!bucket) return 1;
+
+    table->buckets[hash] = bucket->next;
+    free(bucket);
+    return 0;
 }
 
+typedef struct HashImpl {
+    const char    *name;
+    unsigned long max_keys;	/* Larger runs take minutes */
+    void          *(*create)(void);
+    int           (*insert)(void *t, unsigned long key, void *value);
+    int           (*lookup)(void *t, unsigned long key, void **value);
+    int           (*delete)(void *t, unsigned long key);
+    void          (*destroy)(void *t);
+} HashImpl;
+
+static void open_destroy(void *t)
+{
+    drmHashDestroy(t);
+}
+
+static const HashImpl impls[] = {
+    { "robin hood", 1000000, drmHashCreate, drmHashInsert, drmHashLookup,
+      drmHashDelete, open_destroy },
+    { "chained",    100000,  chain_create,  chain_insert,  chain_lookup,
+      chain_delete,  chain_destroy },
+};
+
+static int errors;
+
 static void check_table(HashTablePtr table,
 			unsigned long key, unsigned long value)
 {
-    unsigned long retval  = 0;
-    int           retcode = drmHashLookup(table, key, &retval);
+    void *retval  = NULL;
+    int   retcode = drmHashLookup(table, key, &retval);
 
     switch (retcode) {
     case -1:
-	printf("Bad magic = 0x%08lx:"
-	       " key = %lu, expected = %lu, returned = %lu\n",
-	       table->magic, key, value, retval);
+	printf("Bad magic = 0x%08lx: key = %lu, expected = %lu\n",
+	       table->magic, key, value);
+	++errors;
 	break;
     case 1:
-	printf("Not found: key = %lu, expected = %lu returned = %lu\n",
-	       key, value, retval);
+	printf("Not found: key = %lu, expected = %lu\n", key, value);
+	++errors;
 	break;
     case 0:
-	if (value != retval)
+	if (value != (unsigned long)retval) {
 	    printf("Bad value: key = %lu, expected = %lu, returned = %lu\n",
-		   key, value, retval);
+		   key, value, (unsigned long)retval);
+	    ++errors;
+	}
 	break;
     default:
-	printf("Bad retcode = %d: key = %lu, expected = %lu, returned = %lu\n",
-	       retcode, key, value, retval);
+	printf("Bad retcode = %d: key = %lu, expected = %lu\n",
+	       retcode, key, value);
+	++errors;
 	break;
     }
 }
 
-int main(void)
+static void check_stats(HashTablePtr table)
 {
-    HashTablePtr table;
-    int          i;
+    unsigned long i, longest = 0;
+
+    for (i = 0; i <= table->mask; i++)
+	if (table->slots[i].index && HashDistance(table, i) > longest)
+	    longest = HashDistance(table, i);
+    printf("Entries = %lu, slots = %u, hits = %lu, partials = %lu,"
+	   " misses = %lu, longest probe = %lu\n",
+	   table->entries, table->mask + 1, table->hits, table->partials,
+	   table->misses, longest);
+}
+
+static void test_keys(const char *name, unsigned long count,
+		      unsigned long stride)
+{
+    HashTablePtr  table;
+    unsigned long i;
 
-    printf("\n***** 256 consecutive integers ****\n");
+    printf("\n***** %lu %s ****\n", count, name);
     table = drmHashCreate();
-    for (i = 0; i < 256; i++) drmHashInsert(table, i, i);
-    for (i = 0; i < 256; i++) check_table(table, i, i);
-    for (i = 256; i >= 0; i--) check_table(table, i, i);
-    compute_dist(table);
+    for (i = 0; i < count; i++)
+	drmHashInsert(table, i * stride, (void *)i);
+    for (i = 0; i < count; i++) check_table(table, i * stride, i);
+    for (i = count; i > 0; i--) check_table(table, (i - 1) * stride, i - 1);
+    check_stats(table);
     drmHashDestroy(table);
+}
+
+static void test_iterate(void)
+{
+    HashTablePtr  table;
+    unsigned long key, seen = 0, i;
+    void          *value;
+    int           ret;
+    char          visits[1024];
 
-    printf("\n***** 1024 consecutive integers ****\n");
+    printf("\n***** iteration with concurrent delete/insert ****\n");
     table = drmHashCreate();
-    for (i = 0; i < 1024; i++) drmHashInsert(table, i, i);
-    for (i = 0; i < 1024; i++) check_table(table, i, i);
-    for (i = 1024; i >= 0; i--) check_table(table, i, i);
-    compute_dist(table);
+    for (i = 0; i < 1000; i++) drmHashInsert(table, i, (void *)i);
+
+				/* Delete every other key as we go, and add
+				   new keys which must show up at the end */
+    for (ret = drmHashFirst(table, &key, &value); ret == 1;
+	 ret = drmHashNext(table, &key, &value)) {
+	if (key < 1000 && (key & 1)) drmHashDelete(table, key);
+	if (key < 1000 && (key % 100) == 0)
+	    drmHashInsert(table, 1000 + key, (void *)key);
+	if (key < 1000 && (key & 1) && key > 1) drmHashDelete(table, key - 2);
+	++seen;
+    }
+    if (seen != 1010) {
+	printf("Iteration returned %lu entries, expected 1010\n", seen);
+	++errors;
+    }
+    if (table->entries != 510) {
+	printf("%lu entries left, expected 510\n", table->entries);
+	++errors;
+    }
     drmHashDestroy(table);
 
-    printf("\n***** 1024 consecutive page addresses (4k pages) ****\n");
+    printf("\n***** iteration across compaction ****\n");
     table = drmHashCreate();
-    for (i = 0; i < 1024; i++) drmHashInsert(table, i*4096, i);
-    for (i = 0; i < 1024; i++) check_table(table, i*4096, i);
-    for (i = 1024; i >= 0; i--) check_table(table, i*4096, i);
-    compute_dist(table);
+    for (i = 0; i < 1024; i++) drmHashInsert(table, i, (void *)0);
+
+				/* Deleting as we go lets the late inserts
+				   compact the entries under the walk */
+    seen = 0;
+    memset(visits, 0, sizeof(visits));
+    for (ret = drmHashFirst(table, &key, &value); ret == 1;
+	 ret = drmHashNext(table, &key, &value)) {
+	if (key < 1024 && visits[key]++) {
+	    printf("Key %lu returned twice\n", key);
+	    ++errors;
+	}
+	drmHashDelete(table, key);
+	if (key >= 600 && key < 1024 && (key % 4) == 0)
+	    drmHashInsert(table, 2000 + key, (void *)0);
+	++seen;
+    }
+    if (seen != 1130 || table->entries) {
+	printf("Iteration returned %lu entries, expected 1130,"
+	       " %lu entries left\n", seen, table->entries);
+	++errors;
+    }
     drmHashDestroy(table);
 
-    printf("\n***** 1024 random integers ****\n");
+    printf("\n***** abandoned iteration ****\n");
     table = drmHashCreate();
-    srandom(0xbeefbeef);
-    for (i = 0; i < 1024; i++) drmHashInsert(table, random(), i);
-    srandom(0xbeefbeef);
-    for (i = 0; i < 1024; i++) check_table(table, random(), i);
-    srandom(0xbeefbeef);
-    for (i = 0; i < 1024; i++) check_table(table, random(), i);
-    compute_dist(table);
+    drmHashInsert(table, 0, NULL);
+    drmHashFirst(table, &key, &value);
+    for (i = 1; i <= 2000000; i++) {
+	drmHashInsert(table, i, NULL);
+	drmHashDelete(table, i);
+    }
+    if (table->size > HASH_MIN_ENTRIES) {
+	printf("%u entries used, %u allocated for one key\n",
+	       table->used, table->size);
+	++errors;
+    }
     drmHashDestroy(table);
+}
 
-    printf("\n***** 5000 random integers ****\n");
-    table = drmHashCreate();
+static double usec(struct timeval *end, struct timeval *start)
+{
+    double e = end->tv_sec   * 1000000.0 + end->tv_usec;
+    double s = start->tv_sec * 1000000.0 + start->tv_usec;
+
+    return e - s;
+}
+
+static void bench(const HashImpl *impl, unsigned long count)
+{
+    struct timeval start, insert, lookup, miss, delete;
+    void           *table = impl->create();
+    void           *value;
+    unsigned long  i;
+
+    if (count > impl->max_keys) {
+	printf("%-10s %8lu    skipped\n", impl->name, count);
+	impl->destroy(table);
+	return;
+    }
+
+    gettimeofday(&start, NULL);
     srandom(0xbeefbeef);
-    for (i = 0; i < 5000; i++) drmHashInsert(table, random(), i);
+    for (i = 0; i < count; i++) impl->insert(table, random(), (void *)i);
+    gettimeofday(&insert, NULL);
     srandom(0xbeefbeef);
-    for (i = 0; i < 5000; i++) check_table(table, random(), i);
+    for (i = 0; i < count; i++) impl->lookup(table, random(), &value);
+    gettimeofday(&lookup, NULL);
+    for (i = 0; i < count; i++) impl->lookup(table, ~i, &value);
+    gettimeofday(&miss, NULL);
     srandom(0xbeefbeef);
-    for (i = 0; i < 5000; i++) check_table(table, random(), i);
-    compute_dist(table);
-    drmHashDestroy(table);
+    for (i = 0; i < count; i++) impl->delete(table, random());
+    gettimeofday(&delete, NULL);
+    impl->destroy(table);
+
+    printf("%-10s %8lu %10.1f %10.1f %10.1f %10.1f\n", impl->name, count,
+	   usec(&insert, &start) * 1000.0 / count,
+	   usec(&lookup, &insert) * 1000.0 / count,
+	   usec(&miss, &lookup) * 1000.0 / count,
+	   usec(&delete, &miss) * 1000.0 / count);
+}
+
+int main(void)
+{
+    unsigned long count;
+    unsigned int  i;
+
+    test_keys("consecutive integers", 256, 1);
+    test_keys("consecutive integers", 1024, 1);
+    test_keys("consecutive page addresses (4k pages)", 1024, 4096);
+    test_keys("consecutive integers", 100000, 1);
+    test_iterate();
+    if (errors) {
+	printf("\n%d errors\n", errors);
+	return 1;
+    }
+
+    printf("\n%-10s %8s %10s %10s %10s %10s\n", "table", "keys",
+	   "insert ns", "lookup ns", "miss ns", "delete ns");
+    for (count = 1000; count <= 1000000; count *= 10)
+	for (i = 0; i < sizeof(impls) / sizeof(impls[0]); i++)
+	    bench(&impls[i], count);
 
     return 0;
 }
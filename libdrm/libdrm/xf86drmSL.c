@@ -27,12 +27,37 @@
  *
  * DESCRIPTION
  *
- * This file contains a straightforward skip list implementation.n
+ * This file contains an ordered map from unsigned long keys to pointers,
+ * historically a skip list [Pugh90] (hence the drmSL names) and now a
+ * B+-tree [Comer79].  Compared to the skip list it replaces:
  *
- * FUTURE ENHANCEMENTS
+ * 1) Keys are stored contiguously, SL_NODE_KEYS to a node, so a lookup
+ * touches one cache-friendly node per level instead of chasing one
+ * pointer per comparison, and no allocation is made per entry.
+ *
+ * 2) Nodes come from a per-list arena that is grown SL_ARENA_NODES at a
+ * time and recycled through a free list.
+ *
+ * 3) Leaves are doubly linked, which makes ordered iteration, neighbor
+ * lookup and range scans (drmSLRange) a walk along the leaf level.
+ * A sorted array of keys can be loaded into an empty list with
+ * drmSLBulkLoad, which builds packed leaves bottom-up in linear time.
+ *
+ * Deletion is relaxed: nodes are only freed once they become empty, and
+ * are never rebalanced.  Lookups remain O(log n) in the largest size the
+ * list has reached, which matches how these lists are used.
+ *
+ * drmSLFirst/drmSLNext remember the last key returned, so the list may
+ * be modified between calls; iteration resumes at the next larger key.
+ *
+ * Define SL_MAIN to 1 to build a standalone test and timing harness that
+ * compares this implementation with the original skip list.
  *
  * REFERENCES
  *
+ * [Comer79] Douglas Comer.  The Ubiquitous B-Tree.  ACM Computing
+ * Surveys 11(2), June 1979, pp. 121-137.
+ *
  * [Pugh90] William Pugh.  Skip Lists: A Probabilistic Alternative to
  * Balanced Trees. CACM 33(6), June 1990, pp. 668-676.
  *
@@ -40,8 +65,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#ifndef SL_MAIN
 #define SL_MAIN 0
+#endif
 
 #if !SL_MAIN
 # include "xf86drm.h"
@@ -50,41 +78,51 @@
 #endif
 
 #define SL_LIST_MAGIC  0xfacade00LU
-#define SL_ENTRY_MAGIC 0x00fab1edLU
 #define SL_FREED_MAGIC 0xdecea5edLU
-#define SL_MAX_LEVEL   16
+#define SL_NODE_KEYS   32	/* Keys per node */
+#define SL_MAX_DEPTH   16	/* Good for SL_NODE_KEYS^16 entries */
+#define SL_ARENA_NODES 64	/* Nodes allocated at a time */
 #define SL_DEBUG       0
-#define SL_RANDOM_SEED 0xc01055a1LU
 
 #if SL_MAIN
-#define SL_ALLOC malloc
+#define SL_ALLOC(size) calloc(1, size)
 #define SL_FREE  free
-#define SL_RANDOM_DECL        static int state = 0;
-#define SL_RANDOM_INIT(seed)  if (!state) { srandom(seed); ++state; }
-#define SL_RANDOM             random()
 #else
 #define SL_ALLOC drmMalloc
 #define SL_FREE  drmFree
-#define SL_RANDOM_DECL        static void *state = NULL
-#define SL_RANDOM_INIT(seed)  if (!state) state = drmRandomCreate(seed)
-#define SL_RANDOM             drmRandom(state)
-
 #endif
 
-typedef struct SLEntry {
-    unsigned long     magic;	   /* SL_ENTRY_MAGIC */
-    unsigned long     key;
-    void              *value;
-    int               levels;
-    struct SLEntry    *forward[1]; /* variable sized array */
-} SLEntry, *SLEntryPtr;
+typedef struct SLNode {
+    int               leaf;
+    int               count;	/* Keys in use */
+    unsigned long     key[SL_NODE_KEYS];
+    union {
+	void          *value[SL_NODE_KEYS];	     /* Leaf */
+	struct SLNode *child[SL_NODE_KEYS + 1];  /* Interior, count + 1 */
+    } u;
+    struct SLNode     *prev;	/* Leaf chain */
+    struct SLNode     *next;	/* Leaf chain, or arena free list */
+} SLNode, *SLNodePtr;
+
+typedef struct SLArena {
+    struct SLArena    *next;
+    SLNode            node[SL_ARENA_NODES];
+} SLArena, *SLArenaPtr;
 
 typedef struct SkipList {
     unsigned long    magic;	/* SL_LIST_MAGIC */
-    int              level;
+    int              level;	/* Height of the tree, 0 for a single leaf */
     int              count;
-    SLEntryPtr       head;
-    SLEntryPtr       p0;	/* Position for iteration */
+    SLNodePtr        root;
+    SLArenaPtr       arena;
+    SLNodePtr        free_nodes;
+    unsigned long    version;	/* Bumped on every modification */
+
+				/* Position for iteration */
+    SLNodePtr        p0;
+    int              p1;
+    unsigned long    p_key;
+    unsigned long    p_version;
 } SkipList, *SkipListPtr;
 
 #if SL_MAIN
@@ -99,66 +137,136 @@ extern void drmSLDump(void *l);
 extern int  drmSLLookupNeighbors(void *l, unsigned long key,
 				 unsigned long *prev_key, void **prev_value,
 				 unsigned long *next_key, void **next_value);
+extern int  drmSLBulkLoad(void *l, int count, const unsigned long *keys,
+			  void * const *values);
+extern int  drmSLRange(void *l, unsigned long first, unsigned long last,
+		       int (*func)(unsigned long key, void *value, void *data),
+		       void *data);
 #endif
 
-static SLEntryPtr SLCreateEntry(int max_level, unsigned long key, void *value)
+static SLNodePtr SLAllocNode(SkipListPtr list, int leaf)
 {
-    SLEntryPtr entry;
-    
-    if (max_level < 0 || max_level > SL_MAX_LEVEL) max_level = SL_MAX_LEVEL;
+    SLNodePtr  node;
+    SLArenaPtr arena;
+    int        i;
+
+    if (!list->free_nodes) {
+	arena = SL_ALLOC(sizeof(*arena));
+	if (!arena) return NULL;
+	arena->next = list->arena;
+	list->arena = arena;
+	for (i = SL_ARENA_NODES - 1; i >= 0; i--) {
+	    arena->node[i].next = list->free_nodes;
+	    list->free_nodes    = &arena->node[i];
+	}
+    }
 
-    entry         = SL_ALLOC(sizeof(*entry)
-			     + (max_level + 1) * sizeof(entry->forward[0]));
-    if (!entry) return NULL;
-    entry->magic  = SL_ENTRY_MAGIC;
-    entry->key    = key;
-    entry->value  = value;
-    entry->levels = max_level + 1;
+    node             = list->free_nodes;
+    list->free_nodes = node->next;
+    node->leaf       = leaf;
+    node->count      = 0;
+    node->prev       = NULL;
+    node->next       = NULL;
+    return node;
+}
 
-    return entry;
+static void SLFreeNode(SkipListPtr list, SLNodePtr node)
+{
+    node->next       = list->free_nodes;
+    list->free_nodes = node;
 }
 
-static int SLRandomLevel(void)
+/* Index of the first key >= key. */
+static int SLLowerBound(SLNodePtr node, unsigned long key)
 {
-    int level = 1;
-    SL_RANDOM_DECL;
+    int lo = 0;
+    int hi = node->count;
+    int mid;
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (node->key[mid] < key) lo = mid + 1;
+	else                      hi = mid;
+    }
+    return lo;
+}
 
-    SL_RANDOM_INIT(SL_RANDOM_SEED);
-    
-    while ((SL_RANDOM & 0x01) && level < SL_MAX_LEVEL) ++level;
-    return level;
+/* Index of the child of an interior node that may hold key. */
+static int SLChild(SLNodePtr node, unsigned long key)
+{
+    int lo = 0;
+    int hi = node->count;
+    int mid;
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (node->key[mid] <= key) lo = mid + 1;
+	else                       hi = mid;
+    }
+    return lo;
+}
+
+/* Descend to the leaf that may hold key, recording the path. */
+static SLNodePtr SLLocate(SkipListPtr list, unsigned long key,
+			  SLNodePtr *path, int *index)
+{
+    SLNodePtr node = list->root;
+    int       depth = 0;
+    int       i;
+
+    while (!node->leaf) {
+	i = SLChild(node, key);
+	if (path) {
+	    path[depth]  = node;
+	    index[depth] = i;
+	}
+	++depth;
+	node = node->u.child[i];
+    }
+    return node;
+}
+
+static SLNodePtr SLFirstLeaf(SkipListPtr list)
+{
+    SLNodePtr node = list->root;
+
+    while (!node->leaf) node = node->u.child[0];
+    return node;
 }
 
 void *drmSLCreate(void)
 {
     SkipListPtr  list;
-    int          i;
 
     list           = SL_ALLOC(sizeof(*list));
     if (!list) return NULL;
     list->magic    = SL_LIST_MAGIC;
     list->level    = 0;
-    list->head     = SLCreateEntry(SL_MAX_LEVEL, 0, NULL);
     list->count    = 0;
+    list->arena    = NULL;
+    list->free_nodes = NULL;
+    list->version  = 0;
+    list->p0       = NULL;
+    list->root     = SLAllocNode(list, 1);
+    if (!list->root) {
+	SL_FREE(list);
+	return NULL;
+    }
 
-    for (i = 0; i <= SL_MAX_LEVEL; i++) list->head->forward[i] = NULL;
-    
     return list;
 }
 
 int drmSLDestroy(void *l)
 {
     SkipListPtr   list  = (SkipListPtr)l;
-    SLEntryPtr    entry;
-    SLEntryPtr    next;
+    SLArenaPtr    arena;
+    SLArenaPtr    next;
 
     if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
 
-    for (entry = list->head; entry; entry = next) {
-	if (entry->magic != SL_ENTRY_MAGIC) return -1; /* Bad magic */
-	next         = entry->forward[0];
-	entry->magic = SL_FREED_MAGIC;
-	SL_FREE(entry);
+    for (arena = list->arena; arena; arena = next) {
+	next = arena->next;
+	SL_FREE(arena);
     }
 
     list->magic = SL_FREED_MAGIC;
@@ -166,93 +274,232 @@ int drmSLDestroy(void *l)
     return 0;
 }
 
-static SLEntryPtr SLLocate(void *l, unsigned long key, SLEntryPtr *update)
+/* Insert key/child into the interior node path[depth] after index,
+   splitting upwards as needed. */
+static int SLInsertChild(SkipListPtr list, SLNodePtr *path, int *index,
+			 int depth, unsigned long key, SLNodePtr child)
 {
-    SkipListPtr   list  = (SkipListPtr)l;
-    SLEntryPtr    entry;
+    unsigned long keys[SL_NODE_KEYS + 1];
+    SLNodePtr     children[SL_NODE_KEYS + 2];
+    SLNodePtr     node;
+    SLNodePtr     right;
+    int           pos;
+    int           mid;
     int           i;
 
-    if (list->magic != SL_LIST_MAGIC) return NULL;
+    for (; depth >= 0; depth--) {
+	node = path[depth];
+	pos  = index[depth];
+
+	if (node->count < SL_NODE_KEYS) {
+	    memmove(&node->key[pos + 1], &node->key[pos],
+		    (node->count - pos) * sizeof(node->key[0]));
+	    memmove(&node->u.child[pos + 2], &node->u.child[pos + 1],
+		    (node->count - pos) * sizeof(node->u.child[0]));
+	    node->key[pos]         = key;
+	    node->u.child[pos + 1] = child;
+	    ++node->count;
+	    return 0;
+	}
 
-    for (i = list->level, entry = list->head; i >= 0; i--) {
-	while (entry->forward[i] && entry->forward[i]->key < key)
-	    entry = entry->forward[i];
-	update[i] = entry;
+				/* Split a full interior node */
+	right = SLAllocNode(list, 0);
+	if (!right) return -1;
+
+	for (i = 0; i < pos; i++) keys[i] = node->key[i];
+	keys[pos] = key;
+	for (i = pos; i < SL_NODE_KEYS; i++) keys[i + 1] = node->key[i];
+	for (i = 0; i <= pos; i++) children[i] = node->u.child[i];
+	children[pos + 1] = child;
+	for (i = pos + 1; i <= SL_NODE_KEYS; i++)
+	    children[i + 1] = node->u.child[i];
+
+	mid = (SL_NODE_KEYS + 1) / 2;
+	node->count = mid;
+	for (i = 0; i < mid; i++) {
+	    node->key[i]     = keys[i];
+	    node->u.child[i] = children[i];
+	}
+	node->u.child[mid] = children[mid];
+
+	right->count = SL_NODE_KEYS - mid;
+	for (i = 0; i < right->count; i++) {
+	    right->key[i]     = keys[mid + 1 + i];
+	    right->u.child[i] = children[mid + 1 + i];
+	}
+	right->u.child[right->count] = children[SL_NODE_KEYS + 1];
+
+	key   = keys[mid];
+	child = right;
     }
 
-    return entry->forward[0];
+				/* Grow a new root */
+    node = SLAllocNode(list, 0);
+    if (!node) return -1;
+    node->count      = 1;
+    node->key[0]     = key;
+    node->u.child[0] = list->root;
+    node->u.child[1] = child;
+    list->root       = node;
+    ++list->level;
+    return 0;
 }
 
 int drmSLInsert(void *l, unsigned long key, void *value)
 {
     SkipListPtr   list  = (SkipListPtr)l;
-    SLEntryPtr    entry;
-    SLEntryPtr    update[SL_MAX_LEVEL + 1];
-    int           level;
-    int           i;
+    SLNodePtr     path[SL_MAX_DEPTH];
+    int           index[SL_MAX_DEPTH];
+    SLNodePtr     leaf;
+    SLNodePtr     right;
+    int           pos;
+    int           half;
 
     if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
 
-    entry = SLLocate(list, key, update);
-
-    if (entry && entry->key == key) return 1; /* Already in list */
-
+    leaf = SLLocate(list, key, path, index);
+    pos  = SLLowerBound(leaf, key);
+
+    if (pos < leaf->count && leaf->key[pos] == key) return 1; /* Already in list */
+
+    if (leaf->count == SL_NODE_KEYS) {
+	if (list->level == SL_MAX_DEPTH) return -1;
+
+				/* Split the leaf, keeping the lower half */
+	right = SLAllocNode(list, 1);
+	if (!right) return -1;
+	half         = SL_NODE_KEYS / 2;
+	right->count = SL_NODE_KEYS - half;
+	memcpy(right->key, &leaf->key[half], right->count * sizeof(leaf->key[0]));
+	memcpy(right->u.value, &leaf->u.value[half],
+	       right->count * sizeof(leaf->u.value[0]));
+	leaf->count  = half;
+
+	right->prev  = leaf;
+	right->next  = leaf->next;
+	if (leaf->next) leaf->next->prev = right;
+	leaf->next   = right;
+
+	if (SLInsertChild(list, path, index, list->level - 1,
+			  right->key[0], right)) {
+				/* Undo; the leaf is still consistent */
+	    memcpy(&leaf->key[half], right->key,
+		   right->count * sizeof(leaf->key[0]));
+	    memcpy(&leaf->u.value[half], right->u.value,
+		   right->count * sizeof(leaf->u.value[0]));
+	    leaf->count = SL_NODE_KEYS;
+	    leaf->next  = right->next;
+	    if (right->next) right->next->prev = leaf;
+	    SLFreeNode(list, right);
+	    return -1;
+	}
 
-    level = SLRandomLevel();
-    if (level > list->level) {
-	level = ++list->level;
-	update[level] = list->head;
+	if (pos > half) {
+	    leaf = right;
+	    pos -= half;
+	}
     }
 
-    entry = SLCreateEntry(level, key, value);
-
-				/* Fix up forward pointers */
-    for (i = 0; i <= level; i++) {
-	entry->forward[i]     = update[i]->forward[i];
-	update[i]->forward[i] = entry;
-    }
+    memmove(&leaf->key[pos + 1], &leaf->key[pos],
+	    (leaf->count - pos) * sizeof(leaf->key[0]));
+    memmove(&leaf->u.value[pos + 1], &leaf->u.value[pos],
+	    (leaf->count - pos) * sizeof(leaf->u.value[0]));
+    leaf->key[pos]     = key;
+    leaf->u.value[pos] = value;
+    ++leaf->count;
 
     ++list->count;
+    ++list->version;
     return 0;			/* Added to table */
 }
 
 int drmSLDelete(void *l, unsigned long key)
 {
     SkipListPtr   list = (SkipListPtr)l;
-    SLEntryPtr    update[SL_MAX_LEVEL + 1];
-    SLEntryPtr    entry;
-    int           i;
+    SLNodePtr     path[SL_MAX_DEPTH];
+    int           index[SL_MAX_DEPTH];
+    SLNodePtr     node;
+    SLNodePtr     parent;
+    int           depth;
+    int           pos;
 
     if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
 
-    entry = SLLocate(list, key, update);
+    node = SLLocate(list, key, path, index);
+    pos  = SLLowerBound(node, key);
+
+    if (pos >= node->count || node->key[pos] != key) return 1; /* Not found */
+
+    --node->count;
+    memmove(&node->key[pos], &node->key[pos + 1],
+	    (node->count - pos) * sizeof(node->key[0]));
+    memmove(&node->u.value[pos], &node->u.value[pos + 1],
+	    (node->count - pos) * sizeof(node->u.value[0]));
+    --list->count;
+    ++list->version;
+
+    if (node->count || node == list->root) return 0;
 
-    if (!entry || entry->key != key) return 1; /* Not found */
+				/* Unlink the empty leaf and any interior
+				   nodes left without children */
+    if (node->prev) node->prev->next = node->next;
+    if (node->next) node->next->prev = node->prev;
 
-				/* Fix up forward pointers */
-    for (i = 0; i <= list->level; i++) {
-	if (update[i]->forward[i] == entry)
-	    update[i]->forward[i] = entry->forward[i];
+    for (depth = list->level - 1; depth >= 0; depth--) {
+	SLFreeNode(list, node);
+	parent = path[depth];
+	pos    = index[depth];
+
+	if (parent->count == 0) {
+				/* Only child; the parent goes too */
+	    node = parent;
+	    continue;
+	}
+	if (pos > 0) {
+	    memmove(&parent->key[pos - 1], &parent->key[pos],
+		    (parent->count - pos) * sizeof(parent->key[0]));
+	} else {
+	    memmove(&parent->key[0], &parent->key[1],
+		    (parent->count - 1) * sizeof(parent->key[0]));
+	}
+	memmove(&parent->u.child[pos], &parent->u.child[pos + 1],
+		(parent->count - pos) * sizeof(parent->u.child[0]));
+	--parent->count;
+	break;
     }
 
-    entry->magic = SL_FREED_MAGIC;
-    SL_FREE(entry);
+    if (depth < 0) {
+				/* Emptied the whole tree */
+	node->leaf  = 1;
+	node->count = 0;
+	node->prev  = node->next = NULL;
+	list->root  = node;
+	list->level = 0;
+    }
 
-    while (list->level && !list->head->forward[list->level]) --list->level;
-    --list->count;
+				/* Collapse single-child roots */
+    while (!list->root->leaf && list->root->count == 0) {
+	node       = list->root;
+	list->root = node->u.child[0];
+	SLFreeNode(list, node);
+	--list->level;
+    }
     return 0;
 }
 
 int drmSLLookup(void *l, unsigned long key, void **value)
 {
     SkipListPtr   list = (SkipListPtr)l;
-    SLEntryPtr    update[SL_MAX_LEVEL + 1];
-    SLEntryPtr    entry;
+    SLNodePtr     leaf;
+    int           pos;
 
-    entry = SLLocate(list, key, update);
+    if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
 
-    if (entry && entry->key == key) {
-	*value = entry;
+    leaf = SLLocate(list, key, NULL, NULL);
+    pos  = SLLowerBound(leaf, key);
+
+    if (pos < leaf->count && leaf->key[pos] == key) {
+	*value = leaf->u.value[pos];
 	return 0;
     }
     *value = NULL;
@@ -264,24 +511,41 @@ int drmSLLookupNeighbors(void *l, unsigned long key,
 			 unsigned long *next_key, void **next_value)
 {
     SkipListPtr   list = (SkipListPtr)l;
-    SLEntryPtr    update[SL_MAX_LEVEL + 1];
-    SLEntryPtr    entry;
+    SLNodePtr     leaf;
+    SLNodePtr     node;
+    int           pos;
     int           retcode = 0;
 
-    entry = SLLocate(list, key, update);
-
     *prev_key   = *next_key   = key;
     *prev_value = *next_value = NULL;
-	
-    if (update[0]) {
-	*prev_key   = update[0]->key;
-	*prev_value = update[0]->value;
+
+    if (list->magic != SL_LIST_MAGIC) return 0; /* Bad magic */
+
+    leaf = SLLocate(list, key, NULL, NULL);
+    pos  = SLLowerBound(leaf, key);
+
+				/* Like the skip list, the predecessor of the
+				   smallest key is a dummy <0, NULL> head */
+    ++retcode;
+    if (pos > 0) {
+	*prev_key   = leaf->key[pos - 1];
+	*prev_value = leaf->u.value[pos - 1];
+    } else if ((node = leaf->prev)) {
+	*prev_key   = node->key[node->count - 1];
+	*prev_value = node->u.value[node->count - 1];
+    } else {
+	*prev_key   = 0;
+    }
+
+    node = leaf;
+    if (pos == node->count) {
+	node = node->next;
+	pos  = 0;
+    }
+    if (node && pos < node->count) {
+	*next_key   = node->key[pos];
+	*next_value = node->u.value[pos];
 	++retcode;
-	if (update[0]->forward[0]) {
-	    *next_key   = update[0]->forward[0]->key;
-	    *next_value = update[0]->forward[0]->value;
-	    ++retcode;
-	}
     }
     return retcode;
 }
@@ -289,16 +553,37 @@ int drmSLLookupNeighbors(void *l, unsigned long key,
 int drmSLNext(void *l, unsigned long *key, void **value)
 {
     SkipListPtr   list = (SkipListPtr)l;
-    SLEntryPtr    entry;
+    SLNodePtr     leaf;
+    int           pos;
     
     if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
 
-    entry    = list->p0;
+    leaf = list->p0;
+    pos  = list->p1;
+
+    if (leaf && list->p_version != list->version) {
+				/* Modified since the last call; find the
+				   next key after the one last returned */
+	if (list->p_key == ~0UL) {
+	    leaf = NULL;
+	} else {
+	    leaf = SLLocate(list, list->p_key + 1, NULL, NULL);
+	    pos  = SLLowerBound(leaf, list->p_key + 1);
+	}
+    }
+
+    while (leaf && pos == leaf->count) {
+	leaf = leaf->next;
+	pos  = 0;
+    }
 
-    if (entry) {
-	list->p0 = entry->forward[0];
-	*key     = entry->key;
-	*value   = entry->value;
+    if (leaf) {
+	*key            = leaf->key[pos];
+	*value          = leaf->u.value[pos];
+	list->p0        = leaf;
+	list->p1        = pos + 1;
+	list->p_key     = *key;
+	list->p_version = list->version;
 	return 1;
     }
     list->p0 = NULL;
@@ -311,16 +596,153 @@ int drmSLFirst(void *l, unsigned long *key, void **value)
     
     if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
     
-    list->p0 = list->head->forward[0];
+    list->p0        = SLFirstLeaf(list);
+    list->p1        = 0;
+    list->p_version = list->version;
     return drmSLNext(list, key, value);
 }
 
+/* Call func for every entry with first <= key <= last, in order, until it
+   returns non-zero.  The list must not be modified from func.  Returns the
+   number of entries visited. */
+int drmSLRange(void *l, unsigned long first, unsigned long last,
+	       int (*func)(unsigned long key, void *value, void *data),
+	       void *data)
+{
+    SkipListPtr   list = (SkipListPtr)l;
+    SLNodePtr     leaf;
+    int           pos;
+    int           count = 0;
+
+    if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
+
+    leaf = SLLocate(list, first, NULL, NULL);
+    for (pos = SLLowerBound(leaf, first); leaf; leaf = leaf->next, pos = 0) {
+	for (; pos < leaf->count; pos++) {
+	    if (leaf->key[pos] > last) return count;
+	    ++count;
+	    if (func(leaf->key[pos], leaf->u.value[pos], data)) return count;
+	}
+    }
+    return count;
+}
+
+/* Load count entries, which must be sorted by strictly increasing key,
+   into an empty list.  Leaves are packed full and the interior levels
+   built bottom-up, so this is linear in count.  Returns 0 on success,
+   1 if the list is not empty or the keys are not sorted, and -1 on
+   error. */
+int drmSLBulkLoad(void *l, int count, const unsigned long *keys,
+		  void * const *values)
+{
+    SkipListPtr   list = (SkipListPtr)l;
+    SLNodePtr     *level;
+    unsigned long *low;
+    SLNodePtr     node;
+    SLNodePtr     prev = NULL;
+    int           n, m;
+    int           i, j;
+
+    if (list->magic != SL_LIST_MAGIC) return -1; /* Bad magic */
+    if (list->count) return 1;
+    if (count <= 0) return 0;
+    for (i = 1; i < count; i++)
+	if (keys[i] <= keys[i - 1]) return 1;
+
+    n     = (count + SL_NODE_KEYS - 1) / SL_NODE_KEYS;
+    level = SL_ALLOC(n * sizeof(*level));
+    low   = SL_ALLOC(n * sizeof(*low));
+    if (!level || !low) goto fail;
+
+    SLFreeNode(list, list->root);
+    list->root = NULL;
+
+    for (i = 0; i < n; i++) {
+	node = SLAllocNode(list, 1);
+	if (!node) goto fail_tree;
+	node->count = (i == n - 1) ? count - i * SL_NODE_KEYS : SL_NODE_KEYS;
+	memcpy(node->key, &keys[i * SL_NODE_KEYS],
+	       node->count * sizeof(node->key[0]));
+	if (values)
+	    memcpy(node->u.value, &values[i * SL_NODE_KEYS],
+		   node->count * sizeof(node->u.value[0]));
+	else
+	    memset(node->u.value, 0, node->count * sizeof(node->u.value[0]));
+	node->prev = prev;
+	if (prev) prev->next = node;
+	prev     = node;
+	level[i] = node;
+	low[i]   = node->key[0];
+    }
+    list->level = 0;
+
+    while (n > 1) {
+	if (list->level == SL_MAX_DEPTH) goto fail_tree;
+	m = (n + SL_NODE_KEYS) / (SL_NODE_KEYS + 1);
+	for (i = 0; i < m; i++) {
+	    int first = i * (SL_NODE_KEYS + 1);
+	    int last  = first + SL_NODE_KEYS + 1;
+
+	    if (last > n) last = n;
+	    node = SLAllocNode(list, 0);
+	    if (!node) goto fail_tree;
+	    node->count = last - first - 1;
+	    for (j = first; j < last; j++) {
+		node->u.child[j - first] = level[j];
+		if (j > first) node->key[j - first - 1] = low[j];
+	    }
+	    level[i] = node;
+	    low[i]   = low[first];
+	}
+	n = m;
+	++list->level;
+    }
+
+    list->root  = level[0];
+    list->count = count;
+    ++list->version;
+    SL_FREE(level);
+    SL_FREE(low);
+    return 0;
+
+ fail_tree:
+				/* Throw away the partial tree */
+    while (list->arena) {
+	SLArenaPtr next = list->arena->next;
+	SL_FREE(list->arena);
+	list->arena = next;
+    }
+    list->free_nodes = NULL;
+    list->level      = 0;
+    list->root       = SLAllocNode(list, 1);
+ fail:
+    SL_FREE(level);
+    SL_FREE(low);
+    return -1;
+}
+
+static void SLDumpNode(SLNodePtr node, int depth)
+{
+    int i;
+
+    printf("%*sNode %p: %s, %d keys\n", depth * 2, "", (void *)node,
+	   node->leaf ? "leaf" : "interior", node->count);
+    if (node->leaf) {
+	for (i = 0; i < node->count; i++)
+	    printf("%*s  <0x%08lx, %p>\n", depth * 2, "",
+		   node->key[i], node->u.value[i]);
+	return;
+    }
+    for (i = 0; i <= node->count; i++) {
+	if (i) printf("%*s  key 0x%08lx\n", depth * 2, "", node->key[i - 1]);
+	SLDumpNode(node->u.child[i], depth + 1);
+    }
+}
+
 /* Dump internal data structures for debugging. */
 void drmSLDump(void *l)
 {
     SkipListPtr   list = (SkipListPtr)l;
-    SLEntryPtr    entry;
-    int           i;
     
     if (list->magic != SL_LIST_MAGIC) {
 	printf("Bad magic: 0x%08lx (expected 0x%08lx)\n",
@@ -329,28 +751,126 @@ void drmSLDump(void *l)
     }
 
     printf("Level = %d, count = %d\n", list->level, list->count);
-    for (entry = list->head; entry; entry = entry->forward[0]) {
-	if (entry->magic != SL_ENTRY_MAGIC) {
-	    printf("Bad magic: 0x%08lx (expected 0x%08lx)\n",
-		   list->magic, SL_ENTRY_MAGIC);
-	}
-	printf("\nEntry %p <0x%08lx, %p> has %2d levels\n",
-	       entry, entry->key, entry->value, entry->levels);
-	for (i = 0; i < entry->levels; i++) {
-	    if (entry->forward[i]) {
-		printf("   %2d: %p <0x%08lx, %p>\n",
-		       i,
-		       entry->forward[i],
-		       entry->forward[i]->key,
-		       entry->forward[i]->value);
-	    } else {
-		printf("   %2d: %p\n", i, entry->forward[i]);
-	    }
-	}
-    }
+    SLDumpNode(list->root, 0);
 }
 
 #if SL_MAIN
+/* The skip list this file used to implement, kept for comparison. */
+
+#define SKIP_MAX_LEVEL 16
+
+typedef struct SkipEntry {
+    unsigned long     key;
+    void              *value;
+    struct SkipEntry  *forward[1]; /* variable sized array */
+} SkipEntry, *SkipEntryPtr;
+
+typedef struct Skip {
+    int              level;
+    SkipEntryPtr     head;
+} Skip, *SkipPtr;
+
+static SkipEntryPtr skip_entry(int max_level, unsigned long key, void *value)
+{
+    SkipEntryPtr entry;
+
+    entry        = malloc(sizeof(*entry)
+			  + (max_level + 1) * sizeof(entry->forward[0]));
+    entry->key   = key;
+    entry->value = value;
+    return entry;
+}
+
+static void *skip_create(void)
+{
+    SkipPtr list = malloc(sizeof(*list));
+    int     i;
+
+    list->level = 0;
+    list->head  = skip_entry(SKIP_MAX_LEVEL, 0, NULL);
+    for (i = 0; i <= SKIP_MAX_LEVEL; i++) list->head->forward[i] = NULL;
+    return list;
+}
+
+static int skip_destroy(void *l)
+{
+    SkipPtr      list = l;
+    SkipEntryPtr entry, next;
+
+    for (entry = list->head; entry; entry = next) {
+	next = entry->forward[0];
+	free(entry);
+    }
+    free(list);
+    return 0;
+}
+
+static SkipEntryPtr skip_locate(SkipPtr list, unsigned long key,
+				SkipEntryPtr *update)
+{
+    SkipEntryPtr entry = list->head;
+    int          i;
+
+    for (i = list->level; i >= 0; i--) {
+	while (entry->forward[i] && entry->forward[i]->key < key)
+	    entry = entry->forward[i];
+	update[i] = entry;
+    }
+    return entry->forward[0];
+}
+
+static int skip_insert(void *l, unsigned long key, void *value)
+{
+    SkipPtr      list = l;
+    SkipEntryPtr update[SKIP_MAX_LEVEL + 1];
+    SkipEntryPtr entry;
+    int          level = 1;
+    int          i;
+
+    entry = skip_locate(list, key, update);
+    if (entry && entry->key == key) return 1;
+
+    while ((random() & 0x01) && level < SKIP_MAX_LEVEL) ++level;
+    if (level > list->level) {
+	level = ++list->level;
+	update[level] = list->head;
+    }
+
+    entry = skip_entry(level, key, value);
+    for (i = 0; i <= level; i++) {
+	entry->forward[i]     = update[i]->forward[i];
+	update[i]->forward[i] = entry;
+    }
+    return 0;
+}
+
+static int skip_lookup(void *l, unsigned long key, void **value)
+{
+    SkipEntryPtr update[SKIP_MAX_LEVEL + 1];
+    SkipEntryPtr entry = skip_locate(l, key, update);
+
+    if (entry && entry->key == key) {
+	*value = entry->value;
+	return 0;
+    }
+    return -1;
+}
+
+typedef struct SLImpl {
+    const char *name;
+    void       *(*create)(void);
+    int        (*insert)(void *l, unsigned long key, void *value);
+    int        (*lookup)(void *l, unsigned long key, void **value);
+    int        (*destroy)(void *l);
+} SLImpl;
+
+static const SLImpl impls[] = {
+    { "b+tree",    drmSLCreate, drmSLInsert, drmSLLookup, drmSLDestroy },
+    { "skip list", skip_create, skip_insert, skip_lookup, skip_destroy },
+};
+
+static int errors;
+
 static void print(SkipListPtr list)
 {
     unsigned long key;
@@ -363,52 +883,48 @@ static void print(SkipListPtr list)
     }
 }
 
-static double do_time(int size, int iter)
+static double usec_since(struct timeval *start)
 {
-    SkipListPtr    list;
+    struct timeval stop;
+
+    gettimeofday(&stop, NULL);
+    return (double)(stop.tv_sec * 1000000 + stop.tv_usec
+		    - start->tv_sec * 1000000 - start->tv_usec);
+}
+
+static unsigned long keys[1000000];
+
+static double do_time(const SLImpl *impl, int size, int iter)
+{
+    void           *list;
     int            i, j;
-    unsigned long  keys[1000000];
-    unsigned long  previous;
-    unsigned long  key;
     void           *value;
-    struct timeval start, stop;
-    double         usec;
-    SL_RANDOM_DECL;
+    struct timeval start;
+    double         insert, usec;
 
-    SL_RANDOM_INIT(12345);
-    
-    list = drmSLCreate();
+    srandom(12345);
 
+    list = impl->create();
+
+    gettimeofday(&start, NULL);
     for (i = 0; i < size; i++) {
-	keys[i] = SL_RANDOM;
-	drmSLInsert(list, keys[i], NULL);
+	keys[i] = random();
+	impl->insert(list, keys[i], NULL);
     }
+    insert = usec_since(&start) / size;
 
-    previous = 0;
-    if (drmSLFirst(list, &key, &value)) {
-	do {
-	    if (key <= previous) {
-		printf( "%lu !< %lu\n", previous, key);
-	    }
-	    previous = key;
-	} while (drmSLNext(list, &key, &value));
-    }
-    
     gettimeofday(&start, NULL);
     for (j = 0; j < iter; j++) {
 	for (i = 0; i < size; i++) {
-	    if (drmSLLookup(list, keys[i], &value))
+	    if (impl->lookup(list, keys[i], &value))
 		printf("Error %lu %d\n", keys[i], i);
 	}
     }
-    gettimeofday(&stop, NULL);
-    
-    usec = (double)(stop.tv_sec * 1000000 + stop.tv_usec
-		    - start.tv_sec * 1000000 - start.tv_usec) / (size * iter);
-    
-    printf("%0.2f microseconds for list length %d\n", usec, size);
+    usec = usec_since(&start) / ((double)size * iter);
 
-    drmSLDestroy(list);
+    printf("%-10s %8d %10.3f %10.3f\n", impl->name, size, insert, usec);
+
+    impl->destroy(list);
     
     return usec;
 }
@@ -428,10 +944,130 @@ static void print_neighbors(void *list, unsigned long key)
 	   key, retval, prev_key, next_key);
 }
 
+static int count_range(unsigned long key, void *value, void *data)
+{
+    unsigned long *last = data;
+
+    if (key <= *last && *last != ~0UL) {
+	printf("Range out of order: %lu after %lu\n", key, *last);
+	++errors;
+    }
+    *last = key;
+    return 0;
+}
+
+/* Random inserts and deletes checked against a bitmap, with ordered
+   iteration, neighbor and range checks after each round. */
+static void check_random(int range, int rounds)
+{
+    unsigned char *present = calloc(range, 1);
+    void          *list    = drmSLCreate();
+    unsigned long key, prev, next, last;
+    void          *value, *pv, *nv;
+    int           i, r, count = 0, seen;
+
+    srandom(0xc01055a1);
+    for (r = 0; r < rounds; r++) {
+	for (i = 0; i < range; i++) {
+	    key = random() % range;
+	    if (random() & 1) {
+		if (drmSLInsert(list, key, (void *)(key + 1)) == !present[key]) {
+		    printf("Insert %lu returned wrong status\n", key);
+		    ++errors;
+		}
+		if (!present[key]) ++count;
+		present[key] = 1;
+	    } else {
+		if (drmSLDelete(list, key) == present[key]) {
+		    printf("Delete %lu returned wrong status\n", key);
+		    ++errors;
+		}
+		if (present[key]) --count;
+		present[key] = 0;
+	    }
+	}
+
+	seen = 0;
+	prev = 0;
+	if (drmSLFirst(list, &key, &value) == 1) {
+	    do {
+		if ((seen && key <= prev) || !present[key]
+		    || value != (void *)(key + 1)) {
+		    printf("Bad iteration at %lu\n", key);
+		    ++errors;
+		}
+		prev = key;
+		++seen;
+	    } while (drmSLNext(list, &key, &value) == 1);
+	}
+	if (seen != count) {
+	    printf("Iterated %d entries, expected %d\n", seen, count);
+	    ++errors;
+	}
+
+	for (i = 0; i < 100; i++) {
+	    key = random() % range;
+	    drmSLLookupNeighbors(list, key, &prev, &pv, &next, &nv);
+	    if (pv && (prev >= key || !present[prev])) ++errors;
+	    if (nv && (next < key || !present[next])) ++errors;
+	}
+
+	last = ~0UL;
+	if (drmSLRange(list, 0, ~0UL, count_range, &last) != count) {
+	    printf("Range scan count mismatch\n");
+	    ++errors;
+	}
+    }
+
+				/* Delete everything while iterating */
+    seen = 0;
+    if (drmSLFirst(list, &key, &value) == 1) {
+	do {
+	    drmSLDelete(list, key);
+	    ++seen;
+	} while (drmSLNext(list, &key, &value) == 1);
+    }
+    if (seen != count || drmSLFirst(list, &key, &value) != 0) {
+	printf("Delete during iteration failed\n");
+	++errors;
+    }
+
+    drmSLDestroy(list);
+    free(present);
+}
+
+static void check_bulk(int size)
+{
+    void           *list = drmSLCreate();
+    void           *value;
+    struct timeval start;
+    int            i;
+
+    for (i = 0; i < size; i++) keys[i] = (unsigned long)i * 3;
+    gettimeofday(&start, NULL);
+    if (drmSLBulkLoad(list, size, keys, NULL)) {
+	printf("Bulk load failed\n");
+	++errors;
+    }
+    printf("Bulk loaded %d keys in %0.3f microseconds per key\n",
+	   size, usec_since(&start) / size);
+    for (i = 0; i < size; i++) {
+	if (drmSLLookup(list, keys[i], &value)) ++errors;
+	if (!drmSLLookup(list, keys[i] + 1, &value)) ++errors;
+    }
+    for (i = 0; i < size; i += 2) drmSLInsert(list, keys[i] + 1, NULL);
+    for (i = 0; i < size; i += 3) drmSLDelete(list, keys[i]);
+    drmSLDestroy(list);
+}
+
 int main(void)
 {
     SkipListPtr    list;
-    double         usec, usec2, usec3, usec4;
+    int            sizes[] = { 100, 1000, 10000, 100000, 1000000 };
+    int            iters[] = { 10000, 1000, 100, 10, 2 };
+    double         base[2] = { 0, 0 };
+    double         usec;
+    unsigned int   i, j;
 
     list = drmSLCreate();
     printf( "list at %p\n", list);
@@ -462,18 +1098,24 @@ int main(void)
     drmSLDestroy(list);
     printf("\n==============================\n\n");
 
-    usec  = do_time(100, 10000);
-    usec2 = do_time(1000, 500);
-    printf("Table size increased by %0.2f, search time increased by %0.2f\n",
-	   1000.0/100.0, usec2 / usec);
-    
-    usec3 = do_time(10000, 50);
-    printf("Table size increased by %0.2f, search time increased by %0.2f\n",
-	   10000.0/100.0, usec3 / usec);
-    
-    usec4 = do_time(100000, 4);
-    printf("Table size increased by %0.2f, search time increased by %0.2f\n",
-	   100000.0/100.0, usec4 / usec);
+    check_random(1000, 20);
+    check_random(100000, 5);
+    check_bulk(1000000);
+    if (errors) {
+	printf("%d errors\n", errors);
+	return 1;
+    }
+
+    printf("%-10s %8s %10s %10s\n", "list", "size", "insert us", "lookup us");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+	for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++) {
+	    usec = do_time(&impls[j], sizes[i], iters[i]);
+	    if (!i) base[j] = usec;
+	    else printf("%-10s table size increased by %0.2f,"
+			" search time increased by %0.2f\n", impls[j].name,
+			(double)sizes[i] / sizes[0], usec / base[j]);
+	}
+    }
 
     return 0;
 }
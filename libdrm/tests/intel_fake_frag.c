@@ -0,0 +1,237 @@
+/* intel_fake_frag.c -- aperture heap fragmentation benchmark
+ *
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ * DESCRIPTION
+ *
+ * Exercises the drm_mm heap used by intel_bufmgr_fake with a randomized
+ * texture-like workload.  Everything runs on the host: the fake buffer
+ * manager is given a malloc'd "aperture" and no-op fence/exec callbacks,
+ * so no DRM device is needed.
+ *
+ * Two passes are made:
+ *  - a raw pass directly against mmAllocMem/mmFreeMem, reporting ns/op,
+ *    allocation failures and external fragmentation
+ *    (1 - largest free block / total free);
+ *  - a bufmgr pass that maps/unmaps buffer objects with no backing store,
+ *    counting how often a buffer had to be evicted and placed elsewhere.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "xf86drm.h"
+#include "intel_bufmgr.h"
+#include "mm.h"
+
+#define APERTURE_SIZE	(64 * 1024 * 1024)
+#define MAX_LIVE	4096
+
+static unsigned long seed = 1;
+
+static unsigned long rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static double usec(struct timeval *end, struct timeval *start)
+{
+    double e = end->tv_sec   * 1000000 + end->tv_usec;
+    double s = start->tv_sec * 1000000 + start->tv_usec;
+
+    return e - s;
+}
+
+/* Mostly small buffers with the occasional large one, page aligned. */
+static int pick_size(void)
+{
+    int pages;
+
+    switch (rnd() % 8) {
+    case 0:  pages = 64 + rnd() % 192; break;	/* 256k..1M */
+    case 1:
+    case 2:  pages = 8 + rnd() % 56;   break;	/* 32k..256k */
+    default: pages = 1 + rnd() % 7;    break;	/* 4k..32k */
+    }
+    return pages * 4096;
+}
+
+static int pick_align2(void)
+{
+    return 12 + rnd() % 5;			/* 4k..64k */
+}
+
+static void heap_stats(struct mem_block *heap, int *total, int *largest,
+		       int *blocks)
+{
+    struct mem_block *p;
+
+    *total = *largest = *blocks = 0;
+    for (p = heap->next; p != heap; p = p->next) {
+	(*blocks)++;
+	if (!p->free)
+	    continue;
+	*total += p->size;
+	if (p->size > *largest)
+	    *largest = p->size;
+    }
+}
+
+static void run_raw(int iterations)
+{
+    struct mem_block *heap = mmInit(0, APERTURE_SIZE);
+    struct mem_block *live[MAX_LIVE];
+    struct timeval start, end;
+    int nlive = 0, used = 0, fails = 0;
+    int i, total, largest, blocks;
+
+    memset(live, 0, sizeof(live));
+    seed = 1;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < iterations; i++) {
+	/* Keep the aperture around 80% full so the heap stays fragmented. */
+	if (nlive > 0 && (used > APERTURE_SIZE / 10 * 8 || nlive == MAX_LIVE ||
+			  rnd() % 2)) {
+	    int victim = rnd() % nlive;
+
+	    used -= live[victim]->size;
+	    mmFreeMem(live[victim]);
+	    live[victim] = live[--nlive];
+	} else {
+	    struct mem_block *b = mmAllocMem(heap, pick_size(),
+					     pick_align2(), 0);
+	    if (!b) {
+		fails++;
+		continue;
+	    }
+	    used += b->size;
+	    live[nlive++] = b;
+	}
+    }
+    gettimeofday(&end, NULL);
+
+    heap_stats(heap, &total, &largest, &blocks);
+    printf("mm:     %d ops, %.1f ns/op, %d failed, %d blocks, "
+	   "fragmentation %.3f\n",
+	   iterations, usec(&end, &start) * 1000.0 / iterations, fails,
+	   blocks, total ? 1.0 - (double)largest / total : 0.0);
+
+    mmDestroy(heap);
+}
+
+static unsigned int fence_emit(void *priv)
+{
+    static unsigned int cookie;
+
+    return ++cookie;
+}
+
+static void fence_wait(unsigned int fence, void *priv)
+{
+}
+
+struct live_bo {
+    drm_intel_bo *bo;
+    unsigned long offset;
+};
+
+static unsigned long map_offset(drm_intel_bo *bo, void *aperture)
+{
+    unsigned long ofs;
+
+    if (drm_intel_bo_map(bo, 0))
+	return ~0UL;
+    ofs = (uint8_t *)bo->virtual - (uint8_t *)aperture;
+    drm_intel_bo_unmap(bo);
+    return ofs;
+}
+
+static void run_bufmgr(int iterations)
+{
+    void *aperture = malloc(APERTURE_SIZE);
+    drm_intel_bufmgr *bufmgr;
+    struct live_bo live[MAX_LIVE];
+    struct timeval start, end;
+    int nlive = 0, fails = 0, moved = 0;
+    int i;
+
+    bufmgr = drm_intel_bufmgr_fake_init(-1, 0, aperture, APERTURE_SIZE, NULL);
+    drm_intel_bufmgr_fake_set_fence_callback(bufmgr, fence_emit, fence_wait,
+					     NULL);
+    seed = 1;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < iterations; i++) {
+	unsigned int op = rnd() % 4;
+
+	if (nlive > 0 && (nlive == MAX_LIVE || op == 0)) {
+	    int victim = rnd() % nlive;
+
+	    drm_intel_bo_unreference(live[victim].bo);
+	    live[victim] = live[--nlive];
+	} else if (nlive > 0 && op == 1) {
+	    /* Touch an existing buffer; if it was evicted to make room for
+	     * somebody else it comes back at a different offset.
+	     */
+	    struct live_bo *l = &live[rnd() % nlive];
+	    unsigned long ofs = map_offset(l->bo, aperture);
+
+	    if (ofs != l->offset)
+		moved++;
+	    l->offset = ofs;
+	} else {
+	    drm_intel_bo *bo = drm_intel_bo_alloc(bufmgr, "frag", pick_size(),
+						  1 << pick_align2());
+
+	    drm_intel_bo_fake_disable_backing_store(bo, NULL, NULL);
+	    live[nlive].bo = bo;
+	    live[nlive].offset = map_offset(bo, aperture);
+	    if (live[nlive].offset == ~0UL)
+		fails++;
+	    nlive++;
+	}
+    }
+    gettimeofday(&end, NULL);
+
+    printf("bufmgr: %d ops, %.1f ns/op, %d failed, %d evicted+moved\n",
+	   iterations, usec(&end, &start) * 1000.0 / iterations, fails, moved);
+
+    while (nlive > 0)
+	drm_intel_bo_unreference(live[--nlive].bo);
+    drm_intel_bufmgr_destroy(bufmgr);
+    free(aperture);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    run_raw(iterations);
+    run_bufmgr(iterations / 10);
+
+    return 0;
+}
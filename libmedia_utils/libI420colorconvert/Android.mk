@@ -2,7 +2,8 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES := \
-    ColorConvert.cpp
+    ColorConvert.cpp \
+    NV12ToI420.cpp
 
 LOCAL_C_INCLUDES:= \
         $(call include-path-for, frameworks-native)/media/openmax \
@@ -20,4 +21,4 @@ endif
 
 include $(BUILD_SHARED_LIBRARY)
 
-
+include $(call all-makefiles-under,$(LOCAL_PATH))
@@ -18,6 +18,8 @@
 #include <OMX_IVCommon.h>
 #include <string.h>
 
+#include "NV12ToI420.h"
+
 static int getDecoderOutputFormat() {
     return OMX_INTEL_COLOR_FormatYUV420PackedSemiPlanar;
 }
@@ -31,32 +33,14 @@ static int convertDecoderOutputToI420(
         srcWidth * (srcHeight - srcRect.top / 2);
     int dstWidth = srcRect.right - srcRect.left + 1;
     int dstHeight = srcRect.bottom - srcRect.top + 1;
-    size_t dst_y_size = dstWidth * dstHeight;
 
 #ifndef VIDEOEDITOR_INTEL_NV12_VERSION
-    size_t dst_uv_stride = dstWidth / 2;
-    size_t dst_uv_size = dstWidth / 2 * dstHeight / 2;
-    uint8_t *pDst_y = (uint8_t *)dstBits;
-    uint8_t *pDst_u = pDst_y + dst_y_size;
-    uint8_t *pDst_v = pDst_u + dst_uv_size;
-
-    for (int y = 0; y < dstHeight; ++y) {
-        memcpy(pDst_y, pSrc_y, dstWidth);
-        pSrc_y += srcWidth;
-        pDst_y += dstWidth;
-    }
-
-    size_t tmp = (dstWidth + 1) / 2;
-    for (int y = 0; y < (dstHeight + 1) / 2; ++y) {
-        for (size_t x = 0; x < tmp; ++x) {
-            pDst_u[x] = pSrc_uv[2 * x];
-            pDst_v[x] = pSrc_uv[2 * x + 1];
-        }
-        pSrc_uv += srcWidth;
-        pDst_u += dst_uv_stride;
-        pDst_v += dst_uv_stride;
-    }
+    // The I420 buffer is dstWidth * dstHeight * 3 / 2 bytes, with
+    // dstWidth / 2 x dstHeight / 2 chroma planes.
+    return NV12ToI420Packed(pSrc_y, srcWidth, pSrc_uv, srcWidth,
+                            dstWidth, dstHeight, (uint8_t *)dstBits, 0);
 #else
+    size_t dst_y_size = dstWidth * dstHeight;
     uint8_t *pDst_y = (uint8_t *)dstBits;
     memcpy(pDst_y,pSrc_y,dst_y_size*3/2);
 #endif
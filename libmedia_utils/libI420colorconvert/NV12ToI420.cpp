@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NV12ToI420.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define NV12_HAVE_X86 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+// Frames above this many luma pixels are converted in row bands.
+#define BAND_MIN_PIXELS (1920 * 1088)
+#define MAX_BANDS 4
+
+typedef void (*DeinterleaveFunc)(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                                 int count);
+
+extern "C" void NV12DeinterleaveUVScalar(
+    const uint8_t *uv, uint8_t *u, uint8_t *v, int count) {
+    for (int x = 0; x < count; ++x) {
+        u[x] = uv[2 * x];
+        v[x] = uv[2 * x + 1];
+    }
+}
+
+#ifdef NV12_HAVE_X86
+extern "C" __attribute__((target("sse2")))
+void NV12DeinterleaveUVSSE2(
+    const uint8_t *uv, uint8_t *u, uint8_t *v, int count) {
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    int x = 0;
+
+    for (; x + 16 <= count; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(uv + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(uv + 2 * x + 16));
+        __m128i uu = _mm_packus_epi16(_mm_and_si128(a, mask),
+                                      _mm_and_si128(b, mask));
+        __m128i vv = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+                                      _mm_srli_epi16(b, 8));
+        _mm_storeu_si128((__m128i *)(u + x), uu);
+        _mm_storeu_si128((__m128i *)(v + x), vv);
+    }
+    NV12DeinterleaveUVScalar(uv + 2 * x, u + x, v + x, count - x);
+}
+
+extern "C" __attribute__((target("ssse3")))
+void NV12DeinterleaveUVSSSE3(
+    const uint8_t *uv, uint8_t *u, uint8_t *v, int count) {
+    // Even bytes (U) to the low half, odd bytes (V) to the high half.
+    const __m128i shuffle = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14,
+                                          1, 3, 5, 7, 9, 11, 13, 15);
+    int x = 0;
+
+    for (; x + 16 <= count; x += 16) {
+        __m128i a = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)(uv + 2 * x)), shuffle);
+        __m128i b = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)(uv + 2 * x + 16)), shuffle);
+        _mm_storeu_si128((__m128i *)(u + x), _mm_unpacklo_epi64(a, b));
+        _mm_storeu_si128((__m128i *)(v + x), _mm_unpackhi_epi64(a, b));
+    }
+    NV12DeinterleaveUVScalar(uv + 2 * x, u + x, v + x, count - x);
+}
+#endif
+
+static DeinterleaveFunc sDeinterleave = NV12DeinterleaveUVScalar;
+static pthread_once_t sDispatchOnce = PTHREAD_ONCE_INIT;
+
+static void selectDeinterleave() {
+#ifdef NV12_HAVE_X86
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        if (ecx & bit_SSSE3) {
+            sDeinterleave = NV12DeinterleaveUVSSSE3;
+        } else if (edx & bit_SSE2) {
+            sDeinterleave = NV12DeinterleaveUVSSE2;
+        }
+    }
+#endif
+}
+
+extern "C" void NV12DeinterleaveUV(
+    const uint8_t *uv, uint8_t *u, uint8_t *v, int count) {
+    pthread_once(&sDispatchOnce, selectDeinterleave);
+    sDeinterleave(uv, u, v, count);
+}
+
+struct Band {
+    const uint8_t *srcY;
+    int srcYStride;
+    const uint8_t *srcUV;
+    int srcUVStride;
+    int width;
+    int rows;       // luma rows
+    int uvRows;     // chroma rows
+    uint8_t *dstY;
+    int dstYStride;
+    uint8_t *dstU;
+    int dstUStride;
+    uint8_t *dstV;
+    int dstVStride;
+};
+
+static void convertBand(const Band *b) {
+    const uint8_t *srcY = b->srcY;
+    const uint8_t *srcUV = b->srcUV;
+    uint8_t *dstY = b->dstY;
+    uint8_t *dstU = b->dstU;
+    uint8_t *dstV = b->dstV;
+    int uvWidth = (b->width + 1) / 2;
+
+    if (b->srcYStride == b->width && b->dstYStride == b->width) {
+        memcpy(dstY, srcY, (size_t)b->width * b->rows);
+    } else {
+        for (int y = 0; y < b->rows; ++y) {
+            memcpy(dstY, srcY, b->width);
+            srcY += b->srcYStride;
+            dstY += b->dstYStride;
+        }
+    }
+
+    for (int y = 0; y < b->uvRows; ++y) {
+        sDeinterleave(srcUV, dstU, dstV, uvWidth);
+        srcUV += b->srcUVStride;
+        dstU += b->dstUStride;
+        dstV += b->dstVStride;
+    }
+}
+
+static void *bandThread(void *arg) {
+    convertBand((const Band *)arg);
+    return NULL;
+}
+
+static int pickBands(int width, int height, int threads) {
+    if (threads <= 0) {
+        if ((long)width * height <= BAND_MIN_PIXELS) {
+            return 1;
+        }
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > MAX_BANDS) {
+        threads = MAX_BANDS;
+    }
+    // Keep every band at least a few chroma rows tall.
+    if (threads > height / 16) {
+        threads = height / 16 > 0 ? height / 16 : 1;
+    }
+    return threads;
+}
+
+extern "C" int NV12ToI420(
+    const uint8_t *srcY, int srcYStride,
+    const uint8_t *srcUV, int srcUVStride,
+    int width, int height,
+    uint8_t *dstY, int dstYStride,
+    uint8_t *dstU, int dstUStride,
+    uint8_t *dstV, int dstVStride,
+    int threads) {
+
+    if (!srcY || !srcUV || !dstY || !dstU || !dstV ||
+        width <= 0 || height <= 0 ||
+        srcYStride < width || dstYStride < width ||
+        srcUVStride < ((width + 1) & ~1) ||
+        dstUStride < (width + 1) / 2 || dstVStride < (width + 1) / 2) {
+        return -1;
+    }
+
+    pthread_once(&sDispatchOnce, selectDeinterleave);
+
+    int bands = pickBands(width, height, threads);
+    int uvHeight = (height + 1) / 2;
+    // Band boundaries fall on even luma rows so chroma rows split cleanly.
+    int bandRows = ((height + bands - 1) / bands + 1) & ~1;
+
+    Band band[MAX_BANDS];
+    pthread_t thread[MAX_BANDS];
+    bool started[MAX_BANDS];
+    int n = 0;
+
+    for (int row = 0; row < height && n < MAX_BANDS; row += bandRows, ++n) {
+        Band *b = &band[n];
+        int uvRow = row / 2;
+
+        b->srcY = srcY + (size_t)row * srcYStride;
+        b->srcYStride = srcYStride;
+        b->srcUV = srcUV + (size_t)uvRow * srcUVStride;
+        b->srcUVStride = srcUVStride;
+        b->width = width;
+        b->rows = height - row < bandRows ? height - row : bandRows;
+        b->uvRows = (row + b->rows + 1) / 2 - uvRow;
+        if (uvRow + b->uvRows > uvHeight) {
+            b->uvRows = uvHeight - uvRow;
+        }
+        b->dstY = dstY + (size_t)row * dstYStride;
+        b->dstYStride = dstYStride;
+        b->dstU = dstU + (size_t)uvRow * dstUStride;
+        b->dstUStride = dstUStride;
+        b->dstV = dstV + (size_t)uvRow * dstVStride;
+        b->dstVStride = dstVStride;
+    }
+
+    // The calling thread converts the last band itself.  If a thread
+    // cannot be created its band is converted inline as well.
+    for (int i = 0; i < n - 1; ++i) {
+        started[i] = pthread_create(&thread[i], NULL, bandThread,
+                                    &band[i]) == 0;
+        if (!started[i]) {
+            convertBand(&band[i]);
+        }
+    }
+    convertBand(&band[n - 1]);
+    for (int i = 0; i < n - 1; ++i) {
+        if (started[i]) {
+            pthread_join(thread[i], NULL);
+        }
+    }
+
+    return 0;
+}
+
+extern "C" int NV12ToI420Packed(
+    const uint8_t *srcY, int srcYStride,
+    const uint8_t *srcUV, int srcUVStride,
+    int width, int height, uint8_t *dst, int threads) {
+
+    if (!srcY || !srcUV || !dst || width <= 0 || height <= 0 ||
+        srcYStride < width) {
+        return -1;
+    }
+
+    // The chroma planes hold width / 2 x height / 2 samples, so only the
+    // even part of the frame goes through NV12ToI420.
+    int evenWidth = width & ~1;
+    int evenHeight = height & ~1;
+    uint8_t *dstU = dst + (size_t)width * height;
+    uint8_t *dstV = dstU + (size_t)(width / 2) * (height / 2);
+
+    if (evenWidth && evenHeight &&
+        NV12ToI420(srcY, srcYStride, srcUV, srcUVStride,
+                   evenWidth, evenHeight,
+                   dst, width,
+                   dstU, width / 2,
+                   dstV, width / 2,
+                   threads) != 0) {
+        return -1;
+    }
+
+    if (evenWidth != width) {
+        for (int y = 0; y < evenHeight; ++y) {
+            dst[(size_t)y * width + evenWidth] =
+                srcY[(size_t)y * srcYStride + evenWidth];
+        }
+    }
+    if (evenHeight != height) {
+        memcpy(dst + (size_t)evenHeight * width,
+               srcY + (size_t)evenHeight * srcYStride, width);
+    }
+
+    return 0;
+}
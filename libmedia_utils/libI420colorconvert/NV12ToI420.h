@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NV12_TO_I420_H_
+#define NV12_TO_I420_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Convert a width x height NV12 image into planar I420, writing straight
+ * into the caller's Y, U and V planes.  Every plane has its own stride,
+ * so the destination can be a sub-rectangle of a larger buffer.  Odd
+ * widths and heights round the chroma planes up.
+ *
+ * The UV deinterleave uses SSSE3 or SSE2 when the CPU has them.  Frames
+ * larger than 1080p are split into row bands converted in parallel;
+ * threads selects the number of bands (0 picks automatically, 1 forces
+ * a single-threaded conversion).
+ *
+ * Returns 0 on success, -1 on invalid arguments.
+ */
+int NV12ToI420(const uint8_t *srcY, int srcYStride,
+               const uint8_t *srcUV, int srcUVStride,
+               int width, int height,
+               uint8_t *dstY, int dstYStride,
+               uint8_t *dstU, int dstUStride,
+               uint8_t *dstV, int dstVStride,
+               int threads);
+
+/*
+ * Convert into a tightly packed I420 buffer of width * height * 3 / 2
+ * bytes, the layout the II420ColorConverter interface hands out: Y,
+ * then U and V planes of width / 2 x height / 2 samples.  For odd sizes
+ * the last chroma column and row do not fit that buffer and are
+ * dropped; luma is always converted in full.
+ *
+ * Returns 0 on success, -1 on invalid arguments.
+ */
+int NV12ToI420Packed(const uint8_t *srcY, int srcYStride,
+                     const uint8_t *srcUV, int srcUVStride,
+                     int width, int height, uint8_t *dst, int threads);
+
+/*
+ * Reference scalar deinterleave of count UV pairs; exposed so the tests
+ * can check the vector paths bit-exactly.
+ */
+void NV12DeinterleaveUVScalar(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                              int count);
+
+#if defined(__i386__) || defined(__x86_64__)
+/*
+ * The vector kernels behind NV12DeinterleaveUV, exposed for the same
+ * reason.  Only call the ones the CPU supports.
+ */
+void NV12DeinterleaveUVSSE2(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                            int count);
+void NV12DeinterleaveUVSSSE3(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                             int count);
+#endif
+
+/* Deinterleave using the best path available on this CPU. */
+void NV12DeinterleaveUV(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                        int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // NV12_TO_I420_H_
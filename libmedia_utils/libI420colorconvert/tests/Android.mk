@@ -0,0 +1,15 @@
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+    NV12ToI420Test.cpp \
+    ../NV12ToI420.cpp
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/..
+
+LOCAL_MODULE:= nv12toi420_test
+
+LOCAL_MODULE_TAGS := eng
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Bit-exactness test and benchmark for NV12ToI420.
+//
+// Every vector path and band count is compared against a plain scalar
+// conversion over odd and even sizes and padded strides, the packed
+// layout handed to II420ColorConverter users is checked to stay inside
+// its buffer, then the conversion is timed at 720p, 1080p and 4K.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NV12ToI420.h"
+
+static int sErrors = 0;
+
+static void referenceConvert(
+    const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+    int width, int height,
+    uint8_t *dstY, int dstYStride, uint8_t *dstU, int dstUStride,
+    uint8_t *dstV, int dstVStride) {
+    for (int y = 0; y < height; ++y) {
+        memcpy(dstY + y * dstYStride, srcY + y * srcYStride, width);
+    }
+    for (int y = 0; y < (height + 1) / 2; ++y) {
+        NV12DeinterleaveUVScalar(srcUV + y * srcUVStride,
+                                 dstU + y * dstUStride,
+                                 dstV + y * dstVStride, (width + 1) / 2);
+    }
+}
+
+static void fill(uint8_t *p, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        p[i] = rand() & 0xff;
+    }
+}
+
+typedef void (*DeinterleaveFunc)(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                                 int count);
+
+static void checkDeinterleave(const char *name, DeinterleaveFunc func) {
+    uint8_t uv[2 * 100 + 1];
+    uint8_t u0[100], v0[100], u1[100], v1[100];
+
+    fill(uv, sizeof(uv));
+    for (int count = 0; count <= 100; ++count) {
+        // Odd source offset exercises unaligned loads.
+        NV12DeinterleaveUVScalar(uv + 1, u0, v0, count);
+        func(uv + 1, u1, v1, count);
+        if (memcmp(u0, u1, count) || memcmp(v0, v1, count)) {
+            printf("%s deinterleave mismatch at count %d\n", name, count);
+            ++sErrors;
+        }
+    }
+}
+
+// The dispatcher only runs the best kernel, so check every kernel the
+// CPU can run on its own.
+static void checkDeinterleavers() {
+    checkDeinterleave("dispatched", NV12DeinterleaveUV);
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        checkDeinterleave("sse2", NV12DeinterleaveUVSSE2);
+    } else {
+        printf("sse2 not supported, skipped\n");
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        checkDeinterleave("ssse3", NV12DeinterleaveUVSSSE3);
+    } else {
+        printf("ssse3 not supported, skipped\n");
+    }
+#endif
+}
+
+static void checkConvert(int width, int height, int pad, int threads) {
+    int srcStride = ((width + 1) & ~1) + pad;
+    int uvWidth = (width + 1) / 2;
+    int uvHeight = (height + 1) / 2;
+    int dstYStride = width + pad;
+    int dstUVStride = uvWidth + pad / 2;
+    size_t srcSize = (size_t)srcStride * (height + uvHeight);
+    size_t dstSize = (size_t)dstYStride * height +
+                     2 * (size_t)dstUVStride * uvHeight;
+
+    uint8_t *src = (uint8_t *)malloc(srcSize);
+    uint8_t *ref = (uint8_t *)malloc(dstSize);
+    uint8_t *out = (uint8_t *)malloc(dstSize);
+
+    fill(src, srcSize);
+    // Identical background so that padding bytes compare equal too.
+    memset(ref, 0x5a, dstSize);
+    memset(out, 0x5a, dstSize);
+
+    const uint8_t *srcUV = src + (size_t)srcStride * height;
+    size_t uOffset = (size_t)dstYStride * height;
+    size_t vOffset = uOffset + (size_t)dstUVStride * uvHeight;
+
+    referenceConvert(src, srcStride, srcUV, srcStride, width, height,
+                     ref, dstYStride, ref + uOffset, dstUVStride,
+                     ref + vOffset, dstUVStride);
+    if (NV12ToI420(src, srcStride, srcUV, srcStride, width, height,
+                   out, dstYStride, out + uOffset, dstUVStride,
+                   out + vOffset, dstUVStride, threads) != 0) {
+        printf("%dx%d pad %d threads %d: rejected\n",
+               width, height, pad, threads);
+        ++sErrors;
+    } else if (memcmp(ref, out, dstSize)) {
+        printf("%dx%d pad %d threads %d: mismatch\n",
+               width, height, pad, threads);
+        ++sErrors;
+    }
+
+    free(src);
+    free(ref);
+    free(out);
+}
+
+static void checkPacked(int width, int height) {
+    const size_t kGuard = 64;
+    int srcStride = (width + 1) & ~1;
+    size_t srcSize = (size_t)srcStride * (height + (height + 1) / 2);
+    size_t dstSize = (size_t)width * height * 3 / 2;
+
+    uint8_t *src = (uint8_t *)malloc(srcSize);
+    uint8_t *ref = (uint8_t *)malloc(dstSize + kGuard);
+    uint8_t *out = (uint8_t *)malloc(dstSize + kGuard);
+
+    fill(src, srcSize);
+    memset(ref, 0x5a, dstSize + kGuard);
+    memset(out, 0x5a, dstSize + kGuard);
+
+    // Full luma, chroma cut down to width / 2 x height / 2.
+    const uint8_t *srcUV = src + (size_t)srcStride * height;
+    uint8_t *refU = ref + (size_t)width * height;
+    uint8_t *refV = refU + (size_t)(width / 2) * (height / 2);
+    for (int y = 0; y < height; ++y) {
+        memcpy(ref + (size_t)y * width, src + (size_t)y * srcStride, width);
+    }
+    for (int y = 0; y < height / 2; ++y) {
+        NV12DeinterleaveUVScalar(srcUV + (size_t)y * srcStride,
+                                 refU + y * (width / 2),
+                                 refV + y * (width / 2), width / 2);
+    }
+
+    if (NV12ToI420Packed(src, srcStride, srcUV, srcStride, width, height,
+                         out, 0) != 0) {
+        printf("packed %dx%d: rejected\n", width, height);
+        ++sErrors;
+    } else if (memcmp(ref, out, dstSize + kGuard)) {
+        printf("packed %dx%d: mismatch or overrun\n", width, height);
+        ++sErrors;
+    }
+
+    free(src);
+    free(ref);
+    free(out);
+}
+
+static double nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void bench(const char *name, int width, int height) {
+    const int kIterations = 50;
+    size_t ySize = (size_t)width * height;
+    uint8_t *src = (uint8_t *)malloc(ySize * 3 / 2);
+    uint8_t *dst = (uint8_t *)malloc(ySize * 3 / 2);
+    uint8_t *dstU = dst + ySize;
+    uint8_t *dstV = dstU + ySize / 4;
+    double start;
+
+    fill(src, ySize * 3 / 2);
+
+    start = nowMs();
+    for (int i = 0; i < kIterations; ++i) {
+        referenceConvert(src, width, src + ySize, width, width, height,
+                         dst, width, dstU, width / 2, dstV, width / 2);
+    }
+    double scalar = (nowMs() - start) / kIterations;
+
+    start = nowMs();
+    for (int i = 0; i < kIterations; ++i) {
+        NV12ToI420(src, width, src + ySize, width, width, height,
+                   dst, width, dstU, width / 2, dstV, width / 2, 1);
+    }
+    double simd = (nowMs() - start) / kIterations;
+
+    start = nowMs();
+    for (int i = 0; i < kIterations; ++i) {
+        NV12ToI420(src, width, src + ySize, width, width, height,
+                   dst, width, dstU, width / 2, dstV, width / 2, 0);
+    }
+    double automatic = (nowMs() - start) / kIterations;
+
+    printf("%-6s %5dx%-5d scalar %7.3f ms  simd %7.3f ms  auto %7.3f ms\n",
+           name, width, height, scalar, simd, automatic);
+
+    free(src);
+    free(dst);
+}
+
+int main(int argc, char **argv) {
+    static const int kWidths[] = { 1, 2, 15, 16, 17, 31, 32, 33, 63, 176,
+                                   1279, 1280, 1920 };
+    static const int kHeights[] = { 1, 2, 3, 17, 64, 97 };
+    static const int kThreads[] = { 1, 2, 3, 4, 0 };
+
+    srand(1234);
+    checkDeinterleavers();
+    for (size_t w = 0; w < sizeof(kWidths) / sizeof(kWidths[0]); ++w) {
+        for (size_t h = 0; h < sizeof(kHeights) / sizeof(kHeights[0]); ++h) {
+            for (size_t t = 0; t < sizeof(kThreads) / sizeof(kThreads[0]);
+                 ++t) {
+                checkConvert(kWidths[w], kHeights[h], 0, kThreads[t]);
+                checkConvert(kWidths[w], kHeights[h], 36, kThreads[t]);
+            }
+        }
+    }
+    checkConvert(3840, 2160, 0, 0);
+    checkConvert(3840, 2160, 64, 3);
+    for (size_t w = 0; w < sizeof(kWidths) / sizeof(kWidths[0]); ++w) {
+        for (size_t h = 0; h < sizeof(kHeights) / sizeof(kHeights[0]); ++h) {
+            checkPacked(kWidths[w], kHeights[h]);
+        }
+    }
+    checkPacked(5, 5);
+
+    if (sErrors) {
+        printf("FAILED: %d errors\n", sErrors);
+        return 1;
+    }
+    printf("bit-exact: OK\n");
+
+    if (argc > 1 && !strcmp(argv[1], "-b")) {
+        bench("720p", 1280, 720);
+        bench("1080p", 1920, 1080);
+        bench("4K", 3840, 2160);
+    }
+    return 0;
+}
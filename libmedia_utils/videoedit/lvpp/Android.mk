@@ -53,3 +53,4 @@ LOCAL_LDLIBS := \
 
 include $(BUILD_STATIC_LIBRARY)
 
+include $(call all-makefiles-under,$(LOCAL_PATH))
@@ -19,83 +19,616 @@
 #include <utils/Log.h>
 
 #include "VideoEditorToolsNV12.h"
+
+#include <pthread.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define M4VIFI_HAVE_X86 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
 #define M4VIFI_ALLOC_FAILURE 10
 
-static M4VIFI_UInt8 M4VIFI_SemiplanarYUV420toYUV420_X86(void *user_data,
-    M4VIFI_ImagePlane *PlaneIn, M4VIFI_ImagePlane *PlaneOut )
+/* Rotation works on 8x8 element tiles grouped into blocks of this size */
+#define ROTATE_BLOCK 64
+
+/* Largest run of pixels swapped at once by the in-place 180 rotation */
+#define REVERSE_CHUNK 256
+
+/**
+ ***********************************************************************************************
+ * Row kernels
+ *
+ * The entry points below are split into per-row kernels which are selected
+ * once at runtime from the CPU features. Every variant of a kernel produces
+ * bit-exact results; only the speed differs.
+ ***********************************************************************************************
+*/
+
+/* Vertical bilinear pass: pu16_out[i] = top[i] * (16 - frac) + bottom[i] * frac */
+typedef void (*M4VIFI_BlendRowsFct)(const M4VIFI_UInt8 *pu8_top,
+    const M4VIFI_UInt8 *pu8_bottom, M4VIFI_UInt32 u32_y_frac,
+    M4VIFI_UInt16 *pu16_out, M4VIFI_UInt32 u32_count);
+
+/* Transpose one 8x8 tile of 1 or 2 byte elements, strides may be negative */
+typedef void (*M4VIFI_TransposeTileFct)(const M4VIFI_UInt8 *pu8_src,
+    M4VIFI_Int32 i32_src_stride, M4VIFI_UInt8 *pu8_dst, M4VIFI_Int32 i32_dst_stride);
+
+/* Mirror a row of u32_count elements, source and destination must not overlap */
+typedef void (*M4VIFI_ReverseRowFct)(const M4VIFI_UInt8 *pu8_src,
+    M4VIFI_UInt8 *pu8_dst, M4VIFI_UInt32 u32_count);
+
+/* Split u32_count interleaved UV pairs into separate U and V rows */
+typedef void (*M4VIFI_DeinterleaveFct)(const M4VIFI_UInt8 *pu8_uv,
+    M4VIFI_UInt8 *pu8_u, M4VIFI_UInt8 *pu8_v, M4VIFI_UInt32 u32_count);
+
+typedef struct {
+    M4VIFI_BlendRowsFct     blendRows;
+    M4VIFI_TransposeTileFct transpose8;
+    M4VIFI_TransposeTileFct transpose16;
+    M4VIFI_ReverseRowFct    reverse8;
+    M4VIFI_ReverseRowFct    reverse16;
+    M4VIFI_DeinterleaveFct  deinterleave;
+} M4VIFI_NV12Kernels;
+
+static void blendRows_C(const M4VIFI_UInt8 *pu8_top, const M4VIFI_UInt8 *pu8_bottom,
+    M4VIFI_UInt32 u32_y_frac, M4VIFI_UInt16 *pu16_out, M4VIFI_UInt32 u32_count)
+{
+    M4VIFI_UInt32 i;
+
+    for (i = 0; i < u32_count; i++) {
+        pu16_out[i] = (M4VIFI_UInt16)(pu8_top[i] * (16 - u32_y_frac) +
+                                      pu8_bottom[i] * u32_y_frac);
+    }
+}
+
+static void transpose8_C(const M4VIFI_UInt8 *pu8_src, M4VIFI_Int32 i32_src_stride,
+    M4VIFI_UInt8 *pu8_dst, M4VIFI_Int32 i32_dst_stride)
+{
+    M4VIFI_Int32 i, j;
+
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 8; j++) {
+            pu8_dst[i * i32_dst_stride + j] = pu8_src[j * i32_src_stride + i];
+        }
+    }
+}
+
+static void transpose16_C(const M4VIFI_UInt8 *pu8_src, M4VIFI_Int32 i32_src_stride,
+    M4VIFI_UInt8 *pu8_dst, M4VIFI_Int32 i32_dst_stride)
+{
+    M4VIFI_Int32 i, j;
+
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 8; j++) {
+            memcpy(pu8_dst + i * i32_dst_stride + 2 * j,
+                   pu8_src + j * i32_src_stride + 2 * i, 2);
+        }
+    }
+}
+
+static void reverse8_C(const M4VIFI_UInt8 *pu8_src, M4VIFI_UInt8 *pu8_dst,
+    M4VIFI_UInt32 u32_count)
+{
+    M4VIFI_UInt32 i;
+
+    for (i = 0; i < u32_count; i++) {
+        pu8_dst[i] = pu8_src[u32_count - 1 - i];
+    }
+}
+
+static void reverse16_C(const M4VIFI_UInt8 *pu8_src, M4VIFI_UInt8 *pu8_dst,
+    M4VIFI_UInt32 u32_count)
+{
+    M4VIFI_UInt32 i;
+
+    for (i = 0; i < u32_count; i++) {
+        pu8_dst[2 * i]     = pu8_src[2 * (u32_count - 1 - i)];
+        pu8_dst[2 * i + 1] = pu8_src[2 * (u32_count - 1 - i) + 1];
+    }
+}
+
+static void deinterleave_C(const M4VIFI_UInt8 *pu8_uv, M4VIFI_UInt8 *pu8_u,
+    M4VIFI_UInt8 *pu8_v, M4VIFI_UInt32 u32_count)
+{
+    M4VIFI_UInt32 i;
+
+    for (i = 0; i < u32_count; i++) {
+        pu8_u[i] = pu8_uv[2 * i];
+        pu8_v[i] = pu8_uv[2 * i + 1];
+    }
+}
+
+#ifdef M4VIFI_HAVE_X86
+__attribute__((target("sse2")))
+static void blendRows_SSE2(const M4VIFI_UInt8 *pu8_top, const M4VIFI_UInt8 *pu8_bottom,
+    M4VIFI_UInt32 u32_y_frac, M4VIFI_UInt16 *pu16_out, M4VIFI_UInt32 u32_count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w_top = _mm_set1_epi16((short)(16 - u32_y_frac));
+    const __m128i w_bottom = _mm_set1_epi16((short)u32_y_frac);
+    M4VIFI_UInt32 i = 0;
+
+    for (; i + 16 <= u32_count; i += 16) {
+        __m128i t = _mm_loadu_si128((const __m128i *)(pu8_top + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(pu8_bottom + i));
+        __m128i lo = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), w_top),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w_bottom));
+        __m128i hi = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), w_top),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w_bottom));
+        _mm_storeu_si128((__m128i *)(pu16_out + i), lo);
+        _mm_storeu_si128((__m128i *)(pu16_out + i + 8), hi);
+    }
+    blendRows_C(pu8_top + i, pu8_bottom + i, u32_y_frac, pu16_out + i, u32_count - i);
+}
+
+__attribute__((target("sse2")))
+static void transpose8_SSE2(const M4VIFI_UInt8 *pu8_src, M4VIFI_Int32 i32_src_stride,
+    M4VIFI_UInt8 *pu8_dst, M4VIFI_Int32 i32_dst_stride)
+{
+    __m128i r0, r1, r2, r3, r4, r5, r6, r7;
+    __m128i t0, t1, t2, t3;
+
+#define LOAD8(n) _mm_loadl_epi64((const __m128i *)(pu8_src + (n) * i32_src_stride))
+    r0 = LOAD8(0); r1 = LOAD8(1); r2 = LOAD8(2); r3 = LOAD8(3);
+    r4 = LOAD8(4); r5 = LOAD8(5); r6 = LOAD8(6); r7 = LOAD8(7);
+#undef LOAD8
+
+    t0 = _mm_unpacklo_epi8(r0, r1);
+    t1 = _mm_unpacklo_epi8(r2, r3);
+    t2 = _mm_unpacklo_epi8(r4, r5);
+    t3 = _mm_unpacklo_epi8(r6, r7);
+
+    r0 = _mm_unpacklo_epi16(t0, t1);
+    r1 = _mm_unpackhi_epi16(t0, t1);
+    r2 = _mm_unpacklo_epi16(t2, t3);
+    r3 = _mm_unpackhi_epi16(t2, t3);
+
+    t0 = _mm_unpacklo_epi32(r0, r2);
+    t1 = _mm_unpackhi_epi32(r0, r2);
+    t2 = _mm_unpacklo_epi32(r1, r3);
+    t3 = _mm_unpackhi_epi32(r1, r3);
+
+#define STORE8(n, v) _mm_storel_epi64((__m128i *)(pu8_dst + (n) * i32_dst_stride), v)
+    STORE8(0, t0); STORE8(1, _mm_srli_si128(t0, 8));
+    STORE8(2, t1); STORE8(3, _mm_srli_si128(t1, 8));
+    STORE8(4, t2); STORE8(5, _mm_srli_si128(t2, 8));
+    STORE8(6, t3); STORE8(7, _mm_srli_si128(t3, 8));
+#undef STORE8
+}
+
+__attribute__((target("sse2")))
+static void transpose16_SSE2(const M4VIFI_UInt8 *pu8_src, M4VIFI_Int32 i32_src_stride,
+    M4VIFI_UInt8 *pu8_dst, M4VIFI_Int32 i32_dst_stride)
+{
+    __m128i r0, r1, r2, r3, r4, r5, r6, r7;
+    __m128i t0, t1, t2, t3, t4, t5, t6, t7;
+
+#define LOAD16(n) _mm_loadu_si128((const __m128i *)(pu8_src + (n) * i32_src_stride))
+    r0 = LOAD16(0); r1 = LOAD16(1); r2 = LOAD16(2); r3 = LOAD16(3);
+    r4 = LOAD16(4); r5 = LOAD16(5); r6 = LOAD16(6); r7 = LOAD16(7);
+#undef LOAD16
+
+    t0 = _mm_unpacklo_epi16(r0, r1);
+    t1 = _mm_unpackhi_epi16(r0, r1);
+    t2 = _mm_unpacklo_epi16(r2, r3);
+    t3 = _mm_unpackhi_epi16(r2, r3);
+    t4 = _mm_unpacklo_epi16(r4, r5);
+    t5 = _mm_unpackhi_epi16(r4, r5);
+    t6 = _mm_unpacklo_epi16(r6, r7);
+    t7 = _mm_unpackhi_epi16(r6, r7);
+
+    r0 = _mm_unpacklo_epi32(t0, t2);
+    r1 = _mm_unpackhi_epi32(t0, t2);
+    r2 = _mm_unpacklo_epi32(t1, t3);
+    r3 = _mm_unpackhi_epi32(t1, t3);
+    r4 = _mm_unpacklo_epi32(t4, t6);
+    r5 = _mm_unpackhi_epi32(t4, t6);
+    r6 = _mm_unpacklo_epi32(t5, t7);
+    r7 = _mm_unpackhi_epi32(t5, t7);
+
+#define STORE16(n, v) _mm_storeu_si128((__m128i *)(pu8_dst + (n) * i32_dst_stride), v)
+    STORE16(0, _mm_unpacklo_epi64(r0, r4));
+    STORE16(1, _mm_unpackhi_epi64(r0, r4));
+    STORE16(2, _mm_unpacklo_epi64(r1, r5));
+    STORE16(3, _mm_unpackhi_epi64(r1, r5));
+    STORE16(4, _mm_unpacklo_epi64(r2, r6));
+    STORE16(5, _mm_unpackhi_epi64(r2, r6));
+    STORE16(6, _mm_unpacklo_epi64(r3, r7));
+    STORE16(7, _mm_unpackhi_epi64(r3, r7));
+#undef STORE16
+}
+
+__attribute__((target("sse2")))
+static __m128i reverseWords_SSE2(__m128i v)
+{
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+__attribute__((target("sse2")))
+static void reverse8_SSE2(const M4VIFI_UInt8 *pu8_src, M4VIFI_UInt8 *pu8_dst,
+    M4VIFI_UInt32 u32_count)
+{
+    M4VIFI_UInt32 i = 0;
+
+    for (; i + 16 <= u32_count; i += 16) {
+        __m128i v = reverseWords_SSE2(
+            _mm_loadu_si128((const __m128i *)(pu8_src + u32_count - 16 - i)));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *)(pu8_dst + i), v);
+    }
+    reverse8_C(pu8_src, pu8_dst + i, u32_count - i);
+}
+
+__attribute__((target("ssse3")))
+static void reverse8_SSSE3(const M4VIFI_UInt8 *pu8_src, M4VIFI_UInt8 *pu8_dst,
+    M4VIFI_UInt32 u32_count)
+{
+    const __m128i mirror = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                         7, 6, 5, 4, 3, 2, 1, 0);
+    M4VIFI_UInt32 i = 0;
+
+    for (; i + 16 <= u32_count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(pu8_src + u32_count - 16 - i));
+        _mm_storeu_si128((__m128i *)(pu8_dst + i), _mm_shuffle_epi8(v, mirror));
+    }
+    reverse8_C(pu8_src, pu8_dst + i, u32_count - i);
+}
+
+__attribute__((target("sse2")))
+static void reverse16_SSE2(const M4VIFI_UInt8 *pu8_src, M4VIFI_UInt8 *pu8_dst,
+    M4VIFI_UInt32 u32_count)
+{
+    M4VIFI_UInt32 i = 0;
+
+    for (; i + 8 <= u32_count; i += 8) {
+        __m128i v = _mm_loadu_si128(
+            (const __m128i *)(pu8_src + 2 * (u32_count - 8 - i)));
+        _mm_storeu_si128((__m128i *)(pu8_dst + 2 * i), reverseWords_SSE2(v));
+    }
+    reverse16_C(pu8_src, pu8_dst + 2 * i, u32_count - i);
+}
+
+__attribute__((target("sse2")))
+static void deinterleave_SSE2(const M4VIFI_UInt8 *pu8_uv, M4VIFI_UInt8 *pu8_u,
+    M4VIFI_UInt8 *pu8_v, M4VIFI_UInt32 u32_count)
+{
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    M4VIFI_UInt32 i = 0;
+
+    for (; i + 16 <= u32_count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(pu8_uv + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(pu8_uv + 2 * i + 16));
+        _mm_storeu_si128((__m128i *)(pu8_u + i), _mm_packus_epi16(
+            _mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128((__m128i *)(pu8_v + i), _mm_packus_epi16(
+            _mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    deinterleave_C(pu8_uv + 2 * i, pu8_u + i, pu8_v + i, u32_count - i);
+}
+
+__attribute__((target("ssse3")))
+static void deinterleave_SSSE3(const M4VIFI_UInt8 *pu8_uv, M4VIFI_UInt8 *pu8_u,
+    M4VIFI_UInt8 *pu8_v, M4VIFI_UInt32 u32_count)
+{
+    /* Even bytes (U) to the low half, odd bytes (V) to the high half */
+    const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14,
+                                        1, 3, 5, 7, 9, 11, 13, 15);
+    M4VIFI_UInt32 i = 0;
+
+    for (; i + 16 <= u32_count; i += 16) {
+        __m128i a = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)(pu8_uv + 2 * i)), split);
+        __m128i b = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)(pu8_uv + 2 * i + 16)), split);
+        _mm_storeu_si128((__m128i *)(pu8_u + i), _mm_unpacklo_epi64(a, b));
+        _mm_storeu_si128((__m128i *)(pu8_v + i), _mm_unpackhi_epi64(a, b));
+    }
+    deinterleave_C(pu8_uv + 2 * i, pu8_u + i, pu8_v + i, u32_count - i);
+}
+#endif /* M4VIFI_HAVE_X86 */
+
+static M4VIFI_NV12Kernels sKernels = {
+    blendRows_C, transpose8_C, transpose16_C, reverse8_C, reverse16_C, deinterleave_C
+};
+static M4VIFI_Int32 sCpuSimdLevel = M4VIFI_NV12_SIMD_NONE;
+static pthread_once_t sKernelsOnce = PTHREAD_ONCE_INIT;
+
+static void setKernels(M4VIFI_Int32 level)
+{
+    M4VIFI_NV12Kernels k = {
+        blendRows_C, transpose8_C, transpose16_C, reverse8_C, reverse16_C, deinterleave_C
+    };
+
+#ifdef M4VIFI_HAVE_X86
+    if (level >= M4VIFI_NV12_SIMD_SSE2) {
+        k.blendRows    = blendRows_SSE2;
+        k.transpose8   = transpose8_SSE2;
+        k.transpose16  = transpose16_SSE2;
+        k.reverse8     = reverse8_SSE2;
+        k.reverse16    = reverse16_SSE2;
+        k.deinterleave = deinterleave_SSE2;
+    }
+    if (level >= M4VIFI_NV12_SIMD_SSSE3) {
+        k.reverse8     = reverse8_SSSE3;
+        k.deinterleave = deinterleave_SSSE3;
+    }
+#endif
+    sKernels = k;
+}
+
+static void detectKernels(void)
+{
+#ifdef M4VIFI_HAVE_X86
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        if (ecx & bit_SSSE3) {
+            sCpuSimdLevel = M4VIFI_NV12_SIMD_SSSE3;
+        } else if (edx & bit_SSE2) {
+            sCpuSimdLevel = M4VIFI_NV12_SIMD_SSE2;
+        }
+    }
+#endif
+    setKernels(sCpuSimdLevel);
+    LOGV("NV12 kernels: simd level %d", sCpuSimdLevel);
+}
+
+static const M4VIFI_NV12Kernels *getKernels(void)
 {
+    pthread_once(&sKernelsOnce, detectKernels);
+    return &sKernels;
+}
 
-     M4VIFI_UInt32 i;
-     M4VIFI_UInt8 *p_buf_src, *p_buf_dest, *p_buf_src_u, *p_buf_src_v;
-     M4VIFI_UInt8 *p_buf_dest_u,*p_buf_dest_v,*p_buf_src_uv;
-     M4VIFI_UInt8     return_code = M4VIFI_OK;
-
-     /* the filter is implemented with the assumption that the width is equal to stride */
-     if(PlaneIn[0].u_width != PlaneIn[0].u_stride)
-        return M4VIFI_INVALID_PARAM;
-
-     /* The input Y Plane is the same as the output Y Plane */
-     p_buf_src = &(PlaneIn[0].pac_data[PlaneIn[0].u_topleft]);
-     p_buf_dest = &(PlaneOut[0].pac_data[PlaneOut[0].u_topleft]);
-     memcpy((void *)p_buf_dest,(void *)p_buf_src ,
-         PlaneOut[0].u_width * PlaneOut[0].u_height);
-
-     /* The U and V components are planar. The need to be made interleaved */
-     p_buf_src_uv = &(PlaneIn[1].pac_data[PlaneIn[1].u_topleft]);
-     p_buf_dest_u  = &(PlaneOut[1].pac_data[PlaneOut[1].u_topleft]);
-     p_buf_dest_v  = &(PlaneOut[2].pac_data[PlaneOut[2].u_topleft]);
-
-     for(i = 0; i < PlaneOut[1].u_width*PlaneOut[1].u_height; i++)
-     {
-        *p_buf_dest_u++ = *p_buf_src_uv++;
-        *p_buf_dest_v++ = *p_buf_src_uv++;
-     }
-     return return_code;
+M4VIFI_Int32 M4VIFI_NV12SelectKernels(M4VIFI_Int32 level)
+{
+    pthread_once(&sKernelsOnce, detectKernels);
+    if (level < 0 || level > sCpuSimdLevel) {
+        level = sCpuSimdLevel;
+    }
+    setKernels(level);
+    return level;
 }
 
 /**
  ***********************************************************************************************
- * M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData, M4VIFI_ImagePlane *pPlaneIn,
+ * Horizontal taps of a bilinear resize
+ *
+ * The per-pixel source offset and weight only depend on the column, so they
+ * are computed once per plane instead of once per output pixel. The buffer
+ * also holds one vertically blended source row (see M4VIFI_BlendRowsFct).
+ ***********************************************************************************************
+*/
+typedef struct {
+    M4VIFI_UInt16   *pu16_row;      /* vertically blended source row */
+    M4VIFI_UInt32   *pu32_offset;   /* left tap of each output sample, in bytes */
+    M4VIFI_UInt8    *pu8_frac;      /* weight of the right tap, 0..15 */
+    M4VIFI_UInt32   u32_count;      /* output samples per row */
+    M4VIFI_UInt32   u32_step;       /* bytes between the left and right tap */
+    M4VIFI_UInt32   u32_span;       /* source bytes read per row */
+} M4VIFI_ResizeTaps;
+
+static M4VIFI_UInt8 allocResizeTaps(M4VIFI_ResizeTaps *pTaps,
+    M4VIFI_UInt32 u32_x_accum, M4VIFI_UInt32 u32_x_inc, M4VIFI_UInt32 u32_count,
+    M4VIFI_UInt32 u32_step, M4VIFI_UInt32 u32_channels)
+{
+    M4VIFI_UInt32 i, u32_last, u32_row_size;
+    M4VIFI_UInt8 *pu8_buf;
+
+    /* The accumulator only grows, so the last sample reads furthest right */
+    u32_last = ((u32_x_accum + (u32_count - 1) * u32_x_inc) >> 16) * u32_step;
+    pTaps->u32_span = u32_last + u32_step + u32_channels;
+    pTaps->u32_count = u32_count;
+    pTaps->u32_step = u32_step;
+
+    u32_row_size = (pTaps->u32_span * sizeof(M4VIFI_UInt16) + 3) & ~3;
+    pu8_buf = (M4VIFI_UInt8 *)M4OSA_32bitAlignedMalloc(
+                  u32_row_size + u32_count * (sizeof(M4VIFI_UInt32) + 1),
+                  12420, (M4OSA_Char*)("M4VIFI_ResizeTaps"));
+    if (NULL == pu8_buf) {
+        LOGE("Error: Fail to allocate resize taps!");
+        return M4VIFI_ALLOC_FAILURE;
+    }
+    pTaps->pu16_row = (M4VIFI_UInt16 *)pu8_buf;
+    pTaps->pu32_offset = (M4VIFI_UInt32 *)(pu8_buf + u32_row_size);
+    pTaps->pu8_frac = (M4VIFI_UInt8 *)(pTaps->pu32_offset + u32_count);
+
+    for (i = 0; i < u32_count; i++) {
+        pTaps->pu32_offset[i] = (u32_x_accum >> 16) * u32_step;
+        pTaps->pu8_frac[i] = (u32_x_accum >> 12) & 15;
+        u32_x_accum += u32_x_inc;
+    }
+    return M4VIFI_OK;
+}
+
+static void freeResizeTaps(M4VIFI_ResizeTaps *pTaps)
+{
+    free(pTaps->pu16_row);
+    pTaps->pu16_row = NULL;
+}
+
+/* Blend two source rows, then interpolate u32_count samples of one channel */
+static void resizeRow(const M4VIFI_NV12Kernels *k, const M4VIFI_ResizeTaps *pTaps,
+    const M4VIFI_UInt8 *pu8_src_top, M4VIFI_UInt32 u32_stride_in,
+    M4VIFI_UInt32 u32_y_frac, M4VIFI_UInt8 *pu8_out)
+{
+    const M4VIFI_UInt16 *pu16_row = pTaps->pu16_row;
+    const M4VIFI_UInt32 *pu32_offset = pTaps->pu32_offset;
+    const M4VIFI_UInt8 *pu8_frac = pTaps->pu8_frac;
+    M4VIFI_UInt32 u32_step = pTaps->u32_step;
+    M4VIFI_UInt32 i;
+
+    k->blendRows(pu8_src_top, pu8_src_top + u32_stride_in, u32_y_frac,
+                 pTaps->pu16_row, pTaps->u32_span);
+
+    for (i = 0; i < pTaps->u32_count; i++) {
+        const M4VIFI_UInt16 *p = pu16_row + pu32_offset[i];
+        M4VIFI_UInt32 u32_x_frac = pu8_frac[i];
+
+        pu8_out[i] = (M4VIFI_UInt8)((p[0] * (16 - u32_x_frac) +
+                                     p[u32_step] * u32_x_frac) >> 8);
+    }
+}
+
+/* Same as resizeRow() for an interleaved UV row, writing interleaved UV */
+static void resizeRowUV(const M4VIFI_NV12Kernels *k, const M4VIFI_ResizeTaps *pTaps,
+    const M4VIFI_UInt8 *pu8_src_top, M4VIFI_UInt32 u32_stride_in,
+    M4VIFI_UInt32 u32_y_frac, M4VIFI_UInt8 *pu8_out)
+{
+    const M4VIFI_UInt16 *pu16_row = pTaps->pu16_row;
+    const M4VIFI_UInt32 *pu32_offset = pTaps->pu32_offset;
+    const M4VIFI_UInt8 *pu8_frac = pTaps->pu8_frac;
+    M4VIFI_UInt32 i;
+
+    k->blendRows(pu8_src_top, pu8_src_top + u32_stride_in, u32_y_frac,
+                 pTaps->pu16_row, pTaps->u32_span);
+
+    for (i = 0; i < pTaps->u32_count; i++) {
+        const M4VIFI_UInt16 *p = pu16_row + pu32_offset[i];
+        M4VIFI_UInt32 u32_x_frac = pu8_frac[i];
+
+        pu8_out[2 * i]     = (M4VIFI_UInt8)((p[0] * (16 - u32_x_frac) +
+                                             p[2] * u32_x_frac) >> 8);
+        pu8_out[2 * i + 1] = (M4VIFI_UInt8)((p[1] * (16 - u32_x_frac) +
+                                             p[3] * u32_x_frac) >> 8);
+    }
+}
+
+/**
+ * Tile-blocked transpose of u32_width x u32_height elements of u32_bpp bytes:
+ * dst[i][j] = src[j][i]. With a negative stride on either side this gives
+ * both 90 degree rotations.
+ */
+static void transposePlane(const M4VIFI_NV12Kernels *k,
+    const M4VIFI_UInt8 *pu8_src, M4VIFI_Int32 i32_src_stride,
+    M4VIFI_UInt8 *pu8_dst, M4VIFI_Int32 i32_dst_stride,
+    M4VIFI_UInt32 u32_width, M4VIFI_UInt32 u32_height, M4VIFI_UInt32 u32_bpp)
+{
+    M4VIFI_TransposeTileFct tile = (u32_bpp == 1) ? k->transpose8 : k->transpose16;
+    M4VIFI_Int32 w8 = u32_width & ~7, h8 = u32_height & ~7;
+    M4VIFI_Int32 bi, bj, i, j, i_end, j_end;
+
+    for (bi = 0; bi < w8; bi += ROTATE_BLOCK) {
+        i_end = (bi + ROTATE_BLOCK < w8) ? bi + ROTATE_BLOCK : w8;
+        for (bj = 0; bj < h8; bj += ROTATE_BLOCK) {
+            j_end = (bj + ROTATE_BLOCK < h8) ? bj + ROTATE_BLOCK : h8;
+            for (i = bi; i < i_end; i += 8) {
+                for (j = bj; j < j_end; j += 8) {
+                    tile(pu8_src + j * i32_src_stride + i * (M4VIFI_Int32)u32_bpp,
+                         i32_src_stride,
+                         pu8_dst + i * i32_dst_stride + j * (M4VIFI_Int32)u32_bpp,
+                         i32_dst_stride);
+                }
+            }
+        }
+    }
+
+    /* Right and bottom edges that do not fill a whole tile */
+    for (i = 0; i < (M4VIFI_Int32)u32_width; i++) {
+        for (j = (i < w8) ? h8 : 0; j < (M4VIFI_Int32)u32_height; j++) {
+            memcpy(pu8_dst + i * i32_dst_stride + j * (M4VIFI_Int32)u32_bpp,
+                   pu8_src + j * i32_src_stride + i * (M4VIFI_Int32)u32_bpp, u32_bpp);
+        }
+    }
+}
+
+/* Mirror a row in place, u32_count elements of u32_bpp bytes */
+static void reverseRowInPlace(M4VIFI_UInt8 *pu8_row, M4VIFI_UInt32 u32_count,
+    M4VIFI_UInt32 u32_bpp)
+{
+    M4VIFI_UInt8 *pu8_left = pu8_row;
+    M4VIFI_UInt8 *pu8_right = pu8_row + (u32_count - 1) * u32_bpp;
+    M4VIFI_UInt8 u8_tmp;
+    M4VIFI_UInt32 i, j;
+
+    for (i = u32_count >> 1; i != 0; i--) {
+        for (j = 0; j < u32_bpp; j++) {
+            u8_tmp = pu8_left[j];
+            pu8_left[j] = pu8_right[j];
+            pu8_right[j] = u8_tmp;
+        }
+        pu8_left += u32_bpp;
+        pu8_right -= u32_bpp;
+    }
+}
+
+/**
+ * Swap two distinct rows while mirroring them, working in chunks so no row
+ * sized buffer is needed: the first n elements of the top row exchange with
+ * the last n elements of the bottom row, and so on.
+ */
+static void reverseSwapRows(const M4VIFI_NV12Kernels *k, M4VIFI_UInt8 *pu8_top,
+    M4VIFI_UInt8 *pu8_bottom, M4VIFI_UInt32 u32_count, M4VIFI_UInt32 u32_bpp)
+{
+    M4VIFI_ReverseRowFct reverse = (u32_bpp == 1) ? k->reverse8 : k->reverse16;
+    M4VIFI_UInt8 au8_tmp[REVERSE_CHUNK * 2];
+    M4VIFI_UInt32 u32_chunk = REVERSE_CHUNK * 2 / u32_bpp;
+    M4VIFI_UInt32 a, n;
+
+    for (a = 0; a < u32_count; a += n) {
+        M4VIFI_UInt8 *pu8_left = pu8_top + a * u32_bpp;
+        M4VIFI_UInt8 *pu8_right;
+
+        n = (u32_count - a < u32_chunk) ? u32_count - a : u32_chunk;
+        pu8_right = pu8_bottom + (u32_count - a - n) * u32_bpp;
+
+        reverse(pu8_left, au8_tmp, n);
+        reverse(pu8_right, pu8_left, n);
+        memcpy(pu8_right, au8_tmp, n * u32_bpp);
+    }
+}
+
+/**
+ ***********************************************************************************************
+ * M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toYUV420_X86(void *pUserData, M4VIFI_ImagePlane *pPlaneIn,
  *                                                                  M4VIFI_ImagePlane *pPlaneOut)
  * @author  David Dana (PHILIPS Software)
- * @brief   Resizes YUV420 Planar plane.
+ * @brief   Resizes a NV12 plane into a YUV420 Planar plane.
  * @note    Basic structure of the function
- *          Loop on each row (step 2)
- *              Loop on each column (step 2)
- *                  Get four Y samples and 1 U & V sample
- *                  Resize the Y with corresponing U and V samples
- *                  Place the YUV in the ouput plane
- *              end loop column
- *          end loop row
+ *          Loop on each output plane
+ *              Loop on each row
+ *                  Blend the two nearest source rows (SIMD)
+ *                  Interpolate each output sample from the blended row
+ *              end loop row
+ *          end loop plane
  *          For resizing bilinear interpolation linearly interpolates along
  *          each row, and then uses that result in a linear interpolation down each column.
  *          Each estimated pixel in the output image is a weighted
  *          combination of its four neighbours. The ratio of compression
  *          or dilatation is estimated using input and output sizes.
+ *          U and V are read straight from the interleaved NV12 chroma plane,
+ *          so no intermediate planar copy of the input is needed.
  * @param   pUserData: (IN) User Data
- * @param   pPlaneIn: (IN) Pointer to YUV420 (Planar) plane buffer
+ * @param   pPlaneIn: (IN) Pointer to NV12 (Semiplanar) plane buffer
  * @param   pPlaneOut: (OUT) Pointer to YUV420 (Planar) plane
  * @return  M4VIFI_OK: there is no error
  * @return  M4VIFI_ILLEGAL_FRAME_HEIGHT: Error in height
  * @return  M4VIFI_ILLEGAL_FRAME_WIDTH:  Error in width
+ * @return  M4VIFI_ALLOC_FAILURE: No memory for the resize taps
  ***********************************************************************************************
 */
 
-static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
+static M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toYUV420_X86(void *pUserData,
     M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut)
 {
+    const M4VIFI_NV12Kernels *k = getKernels();
+    M4VIFI_ResizeTaps taps;
     M4VIFI_UInt8    *pu8_data_in, *pu8_data_out, *pu8dum;
     M4VIFI_UInt32   u32_plane;
     M4VIFI_UInt32   u32_width_in, u32_width_out, u32_height_in, u32_height_out;
-    M4VIFI_UInt32   u32_stride_in, u32_stride_out;
+    M4VIFI_UInt32   u32_stride_in, u32_stride_out, u32_step_in;
     M4VIFI_UInt32   u32_x_inc, u32_y_inc;
-    M4VIFI_UInt32   u32_x_accum, u32_y_accum, u32_x_accum_start;
-    M4VIFI_UInt32   u32_width, u32_height;
+    M4VIFI_UInt32   u32_y_accum, u32_x_accum_start;
+    M4VIFI_UInt32   u32_height;
     M4VIFI_UInt32   u32_y_frac;
-    M4VIFI_UInt32   u32_x_frac;
-    M4VIFI_UInt32   u32_temp_value;
-    M4VIFI_UInt8    *pu8_src_top;
-    M4VIFI_UInt8    *pu8_src_bottom;
+    M4VIFI_UInt32   u32_temp_value = 0;
+    M4VIFI_UInt8    u8_err;
 
     M4VIFI_UInt8    u8Wflag = 0;
     M4VIFI_UInt8    u8Hflag = 0;
@@ -103,12 +636,28 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
 
     /*
      If input width is equal to output width and input height equal to
-     output height then M4VIFI_YUV420toYUV420 is called.
+     output height, the planes are only copied and deinterleaved.
     */
     if ((pPlaneIn[0].u_height == pPlaneOut[0].u_height) &&
               (pPlaneIn[0].u_width == pPlaneOut[0].u_width))
     {
-        return M4VIFI_YUV420toYUV420(pUserData, pPlaneIn, pPlaneOut);
+        pu8_data_in = pPlaneIn[0].pac_data + pPlaneIn[0].u_topleft;
+        pu8_data_out = pPlaneOut[0].pac_data + pPlaneOut[0].u_topleft;
+        for (loop = 0; loop < pPlaneOut[0].u_height; loop++) {
+            memcpy((void *)pu8_data_out, (void *)pu8_data_in, pPlaneOut[0].u_width);
+            pu8_data_in += pPlaneIn[0].u_stride;
+            pu8_data_out += pPlaneOut[0].u_stride;
+        }
+
+        pu8_data_in = pPlaneIn[1].pac_data + pPlaneIn[1].u_topleft;
+        for (loop = 0; loop < pPlaneOut[1].u_height; loop++) {
+            k->deinterleave(pu8_data_in,
+                pPlaneOut[1].pac_data + pPlaneOut[1].u_topleft + loop * pPlaneOut[1].u_stride,
+                pPlaneOut[2].pac_data + pPlaneOut[2].u_topleft + loop * pPlaneOut[2].u_stride,
+                pPlaneOut[1].u_width);
+            pu8_data_in += pPlaneIn[1].u_stride;
+        }
+        return M4VIFI_OK;
     }
 
     /* Check for the YUV width and height are even */
@@ -128,17 +677,23 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
     for(u32_plane = 0;u32_plane < PLANES;u32_plane++)
     {
         /* Set the working pointers at the beginning of the input/output data field */
-        pu8_data_in     = pPlaneIn[u32_plane].pac_data + pPlaneIn[u32_plane].u_topleft;
+        if (u32_plane == 0) {
+            pu8_data_in = pPlaneIn[0].pac_data + pPlaneIn[0].u_topleft;
+            u32_stride_in = pPlaneIn[0].u_stride;
+            u32_width_in = pPlaneIn[0].u_width;
+            u32_height_in = pPlaneIn[0].u_height;
+            u32_step_in = 1;
+        } else {
+            /* U at even bytes and V at odd bytes of the NV12 chroma plane */
+            pu8_data_in = pPlaneIn[1].pac_data + pPlaneIn[1].u_topleft + (u32_plane - 1);
+            u32_stride_in = pPlaneIn[1].u_stride;
+            u32_width_in = pPlaneIn[0].u_width >> 1;
+            u32_height_in = pPlaneIn[0].u_height >> 1;
+            u32_step_in = 2;
+        }
         pu8_data_out    = pPlaneOut[u32_plane].pac_data + pPlaneOut[u32_plane].u_topleft;
-
-        /* Get the memory jump corresponding to a row jump */
-        u32_stride_in   = pPlaneIn[u32_plane].u_stride;
         u32_stride_out  = pPlaneOut[u32_plane].u_stride;
 
-        /* Set the bounds of the active image */
-        u32_width_in    = pPlaneIn[u32_plane].u_width;
-        u32_height_in   = pPlaneIn[u32_plane].u_height;
-
         u32_width_out   = pPlaneOut[u32_plane].u_width;
         u32_height_out  = pPlaneOut[u32_plane].u_height;
 
@@ -228,6 +783,13 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
             u32_x_accum_start = 0;
         }
 
+        u8_err = allocResizeTaps(&taps, u32_x_accum_start, u32_x_inc,
+                                 u32_width_out, u32_step_in, 1);
+        if (u8_err != M4VIFI_OK)
+        {
+            return u8_err;
+        }
+
         u32_height = u32_height_out;
 
         /*
@@ -246,27 +808,9 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
             /* Vertical weight factor */
             u32_y_frac = (u32_y_accum>>12)&15;
 
-            /* Reinit accumulator */
-            u32_x_accum = u32_x_accum_start;
-
-            u32_width = u32_width_out;
-
-            do { /* Scan along each row */
-                pu8_src_top = pu8_data_in + (u32_x_accum >> 16);
-                pu8_src_bottom = pu8_src_top + u32_stride_in;
-                u32_x_frac = (u32_x_accum >> 12)&15; /* Horizontal weight factor */
-
-                /* Weighted combination */
-                u32_temp_value = (M4VIFI_UInt8)(((pu8_src_top[0]*(16-u32_x_frac) +
-                                                 pu8_src_top[1]*u32_x_frac)*(16-u32_y_frac) +
-                                                (pu8_src_bottom[0]*(16-u32_x_frac) +
-                                                 pu8_src_bottom[1]*u32_x_frac)*u32_y_frac )>>8);
-
-                *pu8_data_out++ = (M4VIFI_UInt8)u32_temp_value;
-
-                /* Update horizontal accumulator */
-                u32_x_accum += u32_x_inc;
-            } while(--u32_width);
+            resizeRow(k, &taps, pu8_data_in, u32_stride_in, u32_y_frac, pu8_data_out);
+            pu8_data_out += u32_width_out;
+            u32_temp_value = pu8_data_out[-1];
 
             /*
                This u8Wflag flag gets in to effect if input and output
@@ -294,10 +838,10 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
         replicated here
         */
         if (u8Hflag) {
-            for(loop =0; loop < (u32_width_out+u8Wflag); loop++) {
-                *pu8_data_out++ = (M4VIFI_UInt8)*pu8dum++;
-            }
+            memcpy((void *)pu8_data_out, (void *)pu8dum, u32_width_out + u8Wflag);
         }
+
+        freeResizeTaps(&taps);
     }
 
     return M4VIFI_OK;
@@ -306,7 +850,8 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
 /**
  *********************************************************************************************
  * M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toBGR565_X86(void *pContext, M4VIFI_ImagePlane *pPlaneIn,
- *                                                        M4VIFI_ImagePlane *pPlaneOut)
+ *                                                        M4VIFI_ImagePlane *pPlaneOut,
+ *                                                        M4VIFI_UInt32 u32_uv_step)
  * @brief   Resize YUV420 plane and converts to BGR565 with +90 rotation.
  * @note    Basic sturture of the function
  *          Loop on each row (step 2)
@@ -325,13 +870,15 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toYUV420_X86(void *pUserData,
  * @param   pPlaneIn: (IN) Pointer to YUV plane buffer
  * @param   pContext: (IN) Context Pointer
  * @param   pPlaneOut: (OUT) Pointer to BGR565 Plane
+ * @param   u32_uv_step: (IN) Bytes between two chroma samples of a row, 1 for
+ *                            planar input, 2 when U and V point into a NV12 plane
  * @return  M4VIFI_OK: there is no error
  * @return  M4VIFI_ILLEGAL_FRAME_HEIGHT: YUV Plane height is ODD
  * @return  M4VIFI_ILLEGAL_FRAME_WIDTH:  YUV Plane width is ODD
  *********************************************************************************************
 */
 static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toBGR565_X86(void* pContext,
-    M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut)
+    M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut, M4VIFI_UInt32 u32_uv_step)
 {
     M4VIFI_UInt8    *pu8_data_in[PLANES], *pu8_data_in1[PLANES],*pu8_data_out;
     M4VIFI_UInt32   *pu32_rgb_data_current, *pu32_rgb_data_next, *pu32_rgb_data_start;
@@ -534,10 +1081,10 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toBGR565_X86(void* pContext,
             pu8_src_bottom_Y = pu8_src_top_Y + u32_stride_in[YPlane];
 
             /* Input U Plane elements */
-            pu8_src_top_U = pu8_data_in[UPlane] + (u32_x_accum_U >> 16);
+            pu8_src_top_U = pu8_data_in[UPlane] + (u32_x_accum_U >> 16) * u32_uv_step;
             pu8_src_bottom_U = pu8_src_top_U + u32_stride_in[UPlane];
 
-            pu8_src_top_V = pu8_data_in[VPlane] + (u32_x_accum_U >> 16);
+            pu8_src_top_V = pu8_data_in[VPlane] + (u32_x_accum_U >> 16) * u32_uv_step;
             pu8_src_bottom_V = pu8_src_top_V + u32_stride_in[VPlane];
 
             /* Horizontal weight factor for Y plane */
@@ -546,13 +1093,13 @@ static M4VIFI_UInt8 M4VIFI_ResizeBilinearYUV420toBGR565_X86(void* pContext,
             u32_x_frac_U = (u32_x_accum_U >> 12)&15;
 
             /* Weighted combination */
-            U_32 = (((pu8_src_top_U[0]*(16-u32_x_frac_U) + pu8_src_top_U[1]*u32_x_frac_U)
+            U_32 = (((pu8_src_top_U[0]*(16-u32_x_frac_U) + pu8_src_top_U[u32_uv_step]*u32_x_frac_U)
                     *(16-u32_y_frac_U) + (pu8_src_bottom_U[0]*(16-u32_x_frac_U)
-                    + pu8_src_bottom_U[1]*u32_x_frac_U)*u32_y_frac_U ) >> 8);
+                    + pu8_src_bottom_U[u32_uv_step]*u32_x_frac_U)*u32_y_frac_U ) >> 8);
 
-            V_32 = (((pu8_src_top_V[0]*(16-u32_x_frac_U) + pu8_src_top_V[1]*u32_x_frac_U)
+            V_32 = (((pu8_src_top_V[0]*(16-u32_x_frac_U) + pu8_src_top_V[u32_uv_step]*u32_x_frac_U)
                     *(16-u32_y_frac_U)+ (pu8_src_bottom_V[0]*(16-u32_x_frac_U)
-                    + pu8_src_bottom_V[1]*u32_x_frac_U)*u32_y_frac_U ) >> 8);
+                    + pu8_src_bottom_V[u32_uv_step]*u32_x_frac_U)*u32_y_frac_U ) >> 8);
 
             Y_32 = (((pu8_src_top_Y[0]*(16-u32_x_frac_Y) + pu8_src_top_Y[1]*u32_x_frac_Y)
                     *(16-u32_y_frac_Y) + (pu8_src_bottom_Y[0]*(16-u32_x_frac_Y)
@@ -889,18 +1436,18 @@ M4VIFI_UInt8 M4VIFI_NV12toNV12(void *user_data,
 M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toNV12(void *pUserData,
     M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut)
 {
+    const M4VIFI_NV12Kernels *k = getKernels();
+    M4VIFI_ResizeTaps taps;
     M4VIFI_UInt8    *pu8_data_in, *pu8_data_out, *pu8dum;
     M4VIFI_UInt32   u32_plane;
     M4VIFI_UInt32   u32_width_in, u32_width_out, u32_height_in, u32_height_out;
     M4VIFI_UInt32   u32_stride_in, u32_stride_out;
     M4VIFI_UInt32   u32_x_inc, u32_y_inc;
-    M4VIFI_UInt32   u32_x_accum, u32_y_accum, u32_x_accum_start;
-    M4VIFI_UInt32   u32_width, u32_height;
+    M4VIFI_UInt32   u32_y_accum, u32_x_accum_start;
+    M4VIFI_UInt32   u32_height;
     M4VIFI_UInt32   u32_y_frac;
-    M4VIFI_UInt32   u32_x_frac;
     M4VIFI_UInt32   u32_temp_value,u32_temp_value1;
-    M4VIFI_UInt8    *pu8_src_top;
-    M4VIFI_UInt8    *pu8_src_bottom;
+    M4VIFI_UInt8    u8_err;
 
     M4VIFI_UInt8    u8Wflag = 0;
     M4VIFI_UInt8    u8Hflag = 0;
@@ -1042,6 +1589,22 @@ M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toNV12(void *pUserData,
             u32_x_accum_start = 0;
         }
 
+        /* One tap per Y sample, or per UV pair on the chroma plane */
+        if (u32_plane == 0)
+        {
+            u8_err = allocResizeTaps(&taps, u32_x_accum_start, u32_x_inc,
+                                     u32_width_out, 1, 1);
+        }
+        else
+        {
+            u8_err = allocResizeTaps(&taps, u32_x_accum_start, u32_x_inc,
+                                     u32_width_out >> 1, 2, 2);
+        }
+        if (u8_err != M4VIFI_OK)
+        {
+            return u8_err;
+        }
+
         u32_height = u32_height_out;
 
         /*
@@ -1066,27 +1629,9 @@ M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toNV12(void *pUserData,
                 /* Vertical weight factor */
                 u32_y_frac = (u32_y_accum>>12)&15;
 
-                /* Reinit accumulator */
-                u32_x_accum = u32_x_accum_start;
-
-                u32_width = u32_width_out;
-
-                do { /* Scan along each row */
-                    pu8_src_top = pu8_data_in + (u32_x_accum >> 16);
-                    pu8_src_bottom = pu8_src_top + u32_stride_in;
-                    u32_x_frac = (u32_x_accum >> 12)&15; /* Horizontal weight factor */
-
-                    /* Weighted combination */
-                    u32_temp_value = (M4VIFI_UInt8)(((pu8_src_top[0]*(16-u32_x_frac) +
-                                                     pu8_src_top[1]*u32_x_frac)*(16-u32_y_frac) +
-                                                    (pu8_src_bottom[0]*(16-u32_x_frac) +
-                                                     pu8_src_bottom[1]*u32_x_frac)*u32_y_frac )>>8);
-
-                    *pu8_data_out++ = (M4VIFI_UInt8)u32_temp_value;
-
-                    /* Update horizontal accumulator */
-                    u32_x_accum += u32_x_inc;
-                } while(--u32_width);
+                resizeRow(k, &taps, pu8_data_in, u32_stride_in, u32_y_frac, pu8_data_out);
+                pu8_data_out += u32_width_out;
+                u32_temp_value = pu8_data_out[-1];
 
                 /*
                    This u8Wflag flag gets in to effect if input and output
@@ -1128,37 +1673,11 @@ M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toNV12(void *pUserData,
                 /* Vertical weight factor */
                 u32_y_frac = (u32_y_accum>>12)&15;
 
-                /* Reinit accumulator */
-                u32_x_accum = u32_x_accum_start;
-
-                u32_width = u32_width_out;
-
-                do { /* Scan along each row */
-                    pu8_src_top = pu8_data_in + ((u32_x_accum >> 16) << 1);
-                    pu8_src_bottom = pu8_src_top + u32_stride_in;
-                    u32_x_frac = (u32_x_accum >> 12)&15;
-
-                    /* U planar weighted combination */
-                    u32_temp_value1 = (M4VIFI_UInt8)(((pu8_src_top[0]*(16-u32_x_frac) +
-                                                 pu8_src_top[2]*u32_x_frac)*(16-u32_y_frac) +
-                                                (pu8_src_bottom[0]*(16-u32_x_frac) +
-                                                 pu8_src_bottom[2]*u32_x_frac)*u32_y_frac )>>8);
-                    *pu8_data_out++ = (M4VIFI_UInt8)u32_temp_value1;
-
-                    pu8_src_top = pu8_src_top + 1;
-                    pu8_src_bottom = pu8_src_bottom + 1;
-
-                    /* V planar weighted combination */
-                    u32_temp_value = (M4VIFI_UInt8)(((pu8_src_top[0]*(16-u32_x_frac) +
-                                                 pu8_src_top[2]*u32_x_frac)*(16-u32_y_frac) +
-                                                (pu8_src_bottom[0]*(16-u32_x_frac) +
-                                                 pu8_src_bottom[2]*u32_x_frac)*u32_y_frac )>>8);
-                    *pu8_data_out++ = (M4VIFI_UInt8)u32_temp_value;
-
-                    /* Update horizontal accumulator */
-                    u32_x_accum += u32_x_inc;
-                    u32_width -= 2;
-                } while(u32_width);
+                /* U and V planar weighted combination */
+                resizeRowUV(k, &taps, pu8_data_in, u32_stride_in, u32_y_frac, pu8_data_out);
+                pu8_data_out += u32_width_out;
+                u32_temp_value1 = pu8_data_out[-2];
+                u32_temp_value = pu8_data_out[-1];
 
                 /*
                    This u8Wflag flag gets in to effect if input and output
@@ -1190,276 +1709,161 @@ M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toNV12(void *pUserData,
                 memcpy((void *)pu8_data_out,(void *)pu8dum,u32_width_out+u8Wflag+1);
             }
         }
+
+        freeResizeTaps(&taps);
     }
     LOGV("M4VIFI_ResizeBilinearNV12toNV12 end");
     return M4VIFI_OK;
 }
 
+/**
+ *******************************************************************************************
+ * M4VIFI_UInt8 M4VIFI_Rotate90LeftNV12toNV12 (void *pUserData,
+ *                                                 M4VIFI_ImagePlane *pPlaneIn,
+ *                                                 M4VIFI_ImagePlane *pPlaneOut)
+ * @brief   Rotates a NV12 image by -90 degrees.
+ * @note    Both planes are transposed in 8x8 tiles (UV pairs move as one
+ *          element), walking the output through ROTATE_BLOCK sized blocks so
+ *          the input rows of a block stay in cache.
+ * @param   pUserData: (IN) User Specific Data (Unused - could be NULL)
+ * @param   pPlaneIn: (IN) Pointer to NV12 plane buffer
+ * @param   pPlaneOut: (OUT) Pointer to NV12 Plane, must not overlap the input
+ * @return  M4VIFI_OK: there is no error
+ *******************************************************************************************
+ */
 M4VIFI_UInt8 M4VIFI_Rotate90LeftNV12toNV12(void* pUserData,
     M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut)
 {
+    const M4VIFI_NV12Kernels *k = getKernels();
     M4VIFI_Int32 plane_number;
-    M4VIFI_UInt32 i,j, u_stride;
+    M4VIFI_UInt32 u_bpp;
     M4VIFI_UInt8 *p_buf_src, *p_buf_dest;
 
-    /**< Loop on Y,U and V planes */
+    /**< Loop on Y and UV planes */
     for (plane_number = 0; plane_number < 2; plane_number++) {
-        /**< Get adresses of first valid pixel in input and output buffer */
-        /**< As we have a -90. rotation, first needed pixel is the upper-right one */
-        if (plane_number == 0) {
-            p_buf_src =
-                &(pPlaneIn[plane_number].pac_data[pPlaneIn[plane_number].u_topleft]) +
-                 pPlaneOut[plane_number].u_height - 1 ;
-            p_buf_dest =
-                &(pPlaneOut[plane_number].pac_data[pPlaneOut[plane_number].u_topleft]);
-            u_stride = pPlaneIn[plane_number].u_stride;
-            /**< Loop on output rows */
-            for (i = pPlaneOut[plane_number].u_height; i != 0; i--) {
-                /**< Loop on all output pixels in a row */
-                for (j = pPlaneOut[plane_number].u_width; j != 0; j--) {
-                    *p_buf_dest++= *p_buf_src;
-                    p_buf_src += u_stride;  /**< Go to the next row */
-                }
-
-                /**< Go on next row of the output frame */
-                p_buf_dest +=
-                    pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                /**< Go to next pixel in the last row of the input frame*/
-                p_buf_src -=
-                    pPlaneIn[plane_number].u_stride * pPlaneOut[plane_number].u_width + 1 ;
-            }
-        } else {
-            p_buf_src =
-                &(pPlaneIn[plane_number].pac_data[pPlaneIn[plane_number].u_topleft]) +
-                 pPlaneIn[plane_number].u_width - 2 ;
-            p_buf_dest =
-                &(pPlaneOut[plane_number].pac_data[pPlaneOut[plane_number].u_topleft]);
-            u_stride = pPlaneIn[plane_number].u_stride;
-            /**< Loop on output rows */
-            for (i = pPlaneOut[plane_number].u_height; i != 0 ; i--) {
-                /**< Loop on all output pixels in a row */
-                for (j = (pPlaneOut[plane_number].u_width >> 1); j != 0 ; j--) {
-                    *p_buf_dest++= *p_buf_src++;
-                    *p_buf_dest++= *p_buf_src--;
-                    p_buf_src += u_stride;  /**< Go to the next row */
-                }
+        u_bpp = plane_number + 1;
+        p_buf_src =
+            &(pPlaneIn[plane_number].pac_data[pPlaneIn[plane_number].u_topleft]);
+        /**< As we have a -90 rotation, the first input column is the last output row */
+        p_buf_dest =
+            &(pPlaneOut[plane_number].pac_data[pPlaneOut[plane_number].u_topleft]) +
+             pPlaneOut[plane_number].u_stride * (pPlaneOut[plane_number].u_height - 1);
 
-                /**< Go on next row of the output frame */
-                p_buf_dest +=
-                    pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                /**< Go to next pixel in the last row of the input frame*/
-                p_buf_src -=
-                    pPlaneIn[plane_number].u_stride * pPlaneIn[plane_number].u_height + 2 ;
-            }
-        }
+        transposePlane(k, p_buf_src, (M4VIFI_Int32)pPlaneIn[plane_number].u_stride,
+            p_buf_dest, -(M4VIFI_Int32)pPlaneOut[plane_number].u_stride,
+            pPlaneOut[plane_number].u_height,
+            pPlaneOut[plane_number].u_width / u_bpp, u_bpp);
     }
 
     return M4VIFI_OK;
 }
 
+/**
+ *******************************************************************************************
+ * M4VIFI_UInt8 M4VIFI_Rotate90RightNV12toNV12 (void *pUserData,
+ *                                                  M4VIFI_ImagePlane *pPlaneIn,
+ *                                                  M4VIFI_ImagePlane *pPlaneOut)
+ * @brief   Rotates a NV12 image by +90 degrees.
+ * @note    Same tiling as M4VIFI_Rotate90LeftNV12toNV12, reading the input
+ *          bottom-up instead of writing the output bottom-up.
+ * @param   pUserData: (IN) User Specific Data (Unused - could be NULL)
+ * @param   pPlaneIn: (IN) Pointer to NV12 plane buffer
+ * @param   pPlaneOut: (OUT) Pointer to NV12 Plane, must not overlap the input
+ * @return  M4VIFI_OK: there is no error
+ *******************************************************************************************
+ */
 M4VIFI_UInt8 M4VIFI_Rotate90RightNV12toNV12(void* pUserData,
     M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut)
 {
+    const M4VIFI_NV12Kernels *k = getKernels();
     M4VIFI_Int32 plane_number;
-    M4VIFI_UInt32 i,j, u_stride;
+    M4VIFI_UInt32 u_bpp;
     M4VIFI_UInt8 *p_buf_src, *p_buf_dest;
 
-    /**< Loop on Y,U and V planes */
+    /**< Loop on Y and UV planes */
     for (plane_number = 0; plane_number < 2; plane_number++) {
-        /**< Get adresses of first valid pixel in input and output buffer */
+        u_bpp = plane_number + 1;
         /**< As we have a +90 rotation, first needed pixel is the left-down one */
         p_buf_src =
             &(pPlaneIn[plane_number].pac_data[pPlaneIn[plane_number].u_topleft]) +
              (pPlaneIn[plane_number].u_stride * (pPlaneIn[plane_number].u_height - 1));
         p_buf_dest =
             &(pPlaneOut[plane_number].pac_data[pPlaneOut[plane_number].u_topleft]);
-        u_stride = pPlaneIn[plane_number].u_stride;
-        if (plane_number == 0) {
-           /**< Loop on output rows */
-           for (i = pPlaneOut[plane_number].u_height; i != 0 ; i--) {
-                /**< Loop on all output pixels in a row */
-                for (j = pPlaneOut[plane_number].u_width; j != 0 ; j--) {
-                     *p_buf_dest++= *p_buf_src;
-                     p_buf_src -= u_stride;  /**< Go to the previous row */
-                }
 
-                /**< Go on next row of the output frame */
-                p_buf_dest +=
-                    pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                /**< Go to next pixel in the last row of the input frame*/
-                p_buf_src +=
-                    pPlaneIn[plane_number].u_stride * pPlaneOut[plane_number].u_width + 1 ;
-            }
-        } else {
-            /**< Loop on output rows */
-            for (i = pPlaneOut[plane_number].u_height; i != 0 ; i--) {
-                /**< Loop on all output pixels in a row */
-                for (j = (pPlaneOut[plane_number].u_width >> 1); j != 0 ; j--) {
-                     *p_buf_dest++= *p_buf_src++;
-                     *p_buf_dest++= *p_buf_src--;
-                     p_buf_src -= u_stride;  /**< Go to the previous row */
-                }
-
-                /**< Go on next row of the output frame */
-                p_buf_dest +=
-                    pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                /**< Go to next pixel in the last row of the input frame*/
-                p_buf_src +=
-                    pPlaneIn[plane_number].u_stride * pPlaneIn[plane_number].u_height + 2 ;
-            }
-        }
+        transposePlane(k, p_buf_src, -(M4VIFI_Int32)pPlaneIn[plane_number].u_stride,
+            p_buf_dest, (M4VIFI_Int32)pPlaneOut[plane_number].u_stride,
+            pPlaneOut[plane_number].u_height,
+            pPlaneOut[plane_number].u_width / u_bpp, u_bpp);
     }
 
     return M4VIFI_OK;
 }
 
+/**
+ *******************************************************************************************
+ * M4VIFI_UInt8 M4VIFI_Rotate180NV12toNV12 (void *pUserData,
+ *                                              M4VIFI_ImagePlane *pPlaneIn,
+ *                                              M4VIFI_ImagePlane *pPlaneOut)
+ * @brief   Rotates a NV12 image by 180 degrees.
+ * @note    Each output row is the mirrored opposite input row (UV pairs move
+ *          as one element). pPlaneIn may equal pPlaneOut, in which case rows
+ *          are swapped pairwise in place.
+ * @param   pUserData: (IN) User Specific Data (Unused - could be NULL)
+ * @param   pPlaneIn: (IN) Pointer to NV12 plane buffer
+ * @param   pPlaneOut: (OUT) Pointer to NV12 Plane
+ * @return  M4VIFI_OK: there is no error
+ *******************************************************************************************
+ */
 M4VIFI_UInt8 M4VIFI_Rotate180NV12toNV12(void* pUserData,
     M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut)
 {
+    const M4VIFI_NV12Kernels *k = getKernels();
     M4VIFI_Int32 plane_number;
-    M4VIFI_UInt32 i,j;
-    M4VIFI_UInt8 *p_buf_src, *p_buf_dest, temp_pix1;
-    M4VIFI_UInt16 *p16_buf_src, *p16_buf_dest, temp_pix2;
+    M4VIFI_UInt32 i, u_bpp, u_count, u_height;
+    M4VIFI_UInt8 *p_buf_src, *p_buf_dest;
+    M4VIFI_ReverseRowFct reverse;
 
-    /**< Loop on Y,U and V planes */
+    /**< Loop on Y and UV planes */
     for (plane_number = 0; plane_number < 2; plane_number++) {
+        u_bpp = plane_number + 1;
+        u_count = pPlaneOut[plane_number].u_width / u_bpp;
+        u_height = pPlaneOut[plane_number].u_height;
+        reverse = (u_bpp == 1) ? k->reverse8 : k->reverse16;
+
         /**< Get adresses of first valid pixel in input and output buffer */
         p_buf_src =
             &(pPlaneIn[plane_number].pac_data[pPlaneIn[plane_number].u_topleft]);
         p_buf_dest =
             &(pPlaneOut[plane_number].pac_data[pPlaneOut[plane_number].u_topleft]);
 
-        if (plane_number == 0) {
-            /**< If pPlaneIn = pPlaneOut, the algorithm will be different */
-            if (p_buf_src == p_buf_dest) {
-                /**< Get Address of last pixel in the last row of the frame */
-                p_buf_dest +=
-                    pPlaneOut[plane_number].u_stride*(pPlaneOut[plane_number].u_height-1) +
-                     pPlaneOut[plane_number].u_width - 1;
-
-                /**< We loop (height/2) times on the rows.
-                 * In case u_height is odd, the row at the middle of the frame
-                 * has to be processed as must be mirrored */
-                for (i = (pPlaneOut[plane_number].u_height>>1); i != 0; i--) {
-                    for (j = pPlaneOut[plane_number].u_width; j != 0 ; j--) {
-                        temp_pix1= *p_buf_dest;
-                        *p_buf_dest--= *p_buf_src;
-                        *p_buf_src++ = temp_pix1;
-                    }
-                    /**< Go on next row in top of frame */
-                    p_buf_src +=
-                        pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                    /**< Go to the last pixel in previous row in bottom of frame*/
-                    p_buf_dest -=
-                        pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                }
+        /**< If pPlaneIn = pPlaneOut, the algorithm will be different */
+        if (p_buf_src == p_buf_dest) {
+            /**< Swap row i with row (height - 1 - i), mirroring both */
+            for (i = 0; i < (u_height >> 1); i++) {
+                reverseSwapRows(k,
+                    p_buf_dest + i * pPlaneOut[plane_number].u_stride,
+                    p_buf_dest + (u_height - 1 - i) * pPlaneOut[plane_number].u_stride,
+                    u_count, u_bpp);
+            }
 
-                /**< Mirror middle row in case height is odd */
-                if ((pPlaneOut[plane_number].u_height%2)!= 0) {
-                    p_buf_src =
-                        &(pPlaneOut[plane_number].pac_data[pPlaneIn[plane_number].u_topleft]);
-                    p_buf_src +=
-                        pPlaneOut[plane_number].u_stride*(pPlaneOut[plane_number].u_height>>1);
-                    p_buf_dest =
-                        p_buf_src + pPlaneOut[plane_number].u_width;
-
-                    /**< We loop u_width/2 times on this row.
-                     *  In case u_width is odd, the pixel at the middle of this row
-                     * remains unchanged */
-                    for (j = (pPlaneOut[plane_number].u_width>>1); j != 0 ; j--) {
-                        temp_pix1= *p_buf_dest;
-                        *p_buf_dest--= *p_buf_src;
-                        *p_buf_src++ = temp_pix1;
-                    }
-                }
-            } else {
-                /**< Get Address of last pixel in the last row of the output frame */
-                p_buf_dest +=
-                    pPlaneOut[plane_number].u_stride*(pPlaneOut[plane_number].u_height-1) +
-                    pPlaneIn[plane_number].u_width - 1;
-
-                /**< Loop on rows */
-                for (i = pPlaneOut[plane_number].u_height; i != 0 ; i--) {
-                    for (j = pPlaneOut[plane_number].u_width; j != 0 ; j--) {
-                        *p_buf_dest--= *p_buf_src++;
-                    }
-
-                    /**< Go on next row in top of input frame */
-                    p_buf_src +=
-                        pPlaneIn[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                    /**< Go to last pixel of previous row in bottom of input frame*/
-                    p_buf_dest -=
-                        pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width;
-                }
+            /**< Mirror middle row in case height is odd */
+            if ((u_height % 2) != 0) {
+                reverseRowInPlace(
+                    p_buf_dest + (u_height >> 1) * pPlaneOut[plane_number].u_stride,
+                    u_count, u_bpp);
             }
         } else {
-            /**< If pPlaneIn = pPlaneOut, the algorithm will be different */
-            if (p_buf_src == p_buf_dest) {
-                p16_buf_src = (M4VIFI_UInt16 *)p_buf_src;
-                p16_buf_dest = (M4VIFI_UInt16 *)p_buf_dest;
-                /**< Get Address of last pixel in the last row of the frame */
-                p16_buf_dest +=
-                    ((pPlaneOut[plane_number].u_stride*(pPlaneOut[plane_number].u_height-1) +
-                     pPlaneOut[plane_number].u_width)>>1) - 1;
-
-                /**< We loop (height/2) times on the rows.
-                 * In case u_height is odd, the row at the middle of the frame
-                 * has to be processed as must be mirrored */
-                for (i = (pPlaneOut[plane_number].u_height >> 1); i != 0 ; i--) {
-                    for (j = (pPlaneOut[plane_number].u_width >> 1); j != 0 ; j--) {
-                        temp_pix2 = *p16_buf_dest;
-                        *p16_buf_dest--= *p16_buf_src;
-                        *p16_buf_src++ = temp_pix2;
-                    }
-                    /**< Go on next row in top of frame */
-                    p16_buf_src +=
-                        ((pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width)>>1);
-                    /**< Go to the last pixel in previous row in bottom of frame*/
-                    p16_buf_dest -=
-                        ((pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width)>>1);
-                }
+            /**< Start from the last row of the output frame */
+            p_buf_dest += pPlaneOut[plane_number].u_stride * (u_height - 1);
 
-                /**< Mirror middle row in case height is odd */
-                if ((pPlaneOut[plane_number].u_height%2)!= 0) {
-                    p_buf_src =
-                        &(pPlaneOut[plane_number].pac_data[pPlaneIn[plane_number].u_topleft]);
-                    p_buf_src +=
-                        pPlaneOut[plane_number].u_stride*(pPlaneOut[plane_number].u_height>>1);
-                    p16_buf_src = (M4VIFI_UInt16 *)p_buf_src;
-                    p_buf_dest =
-                        p_buf_src + pPlaneOut[plane_number].u_width - 1;
-                    p16_buf_dest = (M4VIFI_UInt16 *)p_buf_dest;
-
-                    /**< We loop u_width/2 times on this row.
-                     *  In case u_width is odd, the pixel at the middle of this row
-                     * remains unchanged */
-                    for (j = (pPlaneOut[plane_number].u_width>>2); j != 0 ; j--) {
-                        temp_pix2= *p16_buf_dest;
-                        *p16_buf_dest--= *p16_buf_src;
-                        *p16_buf_src++ = temp_pix2;
-                    }
-                }
-            } else {
-                /**< Get Address of last pixel in the last row of the output frame */
-                p_buf_dest +=
-                    pPlaneOut[plane_number].u_stride*(pPlaneOut[plane_number].u_height-1) +
-                    pPlaneIn[plane_number].u_width - 2;
-                p16_buf_dest = (M4VIFI_UInt16 *)p_buf_dest;
-                p16_buf_src = (M4VIFI_UInt16 *)p_buf_src;
-
-                /**< Loop on rows */
-                for (i = pPlaneOut[plane_number].u_height; i != 0 ; i--) {
-                    for (j = (pPlaneOut[plane_number].u_width >> 1); j != 0 ; j--) {
-                        *p16_buf_dest--= *p16_buf_src++;
-                    }
-
-                    /**< Go on next row in top of input frame */
-                    p16_buf_src +=
-                        ((pPlaneIn[plane_number].u_stride - pPlaneOut[plane_number].u_width)>>1);
-                    /**< Go to last pixel of previous row in bottom of input frame*/
-                    p16_buf_dest -=
-                        ((pPlaneOut[plane_number].u_stride - pPlaneOut[plane_number].u_width)>>1);
-                }
+            /**< Loop on rows */
+            for (i = u_height; i != 0; i--) {
+                reverse(p_buf_src, p_buf_dest, u_count);
+
+                /**< Go on next row in top of input frame */
+                p_buf_src += pPlaneIn[plane_number].u_stride;
+                /**< Go to previous row in bottom of output frame*/
+                p_buf_dest -= pPlaneOut[plane_number].u_stride;
             }
         }
     }
@@ -1471,63 +1875,14 @@ M4VIFI_UInt8 M4VIFI_Rotate180NV12toNV12(void* pUserData,
 M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toYUV420(void *pUserData,
     M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut)
 {
-
-    LOGV("M4VIFI_ResizeBilinearNV12toYUV420 begin");
-
-    M4VIFI_ImagePlane pPlaneTmp[3];
-    M4OSA_UInt32 mVideoWidth, mVideoHeight;
-    M4OSA_UInt32 mFrameSize;
-
-    mVideoWidth  = pPlaneIn[0].u_width;
-    mVideoHeight = pPlaneIn[0].u_height;
-    mFrameSize   = mVideoWidth * mVideoHeight * 3/2;
-
-    M4OSA_UInt8 *pData = (M4OSA_UInt8 *)M4OSA_32bitAlignedMalloc(
-                             mFrameSize,
-                             12420,
-                             (M4OSA_Char*)("M4VIFI_ResizeBilinearNV12toYUV420: tempBuffer")
-                         );
-
-    if (NULL == pData)
-    {
-        LOGE("Error: Fail to allocate tempBuffer!");
-        return M4VIFI_ALLOC_FAILURE;
-    }
-
-    pPlaneTmp[0].pac_data       = pData;
-    pPlaneTmp[0].u_height       = pPlaneIn[0].u_height;
-    pPlaneTmp[0].u_width        = pPlaneIn[0].u_width;
-    pPlaneTmp[0].u_stride       = pPlaneIn[0].u_stride;
-    pPlaneTmp[0].u_topleft      = pPlaneIn[0].u_topleft;
-
-    pPlaneTmp[1].pac_data       = (M4OSA_UInt8 *)(pData + mVideoWidth*mVideoHeight);
-    pPlaneTmp[1].u_height       = pPlaneTmp[0].u_height/2;
-    pPlaneTmp[1].u_width        = pPlaneTmp[0].u_width/2;
-    pPlaneTmp[1].u_stride       = pPlaneTmp[0].u_stride/2;
-    pPlaneTmp[1].u_topleft      = pPlaneTmp[0].u_topleft;
-
-    pPlaneTmp[2].pac_data       = (M4OSA_UInt8 *)(pData + mVideoWidth*mVideoHeight*5/4);
-    pPlaneTmp[2].u_height       = pPlaneTmp[0].u_height/2;
-    pPlaneTmp[2].u_width        = pPlaneTmp[0].u_width/2;
-    pPlaneTmp[2].u_stride       = pPlaneTmp[0].u_stride/2;
-    pPlaneTmp[2].u_topleft      = pPlaneTmp[0].u_topleft;
-
     M4VIFI_UInt8 err;
-    err = M4VIFI_SemiplanarYUV420toYUV420_X86(pUserData, pPlaneIn,&pPlaneTmp[0]);
 
-    if(err != M4VIFI_OK)
-    {
-        LOGE("Error: M4VIFI_SemiplanarYUV420toYUV420 fails!");
-        free(pData);
-        return err;
-    }
+    LOGV("M4VIFI_ResizeBilinearNV12toYUV420 begin");
 
-    err = M4VIFI_ResizeBilinearYUV420toYUV420_X86(pUserData,&pPlaneTmp[0],pPlaneOut);
+    err = M4VIFI_ResizeBilinearNV12toYUV420_X86(pUserData, pPlaneIn, pPlaneOut);
 
-    free(pData);
     LOGV("M4VIFI_ResizeBilinearNV12toYUV420 end");
     return err;
-
 }
 
 M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toBGR565(void *pUserData,
@@ -1535,56 +1890,26 @@ M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toBGR565(void *pUserData,
 {
     LOGV("M4VIFI_ResizeBilinearNV12toBGR565 begin");
 
+    /*
+     Present the NV12 chroma plane as two planar chroma planes whose
+     samples are two bytes apart, so the resize reads it in place.
+    */
     M4VIFI_ImagePlane pPlaneTmp[3];
-    M4OSA_UInt32 mVideoWidth, mVideoHeight;
-    M4OSA_UInt32 mFrameSize;
-
-    mVideoWidth  = pPlaneIn[0].u_width;
-    mVideoHeight = pPlaneIn[0].u_height;
-    mFrameSize   = mVideoWidth * mVideoHeight * 3/2;
-
-    M4OSA_UInt8 *pData = (M4OSA_UInt8 *)M4OSA_32bitAlignedMalloc(
-                             mFrameSize,
-                             12420,
-                             (M4OSA_Char*)("M4VIFI_ResizeBilinearNV12toYUV420:tempBuffer")
-                         );
-    if (NULL == pData)
-    {
-        LOGE("Error: Fail to allocate tempBuffer!");
-        return M4VIFI_ALLOC_FAILURE;
-    }
-    pPlaneTmp[0].pac_data   = pData;
-    pPlaneTmp[0].u_height   = pPlaneIn[0].u_height;
-    pPlaneTmp[0].u_width    = pPlaneIn[0].u_width;
-    pPlaneTmp[0].u_stride   = pPlaneIn[0].u_stride;
-    pPlaneTmp[0].u_topleft  = pPlaneIn[0].u_topleft;
-
-    pPlaneTmp[1].pac_data   = (M4OSA_UInt8 *)(pData + mVideoWidth*mVideoHeight);
-    pPlaneTmp[1].u_height   = pPlaneTmp[0].u_height/2;
-    pPlaneTmp[1].u_width    = pPlaneTmp[0].u_width/2;
-    pPlaneTmp[1].u_stride   = pPlaneTmp[0].u_stride/2;
-    pPlaneTmp[1].u_topleft  = pPlaneTmp[0].u_topleft;
-
-    pPlaneTmp[2].pac_data   = (M4OSA_UInt8 *)(pData + mVideoWidth*mVideoHeight*5/4);
-    pPlaneTmp[2].u_height   = pPlaneTmp[0].u_height/2;
-    pPlaneTmp[2].u_width    = pPlaneTmp[0].u_width/2;
-    pPlaneTmp[2].u_stride   = pPlaneTmp[0].u_stride/2;
-    pPlaneTmp[2].u_topleft  = pPlaneTmp[0].u_topleft;
 
-    M4VIFI_UInt8 err;
-    err = M4VIFI_SemiplanarYUV420toYUV420_X86(pUserData, pPlaneIn,&pPlaneTmp[0]);
+    pPlaneTmp[0]            = pPlaneIn[0];
 
-    if(err != M4VIFI_OK)
-    {
-        LOGE("Error: M4VIFI_SemiplanarYUV420toYUV420 fails!");
-        free(pData);
-        return err;
-    }
+    pPlaneTmp[1].pac_data   = pPlaneIn[1].pac_data;
+    pPlaneTmp[1].u_height   = pPlaneIn[0].u_height/2;
+    pPlaneTmp[1].u_width    = pPlaneIn[0].u_width/2;
+    pPlaneTmp[1].u_stride   = pPlaneIn[1].u_stride;
+    pPlaneTmp[1].u_topleft  = pPlaneIn[1].u_topleft;
+
+    pPlaneTmp[2]            = pPlaneTmp[1];
+    pPlaneTmp[2].u_topleft  = pPlaneIn[1].u_topleft + 1;
 
-    err = M4VIFI_ResizeBilinearYUV420toBGR565_X86(pUserData,&pPlaneTmp[0],pPlaneOut);
-    free(pData);
+    M4VIFI_UInt8 err;
+    err = M4VIFI_ResizeBilinearYUV420toBGR565_X86(pUserData, &pPlaneTmp[0], pPlaneOut, 2);
 
     LOGV("M4VIFI_ResizeBilinearNV12toBGR565 end");
     return err;
 }
-
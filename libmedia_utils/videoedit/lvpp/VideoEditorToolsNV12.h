@@ -47,5 +47,18 @@ M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toBGR565(void *pUserData,
 M4VIFI_UInt8 M4VIFI_ResizeBilinearNV12toYUV420(void *pUserData,
     M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut);
 
+/* SIMD levels of the row kernels used by the functions above */
+#define M4VIFI_NV12_SIMD_NONE   0
+#define M4VIFI_NV12_SIMD_SSE2   1
+#define M4VIFI_NV12_SIMD_SSSE3  2
+
+/**
+ * Force the row kernels to a given SIMD level, or back to the best one the
+ * CPU supports when level is negative. Levels above what the CPU supports
+ * are lowered. Returns the level in effect. Meant for tests and benchmarks;
+ * not safe to call while another thread is converting.
+ */
+M4VIFI_Int32 M4VIFI_NV12SelectKernels(M4VIFI_Int32 level);
+
 #endif
 
@@ -0,0 +1,27 @@
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+    VideoEditorToolsNV12Test.c
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/.. \
+    $(call include-path-for, osal) \
+    $(call include-path-for, vss-common) \
+    $(call include-path-for, vss-mcs) \
+    $(call include-path-for, vss) \
+    $(call include-path-for, lvpp)
+
+LOCAL_STATIC_LIBRARIES:= \
+    liblvpp_intel
+
+LOCAL_SHARED_LIBRARIES:= \
+    libcutils \
+    libutils \
+    libvideoeditor_osal
+
+LOCAL_MODULE:= lvpp_nv12_test
+
+LOCAL_MODULE_TAGS := eng
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bit-exactness test and benchmark for the lvpp NV12 filters.
+ *
+ * Rotations are compared against a per-pixel reference and the NV12 resize
+ * against the original per-pixel bilinear loop. Every entry point is then
+ * run at each SIMD level and must match the plain C kernels. With -b the
+ * entry points are timed at 720p and 1080p.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "VideoEditorToolsNV12.h"
+
+typedef M4VIFI_UInt8 (*FilterFct)(void *pUserData,
+    M4VIFI_ImagePlane *pPlaneIn, M4VIFI_ImagePlane *pPlaneOut);
+
+static int sErrors = 0;
+
+/* Frame with a few spare rows so that edge over-reads stay in the buffer */
+typedef struct {
+    M4VIFI_UInt8 *data;
+    size_t size;
+    M4VIFI_ImagePlane plane[3];
+} Frame;
+
+static void fill(M4VIFI_UInt8 *p, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        p[i] = rand() & 0xff;
+    }
+}
+
+static void allocNV12(Frame *f, int width, int height, int stride, int random)
+{
+    f->size = (size_t)stride * (height + height / 2 + 4) + 64;
+    f->data = (M4VIFI_UInt8 *)malloc(f->size);
+    if (random) {
+        fill(f->data, f->size);
+    } else {
+        memset(f->data, 0x5a, f->size);
+    }
+
+    memset(f->plane, 0, sizeof(f->plane));
+    f->plane[0].pac_data = f->data;
+    f->plane[0].u_width = width;
+    f->plane[0].u_height = height;
+    f->plane[0].u_stride = stride;
+    f->plane[1].pac_data = f->data + (size_t)stride * height;
+    f->plane[1].u_width = width;
+    f->plane[1].u_height = height / 2;
+    f->plane[1].u_stride = stride;
+}
+
+static void allocYUV420(Frame *f, int width, int height)
+{
+    f->size = (size_t)width * height * 3 / 2 + 64;
+    f->data = (M4VIFI_UInt8 *)malloc(f->size);
+    memset(f->data, 0x5a, f->size);
+
+    memset(f->plane, 0, sizeof(f->plane));
+    f->plane[0].pac_data = f->data;
+    f->plane[0].u_width = width;
+    f->plane[0].u_height = height;
+    f->plane[0].u_stride = width;
+    f->plane[1].pac_data = f->data + width * height;
+    f->plane[1].u_width = width / 2;
+    f->plane[1].u_height = height / 2;
+    f->plane[1].u_stride = width / 2;
+    f->plane[2] = f->plane[1];
+    f->plane[2].pac_data = f->data + width * height * 5 / 4;
+}
+
+static void allocPacked(Frame *f, int width, int height, int bpp, int random)
+{
+    f->size = (size_t)width * height * bpp + 64;
+    f->data = (M4VIFI_UInt8 *)malloc(f->size);
+    if (random) {
+        fill(f->data, f->size);
+    } else {
+        memset(f->data, 0x5a, f->size);
+    }
+
+    memset(f->plane, 0, sizeof(f->plane));
+    f->plane[0].pac_data = f->data;
+    f->plane[0].u_width = width;
+    f->plane[0].u_height = height;
+    f->plane[0].u_stride = width * bpp;
+}
+
+static void freeFrame(Frame *f)
+{
+    free(f->data);
+}
+
+static void compare(const char *what, const Frame *a, const Frame *b, int level)
+{
+    if (memcmp(a->data, b->data, a->size)) {
+        printf("%s %ux%u level %d: mismatch\n", what,
+               a->plane[0].u_width, a->plane[0].u_height, level);
+        ++sErrors;
+    }
+}
+
+/* Sample (x, y) of plane p, UV pairs counting as one element */
+static M4VIFI_UInt8 *at(Frame *f, int p, int x, int y)
+{
+    return f->plane[p].pac_data + f->plane[p].u_topleft +
+           y * f->plane[p].u_stride + x * (p + 1);
+}
+
+static void referenceRotate(Frame *in, Frame *out, int angle)
+{
+    int p, x, y;
+
+    for (p = 0; p < 2; p++) {
+        int w = out->plane[p].u_width / (p + 1), h = out->plane[p].u_height;
+
+        for (y = 0; y < h; y++) {
+            for (x = 0; x < w; x++) {
+                M4VIFI_UInt8 *s;
+
+                if (angle == 90) {
+                    s = at(in, p, y, w - 1 - x);
+                } else if (angle == 270) {
+                    s = at(in, p, h - 1 - y, x);
+                } else {
+                    s = at(in, p, w - 1 - x, h - 1 - y);
+                }
+                memcpy(at(out, p, x, y), s, p + 1);
+            }
+        }
+    }
+}
+
+static void checkRotate(int width, int height)
+{
+    Frame in, ref, out;
+
+    allocNV12(&in, width, height, width + 6, 1);
+
+    /* +90: the input bottom-left pixel becomes the output top-left one */
+    allocNV12(&ref, height, width, height + 10, 0);
+    allocNV12(&out, height, width, height + 10, 0);
+    referenceRotate(&in, &ref, 90);
+    M4VIFI_Rotate90RightNV12toNV12(NULL, in.plane, out.plane);
+    compare("rotate90right", &ref, &out, -1);
+    freeFrame(&ref);
+    freeFrame(&out);
+
+    allocNV12(&ref, height, width, height + 10, 0);
+    allocNV12(&out, height, width, height + 10, 0);
+    referenceRotate(&in, &ref, 270);
+    M4VIFI_Rotate90LeftNV12toNV12(NULL, in.plane, out.plane);
+    compare("rotate90left", &ref, &out, -1);
+    freeFrame(&ref);
+    freeFrame(&out);
+
+    allocNV12(&ref, width, height, width + 6, 0);
+    allocNV12(&out, width, height, width + 6, 0);
+    referenceRotate(&in, &ref, 180);
+    M4VIFI_Rotate180NV12toNV12(NULL, in.plane, out.plane);
+    compare("rotate180", &ref, &out, -1);
+
+    /* In place, the padding is left as it was in the input */
+    memcpy(ref.data, in.data, in.size);
+    referenceRotate(&in, &ref, 180);
+    M4VIFI_Rotate180NV12toNV12(NULL, in.plane, in.plane);
+    compare("rotate180 in place", &ref, &in, -1);
+    freeFrame(&ref);
+    freeFrame(&out);
+
+    freeFrame(&in);
+}
+
+/* The per-pixel bilinear loop M4VIFI_ResizeBilinearNV12toNV12 used to run */
+static void referenceResize(Frame *in, Frame *out)
+{
+    M4VIFI_UInt32 p, x, y, c;
+    M4VIFI_UInt8 wflag = 0, hflag = 0;
+
+    for (p = 0; p < 2; p++) {
+        M4VIFI_UInt32 w_in = in->plane[p].u_width, h_in = in->plane[p].u_height;
+        M4VIFI_UInt32 w_out = out->plane[p].u_width, h_out = out->plane[p].u_height;
+        M4VIFI_UInt32 x_inc, y_inc, x_start, x_accum, y_accum, x_frac, y_frac;
+        M4VIFI_UInt32 channels = p + 1;
+        M4VIFI_UInt8 *src = in->plane[p].pac_data;
+        M4VIFI_UInt8 *dst = out->plane[p].pac_data;
+        M4VIFI_UInt8 *last_row = dst, last[2] = { 0, 0 };
+
+        if (w_out == w_in) {
+            w_out = w_out - 1 - p;
+            wflag = 1;
+        }
+        x_inc = (w_out >= w_in) ? ((w_in - 1 - p) * 0x10000) / (w_out - 1 - p)
+                                : (w_in * 0x10000) / w_out;
+        if (h_out == h_in) {
+            h_out = h_out - 1;
+            hflag = 1;
+        }
+        y_inc = (h_out >= h_in) ? ((h_in - 1) * 0x10000) / (h_out - 1)
+                                : (h_in * 0x10000) / h_out;
+
+        y_accum = (y_inc >= 0x10000) ? ((y_inc & 0xffff) ? y_inc & 0xffff : 0x10000) >> 1 : 0;
+        x_start = (x_inc >= 0x10000) ? ((x_inc & 0xffff) ? x_inc & 0xffff : 0x10000) >> 1 : 0;
+
+        for (y = 0; y < h_out; y++) {
+            M4VIFI_UInt8 *row = dst + y * out->plane[p].u_stride;
+
+            y_frac = (y_accum >> 12) & 15;
+            x_accum = x_start;
+            for (x = 0; x < w_out / channels; x++) {
+                M4VIFI_UInt8 *top = src + (x_accum >> 16) * channels;
+                M4VIFI_UInt8 *bottom = top + in->plane[p].u_stride;
+
+                x_frac = (x_accum >> 12) & 15;
+                for (c = 0; c < channels; c++) {
+                    last[c] = (M4VIFI_UInt8)(((top[c] * (16 - x_frac) +
+                        top[c + channels] * x_frac) * (16 - y_frac) +
+                        (bottom[c] * (16 - x_frac) +
+                        bottom[c + channels] * x_frac) * y_frac) >> 8);
+                    row[x * channels + c] = last[c];
+                }
+                x_accum += x_inc;
+            }
+            if (wflag) {
+                memcpy(row + w_out, last, channels);
+            }
+            last_row = row;
+
+            y_accum += y_inc;
+            src += (y_accum >> 16) * in->plane[p].u_stride;
+            y_accum &= 0xffff;
+        }
+        if (hflag) {
+            memcpy(dst + h_out * out->plane[p].u_stride, last_row, w_out + wflag + p);
+        }
+    }
+}
+
+static void checkResize(int width, int height, int width2, int height2)
+{
+    Frame in, ref, out;
+
+    allocNV12(&in, width, height, width + 8, 1);
+    allocNV12(&ref, width2, height2, width2 + 4, 0);
+    allocNV12(&out, width2, height2, width2 + 4, 0);
+
+    referenceResize(&in, &ref);
+    if (M4VIFI_ResizeBilinearNV12toNV12(NULL, in.plane, out.plane) != M4VIFI_OK) {
+        printf("resize %dx%d -> %dx%d: failed\n", width, height, width2, height2);
+        ++sErrors;
+    }
+    compare("resize", &ref, &out, -1);
+
+    freeFrame(&in);
+    freeFrame(&ref);
+    freeFrame(&out);
+}
+
+/* Run one entry point at every SIMD level and compare with the C kernels */
+static void checkLevels(const char *what, FilterFct fct, Frame *in,
+                        void (*allocOut)(Frame *f, int w, int h), int width2, int height2)
+{
+    Frame ref, out;
+    M4VIFI_Int32 level, top = M4VIFI_NV12SelectKernels(-1);
+
+    allocOut(&ref, width2, height2);
+    M4VIFI_NV12SelectKernels(M4VIFI_NV12_SIMD_NONE);
+    fct(NULL, in->plane, ref.plane);
+
+    for (level = M4VIFI_NV12_SIMD_SSE2; level <= top; level++) {
+        M4VIFI_NV12SelectKernels(level);
+        allocOut(&out, width2, height2);
+        fct(NULL, in->plane, out.plane);
+        compare(what, &ref, &out, level);
+        freeFrame(&out);
+    }
+    M4VIFI_NV12SelectKernels(-1);
+    freeFrame(&ref);
+}
+
+static void outNV12(Frame *f, int w, int h) { allocNV12(f, w, h, w, 0); }
+static void outYUV420(Frame *f, int w, int h) { allocYUV420(f, w, h); }
+static void outBGR565(Frame *f, int w, int h) { allocPacked(f, w, h, 2, 0); }
+
+static void checkAllLevels(int width, int height, int width2, int height2)
+{
+    Frame in;
+
+    /* The YUV420 and BGR565 paths also accept packed frames only */
+    allocNV12(&in, width, height, width, 1);
+    checkLevels("resize nv12", M4VIFI_ResizeBilinearNV12toNV12, &in, outNV12,
+                width2, height2);
+    checkLevels("resize yuv420", M4VIFI_ResizeBilinearNV12toYUV420, &in, outYUV420,
+                width2, height2);
+    checkLevels("resize bgr565", M4VIFI_ResizeBilinearNV12toBGR565, &in, outBGR565,
+                width2, height2);
+    checkLevels("rotate90left", M4VIFI_Rotate90LeftNV12toNV12, &in, outNV12,
+                height, width);
+    checkLevels("rotate90right", M4VIFI_Rotate90RightNV12toNV12, &in, outNV12,
+                height, width);
+    checkLevels("rotate180", M4VIFI_Rotate180NV12toNV12, &in, outNV12,
+                width, height);
+    freeFrame(&in);
+}
+
+static double nowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static double timeFilter(FilterFct fct, Frame *in, Frame *out, M4VIFI_Int32 level)
+{
+    const int kIterations = 20;
+    double start;
+    int i;
+
+    M4VIFI_NV12SelectKernels(level);
+    start = nowMs();
+    for (i = 0; i < kIterations; i++) {
+        fct(NULL, in->plane, out->plane);
+    }
+    return (nowMs() - start) / kIterations;
+}
+
+static void benchFilter(const char *name, const char *what, FilterFct fct,
+                        Frame *in, Frame *out)
+{
+    double scalar = timeFilter(fct, in, out, M4VIFI_NV12_SIMD_NONE);
+    double simd = timeFilter(fct, in, out, -1);
+
+    printf("%-6s %-22s C %8.3f ms  simd %8.3f ms\n", name, what, scalar, simd);
+}
+
+static void bench(const char *name, int width, int height)
+{
+    Frame in, rgb, out;
+
+    allocNV12(&in, width, height, width, 1);
+
+    allocNV12(&out, width / 2, height / 2, width / 2, 0);
+    benchFilter(name, "resize nv12 1/2", M4VIFI_ResizeBilinearNV12toNV12, &in, &out);
+    freeFrame(&out);
+
+    allocNV12(&out, width * 3 / 2, height * 3 / 2, width * 3 / 2, 0);
+    benchFilter(name, "resize nv12 3/2", M4VIFI_ResizeBilinearNV12toNV12, &in, &out);
+    freeFrame(&out);
+
+    allocYUV420(&out, width / 2, height / 2);
+    benchFilter(name, "resize yuv420 1/2", M4VIFI_ResizeBilinearNV12toYUV420, &in, &out);
+    freeFrame(&out);
+
+    allocPacked(&out, width / 2, height / 2, 2, 0);
+    benchFilter(name, "resize bgr565 1/2", M4VIFI_ResizeBilinearNV12toBGR565, &in, &out);
+    freeFrame(&out);
+
+    allocNV12(&out, height, width, height, 0);
+    benchFilter(name, "rotate90left", M4VIFI_Rotate90LeftNV12toNV12, &in, &out);
+    benchFilter(name, "rotate90right", M4VIFI_Rotate90RightNV12toNV12, &in, &out);
+    freeFrame(&out);
+
+    allocNV12(&out, width, height, width, 0);
+    benchFilter(name, "rotate180", M4VIFI_Rotate180NV12toNV12, &in, &out);
+    benchFilter(name, "rotate180 in place", M4VIFI_Rotate180NV12toNV12, &in, &in);
+    benchFilter(name, "nv12 copy", M4VIFI_NV12toNV12, &in, &out);
+    freeFrame(&out);
+
+    allocPacked(&rgb, width, height, 3, 1);
+    allocNV12(&out, width, height, width, 0);
+    benchFilter(name, "rgb888 to nv12", M4VIFI_RGB888toNV12, &rgb, &out);
+    freeFrame(&out);
+    freeFrame(&rgb);
+
+    freeFrame(&in);
+}
+
+int main(int argc, char **argv)
+{
+    static const int kResize[][4] = {
+        { 16, 16, 32, 32 }, { 176, 144, 352, 288 }, { 640, 480, 320, 240 },
+        { 320, 240, 320, 180 }, { 320, 240, 160, 240 }, { 100, 50, 62, 38 },
+        { 1280, 720, 1920, 1080 }, { 1920, 1080, 1280, 720 },
+    };
+    static const int kRotate[][2] = {
+        { 2, 2 }, { 8, 8 }, { 34, 18 }, { 90, 30 }, { 176, 144 }, { 180, 146 },
+        { 1280, 720 },
+    };
+    size_t i;
+
+    srand(1234);
+    printf("simd level %d\n", M4VIFI_NV12SelectKernels(-1));
+
+    for (i = 0; i < sizeof(kRotate) / sizeof(kRotate[0]); i++) {
+        checkRotate(kRotate[i][0], kRotate[i][1]);
+    }
+    for (i = 0; i < sizeof(kResize) / sizeof(kResize[0]); i++) {
+        checkResize(kResize[i][0], kResize[i][1], kResize[i][2], kResize[i][3]);
+        checkAllLevels(kResize[i][0], kResize[i][1], kResize[i][2], kResize[i][3]);
+    }
+
+    if (sErrors) {
+        printf("FAILED: %d errors\n", sErrors);
+        return 1;
+    }
+    printf("bit-exact: OK\n");
+
+    if (argc > 1 && !strcmp(argv[1], "-b")) {
+        bench("720p", 1280, 720);
+        bench("1080p", 1920, 1080);
+    }
+    return 0;
+}
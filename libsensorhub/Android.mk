@@ -12,9 +12,10 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_C_INCLUDES += $(LOCAL_PATH)
 
 LOCAL_SRC_FILES := src/daemon/main.c \
-			src/utils/utils.c
+			src/utils/utils.c \
+			src/utils/ring.c
 
-LOCAL_SHARED_LIBRARIES := liblog libhardware_legacy
+LOCAL_SHARED_LIBRARIES := liblog libhardware_legacy libcutils
 
 LOCAL_MODULE := sensorhubd
 
@@ -32,7 +33,8 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_C_INCLUDES += $(LOCAL_PATH)
 
 LOCAL_SRC_FILES := src/lib/libsensorhub.c \
-			src/utils/utils.c
+			src/utils/utils.c \
+			src/utils/ring.c
 
 LOCAL_SHARED_LIBRARIES := liblog libcutils
 
@@ -124,4 +126,22 @@ LOCAL_MODULE    := event_notification
 
 include $(BUILD_EXECUTABLE)
 
+#
+# shared ring test on the host, with a fake sysfs data source.
+#
+include $(CLEAR_VARS)
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)
+
+LOCAL_SRC_FILES := src/tests/ring_test.c \
+			src/utils/ring.c
+
+LOCAL_LDLIBS := -lpthread
+
+LOCAL_MODULE    := sensorhub_ring_test
+
+include $(BUILD_HOST_EXECUTABLE)
+
 endif
@@ -10,7 +10,8 @@
 #include <sys/socket.h>
 #include <linux/un.h>
 #include <string.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
 #include <poll.h>
 #include <sys/time.h>
 #include <sys/stat.h>
@@ -19,11 +20,13 @@
 #include <pthread.h>
 #include <hardware_legacy/power.h>
 #include <cutils/sockets.h>
+#include <cutils/ashmem.h>
 
 #include "../include/socket.h"
 #include "../include/utils.h"
 #include "../include/message.h"
 #include "../include/bist.h"
+#include "../include/ring.h"
 #ifdef ENABLE_CONTEXT_ARBITOR
 #include <libcontextarbitor.h>
 #endif
@@ -109,9 +112,17 @@ typedef struct session_state_t {
 	unsigned char event_id;
 	};
 	void *handle;
+	ring_t *ring;		// NULL: data is sent on datafd
 	struct session_state_t *next;
 } session_state_t;
 
+/* sensor flags, set once the sensor list is known so that the data path
+   does not compare sensor names */
+#define SNR_FLAG_GYRO_RAW	(1 << 0)	// accuracy appended to gyro data
+#define SNR_FLAG_COMPASS_RAW	(1 << 1)	// accuracy appended to compass data
+#define SNR_FLAG_CTX_ARBITOR	(1 << 2)	// data goes through the context arbitor
+#define SNR_FLAG_EVENT		(1 << 3)
+
 /* data structure to keep state for a particular type of sensor */
 typedef struct {
 	int sensor_id;
@@ -120,6 +131,8 @@ typedef struct {
 	int data_rate;
 	int buffer_delay;
 	int calibration_status; // only for compass_cal and gyro_cal
+	int flags;
+	int cal_index;		// index of the calibration sensor, -1 if none
 	session_state_t *list;
 } sensor_state_t;
 
@@ -129,6 +142,9 @@ static sensor_state_t *sensor_list = NULL;
 
 static int current_sensor_index = 0;	// means the current empty slot of sensor_list[]
 
+/* index + 1 in sensor_list[] of each sensor id, 0 if unknown */
+static short sensor_id_to_index[256];
+
 #define MERRIFIELD 0
 #define BAYTRAIL 1
 
@@ -188,15 +204,70 @@ static sensor_state_t* get_sensor_state_with_name(char *name)
 
 static sensor_state_t* get_sensor_state_with_id(unsigned char sensor_id)
 {
-	int i;
+	int index = sensor_id_to_index[sensor_id];
 
-	for (i = 0; i < current_sensor_index; i ++) {
-		if (sensor_list[i].sensor_id == sensor_id) {
-			return &sensor_list[i];
+	if (index == 0)
+		return NULL;
+
+	return &sensor_list[index - 1];
+}
+
+static sensor_state_t* get_sensor_state_with_index(int index)
+{
+	if (index < 0)
+		return NULL;
+
+	return &sensor_list[index];
+}
+
+static int get_sensor_index_with_name(char *name)
+{
+	sensor_state_t *p_sensor_state = get_sensor_state_with_name(name);
+
+	if (p_sensor_state == NULL)
+		return -1;
+
+	return p_sensor_state - sensor_list;
+}
+
+/* set the flags and the sensor id index once sensor_list[] is complete */
+static void index_sensors()
+{
+	static char *ctx_sensors[] = { "PHYAC", "PEDOM", "STAP", "GSFLK",
+					"SHAKI", "GSPX", "SCOUN", "SDET" };
+	int compc = get_sensor_index_with_name("COMPC");
+	int gyroc = get_sensor_index_with_name("GYROC");
+	int i, j;
+
+	memset(sensor_id_to_index, 0, sizeof(sensor_id_to_index));
+
+	for (i = 0; i < current_sensor_index; i++) {
+		sensor_state_t *p_sensor_state = &sensor_list[i];
+		char *name = p_sensor_state->name;
+
+		p_sensor_state->flags = 0;
+		p_sensor_state->cal_index = -1;
+
+		if (strncmp(name, "GYRO", SNR_NAME_MAX_LEN) == 0
+			|| strncmp(name, "GYRO1", SNR_NAME_MAX_LEN) == 0) {
+			p_sensor_state->flags |= SNR_FLAG_GYRO_RAW;
+			p_sensor_state->cal_index = gyroc;
+		} else if (strncmp(name, "COMPS", SNR_NAME_MAX_LEN) == 0
+			|| strncmp(name, "COMP1", SNR_NAME_MAX_LEN) == 0) {
+			p_sensor_state->flags |= SNR_FLAG_COMPASS_RAW;
+			p_sensor_state->cal_index = compc;
+		} else if (strncmp(name, "EVENT", SNR_NAME_MAX_LEN) == 0) {
+			p_sensor_state->flags |= SNR_FLAG_EVENT;
 		}
-	}
 
-	return NULL;
+		for (j = 0; j < (int)(sizeof(ctx_sensors) / sizeof(ctx_sensors[0])); j++)
+			if (strncmp(name, ctx_sensors[j], SNR_NAME_MAX_LEN) == 0)
+				p_sensor_state->flags |= SNR_FLAG_CTX_ARBITOR;
+
+		/* the first sensor with an id wins, as in a linear search */
+		if (sensor_id_to_index[p_sensor_state->sensor_id & 0xff] == 0)
+			sensor_id_to_index[p_sensor_state->sensor_id & 0xff] = i + 1;
+	}
 }
 
 static session_state_t* get_session_state_with_session_id(
@@ -1272,6 +1343,101 @@ static int recalculate_data_rate(sensor_state_t *p_sensor_state, int data_rate)
      cmd format is <TRANID><CMDID><SENSORID><RATE><BUFFER DELAY>
      CMDID refer to psh_fw/include/cmd_engine.h;
      SENSORID refer to psh_fw/sensors/include/sensor_def.h */
+/* create a ring of at least size bytes for the session and send its fd in
+   the ack; return 0 on success, -1 if the ack is still to be sent */
+static int map_ring(int fd, session_state_t *p_session_state, int size)
+{
+	char reply[sizeof(cmd_ack_event) + sizeof(int)];
+	char control[CMSG_SPACE(sizeof(int))];
+	cmd_ack_event *p_cmd_ack = (cmd_ack_event *)reply;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	unsigned int data_size, map_size;
+	int ring_fd, ret;
+	void *mem;
+	ring_t *ring;
+
+	if (size <= 0)
+		size = RING_MIN_SIZE;
+
+	data_size = ring_data_size(size);
+	map_size = ring_map_size(data_size);
+
+	ring = malloc(sizeof(ring_t));
+	if (ring == NULL) {
+		LOGE("map_ring(): malloc failed \n");
+		return -1;
+	}
+
+	ring_fd = ashmem_create_region("sensorhub_ring", map_size);
+	if (ring_fd < 0) {
+		LOGE("map_ring(): ashmem_create_region failed, errno is %d\n", errno);
+		free(ring);
+		return -1;
+	}
+
+	mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+	if (mem == MAP_FAILED) {
+		LOGE("map_ring(): mmap failed, errno is %d\n", errno);
+		close(ring_fd);
+		free(ring);
+		return -1;
+	}
+
+	ring_init(ring, mem, data_size);
+
+	p_cmd_ack->event_type = EVENT_CMD_ACK;
+	p_cmd_ack->ret = SUCCESS;
+	p_cmd_ack->buf_len = sizeof(int);
+	memcpy(p_cmd_ack->buf, &map_size, sizeof(int));
+
+	iov.iov_base = reply;
+	iov.iov_len = sizeof(reply);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &ring_fd, sizeof(int));
+
+	ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+	/* the mapping is kept, the client has its own fd */
+	close(ring_fd);
+	if (ret < 0) {
+		LOGE("map_ring(): sendmsg failed, errno is %d\n", errno);
+		munmap(mem, map_size);
+		free(ring);
+		return -1;
+	}
+
+	p_session_state->ring = ring;
+
+	log_message(DEBUG, "map_ring(): %d bytes ring for session %d \n",
+				data_size, p_session_state->session_id);
+
+	return 0;
+}
+
+static void unmap_ring(session_state_t *p_session_state)
+{
+	ring_t *ring = p_session_state->ring;
+
+	if (ring == NULL)
+		return;
+
+	log_message(DEBUG, "unmap_ring(): session %d dropped %d records \n",
+			p_session_state->session_id, ring_dropped(ring));
+
+	munmap(ring->hdr, ring->map_size);
+	free(ring);
+	p_session_state->ring = NULL;
+}
+
 static ret_t handle_cmd(int fd, cmd_event* p_cmd, int parameter, int parameter1,
 						int parameter2,	int *reply_now)
 {
@@ -1334,14 +1500,7 @@ static ret_t handle_cmd(int fd, cmd_event* p_cmd, int parameter, int parameter1,
 			return ERR_SESSION_NOT_EXIST;
 	} else if (cmd == CMD_SET_PROPERTY) {
 #ifdef ENABLE_CONTEXT_ARBITOR
-		if (strncmp(p_sensor_state->name, "PHYAC", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "PEDOM", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "STAP", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "GSFLK", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SHAKI", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "GSPX", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SCOUN", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SDET", SNR_NAME_MAX_LEN) == 0) {
+		if (p_sensor_state->flags & SNR_FLAG_CTX_ARBITOR) {
 			if (strncmp(p_sensor_state->name, "PHYAC", SNR_NAME_MAX_LEN) == 0) {
 				ctx_activity_option_t activity_option;
 				if (ctx_set_option(p_session_state->handle, p_cmd->parameter, (char *)p_cmd->buf, &activity_option) == -1) {
@@ -1399,6 +1558,19 @@ LOGI("STY prop_mode %d cycle %d duty %d", activity_option.prop_mode, activity_op
 #ifdef ENABLE_CONTEXT_ARBITOR
 		}
 #endif
+	} else if (cmd == CMD_MAP_RING) {
+		/* event data is not streamed, it keeps going on datafd. A
+		   streaming session would have records queued on datafd that
+		   the client then takes for wakeups */
+		if ((p_sensor_state->flags & SNR_FLAG_EVENT)
+			|| (p_session_state->ring != NULL)
+			|| (p_session_state->state != INACTIVE))
+			return ERR_CMD_NOT_SUPPORT;
+
+		if (map_ring(fd, p_session_state, parameter) != 0)
+			return ERR_CMD_NOT_SUPPORT;
+
+		*reply_now = 0;
 	}
 
 	return SUCCESS;
@@ -1446,14 +1618,7 @@ static void handle_message(int fd, char *message)
 
 #ifdef ENABLE_CONTEXT_ARBITOR
 
-		if (strncmp(p_sensor_state->name, "PHYAC", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "PEDOM", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "STAP", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "GSFLK", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SHAKI", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "GSPX", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SCOUN", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SDET", SNR_NAME_MAX_LEN) == 0) {
+		if (p_sensor_state->flags & SNR_FLAG_CTX_ARBITOR) {
 			void *handle;
 			handle = ctx_open_session(p_sensor_state->name);
 			if (handle == NULL) {
@@ -1688,11 +1853,26 @@ static void write_data(session_state_t *p_session_state, void *data, int size)
 		p_session_state->datafd_invalid = 1;
 }
 
+static void send_data_to_session(session_state_t *p_session_state,
+						void *data, int size)
+{
+	char wakeup = 0;
+
+	if (p_session_state->ring == NULL) {
+		send(p_session_state->datafd, data, size, MSG_NOSIGNAL|MSG_DONTWAIT);
+		return;
+	}
+
+	/* the client reads the ring; datafd only wakes it up when it had
+	   read everything before */
+	if (ring_write(p_session_state->ring, data, size) == 1)
+		send(p_session_state->datafd, &wakeup, 1, MSG_NOSIGNAL|MSG_DONTWAIT);
+}
+
 static void send_data_to_clients(sensor_state_t *p_sensor_state, void *data,
 						int size)
 {
 	session_state_t *p_session_state = p_sensor_state->list;
-	char buf[MAX_MESSAGE_LENGTH];
 
 	/* Use slide window mechanism to send data to target client,
 	   buffer_delay is gauranteed, data count is not gauranteed.
@@ -1705,38 +1885,24 @@ static void send_data_to_clients(sensor_state_t *p_sensor_state, void *data,
 			continue;
 
 #ifdef ENABLE_CONTEXT_ARBITOR
-		if (strncmp(p_sensor_state->name, "PHYAC", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "PEDOM", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "STAP", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "GSFLK", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SHAKI", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "GSPX", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SCOUN", SNR_NAME_MAX_LEN) == 0
-			|| strncmp(p_sensor_state->name, "SDET", SNR_NAME_MAX_LEN) == 0) {
+		if (p_sensor_state->flags & SNR_FLAG_CTX_ARBITOR) {
 			void *out_data;
 			int out_size;
 			if (ctx_dispatch_data(p_session_state->handle, data, size, &out_data, &out_size) == 1)
-				send(p_session_state->datafd, out_data, out_size, MSG_NOSIGNAL|MSG_DONTWAIT);
+				send_data_to_session(p_session_state, out_data, out_size);
 		} else
 #endif
-			send(p_session_state->datafd, data, size, MSG_NOSIGNAL|MSG_DONTWAIT);
+			send_data_to_session(p_session_state, data, size);
 	}
 }
 
 static void dispatch_get_single(struct cmd_resp *p_cmd_resp)
 {
-	int i;
 	sensor_state_t *p_sensor_state = NULL;
 	session_state_t *p_session_state;
 	cmd_ack_event *p_cmd_ack;
 
-	for (i = 0; i < current_sensor_index; i ++) {
-		if (sensor_list[i].sensor_id == p_cmd_resp->sensor_id) {
-			p_sensor_state = &sensor_list[i];
-			break;
-		}
-	}
-
+	p_sensor_state = get_sensor_state_with_id(p_cmd_resp->sensor_id);
 	if (p_sensor_state == NULL) {
 		LOGE("dispatch_get_single(): unkown sensor id from psh fw %d \n", p_cmd_resp->sensor_id);
 		return;
@@ -1833,8 +1999,7 @@ static void dispatch_streaming(struct cmd_resp *p_cmd_resp)
 		return;
 	}
 
-	if ((strncmp(p_sensor_state->name, "GYRO", SNR_NAME_MAX_LEN) == 0)
-		|| (strncmp(p_sensor_state->name, "GYRO1", SNR_NAME_MAX_LEN) == 0)) {
+	if (p_sensor_state->flags & SNR_FLAG_GYRO_RAW) {
 		sensor_state_t *p_cal_sensor_state;
 		struct gyro_raw_data *p_gyro_raw_data;
 		struct gyro_raw_data *p_fake
@@ -1846,7 +2011,7 @@ static void dispatch_streaming(struct cmd_resp *p_cmd_resp)
 		if (p_gyro_raw_data == NULL)
 			goto fail;
 
-		p_cal_sensor_state = get_sensor_state_with_name("GYROC");
+		p_cal_sensor_state = get_sensor_state_with_index(p_sensor_state->cal_index);
 		for (i = 0; i < len; ++i) {
 			p_gyro_raw_data[i].x = p_fake[i].x;
 			p_gyro_raw_data[i].y = p_fake[i].y;
@@ -1858,8 +2023,7 @@ static void dispatch_streaming(struct cmd_resp *p_cmd_resp)
 		send_data_to_clients(p_sensor_state, p_gyro_raw_data,
 					len*sizeof(struct gyro_raw_data));
 		free(p_gyro_raw_data);
-	} else if ((strncmp(p_sensor_state->name, "COMPS", SNR_NAME_MAX_LEN) == 0)
-		|| (strncmp(p_sensor_state->name, "COMP1", SNR_NAME_MAX_LEN) == 0)) {
+	} else if (p_sensor_state->flags & SNR_FLAG_COMPASS_RAW) {
 		sensor_state_t *p_cal_sensor_state;
 		struct compass_raw_data *p_compass_raw_data;
 		struct compass_raw_data *p_fake = (struct compass_raw_data *)p_cmd_resp->buf;
@@ -1870,7 +2034,7 @@ static void dispatch_streaming(struct cmd_resp *p_cmd_resp)
 		if(p_compass_raw_data == NULL)
 			goto fail;
 
-		p_cal_sensor_state = get_sensor_state_with_name("COMPC");
+		p_cal_sensor_state = get_sensor_state_with_index(p_sensor_state->cal_index);
 		for (i = 0; i < len; ++i){
 			p_compass_raw_data[i].x = p_fake[i].x;
 			p_compass_raw_data[i].y = p_fake[i].y;
@@ -2035,7 +2199,7 @@ static void dispatch_data()
 	int ret, data_size, left = 0;
 	struct cmd_resp *p_cmd_resp;
 	struct timeval tv, tv1;
-	char datasize_buf[8];
+	char datasize_buf[8], *end;
 
 	if (buf == NULL)
 		buf = (char *)malloc(128 * 1024);
@@ -2051,15 +2215,14 @@ static void dispatch_data()
 					tv.tv_sec, tv.tv_usec);
 
 	/* read data_size node */
-	lseek(datasizefd, 0, SEEK_SET);
-	ret = read(datasizefd, datasize_buf, 8);
+	ret = pread(datasizefd, datasize_buf, sizeof(datasize_buf) - 1, 0);
 	if (ret <= 0)
 		return;
 
-	datasize_buf[7] = '\0';
-	sscanf(datasize_buf, "%d", &data_size);
+	datasize_buf[ret] = '\0';
+	data_size = strtol(datasize_buf, &end, 10);
 
-	if ((data_size <= 0) || (data_size > 128 * 1024))
+	if ((end == datasize_buf) || (data_size <= 0) || (data_size > 128 * 1024))
 		return;
 
 	left = data_size;
@@ -2169,6 +2332,7 @@ static void remove_session_by_fd(int fd)
 
 				stop_streaming(&sensor_list[i], p_session_state);
 			}
+			unmap_ring(p_session_state);
 			if (p_session_state == sensor_list[i].list)
 				sensor_list[i].list = p_session_state->next;
 			else
@@ -2250,93 +2414,95 @@ static void remove_session_by_fd(int fd)
         }
 }
 
+#define MAX_EPOLL_EVENTS 32
+
+static void add_listen_fd(int epollfd, int fd, unsigned int events)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = fd;
+
+	if (epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+		LOGE("sensorhubd epoll_ctl() failed for fd %d. errno "
+			"is %d\n", fd, errno);
+		exit(EXIT_FAILURE);
+	}
+}
+
 /* 1 create data thread
    2 wait and handle the request from client in main thread */
 static void start_sensorhubd()
 {
-	fd_set listen_fds, read_fds;
-	int maxfd;
-	int ret;
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	int epollfd, nfds, i;
 
-	/* two fd_set for I/O multiplexing */
-	FD_ZERO(&listen_fds);
-	FD_ZERO(&read_fds);
+	epollfd = epoll_create(MAX_EPOLL_EVENTS);
+	if (epollfd == -1) {
+		LOGE("sensorhubd epoll_create() failed. errno is %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
 
-	/* add sockfd to listen_fds */
+	/* new connection requests */
 //	listen(sockfd, MAX_Q_LENGTH);
-	FD_SET(sockfd, &listen_fds);
-	maxfd = sockfd;
-
-	/* get data from data node and dispatch it to clients, begin */
-	fd_set datasize_fds;
-	FD_ZERO(&datasize_fds);
+	add_listen_fd(epollfd, sockfd, EPOLLIN);
 
-	if (datasizefd > maxfd)
-		maxfd = datasizefd;
-	/* get data from data node and dispatch it to clients, end */
+	/* sysfs notifies new data on the data_size node as an exception */
+	add_listen_fd(epollfd, datasizefd, EPOLLPRI | EPOLLERR);
 
 	while (1) {
-		read_fds = listen_fds;
-		FD_SET(datasizefd, &datasize_fds);
-
-		/* error handling of select() */
-		if (select(maxfd + 1, &read_fds, NULL, &datasize_fds, NULL)
-								== -1) {
+		nfds = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, -1);
+		if (nfds == -1) {
 			if (errno == EINTR)
 				continue;
 			else {
 				LOGE("sensorhubd socket "
-					"select() failed. errno "
+					"epoll_wait() failed. errno "
 					"is %d\n", errno);
 				exit(EXIT_FAILURE);
 			}
 		}
 
-		/* handle new connection request */
-		if (FD_ISSET(sockfd, &read_fds)) {
-			struct sockaddr_un client_addr;
-			socklen_t addrlen = sizeof(client_addr);
-			int clientfd = accept(sockfd,
-					(struct sockaddr *) &client_addr,
-					&addrlen);
-			if (clientfd == -1) {
-				LOGE("sensorhubd socket "
-					"accept() failed.\n");
-				exit(EXIT_FAILURE);
-			} else {
+		for (i = 0; i < nfds; i++) {
+			int fd = events[i].data.fd;
+
+			/* handle new connection request */
+			if (fd == sockfd) {
+				struct sockaddr_un client_addr;
+				socklen_t addrlen = sizeof(client_addr);
+				int clientfd = accept(sockfd,
+						(struct sockaddr *) &client_addr,
+						&addrlen);
+				if (clientfd == -1) {
+					LOGE("sensorhubd socket "
+						"accept() failed.\n");
+					exit(EXIT_FAILURE);
+				}
+
 				LOGI("new connection from client\n");
-				FD_SET(clientfd, &listen_fds);
-				if (clientfd > maxfd)
-					maxfd = clientfd;
+				add_listen_fd(epollfd, clientfd, EPOLLIN);
+				continue;
 			}
 
-			FD_CLR(sockfd, &read_fds);
-		}
-
-		/* get data from data node and dispatch it to clients, begin */
-		if (FD_ISSET(datasizefd, &datasize_fds)) {
-			dispatch_data();
-		}
-		/* get data from data node and dispatch it to clients, end */
-
-		/* handle request from clients */
-		int i;
-		for (i = maxfd; i >= 0; i--) {
-			char message[MAX_MESSAGE_LENGTH];
-
-			if (!FD_ISSET(i, &read_fds))
+			/* get data from data node and dispatch it to clients */
+			if (fd == datasizefd) {
+				dispatch_data();
 				continue;
+			}
 
-			int length = recv(i, message, MAX_MESSAGE_LENGTH, 0);
+			/* handle request from clients */
+			char message[MAX_MESSAGE_LENGTH];
+			int length = recv(fd, message, MAX_MESSAGE_LENGTH, 0);
 			if (length <= 0) {
 				/* release session resource if necessary */
-				remove_session_by_fd(i);
-				close(i);
-				log_message(DEBUG, "fd %d:error reading message \n", i);
-				FD_CLR(i, &listen_fds);
+				remove_session_by_fd(fd);
+				epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL);
+				close(fd);
+				log_message(DEBUG, "fd %d:error reading message \n", fd);
 			} else {
 				/* process message */
-				handle_message(i, message);
+				handle_message(fd, message);
 			}
 		}
 	}
@@ -2457,6 +2623,8 @@ static void get_status()
 	memcpy(sensor_list[current_sensor_index].name, "EVENT", SNR_NAME_MAX_LEN);
 	current_sensor_index++;
 
+	index_sensors();
+
 	gettimeofday(&tv1, NULL);
 	LOGI("latency of is get_status() is "
 		"%d \n", tv1.tv_usec - tv.tv_usec);
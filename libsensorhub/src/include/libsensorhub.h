@@ -183,6 +183,20 @@ error_t psh_get_calibration(handle_t handle, struct cmd_calibration_param * para
 /* return -1 if failed */
 int psh_get_fd(handle_t handle);
 
+/* receive the data of the session through a ring of at least size bytes
+   shared with sensorhubd instead of reading it from psh_get_fd(); the fd
+   then only becomes readable to wake the client up.
+   Call it before psh_start_streaming(): it fails while the session
+   streams, and data of an earlier stream still queued on the fd is
+   dropped.
+   Not available for SENSOR_EVENT. */
+error_t psh_enable_ring(handle_t handle, int size);
+
+/* return the size of the data copied in buf, 0 once there is no more data;
+   error_t if failure. Call it until it returns 0 before polling the fd again,
+   buf must hold the largest data sent at once */
+int psh_read_ring(handle_t handle, void *buf, int buf_size);
+
 /* relation: 0, AND; 1, OR; default is AND */
 error_t psh_event_set_relation(handle_t handle, relation relation);
 
@@ -19,6 +19,7 @@ typedef enum {
 	CMD_SET_CALIBRATION,
 	CMD_GET_CALIBRATION,
 	CMD_SET_PROPERTY,
+	CMD_MAP_RING,		// sensorhubd only, the ring fd comes with the ack
 	CMD_MAX
 } cmd_t;
 
@@ -0,0 +1,61 @@
+#ifndef _RING_H
+#define _RING_H
+
+/* Ring of sensor data shared between sensorhubd and one client session.
+   sensorhubd is the only writer and the client the only reader, so no lock
+   is taken: head is only moved by sensorhubd, tail only by the client.
+   Each record is a 4 bytes length followed by the payload, padded to 4 bytes.
+   The client mmaps the ring and the data socket only carries wakeups. */
+
+#define RING_MAGIC		0x52494e47
+#define RING_MIN_SIZE		(4 * 1024)
+#define RING_MAX_SIZE		(1024 * 1024)
+
+/* head and tail on their own cache line */
+struct ring_header {
+	unsigned int magic;
+	unsigned int size;
+	volatile unsigned int dropped;
+	char reserved0[52];
+	volatile unsigned int head;
+	char reserved1[60];
+	volatile unsigned int tail;
+	char reserved2[60];
+};
+
+/* the shared header can be written by the other side, so each side keeps
+   its own copy of the size and of the index it moves */
+typedef struct {
+	struct ring_header *hdr;
+	char *data;
+	unsigned int size;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int map_size;
+} ring_t;
+
+/* size rounded up to a power of two within [RING_MIN_SIZE, RING_MAX_SIZE] */
+unsigned int ring_data_size(unsigned int size);
+
+unsigned int ring_map_size(unsigned int data_size);
+
+/* writer side: format mem, which is ring_map_size(data_size) bytes */
+void ring_init(ring_t *ring, void *mem, unsigned int data_size);
+
+/* reader side: return 0 on success; -1 if mem does not hold a ring */
+int ring_attach(ring_t *ring, void *mem, unsigned int map_size);
+
+/* return 1 if the reader had read everything before and must be woken up,
+   0 if not, -1 if the record is dropped because the ring is full */
+int ring_write(ring_t *ring, const void *data, unsigned int len);
+
+/* copy the payloads of as many whole records as fit in buf and return the
+   number of bytes copied; 0 once the ring is empty; -1 if the next record
+   is larger than buf or the ring is corrupted.
+   The writer only wakes the reader up once it has returned 0, so it must be
+   called again until then before sleeping. */
+int ring_read(ring_t *ring, void *buf, unsigned int size);
+
+unsigned int ring_dropped(ring_t *ring);
+
+#endif
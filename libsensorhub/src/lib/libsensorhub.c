@@ -4,6 +4,8 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <errno.h>
 #include <linux/un.h>
 #include <assert.h>
 #include <cutils/sockets.h>
@@ -12,6 +14,7 @@
 #include "../include/socket.h"
 #include "../include/utils.h"
 #include "../include/bist.h"
+#include "../include/ring.h"
 
 #undef LOG_TAG
 #define LOG_TAG "LibsensorhubClient"
@@ -23,6 +26,7 @@ typedef struct {
 	char name[SNR_NAME_MAX_LEN + 1];
 	unsigned char evt_id;
 	struct cmd_event_param *evt_param;
+	ring_t *ring;
 } session_context_t;
 
 handle_t psh_open_session_with_name(char *name)
@@ -152,6 +156,7 @@ handle_t psh_open_session_with_name(char *name)
 	hello_with_sensor_type.name[len] = '\0';
 	session_context->evt_id = 0;
 	session_context->evt_param = evt_param;
+	session_context->ring = NULL;
 
 	return session_context;
 }
@@ -175,6 +180,10 @@ void psh_close_session(handle_t handle)
 
 	close(session_context->datafd);
 	close(session_context->ctlfd);
+	if (session_context->ring != NULL) {
+		munmap(session_context->ring->hdr, session_context->ring->map_size);
+		free(session_context->ring);
+	}
 	if (session_context->evt_param != NULL)
 		free(session_context->evt_param);
 	free(session_context);
@@ -347,6 +356,117 @@ int psh_get_fd(handle_t handle)
 	return session_context->datafd;
 }
 
+error_t psh_enable_ring(handle_t handle, int size)
+{
+	session_context_t *session_context = (session_context_t *)handle;
+	cmd_event cmd;
+	int ret, ring_fd = -1, map_size;
+	char message[MAX_MESSAGE_LENGTH];
+	char control[CMSG_SPACE(sizeof(int))];
+	cmd_ack_event *p_cmd_ack;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	ring_t *ring;
+	void *mem;
+
+	if (session_context == NULL)
+		return ERROR_NOT_AVAILABLE;
+
+	if (session_context->ring != NULL)
+		return ERROR_NONE;
+
+	cmd.event_type = EVENT_CMD;
+	cmd.cmd = CMD_MAP_RING;
+	cmd.parameter = size;
+	cmd.parameter1 = 0;
+	cmd.parameter2 = 0;
+
+	ret = send(session_context->ctlfd, &cmd, sizeof(cmd), 0);
+	if (ret <= 0)
+		return ERROR_MESSAGE_NOT_SENT;
+
+	iov.iov_base = message;
+	iov.iov_len = MAX_MESSAGE_LENGTH;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	ret = recvmsg(session_context->ctlfd, &msg, 0);
+	if (ret <= 0)
+		return ERROR_CAN_NOT_GET_REPLY;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if ((cmsg != NULL) && (cmsg->cmsg_level == SOL_SOCKET)
+		&& (cmsg->cmsg_type == SCM_RIGHTS))
+		memcpy(&ring_fd, CMSG_DATA(cmsg), sizeof(int));
+
+	p_cmd_ack = (cmd_ack_event *)message;
+	if (((unsigned int)ret < sizeof(cmd_ack_event) + sizeof(int))
+		|| (p_cmd_ack->event_type != EVENT_CMD_ACK)
+		|| (p_cmd_ack->ret != SUCCESS) || (ring_fd < 0)) {
+		if (ring_fd >= 0)
+			close(ring_fd);
+		return ERROR_NOT_AVAILABLE;
+	}
+
+	memcpy(&map_size, p_cmd_ack->buf, sizeof(int));
+
+	mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+	close(ring_fd);
+	if (mem == MAP_FAILED) {
+		LOGE("mmap of the ring failed, errno is %d \n", errno);
+		return ERROR_NOT_AVAILABLE;
+	}
+
+	ring = malloc(sizeof(ring_t));
+	if (ring == NULL) {
+		munmap(mem, map_size);
+		return ERROR_NOT_AVAILABLE;
+	}
+
+	if (ring_attach(ring, mem, map_size) != 0) {
+		LOGE("not a sensorhubd ring \n");
+		munmap(mem, map_size);
+		free(ring);
+		return ERROR_NOT_AVAILABLE;
+	}
+
+	session_context->ring = ring;
+
+	/* the session is stopped: what is left on datafd are records of an
+	   earlier stream. From now on it only carries wakeups */
+	while (recv(session_context->datafd, message, sizeof(message),
+						MSG_DONTWAIT) > 0)
+		;
+
+	return ERROR_NONE;
+}
+
+int psh_read_ring(handle_t handle, void *buf, int buf_size)
+{
+	session_context_t *session_context = (session_context_t *)handle;
+	char wakeup[64];
+	int ret;
+
+	if ((session_context == NULL) || (session_context->ring == NULL))
+		return ERROR_NOT_AVAILABLE;
+
+	/* datafd only carries wakeups once the ring is enabled. Consume them
+	   first: one sent after this is for data not read below */
+	while (recv(session_context->datafd, wakeup, sizeof(wakeup),
+						MSG_DONTWAIT) > 0)
+		;
+
+	ret = ring_read(session_context->ring, buf, buf_size);
+	if (ret < 0)
+		return ERROR_WRONG_PARAMETER;
+
+	return ret;
+}
+
 error_t psh_set_calibration(handle_t handle,
 			        struct cmd_calibration_param * param)
 {
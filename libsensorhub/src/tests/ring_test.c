@@ -0,0 +1,248 @@
+/* Host test of the ring shared by sensorhubd and its clients.
+   A fake psh firmware writes streaming packets to a fake sysfs data node,
+   the dispatcher parses them as sensorhubd does and writes the payloads to
+   the ring, a client thread reads them back. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "../include/ring.h"
+
+#define RESP_STREAMING		3
+#define BATCHES			2000
+#define SAMPLES_PER_BATCH	8
+
+struct cmd_resp {
+	unsigned char tran_id;
+	unsigned char cmd_type;
+	unsigned char sensor_id;
+	unsigned short data_len;
+	char buf[0];
+} __attribute__ ((packed));
+
+struct sample {
+	unsigned int seq;
+	short x;
+	short y;
+	short z;
+} __attribute__ ((packed));
+
+static char sysfs_dir[] = "/tmp/sensorhub_ring_testXXXXXX";
+static int notify_pipe[2], ack_pipe[2], wakeup_pair[2];
+static ring_t ring;
+static volatile int done;
+static unsigned int received, out_of_order;
+
+/* fake psh firmware: fill the data node, update data_size and notify */
+static void *firmware_thread(void *arg)
+{
+	char data[SAMPLES_PER_BATCH * (sizeof(struct cmd_resp) + sizeof(struct sample))];
+	char path[64], size_str[16];
+	unsigned int seq = 0;
+	int datafd, datasizefd, b, i, len;
+	char c;
+
+	snprintf(path, sizeof(path), "%s/data", sysfs_dir);
+	datafd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	snprintf(path, sizeof(path), "%s/data_size", sysfs_dir);
+	datasizefd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (datafd < 0 || datasizefd < 0) {
+		printf("can't create fake sysfs nodes in %s \n", sysfs_dir);
+		exit(EXIT_FAILURE);
+	}
+
+	for (b = 0; b < BATCHES; b++) {
+		char *p = data;
+
+		for (i = 0; i < SAMPLES_PER_BATCH; i++) {
+			struct cmd_resp *resp = (struct cmd_resp *)p;
+			struct sample s;
+
+			resp->tran_id = 0;
+			resp->cmd_type = RESP_STREAMING;
+			resp->sensor_id = 0;
+			resp->data_len = sizeof(s);
+			s.seq = seq++;
+			s.x = s.y = s.z = (short)s.seq;
+			memcpy(resp->buf, &s, sizeof(s));
+			p += sizeof(struct cmd_resp) + sizeof(s);
+		}
+
+		pwrite(datafd, data, p - data, 0);
+		len = snprintf(size_str, sizeof(size_str), "%d\n", (int)(p - data));
+		ftruncate(datasizefd, 0);
+		pwrite(datasizefd, size_str, len, 0);
+
+		/* sysfs_notify() */
+		write(notify_pipe[1], &c, 1);
+		read(ack_pipe[0], &c, 1);
+	}
+
+	close(notify_pipe[1]);
+	close(datafd);
+	close(datasizefd);
+
+	return NULL;
+}
+
+static void drain(char *buf, int size, unsigned int *next_seq)
+{
+	int ret, off;
+
+	while ((ret = ring_read(&ring, buf, size)) > 0) {
+		for (off = 0; off + (int)sizeof(struct sample) <= ret;
+				off += sizeof(struct sample)) {
+			struct sample *s = (struct sample *)(buf + off);
+
+			/* dropped records leave a gap, never a step back */
+			if (s->seq < *next_seq)
+				out_of_order++;
+			*next_seq = s->seq + 1;
+			received++;
+		}
+	}
+
+	if (ret < 0) {
+		printf("ring_read() failed \n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* client: sleep on the socket, read the ring when woken up */
+static void *client_thread(void *arg)
+{
+	char buf[1024], wakeup[64];
+	unsigned int next_seq = 0;
+	struct pollfd pfd;
+	int rounds = 0;
+
+	pfd.fd = wakeup_pair[1];
+	pfd.events = POLLIN;
+
+	while (1) {
+		int finished = done;
+
+		poll(&pfd, 1, 100);
+		while (recv(wakeup_pair[1], wakeup, sizeof(wakeup), MSG_DONTWAIT) > 0)
+			;
+
+		drain(buf, sizeof(buf), &next_seq);
+
+		if (finished)
+			break;
+
+		/* be a slow client now and then so that the ring fills up */
+		if ((++rounds % 256) == 0)
+			usleep(1000);
+	}
+
+	return NULL;
+}
+
+/* sensorhubd side, as dispatch_data() */
+static void dispatch(int datafd, int datasizefd)
+{
+	char buf[4096], size_str[8], *end, *p, wakeup = 0;
+	int ret, data_size;
+
+	ret = pread(datasizefd, size_str, sizeof(size_str) - 1, 0);
+	if (ret <= 0)
+		return;
+
+	size_str[ret] = '\0';
+	data_size = strtol(size_str, &end, 10);
+	if (end == size_str || data_size <= 0 || data_size > (int)sizeof(buf))
+		return;
+
+	if (pread(datafd, buf, data_size, 0) != data_size)
+		return;
+
+	for (p = buf; p < buf + data_size; ) {
+		struct cmd_resp *resp = (struct cmd_resp *)p;
+
+		if (resp->cmd_type == RESP_STREAMING
+			&& ring_write(&ring, resp->buf, resp->data_len) == 1)
+			send(wakeup_pair[0], &wakeup, 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		p += sizeof(struct cmd_resp) + resp->data_len;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t firmware, client;
+	struct epoll_event ev;
+	char path[64], c = 0, wakeup = 0;
+	unsigned int total = BATCHES * SAMPLES_PER_BATCH;
+	unsigned int data_size = ring_data_size(RING_MIN_SIZE);
+	int epollfd, datafd, datasizefd;
+	void *mem;
+
+	if (mkdtemp(sysfs_dir) == NULL || pipe(notify_pipe) != 0
+		|| pipe(ack_pipe) != 0
+		|| socketpair(AF_UNIX, SOCK_STREAM, 0, wakeup_pair) != 0) {
+		printf("setup failed, errno is %d \n", errno);
+		return 1;
+	}
+
+	mem = malloc(ring_map_size(data_size));
+	if (mem == NULL)
+		return 1;
+	ring_init(&ring, mem, data_size);
+
+	pthread_create(&firmware, NULL, firmware_thread, NULL);
+	pthread_create(&client, NULL, client_thread, NULL);
+
+	epollfd = epoll_create(1);
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = notify_pipe[0];
+	epoll_ctl(epollfd, EPOLL_CTL_ADD, notify_pipe[0], &ev);
+
+	/* the nodes exist once the firmware sent its first notification */
+	datafd = datasizefd = -1;
+	while (epoll_wait(epollfd, &ev, 1, -1) == 1) {
+		if (read(notify_pipe[0], &c, 1) != 1)
+			break;
+
+		if (datafd == -1) {
+			snprintf(path, sizeof(path), "%s/data", sysfs_dir);
+			datafd = open(path, O_RDONLY);
+			snprintf(path, sizeof(path), "%s/data_size", sysfs_dir);
+			datasizefd = open(path, O_RDONLY);
+		}
+
+		dispatch(datafd, datasizefd);
+		write(ack_pipe[1], &c, 1);
+	}
+
+	pthread_join(firmware, NULL);
+	done = 1;
+	send(wakeup_pair[0], &wakeup, 1, MSG_NOSIGNAL);
+	pthread_join(client, NULL);
+
+	printf("%u samples: %u received, %u dropped, %u out of order \n",
+			total, received, ring_dropped(&ring), out_of_order);
+
+	snprintf(path, sizeof(path), "%s/data", sysfs_dir);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/data_size", sysfs_dir);
+	unlink(path);
+	rmdir(sysfs_dir);
+
+	if (received + ring_dropped(&ring) != total || out_of_order != 0) {
+		printf("FAIL \n");
+		return 1;
+	}
+
+	printf("PASS \n");
+	return 0;
+}
@@ -0,0 +1,162 @@
+#include <string.h>
+
+#include "../include/ring.h"
+
+#define RECORD_HDR_SIZE		sizeof(unsigned int)
+#define RECORD_ALIGN(len)	(((len) + 3) & ~3U)
+
+unsigned int ring_data_size(unsigned int size)
+{
+	unsigned int data_size = RING_MIN_SIZE;
+
+	while (data_size < size && data_size < RING_MAX_SIZE)
+		data_size <<= 1;
+
+	return data_size;
+}
+
+unsigned int ring_map_size(unsigned int data_size)
+{
+	return sizeof(struct ring_header) + data_size;
+}
+
+void ring_init(ring_t *ring, void *mem, unsigned int data_size)
+{
+	memset(mem, 0, sizeof(struct ring_header));
+
+	ring->hdr = (struct ring_header *)mem;
+	ring->data = (char *)mem + sizeof(struct ring_header);
+	ring->size = data_size;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->map_size = ring_map_size(data_size);
+
+	ring->hdr->size = data_size;
+	__sync_synchronize();
+	ring->hdr->magic = RING_MAGIC;
+}
+
+int ring_attach(ring_t *ring, void *mem, unsigned int map_size)
+{
+	struct ring_header *hdr = (struct ring_header *)mem;
+	unsigned int data_size;
+
+	if (map_size < sizeof(struct ring_header) || hdr->magic != RING_MAGIC)
+		return -1;
+
+	data_size = hdr->size;
+	if (data_size < RING_MIN_SIZE || data_size > RING_MAX_SIZE
+		|| (data_size & (data_size - 1)) != 0
+		|| ring_map_size(data_size) > map_size)
+		return -1;
+
+	ring->hdr = hdr;
+	ring->data = (char *)mem + sizeof(struct ring_header);
+	ring->size = data_size;
+	ring->head = hdr->head;
+	ring->tail = hdr->tail;
+	ring->map_size = map_size;
+
+	return 0;
+}
+
+static void copy_in(ring_t *ring, unsigned int pos, const void *src,
+						unsigned int len)
+{
+	unsigned int off = pos & (ring->size - 1);
+	unsigned int first = ring->size - off;
+
+	if (first > len)
+		first = len;
+
+	memcpy(ring->data + off, src, first);
+	memcpy(ring->data, (const char *)src + first, len - first);
+}
+
+static void copy_out(ring_t *ring, unsigned int pos, void *dst,
+						unsigned int len)
+{
+	unsigned int off = pos & (ring->size - 1);
+	unsigned int first = ring->size - off;
+
+	if (first > len)
+		first = len;
+
+	memcpy(dst, ring->data + off, first);
+	memcpy((char *)dst + first, ring->data, len - first);
+}
+
+int ring_write(ring_t *ring, const void *data, unsigned int len)
+{
+	unsigned int head = ring->head;
+	unsigned int used, need;
+
+	used = head - ring->hdr->tail;
+	need = RECORD_HDR_SIZE + RECORD_ALIGN(len);
+
+	/* a tail ahead of head or too far behind is a broken reader */
+	if (len > ring->size || used > ring->size
+		|| need > ring->size - used) {
+		ring->hdr->dropped++;
+		return -1;
+	}
+
+	copy_in(ring, head, &len, RECORD_HDR_SIZE);
+	copy_in(ring, head + RECORD_HDR_SIZE, data, len);
+
+	/* the record is visible before the new head; the new head is visible
+	   before tail is read again, pairs with the barriers in ring_read() */
+	__sync_synchronize();
+	ring->head = head + need;
+	ring->hdr->head = ring->head;
+	__sync_synchronize();
+
+	return ring->hdr->tail == head;
+}
+
+int ring_read(ring_t *ring, void *buf, unsigned int size)
+{
+	char *p = (char *)buf;
+	unsigned int head, len, copied = 0;
+
+	head = ring->hdr->head;
+	__sync_synchronize();
+
+	while (ring->tail != head) {
+		if (head - ring->tail > ring->size)
+			return -1;
+
+		copy_out(ring, ring->tail, &len, RECORD_HDR_SIZE);
+		if (len > head - ring->tail - RECORD_HDR_SIZE)
+			return -1;
+
+		if (len > size - copied) {
+			if (copied == 0)
+				return -1;
+			break;
+		}
+
+		copy_out(ring, ring->tail + RECORD_HDR_SIZE, p + copied, len);
+		copied += len;
+		ring->tail += RECORD_HDR_SIZE + RECORD_ALIGN(len);
+
+		if (ring->tail == head) {
+			/* caught up: release the space, then look for records
+			   written before the writer could see it */
+			__sync_synchronize();
+			ring->hdr->tail = ring->tail;
+			__sync_synchronize();
+			head = ring->hdr->head;
+		}
+	}
+
+	__sync_synchronize();
+	ring->hdr->tail = ring->tail;
+
+	return copied;
+}
+
+unsigned int ring_dropped(ring_t *ring)
+{
+	return ring->hdr->dropped;
+}
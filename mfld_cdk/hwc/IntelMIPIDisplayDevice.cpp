@@ -940,6 +940,10 @@ bool IntelMIPIDisplayDevice::dump(char *buff,
     }
 
     *cur_len = mDumpLen;
+
+    if (mRotationBufProvider)
+        mRotationBufProvider->dump(buff, buff_len, cur_len);
+
     return ret;
 }
 
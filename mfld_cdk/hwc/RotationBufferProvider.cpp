@@ -28,6 +28,7 @@
 
 #include <cutils/log.h>
 #include "RotationBufferProvider.h"
+#include "IntelHWComposerCfg.h"
 
 
 #define CHECK_VA_STATUS_RETURN(FUNC) \
@@ -50,36 +51,26 @@ RotationBufferProvider::RotationBufferProvider(IntelWsbm* wsbm)
       mVaInitialized(false),
       mVaDpy(0),
       mVaCfg(0),
-      mVaCtx(0),
-      mVaBufFilter(0),
-      mSourceSurface(0),
       mDisplay(DISPLAYVALUE),
-      mWidth(0),
-      mHeight(0),
-      mTransform(0),
-      mRotatedWidth(0),
-      mRotatedHeight(0),
-      mRotatedStride(0),
-      mTargetIndex(0)
+      mCurrent(NULL),
+      mUseCount(0),
+      mFrames(0),
+      mContextHits(0),
+      mContextMisses(0),
+      mLastLatency(0),
+      mMaxLatency(0),
+      mTotalLatency(0),
+      mLastWait(0),
+      mMaxWait(0),
+      mTotalWait(0)
 {
-    for (int i = 0; i < MAX_SURFACE_NUM; i++) {
-        mKhandles[i] = 0;
-        mRotatedSurfaces[i] = 0;
-        mDrmBuf[i] = NULL;
-    }
+    memset(mContexts, 0, sizeof(mContexts));
 }
 
 RotationBufferProvider::~RotationBufferProvider()
 {
 }
 
-uint32_t RotationBufferProvider::getMilliseconds()
-{
-    struct timeval ptimeval;
-    gettimeofday(&ptimeval, NULL);
-    return (uint32_t)((ptimeval.tv_sec * 1000) + (ptimeval.tv_usec / 1000));
-}
-
 bool RotationBufferProvider::initialize()
 {
     if (NULL == mWsbm)
@@ -137,26 +128,28 @@ uint32_t RotationBufferProvider::createWsbmBuffer(int width, int height, void **
     return mWsbm->getKBufHandle(*buf);
 }
 
-bool RotationBufferProvider::createVaSurface(intel_gralloc_payload_t *payload, int transform, bool isTarget)
+bool RotationBufferProvider::createVaSurface(RotationContext *ctx,
+                                             intel_gralloc_payload_t *payload,
+                                             bool isTarget,
+                                             VASurfaceID *surface)
 {
     VAStatus vaStatus;
     VASurfaceAttributeTPI attribTpi;
     VASurfaceAttributeTPI *vaSurfaceAttrib = &attribTpi;
     int stride;
     unsigned int buffers;
-    VASurfaceID *surface;
     int width = 0, height = 0, bufferHeight = 0;
 
     if (isTarget) {
-        if (transFromHalToVa(transform) == VA_ROTATION_180) {
+        if (transFromHalToVa(ctx->transform) == VA_ROTATION_180) {
             width = payload->width;
             height = payload->height;
         } else {
             width = payload->height;
             height = payload->width;
         }
-        mRotatedWidth = width;
-        mRotatedHeight = height;
+        ctx->rotatedWidth = width;
+        ctx->rotatedHeight = height;
     } else {
         width = payload->width;
         height = payload->height;
@@ -185,19 +178,18 @@ bool RotationBufferProvider::createVaSurface(intel_gralloc_payload_t *payload, i
     vaSurfaceAttrib->buffers = &buffers;
 
     if (isTarget) {
-        int khandle = createWsbmBuffer(stride, bufferHeight, &mDrmBuf[mTargetIndex]);
+        RotationTarget *target = &ctx->targets[ctx->targetIndex];
+        int khandle = createWsbmBuffer(stride, bufferHeight, &target->drmBuf);
         if (khandle == 0) {
             ALOGE("failed to create buffer by wsbm");
             return false;
         }
 
-        mKhandles[mTargetIndex] = khandle;
+        target->khandle = khandle;
         vaSurfaceAttrib->buffers[0] = khandle;
-        mRotatedStride = stride;
-        surface = &mRotatedSurfaces[mTargetIndex];
+        ctx->rotatedStride = stride;
     } else {
         vaSurfaceAttrib->buffers[0] = payload->khandle;
-        surface = &mSourceSurface;
     }
 
     vaStatus = vaCreateSurfacesWithAttribute(mVaDpy,
@@ -212,9 +204,8 @@ bool RotationBufferProvider::createVaSurface(intel_gralloc_payload_t *payload, i
     return true;
 }
 
-bool RotationBufferProvider::startVA(intel_gralloc_payload_t *payload, int transform)
+bool RotationBufferProvider::startVA()
 {
-    bool ret = true;
     VAStatus vaStatus;
     VAEntrypoint *entryPoint;
     VAConfigAttrib attribDummy;
@@ -249,6 +240,8 @@ bool RotationBufferProvider::startVA(intel_gralloc_payload_t *payload, int trans
                                         VAProfileNone,
                                         entryPoint,
                                         &numEntryPoints);
+    if (vaStatus != VA_STATUS_SUCCESS)
+        free(entryPoint);
     CHECK_VA_STATUS_RETURN("vaQueryConfigEntrypoints");
 
     for (int i = 0; i < numEntryPoints; i++)
@@ -271,8 +264,29 @@ bool RotationBufferProvider::startVA(intel_gralloc_payload_t *payload, int trans
                               &mVaCfg);
     CHECK_VA_STATUS_RETURN("vaCreateConfig");
 
+    mVaInitialized = true;
+
+    return true;
+}
+
+bool RotationBufferProvider::createContext(RotationContext *ctx,
+                                           intel_gralloc_payload_t *payload,
+                                           int transform)
+{
+    VAStatus vaStatus;
+    bool ret;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->width = payload->width;
+    ctx->height = payload->height;
+    ctx->transform = transform;
+    ctx->pending = -1;
+    ctx->ready = -1;
+    // mark active so that a half created context is destroyed
+    ctx->active = true;
+
     // create first target surface
-    ret = createVaSurface(payload, transform, true);
+    ret = createVaSurface(ctx, payload, true, &ctx->targets[0].surface);
     if (ret == false) {
         ALOGE("failed to create target surface with attribute");
         return false;
@@ -283,14 +297,14 @@ bool RotationBufferProvider::startVA(intel_gralloc_payload_t *payload, int trans
                                payload->width,
                                payload->height,
                                0,
-                               &mRotatedSurfaces[0],
+                               &ctx->targets[0].surface,
                                1,
-                               &mVaCtx);
+                               &ctx->vaCtx);
     CHECK_VA_STATUS_RETURN("vaCreateContext");
 
     VAProcFilterType filters[VAProcFilterCount];
     unsigned int numFilters = VAProcFilterCount;
-    vaStatus = vaQueryVideoProcFilters(mVaDpy, mVaCtx, filters, &numFilters);
+    vaStatus = vaQueryVideoProcFilters(mVaDpy, ctx->vaCtx, filters, &numFilters);
     CHECK_VA_STATUS_RETURN("vaQueryVideoProcFilters");
 
     bool supportVideoProcFilter = false;
@@ -308,19 +322,19 @@ bool RotationBufferProvider::startVA(intel_gralloc_payload_t *payload, int trans
     filter.value = 0;
 
     vaStatus = vaCreateBuffer(mVaDpy,
-                              mVaCtx,
+                              ctx->vaCtx,
                               VAProcFilterParameterBufferType,
                               sizeof(filter),
                               1,
                               &filter,
-                              &mVaBufFilter);
+                              &ctx->vaBufFilter);
     CHECK_VA_STATUS_RETURN("vaCreateBuffer");
 
     VAProcPipelineCaps pipelineCaps;
     unsigned int numCaps = 1;
     vaStatus = vaQueryVideoProcPipelineCaps(mVaDpy,
-                                            mVaCtx,
-                                            &mVaBufFilter,
+                                            ctx->vaCtx,
+                                            &ctx->vaBufFilter,
                                             numCaps,
                                             &pipelineCaps);
     CHECK_VA_STATUS_RETURN("vaQueryVideoProcPipelineCaps");
@@ -331,74 +345,141 @@ bool RotationBufferProvider::startVA(intel_gralloc_payload_t *payload, int trans
         return false;
     }
 
-    mVaInitialized = true;
-
     return true;
 }
 
-bool RotationBufferProvider::setupRotationBuffer(intel_gralloc_payload_t *payload, int transform)
+void RotationBufferProvider::destroyContext(RotationContext *ctx)
 {
-#ifdef DEBUG_ROTATION_PERFROMANCE
-    uint32_t setup_Begin = getMilliseconds();
-#endif
+    bool ret;
     VAStatus vaStatus;
-    int stride;
-    bool ret = false;
 
-    if (payload->format != VA_FOURCC_NV12 || payload->width == 0 || payload->height == 0) {
-        ALOGE("payload data is not correct");
-        return ret;
+    if (!ctx->active)
+        return;
+
+    // the rotated buffers can't be freed while VA still writes to them
+    for (int i = 0; i < MAX_SURFACE_NUM; i++)
+        waitRotation(ctx, i);
+
+    for (int i = 0; i < MAX_SURFACE_NUM; i++) {
+        RotationTarget *target = &ctx->targets[i];
+
+        if (NULL != target->drmBuf) {
+            ret = mWsbm->destroyTTMBuffer(target->drmBuf);
+            if (!ret)
+                ALOGD("failed to free TTMBuffer");
+            target->drmBuf = NULL;
+        }
+
+        // remove wsbm buffer ref from VA
+        if (0 != target->surface) {
+            vaStatus = vaDestroySurfaces(mVaDpy, &target->surface, 1);
+            if (vaStatus != VA_STATUS_SUCCESS)
+                ALOGD("vaDestroySurfaces failed, vaStatus = %d", vaStatus);
+        }
+        target->surface = 0;
     }
 
-    do {
-        if (isContextChanged(payload->width, payload->height, transform)) {
-            ALOGD("Rotation config changes, will re-start VA");
+    if (0 != ctx->vaBufFilter)
+        vaDestroyBuffer(mVaDpy, ctx->vaBufFilter);
+    if (0 != ctx->vaCtx)
+        vaDestroyContext(mVaDpy, ctx->vaCtx);
 
-            if (mVaInitialized)
-                stopVA(); // need to re-initialize VA for new rotation config
+    if (mCurrent == ctx)
+        mCurrent = NULL;
 
-            mTransform = transform;
-            mWidth = payload->width;
-            mHeight = payload->height;
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+RotationBufferProvider::RotationContext*
+RotationBufferProvider::getContext(intel_gralloc_payload_t *payload, int transform)
+{
+    RotationContext *ctx = NULL;
+
+    for (int i = 0; i < MAX_CONTEXT_NUM; i++) {
+        RotationContext *c = &mContexts[i];
+        if (c->active &&
+            c->width == payload->width &&
+            c->height == payload->height &&
+            c->transform == transform) {
+            ctx = c;
+            break;
         }
+    }
 
-        if (!mVaInitialized) {
-            ret = startVA(payload, transform);
-            if (ret == false) {
-                vaStatus = VA_STATUS_ERROR_OPERATION_FAILED;
+    if (ctx) {
+        mContextHits++;
+    } else {
+        ALOGD("Rotation config changes, will switch VA context");
+        mContextMisses++;
+
+        // take a free context or evict the least recently used one
+        ctx = &mContexts[0];
+        for (int i = 0; i < MAX_CONTEXT_NUM; i++) {
+            RotationContext *c = &mContexts[i];
+            if (!c->active) {
+                ctx = c;
                 break;
             }
+            if (c->lastUse < ctx->lastUse)
+                ctx = c;
         }
 
-        // start to create next target surface
-        if (!mRotatedSurfaces[mTargetIndex]) {
-            ret = createVaSurface(payload, transform, true);
-            if (ret == false) {
-                ALOGE("failed to create target surface with attribute");
-                vaStatus = VA_STATUS_ERROR_OPERATION_FAILED;
-                break;
-            }
+        destroyContext(ctx);
+        if (!createContext(ctx, payload, transform)) {
+            destroyContext(ctx);
+            return NULL;
         }
+    }
+
+    if (mCurrent != ctx) {
+        // the rotation left behind in the previous context is shown no more
+        if (mCurrent && mCurrent->pending >= 0)
+            waitRotation(mCurrent, mCurrent->pending);
 
-        // create source surface
-        ret = createVaSurface(payload, transform, false);
+        // the rotated buffers of a warm context hold frames of the past
+        ctx->ready = -1;
+    }
+
+    mCurrent = ctx;
+    ctx->lastUse = ++mUseCount;
+    return ctx;
+}
+
+bool RotationBufferProvider::submitRotation(RotationContext *ctx,
+                                            intel_gralloc_payload_t *payload)
+{
+    VAStatus vaStatus = VA_STATUS_SUCCESS;
+    RotationTarget *target = &ctx->targets[ctx->targetIndex];
+    VABufferID pipelineBuf;
+    void *p;
+    VAProcPipelineParameterBuffer *pipelineParam;
+    bool ret;
+
+    // the target buffer is reused, VA has to be done with it
+    waitRotation(ctx, ctx->targetIndex);
+
+    // start to create next target surface
+    if (!target->surface) {
+        ret = createVaSurface(ctx, payload, true, &target->surface);
         if (ret == false) {
-            ALOGE("failed to create source surface with attribute");
-            vaStatus = VA_STATUS_ERROR_OPERATION_FAILED;
-            break;
+            ALOGE("failed to create target surface with attribute");
+            return false;
         }
+    }
 
-#ifdef DEBUG_ROTATION_PERFROMANCE
-        uint32_t beginPicture = getMilliseconds();
-#endif
-        vaStatus = vaBeginPicture(mVaDpy, mVaCtx, mRotatedSurfaces[mTargetIndex]);
+    // create source surface, it lives till the rotation finished
+    ret = createVaSurface(ctx, payload, false, &target->sourceSurface);
+    if (ret == false) {
+        ALOGE("failed to create source surface with attribute");
+        return false;
+    }
+
+    do {
+        vaStatus = vaBeginPicture(mVaDpy, ctx->vaCtx, target->surface);
         CHECK_VA_STATUS_BREAK("vaBeginPicture");
 
-        VABufferID pipelineBuf;
-        void *p;
-        VAProcPipelineParameterBuffer *pipelineParam;
         vaStatus = vaCreateBuffer(mVaDpy,
-                                  mVaCtx,
+                                  ctx->vaCtx,
                                   VAProcPipelineParameterBufferType,
                                   sizeof(*pipelineParam),
                                   1,
@@ -410,93 +491,167 @@ bool RotationBufferProvider::setupRotationBuffer(intel_gralloc_payload_t *payloa
         CHECK_VA_STATUS_BREAK("vaMapBuffer");
 
         pipelineParam = (VAProcPipelineParameterBuffer*)p;
-        pipelineParam->surface = mSourceSurface;
-        pipelineParam->rotation_state = transFromHalToVa(transform);
-        pipelineParam->filters = &mVaBufFilter;
+        pipelineParam->surface = target->sourceSurface;
+        pipelineParam->rotation_state = transFromHalToVa(ctx->transform);
+        pipelineParam->filters = &ctx->vaBufFilter;
         pipelineParam->num_filters = 1;
         vaStatus = vaUnmapBuffer(mVaDpy, pipelineBuf);
         CHECK_VA_STATUS_BREAK("vaUnmapBuffer");
 
-        vaStatus = vaRenderPicture(mVaDpy, mVaCtx, &pipelineBuf, 1);
+        vaStatus = vaRenderPicture(mVaDpy, ctx->vaCtx, &pipelineBuf, 1);
         CHECK_VA_STATUS_BREAK("vaRenderPicture");
 
-        vaStatus = vaEndPicture(mVaDpy, mVaCtx);
+        vaStatus = vaEndPicture(mVaDpy, ctx->vaCtx);
         CHECK_VA_STATUS_BREAK("vaEndPicture");
+    } while (0);
 
-        vaStatus = vaSyncSurface(mVaDpy, mRotatedSurfaces[mTargetIndex]);
-        CHECK_VA_STATUS_BREAK("vaSyncSurface");
+    if (vaStatus != VA_STATUS_SUCCESS) {
+        vaDestroySurfaces(mVaDpy, &target->sourceSurface, 1);
+        target->sourceSurface = 0;
+        return false;
+    }
 
-#ifdef DEBUG_ROTATION_PERFROMANCE
-        ALOGD("time spent %dms ...from vaBeginPicture to vaSyncSurface",
-             getMilliseconds() - beginPicture);
-#endif
+    target->sourceKhandle = payload->khandle;
+    target->submitTime = systemTime();
+    target->busy = true;
 
-        // Populate payload fields so that overlayPlane can flip the buffer
-        payload->rotated_width = mRotatedStride;
-        payload->rotated_height = mRotatedHeight;
-        payload->rotated_buffer_handle = mKhandles[mTargetIndex];
+    ctx->pending = ctx->targetIndex;
+    ctx->targetIndex++;
+    if (ctx->targetIndex >= MAX_SURFACE_NUM)
+        ctx->targetIndex = 0;
 
-        mTargetIndex++;
-        if (mTargetIndex >= MAX_SURFACE_NUM)
-            mTargetIndex = 0;
+    return true;
+}
 
-    } while(0);
+// wait for the rotation into a target buffer, like a fence
+bool RotationBufferProvider::waitRotation(RotationContext *ctx, int index)
+{
+    RotationTarget *target = &ctx->targets[index];
+    VASurfaceStatus status = VASurfaceRendering;
+    VAStatus vaStatus;
+    nsecs_t waitBegin, now;
 
-#ifdef DEBUG_ROTATION_PERFROMANCE
-    ALOGD("time spent %dms for setupRotationBuffer",
-         getMilliseconds() - setup_Begin);
-#endif
+    if (!target->busy)
+        return true;
 
-    if (mSourceSurface > 0) {
-        vaStatus = vaDestroySurfaces(mVaDpy, &mSourceSurface, 1);
-        if (vaStatus != VA_STATUS_SUCCESS)
-            ALOGD("vaDestroySurfaces failed, vaStatus = %d", vaStatus);
-        mSourceSurface = 0;
+    waitBegin = systemTime();
+    vaStatus = vaQuerySurfaceStatus(mVaDpy, target->surface, &status);
+    if (vaStatus != VA_STATUS_SUCCESS || status != VASurfaceReady)
+        vaStatus = vaSyncSurface(mVaDpy, target->surface);
+    now = systemTime();
+
+    target->busy = false;
+    if (0 != target->sourceSurface) {
+        vaDestroySurfaces(mVaDpy, &target->sourceSurface, 1);
+        target->sourceSurface = 0;
     }
 
+    if (ctx->pending == index)
+        ctx->pending = -1;
+
     if (vaStatus != VA_STATUS_SUCCESS) {
-        stopVA();
-        return false; // To not block in HWC, just abort instead of re-try
+        ALOGE("vaSyncSurface failed. vaStatus = %#x", vaStatus);
+        return false;
     }
 
+    // per frame rotation latency
+    mFrames++;
+    mLastLatency = now - target->submitTime;
+    mLastWait = now - waitBegin;
+    mTotalLatency += mLastLatency;
+    mTotalWait += mLastWait;
+    if (mLastLatency > mMaxLatency)
+        mMaxLatency = mLastLatency;
+    if (mLastWait > mMaxWait)
+        mMaxWait = mLastWait;
+
+    ALOGD_IF(ALLOW_OVERLAY_PRINT,
+             "rotation latency %lldus, waited %lldus",
+             ns2us(mLastLatency), ns2us(mLastWait));
+
     return true;
 }
 
-void RotationBufferProvider::freeVaSurfaces()
+void RotationBufferProvider::publish(RotationContext *ctx,
+                                     intel_gralloc_payload_t *payload)
 {
-    bool ret;
-    VAStatus vaStatus;
+    // Populate payload fields so that overlayPlane can flip the buffer
+    payload->rotated_width = ctx->rotatedStride;
+    payload->rotated_height = ctx->rotatedHeight;
+    payload->rotated_buffer_handle = ctx->targets[ctx->ready].khandle;
+}
 
-    for (int i = 0; i < MAX_SURFACE_NUM; i++) {
-        if (NULL != mDrmBuf[i]) {
-            ret = mWsbm->destroyTTMBuffer(mDrmBuf[i]);
-            if (!ret)
-                ALOGD("failed to free TTMBuffer");
-            mDrmBuf[i] = NULL;
-        }
+bool RotationBufferProvider::setupRotationBuffer(intel_gralloc_payload_t *payload, int transform)
+{
+    RotationContext *ctx;
+    int previous;
+
+    if (payload->format != VA_FOURCC_NV12 || payload->width == 0 || payload->height == 0) {
+        ALOGE("payload data is not correct");
+        return false;
     }
 
-    // remove wsbm buffer ref from VA
-    for (int j = 0; j < MAX_SURFACE_NUM; j++) {
-        if (0 != mRotatedSurfaces[j]) {
-            vaStatus = vaDestroySurfaces(mVaDpy, &mRotatedSurfaces[j], 1);
-            if (vaStatus != VA_STATUS_SUCCESS)
-                ALOGD("vaDestroySurfaces failed, vaStatus = %d", vaStatus);
-        }
-        mRotatedSurfaces[j] = 0;
+    if (!mVaInitialized && !startVA()) {
+        stopVA();
+        return false;
+    }
+
+    ctx = getContext(payload, transform);
+    if (!ctx)
+        return false;
+
+    // the source buffer was submitted already, e.g. a paused video or a
+    // second composition within a video frame
+    if (ctx->pending >= 0 &&
+        ctx->targets[ctx->pending].sourceKhandle == payload->khandle) {
+        previous = ctx->pending;
+        if (!waitRotation(ctx, previous))
+            goto rotation_err;
+        ctx->ready = previous;
+        publish(ctx, payload);
+        return true;
+    }
+
+    // decoders reuse their buffers, a khandle matches the shown rotation
+    // only while no newer source was submitted
+    if (ctx->pending < 0 && ctx->ready >= 0 &&
+        ctx->targets[ctx->ready].sourceKhandle == payload->khandle) {
+        publish(ctx, payload);
+        return true;
+    }
+
+    previous = ctx->pending;
+    if (!submitRotation(ctx, payload))
+        goto rotation_err;
+
+    // show the previous rotation, which has finished meanwhile, and leave
+    // the new one in flight. The first frame of a context has nothing to
+    // show yet and waits for its own
+    if (previous < 0 && ctx->ready < 0)
+        previous = ctx->pending;
+
+    if (previous >= 0) {
+        if (!waitRotation(ctx, previous))
+            goto rotation_err;
+        ctx->ready = previous;
     }
+
+    publish(ctx, payload);
+    return true;
+
+rotation_err:
+    // To not block in HWC, just abort instead of re-try
+    destroyContext(ctx);
+    return false;
 }
 
 void RotationBufferProvider::stopVA()
 {
-    freeVaSurfaces();
+    for (int i = 0; i < MAX_CONTEXT_NUM; i++)
+        destroyContext(&mContexts[i]);
 
-    if (0 != mVaBufFilter)
-        vaDestroyBuffer(mVaDpy, mVaBufFilter);
     if (0 != mVaCfg)
         vaDestroyConfig(mVaDpy,mVaCfg);
-    if (0 != mVaCtx)
-        vaDestroyContext(mVaDpy, mVaCtx);
     if (0 != mVaDpy)
         vaTerminate(mVaDpy);
 
@@ -505,27 +660,37 @@ void RotationBufferProvider::stopVA()
     // reset VA variable
     mVaDpy = 0;
     mVaCfg = 0;
-    mVaCtx = 0;
-    mVaBufFilter = 0;
-    mSourceSurface = 0;
-
-    mWidth = 0;
-    mHeight = 0;
-    mRotatedWidth = 0;
-    mRotatedHeight = 0;
-    mRotatedStride = 0;
-    mTargetIndex = 0;
+    mCurrent = NULL;
 }
 
-bool RotationBufferProvider::isContextChanged(int width, int height, int transform)
+bool RotationBufferProvider::dump(char *buff, int buff_len, int *cur_len)
 {
-    // check rotation config
-    if (height == mHeight &&
-        width == mWidth &&
-        transform == mTransform) {
-        return false;
+    mDumpBuf = buff;
+    mDumpBuflen = buff_len;
+    mDumpLen = *cur_len;
+
+    dumpPrintf("-------------Rotation Buffer Provider -------------\n");
+    dumpPrintf("  + VA initialized: %d \n", mVaInitialized);
+    for (int i = 0; i < MAX_CONTEXT_NUM; i++) {
+        RotationContext *ctx = &mContexts[i];
+        if (!ctx->active)
+            continue;
+        dumpPrintf("  + context %d: %ux%u, transform %d%s \n", i,
+                   ctx->width, ctx->height, ctx->transform,
+                   (ctx == mCurrent) ? ", current" : "");
+    }
+    dumpPrintf("  + context hits: %d, misses: %d \n",
+               mContextHits, mContextMisses);
+    dumpPrintf("  + rotated frames: %d \n", mFrames);
+    if (mFrames) {
+        dumpPrintf("  + latency: last %lldus, avg %lldus, max %lldus \n",
+                   ns2us(mLastLatency), ns2us(mTotalLatency / mFrames),
+                   ns2us(mMaxLatency));
+        dumpPrintf("  + wait: last %lldus, avg %lldus, max %lldus \n",
+                   ns2us(mLastWait), ns2us(mTotalWait / mFrames),
+                   ns2us(mMaxWait));
     }
 
+    *cur_len = mDumpLen;
     return true;
 }
-
@@ -37,12 +37,26 @@
 #include <utils/Timers.h>
 #include <va/va_android.h>
 #include "IntelBufferManager.h"
+#include "IntelHWComposerDump.h"
 
 #define Display unsigned int
 typedef void* VADisplay;
 typedef int VAStatus;
 
-class RotationBufferProvider {
+// RotationBufferProvider: rotate video buffers with VA for the overlay.
+//
+// A rotation context (VA context, filter and rotated buffers) is needed
+// for each source size and transform. Contexts are kept in a small pool
+// with LRU eviction, so turning the device back and forth doesn't tear
+// down and rebuild VA each time.
+//
+// Rotation is pipelined one frame ahead: the rotation of a new source
+// buffer is submitted, and the overlay is given the rotation of the
+// previous one, which has finished by then. The rotated buffer of each
+// submission works as a fence, it is waited for before it is shown. Only
+// the first frame of a context, or a source buffer shown again, waits for
+// its own rotation.
+class RotationBufferProvider : public IntelHWComposerDump {
 
 public:
     RotationBufferProvider(IntelWsbm* wsbm);
@@ -51,45 +65,84 @@ public:
     bool initialize();
     void deinitialize();
     bool setupRotationBuffer(intel_gralloc_payload_t *payload, int transform);
+    bool dump(char *buff, int buff_len, int *cur_len);
 
 private:
-    bool startVA(intel_gralloc_payload_t *payload, int transform);
+    enum {
+        MAX_SURFACE_NUM = 4,
+        MAX_CONTEXT_NUM = 2,
+    };
+
+    // a rotated buffer, and the rotation into it while it is in flight
+    struct RotationTarget {
+        VASurfaceID surface;
+        void *drmBuf;
+        uint32_t khandle;
+        VASurfaceID sourceSurface;
+        uint32_t sourceKhandle;
+        nsecs_t submitTime;
+        bool busy;
+    };
+
+    struct RotationContext {
+        bool active;
+        uint32_t lastUse;
+        // rotation config variables, as in the gralloc payload
+        uint32_t width;
+        uint32_t height;
+        int transform;
+        VAContextID vaCtx;
+        VABufferID vaBufFilter;
+
+        int rotatedWidth;
+        int rotatedHeight;
+        int rotatedStride;
+
+        int targetIndex;
+        // last submitted and last finished rotation, -1 if none
+        int pending;
+        int ready;
+        RotationTarget targets[MAX_SURFACE_NUM];
+    };
+
+private:
+    bool startVA();
     void stopVA();
-    bool isContextChanged(int width, int height, int transform);
+    RotationContext* getContext(intel_gralloc_payload_t *payload, int transform);
+    bool createContext(RotationContext *ctx,
+                       intel_gralloc_payload_t *payload, int transform);
+    void destroyContext(RotationContext *ctx);
+    bool submitRotation(RotationContext *ctx, intel_gralloc_payload_t *payload);
+    bool waitRotation(RotationContext *ctx, int index);
+    void publish(RotationContext *ctx, intel_gralloc_payload_t *payload);
     int transFromHalToVa(int transform);
     uint32_t createWsbmBuffer(int width, int height, void **buf);
     int getStride(bool isTarget, int width);
-    bool createVaSurface(intel_gralloc_payload_t *payload, int transform, bool isTarget);
-    void freeVaSurfaces();
-    inline uint32_t getMilliseconds();
+    bool createVaSurface(RotationContext *ctx, intel_gralloc_payload_t *payload,
+                         bool isTarget, VASurfaceID *surface);
 
 private:
-    enum {
-        MAX_SURFACE_NUM = 4
-    };
-
     IntelWsbm* mWsbm;
     bool mVaInitialized;
     VADisplay mVaDpy;
     VAConfigID mVaCfg;
-    VAContextID mVaCtx;
-    VABufferID mVaBufFilter;
-    VASurfaceID mSourceSurface;
     Display mDisplay;
 
-    // rotation config variables
-    int mWidth;
-    int mHeight;
-    int mTransform;
-
-    int mRotatedWidth;
-    int mRotatedHeight;
-    int mRotatedStride;
+    RotationContext mContexts[MAX_CONTEXT_NUM];
+    RotationContext *mCurrent;
+    uint32_t mUseCount;
 
-    int mTargetIndex;
-    int mKhandles[MAX_SURFACE_NUM];
-    VASurfaceID mRotatedSurfaces[MAX_SURFACE_NUM];
-    void *mDrmBuf[MAX_SURFACE_NUM];
+    // statistics. Latency is from submitting a rotation till it was seen
+    // finished, wait is the time the composition blocked for it.
+    uint32_t mFrames;
+    uint32_t mContextHits;
+    uint32_t mContextMisses;
+    nsecs_t mLastLatency;
+    nsecs_t mMaxLatency;
+    nsecs_t mTotalLatency;
+    nsecs_t mLastWait;
+    nsecs_t mMaxWait;
+    nsecs_t mTotalWait;
 };
 
 #endif
@@ -16,3 +16,35 @@ LOCAL_MODULE:= hwc-overlay
 LOCAL_MODULE_TAGS := eng
 
 include $(BUILD_EXECUTABLE)
+
+# rotation pipeline of RotationBufferProvider, against a fake libva
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	rotation_test.cpp \
+	../RotationBufferProvider.cpp \
+	../IntelHWComposerDump.cpp
+
+# same headers as the hwcomposer module
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. \
+	$(addprefix $(LOCAL_PATH)/../../../, $(SGX_INCLUDES)) \
+	$(call include-path-for, frameworks-native)/media/openmax \
+	$(TARGET_OUT_HEADERS)/pvr/hal \
+	$(TARGET_OUT_HEADERS)/pvr/pvr2d \
+	$(TARGET_OUT_HEADERS)/pvr/include4 \
+	$(TARGET_OUT_HEADERS)/libwsbm/wsbm \
+	$(TARGET_OUT_HEADERS)/libva \
+	$(TARGET_OUT_HEADERS)/libwsbm
+
+LOCAL_CFLAGS := -DLOG_TAG=\"hwc_rotation_test\" -DLINUX
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE:= hwc_rotation_test
+
+LOCAL_MODULE_TAGS := eng
+
+include $(BUILD_EXECUTABLE)
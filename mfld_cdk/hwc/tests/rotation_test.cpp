@@ -0,0 +1,298 @@
+/*
+ * Copyright © 2012 Intel Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+// Checks the rotation pipeline of RotationBufferProvider against a fake
+// libva: a submitted rotation keeps rendering until a newer one is
+// submitted or it is synced, like the VED does with back to back frames.
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+
+#include "RotationBufferProvider.h"
+#include "IntelHWComposerCfg.h"
+
+hwc_cfg cfg;
+
+static int gErrors;
+
+// not assert(): NDEBUG builds must still run and check every call
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            gErrors++; \
+        } \
+    } while (0)
+
+// fake wsbm, rotated buffers are only handed around by khandle
+static int gTTMBuffers;
+static uint32_t gNextKhandle = 0x100;
+
+IntelWsbm::IntelWsbm(int drmFD) : mDrmFD(drmFD) {}
+IntelWsbm::~IntelWsbm() {}
+
+bool IntelWsbm::allocateTTMBuffer(uint32_t size, uint32_t align, void **buf)
+{
+    *buf = new uint32_t(gNextKhandle++);
+    gTTMBuffers++;
+    return true;
+}
+
+bool IntelWsbm::destroyTTMBuffer(void *buf)
+{
+    delete (uint32_t *)buf;
+    gTTMBuffers--;
+    return true;
+}
+
+uint32_t IntelWsbm::getKBufHandle(void *buf)
+{
+    return *(uint32_t *)buf;
+}
+
+// fake libva
+static unsigned int gNextId = 1;
+static int gSurfaces;
+static int gContexts;
+static int gSyncs;
+static std::map<VASurfaceID, uint32_t> gSurfaceKhandle;
+static std::map<uint32_t, uint32_t> gRotatedFrom;
+static VASurfaceID gTarget;
+static VASurfaceID gRendering;
+static VAProcPipelineParameterBuffer gPipeline;
+
+VADisplay vaGetDisplay(void *dpy) { return dpy; }
+VAStatus vaInitialize(VADisplay dpy, int *major, int *minor) { return VA_STATUS_SUCCESS; }
+int vaMaxNumEntrypoints(VADisplay dpy) { return 1; }
+VAStatus vaTerminate(VADisplay dpy) { return VA_STATUS_SUCCESS; }
+
+VAStatus vaQueryConfigEntrypoints(VADisplay dpy, VAProfile profile,
+                                  VAEntrypoint *entrypoints, int *num)
+{
+    entrypoints[0] = VAEntrypointVideoProc;
+    *num = 1;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreateConfig(VADisplay dpy, VAProfile profile, VAEntrypoint entrypoint,
+                        VAConfigAttrib *attribs, int num, VAConfigID *config)
+{
+    *config = gNextId++;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyConfig(VADisplay dpy, VAConfigID config) { return VA_STATUS_SUCCESS; }
+
+VAStatus vaCreateSurfacesWithAttribute(VADisplay dpy, int width, int height,
+                                       int format, int num, VASurfaceID *surfaces,
+                                       VASurfaceAttributeTPI *attribs)
+{
+    surfaces[0] = gNextId++;
+    gSurfaceKhandle[surfaces[0]] = attribs->buffers[0];
+    gSurfaces++;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroySurfaces(VADisplay dpy, VASurfaceID *surfaces, int num)
+{
+    // VA must not be writing to a surface which is destroyed
+    CHECK(surfaces[0] != gRendering);
+    gSurfaces--;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreateContext(VADisplay dpy, VAConfigID config, int width, int height,
+                         int flag, VASurfaceID *targets, int num, VAContextID *context)
+{
+    *context = gNextId++;
+    gContexts++;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyContext(VADisplay dpy, VAContextID context)
+{
+    gContexts--;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaQueryVideoProcFilters(VADisplay dpy, VAContextID context,
+                                 VAProcFilterType *filters, unsigned int *num)
+{
+    filters[0] = VAProcFilterNone;
+    *num = 1;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaQueryVideoProcPipelineCaps(VADisplay dpy, VAContextID context,
+                                      VABufferID *filters, unsigned int num,
+                                      VAProcPipelineCaps *caps)
+{
+    caps->rotation_flags = (1 << VA_ROTATION_NONE) | (1 << VA_ROTATION_90) |
+                           (1 << VA_ROTATION_180) | (1 << VA_ROTATION_270);
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreateBuffer(VADisplay dpy, VAContextID context, VABufferType type,
+                        unsigned int size, unsigned int num, void *data,
+                        VABufferID *buf)
+{
+    *buf = gNextId++;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyBuffer(VADisplay dpy, VABufferID buf) { return VA_STATUS_SUCCESS; }
+
+VAStatus vaMapBuffer(VADisplay dpy, VABufferID buf, void **p)
+{
+    *p = &gPipeline;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaUnmapBuffer(VADisplay dpy, VABufferID buf) { return VA_STATUS_SUCCESS; }
+
+VAStatus vaBeginPicture(VADisplay dpy, VAContextID context, VASurfaceID target)
+{
+    gTarget = target;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaRenderPicture(VADisplay dpy, VAContextID context,
+                         VABufferID *buffers, int num)
+{
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaEndPicture(VADisplay dpy, VAContextID context)
+{
+    // the older rotation has finished when a new one starts
+    gRendering = gTarget;
+    gRotatedFrom[gSurfaceKhandle[gTarget]] = gSurfaceKhandle[gPipeline.surface];
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaQuerySurfaceStatus(VADisplay dpy, VASurfaceID surface,
+                              VASurfaceStatus *status)
+{
+    *status = (surface == gRendering) ? VASurfaceRendering : VASurfaceReady;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaSyncSurface(VADisplay dpy, VASurfaceID surface)
+{
+    if (surface == gRendering) {
+        gRendering = 0;
+        gSyncs++;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static bool rotate(RotationBufferProvider& provider,
+                   intel_gralloc_payload_t& payload,
+                   uint32_t khandle, int transform)
+{
+    payload.khandle = khandle;
+    payload.rotated_buffer_handle = 0;
+    return provider.setupRotationBuffer(&payload, transform);
+}
+
+int main(int argc, char **argv)
+{
+    IntelWsbm wsbm(-1);
+    RotationBufferProvider provider(&wsbm);
+    intel_gralloc_payload_t payload;
+    bool ok;
+
+    memset(&payload, 0, sizeof(payload));
+    payload.format = VA_FOURCC_NV12;
+    payload.width = 1280;
+    payload.height = 720;
+
+    ok = provider.initialize();
+    CHECK(ok);
+
+    // first frame of a context waits for its own rotation
+    ok = rotate(provider, payload, 0x1000, HAL_TRANSFORM_ROT_90);
+    CHECK(ok);
+    CHECK(gRotatedFrom[payload.rotated_buffer_handle] == 0x1000);
+    CHECK(gSyncs == 1);
+
+    // later frames show the rotation of the previous source, the new one
+    // stays in flight and nobody blocks
+    for (uint32_t k = 0x1001; k < 0x1010; k++) {
+        ok = rotate(provider, payload, k, HAL_TRANSFORM_ROT_90);
+        CHECK(ok);
+        CHECK(gRotatedFrom[payload.rotated_buffer_handle] == k - 1);
+        CHECK(payload.rotated_width == 1024);
+        CHECK(payload.rotated_height == 1280);
+    }
+    CHECK(gSyncs == 1);
+
+    // a source composed again (paused video) shows its own rotation
+    ok = rotate(provider, payload, 0x100f, HAL_TRANSFORM_ROT_90);
+    CHECK(ok);
+    CHECK(gRotatedFrom[payload.rotated_buffer_handle] == 0x100f);
+    CHECK(gSyncs == 2);
+
+    // a decoder buffer reused with new content is rotated again
+    ok = rotate(provider, payload, 0x1001, HAL_TRANSFORM_ROT_90);
+    CHECK(ok);
+    ok = rotate(provider, payload, 0x1001, HAL_TRANSFORM_ROT_90);
+    CHECK(ok);
+    CHECK(gRotatedFrom[payload.rotated_buffer_handle] == 0x1001);
+
+    // turning the device switches to a warm context, whose old rotations
+    // must not be shown again
+    ok = rotate(provider, payload, 0x2000, HAL_TRANSFORM_ROT_270);
+    CHECK(ok);
+    CHECK(gRotatedFrom[payload.rotated_buffer_handle] == 0x2000);
+    ok = rotate(provider, payload, 0x2001, HAL_TRANSFORM_ROT_90);
+    CHECK(ok);
+    CHECK(gRotatedFrom[payload.rotated_buffer_handle] == 0x2001);
+    CHECK(gContexts == 2);
+
+    // a third configuration evicts the least recently used context
+    payload.width = 1920;
+    payload.height = 1080;
+    ok = rotate(provider, payload, 0x3000, HAL_TRANSFORM_ROT_180);
+    CHECK(ok);
+    CHECK(gRotatedFrom[payload.rotated_buffer_handle] == 0x3000);
+    CHECK(gContexts == 2);
+
+    char buf[2048];
+    int len = 0;
+    provider.dump(buf, sizeof(buf), &len);
+    fputs(buf, stdout);
+
+    provider.deinitialize();
+    CHECK(gSurfaces == 0 && gContexts == 0 && gTTMBuffers == 0);
+
+    if (gErrors) {
+        printf("rotation test FAILED: %d errors\n", gErrors);
+        return 1;
+    }
+    printf("rotation test passed\n");
+    return 0;
+}
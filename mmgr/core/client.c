@@ -25,15 +25,38 @@
 #include "logs.h"
 #include "data_to_msg.h"
 #include "msg_format.h"
+#include "tty.h"
 #include <time.h>
 
 #define NEW_CLIENT_NAME "unknown"
+/* messages waiting for a slow client. When full, the oldest is dropped */
+#define CLIENT_QUEUE_LEN 16
 
 typedef e_mmgr_errors_t (*set_msg) (msg_t *, mmgr_cli_event_t *);
 
+typedef struct client_msg {
+    char *data;
+    size_t len;
+} client_msg_t;
+
+typedef struct client_queue {
+    client_msg_t msg[CLIENT_QUEUE_LEN];
+    int head;
+    int count;
+    /* bytes of the head message already sent */
+    size_t offset;
+    bool pollout;
+    /* metrics */
+    int max_depth;
+    int dropped;
+    int sent;
+} client_queue_t;
+
 typedef struct client {
     char name[CLIENT_NAME_LEN + 1];
     int fd;
+    int epollfd;
+    client_queue_t queue;
     struct timespec time;
     e_mmgr_requests_t request;
     uint32_t subscription;
@@ -46,6 +69,9 @@ typedef struct client_list {
     int list_size;
     int connected;
     client_t *list;
+    /* clients indexed by their file descriptor */
+    client_t **fd_index;
+    int fd_index_size;
     set_msg set_data[E_MMGR_NUM_EVENTS];
 } client_list_t;
 
@@ -157,15 +183,15 @@ static inline e_mmgr_errors_t reset_ack(clients_hdle_t *h,
  *
  * @param [in] client current client
  * @param [in] fd client file descriptor
- *
- * @return E_ERR_FAILED if at least one client has not acknowledge
- * @return E_ERR_SUCCESS if successful
+ * @param [in] epollfd epoll fd listening the client
  */
-static inline void init_client(client_t *client, int fd)
+static inline void init_client(client_t *client, int fd, int epollfd)
 {
     ASSERT(client != NULL);
 
     client->fd = fd;
+    client->epollfd = epollfd;
+    memset(&client->queue, 0, sizeof(client->queue));
     client->cnx = E_CNX_RESOURCE_RELEASED;
     /* users should be registered to these events */
     client->subscription = (0x1 << E_MMGR_ACK) | (0x1 << E_MMGR_NACK);
@@ -173,6 +199,137 @@ static inline void init_client(client_t *client, int fd)
     clock_gettime(CLOCK_MONOTONIC, &client->time);
 }
 
+/**
+ * free the messages waiting for the client and stop waiting for EPOLLOUT
+ *
+ * @private
+ *
+ * @param [in,out] client current client
+ */
+static void queue_clear(client_t *client)
+{
+    client_queue_t *queue = NULL;
+
+    ASSERT(client != NULL);
+
+    queue = &client->queue;
+    while (queue->count > 0) {
+        free(queue->msg[queue->head].data);
+        queue->msg[queue->head].data = NULL;
+        queue->head = (queue->head + 1) % CLIENT_QUEUE_LEN;
+        queue->count--;
+    }
+    queue->offset = 0;
+
+    if (queue->pollout && (client->fd != CLOSED_FD))
+        tty_update_listen_fd(client->epollfd, client->fd, EPOLLIN);
+    queue->pollout = false;
+}
+
+/**
+ * queue a message for the client. The message data is owned by the queue.
+ * If the queue is full, the oldest message not being sent is dropped
+ *
+ * @private
+ *
+ * @param [in,out] client current client
+ * @param [in] data message to queue
+ * @param [in] len message length
+ */
+static void queue_push(client_t *client, char *data, size_t len)
+{
+    client_queue_t *queue = NULL;
+    int i;
+
+    ASSERT(client != NULL);
+    ASSERT(data != NULL);
+
+    queue = &client->queue;
+    if (queue->count == CLIENT_QUEUE_LEN) {
+        /* a partially sent message must be completed, otherwise the
+         * stream is corrupted */
+        i = queue->head;
+        if (queue->offset > 0)
+            i = (i + 1) % CLIENT_QUEUE_LEN;
+        free(queue->msg[i].data);
+        for (; i != (queue->head + queue->count - 1) % CLIENT_QUEUE_LEN;
+             i = (i + 1) % CLIENT_QUEUE_LEN)
+            queue->msg[i] = queue->msg[(i + 1) % CLIENT_QUEUE_LEN];
+        queue->count--;
+        /* do not flood the logs with a stuck client */
+        if ((queue->dropped++ % CLIENT_QUEUE_LEN) == 0)
+            LOG_ERROR("client (fd=%d name=%s) too slow. event dropped "
+                      "(total: %d)", client->fd, client->name,
+                      queue->dropped);
+    }
+
+    i = (queue->head + queue->count) % CLIENT_QUEUE_LEN;
+    queue->msg[i].data = data;
+    queue->msg[i].len = len;
+    queue->count++;
+    if (queue->count > queue->max_depth)
+        queue->max_depth = queue->count;
+}
+
+/**
+ * send as many queued messages as the client socket accepts without
+ * blocking. EPOLLOUT is listened as long as messages are waiting
+ *
+ * @private
+ *
+ * @param [in,out] client current client
+ *
+ * @return E_ERR_FAILED if send fails. queued messages are dropped
+ * @return E_ERR_SUCCESS if successful
+ */
+static e_mmgr_errors_t queue_flush(client_t *client)
+{
+    e_mmgr_errors_t ret = E_ERR_SUCCESS;
+    client_queue_t *queue = NULL;
+    client_msg_t *msg = NULL;
+    size_t len;
+    bool pollout;
+
+    ASSERT(client != NULL);
+
+    queue = &client->queue;
+    while (queue->count > 0) {
+        msg = &queue->msg[queue->head];
+        len = msg->len - queue->offset;
+        ret = cnx_send(client->fd, msg->data + queue->offset, &len);
+        if (ret != E_ERR_SUCCESS) {
+            LOG_ERROR("send failed for client (fd=%d name=%s). %d event(s) "
+                      "dropped", client->fd, client->name, queue->count);
+            queue->dropped += queue->count;
+            queue_clear(client);
+            goto out;
+        }
+        if (len == 0)
+            break;
+
+        queue->offset += len;
+        if (queue->offset == msg->len) {
+            free(msg->data);
+            msg->data = NULL;
+            queue->offset = 0;
+            queue->head = (queue->head + 1) % CLIENT_QUEUE_LEN;
+            queue->count--;
+            queue->sent++;
+        }
+    }
+
+    pollout = queue->count > 0;
+    if (pollout != queue->pollout) {
+        ret = tty_update_listen_fd(client->epollfd, client->fd,
+                                   pollout ? EPOLLIN | EPOLLOUT : EPOLLIN);
+        if (ret == E_ERR_SUCCESS)
+            queue->pollout = pollout;
+    }
+
+out:
+    return ret;
+}
+
 /**
  * remove client from client's list
  *
@@ -194,11 +351,21 @@ static e_mmgr_errors_t remove_from_list(client_list_t *clients, int fd)
     if (CLOSED_FD != fd) {
         for (i = 0; i < clients->list_size; i++) {
             if (fd == clients->list[i].fd) {
+                client_queue_t *queue = &clients->list[i].queue;
+
                 clients->connected--;
                 LOG_INFO("client (fd=%d name=%s) removed. still connected: %d",
                          clients->list[i].fd, clients->list[i].name,
                          clients->connected);
+                LOG_INFO("client (name=%s) events sent: %d, dropped: %d, "
+                         "max queue depth: %d", clients->list[i].name,
+                         queue->sent, queue->dropped + queue->count,
+                         queue->max_depth);
+                /* the fd is closed right after: epoll forgets it */
                 clients->list[i].fd = CLOSED_FD;
+                queue_clear(&clients->list[i]);
+                if (fd < clients->fd_index_size)
+                    clients->fd_index[fd] = NULL;
                 ret = E_ERR_SUCCESS;
                 break;
             }
@@ -232,7 +399,7 @@ clients_hdle_t *clients_init(int list_size)
     clients->connected = 0;
     clients->list_size = list_size;
     for (i = 0; i < list_size; i++) {
-        init_client(&clients->list[i], CLOSED_FD);
+        init_client(&clients->list[i], CLOSED_FD, CLOSED_FD);
         clients->list[i].set_data = clients->set_data;
     }
 
@@ -270,6 +437,8 @@ e_mmgr_errors_t clients_dispose(clients_hdle_t *h)
         client_close(clients);
         if (clients->list)
             free(clients->list);
+        if (clients->fd_index)
+            free(clients->fd_index);
         free(clients);
     }
 
@@ -281,11 +450,12 @@ e_mmgr_errors_t clients_dispose(clients_hdle_t *h)
  *
  * @param [in,out] h list of clients
  * @param [in] fd client file descriptor
+ * @param [in] epollfd epoll fd listening the client
  *
  * @return E_ERR_FAILED no space
  * @return E_ERR_SUCCESS if successful
  */
-e_mmgr_errors_t client_add(clients_hdle_t *h, int fd)
+e_mmgr_errors_t client_add(clients_hdle_t *h, int fd, int epollfd)
 {
     int i = 0;
     e_mmgr_errors_t ret = E_ERR_FAILED;
@@ -293,9 +463,27 @@ e_mmgr_errors_t client_add(clients_hdle_t *h, int fd)
 
     ASSERT(clients != NULL);
 
+    if (fd < 0)
+        goto out;
+
+    if (fd >= clients->fd_index_size) {
+        int size = fd + 1 + clients->list_size;
+        client_t **index = realloc(clients->fd_index,
+                                   size * sizeof(client_t *));
+        if (!index) {
+            LOG_ERROR("memory allocation failed");
+            goto out;
+        }
+        memset(index + clients->fd_index_size, 0,
+               (size - clients->fd_index_size) * sizeof(client_t *));
+        clients->fd_index = index;
+        clients->fd_index_size = size;
+    }
+
     for (i = 0; i < clients->list_size; i++) {
         if (clients->list[i].fd == CLOSED_FD) {
-            init_client(&clients->list[i], fd);
+            init_client(&clients->list[i], fd, epollfd);
+            clients->fd_index[fd] = &clients->list[i];
             clients->connected++;
             LOG_DEBUG("client (fd=%d) added. connected: %d",
                       fd, clients->connected);
@@ -304,6 +492,7 @@ e_mmgr_errors_t client_add(clients_hdle_t *h, int fd)
         }
     }
 
+out:
     return ret;
 }
 
@@ -393,27 +582,20 @@ e_mmgr_errors_t client_set_filter(client_hdle_t *h, uint32_t subscription)
  */
 client_hdle_t *client_find(const clients_hdle_t *h, int fd)
 {
-    int i = 0;
     client_list_t *clients = (client_list_t *)h;
     client_t *client = NULL;
 
     ASSERT(clients != NULL);
 
-    if (fd != CLOSED_FD) {
-        for (i = 0; i < clients->list_size; i++) {
-            if (fd == clients->list[i].fd) {
-                client = &clients->list[i];
-                break;
-            }
-        }
-    }
+    if ((fd >= 0) && (fd < clients->fd_index_size))
+        client = clients->fd_index[fd];
 
     return (client_hdle_t *)client;
 }
 
-
 /**
- * send message with data to client
+ * send message with data to client. The client socket is never blocking:
+ * what can not be sent now is queued and sent on EPOLLOUT
  *
  * @param [in] h client to inform
  * @param [in] state state to provide
@@ -425,8 +607,6 @@ client_hdle_t *client_find(const clients_hdle_t *h, int fd)
 e_mmgr_errors_t client_inform(const client_hdle_t *h, e_mmgr_events_t state,
                               void *data)
 {
-    size_t size;
-    size_t write_size;
     e_mmgr_errors_t ret = E_ERR_SUCCESS;
     mmgr_cli_event_t event = { .id = state, .data = data };
     msg_t msg = { .data = NULL };
@@ -435,32 +615,81 @@ e_mmgr_errors_t client_inform(const client_hdle_t *h, e_mmgr_events_t state,
     ASSERT(client != NULL);
     ASSERT(client->set_data[state] != NULL);
 
+    if (!((0x01 << state) & client->subscription)) {
+        LOG_DEBUG("Client (fd=%d name=%s) NOT informed of: %s",
+                  client->fd, client->name, g_mmgr_events[state]);
+        goto out;
+    }
+
     /* do not check data because it can be NULL on purpose */
     client->set_data[state] (&msg, &event);
+    if (!msg.data) {
+        ret = E_ERR_FAILED;
+        goto out;
+    }
 
-    size = SIZE_HEADER + msg.hdr.len;
-    write_size = size;
-    if ((0x01 << state) & client->subscription) {
-        if ((ret = cnx_write(client->fd, msg.data, &write_size)) ==
-            E_ERR_SUCCESS) {
-            if (size != write_size) {
-                LOG_ERROR("send failed for client (fd=%d name=%s) send=%d/%d",
-                          client->fd, client->name, write_size, size);
-                ret = E_ERR_FAILED;
-            } else {
-                LOG_DEBUG("Client (fd=%d name=%s) informed of: %s", client->fd,
-                          client->name, g_mmgr_events[state]);
-            }
-        }
-    } else {
-        LOG_DEBUG("Client (fd=%d name=%s) NOT informed of: %s",
-                  client->fd, client->name, g_mmgr_events[state]);
+    /* the queue keeps the message: do not delete it */
+    queue_push(client, msg.data, SIZE_HEADER + msg.hdr.len);
+    ret = queue_flush(client);
+    if (ret == E_ERR_SUCCESS) {
+        if (client->queue.count > 0)
+            LOG_DEBUG("Client (fd=%d name=%s) event %s queued (depth: %d)",
+                      client->fd, client->name, g_mmgr_events[state],
+                      client->queue.count);
+        else
+            LOG_DEBUG("Client (fd=%d name=%s) informed of: %s", client->fd,
+                      client->name, g_mmgr_events[state]);
     }
 
-    msg_delete(&msg);
+out:
     return ret;
 }
 
+/**
+ * send the messages queued for the client. To be called when the client
+ * socket is writable (EPOLLOUT)
+ *
+ * @param [in] h client handle
+ *
+ * @return E_ERR_SUCCESS if successful
+ * @return E_ERR_FAILED otherwise
+ */
+e_mmgr_errors_t client_flush(client_hdle_t *h)
+{
+    client_t *client = (client_t *)h;
+
+    ASSERT(client != NULL);
+
+    return queue_flush(client);
+}
+
+/**
+ * @brief client_get_queue_stats Return client send queue metrics
+ *
+ * @param h client handle
+ * @param [out] depth messages waiting to be sent
+ * @param [out] max_depth highest depth reached
+ * @param [out] dropped messages dropped because the client was too slow
+ *
+ * @return E_ERR_SUCCESS
+ */
+e_mmgr_errors_t client_get_queue_stats(const client_hdle_t *h, int *depth,
+                                       int *max_depth, int *dropped)
+{
+    client_t *client = (client_t *)h;
+
+    ASSERT(client != NULL);
+    ASSERT(depth != NULL);
+    ASSERT(max_depth != NULL);
+    ASSERT(dropped != NULL);
+
+    *depth = client->queue.count;
+    *max_depth = client->queue.max_depth;
+    *dropped = client->queue.dropped;
+
+    return E_ERR_SUCCESS;
+}
+
 /**
  * inform all clients of modem state
  *
@@ -518,6 +747,7 @@ static e_mmgr_errors_t client_close(client_list_t *clients)
         if (clients->list[i].fd != CLOSED_FD) {
             LOG_DEBUG("i=%d fd=%d", i, clients->list[i].fd);
             cnx_close(&clients->list[i].fd);
+            queue_clear(&clients->list[i]);
         }
     }
 
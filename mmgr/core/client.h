@@ -47,7 +47,7 @@ typedef void *clients_hdle_t;
 clients_hdle_t *clients_init(int list_size);
 e_mmgr_errors_t clients_dispose(clients_hdle_t *clients);
 
-e_mmgr_errors_t client_add(clients_hdle_t *clients, int fd);
+e_mmgr_errors_t client_add(clients_hdle_t *clients, int fd, int epollfd);
 e_mmgr_errors_t client_remove(clients_hdle_t *clients, int fd);
 
 int clients_get_connected(const clients_hdle_t *l);
@@ -73,6 +73,9 @@ e_mmgr_errors_t client_unset_request(client_hdle_t *cli, e_cnx_requests_t req);
 
 e_mmgr_errors_t client_inform(const client_hdle_t *l, e_mmgr_events_t ev,
                               void *data);
+e_mmgr_errors_t client_flush(client_hdle_t *client);
+e_mmgr_errors_t client_get_queue_stats(const client_hdle_t *client, int *depth,
+                                       int *max_depth, int *dropped);
 
 client_hdle_t *client_find(const clients_hdle_t *l, int fd);
 const char *client_get_name(const client_hdle_t *client);
@@ -571,11 +571,13 @@ e_mmgr_errors_t known_client(mmgr_data_t *mmgr)
 {
     e_mmgr_errors_t ret = E_ERR_SUCCESS;
     int fd = CLOSED_FD;
+    uint32_t events;
     client_hdle_t *client = NULL;
 
     ASSERT(mmgr != NULL);
 
     fd = mmgr->events.ev[mmgr->events.cur_ev].data.fd;
+    events = mmgr->events.ev[mmgr->events.cur_ev].events;
     client = client_find(mmgr->clients, fd);
 
     if (!client) {
@@ -585,6 +587,12 @@ e_mmgr_errors_t known_client(mmgr_data_t *mmgr)
     } else {
         const char *name = client_get_name(client);
 
+        if (events & EPOLLOUT)
+            client_flush(client);
+        /* client socket is writable only: nothing to read */
+        if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+            goto out;
+
         ret = msg_get_header(fd, &mmgr->request.msg.hdr);
         mmgr->request.client = client;
         if (ret == E_ERR_SUCCESS) {
@@ -605,6 +613,7 @@ e_mmgr_errors_t known_client(mmgr_data_t *mmgr)
         }
     }
 
+out:
     return ret;
 }
 
@@ -634,7 +643,7 @@ e_mmgr_errors_t new_client(mmgr_data_t *mmgr)
             LOG_ERROR("Error during accept (%s)", strerror(errno));
         } else if (tty_listen_fd(mmgr->epollfd, conn_sock,
                                  EPOLLIN) == E_ERR_SUCCESS) {
-            ret = client_add(mmgr->clients, conn_sock);
+            ret = client_add(mmgr->clients, conn_sock, mmgr->epollfd);
             if (ret != E_ERR_SUCCESS)
                 LOG_ERROR("failed to add new client");
             /* do not provide modem status as long as client has not
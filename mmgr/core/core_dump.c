@@ -17,15 +17,39 @@
 */
 
 #include <errno.h>
+#include <dirent.h>
 #include <dlfcn.h>
+#include <limits.h>
 #include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 #include "core_dump.h"
 #include "errors.h"
 #include "logs.h"
+#include "property.h"
 
 #define WRITE 1
 #define READ 0
 
+/* Ring of the latest core dumps. 0 (property not set) means no limit.
+ * NB: The key length can't exceed PROPERTY_KEY_MAX */
+#define MCDR_MAX_FILES_KEY "persist.service.mmgr.cd_max"
+#define MCDR_MAX_SIZE_KEY "persist.service.mmgr.cd_max_kb"
+/* name of the archives produced by libmcdr: cd_<...>.tgz. Other files of
+ * the folder are left alone */
+#define MCDR_ARCHIVE_PREFIX "cd_"
+#define MCDR_ARCHIVE_EXT ".tgz"
+#define MCDR_ARCHIVES_STEP 16
+
+typedef struct mcdr_archive {
+    char name[NAME_MAX + 1];
+    time_t mtime;
+    off_t size;
+} mcdr_archive_t;
+
 typedef struct mcdr_lib {
     void *hdle;
     void (*read)(mcdr_data_t *);
@@ -40,6 +64,8 @@ typedef struct mcdr_ctx {
     pthread_t id;
     mcdr_lib_t mcdr;
     mcdr_data_t data;
+    struct timespec start;
+    struct timespec end;
 } mcdr_ctx_t;
 
 #ifdef GOCV_MMGR
@@ -123,6 +149,142 @@ e_mmgr_errors_t mcdr_dispose(mcdr_handle_t *h)
     return ret;
 }
 
+/**
+ * sort archives from the newest to the oldest
+ *
+ * @private
+ */
+static int cmp_archive(const void *a, const void *b)
+{
+    const mcdr_archive_t *first = a;
+    const mcdr_archive_t *second = b;
+
+    if (first->mtime == second->mtime)
+        return strcmp(second->name, first->name);
+    return (first->mtime < second->mtime) ? 1 : -1;
+}
+
+/**
+ * Checks that name is the one of an archive produced by libmcdr
+ *
+ * @private
+ */
+static bool is_mcdr_archive(const char *name)
+{
+    size_t len = strlen(name);
+    size_t prefix = strlen(MCDR_ARCHIVE_PREFIX);
+    size_t ext = strlen(MCDR_ARCHIVE_EXT);
+
+    return (len > prefix + ext) &&
+           !strncmp(name, MCDR_ARCHIVE_PREFIX, prefix) &&
+           !strcmp(name + len - ext, MCDR_ARCHIVE_EXT);
+}
+
+/**
+ * Removes the oldest core dump archives of the folder to keep room for the
+ * next one. The limits are read from MCDR_MAX_FILES_KEY and MCDR_MAX_SIZE_KEY.
+ * The next dump is expected to be as large as the latest one.
+ *
+ * @private
+ *
+ * @param [in] path core dump folder
+ */
+static void mcdr_prune(const char *path)
+{
+    int max_files = 0;
+    int max_kb = 0;
+    int nb = 0;
+    int max_nb = 0;
+    int kept = 0;
+    int i;
+    off_t total = 0;
+    char file[PATH_MAX];
+    struct stat st;
+    struct dirent *entry = NULL;
+    DIR *dir = NULL;
+    mcdr_archive_t *archives = NULL;
+    mcdr_archive_t *tmp = NULL;
+    bool full = false;
+
+    ASSERT(path != NULL);
+
+    property_get_int(MCDR_MAX_FILES_KEY, &max_files);
+    property_get_int(MCDR_MAX_SIZE_KEY, &max_kb);
+    if ((max_files <= 0) && (max_kb <= 0))
+        goto out;
+
+    dir = opendir(path);
+    if (!dir) {
+        LOG_ERROR("failed to open %s (%s)", path, strerror(errno));
+        goto out;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_mcdr_archive(entry->d_name))
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if ((stat(file, &st) != 0) || !S_ISREG(st.st_mode))
+            continue;
+        if (nb == max_nb) {
+            tmp = realloc(archives, (max_nb + MCDR_ARCHIVES_STEP) *
+                          sizeof(mcdr_archive_t));
+            if (!tmp) {
+                LOG_ERROR("memory allocation fails");
+                closedir(dir);
+                goto out;
+            }
+            archives = tmp;
+            max_nb += MCDR_ARCHIVES_STEP;
+        }
+        strncpy(archives[nb].name, entry->d_name, NAME_MAX);
+        archives[nb].name[NAME_MAX] = '\0';
+        archives[nb].mtime = st.st_mtime;
+        archives[nb].size = st.st_size;
+        nb++;
+    }
+    closedir(dir);
+
+    if (nb == 0)
+        goto out;
+
+    qsort(archives, nb, sizeof(mcdr_archive_t), cmp_archive);
+
+    /* the archive about to be created takes one file slot and the room of
+     * the latest one. Once an archive does not fit, the older ones go too */
+    total = archives[0].size;
+    for (i = 0; i < nb; i++) {
+        if (!full && ((max_files <= 0) || (kept + 1 < max_files)) &&
+            ((max_kb <= 0) || (total + archives[i].size <=
+                               (off_t)max_kb * 1024))) {
+            total += archives[i].size;
+            kept++;
+            continue;
+        }
+        full = true;
+        snprintf(file, sizeof(file), "%s/%s", path, archives[i].name);
+        if (unlink(file) == 0)
+            LOG_INFO("%s removed (%lld bytes)", file,
+                     (long long)archives[i].size);
+        else
+            LOG_ERROR("failed to remove %s (%s)", file, strerror(errno));
+    }
+
+out:
+    free(archives);
+}
+
+/**
+ * Elapsed time in milliseconds
+ *
+ * @private
+ */
+static long elapsed_ms(const struct timespec *start,
+                       const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000 +
+           (end->tv_nsec - start->tv_nsec) / 1000000;
+}
+
 /**
  * function calling the mcdr lib. This function will send a signal once the
  * the operation is ended
@@ -135,7 +297,12 @@ static void mcdr_read(mcdr_ctx_t *ctx)
 
     ASSERT(ctx != NULL);
 
+    /* done here, not to delay the main thread */
+    mcdr_prune(ctx->data.mcdr_info.gnl.path);
+
+    clock_gettime(CLOCK_MONOTONIC, &ctx->start);
     ctx->mcdr.read(&ctx->data);
+    clock_gettime(CLOCK_MONOTONIC, &ctx->end);
     LOG_DEBUG("[SLAVE-MCDR] Core dump retrieved. Notify main thread");
     write(ctx->fd_pipe[WRITE], &msg, sizeof(msg));
 }
@@ -178,9 +345,19 @@ void mcdr_finalize(mcdr_handle_t *h)
     ASSERT(ctx != NULL);
 
     if (ctx->id) {
+        char file[PATH_MAX];
+        struct stat st;
+
         pthread_join(ctx->id, NULL);
         ctx->id = 0;
         LOG_DEBUG("[MASTER] MCDR thread is stopped");
+
+        snprintf(file, sizeof(file), "%s/%s", ctx->data.mcdr_info.gnl.path,
+                 ctx->data.coredump_file);
+        if (stat(file, &st) != 0)
+            st.st_size = 0;
+        LOG_INFO("core dump retrieved in %ld ms. %lld bytes written",
+                 elapsed_ms(&ctx->start, &ctx->end), (long long)st.st_size);
     }
 }
 
@@ -17,6 +17,7 @@
 */
 
 #include <cutils/sockets.h>
+#include <errno.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -121,6 +122,39 @@ e_mmgr_errors_t cnx_write(int fd, void *data, size_t *len)
     return ret;
 }
 
+/**
+ * write data to cnx without blocking
+ *
+ * @param [in] fd cnx file descriptor
+ * @param [in] data data to write
+ * @param [in,out] len data length. the value returned is the written size,
+ *                 0 if the socket buffer is full
+ *
+ * @return E_ERR_FAILED send fails
+ * @return E_ERR_SUCCESS if successful
+ */
+e_mmgr_errors_t cnx_send(int fd, void *data, size_t *len)
+{
+    e_mmgr_errors_t ret = E_ERR_SUCCESS;
+    int err;
+
+    ASSERT(data != NULL);
+    ASSERT(len != NULL);
+
+    err = send(fd, data, *len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (err < 0) {
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+            LOG_ERROR("send fails (%s)", strerror(errno));
+            ret = E_ERR_FAILED;
+        }
+        *len = 0;
+    } else {
+        *len = err;
+    }
+
+    return ret;
+}
+
 /**
  * close cnx
  *
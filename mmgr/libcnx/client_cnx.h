@@ -27,5 +27,6 @@ e_mmgr_errors_t cnx_close(int *fd);
 e_mmgr_errors_t cnx_accept(int fd);
 e_mmgr_errors_t cnx_read(int fd, void *data, size_t *len);
 e_mmgr_errors_t cnx_write(int fd, void *data, size_t *len);
+e_mmgr_errors_t cnx_send(int fd, void *data, size_t *len);
 
 #endif                          /* __MMGR_CNX_HEADER__ */
@@ -52,6 +52,31 @@ e_mmgr_errors_t tty_listen_fd(int epollfd, int fd, int events)
     return ret;
 }
 
+/**
+ * change the events caught for a fd already added to epoll
+ *
+ * @param [in] epollfd epoll fd
+ * @param [in] fd file descriptor
+ * @param [in] events events to catch
+ *
+ * @return E_ERR_FAILED if epoll_ctl fails
+ * @return E_ERR_SUCCESS if successful
+ */
+e_mmgr_errors_t tty_update_listen_fd(int epollfd, int fd, int events)
+{
+    e_mmgr_errors_t ret = E_ERR_SUCCESS;
+    struct epoll_event ev;
+
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+        LOG_ERROR("Failed to update fd: (%s)", strerror(errno));
+        ret = E_ERR_FAILED;
+    }
+
+    return ret;
+}
+
 e_mmgr_errors_t tty_init_listener(int *epollfd)
 {
     e_mmgr_errors_t ret = E_ERR_SUCCESS;
@@ -27,6 +27,7 @@ e_mmgr_errors_t tty_close(int *fd);
 e_mmgr_errors_t tty_set_termio(int fd);
 e_mmgr_errors_t tty_write(int fd, const char *data, int data_size);
 e_mmgr_errors_t tty_listen_fd(int epollfd, int fd, int events);
+e_mmgr_errors_t tty_update_listen_fd(int epollfd, int fd, int events);
 e_mmgr_errors_t tty_init_listener(int *epollfd);
 e_mmgr_errors_t tty_wait_for_event(int fd, int timeout);
 e_mmgr_errors_t tty_read(int fd, char *data, int *data_size, int max_retries);
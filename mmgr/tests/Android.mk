@@ -8,6 +8,8 @@ LOCAL_MODULE_TAGS := optional tests
 
 LOCAL_REQUIRED_MODULES :=\
     mmgr-test\
+    mmgr-bench\
+    libmcdr-fake\
     MMGR_test\
 
 include $(BUILD_PHONY_PACKAGE)
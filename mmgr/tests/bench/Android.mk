@@ -0,0 +1,21 @@
+LOCAL_PATH:= $(call my-dir)
+
+#############################################
+# MODEM MANAGER client protocol benchmark
+#############################################
+include $(CLEAR_VARS)
+LOCAL_MODULE := mmgr-bench
+LOCAL_MODULE_TAGS := optional tests
+
+LOCAL_C_INCLUDES := \
+    $(MMGR_PATH)/inc \
+    $(TARGET_OUT_HEADERS)/libtcs \
+
+LOCAL_SRC_FILES := $(call all-c-files-under, .)
+LOCAL_CFLAGS += -Wall -Werror -Wvla -DSTDIO_LOGS -DMODULE_NAME=\"MMGR-BENCH\"
+
+LOCAL_IMPORT_C_INCLUDE_DIRS_FROM_SHARED_LIBRARIES := libmmgr_utils libmmgrcli \
+    libmmgr_cnx
+LOCAL_LDLIBS += -lpthread
+LOCAL_SHARED_LIBRARIES := libcutils libc libmmgr_utils libmmgrcli libmmgr_cnx
+include $(BUILD_EXECUTABLE)
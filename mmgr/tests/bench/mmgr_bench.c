@@ -0,0 +1,454 @@
+/* Modem Manager (MMGR) client protocol benchmark
+**
+** Copyright (C) Intel 2013
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+**
+*/
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "errors.h"
+#include "logs.h"
+#include "mmgr.h"
+#include "mmgr_cli.h"
+#include "msg_format.h"
+
+#define DEFAULT_CLIENTS 8
+#define DEFAULT_ITERATIONS 100
+#define DEFAULT_MSG 100000
+#define EVENT_TIMEOUT 5         /* in seconds */
+
+#define USAGE "\n" \
+    "Usage: "MODULE_NAME " [-h] [-n <clients>] [-i <iterations>] " \
+    "[-m <messages>] [-r] [-s]\n" \
+    "Measures mmgr with many clients. mmgr must run on an eng build: the\n" \
+    "modem events are faked, no modem is needed unless -r is given.\n" \
+    "optional arguments:\n" \
+    " -h                show this help message and exit\n" \
+    " -n <clients>      number of clients (default: %d)\n" \
+    " -i <iterations>   iterations of each flow (default: %d)\n" \
+    " -m <messages>     messages of the serialization test (default: %d)\n" \
+    " -r                also measure resource acquire/release ACKs. An\n" \
+    "                   acquire powers the modem up: a modem is needed\n" \
+    " -s                serialization test only. mmgr is not needed\n\n"
+
+typedef struct bench_client {
+    mmgr_cli_handle_t *lib;
+    struct bench_ctx *ctx;
+} bench_client_t;
+
+typedef struct bench_ctx {
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    e_mmgr_events_t waited;
+    struct timespec sent;
+    int received;
+    /* latencies in microseconds */
+    long *samples;
+    int nb_samples;
+    int max_samples;
+    int nb_clients;
+    bench_client_t *clients;
+} bench_ctx_t;
+
+static long elapsed_us(const struct timespec *start,
+                       const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000L +
+           (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+static int cmp_long(const void *a, const void *b)
+{
+    long first = *(const long *)a;
+    long second = *(const long *)b;
+
+    return (first > second) - (first < second);
+}
+
+/**
+ * print percentiles of the samples and reset them
+ *
+ * @param [in,out] ctx bench context
+ * @param [in] name name of the measure
+ */
+static void report(bench_ctx_t *ctx, const char *name)
+{
+    long *s = ctx->samples;
+    int nb = ctx->nb_samples;
+
+    if (nb == 0) {
+        printf("%-24s: no sample\n", name);
+        return;
+    }
+
+    qsort(s, nb, sizeof(long), cmp_long);
+    printf("%-24s: %6d samples. us: p50 %ld p90 %ld p99 %ld max %ld\n",
+           name, nb, s[nb / 2], s[(nb * 90) / 100], s[(nb * 99) / 100],
+           s[nb - 1]);
+    ctx->nb_samples = 0;
+}
+
+static void add_sample(bench_ctx_t *ctx, long us)
+{
+    if (ctx->nb_samples < ctx->max_samples)
+        ctx->samples[ctx->nb_samples++] = us;
+}
+
+/**
+ * callback of all clients: measures the delivery latency of the waited event
+ *
+ * @param [in] ev event
+ *
+ * @return 0
+ */
+static int bench_evt(mmgr_cli_event_t *ev)
+{
+    struct timespec now;
+    bench_client_t *client = NULL;
+    bench_ctx_t *ctx = NULL;
+
+    ASSERT(ev != NULL);
+    client = ev->context;
+    ASSERT(client != NULL);
+    ctx = client->ctx;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&ctx->mtx);
+    if (ev->id == ctx->waited) {
+        add_sample(ctx, elapsed_us(&ctx->sent, &now));
+        if (++ctx->received == ctx->nb_clients)
+            pthread_cond_signal(&ctx->cond);
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+
+    return 0;
+}
+
+/**
+ * sends a request with the first client and waits until all clients have
+ * received the event
+ *
+ * @param [in,out] ctx bench context
+ * @param [in] id request
+ * @param [in] answer event broadcasted by mmgr
+ *
+ * @return E_ERR_SUCCESS if all clients received the event
+ * @return E_ERR_FAILED otherwise
+ */
+static e_mmgr_errors_t broadcast(bench_ctx_t *ctx, e_mmgr_requests_t id,
+                                 e_mmgr_events_t answer)
+{
+    e_mmgr_errors_t ret = E_ERR_SUCCESS;
+    mmgr_cli_requests_t request;
+    struct timespec timeout;
+    int err = 0;
+
+    MMGR_CLI_INIT_REQUEST(request, id);
+
+    pthread_mutex_lock(&ctx->mtx);
+    ctx->waited = answer;
+    ctx->received = 0;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->sent);
+    pthread_mutex_unlock(&ctx->mtx);
+
+    if (mmgr_cli_send_msg(ctx->clients[0].lib, &request) != E_ERR_CLI_SUCCEED) {
+        printf("request %d rejected. Is it an eng build?\n", id);
+        /* no wait */
+        err = ETIMEDOUT;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_sec += EVENT_TIMEOUT;
+
+    pthread_mutex_lock(&ctx->mtx);
+    while ((ctx->received < ctx->nb_clients) && (err != ETIMEDOUT))
+        err = pthread_cond_timedwait(&ctx->cond, &ctx->mtx, &timeout);
+    if (ctx->received < ctx->nb_clients) {
+        printf("event %d: only %d/%d clients informed\n", answer,
+               ctx->received, ctx->nb_clients);
+        ret = E_ERR_FAILED;
+    }
+    ctx->waited = E_MMGR_NUM_EVENTS;
+    pthread_mutex_unlock(&ctx->mtx);
+
+    return ret;
+}
+
+/**
+ * sends a request from each client and measures the time to get its ACK
+ *
+ * @param [in,out] ctx bench context
+ * @param [in] id request
+ */
+static void send_all(bench_ctx_t *ctx, e_mmgr_requests_t id)
+{
+    mmgr_cli_requests_t request;
+    struct timespec start;
+    struct timespec end;
+    int i;
+
+    MMGR_CLI_INIT_REQUEST(request, id);
+
+    for (i = 0; i < ctx->nb_clients; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (mmgr_cli_send_msg(ctx->clients[i].lib, &request) ==
+            E_ERR_CLI_SUCCEED) {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            add_sample(ctx, elapsed_us(&start, &end));
+        }
+    }
+}
+
+/**
+ * measures the throughput of the message serialization and of the header
+ * parsing done by mmgr for each request
+ *
+ * @param [in] nb number of messages
+ *
+ * @return E_ERR_SUCCESS if successful
+ * @return E_ERR_FAILED otherwise
+ */
+static e_mmgr_errors_t bench_msg_format(int nb)
+{
+    e_mmgr_errors_t ret = E_ERR_FAILED;
+    mmgr_cli_event_t event = { .id = E_MMGR_EVENT_MODEM_UP, .data = NULL };
+    struct timespec start;
+    struct timespec end;
+    msg_hdr_t hdr;
+    msg_t msg;
+    long us;
+    int fd[2];
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < nb; i++) {
+        msg.data = NULL;
+        if (msg_set_empty(&msg, &event) != E_ERR_SUCCESS)
+            goto out;
+        msg_delete(&msg);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    us = elapsed_us(&start, &end);
+    printf("%-24s: %d msgs in %ld us (%.0f msg/s)\n", "serialize", nb, us,
+           us ? nb * 1000000.0 / us : 0.0);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) != 0) {
+        printf("socketpair failed (%s)\n", strerror(errno));
+        goto out;
+    }
+
+    msg.data = NULL;
+    msg_set_empty(&msg, &event);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < nb; i++) {
+        if ((write(fd[0], msg.data, SIZE_HEADER) != SIZE_HEADER) ||
+            (msg_get_header(fd[1], &hdr) != E_ERR_SUCCESS) ||
+            (hdr.id != E_MMGR_EVENT_MODEM_UP))
+            break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    msg_delete(&msg);
+    close(fd[0]);
+    close(fd[1]);
+
+    us = elapsed_us(&start, &end);
+    printf("%-24s: %d msgs in %ld us (%.0f msg/s)\n", "send + parse header",
+           i, us, us ? i * 1000000.0 / us : 0.0);
+    if (i == nb)
+        ret = E_ERR_SUCCESS;
+
+out:
+    return ret;
+}
+
+static e_mmgr_errors_t clients_start(bench_ctx_t *ctx)
+{
+    char name[CLIENT_NAME_LEN];
+    int i;
+    int ev;
+
+    for (i = 0; i < ctx->nb_clients; i++) {
+        bench_client_t *client = &ctx->clients[i];
+
+        client->ctx = ctx;
+        snprintf(name, sizeof(name), "bench_%d", i);
+        if (mmgr_cli_create_handle(&client->lib, name, client) !=
+            E_ERR_CLI_SUCCEED) {
+            printf("failed to create client %d\n", i);
+            return E_ERR_FAILED;
+        }
+
+        /* ACK and NACK are refused by the library */
+        for (ev = 0; ev < E_MMGR_NUM_EVENTS; ev++)
+            if ((ev != E_MMGR_ACK) && (ev != E_MMGR_NACK))
+                mmgr_cli_subscribe_event(client->lib, bench_evt, ev);
+
+        if (mmgr_cli_connect(client->lib) != E_ERR_CLI_SUCCEED) {
+            printf("client %d failed to connect. Is mmgr running?\n", i);
+            return E_ERR_FAILED;
+        }
+    }
+
+    return E_ERR_SUCCESS;
+}
+
+static void clients_stop(bench_ctx_t *ctx)
+{
+    int i;
+
+    for (i = 0; i < ctx->nb_clients; i++) {
+        if (ctx->clients[i].lib) {
+            mmgr_cli_disconnect(ctx->clients[i].lib);
+            mmgr_cli_delete_handle(ctx->clients[i].lib);
+        }
+    }
+}
+
+/**
+ * runs the flows against mmgr and reports the latencies
+ *
+ * @param [in,out] ctx bench context
+ * @param [in] iterations
+ * @param [in] resources measure the resource acquire/release ACKs too
+ *
+ * @return E_ERR_SUCCESS if successful
+ * @return E_ERR_FAILED otherwise
+ */
+static e_mmgr_errors_t bench_flows(bench_ctx_t *ctx, int iterations,
+                                   bool resources)
+{
+    e_mmgr_errors_t ret = E_ERR_FAILED;
+    struct timespec start;
+    struct timespec end;
+    int i;
+
+    if (clients_start(ctx) != E_ERR_SUCCESS)
+        goto out;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* mmgr does not send MODEM_DOWN twice in a row: alternate */
+    for (i = 0; i < iterations; i++) {
+        if ((broadcast(ctx, E_MMGR_REQUEST_FAKE_UP, E_MMGR_EVENT_MODEM_UP)
+             != E_ERR_SUCCESS) ||
+            (broadcast(ctx, E_MMGR_REQUEST_FAKE_DOWN, E_MMGR_EVENT_MODEM_DOWN)
+             != E_ERR_SUCCESS))
+            goto out;
+    }
+    report(ctx, "modem up/down delivery");
+
+    /* the fake requests don't change the mmgr state: an acquire in MDM_OFF
+     * really wakes up the modem */
+    if (resources) {
+        for (i = 0; i < iterations; i++) {
+            send_all(ctx, E_MMGR_RESOURCE_ACQUIRE);
+            send_all(ctx, E_MMGR_RESOURCE_RELEASE);
+        }
+        report(ctx, "acquire/release ACK");
+    }
+
+    for (i = 0; i < iterations; i++) {
+        if (broadcast(ctx, E_MMGR_REQUEST_FAKE_MODEM_SHUTDOWN,
+                      E_MMGR_NOTIFY_MODEM_SHUTDOWN) != E_ERR_SUCCESS)
+            goto out;
+    }
+    report(ctx, "shutdown delivery");
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%-24s: %d clients, %ld ms\n", "total", ctx->nb_clients,
+           elapsed_us(&start, &end) / 1000);
+    ret = E_ERR_SUCCESS;
+
+out:
+    clients_stop(ctx);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    e_mmgr_errors_t err = E_ERR_FAILED;
+    bench_ctx_t ctx;
+    int iterations = DEFAULT_ITERATIONS;
+    int nb_msg = DEFAULT_MSG;
+    bool format_only = false;
+    bool resources = false;
+    int opt;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.nb_clients = DEFAULT_CLIENTS;
+
+    while ((opt = getopt(argc, argv, "hn:i:m:rs")) != -1) {
+        switch (opt) {
+        case 'n':
+            ctx.nb_clients = atoi(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'm':
+            nb_msg = atoi(optarg);
+            break;
+        case 'r':
+            resources = true;
+            break;
+        case 's':
+            format_only = true;
+            break;
+        default:
+            printf(USAGE, DEFAULT_CLIENTS, DEFAULT_ITERATIONS, DEFAULT_MSG);
+            goto out;
+        }
+    }
+
+    if ((ctx.nb_clients <= 0) || (iterations <= 0) || (nb_msg <= 0)) {
+        printf(USAGE, DEFAULT_CLIENTS, DEFAULT_ITERATIONS, DEFAULT_MSG);
+        goto out;
+    }
+
+    err = bench_msg_format(nb_msg);
+    if ((err != E_ERR_SUCCESS) || format_only)
+        goto out;
+
+    pthread_mutex_init(&ctx.mtx, NULL);
+    pthread_cond_init(&ctx.cond, NULL);
+    ctx.waited = E_MMGR_NUM_EVENTS;
+    /* a flow produces at most one sample per client and per iteration */
+    ctx.max_samples = ctx.nb_clients * iterations * 2;
+    ctx.samples = malloc(ctx.max_samples * sizeof(long));
+    ctx.clients = calloc(ctx.nb_clients, sizeof(bench_client_t));
+    if (!ctx.samples || !ctx.clients) {
+        printf("memory allocation failed\n");
+        err = E_ERR_FAILED;
+    } else {
+        err = bench_flows(&ctx, iterations, resources);
+    }
+
+    free(ctx.samples);
+    free(ctx.clients);
+    pthread_cond_destroy(&ctx.cond);
+    pthread_mutex_destroy(&ctx.mtx);
+
+out:
+    return (err == E_ERR_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,13 @@
+LOCAL_PATH:= $(call my-dir)
+
+#############################################
+# Simulated core dump reader, to be installed as libmcdr.so
+#############################################
+include $(CLEAR_VARS)
+LOCAL_MODULE := libmcdr-fake
+LOCAL_MODULE_TAGS := optional tests
+
+LOCAL_C_INCLUDES := $(TARGET_OUT_HEADERS)/libmcdr
+LOCAL_SRC_FILES := fake_mcdr.c
+LOCAL_CFLAGS += -Wall -Werror -Wvla
+include $(BUILD_SHARED_LIBRARY)
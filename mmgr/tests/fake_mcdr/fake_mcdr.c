@@ -0,0 +1,85 @@
+/* Modem Manager - simulated core dump reader
+**
+** Copyright (C) Intel 2013
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+**
+*/
+
+/* Stands in for libmcdr to measure the core dump retrieval and the pruning
+ * of the core dump folder without a modem. Installed as libmcdr.so, each
+ * retrieval writes a cd_fake_<time>_<n>.tgz archive of FAKE_MCDR_SIZE_KB kB
+ * (8 MB if the variable is not set) in the core dump folder. */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dumpreader.h"
+
+#define FAKE_MCDR_SIZE_KEY "FAKE_MCDR_SIZE_KB"
+#define FAKE_MCDR_DEFAULT_KB (8 * 1024)
+#define FAKE_MCDR_CHUNK 1024
+
+static mcdr_status_t g_state = MCDR_SUCCEED;
+static int g_count = 0;
+
+void mcdr_get_core_dump(mcdr_data_t *data)
+{
+    char file[PATH_MAX];
+    char chunk[FAKE_MCDR_CHUNK];
+    const char *env = getenv(FAKE_MCDR_SIZE_KEY);
+    long size_kb = FAKE_MCDR_DEFAULT_KB;
+    long i;
+    FILE *fp = NULL;
+
+    if (env)
+        size_kb = strtol(env, NULL, 0);
+
+    snprintf(data->coredump_file, sizeof(data->coredump_file),
+             "cd_fake_%lu_%04d.tgz", (unsigned long)time(NULL), g_count++);
+    snprintf(file, sizeof(file), "%s/%s", data->mcdr_info.gnl.path,
+             data->coredump_file);
+
+    fp = fopen(file, "w");
+    if (!fp) {
+        g_state = MCDR_FS_ERROR;
+        return;
+    }
+
+    memset(chunk, g_count, sizeof(chunk));
+    for (i = 0; i < size_kb; i++) {
+        if (fwrite(chunk, sizeof(chunk), 1, fp) != 1) {
+            g_state = MCDR_IO_ERROR;
+            fclose(fp);
+            return;
+        }
+    }
+    fclose(fp);
+    g_state = MCDR_SUCCEED;
+}
+
+void mcdr_cleanup(void)
+{
+}
+
+mcdr_status_t mcdr_get_state(void)
+{
+    return g_state;
+}
+
+char *mcdr_get_reason(void)
+{
+    return g_state == MCDR_SUCCEED ? "none" : "simulated write error";
+}
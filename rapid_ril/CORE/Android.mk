@@ -9,6 +9,7 @@ LOCAL_SRC_FILES:= \
     ND/te_base.cpp \
     ND/te.cpp \
     ND/cellInfo_cache.cpp \
+    ND/unsol_coalescer.cpp \
     ND/systemmanager.cpp \
     ND/radio_state.cpp \
     silo.cpp \
@@ -23,6 +24,7 @@ LOCAL_SRC_FILES:= \
     ND/silo_common.cpp \
     ND/channel_nd.cpp \
     channelbase.cpp \
+    urc_dispatcher.cpp \
     channel_atcmd.cpp \
     channel_data.cpp \
     channel_DLC2.cpp \
@@ -108,3 +110,4 @@ LOCAL_MODULE:= librapid-ril-core
 LOCAL_MODULE_TAGS:= optional
 include $(BUILD_SHARED_LIBRARY)
 
+include $(call all-makefiles-under,$(LOCAL_PATH))
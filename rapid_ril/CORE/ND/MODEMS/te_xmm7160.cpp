@@ -95,14 +95,14 @@ char* CTE_XMM7160::GetUnlockInitCommands(UINT32 uiChannelType)
 
         // read the property enabling ciphering
         CRepository repository;
-        int uiEnableCipheringInd = 1;
-        if (!repository.Read(g_szGroupModem, g_szEnableCipheringInd, uiEnableCipheringInd))
+        BOOL bEnableCipheringInd = TRUE;
+        if (!repository.Read(g_szGroupModem, g_szEnableCipheringInd, bEnableCipheringInd))
         {
             RIL_LOG_VERBOSE("CTE_XMM7160::GetUnlockInitCommands()- Repository read failed!\r\n");
         }
 
         ConcatenateStringNullTerminate(szInitCmd, sizeof(szInitCmd),
-                (bConformance || (uiEnableCipheringInd != 0)) ? "|+XUCCI=1" : "|+XUCCI=0");
+                (bConformance || bEnableCipheringInd) ? "|+XUCCI=1" : "|+XUCCI=0");
     }
 
     RIL_LOG_VERBOSE("CTE_XMM7160::GetUnlockInitCommands() - Exit\r\n");
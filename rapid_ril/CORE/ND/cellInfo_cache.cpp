@@ -92,6 +92,7 @@ BOOL operator==(const RIL_CellInfo& first, const RIL_CellInfo& second)
 CellInfoCache::CellInfoCache()
 {
     memset(&m_sCellInfo, 0, sizeof(S_ND_N_CELL_INFO_DATA));
+    memset(m_rguiHash, 0, sizeof(m_rguiHash));
     m_iCacheSize = 0;
     m_pCacheLock = new CMutex();
 }
@@ -116,12 +117,73 @@ BOOL CellInfoCache::getCellInfo(P_ND_N_CELL_INFO_DATA pRetData, UINT32& uiItemCo
     return TRUE;
 }
 
-INT32 CellInfoCache::checkCache(const RIL_CellInfo& pData)
+// Hashes the fields compared by operator==, so equal items have equal hashes.
+UINT32 CellInfoCache::hashCellInfo(const RIL_CellInfo& rData)
+{
+    int rgiFields[11];
+    int nFields = 0;
+    UINT32 uiHash = 2166136261U; // FNV-1a
+
+    switch (rData.cellInfoType)
+    {
+    case RIL_CELL_INFO_TYPE_GSM:
+    {
+        const RIL_CellInfoGsm& gsm = rData.CellInfo.gsm;
+        rgiFields[nFields++] = gsm.cellIdentityGsm.mcc;
+        rgiFields[nFields++] = gsm.cellIdentityGsm.mnc;
+        rgiFields[nFields++] = gsm.cellIdentityGsm.lac;
+        rgiFields[nFields++] = gsm.cellIdentityGsm.cid;
+        rgiFields[nFields++] = gsm.signalStrengthGsm.signalStrength;
+        rgiFields[nFields++] = gsm.signalStrengthGsm.bitErrorRate;
+        break;
+    }
+    case RIL_CELL_INFO_TYPE_WCDMA:
+    {
+        const RIL_CellInfoWcdma& wcdma = rData.CellInfo.wcdma;
+        rgiFields[nFields++] = wcdma.cellIdentityWcdma.mcc;
+        rgiFields[nFields++] = wcdma.cellIdentityWcdma.mnc;
+        rgiFields[nFields++] = wcdma.cellIdentityWcdma.lac;
+        rgiFields[nFields++] = wcdma.cellIdentityWcdma.cid;
+        rgiFields[nFields++] = wcdma.cellIdentityWcdma.psc;
+        rgiFields[nFields++] = wcdma.signalStrengthWcdma.signalStrength;
+        rgiFields[nFields++] = wcdma.signalStrengthWcdma.bitErrorRate;
+        break;
+    }
+    case RIL_CELL_INFO_TYPE_LTE:
+    {
+        const RIL_CellInfoLte& lte = rData.CellInfo.lte;
+        rgiFields[nFields++] = lte.cellIdentityLte.mcc;
+        rgiFields[nFields++] = lte.cellIdentityLte.mnc;
+        rgiFields[nFields++] = lte.cellIdentityLte.ci;
+        rgiFields[nFields++] = lte.cellIdentityLte.pci;
+        rgiFields[nFields++] = lte.cellIdentityLte.tac;
+        rgiFields[nFields++] = lte.signalStrengthLte.signalStrength;
+        rgiFields[nFields++] = lte.signalStrengthLte.rsrp;
+        rgiFields[nFields++] = lte.signalStrengthLte.rsrq;
+        rgiFields[nFields++] = lte.signalStrengthLte.rssnr;
+        rgiFields[nFields++] = lte.signalStrengthLte.cqi;
+        rgiFields[nFields++] = lte.signalStrengthLte.timingAdvance;
+        break;
+    }
+    default:
+        break;
+    }
+
+    uiHash = (uiHash ^ (UINT32)rData.cellInfoType) * 16777619U;
+    for (int i = 0; i < nFields; i++)
+    {
+        uiHash = (uiHash ^ (UINT32)rgiFields[i]) * 16777619U;
+    }
+    return uiHash;
+}
+
+// Called with m_pCacheLock held
+INT32 CellInfoCache::checkCache(const RIL_CellInfo& pData, UINT32 uiHash)
 {
     RIL_LOG_VERBOSE("CellInfoCache::checkCache() %d\r\n", m_iCacheSize);
     for (INT32 i = 0; i < m_iCacheSize; i++)
     {
-        if (pData == m_sCellInfo.pnCellData[i])
+        if (uiHash == m_rguiHash[i] && pData == m_sCellInfo.pnCellData[i])
         {
             RIL_LOG_VERBOSE("CellInfoCache::checkCache() - Found match at %d\r\n",i);
             return i;
@@ -133,6 +195,7 @@ INT32 CellInfoCache::checkCache(const RIL_CellInfo& pData)
 BOOL CellInfoCache::updateCache(const P_ND_N_CELL_INFO_DATA pData, const INT32 aItemsCount)
 {
     BOOL ret = FALSE;
+    UINT32 rguiHash[RRIL_MAX_CELL_ID_COUNT];
 
     RIL_LOG_VERBOSE("CellInfoCache::updateCache() - aItemsCount %d \r\n",aItemsCount);
     if (NULL == pData || aItemsCount > RRIL_MAX_CELL_ID_COUNT)
@@ -140,22 +203,29 @@ BOOL CellInfoCache::updateCache(const P_ND_N_CELL_INFO_DATA pData, const INT32 a
         RIL_LOG_INFO("CellInfoCache::updateCache() - Invalid data\r\n");
         goto Error;
     }
+
+    for (INT32 i = 0; i < aItemsCount; i++)
+    {
+        rguiHash[i] = hashCellInfo(pData->pnCellData[i]);
+    }
+
+    // Access mutex; the cache must not change between the check and the update
+    CMutex::Lock(m_pCacheLock);
+
+    // if there were more items in the cache before
+    if (aItemsCount != m_iCacheSize)
+    {
+        ret = TRUE;
+    }
     else
     {
-        // if there were more items in the cache before
-        if (aItemsCount != m_iCacheSize)
-        {
-            ret = TRUE;
-        }
-        else
+        for (INT32 storeIndex= 0; storeIndex < aItemsCount; storeIndex++)
         {
-            for (INT32 storeIndex= 0; storeIndex < aItemsCount; storeIndex++)
+            // new item
+            if (checkCache(pData->pnCellData[storeIndex], rguiHash[storeIndex]) < 0)
             {
-                if (checkCache(pData->pnCellData[storeIndex]) < 0 ) // new item
-                {
-                    ret = TRUE;
-                    break;
-                }
+                ret = TRUE;
+                break;
             }
         }
     }
@@ -164,17 +234,17 @@ BOOL CellInfoCache::updateCache(const P_ND_N_CELL_INFO_DATA pData, const INT32 a
     {
         RIL_LOG_INFO("CellInfoCache::updateCache() -"
                 "Updating cache with %d items\r\n", aItemsCount);
-        // Access mutex
-        CMutex::Lock(m_pCacheLock);
         m_iCacheSize = aItemsCount;
         memset(&m_sCellInfo, 0, sizeof(S_ND_N_CELL_INFO_DATA));
         for (INT32 j = 0; j < m_iCacheSize; j++)
         {
             m_sCellInfo.pnCellData[j] = pData->pnCellData[j];
+            m_rguiHash[j] = rguiHash[j];
         }
-        // release mutex
-        CMutex::Unlock(m_pCacheLock);
     }
+
+    // release mutex
+    CMutex::Unlock(m_pCacheLock);
 Error:
     return ret;
 }
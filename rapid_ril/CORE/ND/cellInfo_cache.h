@@ -29,8 +29,11 @@ public:
     bool IsCellInfoCacheEmpty() { return m_iCacheSize <= 0; }
 
 private:
-    INT32 checkCache(const RIL_CellInfo& pData);
+    INT32 checkCache(const RIL_CellInfo& pData, UINT32 uiHash);
+    static UINT32 hashCellInfo(const RIL_CellInfo& rData);
     S_ND_N_CELL_INFO_DATA m_sCellInfo;
+    // Hash of each cached item, checked before the item itself
+    UINT32 m_rguiHash[RRIL_MAX_CELL_ID_COUNT];
     INT32 m_iCacheSize;
     CMutex* m_pCacheLock;
 };
@@ -189,8 +189,9 @@ BOOL CChannel::SendCommand(CCommand*& rpCmd)
         pATCommand2 = (char*) rpCmd->GetATCmd2();
         UINT32 nCmd1Length = (NULL == pATCommand) ? 0 : strlen(pATCommand);
         UINT32 nCmd2Length = (NULL == pATCommand2) ? 0 : strlen(pATCommand2);
-        CRLFExpandedString cmd1(pATCommand, nCmd1Length);
-        CRLFExpandedString cmd2(pATCommand2, nCmd2Length);
+        // Only printed in full log builds
+        CRLFExpandedString cmd1(CRilLog::IsFullLogBuild() ? pATCommand : NULL, nCmd1Length);
+        CRLFExpandedString cmd2(CRilLog::IsFullLogBuild() ? pATCommand2 : NULL, nCmd2Length);
 
         // GetString will return a pointer to the actual command buffer or "NULL"
         const char* pPrintStr = cmd1.GetString();
@@ -467,7 +468,8 @@ RIL_RESULT_CODE CChannel::GetResponse(CCommand*& rpCmd, CResponse*& rpResponse)
         SetCmdThreadBlockedOnRxQueue();
 
         UINT32 cmdStrLen = (NULL == pATCommand) ? 0 : strlen(pATCommand);
-        CRLFExpandedString cmd(pATCommand, cmdStrLen);
+        // Only printed in full log builds
+        CRLFExpandedString cmd(CRilLog::IsFullLogBuild() ? pATCommand : NULL, cmdStrLen);
         const char* pPrintStr = cmd.GetString();
 
         BOOL bSuccess = WriteToPort(pATCommand, cmdStrLen, uiBytesWritten);
@@ -829,9 +831,12 @@ BOOL CChannel::ProcessModemData(char* szRxBytes, UINT32 uiRxBytesSize)
         goto Error;
     }
 
-    RIL_LOG_INFO("CChannel::ProcessModemData() - INFO: chnl=[%d] size=[%d] RX [%s]\r\n",
-            m_uiRilChannel, uiRxBytesSize,
-            CRLFExpandedString(szRxBytes,uiRxBytesSize).GetString());
+    if (CRilLog::IsInfoLogEnabled())
+    {
+        RIL_LOG_INFO("CChannel::ProcessModemData() - INFO: chnl=[%d] size=[%d] RX [%s]\r\n",
+                m_uiRilChannel, uiRxBytesSize,
+                CRLFExpandedString(szRxBytes,uiRxBytesSize).GetString());
+    }
 
     CMutex::Lock(m_pResponseObjectAccessMutex);
 
@@ -56,7 +56,10 @@ const char* const CFile::NULL_FILENAME = "<null>";
 CFile::CFile() :
     m_file(-1),
     m_fInitialized(FALSE),
-    m_pszFileName(NULL) {};
+    m_pszFileName(NULL)
+{
+    memset(&m_ioCounters, 0, sizeof(m_ioCounters));
+}
 
 CFile::~CFile()
 {
@@ -295,8 +298,25 @@ BOOL CFile::Write(const void* pBuffer, UINT32 dwBytesToWrite, UINT32 &rdwBytesWr
         return FALSE;
     }
 
-    while ((bytesWritten = (write(m_file, pBuffer, dwBytesToWrite))) == -1)
+    // A DLC may take a long command (e.g. an SMS PDU) in several writes
+    while (rdwBytesWritten < dwBytesToWrite)
     {
+        bytesWritten = write(m_file, (const char*)pBuffer + rdwBytesWritten,
+                dwBytesToWrite - rdwBytesWritten);
+        m_ioCounters.uiWriteCalls++;
+
+        if (bytesWritten > 0)
+        {
+            rdwBytesWritten += (UINT32)bytesWritten;
+            m_ioCounters.uiBytesWritten += (UINT32)bytesWritten;
+            continue;
+        }
+        else if (0 == bytesWritten)
+        {
+            // Nothing taken; the caller reports the short write
+            break;
+        }
+
         switch (errno)
         {
             case EAGAIN:
@@ -336,8 +356,6 @@ BOOL CFile::Write(const void* pBuffer, UINT32 dwBytesToWrite, UINT32 &rdwBytesWr
         }
     }
 
-    rdwBytesWritten = (UINT32)bytesWritten;
-
     return TRUE;
 }
 
@@ -354,7 +372,10 @@ BOOL CFile::Read(void* pBuffer, UINT32 dwBytesToRead, UINT32 &rdwBytesRead)
         return FALSE;
     }
 
-    if ((iCount = read(m_file, pBuffer, dwBytesToRead)) == -1)
+    iCount = read(m_file, pBuffer, dwBytesToRead);
+    m_ioCounters.uiReadCalls++;
+
+    if (-1 == iCount)
     {
         if (errno != EAGAIN)
         {
@@ -372,6 +393,7 @@ BOOL CFile::Read(void* pBuffer, UINT32 dwBytesToRead, UINT32 &rdwBytesRead)
     }
 
     rdwBytesRead = (UINT32)iCount;
+    m_ioCounters.uiBytesRead += rdwBytesRead;
 
     return TRUE;
 }
@@ -584,6 +606,18 @@ BOOL CFile::WaitForEvent(CFile* pFile, UINT32 &rdwFlags, UINT32 dwTimeoutInMS)
     }
 }
 
+void CFile::GetIoCounters(CFile* pFile, FILE_IO_COUNTERS& rCounters)
+{
+    if (pFile)
+    {
+        rCounters = pFile->m_ioCounters;
+    }
+    else
+    {
+        memset(&rCounters, 0, sizeof(rCounters));
+    }
+}
+
 int CFile::GetFD(CFile* pFile)
 {
     if (pFile)
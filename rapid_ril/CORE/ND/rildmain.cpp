@@ -426,7 +426,12 @@ void RIL_onUnsolicitedResponse(int unsolResponseID, const void* pData, size_t da
         RIL_LOG_INFO("RIL_onUnsolicitedResponse() - pData is NULL! id=%d\r\n", unsolResponseID);
     }
 
-    if (bSendNotification)
+    if (bSendNotification && CTE::GetTE().CoalesceUnsolicited(unsolResponseID, pData, dataSize))
+    {
+        RIL_LOG_VERBOSE("RIL_onUnsolicitedResponse() - id=%d handled by the coalescer\r\n",
+                unsolResponseID);
+    }
+    else if (bSendNotification)
     {
         RIL_LOG_VERBOSE("Calling gs_pRilEnv->OnUnsolicitedResponse()... id=%d\r\n",
                 unsolResponseID);
@@ -438,6 +443,22 @@ void RIL_onUnsolicitedResponse(int unsolResponseID, const void* pData, size_t da
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void RIL_onCoalescedUnsolicitedResponse(int unsolResponseID, const void* pData, size_t dataSize)
+{
+    if (CTE::GetTE().IsPlatformShutDownRequested() || CTE::GetTE().IsRadioRequestPending())
+    {
+        RIL_LOG_INFO("RIL_onCoalescedUnsolicitedResponse() - ignoring id=%d due to "
+                "radio on/off requested\r\n", unsolResponseID);
+        return;
+    }
+
+    RIL_LOG_VERBOSE("Calling gs_pRilEnv->OnUnsolicitedResponse()... id=%d\r\n",
+            unsolResponseID);
+    gs_pRilEnv->OnUnsolicitedResponse(unsolResponseID, pData, dataSize);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 void RIL_requestTimedCallback(RIL_TimedCallback callback, void* pParam,
@@ -52,6 +52,9 @@ void RIL_onRequestComplete(RIL_Token tRIL, RIL_Errno eErrNo, void* pResponse, si
 
 void RIL_onUnsolicitedResponse(int unsolResponseID, const void* pData, size_t dataSize);
 
+//  Sends a notification on behalf of the coalescer, bypassing it.
+void RIL_onCoalescedUnsolicitedResponse(int unsolResponseID, const void* pData, size_t dataSize);
+
 void RIL_requestTimedCallback(RIL_TimedCallback callback,
                                             void* pParam,
                                             const struct timeval* pRelativeTime);
@@ -243,6 +243,7 @@ BOOL CSystemManager::InitializeSystem()
 
     CRepository repository;
     int iTemp = 0;
+    UINT32 uiTemp = 0;
     BOOL bRetVal = FALSE;
 
     char szModem[MAX_MODEM_NAME_LEN];
@@ -342,45 +343,55 @@ BOOL CSystemManager::InitializeSystem()
 
     ResetSystemState();
 
-    if (repository.Read(g_szGroupModem, g_szEnableModemOffInFlightMode, iTemp))
+    if (repository.Read(g_szGroupModem, g_szEnableModemOffInFlightMode, uiTemp))
     {
-        CTE::GetTE().SetModemOffInFlightModeState((UINT32)iTemp);
+        CTE::GetTE().SetModemOffInFlightModeState(uiTemp);
     }
 
-    if (repository.Read(g_szGroupOtherTimeouts, g_szTimeoutCmdInit, iTemp))
+    if (repository.Read(g_szGroupOtherTimeouts, g_szTimeoutCmdInit, uiTemp))
     {
-        CTE::GetTE().SetTimeoutCmdInit((UINT32)iTemp);
+        CTE::GetTE().SetTimeoutCmdInit(uiTemp);
     }
 
-    if (repository.Read(g_szGroupOtherTimeouts, g_szTimeoutAPIDefault, iTemp))
+    if (repository.Read(g_szGroupOtherTimeouts, g_szTimeoutAPIDefault, uiTemp))
     {
-        CTE::GetTE().SetTimeoutAPIDefault((UINT32)iTemp);
+        CTE::GetTE().SetTimeoutAPIDefault(uiTemp);
     }
 
-    if (repository.Read(g_szGroupOtherTimeouts, g_szTimeoutWaitForInit, iTemp))
+    if (repository.Read(g_szGroupOtherTimeouts, g_szTimeoutWaitForInit, uiTemp))
     {
-        CTE::GetTE().SetTimeoutWaitForInit((UINT32)iTemp);
+        CTE::GetTE().SetTimeoutWaitForInit(uiTemp);
     }
 
-    if (repository.Read(g_szGroupRILSettings, g_szTimeoutThresholdForRetry, iTemp))
+    if (repository.Read(g_szGroupRILSettings, g_szTimeoutThresholdForRetry, uiTemp))
     {
-        CTE::GetTE().SetTimeoutThresholdForRetry((UINT32)iTemp);
+        CTE::GetTE().SetTimeoutThresholdForRetry(uiTemp);
     }
 
-    if (repository.Read(g_szGroupModem, g_szMTU, iTemp))
+    if (repository.Read(g_szGroupRILSettings, g_szUnsolCoalesceWindow, uiTemp))
     {
-        CTE::GetTE().SetMTU((UINT32)iTemp);
+        CTE::GetTE().SetUnsolCoalesceWindow(uiTemp);
     }
 
-    if (repository.Read(g_szGroupModem, g_szPinCacheMode, iTemp))
+    if (repository.Read(g_szGroupRILSettings, g_szSignalStrengthDelta, uiTemp))
     {
-        CTE::GetTE().SetPinCacheMode((UINT32)iTemp);
+        CTE::GetTE().SetSignalStrengthDelta(uiTemp);
+    }
+
+    if (repository.Read(g_szGroupModem, g_szMTU, uiTemp))
+    {
+        CTE::GetTE().SetMTU(uiTemp);
+    }
+
+    if (repository.Read(g_szGroupModem, g_szPinCacheMode, uiTemp))
+    {
+        CTE::GetTE().SetPinCacheMode(uiTemp);
     }
 
     // store initial value of Fast Dormancy Mode
-    if (repository.Read(g_szGroupModem, g_szFDMode, iTemp))
+    if (repository.Read(g_szGroupModem, g_szFDMode, uiTemp))
     {
-        CTE::GetTE().SetFastDormancyMode((UINT32)iTemp);
+        CTE::GetTE().SetFastDormancyMode(uiTemp);
     }
 
     // get system capabilities from repository
@@ -424,9 +435,9 @@ BOOL CSystemManager::InitializeSystem()
         CTE::GetTE().SetCellInfoEnabled(iTemp == 1 ? TRUE : FALSE);
     }
 
-    if (repository.Read(g_szGroupModem, g_szModeOfOperation, iTemp))
+    if (repository.Read(g_szGroupModem, g_szModeOfOperation, uiTemp))
     {
-        CTE::GetTE().SetModeOfOperation((UINT32)iTemp);
+        CTE::GetTE().SetModeOfOperation(uiTemp);
     }
 
     // Retrieve IMS capability based on system property
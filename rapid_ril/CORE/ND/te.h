@@ -22,6 +22,7 @@
 #include "command.h"
 #include "initializer.h"
 #include "cellInfo_cache.h"
+#include "unsol_coalescer.h"
 #include "constants.h"
 
 class CTEBase;
@@ -769,6 +770,17 @@ public:
     }
     bool IsCellInfoCacheEmpty() { return m_CellInfoCache.IsCellInfoCacheEmpty(); }
 
+    //  Returns TRUE if the coalescer took care of the notification (see CUnsolCoalescer).
+    BOOL CoalesceUnsolicited(int unsolResponseID, const void* pData, size_t dataSize)
+    {
+        return m_UnsolCoalescer.Coalesce(unsolResponseID, pData, dataSize);
+    }
+    void SetUnsolCoalesceWindow(UINT32 uiWindowMs) { m_UnsolCoalescer.SetWindow(uiWindowMs); }
+    void SetSignalStrengthDelta(UINT32 uiDelta)
+    {
+        m_UnsolCoalescer.SetSignalStrengthDelta(uiDelta);
+    }
+
     BOOL TestAndSetDataCleanupStatus(BOOL bCleanupStatus);
 
     // This function will return true if sys.shutdown.requested is set to 0 or 1
@@ -1183,6 +1195,7 @@ private:
     S_ND_REG_STATUS m_sCSStatus;
     S_ND_GPRS_REG_STATUS m_sEPSStatus;
     CellInfoCache m_CellInfoCache;
+    CUnsolCoalescer m_UnsolCoalescer;
 
     // Flag used to store setup data call status
     BOOL m_bIsSetupDataCallOngoing;
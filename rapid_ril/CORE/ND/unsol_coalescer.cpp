@@ -0,0 +1,394 @@
+////////////////////////////////////////////////////////////////////////////
+// unsol_coalescer.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Implements the class which rate limits the signal strength, network
+//    state and cell info notifications sent to the framework.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unsol_coalescer.h"
+#include "util.h"
+#include "rillog.h"
+#include "rril.h"
+#include "rildmain.h"
+
+//  Number of notifications between two logs of the counters
+static const UINT32 COUNTERS_LOG_PERIOD = 100;
+
+CUnsolCoalescer::CUnsolCoalescer() :
+    m_uiWindowMs(1000),
+    m_uiSignalStrengthDelta(2),
+    m_bFlushScheduled(FALSE),
+    m_nTotal(0)
+{
+    memset(m_rgSlots, 0, sizeof(m_rgSlots));
+    m_rgSlots[SLOT_SIGNAL_STRENGTH].unsolResponseID = RIL_UNSOL_SIGNAL_STRENGTH;
+    m_rgSlots[SLOT_NETWORK_STATE].unsolResponseID =
+            RIL_UNSOL_RESPONSE_VOICE_NETWORK_STATE_CHANGED;
+    m_rgSlots[SLOT_CELL_INFO].unsolResponseID = RIL_UNSOL_CELL_INFO_LIST;
+}
+
+CUnsolCoalescer::~CUnsolCoalescer()
+{
+    for (UINT32 i = 0; i < SLOT_COUNT; i++)
+    {
+        delete[] m_rgSlots[i].pSent;
+        delete[] m_rgSlots[i].pPending;
+    }
+}
+
+BOOL CUnsolCoalescer::Coalesce(int unsolResponseID, const void* pData, size_t dataSize)
+{
+    BOOL bSend = FALSE;
+    UINT32 uiNow = 0;
+    UINT32 uiHash = 0;
+    Slot* pSlot = NULL;
+
+    if (RIL_UNSOL_RESPONSE_RADIO_STATE_CHANGED == unsolResponseID)
+    {
+        //  The framework refreshes its state after a radio state change, so
+        //  the next notifications must not be dropped as identical.
+        CMutex::Lock(&m_cSendMutex);
+        CMutex::Lock(&m_cMutex);
+        Reset();
+        CMutex::Unlock(&m_cMutex);
+        CMutex::Unlock(&m_cSendMutex);
+        return FALSE;
+    }
+
+    pSlot = FindSlot(unsolResponseID);
+    if (NULL == pSlot)
+    {
+        return FALSE;
+    }
+
+    uiHash = HashData(pData, dataSize);
+
+    CMutex::Lock(&m_cSendMutex);
+    CMutex::Lock(&m_cMutex);
+
+    uiNow = GetMonotonicMs();
+
+    if (IsSameAsSent(*pSlot, pData, dataSize, uiHash))
+    {
+        //  The framework already has this data; a held back one is outdated.
+        if (pSlot->bPending)
+        {
+            pSlot->bPending = FALSE;
+            pSlot->nSuppressed++;
+        }
+        pSlot->nSuppressed++;
+    }
+    else if (0 == m_uiWindowMs || !pSlot->bSent
+            || uiNow - pSlot->uiSentTime >= m_uiWindowMs
+            || IsSignificantChange(*pSlot, pData, dataSize)
+            //  Sent at once if it cannot be held back
+            || !Store(pSlot->pPending, pData, dataSize))
+    {
+        if (pSlot->bPending)
+        {
+            pSlot->bPending = FALSE;
+            pSlot->nSuppressed++;
+        }
+        MarkSent(*pSlot, pData, dataSize, uiHash, uiNow);
+        pSlot->nDelivered++;
+        bSend = TRUE;
+    }
+    else
+    {
+        //  Replaces the one held back, if any
+        if (pSlot->bPending)
+        {
+            pSlot->nSuppressed++;
+        }
+        pSlot->bPending = TRUE;
+        pSlot->pendingSize = dataSize;
+        ScheduleFlush(uiNow);
+    }
+
+    if (0 == ++m_nTotal % COUNTERS_LOG_PERIOD)
+    {
+        LogCounters();
+    }
+
+    CMutex::Unlock(&m_cMutex);
+
+    if (bSend)
+    {
+        RIL_onCoalescedUnsolicitedResponse(unsolResponseID, pData, dataSize);
+    }
+
+    CMutex::Unlock(&m_cSendMutex);
+    return TRUE;
+}
+
+void CUnsolCoalescer::GetCounters(UINT32& ruiDelivered, UINT32& ruiSuppressed)
+{
+    ruiDelivered = 0;
+    ruiSuppressed = 0;
+
+    CMutex::Lock(&m_cMutex);
+    for (UINT32 i = 0; i < SLOT_COUNT; i++)
+    {
+        ruiDelivered += m_rgSlots[i].nDelivered;
+        ruiSuppressed += m_rgSlots[i].nSuppressed;
+    }
+    CMutex::Unlock(&m_cMutex);
+}
+
+CUnsolCoalescer::Slot* CUnsolCoalescer::FindSlot(int unsolResponseID)
+{
+    for (UINT32 i = 0; i < SLOT_COUNT; i++)
+    {
+        if (m_rgSlots[i].unsolResponseID == unsolResponseID)
+        {
+            return &m_rgSlots[i];
+        }
+    }
+    return NULL;
+}
+
+//  Called with m_cMutex held
+void CUnsolCoalescer::Reset()
+{
+    for (UINT32 i = 0; i < SLOT_COUNT; i++)
+    {
+        if (m_rgSlots[i].bPending)
+        {
+            m_rgSlots[i].bPending = FALSE;
+            m_rgSlots[i].nSuppressed++;
+        }
+        m_rgSlots[i].bSent = FALSE;
+    }
+}
+
+BOOL CUnsolCoalescer::IsSameAsSent(const Slot& rSlot, const void* pData, size_t dataSize,
+        UINT32 uiHash)
+{
+    //  Notifications without data only tell that something changed.
+    return (rSlot.bSent && 0 != dataSize && NULL != pData
+            && rSlot.sentSize == dataSize && rSlot.uiSentHash == uiHash
+            && 0 == memcmp(rSlot.pSent, pData, dataSize));
+}
+
+BOOL CUnsolCoalescer::IsSignificantChange(const Slot& rSlot, const void* pData,
+        size_t dataSize)
+{
+    const RIL_SignalStrength_v6* pNew = (const RIL_SignalStrength_v6*)pData;
+    const RIL_SignalStrength_v6* pOld = (const RIL_SignalStrength_v6*)rSlot.pSent;
+    int iOld = 0;
+    int iNew = 0;
+
+    if (RIL_UNSOL_SIGNAL_STRENGTH != rSlot.unsolResponseID)
+    {
+        return FALSE;
+    }
+
+    if (NULL == pNew || NULL == pOld || sizeof(RIL_SignalStrength_v6) != dataSize
+            || sizeof(RIL_SignalStrength_v6) != rSlot.sentSize)
+    {
+        return TRUE;
+    }
+
+    //  Gaining or losing the signal is always sent at once.
+    iOld = pOld->GW_SignalStrength.signalStrength;
+    iNew = pNew->GW_SignalStrength.signalStrength;
+    if ((99 == iOld) != (99 == iNew))
+    {
+        return TRUE;
+    }
+    if (99 != iNew && (UINT32)abs(iNew - iOld) >= m_uiSignalStrengthDelta)
+    {
+        return TRUE;
+    }
+
+    iOld = pOld->LTE_SignalStrength.rsrp;
+    iNew = pNew->LTE_SignalStrength.rsrp;
+    if ((INT_MAX == iOld) != (INT_MAX == iNew))
+    {
+        return TRUE;
+    }
+    if (INT_MAX != iNew && (UINT32)abs(iNew - iOld) >= m_uiSignalStrengthDelta)
+    {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+BOOL CUnsolCoalescer::Store(BYTE*& rpBuffer, const void* pData, size_t dataSize)
+{
+    delete[] rpBuffer;
+    rpBuffer = NULL;
+
+    if (NULL == pData || 0 == dataSize)
+    {
+        return TRUE;
+    }
+
+    rpBuffer = new BYTE[dataSize];
+    if (NULL == rpBuffer)
+    {
+        RIL_LOG_CRITICAL("CUnsolCoalescer::Store() - Could not allocate %u bytes\r\n",
+                (UINT32)dataSize);
+        return FALSE;
+    }
+
+    memcpy(rpBuffer, pData, dataSize);
+    return TRUE;
+}
+
+void CUnsolCoalescer::MarkSent(Slot& rSlot, const void* pData, size_t dataSize, UINT32 uiHash,
+        UINT32 uiNow)
+{
+    //  Without a copy, the next notification is never taken as identical.
+    rSlot.sentSize = Store(rSlot.pSent, pData, dataSize) ? dataSize : 0;
+    rSlot.uiSentHash = uiHash;
+    rSlot.uiSentTime = uiNow;
+    rSlot.bSent = TRUE;
+}
+
+//  Called with m_cMutex held
+void CUnsolCoalescer::ScheduleFlush(UINT32 uiNow)
+{
+    UINT32 uiDelayMs = m_uiWindowMs;
+
+    if (m_bFlushScheduled)
+    {
+        return;
+    }
+
+    for (UINT32 i = 0; i < SLOT_COUNT; i++)
+    {
+        const Slot& rSlot = m_rgSlots[i];
+        if (rSlot.bPending)
+        {
+            UINT32 uiElapsed = uiNow - rSlot.uiSentTime;
+            UINT32 uiRemaining = (uiElapsed < m_uiWindowMs) ? m_uiWindowMs - uiElapsed : 0;
+            if (uiRemaining < uiDelayMs)
+            {
+                uiDelayMs = uiRemaining;
+            }
+        }
+    }
+
+    m_bFlushScheduled = TRUE;
+    RIL_requestTimedCallback(FlushCallback, this, uiDelayMs / 1000, (uiDelayMs % 1000) * 1000);
+}
+
+void CUnsolCoalescer::LogCounters()
+{
+    for (UINT32 i = 0; i < SLOT_COUNT; i++)
+    {
+        RIL_LOG_INFO("CUnsolCoalescer::LogCounters() - ID %d: %u delivered, %u suppressed\r\n",
+                m_rgSlots[i].unsolResponseID, m_rgSlots[i].nDelivered,
+                m_rgSlots[i].nSuppressed);
+    }
+}
+
+void CUnsolCoalescer::FlushCallback(void* pParam)
+{
+    ((CUnsolCoalescer*)pParam)->Flush();
+}
+
+void CUnsolCoalescer::Flush()
+{
+    int rgUnsolResponseID[SLOT_COUNT];
+    BYTE* rgpData[SLOT_COUNT];
+    size_t rgDataSize[SLOT_COUNT];
+    UINT32 nDue = 0;
+    BOOL bPending = FALSE;
+    UINT32 uiNow = 0;
+
+    //  Until the due notifications are sent, none can be sent at once.
+    CMutex::Lock(&m_cSendMutex);
+    CMutex::Lock(&m_cMutex);
+
+    uiNow = GetMonotonicMs();
+
+    m_bFlushScheduled = FALSE;
+    for (UINT32 i = 0; i < SLOT_COUNT; i++)
+    {
+        Slot& rSlot = m_rgSlots[i];
+        if (!rSlot.bPending)
+        {
+            continue;
+        }
+
+        if (uiNow - rSlot.uiSentTime < m_uiWindowMs)
+        {
+            bPending = TRUE;
+            continue;
+        }
+
+        //  The held back copy becomes the sent one; hand a copy of it out of
+        //  the lock.
+        rgUnsolResponseID[nDue] = rSlot.unsolResponseID;
+        rgpData[nDue] = NULL;
+        rgDataSize[nDue] = 0;
+        if (Store(rgpData[nDue], rSlot.pPending, rSlot.pendingSize))
+        {
+            rgDataSize[nDue] = rSlot.pendingSize;
+        }
+
+        delete[] rSlot.pSent;
+        rSlot.pSent = rSlot.pPending;
+        rSlot.sentSize = rSlot.pendingSize;
+        rSlot.uiSentHash = HashData(rSlot.pSent, rSlot.sentSize);
+        rSlot.uiSentTime = uiNow;
+        rSlot.bSent = TRUE;
+        rSlot.pPending = NULL;
+        rSlot.pendingSize = 0;
+        rSlot.bPending = FALSE;
+        rSlot.nDelivered++;
+        nDue++;
+    }
+
+    if (bPending)
+    {
+        ScheduleFlush(uiNow);
+    }
+
+    CMutex::Unlock(&m_cMutex);
+
+    for (UINT32 i = 0; i < nDue; i++)
+    {
+        RIL_LOG_VERBOSE("CUnsolCoalescer::Flush() - Sending ID %d\r\n", rgUnsolResponseID[i]);
+        RIL_onCoalescedUnsolicitedResponse(rgUnsolResponseID[i], rgpData[i], rgDataSize[i]);
+        delete[] rgpData[i];
+    }
+
+    CMutex::Unlock(&m_cSendMutex);
+}
+
+//  FNV-1a
+UINT32 CUnsolCoalescer::HashData(const void* pData, size_t dataSize)
+{
+    const BYTE* pByte = (const BYTE*)pData;
+    UINT32 uiHash = 2166136261U;
+
+    for (size_t i = 0; NULL != pByte && i < dataSize; i++)
+    {
+        uiHash ^= pByte[i];
+        uiHash *= 16777619U;
+    }
+    return uiHash;
+}
+
+//  Unlike GetTickCount(), does not jump when the wall clock is set.
+UINT32 CUnsolCoalescer::GetMonotonicMs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT32)ts.tv_sec * 1000 + (UINT32)(ts.tv_nsec / 1000000);
+}
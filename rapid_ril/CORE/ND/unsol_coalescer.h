@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////
+// unsol_coalescer.h
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Defines the class which rate limits the signal strength, network state
+//    and cell info notifications sent to the framework.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef RRIL_UNSOL_COALESCER_H
+#define RRIL_UNSOL_COALESCER_H
+
+#include <stddef.h>
+
+#include "types.h"
+#include "sync_ops.h"
+
+//  Within a window after a notification has been sent, later notifications of
+//  the same ID are held back and only the latest one is sent when the window
+//  ends. Notifications carrying the same data as the last one sent are
+//  dropped, and a signal strength change of at least the configured delta is
+//  sent at once. A radio state change forgets what was sent.
+//
+//  The coalescer sends the notifications it handles itself, one at a time, so
+//  that one sent at once cannot overtake an older one being flushed.
+class CUnsolCoalescer
+{
+public:
+    CUnsolCoalescer();
+    ~CUnsolCoalescer();
+
+    //  0 disables coalescing; identical notifications are still dropped.
+    void SetWindow(UINT32 uiWindowMs) { m_uiWindowMs = uiWindowMs; }
+
+    //  In asu for GSM/UMTS and in dB for LTE RSRP; 0 sends every change at once.
+    void SetSignalStrengthDelta(UINT32 uiDelta) { m_uiSignalStrengthDelta = uiDelta; }
+
+    //  Returns TRUE if the notification was sent, held back or dropped, FALSE
+    //  if it is not coalesced and the caller has to send it.
+    BOOL Coalesce(int unsolResponseID, const void* pData, size_t dataSize);
+
+    void GetCounters(UINT32& ruiDelivered, UINT32& ruiSuppressed);
+
+private:
+    struct Slot
+    {
+        int         unsolResponseID;
+        BOOL        bSent;
+        UINT32      uiSentTime;
+        UINT32      uiSentHash;
+        size_t      sentSize;
+        BYTE*       pSent;
+        BOOL        bPending;
+        size_t      pendingSize;
+        BYTE*       pPending;
+        UINT32      nDelivered;
+        UINT32      nSuppressed;
+    };
+
+    enum
+    {
+        SLOT_SIGNAL_STRENGTH,
+        SLOT_NETWORK_STATE,
+        SLOT_CELL_INFO,
+        SLOT_COUNT
+    };
+
+    Slot    m_rgSlots[SLOT_COUNT];
+    UINT32  m_uiWindowMs;
+    UINT32  m_uiSignalStrengthDelta;
+    BOOL    m_bFlushScheduled;
+    UINT32  m_nTotal;
+    CMutex  m_cMutex;
+    //  Held across a decision to send and the sending; taken before m_cMutex
+    CMutex  m_cSendMutex;
+
+    Slot* FindSlot(int unsolResponseID);
+    void Reset();
+    BOOL IsSameAsSent(const Slot& rSlot, const void* pData, size_t dataSize, UINT32 uiHash);
+    BOOL IsSignificantChange(const Slot& rSlot, const void* pData, size_t dataSize);
+    BOOL Store(BYTE*& rpBuffer, const void* pData, size_t dataSize);
+    void MarkSent(Slot& rSlot, const void* pData, size_t dataSize, UINT32 uiHash, UINT32 uiNow);
+    void ScheduleFlush(UINT32 uiNow);
+    void LogCounters();
+
+    static void FlushCallback(void* pParam);
+    void Flush();
+
+    static UINT32 HashData(const void* pData, size_t dataSize);
+    static UINT32 GetMonotonicMs();
+};
+
+#endif // RRIL_UNSOL_COALESCER_H
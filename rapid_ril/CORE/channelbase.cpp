@@ -193,6 +193,10 @@ BOOL CChannelBase::AddSilo(CSilo* pSilo)
     if (SILO_MAX > m_SiloContainer.nSilos)
     {
         m_SiloContainer.rgpSilos[m_SiloContainer.nSilos++] = pSilo;
+
+        //  Silos are only added before the read thread starts, so the index can
+        //  simply be rebuilt. If that fails, responses go through the silos one by one.
+        m_UrcDispatcher.Build(m_SiloContainer.rgpSilos, m_SiloContainer.nSilos);
     }
     else
     {
@@ -917,9 +921,12 @@ Done:
 UINT32 CChannelBase::ResponseThread()
 {
     RIL_LOG_VERBOSE("CChannelBase::ResponseThread() chnl=[%d] - Enter\r\n", m_uiRilChannel);
-    const UINT32 uiRespDataBufSize = 1024;
+    //  Large enough for a phonebook or SMS list burst to come in a few reads
+    const UINT32 uiRespDataBufSize = 4096;
     char         szData[uiRespDataBufSize];
     UINT32       uiRead;
+    UINT32       uiReads = 0;
+    const UINT32 IO_COUNTERS_LOG_PERIOD = 1000;
     UINT32       uiNumEvents;
     UINT32       uiReadError = 0;
     const UINT32 MAX_READERROR = 3;
@@ -1044,6 +1051,11 @@ UINT32 CChannelBase::ResponseThread()
             else
             {
                 uiReadError = 0;
+
+                if (0 == ++uiReads % IO_COUNTERS_LOG_PERIOD)
+                {
+                    LogIoCounters();
+                }
             }
 
             // If the thread is blocked don't take into account the data
@@ -1092,7 +1104,7 @@ BOOL CChannelBase::LockCommandQueue(UINT32 uiTimeout)
 }
 */
 //
-//  Iterate through each silo in this channel to ParseNotification.
+//  Find the silo handling this notification and let it parse it.
 //
 BOOL CChannelBase::ParseUnsolicitedResponse(CResponse* const pResponse,
                                                const char*& rszPointer,
@@ -1100,28 +1112,59 @@ BOOL CChannelBase::ParseUnsolicitedResponse(CResponse* const pResponse,
 {
     //RIL_LOG_VERBOSE("CChannelBase::ParseUnsolicitedResponse() - Enter\r\n");
     BOOL bResult = TRUE;
+    CSilo* pSilo = NULL;
+    PFN_ATRSP_PARSE fctParser = NULL;
     int count = m_SiloContainer.nSilos;
 
-    for (int i = 0; i < count; ++i)
+    if (m_UrcDispatcher.IsEmpty())
     {
-        CSilo* pSilo = NULL;
-        pSilo = m_SiloContainer.rgpSilos[i];
-
-        if (pSilo)
+        for (int i = 0; i < count; ++i)
         {
-            if (pSilo->ParseUnsolicitedResponse(pResponse, rszPointer, fGotoError))
-            {
-                //  we're done.
-                goto Done;
-            }
-            else if (fGotoError)
+            pSilo = m_SiloContainer.rgpSilos[i];
+
+            if (pSilo)
             {
-                //  done, but need to goto error.
-                break;
+                if (pSilo->ParseUnsolicitedResponse(pResponse, rszPointer, fGotoError))
+                {
+                    //  we're done.
+                    goto Done;
+                }
+                else if (fGotoError)
+                {
+                    //  done, but need to goto error.
+                    break;
+                }
             }
         }
+
+        goto Error;
     }
 
+    if (NULL == pResponse)
+    {
+        RIL_LOG_CRITICAL("CChannelBase::ParseUnsolicitedResponse() chnl=[%d] - pResponse is NULL"
+                "\r\n", m_uiRilChannel);
+        fGotoError = TRUE;
+        goto Error;
+    }
+
+    //  Same result as asking each silo in turn: the first table row, in silo order,
+    //  whose prefix matches.
+    if (!m_UrcDispatcher.Find(rszPointer, pSilo, fctParser, rszPointer))
+    {
+        goto Error;
+    }
+
+    if (!(pSilo->*fctParser)(pResponse, rszPointer))
+    {
+        //  There was a problem parsing the response, goto error
+        fGotoError = TRUE;
+        goto Error;
+    }
+
+    goto Done;
+
+Error:
     bResult = FALSE;
 Done:
     return bResult;
@@ -1134,14 +1177,18 @@ BOOL CChannelBase::InitPort()
 
 BOOL CChannelBase::ClosePort()
 {
+    LogIoCounters();
     return m_Port.Close();
 }
 
 BOOL CChannelBase::WriteToPort(const char* pData, UINT32 uiBytesToWrite, UINT32& ruiBytesWritten)
 {
-    RIL_LOG_INFO("CChannelBase::WriteToPort() - INFO: chnl=[%d] TX [%s]\r\n",
-                       m_uiRilChannel,
-                       CRLFExpandedString(pData,uiBytesToWrite).GetString());
+    if (CRilLog::IsInfoLogEnabled())
+    {
+        RIL_LOG_INFO("CChannelBase::WriteToPort() - INFO: chnl=[%d] TX [%s]\r\n",
+                           m_uiRilChannel,
+                           CRLFExpandedString(pData,uiBytesToWrite).GetString());
+    }
 
     return m_Port.Write(pData, uiBytesToWrite, ruiBytesWritten);
 }
@@ -1151,6 +1198,16 @@ BOOL CChannelBase::ReadFromPort(char* pszReadBuf, UINT32 uiReadBufSize, UINT32&
     return m_Port.Read(pszReadBuf, uiReadBufSize, ruiBytesRead);
 }
 
+void CChannelBase::LogIoCounters()
+{
+    FILE_IO_COUNTERS counters;
+
+    m_Port.GetIoCounters(counters);
+    RIL_LOG_INFO("CChannelBase::LogIoCounters() - chnl=[%d] RX [%u] bytes in [%u] reads,"
+            " TX [%u] bytes in [%u] writes\r\n", m_uiRilChannel, counters.uiBytesRead,
+            counters.uiReadCalls, counters.uiBytesWritten, counters.uiWriteCalls);
+}
+
 BOOL CChannelBase::IsPortOpen()
 {
     return m_Port.IsOpen();
@@ -18,6 +18,7 @@
 #include "command.h"
 #include "systemcaps.h"
 #include "initializer.h"
+#include "urc_dispatcher.h"
 
 // forward declarations
 class CSilo;
@@ -115,6 +116,7 @@ protected:
     BOOL ReadFromPort(char* pszReadBuf, UINT32 uiReadBufSize, UINT32& ruiBytesRead);
     BOOL IsPortOpen();
     BOOL WaitForAvailableData(UINT32 uiTimeout);
+    void LogIoCounters();
 
     //  Framework functions
     virtual BOOL SendCommand(CCommand*& rpCmd) = 0;
@@ -154,6 +156,9 @@ protected:
 
     SILO_CONTAINER m_SiloContainer;
 
+    //  Prefix index over the response tables of m_SiloContainer
+    CUrcDispatcher m_UrcDispatcher;
+
     CPort m_Port;
 
     //  When closing and opening the port (in case of AT command timeout),
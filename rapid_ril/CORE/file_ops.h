@@ -47,6 +47,15 @@
 #define FILE_EVENT_BREAK                0x00000002
 #define FILE_EVENT_ERROR                0x00000004
 
+// read()/write() system calls made on a file and the bytes they moved
+struct FILE_IO_COUNTERS
+{
+    UINT32 uiReadCalls;
+    UINT32 uiBytesRead;
+    UINT32 uiWriteCalls;
+    UINT32 uiBytesWritten;
+};
+
 class CFile
 {
 public:
@@ -69,6 +78,8 @@ public:
 
     static int GetFD(CFile* pFile);
 
+    static void GetIoCounters(CFile* pFile, FILE_IO_COUNTERS& rCounters);
+
     static inline char* GetName(CFile* pFile) { return pFile->m_pszFileName; }
 
 private:
@@ -95,6 +106,8 @@ private:
 
     BOOL   m_fInitialized;
 
+    FILE_IO_COUNTERS m_ioCounters;
+
     char*  m_pszFileName;
 };
 
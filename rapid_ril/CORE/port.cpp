@@ -31,6 +31,7 @@ CPort::CPort() :
     m_fIsPortOpen(FALSE),
     m_pFile(NULL)
 {
+    memset(&m_closedIoCounters, 0, sizeof(m_closedIoCounters));
 }
 
 CPort::~CPort()
@@ -47,6 +48,17 @@ CPort::~CPort()
     m_pFile = NULL;
 }
 
+void CPort::GetIoCounters(FILE_IO_COUNTERS& rCounters)
+{
+    FILE_IO_COUNTERS fileCounters;
+
+    CFile::GetIoCounters(m_pFile, fileCounters);
+    rCounters.uiReadCalls = m_closedIoCounters.uiReadCalls + fileCounters.uiReadCalls;
+    rCounters.uiBytesRead = m_closedIoCounters.uiBytesRead + fileCounters.uiBytesRead;
+    rCounters.uiWriteCalls = m_closedIoCounters.uiWriteCalls + fileCounters.uiWriteCalls;
+    rCounters.uiBytesWritten = m_closedIoCounters.uiBytesWritten + fileCounters.uiBytesWritten;
+}
+
 int CPort::GetFD()
 {
     int fd = -1;
@@ -187,6 +199,7 @@ BOOL CPort::Close()
         }
     }
 
+    GetIoCounters(m_closedIoCounters);
     delete m_pFile;
     m_pFile = NULL;
 
@@ -43,12 +43,18 @@ public:
 
     int  GetFD();
 
+    //  Totals since the port was created, across close and re-open
+    void GetIoCounters(FILE_IO_COUNTERS& rCounters);
+
 private:
     BOOL OpenPort(const char* pszFileName);
     BOOL OpenSocket(const char* pszSocketName);
 
     BOOL        m_fIsPortOpen;
     CFile*      m_pFile;
+
+    //  Counters of the files closed so far
+    FILE_IO_COUNTERS m_closedIoCounters;
 };
 
 #endif
@@ -28,6 +28,8 @@
 #define RRIL_REPOSITORY_H
 
 #include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "types.h"
 #include "constants.h"
 
@@ -62,6 +64,8 @@ extern const char   g_szTimeoutThresholdForRetry[];
 extern const char   g_szOpenPortRetries[];
 extern const char   g_szOpenPortInterval[];
 extern const char   g_szPinCacheMode[];
+extern const char   g_szUnsolCoalesceWindow[];
+extern const char   g_szSignalStrengthDelta[];
 
 /////////////////////////////////////////////////
 
@@ -149,53 +153,75 @@ public:
     // if successful, return 0
     // otherwise return -1
     BOOL Read(const char* szGroup, const char* szKey, int& iRes);
+    BOOL Read(const char* szGroup, const char* szKey, UINT32& ruiRes);
+    BOOL Read(const char* szGroup, const char* szKey, BOOL& rbRes);
     BOOL Read(const char* szGroup, const char* szKey, char* szRes, int iMaxLen);
     BOOL ReadFDParam(const char* szGroup, const char* szKey, char* szRes, int iMaxLen, int iMinVal,
                                                                                       int iMaxVal);
 
 private:
-    // file access and manipulation
-    BOOL  OpenRepositoryFile(void);
-    void  CloseRepositoryFile(void);
-    int   ReadLine(char* szBuf = NULL, bool bRemoveCRAndLF = true);
-    void  RemoveComment(char* szIn);
-    char* SkipSpace(char* szIn);
-    void  RemoveTrailingSpaces(char* szIn);
-    char* SkipAlphaNum(char* szIn);
-    int   DumpLines(int iFd, int iFrom, int iTo);
-    void  ResetFile(void);
-    int   GotoLine(int iLine);
-
-    // marker location utilities
-    int LocateGroup(const char* szGroup);
-    int LocateKey(const char* szKey, char* szOut = NULL);
-    int ExtractValue(char* szIn, char* szRes, UINT32 iMaxLen);
-
-    // locking/unlocking access to the NVM file
-    int ReaderLock();
-    int ReaderUnlock();
+    // The repository file is parsed once into an index of groups and keys,
+    // and parsed again only when its modification time, size or inode change.
+    struct RepGroup
+    {
+        const char* szName;             // group line, after the group marker
+        UINT32      uiNameLen;          // length of the group name token
+        UINT32      uiFirstEntry;       // keys of a group are contiguous in pEntries
+        UINT32      uiEntries;
+        UINT32      uiFirstMatch;       // first group whose name starts with this name
+        UINT32      uiHashNext;         // next group in hash bucket + 1, 0 if none
+    };
 
-private:
-    struct CRepLock
+    struct RepEntry
+    {
+        const char* szLine;             // key line, after leading spaces
+        UINT32      uiKeyLen;           // length of the key token
+        const char* szValue;            // value, comment and trailing spaces removed
+        UINT32      uiGroup;            // index of the group the key belongs to
+        UINT32      uiFirstMatch;       // first line of the group starting with this key
+        UINT32      uiHashNext;         // next entry in hash bucket + 1, 0 if none
+    };
+
+    struct RepCache
     {
-        pthread_mutex_t stLock;         // master lock
-        pthread_cond_t  stRead;         // lock for reader threads
-        UINT32          iReaders;       // # reader threads accessing the file
-        UINT32          iReadWaiters;   // # reader threads waiting to access the file
+        char*       pData;              // file contents, lines NULL-terminated in place
+        RepGroup*   pGroups;
+        UINT32      uiGroups;
+        RepEntry*   pEntries;
+        UINT32      uiEntries;
+        UINT32*     puiGroupHash;       // first group in bucket + 1, 0 if none
+        UINT32*     puiEntryHash;       // first entry in bucket + 1, 0 if none
+        UINT32      uiHashSize;         // power of two
+        time_t      tMTime;
+        off_t       tSize;
+        ino_t       tInode;
     };
 
-    static struct CRepLock m_stLock;
+    // index management, called with the repository lock held
+    static BOOL  Refresh(void);
+    static BOOL  Load(int iFd, const struct stat& rStat);
+    static void  FreeCache(void);
+    static int   FindGroup(const char* szGroup);
+    static const RepEntry* FindKey(int iGroup, const char* szKey);
+    static UINT32 HashName(UINT32 uiSeed, const char* szName, UINT32 uiLen);
+
+    // line parsing
+    static void  RemoveComment(char* szIn);
+    static char* SkipSpace(char* szIn);
+    static void  RemoveTrailingSpaces(char* szIn);
+    static char* SkipAlphaNum(char* szIn);
+    static char* ExtractValue(char* szIn);
+
+private:
+    static pthread_mutex_t m_stLock;    // protects the index and the repository path
+    static RepCache m_stCache;
 
 private:
     // constants
-    static const int END_OF_FILE  = -1;
     static const int MAX_INT_LEN  = 20;     // arbitrary number, long enough to hold a
                                             // string-representation of a 32-bit int
-    static const int MAX_LINE_LEN = 256;    // maximum length for a line in the NVM file
 
 private:
-    int m_iFd;                                    // file descriptor
-    int m_iLine;                                  // current line in file
     static bool m_bInitialized;                   // TRUE if repository initialized, FALSE otherwise
     static char  m_cRepoPath[MAX_MODEM_NAME_LEN]; // repository path
 };
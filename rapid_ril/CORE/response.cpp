@@ -49,6 +49,8 @@ CResponse::CResponse(CChannel* pChannel) :
     m_uiDataSize(0),
     m_pChannel(pChannel),
     m_uiResponseEndMarker(0),
+    m_uiLineStart(0),
+    m_uiScanPos(0),
     m_uiFlags(0)
 {
     CopyStringNullTerminate(m_szNewLine, "\r\n", sizeof(m_szNewLine));
@@ -66,44 +68,52 @@ CResponse::~CResponse()
 
 
 //
-//
+//  Called each time data is appended. Only the bytes received since the last
+//  call are searched for line ends, and each complete line is classified once,
+//  so a long response read in many chunks costs no more than one read at once.
 //
 BOOL CResponse::IsCompleteResponse()
 {
     BOOL bRet = FALSE;
     RIL_LOG_VERBOSE("CResponse::IsCompleteResponse() : Enter\r\n");
 
-    if (m_uiUsed > 0)
+    if (Size() > 0)
     {
+        const char* szBase = Data();
+        const UINT32 uiSize = Size();
+        const char* szLineEnd;
+        const char* szFirstLine = szBase;
+        UINT32 uiFrom;
+
         // NULL-terminate the response string temporarily
         m_szBuffer[m_uiUsed] = '\0';
 
-        // data in the buffer; check the type of data received
-        if (IsUnsolicitedResponse())
-        {
-            bRet = TRUE;
-        }
-        else if (IsExtendedError(pszCMEError))
-        {
-            bRet = TRUE;
-        }
-        else if (IsExtendedError(pszCMSError))
-        {
-            bRet = TRUE;
-        }
-        else if (IsOkResponse())
+        // let the silos look at the response again whenever a new line of it has
+        // completed, not counting the <cr><lf> it starts with
+        SkipRspStart(szFirstLine, m_szNewLine, szFirstLine);
+        uiFrom = szFirstLine - szBase > m_uiScanPos ? szFirstLine - szBase : m_uiScanPos;
+        if (uiFrom < uiSize && NULL != memchr(szBase + uiFrom, '\n', uiSize - uiFrom)
+                && IsUnsolicitedResponse())
         {
             bRet = TRUE;
+            goto Done;
         }
-        else if (IsErrorResponse())
-        {
-            bRet = TRUE;
-        }
-        else if (IsConnectResponse())
+
+        // classify each newly completed line; the first final result code ends the response
+        while (m_uiScanPos < uiSize && NULL != (szLineEnd =
+                (const char*)memchr(szBase + m_uiScanPos, '\n', uiSize - m_uiScanPos)))
         {
-            bRet = TRUE;
+            m_uiScanPos = szLineEnd + 1 - szBase;
+            if (IsFinalResponse(szBase + m_uiLineStart, szBase + m_uiScanPos))
+            {
+                bRet = TRUE;
+                goto Done;
+            }
+            m_uiLineStart = m_uiScanPos;
         }
-        else if (IsAbortedResponse())
+        m_uiScanPos = uiSize;
+
+        if (IsSmsPrompt())
         {
             bRet = TRUE;
         }
@@ -113,6 +123,7 @@ BOOL CResponse::IsCompleteResponse()
         }
     }
 
+Done:
     RIL_LOG_VERBOSE("CResponse::IsCompleteResponse() : Exit [%d]\r\n", bRet);
     return bRet;
 }
@@ -125,7 +136,7 @@ BOOL CResponse::IsUnsolicitedResponse()
 {
     BOOL bRet = FALSE;
     BOOL bGotoError = FALSE;
-    const char* szPointer = m_szBuffer;
+    const char* szPointer = Data();
 
     RIL_LOG_VERBOSE("CResponse::IsUnsolicitedResponse() : Enter\r\n");
 
@@ -147,7 +158,7 @@ BOOL CResponse::IsUnsolicitedResponse()
         }
         else
         {
-            m_uiResponseEndMarker = szPointer - m_szBuffer;
+            m_uiResponseEndMarker = szPointer - Data();
         }
     }
 
@@ -158,18 +169,63 @@ Error:
 
 
 //
+//  szLine..szLineEnd is one complete line, including its line feed.
 //
+BOOL CResponse::IsFinalResponse(const char* szLine, const char* szLineEnd)
+{
+    UINT32 uiResultCode;
+
+    if (IsExtendedError(szLine, szLineEnd, pszCMEError) ||
+            IsExtendedError(szLine, szLineEnd, pszCMSError))
+    {
+        return TRUE;
+    }
+
+    if (IsResultCode(szLine, szLineEnd, pszOkResponse) ||
+            IsResultCode(szLine, szLineEnd, pszConnectResponse) ||
+            IsResultCode(szLine, szLineEnd, pszAborted))
+    {
+        uiResultCode = RIL_E_SUCCESS;
+    }
+    else if (IsResultCode(szLine, szLineEnd, pszErrorResponse))
+    {
+        uiResultCode = RIL_E_GENERIC_FAILURE;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    SetUnsolicitedFlag(FALSE);
+    m_uiResultCode = uiResultCode;
+    m_uiResponseEndMarker = szLineEnd - Data();
+    return TRUE;
+}
+
+
 //
-BOOL CResponse::IsExtendedError(const char* pszToken)
+//
+//
+BOOL CResponse::IsExtendedError(const char* szLine, const char* szLineEnd, const char* pszToken)
 {
     BOOL bRet = FALSE;
-    const char* szPointer = m_szBuffer;
+    const UINT32 uiTokenLen = strlen(pszToken);
+    const char* szPointer = szLine;
 
-    RIL_LOG_VERBOSE("CResponse::IsExtendedError() : Enter\r\n");
+    // look for the token anywhere in the line
+    while (NULL != (szPointer = (const char*)memchr(szPointer, pszToken[0], szLineEnd - szPointer)))
+    {
+        if (0 == strncmp(szPointer, pszToken, uiTokenLen))
+        {
+            break;
+        }
+        ++szPointer;
+    }
 
-    if (FindAndSkipString(szPointer, pszToken, szPointer))
+    if (NULL != szPointer)
     {
         RIL_LOG_INFO("chnl=[%d] Got %s response\r\n", m_pChannel->GetRilChannel(), pszToken);
+        szPointer += uiTokenLen;
 
         // get error code
         UINT32 nCode;
@@ -177,16 +233,8 @@ BOOL CResponse::IsExtendedError(const char* pszToken)
         {
             RIL_LOG_CRITICAL("CResponse::IsExtendedError() - chnl=[%d] could not extract error"
                     " code\r\n", m_pChannel->GetRilChannel());
-            // treat as unrecognized - discard everything until the CR LF or end of buffer
-            if (!SkipRspEnd(szPointer, m_szNewLine, szPointer))
-            {
-                // no CR LF - discard everything
-                m_uiResponseEndMarker = m_uiUsed;
-            }
-            else
-            {
-                m_uiResponseEndMarker = szPointer - m_szBuffer;
-            }
+            // treat as unrecognized - discard up to the end of the line
+            m_uiResponseEndMarker = szLineEnd - Data();
             SetUnrecognizedFlag(TRUE);
             bRet = TRUE;
             goto Error;
@@ -197,102 +245,64 @@ BOOL CResponse::IsExtendedError(const char* pszToken)
             RIL_LOG_CRITICAL("CResponse::IsExtendedError() - chnl=[%d] no CRLF at end of response:"
                     " \"%s\"\r\n",
                     m_pChannel->GetRilChannel(),
-                    CRLFExpandedString(szPointer, strlen(szPointer)).GetString());
+                    CRLFExpandedString(szPointer, szLineEnd - szPointer).GetString());
             goto Error;
         }
-        m_uiResponseEndMarker = szPointer - m_szBuffer;
+        m_uiResponseEndMarker = szPointer - Data();
         bRet = TRUE;
     }
 
 Error:
-    RIL_LOG_VERBOSE("CResponse::IsExtendedError() : Exit[%d]\r\n", bRet);
     return bRet;
 }
 
 
 //
+//  Is the line "<cr><lf><token><cr><lf>"? For "OK", anything ending in
+//  "OK<cr><lf>" is accepted, in case the modem missed a character.
 //
-//
-BOOL CResponse::IsCorruptResponse()
+BOOL CResponse::IsResultCode(const char* szLine, const char* szLineEnd, const char* pszToken)
 {
-    BOOL bRet = FALSE;
-    const char* szDummy = NULL;
+    const UINT32 uiNewLineLen = strlen(m_szNewLine);
+    const UINT32 uiTokenLen = strlen(pszToken);
+    const char* szToken = szLineEnd - uiNewLineLen - uiTokenLen;
 
-    RIL_LOG_VERBOSE("CResponse::IsCorruptResponse() : Enter\r\n");
-
-    if (IsCorruptFlag())
+    if (szToken < szLine ||
+            0 != strncmp(szToken, pszToken, uiTokenLen) ||
+            0 != strncmp(szLineEnd - uiNewLineLen, m_szNewLine, uiNewLineLen))
     {
-        RIL_LOG_INFO("CResponse::IsCorruptResponse() : chnl=[%d] Attempting to filter corrupt"
-                " response\r\n", m_pChannel->GetRilChannel());
-        SetCorruptFlag(FALSE);
-
-        // heuristic used is to parse everything up to the first CR.
-        const char* szPointer = m_szBuffer;
-        if (FindAndSkipString(szPointer, "\r", szPointer))
-        {
-            // if the CR is followed by a LF, then consume that, too.
-            if (SkipString(szPointer, "\n", szPointer))
-            {
-                //  If next item is \r, then stop here
-                if (SkipString(szPointer+1, "\r", szDummy))
-                {
-
+        return FALSE;
+    }
 
-                    // treat as unrecognized
-                    SetUnrecognizedFlag(TRUE);
-                    m_uiResponseEndMarker = szPointer - m_szBuffer;
-                    bRet = TRUE;
-                }
-            }
-        }
+    if (pszOkResponse == pszToken)
+    {
+        return TRUE;
     }
 
-    RIL_LOG_VERBOSE("CResponse::IsCorruptResponse() : Exit[%d]\r\n", bRet);
-    return bRet;
+    return szToken == szLine && (UINT32)(szLine - Data()) >= uiNewLineLen &&
+            0 == strncmp(szLine - uiNewLineLen, m_szNewLine, uiNewLineLen);
 }
 
 
 //
 //
 //
-BOOL CResponse::IsOkResponse()
+BOOL CResponse::IsSmsPrompt()
 {
-    const char* szPointer = m_szBuffer;
-    char szToken[MAX_BUFFER_SIZE] = {0};
+    const char* szPointer = Data();
     BOOL bRet;
 
-    RIL_LOG_VERBOSE("CResponse::IsOkResponse() : Enter\r\n");
-
-    // look for "OK" in response data
-    snprintf(szToken, MAX_BUFFER_SIZE-1, "%s%s%s", m_szNewLine, pszOkResponse, m_szNewLine);
-    szToken[MAX_BUFFER_SIZE-1] = '\0';  //  KW fix
-    bRet = FindAndSkipString(szPointer, szToken, szPointer);
-
-    if (!bRet)
-    {
-        //  Maybe we have just OK<cr><lf> due to modem missing a character
-        snprintf(szToken, MAX_BUFFER_SIZE-1, "%s%s", pszOkResponse, m_szNewLine);
-        szToken[MAX_BUFFER_SIZE-1] = '\0';  //  KW fix
-        bRet = FindAndSkipString(szPointer, szToken, szPointer);
-    }
-
-    if (!bRet)
-    {
-        // No "OK" in buffer - is this an SMS intermediate prompt?
-        // look for SMS token from the beginning of the buffer only
-        bRet = SkipRspStart(szPointer, m_szNewLine, szPointer) &&
-               SkipString(szPointer, pszSMSResponse, szPointer);
-    }
+    // look for SMS token from the beginning of the buffer only
+    bRet = SkipRspStart(szPointer, m_szNewLine, szPointer) &&
+           SkipString(szPointer, pszSMSResponse, szPointer);
 
     if (bRet)
     {
         SetUnsolicitedFlag(FALSE);
-        m_uiResponseEndMarker = szPointer - m_szBuffer;
+        m_uiResponseEndMarker = szPointer - Data();
         m_uiResultCode = RIL_E_SUCCESS;
     }
 
-Error:
-    RIL_LOG_VERBOSE("CResponse::IsOkResponse() : Exit [%d]\r\n", bRet);
     return bRet;
 }
 
@@ -300,93 +310,56 @@ Error:
 //
 //
 //
-BOOL CResponse::IsErrorResponse()
+BOOL CResponse::IsCorruptResponse()
 {
-    const char* szPointer = m_szBuffer;
-    char szToken[MAX_BUFFER_SIZE] = {0};
     BOOL bRet = FALSE;
+    const char* szDummy = NULL;
 
-    RIL_LOG_VERBOSE("CResponse::IsErrorResponse() : Enter\r\n");
-
-    // look for "ERROR" in response data
-    snprintf(szToken, MAX_BUFFER_SIZE-1, "%s%s%s", m_szNewLine, pszErrorResponse, m_szNewLine);
-    szToken[MAX_BUFFER_SIZE-1] = '\0';  //  KW fix
-    bRet = FindAndSkipString(szPointer, szToken, szPointer);
+    RIL_LOG_VERBOSE("CResponse::IsCorruptResponse() : Enter\r\n");
 
-    if (bRet)
+    if (IsCorruptFlag())
     {
-        // found ERROR response
-        RIL_RESULT_CODE resCode;
-        SetUnsolicitedFlag(FALSE);
-        m_uiResultCode = RIL_E_GENERIC_FAILURE;
-
-        m_uiResponseEndMarker = szPointer - m_szBuffer;
-        bRet = TRUE;
-    }
-
-Error:
-    RIL_LOG_VERBOSE("CResponse::IsErrorResponse() : Exit [%d]\r\n", bRet);
-    return bRet;
-}
-
-//
-//
-//
-BOOL CResponse::IsConnectResponse()
-{
-    const char* szPointer = m_szBuffer;
-    char szToken[MAX_BUFFER_SIZE] = {0};
-    BOOL bRet;
+        RIL_LOG_INFO("CResponse::IsCorruptResponse() : chnl=[%d] Attempting to filter corrupt"
+                " response\r\n", m_pChannel->GetRilChannel());
+        SetCorruptFlag(FALSE);
 
-    RIL_LOG_VERBOSE("CResponse::IsConnectResponse() : Enter\r\n");
+        // heuristic used is to parse everything up to the first CR.
+        const char* szPointer = Data();
+        if (FindAndSkipString(szPointer, "\r", szPointer))
+        {
+            // if the CR is followed by a LF, then consume that, too.
+            if (SkipString(szPointer, "\n", szPointer))
+            {
+                //  If next item is \r, then stop here
+                if (SkipString(szPointer+1, "\r", szDummy))
+                {
 
-    // look for "CONNECT" in response data
-    snprintf(szToken, MAX_BUFFER_SIZE-1, "%s%s%s", m_szNewLine, pszConnectResponse, m_szNewLine);
-    szToken[MAX_BUFFER_SIZE-1] = '\0';  //  KW fix
-    bRet = FindAndSkipString(szPointer, szToken, szPointer);
 
-    if (bRet)
-    {
-        SetUnsolicitedFlag(FALSE);
-        m_uiResponseEndMarker = szPointer - m_szBuffer;
-        m_uiResultCode = RIL_E_SUCCESS;
+                    // treat as unrecognized
+                    SetUnrecognizedFlag(TRUE);
+                    m_uiResponseEndMarker = szPointer - Data();
+                    bRet = TRUE;
+                }
+            }
+        }
     }
 
-Error:
-    RIL_LOG_VERBOSE("CResponse::IsConnectResponse() : Exit [%d]\r\n", bRet);
+    RIL_LOG_VERBOSE("CResponse::IsCorruptResponse() : Exit[%d]\r\n", bRet);
     return bRet;
 }
 
+
 //
 //
 //
-BOOL CResponse::IsAbortedResponse()
+void CResponse::ResetFraming()
 {
-    const char* szPointer = m_szBuffer;
-    char szToken[MAX_BUFFER_SIZE] = {0};
-    BOOL bRet;
-
-    RIL_LOG_VERBOSE("CResponse::IsAbortedResponse() : Enter\r\n");
-
-    // look for "ABORTED" in response data
-    snprintf(szToken, MAX_BUFFER_SIZE-1, "%s%s%s", m_szNewLine, pszAborted, m_szNewLine);
-    szToken[MAX_BUFFER_SIZE-1] = '\0';  //  KW fix
-    bRet = FindAndSkipString(szPointer, szToken, szPointer);
-
-    if (bRet)
-    {
-        SetUnsolicitedFlag(FALSE);
-        m_uiResponseEndMarker = szPointer - m_szBuffer;
-        m_uiResultCode = RIL_E_SUCCESS;
-    }
-
-Error:
-    RIL_LOG_VERBOSE("CResponse::IsAbortedResponse() : Exit [%d]\r\n", bRet);
-    return bRet;
+    m_uiResponseEndMarker = 0;
+    m_uiLineStart = 0;
+    m_uiScanPos = 0;
 }
 
 
-
 //
 //
 //
@@ -394,36 +367,79 @@ BOOL CResponse::TransferData(CResponse*& rpRspIn, CResponse*& rpRspOut)
 {
     BOOL       bRet = FALSE;
     CResponse* pRspTmp;
-    int        iRemainder;
+    UINT32     uiRemainder;
 
     RIL_LOG_VERBOSE("CResponse::TransferData() : Enter\r\n");
 
     // rpRspIn must be NOT NULL, rpRspOut must be NULL
     if (NULL == rpRspIn || NULL != rpRspOut
-            || 0 == rpRspIn->m_uiUsed || 0 == rpRspIn->m_uiResponseEndMarker)
+            || 0 == rpRspIn->Size() || 0 == rpRspIn->m_uiResponseEndMarker
+            || rpRspIn->m_uiResponseEndMarker > rpRspIn->Size())
     {
         RIL_LOG_CRITICAL("CResponse::TransferData() : Invalid parameters\r\n");
         goto Error;
     }
 
-    pRspTmp = rpRspIn;
-    rpRspIn = new CResponse(pRspTmp->m_pChannel);
-    if (!rpRspIn)
+    pRspTmp = new CResponse(rpRspIn->m_pChannel);
+    if (!pRspTmp)
     {
         RIL_LOG_CRITICAL("CResponse::TransferData() : Out of memory\r\n");
-        rpRspIn = pRspTmp;
         goto Error;
     }
 
-    // RspOut contains the valid response, RspIn keeps the remainder
-    rpRspOut = pRspTmp;
-    iRemainder = rpRspOut->m_uiUsed - rpRspOut->m_uiResponseEndMarker;
-    if (iRemainder > 0)
+    uiRemainder = rpRspIn->Size() - rpRspIn->m_uiResponseEndMarker;
+    if (0 == uiRemainder)
+    {
+        // RspOut takes the buffer as is, RspIn starts over empty
+        rpRspOut = rpRspIn;
+        rpRspIn = pRspTmp;
+    }
+    else if (uiRemainder < rpRspIn->m_uiResponseEndMarker)
+    {
+        // A long response (e.g. a phonebook or SMS list) followed by the start of the next
+        // one: RspOut takes the buffer cut after the response, RspIn starts over with a
+        // copy of the remainder.
+        if (!pRspTmp->Append(rpRspIn->Data() + rpRspIn->m_uiResponseEndMarker, uiRemainder))
+        {
+            RIL_LOG_CRITICAL("CResponse::TransferData() : Out of memory\r\n");
+            delete pRspTmp;
+            goto Error;
+        }
+
+        rpRspIn->m_uiUsed = rpRspIn->m_uiHead + rpRspIn->m_uiResponseEndMarker;
+        rpRspIn->m_szBuffer[rpRspIn->m_uiUsed] = '\0';
+
+        rpRspOut = rpRspIn;
+        rpRspIn = pRspTmp;
+    }
+    else
     {
-        rpRspIn->Append(rpRspOut->m_szBuffer + rpRspOut->m_uiResponseEndMarker, iRemainder);
-        rpRspOut->m_uiUsed -= iRemainder;
+        // RspOut gets a copy of the response; the remainder stays where it is in RspIn
+        // so that several responses read at once are not shifted down one by one.
+        if (!pRspTmp->Append(rpRspIn->Data(), rpRspIn->m_uiResponseEndMarker))
+        {
+            RIL_LOG_CRITICAL("CResponse::TransferData() : Out of memory\r\n");
+            delete pRspTmp;
+            goto Error;
+        }
+
+        pRspTmp->m_uiResultCode = rpRspIn->m_uiResultCode;
+        pRspTmp->m_uiErrorCode = rpRspIn->m_uiErrorCode;
+        pRspTmp->m_pData = rpRspIn->m_pData;
+        pRspTmp->m_uiDataSize = rpRspIn->m_uiDataSize;
+        pRspTmp->m_uiFlags = rpRspIn->m_uiFlags;
+        pRspTmp->m_uiResponseEndMarker = rpRspIn->m_uiResponseEndMarker;
+
+        rpRspIn->Consume(rpRspIn->m_uiResponseEndMarker);
+        rpRspIn->m_uiResultCode = RRIL_RESULT_OK;
+        rpRspIn->m_uiErrorCode = 0;
+        rpRspIn->m_pData = NULL;
+        rpRspIn->m_uiDataSize = 0;
+        rpRspIn->m_uiFlags = 0;
+        rpRspIn->ResetFraming();
+
+        rpRspOut = pRspTmp;
     }
-    rpRspOut->m_szBuffer[rpRspOut->m_uiUsed] = '\0';
 
     bRet = TRUE;
 Error:
@@ -543,7 +559,7 @@ BOOL CResponse::ParseResponse(CCommand*& rpCmd)
         RESPONSE_DATA rspData;
         memset(&rspData, 0, sizeof(RESPONSE_DATA));
 
-        rspData.szResponse = m_szBuffer;
+        rspData.szResponse = m_szBuffer + m_uiHead;
         rspData.uiChannel = m_pChannel->GetRilChannel();
 
         rspData.pContextData = rpCmd->GetContextData();
@@ -566,7 +582,7 @@ BOOL CResponse::ParseResponse(CCommand*& rpCmd)
         {
             RIL_LOG_CRITICAL("CResponse::ParseResponse() - chnl=[%d] Error parsing response:"
                     " \"%s\"; resCode = 0x%x\r\n", m_pChannel->GetRilChannel(),
-                    CRLFExpandedString(m_szBuffer, strlen(m_szBuffer)).GetString(),
+                    CRLFExpandedString(Data(), Size()).GetString(),
                     resCode);
 
             SetResultCode(resCode);
@@ -59,6 +59,13 @@ public:
             m_uiResponseEndMarker = 0;
     }
 
+    //  Discard any data not yet framed
+    void Flush()
+    {
+        CSelfExpandBuffer::Flush();
+        ResetFraming();
+    }
+
     BOOL IsCompleteResponse();
     BOOL ParseResponse(CCommand*& rpCmd);
 
@@ -126,13 +133,13 @@ private:
     };
 
     BOOL IsUnsolicitedResponse();
-    BOOL IsExtendedError(const char* pszToken);
+    BOOL IsFinalResponse(const char* szLine, const char* szLineEnd);
+    BOOL IsExtendedError(const char* szLine, const char* szLineEnd, const char* pszToken);
+    BOOL IsResultCode(const char* szLine, const char* szLineEnd, const char* pszToken);
+    BOOL IsSmsPrompt();
     BOOL IsCorruptResponse();
-    BOOL IsOkResponse();
-    BOOL IsErrorResponse();
     BOOL RetrieveErrorCode(const char*& rszPointer,  UINT32& nCode, const char* pszToken);
-    BOOL IsConnectResponse();
-    BOOL IsAbortedResponse();
+    void ResetFraming();
 
     char      m_szNewLine[3];
     UINT32    m_uiResultCode;
@@ -140,7 +147,13 @@ private:
     void*     m_pData;
     UINT32    m_uiDataSize;
     CChannel* m_pChannel;
+
+    //  Offsets from Data(). m_uiResponseEndMarker is the length of the framed
+    //  response, m_uiLineStart the start of the first line not yet classified
+    //  and m_uiScanPos how far the data has been searched for line ends.
     UINT32    m_uiResponseEndMarker;
+    UINT32    m_uiLineStart;
+    UINT32    m_uiScanPos;
 
     //  internal flags.
     UINT32     m_uiFlags;
@@ -37,6 +37,12 @@ public:
 
     static inline BOOL IsFullLogBuild() { return m_bFullLogBuild; }
 
+    //  For arguments too costly to build when Info() would drop them
+    static inline BOOL IsInfoLogEnabled()
+    {
+        return (m_bInitialized && (m_uiFlags & E_RIL_INFO_LOG)) ? TRUE : FALSE;
+    }
+
 private:
     static const UINT32 m_uiMaxLogBufferSize = 1024;
     enum
@@ -8,11 +8,29 @@
 // Description:
 //    A simple priority queue
 //
+//    Objects are kept in one FIFO lane per priority level, plus a front lane
+//    for objects queued with bFront. Dequeue takes the head of the front lane,
+//    else the head of the highest non-empty priority lane. This gives the same
+//    order as the former single sorted list:
+//      - bFront puts the object at the head of the queue;
+//      - priority m_uiMinPriority appends at the tail;
+//      - a higher priority goes before the first queued object of lower
+//        priority (which can only be in the front lane or a lower lane).
+//    Priorities above m_uiMaxPriority are treated as m_uiMaxPriority.
+//
+//    Nodes are recycled through a free list and indexed by a hash of the
+//    object, so duplicate detection and DequeueByObj() do not walk the queue.
+//    The object count can be read without taking the queue lock.
+//
+//    Object is expected to be a pointer or a plain value type; it is hashed
+//    by its bytes and compared with ==.
+//
 /////////////////////////////////////////////////////////////////////////////
 
 #ifndef __RIL_QUEUE__
 #define __RIL_QUEUE__
 
+#include <cutils/atomic.h>
 #include "rillog.h"
 #include "sync_ops.h"
 
@@ -24,6 +42,7 @@ class CRilQueue
     ~CRilQueue( );
 
     BOOL IsEmpty( );
+    UINT32 GetCount( );
     BOOL GetFront(Object& rObj);
 
     void MakeEmpty( );
@@ -38,31 +57,64 @@ class CRilQueue
     CRilQueue(const CRilQueue& rQueue);
     const CRilQueue& operator= (const CRilQueue& rQueue);
 
+    static const UINT32 m_uiMinPriority = 0;
+    static const UINT32 m_uiMaxPriority = 3;
+    static const UINT32 m_uiFrontLane = m_uiMaxPriority + 1;
+    static const UINT32 m_uiInitialHashSize = 32;
+
     struct ListNode
     {
         Object      m_Element;
         UINT32      m_uiPriority;
+        UINT32      m_uiLane;
+        UINT32      m_uiHash;
         ListNode*   m_pNext;
+        ListNode*   m_pPrev;
+        ListNode*   m_pHashNext;
 
-        ListNode(const Object& rObject,
-                UINT32 uiPriority = m_uiMinPriority,
-                ListNode* pNext = NULL)
-            : m_Element(rObject), m_uiPriority(uiPriority), m_pNext(pNext) { }
+        ListNode() : m_Element(), m_uiPriority(m_uiMinPriority), m_uiLane(0), m_uiHash(0),
+                m_pNext(NULL), m_pPrev(NULL), m_pHashNext(NULL) { }
     };
 
-    static const UINT32 m_uiMinPriority = 0;
-    ListNode* m_pFront;
-    ListNode* m_pBack;
-    BOOL      m_bDestroy;
-    CMutex    m_cMutex;
+    struct Lane
+    {
+        ListNode*   m_pFront;
+        ListNode*   m_pBack;
+    };
+
+    static UINT32 HashObject(const Object& rObj);
+
+    ListNode* FindNode(const Object& rObj, UINT32 uiHash);
+    ListNode* AllocNode();
+    BOOL GrowHash();
+    void LinkBefore(UINT32 uiLane, ListNode* pNode, ListNode* pNext);
+    void Unlink(ListNode* pNode);
+    ListNode* GetFrontNode();
+
+    Lane        m_rgLanes[m_uiFrontLane + 1];
+    UINT32      m_uiLaneMask;           // bit n set when priority lane n is not empty
+    ListNode**  m_ppHash;
+    UINT32      m_uiHashSize;           // power of two
+    ListNode*   m_pFreeList;
+    volatile int32_t m_nCount;
+    BOOL        m_bDestroy;
+    CMutex      m_cMutex;
 };
 
 // Construct the queue.
 template <class Object>
 CRilQueue<Object>::CRilQueue(BOOL bDestroy /* = false */)
 {
-    m_pFront = NULL;
-    m_pBack = NULL;
+    for (UINT32 i = 0; i <= m_uiFrontLane; i++)
+    {
+        m_rgLanes[i].m_pFront = NULL;
+        m_rgLanes[i].m_pBack = NULL;
+    }
+    m_uiLaneMask = 0;
+    m_ppHash = NULL;
+    m_uiHashSize = 0;
+    m_pFreeList = NULL;
+    m_nCount = 0;
     m_bDestroy = bDestroy;
 }
 
@@ -71,6 +123,16 @@ template <class Object>
 CRilQueue<Object>::~CRilQueue()
 {
     MakeEmpty();
+
+    while (NULL != m_pFreeList)
+    {
+        ListNode* pNode = m_pFreeList;
+        m_pFreeList = pNode->m_pNext;
+        delete pNode;
+    }
+
+    delete[] m_ppHash;
+    m_ppHash = NULL;
 }
 
 // Test if the queue is logically empty.
@@ -78,12 +140,15 @@ CRilQueue<Object>::~CRilQueue()
 template <class Object>
 BOOL CRilQueue<Object>::IsEmpty()
 {
-    CMutex::Lock(&m_cMutex);
-
-    BOOL bIsEmpty = (m_pFront == NULL);
+    return (0 == GetCount());
+}
 
-    CMutex::Unlock(&m_cMutex);
-    return bIsEmpty;
+// Number of objects in the queue. Does not take the queue lock; the value may
+// be stale by the time the caller acts on it.
+template <class Object>
+UINT32 CRilQueue<Object>::GetCount()
+{
+    return (UINT32)android_atomic_acquire_load(&m_nCount);
 }
 
 // Make the queue logically empty.
@@ -112,13 +177,14 @@ BOOL CRilQueue<Object>::GetFront(Object& rObj)
 
     CMutex::Lock(&m_cMutex);
 
-    if (IsEmpty())
+    ListNode* pNode = GetFrontNode();
+    if (NULL == pNode)
     {
         bRetVal = false;
     }
     else
     {
-        rObj = m_pFront->m_Element;
+        rObj = pNode->m_Element;
         bRetVal = true;
     }
 
@@ -137,25 +203,15 @@ BOOL CRilQueue<Object>::Dequeue(Object& rObj)
 
     CMutex::Lock(&m_cMutex);
 
-    if (false == GetFront(rObj))
+    ListNode* pNode = GetFrontNode();
+    if (NULL == pNode)
     {
         bRetVal = false;
     }
     else
     {
-        rObj = m_pFront->m_Element;
-        ListNode* pOld = m_pFront;
-        if (m_pFront == m_pBack)
-        {
-            // One item in queue.  Handle that case.
-            m_pFront = NULL;
-            m_pBack = NULL;
-        }
-        else
-        {
-            m_pFront = m_pFront->m_pNext;
-        }
-        delete pOld;
+        rObj = pNode->m_Element;
+        Unlink(pNode);
     }
 
     CMutex::Unlock(&m_cMutex);
@@ -169,108 +225,70 @@ BOOL CRilQueue<Object>::Enqueue(const Object& rObj, UINT32 uiPriority,
                                                           BOOL bFront)
 {
     BOOL bRetVal = false;
+    UINT32 uiHash = HashObject(rObj);
+    ListNode* pNode = NULL;
+    ListNode* pNext = NULL;
+    UINT32 uiLane = 0;
+
     CMutex::Lock(&m_cMutex);
 
-    if (IsEmpty())
+    // check for existing object before inserting
+    if (NULL != FindNode(rObj, uiHash))
     {
-        ListNode* newNode = new ListNode(rObj, uiPriority);
-        if (NULL == newNode)
-        {
-            RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory new ListNode"
-                    " - empty\r\n");
-            goto Error;
-        }
-        m_pFront = newNode;
-        m_pBack = newNode;
+        RIL_LOG_WARNING("CRilQueue::Enqueue() - Existing object found in queue\r\n");
+        bRetVal = true;
+        goto Error;
+    }
+
+    if ((UINT32)m_nCount >= m_uiHashSize && !GrowHash())
+    {
+        RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory for hash table\r\n");
+        goto Error;
+    }
+
+    pNode = AllocNode();
+    if (NULL == pNode)
+    {
+        RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory new ListNode\r\n");
+        goto Error;
+    }
+
+    pNode->m_Element = rObj;
+    pNode->m_uiPriority = uiPriority;
+    pNode->m_uiHash = uiHash;
+
+    if (bFront)
+    {
+        uiLane = m_uiFrontLane;
+        pNext = m_rgLanes[m_uiFrontLane].m_pFront;
     }
     else
     {
-        ListNode* node;
-        // check for existing object before inserting
-        for (node = m_pFront; node != NULL; node = node->m_pNext)
-        {
-            if (rObj == node->m_Element)
-            {
-                RIL_LOG_WARNING("CRilQueue::Enqueue() - Existing object found in queue\r\n");
-                return true;
-            }
-        }
+        uiLane = (uiPriority > m_uiMaxPriority) ? m_uiMaxPriority : uiPriority;
 
-        if (bFront)
+        //  Objects queued at the front keep their priority; a higher priority
+        //  object still goes ahead of them. The front lane is normally one or
+        //  two objects long.
+        if (m_uiMinPriority != uiPriority)
         {
-            ListNode* temp = m_pFront;
-            ListNode* newNode = new ListNode(rObj, uiPriority);
-            if (NULL == newNode)
-            {
-                RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory new ListNode"
-                        " - front\r\n");
-                goto Error;
-            }
-            newNode->m_pNext = temp;
-            m_pFront = newNode;
-        }
-        else
-        {
-            if (m_uiMinPriority == uiPriority)
-            {
-                ListNode* newNode = new ListNode(rObj, uiPriority);
-                if (NULL == newNode)
-                {
-                    RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory new ListNode"
-                            " - min priority\r\n");
-                    goto Error;
-                }
-                m_pBack->m_pNext = newNode;
-                m_pBack = newNode;
-            }
-            else
+            for (pNext = m_rgLanes[m_uiFrontLane].m_pFront;
+                 NULL != pNext && pNext->m_uiPriority >= uiPriority;
+                 pNext = pNext->m_pNext);
+
+            if (NULL != pNext)
             {
-                ListNode* node;
-                ListNode* previous;
-                for (previous = node = m_pFront;
-                     node != NULL && node->m_uiPriority >= uiPriority;
-                     previous = node, node = node->m_pNext);
-                if (NULL == node)
-                {
-                    //  Insert at end of queue.
-                    ListNode* newNode = new ListNode(rObj, uiPriority);
-                    if (NULL == newNode)
-                    {
-                        RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory new "
-                                "ListNode - end\r\n");
-                        goto Error;
-                    }
-                    m_pBack->m_pNext = newNode;
-                    m_pBack = newNode;
-                }
-                else if (m_pFront == node)
-                {
-                    //  Insert in front of queue.
-                    ListNode* newNode = new ListNode(rObj, uiPriority, m_pFront);
-                    if (NULL == newNode)
-                    {
-                        RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory new "
-                                "ListNode - front\r\n");
-                        goto Error;
-                    }
-                    m_pFront = newNode;
-                }
-                else
-                {
-                    //  Insert in middle of queue.
-                    ListNode* newNode = new ListNode(rObj, uiPriority, node);
-                    if (NULL == newNode)
-                    {
-                        RIL_LOG_CRITICAL("CRilQueue::Enqueue() - Cannot allocate memory new "
-                                "ListNode - middle\r\n");
-                        goto Error;
-                    }
-                    previous->m_pNext = newNode;
-                }
+                uiLane = m_uiFrontLane;
             }
         }
     }
 
+    LinkBefore(uiLane, pNode, pNext);
+
+    pNode->m_pHashNext = m_ppHash[uiHash & (m_uiHashSize - 1)];
+    m_ppHash[uiHash & (m_uiHashSize - 1)] = pNode;
+
+    android_atomic_release_store(m_nCount + 1, &m_nCount);
+
     bRetVal = true;
 Error:
     CMutex::Unlock(&m_cMutex);
@@ -302,11 +320,7 @@ void CRilQueue<Object>::GetAllQueuedObjects(Object*& rpObjArray, int& rnNumOfObj
         goto Error;
     }
 
-    //  Iterate through queue to get count.
-    for (node = m_pFront; node != NULL; node = node->m_pNext)
-    {
-        rnNumOfObjects++;
-    }
+    rnNumOfObjects = (int)m_nCount;
 
     RIL_LOG_VERBOSE("CRilQueue::GetAllQueuedObjects() - count = [%d]\r\n", rnNumOfObjects);
 
@@ -316,14 +330,18 @@ void CRilQueue<Object>::GetAllQueuedObjects(Object*& rpObjArray, int& rnNumOfObj
     {
         RIL_LOG_CRITICAL("CRilQueue::GetAllQueuedObjects() - Cannot allocate memory for %d"
                 " object pointers\r\n", rnNumOfObjects);
+        rnNumOfObjects = 0;
         goto Error;
     }
 
-    //  Iterate through queue, copy Object.
-    for (node = m_pFront; node != NULL; node = node->m_pNext)
+    //  Iterate through the lanes in dequeue order, copy Object.
+    for (int nLane = (int)m_uiFrontLane; nLane >= 0; nLane--)
     {
-        rpObjArray[nCount] = node->m_Element;
-        nCount++;
+        for (node = m_rgLanes[nLane].m_pFront; node != NULL; node = node->m_pNext)
+        {
+            rpObjArray[nCount] = node->m_Element;
+            nCount++;
+        }
     }
 
 
@@ -338,6 +356,7 @@ template <class Object>
 BOOL CRilQueue<Object>::DequeueByObj(Object& rObj)
 {
     BOOL ret = false;
+    ListNode* node = NULL;
     RIL_LOG_VERBOSE("CRilQueue::DequeueByObj() - ENTER  rObj=[0x%08x]\r\n", (unsigned long)rObj);
 
     CMutex::Lock(&m_cMutex);
@@ -348,50 +367,12 @@ BOOL CRilQueue<Object>::DequeueByObj(Object& rObj)
         goto Done;
     }
 
-    ListNode* node;
-    ListNode* previous;
-    for (previous = node = m_pFront;
-         node != NULL;
-         previous = node, node = node->m_pNext)
+    node = FindNode(rObj, HashObject(rObj));
+    if (NULL != node)
     {
-        if (rObj == node->m_Element)
-        {
-            ret = true;
-            //  Found a match.  Determine where in the queue it is.
-            RIL_LOG_VERBOSE("CRilQueue::DequeueByObj() - Found a match\r\n");
-            if (m_pFront == node)
-            {
-                //  In front.  Make sure handle case with 1 item.
-                RIL_LOG_VERBOSE("CRilQueue::DequeueByObj() - Found a match in front\r\n");
-                if (m_pBack == node)
-                {
-                    RIL_LOG_VERBOSE("CRilQueue::DequeueByObj() -"
-                            " Found a match in front, was one so remove\r\n");
-                    m_pFront = NULL;
-                    m_pBack = NULL;
-                }
-                else
-                {
-                    m_pFront = node->m_pNext;
-                }
-            }
-            else if (m_pBack == node)
-            {
-                //  Dequeue back node.
-                RIL_LOG_VERBOSE("CRilQueue::DequeueByObj() - Found a match in back\r\n");
-                m_pBack = previous;
-                previous->m_pNext = NULL;
-            }
-            else
-            {
-                //  In middle.
-                RIL_LOG_VERBOSE("CRilQueue::DequeueByObj() - Found a match in middle\r\n");
-                previous->m_pNext = node->m_pNext;
-            }
-
-            delete node;
-            break;
-        }
+        RIL_LOG_VERBOSE("CRilQueue::DequeueByObj() - Found a match\r\n");
+        Unlink(node);
+        ret = true;
     }
 
 Done:
@@ -401,6 +382,188 @@ Done:
     return ret;
 }
 
+//  FNV-1a over the bytes of the object.
+template <class Object>
+UINT32 CRilQueue<Object>::HashObject(const Object& rObj)
+{
+    const BYTE* pData = (const BYTE*)&rObj;
+    UINT32 uiHash = 2166136261u;
+
+    for (UINT32 i = 0; i < sizeof(Object); i++)
+    {
+        uiHash = (uiHash ^ pData[i]) * 16777619u;
+    }
+    return uiHash;
+}
 
-#endif  // __RIL_QUEUE__
+//  Must be called with the queue lock held.
+template <class Object>
+typename CRilQueue<Object>::ListNode* CRilQueue<Object>::FindNode(const Object& rObj,
+        UINT32 uiHash)
+{
+    if (NULL == m_ppHash)
+    {
+        return NULL;
+    }
 
+    for (ListNode* pNode = m_ppHash[uiHash & (m_uiHashSize - 1)]; NULL != pNode;
+         pNode = pNode->m_pHashNext)
+    {
+        if (pNode->m_uiHash == uiHash && rObj == pNode->m_Element)
+        {
+            return pNode;
+        }
+    }
+    return NULL;
+}
+
+//  Take a node from the free list, or allocate one if the list is empty.
+//  Must be called with the queue lock held.
+template <class Object>
+typename CRilQueue<Object>::ListNode* CRilQueue<Object>::AllocNode()
+{
+    ListNode* pNode = m_pFreeList;
+
+    if (NULL != pNode)
+    {
+        m_pFreeList = pNode->m_pNext;
+        pNode->m_pNext = NULL;
+    }
+    else
+    {
+        pNode = new ListNode();
+    }
+    return pNode;
+}
+
+//  Double the hash table and rehash the queued nodes into it.
+//  Must be called with the queue lock held.
+template <class Object>
+BOOL CRilQueue<Object>::GrowHash()
+{
+    UINT32 uiNewSize = m_uiHashSize ? m_uiHashSize * 2 : m_uiInitialHashSize;
+    ListNode** ppNewHash = new ListNode*[uiNewSize];
+
+    if (NULL == ppNewHash)
+    {
+        return FALSE;
+    }
+    memset(ppNewHash, 0, uiNewSize * sizeof(ListNode*));
+
+    for (UINT32 i = 0; i < m_uiHashSize; i++)
+    {
+        ListNode* pNode = m_ppHash[i];
+        while (NULL != pNode)
+        {
+            ListNode* pHashNext = pNode->m_pHashNext;
+            pNode->m_pHashNext = ppNewHash[pNode->m_uiHash & (uiNewSize - 1)];
+            ppNewHash[pNode->m_uiHash & (uiNewSize - 1)] = pNode;
+            pNode = pHashNext;
+        }
+    }
+
+    delete[] m_ppHash;
+    m_ppHash = ppNewHash;
+    m_uiHashSize = uiNewSize;
+    return TRUE;
+}
+
+//  Link pNode into the lane before pNext, or at the back if pNext is NULL.
+//  Must be called with the queue lock held.
+template <class Object>
+void CRilQueue<Object>::LinkBefore(UINT32 uiLane, ListNode* pNode, ListNode* pNext)
+{
+    Lane& rLane = m_rgLanes[uiLane];
+
+    pNode->m_uiLane = uiLane;
+    pNode->m_pNext = pNext;
+    pNode->m_pPrev = (NULL != pNext) ? pNext->m_pPrev : rLane.m_pBack;
+
+    if (NULL != pNode->m_pPrev)
+    {
+        pNode->m_pPrev->m_pNext = pNode;
+    }
+    else
+    {
+        rLane.m_pFront = pNode;
+    }
+
+    if (NULL != pNext)
+    {
+        pNext->m_pPrev = pNode;
+    }
+    else
+    {
+        rLane.m_pBack = pNode;
+    }
+
+    if (uiLane != m_uiFrontLane)
+    {
+        m_uiLaneMask |= (1 << uiLane);
+    }
+}
+
+//  Remove pNode from its lane and the hash table and put it on the free list.
+//  Must be called with the queue lock held.
+template <class Object>
+void CRilQueue<Object>::Unlink(ListNode* pNode)
+{
+    Lane& rLane = m_rgLanes[pNode->m_uiLane];
+    ListNode** ppHashLink = &m_ppHash[pNode->m_uiHash & (m_uiHashSize - 1)];
+
+    if (NULL != pNode->m_pPrev)
+    {
+        pNode->m_pPrev->m_pNext = pNode->m_pNext;
+    }
+    else
+    {
+        rLane.m_pFront = pNode->m_pNext;
+    }
+
+    if (NULL != pNode->m_pNext)
+    {
+        pNode->m_pNext->m_pPrev = pNode->m_pPrev;
+    }
+    else
+    {
+        rLane.m_pBack = pNode->m_pPrev;
+    }
+
+    if (NULL == rLane.m_pFront && pNode->m_uiLane != m_uiFrontLane)
+    {
+        m_uiLaneMask &= ~(1 << pNode->m_uiLane);
+    }
+
+    while (*ppHashLink != pNode)
+    {
+        ppHashLink = &(*ppHashLink)->m_pHashNext;
+    }
+    *ppHashLink = pNode->m_pHashNext;
+
+    pNode->m_Element = Object();
+    pNode->m_pPrev = NULL;
+    pNode->m_pHashNext = NULL;
+    pNode->m_pNext = m_pFreeList;
+    m_pFreeList = pNode;
+
+    android_atomic_release_store(m_nCount - 1, &m_nCount);
+}
+
+//  Head of the front lane, else head of the highest non-empty priority lane.
+//  Must be called with the queue lock held.
+template <class Object>
+typename CRilQueue<Object>::ListNode* CRilQueue<Object>::GetFrontNode()
+{
+    if (NULL != m_rgLanes[m_uiFrontLane].m_pFront)
+    {
+        return m_rgLanes[m_uiFrontLane].m_pFront;
+    }
+    if (0 == m_uiLaneMask)
+    {
+        return NULL;
+    }
+    return m_rgLanes[31 - __builtin_clz(m_uiLaneMask)].m_pFront;
+}
+
+
+#endif  // __RIL_QUEUE__
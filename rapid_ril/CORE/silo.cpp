@@ -127,7 +127,7 @@ PFN_ATRSP_PARSE CSilo::FindParser(ATRSPTABLE* pRspTable, const char*& pszStr)
 
             if (SkipString(pszStr, szATRsp, pszStr))
             {
-                fctParser = m_pATRspTable[nRow].pfnATParseRsp;
+                fctParser = pRspTable[nRow].pfnATParseRsp;
                 //RIL_LOG_INFO("CSilo::FindParser() chnl=[%d] - Found parse function for response
                 //        [%s]\r\n", m_pChannel->GetRilChannel(),
                 //        CRLFExpandedString(m_pATRspTable[nRow].szATResponse,
@@ -57,6 +57,10 @@ public:
     virtual char* GetURCInitString() { return NULL; }
     virtual char* GetURCUnlockInitString() { return NULL; }
 
+    // Response tables, used by CChannelBase to index the prefixes of all its silos
+    const ATRSPTABLE* GetATRspTable() const { return m_pATRspTable; }
+    const ATRSPTABLE* GetATRspTableExt() const { return m_pATRspTableExt; }
+
 protected:
     char m_cTerminator;
     char m_szNewLine[3];
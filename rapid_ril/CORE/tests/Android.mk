@@ -0,0 +1,139 @@
+#
+# Copyright 2013 Intel Corporation.  All rights reserved.
+#
+
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= urc_dispatch_bench.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..  \
+    $(LOCAL_PATH)/../ND  \
+    $(LOCAL_PATH)/../ND/MODEMS  \
+    $(LOCAL_PATH)/../../INC \
+    $(LOCAL_PATH)/../../UTIL/ND \
+    $(TARGET_OUT_HEADERS)/IFX-modem
+
+LOCAL_SHARED_LIBRARIES := libcutils libutils libmmgrcli librilutils \
+    librapid-ril-core librapid-ril-util
+LOCAL_MODULE:= urc_dispatch_bench
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= response_framing_bench.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..  \
+    $(LOCAL_PATH)/../ND  \
+    $(LOCAL_PATH)/../ND/MODEMS  \
+    $(LOCAL_PATH)/../../INC \
+    $(LOCAL_PATH)/../../UTIL/ND \
+    $(TARGET_OUT_HEADERS)/IFX-modem
+
+LOCAL_SHARED_LIBRARIES := libcutils libutils libmmgrcli librilutils \
+    librapid-ril-core librapid-ril-util
+LOCAL_MODULE:= response_framing_bench
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= rilqueue_bench.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..  \
+    $(LOCAL_PATH)/../ND  \
+    $(LOCAL_PATH)/../ND/MODEMS  \
+    $(LOCAL_PATH)/../../INC \
+    $(LOCAL_PATH)/../../UTIL/ND \
+    $(TARGET_OUT_HEADERS)/IFX-modem
+
+LOCAL_SHARED_LIBRARIES := libcutils libutils libmmgrcli librilutils \
+    librapid-ril-core librapid-ril-util
+LOCAL_MODULE:= rilqueue_bench
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= repository_bench.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..  \
+    $(LOCAL_PATH)/../ND  \
+    $(LOCAL_PATH)/../../INC \
+    $(LOCAL_PATH)/../../UTIL/ND \
+    $(TARGET_OUT_HEADERS)/IFX-modem
+
+LOCAL_SHARED_LIBRARIES := libcutils libutils librapid-ril-util
+LOCAL_MODULE:= repository_bench
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= modem_sim.cpp xmm_modem_sim.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..
+
+LOCAL_MODULE:= xmm_modem_sim
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= modem_sim.cpp xmm_modem_sim.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..
+
+LOCAL_LDLIBS += -lpthread
+LOCAL_MODULE:= xmm_modem_sim
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= modem_sim.cpp ril_latency_bench.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..  \
+    $(LOCAL_PATH)/../ND  \
+    $(LOCAL_PATH)/../ND/MODEMS  \
+    $(LOCAL_PATH)/../../INC \
+    $(LOCAL_PATH)/../../UTIL/ND \
+    $(TARGET_OUT_HEADERS)/IFX-modem
+
+# Same feature flags as librapid-ril-core for the RIL_Init() arguments
+ifeq ($(strip $(BOARD_HAVE_IFX6265)),true)
+LOCAL_CFLAGS += -DM2_DUALSIM_FEATURE_ENABLED
+endif
+LOCAL_CFLAGS += -DRIL_SHLIB
+
+LOCAL_SHARED_LIBRARIES := libcutils libutils libmmgrcli librilutils \
+    librapid-ril-core librapid-ril-util
+LOCAL_MODULE:= ril_latency_bench
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= unsol_coalescer_test.cpp ../ND/unsol_coalescer.cpp ../ND/sync_ops.cpp
+
+LOCAL_C_INCLUDES :=  \
+    $(LOCAL_PATH)/..  \
+    $(LOCAL_PATH)/../ND  \
+    $(LOCAL_PATH)/../../INC \
+    $(LOCAL_PATH)/../../UTIL/ND \
+    $(TARGET_OUT_HEADERS)/IFX-modem
+
+# The coalescer sends through RIL_onCoalescedUnsolicitedResponse(), which the
+# test provides, so librapid-ril-core is not linked.
+LOCAL_SHARED_LIBRARIES := libcutils libutils librapid-ril-util
+LOCAL_MODULE:= unsol_coalescer_test
+LOCAL_MODULE_TAGS:= eng
+include $(BUILD_EXECUTABLE)
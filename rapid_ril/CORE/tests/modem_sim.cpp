@@ -0,0 +1,791 @@
+////////////////////////////////////////////////////////////////////////////
+// modem_sim.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Simulated XMM modem for the RIL benchmarks.
+//
+//    Every channel thread reads commands up to their <CR>, splits them at the
+//    ';' separating concatenated commands and answers each part with the
+//    longest matching rule, the way the modem answers "AT+CREG=2;+CREG?".
+//    Information lines of all parts are sent, followed by a single final
+//    result code. Commands no rule matches are answered "OK". Replies are
+//    sent without echo (the RIL sends ATE0 first), framed as in 27.007.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "modem_sim.h"
+
+//  Replies of a registered, idle XMM modem with a ready SIM.
+//  A reply starting with '>' asks for a PDU; the rest of it is sent once the
+//  PDU has been received.
+const CModemSim::Rule CModemSim::ms_rgBuiltinRules[] =
+{
+    { "+CGSN",          MODEM_ALL,  -1, "351234567890123" },
+    { "+CGMR",          MODEM_6260, -1, "+CGMR: XMM6260_SIM_V1.0" },
+    { "+CGMR",          MODEM_6360, -1, "+CGMR: XMM6360_SIM_V1.0" },
+    { "+CGMR",          MODEM_7160, -1, "+CGMR: XMM7160_SIM_V1.0" },
+    { "+CGMR",          MODEM_7260, -1, "+CGMR: XMM7260_SIM_V1.0" },
+    { "+CIMI",          MODEM_ALL,  -1, "310260000000001" },
+    { "+CCID",          MODEM_ALL,  -1, "+CCID: 89014103211118510720" },
+    { "+CPIN?",         MODEM_ALL,  -1, "+CPIN: READY" },
+    { "+XSIMSTATE?",    MODEM_ALL,  -1, "+XSIMSTATE: 1,7,0,0,0" },
+    { "+CFUN?",         MODEM_ALL,  -1, "+CFUN: 1" },
+    { "+CSQ",           MODEM_ALL,  -1, "+CSQ: 20,99" },
+    { "+XCESQ?",        MODEM_7160 | MODEM_7260, -1, "+XCESQ: 0,99,99,255,255,30,62,40" },
+    { "+CREG?",         MODEM_ALL,  -1, "+CREG: 2,1,\"1A2B\",\"0001C3D5\",2" },
+    { "+CGREG?",        MODEM_ALL,  -1, "+CGREG: 2,1,\"1A2B\",\"0001C3D5\",2,\"01\"" },
+    { "+CEREG?",        MODEM_7160 | MODEM_7260, -1, "+CEREG: 3,1,\"1A2B\",\"0001C3D5\",7" },
+    { "+XREG?",         MODEM_ALL,  -1, "+XREG: 3,1,6,BAND_UMTS_I,\"1A2B\",\"0001C3D5\"" },
+    { "+COPS?",         MODEM_ALL,  -1, "+COPS: 0,2,\"310260\",2" },
+    { "+COPS=?",        MODEM_ALL,  3000,
+            "+COPS: (2,\"Simulated\",\"Sim\",\"310260\",2),(1,\"Other\",\"Oth\",\"310410\",0),,"
+            "(0,1,3,4),(0,1,2)" },
+    { "+XCOPS=11",      MODEM_ALL,  -1, "+XCOPS: 11,\"Sim\"" },
+    { "+XCOPS=12",      MODEM_ALL,  -1, "+XCOPS: 12,\"Simulated\"" },
+    { "+XCOPS=13",      MODEM_ALL,  -1, "+XCOPS: 13,\"310260\"" },
+    { "+CGACT?",        MODEM_ALL,  -1, "+CGACT: 1,0" },
+    { "+CLCC",          MODEM_ALL,  -1, "" },
+    { "+CMGS=",         MODEM_ALL,  -1, ">+CMGS: 12" },
+    { "+CMGW=",         MODEM_ALL,  -1, ">+CMGW: 3" },
+    { "D",              MODEM_ALL,  -1, "" },
+    { "H",              MODEM_ALL,  -1, "" },
+    { "A",              MODEM_ALL,  -1, "" },
+    { NULL,             0,          0,  NULL }
+};
+
+CModemSim::CModemSim() :
+    m_pRules(NULL),
+    m_nRules(0),
+    m_pStorms(NULL),
+    m_nStorms(0),
+    m_uiModem(MODEM_7160),
+    m_uiMinLatencyMs(0),
+    m_uiMaxLatencyMs(0),
+    m_uiErrorPermille(0),
+    m_uiDropPermille(0),
+    m_nChannels(0),
+    m_bStormThread(FALSE),
+    m_bStop(FALSE),
+    m_nCommands(0),
+    m_nErrors(0),
+    m_nDropped(0),
+    m_nUrcs(0)
+{
+    memset(m_rgChannels, 0, sizeof(m_rgChannels));
+}
+
+CModemSim::~CModemSim()
+{
+    Stop();
+
+    for (UINT32 i = 0; i < m_nRules; ++i)
+    {
+        delete[] const_cast<char*>(m_pRules[i].szPrefix);
+        delete[] const_cast<char*>(m_pRules[i].szReply);
+    }
+    delete[] m_pRules;
+
+    for (UINT32 i = 0; i < m_nStorms; ++i)
+    {
+        delete[] m_pStorms[i].szUrc;
+    }
+    delete[] m_pStorms;
+}
+
+BOOL CModemSim::SetModem(const char* szModem)
+{
+    if (0 == strcmp(szModem, "6260"))
+    {
+        m_uiModem = MODEM_6260;
+    }
+    else if (0 == strcmp(szModem, "6360"))
+    {
+        m_uiModem = MODEM_6360;
+    }
+    else if (0 == strcmp(szModem, "7160"))
+    {
+        m_uiModem = MODEM_7160;
+    }
+    else if (0 == strcmp(szModem, "7260"))
+    {
+        m_uiModem = MODEM_7260;
+    }
+    else
+    {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static char* CopyString(const char* szSrc, size_t len)
+{
+    char* szDst = new char[len + 1];
+    memcpy(szDst, szSrc, len);
+    szDst[len] = '\0';
+    return szDst;
+}
+
+BOOL CModemSim::AddRule(const char* szPrefix, INT32 iDelayMs, const char* szReply)
+{
+    Rule* pRules = new Rule[m_nRules + 1];
+    if (m_nRules)
+    {
+        memcpy(pRules, m_pRules, m_nRules * sizeof(Rule));
+    }
+    delete[] m_pRules;
+    m_pRules = pRules;
+
+    //  Script lines separate reply lines with '|'; keep them that way
+    m_pRules[m_nRules].szPrefix = CopyString(szPrefix, strlen(szPrefix));
+    m_pRules[m_nRules].uiModems = MODEM_ALL;
+    m_pRules[m_nRules].iDelayMs = iDelayMs;
+    m_pRules[m_nRules].szReply = CopyString(szReply, strlen(szReply));
+    ++m_nRules;
+    return TRUE;
+}
+
+BOOL CModemSim::LoadScript(const char* szFile)
+{
+    FILE* fp = fopen(szFile, "r");
+    char szLine[1024];
+    UINT32 uiLine = 0;
+    BOOL bRet = TRUE;
+
+    if (NULL == fp)
+    {
+        fprintf(stderr, "CModemSim::LoadScript() - Cannot open %s\n", szFile);
+        return FALSE;
+    }
+
+    while (fgets(szLine, sizeof(szLine), fp))
+    {
+        char* rgszField[5] = { NULL };
+        UINT32 nFields = 0;
+        char* pBuf = szLine;
+
+        ++uiLine;
+        szLine[strcspn(szLine, "\r\n")] = '\0';
+        if ('\0' == szLine[0] || '#' == szLine[0])
+        {
+            continue;
+        }
+
+        while (nFields < 5)
+        {
+            rgszField[nFields++] = pBuf;
+            pBuf = strchr(pBuf, '\t');
+            if (NULL == pBuf)
+            {
+                break;
+            }
+            *pBuf++ = '\0';
+        }
+
+        if (0 == strcmp(rgszField[0], "urc") && 5 == nFields)
+        {
+            bRet = AddUrcStorm(strtoul(rgszField[1], NULL, 10), strtoul(rgszField[2], NULL, 10),
+                    strtoul(rgszField[3], NULL, 10), rgszField[4]);
+        }
+        else if (3 == nFields)
+        {
+            INT32 iDelayMs = ('-' == rgszField[1][0]) ? -1 : atoi(rgszField[1]);
+            bRet = AddRule(rgszField[0], iDelayMs, rgszField[2]);
+        }
+        else
+        {
+            bRet = FALSE;
+        }
+
+        if (!bRet)
+        {
+            fprintf(stderr, "CModemSim::LoadScript() - %s:%u: invalid line\n", szFile, uiLine);
+            break;
+        }
+    }
+
+    fclose(fp);
+    return bRet;
+}
+
+void CModemSim::SetLatency(UINT32 uiMinMs, UINT32 uiMaxMs)
+{
+    m_uiMinLatencyMs = uiMinMs;
+    m_uiMaxLatencyMs = (uiMaxMs < uiMinMs) ? uiMinMs : uiMaxMs;
+}
+
+void CModemSim::SetErrorRate(UINT32 uiErrorPermille, UINT32 uiDropPermille)
+{
+    m_uiErrorPermille = uiErrorPermille;
+    m_uiDropPermille = uiDropPermille;
+}
+
+BOOL CModemSim::AddUrcStorm(UINT32 uiChannel, UINT32 uiPeriodMs, UINT32 uiBurst,
+        const char* szUrc)
+{
+    if (uiChannel >= MAX_CHANNELS || 0 == uiPeriodMs || 0 == uiBurst)
+    {
+        return FALSE;
+    }
+
+    Storm* pStorms = new Storm[m_nStorms + 1];
+    if (m_nStorms)
+    {
+        memcpy(pStorms, m_pStorms, m_nStorms * sizeof(Storm));
+    }
+    delete[] m_pStorms;
+    m_pStorms = pStorms;
+
+    m_pStorms[m_nStorms].uiChannel = uiChannel;
+    m_pStorms[m_nStorms].uiPeriodMs = uiPeriodMs;
+    m_pStorms[m_nStorms].uiBurst = uiBurst;
+    m_pStorms[m_nStorms].szUrc = CopyString(szUrc, strlen(szUrc));
+    m_pStorms[m_nStorms].uiNextMs = 0;
+    ++m_nStorms;
+    return TRUE;
+}
+
+BOOL CModemSim::OpenPty(Channel& rChannel)
+{
+    struct termios tio;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || 0 != grantpt(fd) || 0 != unlockpt(fd) || NULL == ptsname(fd))
+    {
+        fprintf(stderr, "CModemSim::OpenPty() - Cannot create a pty: %s\n", strerror(errno));
+        goto Error;
+    }
+    snprintf(rChannel.szPortName, sizeof(rChannel.szPortName), "%s", ptsname(fd));
+
+    //  Holding the slave open keeps the master readable while the RIL closes
+    //  and reopens the port, and raw mode keeps the line discipline from
+    //  echoing commands before the RIL configures the port itself.
+    rChannel.fdSlave = open(rChannel.szPortName, O_RDWR | O_NOCTTY);
+    if (rChannel.fdSlave < 0)
+    {
+        fprintf(stderr, "CModemSim::OpenPty() - Cannot open %s: %s\n", rChannel.szPortName,
+                strerror(errno));
+        goto Error;
+    }
+    if (0 == tcgetattr(rChannel.fdSlave, &tio))
+    {
+        cfmakeraw(&tio);
+        tcsetattr(rChannel.fdSlave, TCSANOW, &tio);
+    }
+
+    rChannel.fd = fd;
+    return TRUE;
+
+Error:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return FALSE;
+}
+
+BOOL CModemSim::OpenSocket(Channel& rChannel, const char* szSocketDir)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/chnl%u", szSocketDir, rChannel.uiIndex);
+    snprintf(rChannel.szPortName, sizeof(rChannel.szPortName), "%s", addr.sun_path);
+    unlink(addr.sun_path);
+
+    if (fd < 0 || 0 != bind(fd, (struct sockaddr*)&addr, sizeof(addr)) || 0 != listen(fd, 1))
+    {
+        fprintf(stderr, "CModemSim::OpenSocket() - Cannot listen on %s: %s\n", addr.sun_path,
+                strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return FALSE;
+    }
+
+    rChannel.fdListen = fd;
+    return TRUE;
+}
+
+BOOL CModemSim::Start(UINT32 nChannels, const char* szSocketDir)
+{
+    if (m_nChannels || 0 == nChannels || nChannels > MAX_CHANNELS)
+    {
+        return FALSE;
+    }
+
+    m_bStop = FALSE;
+    for (UINT32 i = 0; i < nChannels; ++i)
+    {
+        Channel& rChannel = m_rgChannels[i];
+
+        memset(&rChannel, 0, sizeof(rChannel));
+        rChannel.pSim = this;
+        rChannel.uiIndex = i;
+        rChannel.fd = -1;
+        rChannel.fdListen = -1;
+        rChannel.fdSlave = -1;
+        rChannel.uiSeed = 2166136261u ^ (i * 16777619u);
+        pthread_mutex_init(&rChannel.writeLock, NULL);
+
+        if (!(szSocketDir ? OpenSocket(rChannel, szSocketDir) : OpenPty(rChannel)))
+        {
+            pthread_mutex_destroy(&rChannel.writeLock);
+            Stop();
+            return FALSE;
+        }
+
+        if (0 != pthread_create(&rChannel.thread, NULL, ChannelThreadProc, &rChannel))
+        {
+            fprintf(stderr, "CModemSim::Start() - Cannot create channel thread\n");
+            close(szSocketDir ? rChannel.fdListen : rChannel.fd);
+            pthread_mutex_destroy(&rChannel.writeLock);
+            Stop();
+            return FALSE;
+        }
+        m_nChannels = i + 1;
+    }
+
+    if (m_nStorms)
+    {
+        m_bStormThread = (0 == pthread_create(&m_stormThread, NULL, StormThreadProc, this));
+    }
+    return TRUE;
+}
+
+void CModemSim::Stop()
+{
+    m_bStop = TRUE;
+
+    if (m_bStormThread)
+    {
+        pthread_join(m_stormThread, NULL);
+        m_bStormThread = FALSE;
+    }
+
+    for (UINT32 i = 0; i < m_nChannels; ++i)
+    {
+        Channel& rChannel = m_rgChannels[i];
+
+        pthread_join(rChannel.thread, NULL);
+        if (rChannel.fd >= 0)
+        {
+            close(rChannel.fd);
+        }
+        if (rChannel.fdSlave >= 0)
+        {
+            close(rChannel.fdSlave);
+        }
+        if (rChannel.fdListen >= 0)
+        {
+            close(rChannel.fdListen);
+            unlink(rChannel.szPortName);
+        }
+        pthread_mutex_destroy(&rChannel.writeLock);
+    }
+    m_nChannels = 0;
+}
+
+const char* CModemSim::GetPortName(UINT32 uiChannel) const
+{
+    return (uiChannel < m_nChannels) ? m_rgChannels[uiChannel].szPortName : NULL;
+}
+
+void* CModemSim::ChannelThreadProc(void* pArg)
+{
+    Channel* pChannel = (Channel*)pArg;
+    pChannel->pSim->RunChannel(*pChannel);
+    return NULL;
+}
+
+void* CModemSim::StormThreadProc(void* pArg)
+{
+    ((CModemSim*)pArg)->RunStorms();
+    return NULL;
+}
+
+void CModemSim::RunChannel(Channel& rChannel)
+{
+    char buf[512];
+
+    while (!m_bStop)
+    {
+        struct pollfd pfd;
+
+        //  Sockets serve one client at a time; wait for the next one
+        if (rChannel.fd < 0)
+        {
+            pfd.fd = rChannel.fdListen;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, 100) > 0)
+            {
+                rChannel.uiCmdLen = 0;
+                rChannel.szPduReply = NULL;
+                rChannel.fd = accept(rChannel.fdListen, NULL, NULL);
+            }
+            continue;
+        }
+
+        pfd.fd = rChannel.fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 100) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t n = read(rChannel.fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            if (n < 0 && (EINTR == errno || EAGAIN == errno))
+            {
+                continue;
+            }
+            if (rChannel.fdListen >= 0)
+            {
+                close(rChannel.fd);
+                rChannel.fd = -1;
+            }
+            else
+            {
+                SleepMs(10);
+            }
+            continue;
+        }
+
+        for (ssize_t i = 0; i < n; ++i)
+        {
+            char c = buf[i];
+
+            if (rChannel.szPduReply)
+            {
+                //  <ctrl-Z> sends the PDU, <ESC> cancels it
+                if (0x1A == c)
+                {
+                    const char* szReply = rChannel.szPduReply;
+
+                    rChannel.szPduReply = NULL;
+                    HandleCommand(rChannel, szReply);
+                }
+                else if (0x1B == c)
+                {
+                    rChannel.szPduReply = NULL;
+                    Send(rChannel, "\r\nOK\r\n", 6);
+                }
+                continue;
+            }
+
+            if ('\r' == c)
+            {
+                rChannel.szCmd[rChannel.uiCmdLen] = '\0';
+                if (rChannel.uiCmdLen)
+                {
+                    HandleCommand(rChannel, NULL);
+                }
+                rChannel.uiCmdLen = 0;
+            }
+            else if ('\n' != c && rChannel.uiCmdLen < sizeof(rChannel.szCmd) - 1)
+            {
+                rChannel.szCmd[rChannel.uiCmdLen++] = c;
+            }
+        }
+
+        //  CPort::OpenSocket() greets the modem with "gsm" and waits for any reply
+        if (rChannel.fdListen >= 0 && 3 == rChannel.uiCmdLen &&
+                0 == strncmp(rChannel.szCmd, "gsm", 3))
+        {
+            rChannel.uiCmdLen = 0;
+            Send(rChannel, "\r\nOK\r\n", 6);
+        }
+    }
+}
+
+void CModemSim::RunStorms()
+{
+    UINT32 uiNow = NowMs();
+
+    for (UINT32 i = 0; i < m_nStorms; ++i)
+    {
+        m_pStorms[i].uiNextMs = uiNow + m_pStorms[i].uiPeriodMs;
+    }
+
+    while (!m_bStop)
+    {
+        UINT32 uiWaitMs = 100;
+
+        uiNow = NowMs();
+        for (UINT32 i = 0; i < m_nStorms; ++i)
+        {
+            Storm& rStorm = m_pStorms[i];
+
+            if ((INT32)(uiNow - rStorm.uiNextMs) >= 0)
+            {
+                if (rStorm.uiChannel < m_nChannels)
+                {
+                    Channel& rChannel = m_rgChannels[rStorm.uiChannel];
+                    char szBuf[1024];
+                    int len = snprintf(szBuf, sizeof(szBuf), "\r\n%s\r\n", rStorm.szUrc);
+
+                    if (len >= (int)sizeof(szBuf))
+                    {
+                        len = sizeof(szBuf) - 1;
+                    }
+                    for (UINT32 j = 0; j < rStorm.uiBurst; ++j)
+                    {
+                        Send(rChannel, szBuf, len);
+                    }
+                    __sync_fetch_and_add(&m_nUrcs, rStorm.uiBurst);
+                }
+                rStorm.uiNextMs += rStorm.uiPeriodMs;
+                if ((INT32)(uiNow - rStorm.uiNextMs) >= 0)
+                {
+                    //  Fell behind; do not try to catch up with a single huge burst
+                    rStorm.uiNextMs = uiNow + rStorm.uiPeriodMs;
+                }
+            }
+
+            if (rStorm.uiNextMs - uiNow < uiWaitMs)
+            {
+                uiWaitMs = rStorm.uiNextMs - uiNow;
+            }
+        }
+
+        SleepMs(uiWaitMs ? uiWaitMs : 1);
+    }
+}
+
+const CModemSim::Rule* CModemSim::FindRule(const char* szCmd, UINT32 uiLen) const
+{
+    const Rule* pBest = NULL;
+    size_t bestLen = 0;
+
+    //  Script rules win over built-in ones of the same length
+    for (UINT32 i = 0; i < m_nRules; ++i)
+    {
+        size_t len = strlen(m_pRules[i].szPrefix);
+        if (len <= uiLen && (NULL == pBest || len > bestLen) &&
+                0 == strncasecmp(szCmd, m_pRules[i].szPrefix, len))
+        {
+            pBest = &m_pRules[i];
+            bestLen = len;
+        }
+    }
+
+    for (const Rule* pRule = ms_rgBuiltinRules; NULL != pRule->szPrefix; ++pRule)
+    {
+        size_t len = strlen(pRule->szPrefix);
+        if ((pRule->uiModems & m_uiModem) && len <= uiLen && (NULL == pBest || len > bestLen) &&
+                0 == strncasecmp(szCmd, pRule->szPrefix, len))
+        {
+            pBest = pRule;
+            bestLen = len;
+        }
+    }
+
+    return pBest;
+}
+
+BOOL CModemSim::IsFinalResult(const char* szLine, UINT32 uiLen)
+{
+    static const char* const rgszFinal[] =
+    {
+        "OK", "ERROR", "+CME ERROR:", "+CMS ERROR:", "CONNECT", "NO CARRIER", "BUSY",
+        "NO ANSWER", "NO DIALTONE"
+    };
+
+    for (UINT32 i = 0; i < sizeof(rgszFinal) / sizeof(rgszFinal[0]); ++i)
+    {
+        size_t len = strlen(rgszFinal[i]);
+        if (uiLen >= len && 0 == strncmp(szLine, rgszFinal[i], len))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//  Appends the '|' separated lines of szReply to pBuf. Information lines
+//  follow a single <CR><LF> ("<CR><LF>line1<CR><LF>line2<CR><LF>"), a final
+//  result code gets its own ("<CR><LF>OK<CR><LF>") and sets rbFinal.
+UINT32 CModemSim::AppendReply(char* pBuf, UINT32 uiPos, UINT32 uiSize, const char* szReply,
+        BOOL& rbFinal)
+{
+    while ('\0' != *szReply && !rbFinal)
+    {
+        UINT32 uiLen = strcspn(szReply, "|");
+
+        if (uiPos + uiLen + 4 < uiSize)
+        {
+            rbFinal = IsFinalResult(szReply, uiLen);
+            if (0 == uiPos || rbFinal)
+            {
+                memcpy(pBuf + uiPos, "\r\n", 2);
+                uiPos += 2;
+            }
+            memcpy(pBuf + uiPos, szReply, uiLen);
+            memcpy(pBuf + uiPos + uiLen, "\r\n", 2);
+            uiPos += uiLen + 2;
+        }
+
+        szReply += uiLen;
+        if ('|' == *szReply)
+        {
+            ++szReply;
+        }
+    }
+    return uiPos;
+}
+
+//  Answers rChannel.szCmd, or with szPduReply once the PDU of a +CMGS/+CMGW
+//  has been received.
+void CModemSim::HandleCommand(Channel& rChannel, const char* szPduReply)
+{
+    char szReply[8192];
+    UINT32 uiPos = 0;
+    BOOL bFinal = FALSE;
+    INT32 iDelayMs = -1;
+    const char* pCmd = rChannel.szCmd;
+
+    __sync_fetch_and_add(&m_nCommands, 1);
+
+    if (szPduReply)
+    {
+        uiPos = AppendReply(szReply, uiPos, sizeof(szReply), szPduReply, bFinal);
+    }
+    else if (0 != strncasecmp(rChannel.szCmd, "AT", 2))
+    {
+        uiPos = AppendReply(szReply, uiPos, sizeof(szReply), "ERROR", bFinal);
+    }
+    else
+    {
+        pCmd += 2;
+        while ('\0' != *pCmd && !bFinal)
+        {
+            //  Find the end of this command, outside of quoted strings
+            UINT32 uiLen = 0;
+            BOOL bQuoted = FALSE;
+            while ('\0' != pCmd[uiLen] && (bQuoted || ';' != pCmd[uiLen]))
+            {
+                bQuoted = ('"' == pCmd[uiLen]) ? !bQuoted : bQuoted;
+                ++uiLen;
+            }
+
+            const Rule* pRule = uiLen ? FindRule(pCmd, uiLen) : NULL;
+            if (pRule)
+            {
+                if (pRule->iDelayMs > iDelayMs)
+                {
+                    iDelayMs = pRule->iDelayMs;
+                }
+
+                if ('>' == pRule->szReply[0])
+                {
+                    //  Prompt for the PDU; the reply follows <ctrl-Z>
+                    rChannel.szPduReply = pRule->szReply + 1;
+                    Send(rChannel, "\r\n> ", 4);
+                    return;
+                }
+                uiPos = AppendReply(szReply, uiPos, sizeof(szReply), pRule->szReply, bFinal);
+            }
+
+            pCmd += uiLen;
+            if (';' == *pCmd)
+            {
+                ++pCmd;
+            }
+        }
+    }
+
+    if (m_uiDropPermille && Random(rChannel, 1000) < m_uiDropPermille)
+    {
+        __sync_fetch_and_add(&m_nDropped, 1);
+        return;
+    }
+
+    if (m_uiErrorPermille && Random(rChannel, 1000) < m_uiErrorPermille)
+    {
+        __sync_fetch_and_add(&m_nErrors, 1);
+        uiPos = 0;
+        bFinal = FALSE;
+        uiPos = AppendReply(szReply, uiPos, sizeof(szReply), "+CME ERROR: 100", bFinal);
+    }
+    else if (!bFinal)
+    {
+        uiPos = AppendReply(szReply, uiPos, sizeof(szReply), "OK", bFinal);
+    }
+
+    if (iDelayMs < 0)
+    {
+        iDelayMs = m_uiMinLatencyMs + Random(rChannel, m_uiMaxLatencyMs - m_uiMinLatencyMs + 1);
+    }
+    if (iDelayMs > 0)
+    {
+        SleepMs(iDelayMs);
+    }
+
+    Send(rChannel, szReply, uiPos);
+}
+
+void CModemSim::Send(Channel& rChannel, const char* pData, UINT32 uiLen)
+{
+    pthread_mutex_lock(&rChannel.writeLock);
+
+    while (uiLen > 0 && rChannel.fd >= 0)
+    {
+        ssize_t n = write(rChannel.fd, pData, uiLen);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            if (EAGAIN == errno)
+            {
+                SleepMs(1);
+                continue;
+            }
+            break;
+        }
+        pData += n;
+        uiLen -= n;
+    }
+
+    pthread_mutex_unlock(&rChannel.writeLock);
+}
+
+UINT32 CModemSim::Random(Channel& rChannel, UINT32 uiRange)
+{
+    rChannel.uiSeed = rChannel.uiSeed * 1103515245 + 12345;
+    return uiRange ? ((rChannel.uiSeed >> 8) % uiRange) : 0;
+}
+
+UINT32 CModemSim::NowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT32)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void CModemSim::SleepMs(UINT32 uiMs)
+{
+    struct timespec ts;
+    ts.tv_sec = uiMs / 1000;
+    ts.tv_nsec = (uiMs % 1000) * 1000000;
+    while (-1 == nanosleep(&ts, &ts) && EINTR == errno);
+}
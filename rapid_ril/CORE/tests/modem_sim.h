@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////
+// modem_sim.h
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Simulated XMM modem for the RIL benchmarks. Answers the AT commands the
+//    XMM6260/6360/7160/7260 terminal equipments send, over one pty or unix
+//    socket per channel, with configurable latency, URC storms and errors.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef RRIL_MODEM_SIM_H
+#define RRIL_MODEM_SIM_H
+
+#include <pthread.h>
+
+#include "types.h"
+
+class CModemSim
+{
+public:
+    enum
+    {
+        MODEM_6260 = 0x1,
+        MODEM_6360 = 0x2,
+        MODEM_7160 = 0x4,
+        MODEM_7260 = 0x8,
+        MODEM_ALL = 0xF
+    };
+
+    static const UINT32 MAX_CHANNELS = 12;
+
+    CModemSim();
+    ~CModemSim();
+
+    //  "6260", "6360", "7160" or "7260"; selects the dialect of the built-in replies.
+    BOOL SetModem(const char* szModem);
+
+    //  Adds reply rules from szFile, checked before the built-in ones. Lines are
+    //      <command prefix> <TAB> <delay ms or -> <TAB> <line>|<line>|...
+    //      urc <TAB> <channel> <TAB> <period ms> <TAB> <burst> <TAB> <URC>
+    //  A reply without a final result code gets "OK" appended.
+    BOOL LoadScript(const char* szFile);
+    BOOL AddRule(const char* szPrefix, INT32 iDelayMs, const char* szReply);
+
+    //  Delay of every reply without its own delay, picked uniformly in [min, max].
+    void SetLatency(UINT32 uiMinMs, UINT32 uiMaxMs);
+
+    //  Per-mille of commands answered with +CME ERROR: 100, and of commands
+    //  never answered at all.
+    void SetErrorRate(UINT32 uiErrorPermille, UINT32 uiDropPermille);
+
+    //  Sends szUrc uiBurst times every uiPeriodMs on channel uiChannel.
+    BOOL AddUrcStorm(UINT32 uiChannel, UINT32 uiPeriodMs, UINT32 uiBurst, const char* szUrc);
+
+    //  Creates nChannels ptys, or unix sockets named chnl<N> in szSocketDir if
+    //  it is not NULL, and starts answering on them.
+    BOOL Start(UINT32 nChannels, const char* szSocketDir);
+    void Stop();
+
+    //  Device or socket path the RIL opens for channel uiChannel.
+    const char* GetPortName(UINT32 uiChannel) const;
+
+    UINT32 GetCommandCount() const { return m_nCommands; }
+    UINT32 GetErrorCount() const { return m_nErrors; }
+    UINT32 GetDroppedCount() const { return m_nDropped; }
+    UINT32 GetUrcCount() const { return m_nUrcs; }
+
+private:
+    struct Rule
+    {
+        const char* szPrefix;
+        UINT32      uiModems;
+        INT32       iDelayMs;
+        const char* szReply;
+    };
+
+    struct Storm
+    {
+        UINT32  uiChannel;
+        UINT32  uiPeriodMs;
+        UINT32  uiBurst;
+        char*   szUrc;
+        UINT32  uiNextMs;
+    };
+
+    struct Channel
+    {
+        CModemSim*      pSim;
+        UINT32          uiIndex;
+        int             fdListen;
+        int             fdSlave;
+        volatile int    fd;
+        char            szPortName[108];
+        pthread_t       thread;
+        pthread_mutex_t writeLock;
+        char            szCmd[4096];
+        UINT32          uiCmdLen;
+        const char*     szPduReply;
+        UINT32          uiSeed;
+    };
+
+    static const Rule ms_rgBuiltinRules[];
+
+    Rule*       m_pRules;
+    UINT32      m_nRules;
+    Storm*      m_pStorms;
+    UINT32      m_nStorms;
+    UINT32      m_uiModem;
+    UINT32      m_uiMinLatencyMs;
+    UINT32      m_uiMaxLatencyMs;
+    UINT32      m_uiErrorPermille;
+    UINT32      m_uiDropPermille;
+
+    Channel     m_rgChannels[MAX_CHANNELS];
+    UINT32      m_nChannels;
+    pthread_t   m_stormThread;
+    BOOL        m_bStormThread;
+    volatile BOOL m_bStop;
+
+    volatile UINT32 m_nCommands;
+    volatile UINT32 m_nErrors;
+    volatile UINT32 m_nDropped;
+    volatile UINT32 m_nUrcs;
+
+    BOOL OpenPty(Channel& rChannel);
+    BOOL OpenSocket(Channel& rChannel, const char* szSocketDir);
+
+    static void* ChannelThreadProc(void* pArg);
+    static void* StormThreadProc(void* pArg);
+    void RunChannel(Channel& rChannel);
+    void RunStorms();
+
+    void HandleCommand(Channel& rChannel, const char* szCmd);
+    const Rule* FindRule(const char* szCmd, UINT32 uiLen) const;
+    static UINT32 AppendReply(char* pBuf, UINT32 uiPos, UINT32 uiSize, const char* szReply,
+            BOOL& rbFinal);
+    void Send(Channel& rChannel, const char* pData, UINT32 uiLen);
+    static UINT32 Random(Channel& rChannel, UINT32 uiRange);
+
+    static BOOL IsFinalResult(const char* szLine, UINT32 uiLen);
+    static UINT32 NowMs();
+    static void SleepMs(UINT32 uiMs);
+};
+
+#endif // RRIL_MODEM_SIM_H
@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////
+// repository_bench.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Times the CRepository reads done while the RIL starts and initializes
+//    the modem, against the repository file the RIL uses on this device.
+//
+//    Usage: repository_bench [-n <passes>] [<repository file>]
+//
+//    One pass reads every setting CSystemManager, the channels and the
+//    initializer read at startup, plus the timeout of every request listed in
+//    the RequestTimeouts group. <repository file> is only scanned to list
+//    those requests and should be the file CRepository::Init() selects;
+//    it defaults to /system/etc/rril/repository.txt. The first pass is
+//    reported separately since it includes loading the file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "rril.h"
+#include "repository.h"
+
+struct KEY
+{
+    const char* szGroup;
+    const char* szKey;
+};
+
+//  Settings read while the RIL starts, in the order they are read
+static const KEY s_rgStartupKeys[] =
+{
+    { g_szGroupLogging,         g_szLogLevel },
+    { g_szGroupModem,           g_szSupportedModem },
+    { g_szGroupModem,           g_szEnableModemOffInFlightMode },
+    { g_szGroupOtherTimeouts,   g_szTimeoutCmdInit },
+    { g_szGroupOtherTimeouts,   g_szTimeoutAPIDefault },
+    { g_szGroupOtherTimeouts,   g_szTimeoutWaitForInit },
+    { g_szGroupRILSettings,     g_szTimeoutThresholdForRetry },
+    { g_szGroupRILSettings,     g_szUnsolCoalesceWindow },
+    { g_szGroupRILSettings,     g_szSignalStrengthDelta },
+    { g_szGroupModem,           g_szMTU },
+    { g_szGroupModem,           g_szPinCacheMode },
+    { g_szGroupModem,           g_szFDMode },
+    { g_szGroupModem,           g_szVoiceCapable },
+    { g_szGroupModem,           g_szSmsOverCSCapable },
+    { g_szGroupModem,           g_szSmsOverPSCapable },
+    { g_szGroupModem,           g_szStkCapable },
+    { g_szGroupModem,           g_szEnableXDATASTATURC },
+    { g_szGroupModem,           g_szSupportCGPIAF },
+    { g_szGroupModem,           g_szEnableSignalStrengthURC },
+    { g_szGroupModem,           g_szEnableCellInfo },
+    { g_szGroupModem,           g_szModeOfOperation },
+    { g_szGroupLogging,         g_szCallDropReporting },
+    { g_szGroupModem,           g_szNetworkInterfaceNamePrefix },
+    { g_szGroupModem,           g_szModemResourceName },
+    { g_szGroupModem,           g_szIpcDataChannelMin },
+    { g_szGroupModem,           g_szHsiDataDirect },
+    { g_szGroupModem,           g_szApnTypeDefault },
+    { g_szGroupModem,           g_szApnTypeDUN },
+    { g_szGroupModem,           g_szApnTypeIMS },
+    { g_szGroupModem,           g_szApnTypeMMS },
+    { g_szGroupModem,           g_szApnTypeCBS },
+    { g_szGroupModem,           g_szApnTypeFOTA },
+    { g_szGroupModem,           g_szApnTypeSUPL },
+    { g_szGroupModem,           g_szApnTypeEmergency },
+    { g_szGroupModem,           g_szEnableCipheringInd },
+    { g_szGroupModem,           g_szFDDelayTimer },
+    { g_szGroupModem,           g_szSCRITimer },
+    { g_szGroupModem,           g_szTempOoSNotificationEnable },
+    { g_szGroupModem,           g_szImeiBlackList },
+    { g_szGroupModem,           g_szTeProfile },
+    { g_szGroupChannelSilos,    g_szSilosATCmd },
+    { g_szGroupChannelSilos,    g_szSilosDLC2 },
+    { g_szGroupChannelSilos,    g_szSilosDLC6 },
+    { g_szGroupChannelSilos,    g_szSilosDLC8 },
+    { g_szGroupChannelSilos,    g_szSilosURC },
+    { g_szGroupChannelSilos,    g_szSilosOEM },
+    { g_szGroupChannelSilos,    g_szSilosData },
+    { g_szGroupInitCmds,        "PreInitCmds" },
+    { g_szGroupInitCmds,        "PostInitCmds" },
+    { g_szGroupInitCmds,        "PreReinitCmds" },
+    { g_szGroupInitCmds,        "PostReinitCmds" },
+    { g_szGroupInitCmds,        "PreUnlockCmds" },
+    { g_szGroupInitCmds,        "PostUnlockCmds" },
+    { g_szGroupInitCmds,        "PreSmsInitCmds" },
+    { g_szGroupInitCmds,        "PostSmsInitCmds" },
+    { g_szGroupOtherTimeouts,   g_szTimeoutWaitForXIREG },
+};
+
+//  Keys of the RequestTimeouts group of szFile; returns the number found.
+static UINT32 ListRequestKeys(const char* szFile, char**& rppszKeys)
+{
+    FILE* fp = fopen(szFile, "r");
+    char szLine[1024];
+    BOOL bInGroup = FALSE;
+    UINT32 nKeys = 0;
+    UINT32 nAlloc = 0;
+
+    rppszKeys = NULL;
+    if (NULL == fp)
+    {
+        return 0;
+    }
+
+    while (fgets(szLine, sizeof(szLine), fp))
+    {
+        char* pBuf = szLine + strspn(szLine, " \t");
+
+        if (0 == strncmp(pBuf, "Group", 5))
+        {
+            pBuf += 5 + strspn(pBuf + 5, " \t");
+            bInGroup = (0 == strncmp(pBuf, g_szGroupRequestTimeouts,
+                    strlen(g_szGroupRequestTimeouts)));
+            continue;
+        }
+
+        if (!bInGroup || !isalnum(*pBuf))
+        {
+            continue;
+        }
+
+        if (nKeys == nAlloc)
+        {
+            nAlloc = nAlloc ? nAlloc * 2 : 128;
+            char** ppszNew = new char*[nAlloc];
+            if (nKeys)
+            {
+                memcpy(ppszNew, rppszKeys, nKeys * sizeof(char*));
+            }
+            delete[] rppszKeys;
+            rppszKeys = ppszNew;
+        }
+
+        size_t len = 0;
+        while (isalnum(pBuf[len]))
+        {
+            ++len;
+        }
+        rppszKeys[nKeys] = new char[len + 1];
+        memcpy(rppszKeys[nKeys], pBuf, len);
+        rppszKeys[nKeys][len] = '\0';
+        ++nKeys;
+    }
+
+    fclose(fp);
+    return nKeys;
+}
+
+static double NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//  One startup's worth of reads; returns the number of keys found.
+static UINT32 ReadAll(char** ppszKeys, UINT32 nKeys, UINT32& ruiSink)
+{
+    const UINT32 nStartupKeys = sizeof(s_rgStartupKeys) / sizeof(s_rgStartupKeys[0]);
+    CRepository repository;
+    char szBuf[MAX_BUFFER_SIZE];
+    UINT32 nFound = 0;
+
+    for (UINT32 i = 0; i < nStartupKeys; ++i)
+    {
+        if (repository.Read(s_rgStartupKeys[i].szGroup, s_rgStartupKeys[i].szKey, szBuf,
+                sizeof(szBuf)))
+        {
+            ruiSink += strlen(szBuf);
+            ++nFound;
+        }
+    }
+
+    for (UINT32 i = 0; i < nKeys; ++i)
+    {
+        int iTemp = 0;
+        if (repository.Read(g_szGroupRequestTimeouts, ppszKeys[i], iTemp))
+        {
+            ruiSink += iTemp;
+            ++nFound;
+        }
+    }
+
+    return nFound;
+}
+
+int main(int argc, char** argv)
+{
+    const UINT32 nStartupKeys = sizeof(s_rgStartupKeys) / sizeof(s_rgStartupKeys[0]);
+    const char* szFile = "/system/etc/rril/repository.txt";
+    UINT32 nPasses = 100;
+    char** ppszKeys = NULL;
+    UINT32 nKeys = 0;
+    UINT32 nFound = 0;
+    UINT32 uiSink = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            nPasses = strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            szFile = argv[i];
+        }
+    }
+
+    nKeys = ListRequestKeys(szFile, ppszKeys);
+
+    double start = NowNs();
+    if (!CRepository::Init())
+    {
+        fprintf(stderr, "Cannot initialize the repository\n");
+        return 1;
+    }
+    nFound = ReadAll(ppszKeys, nKeys, uiSink);
+    double firstNs = NowNs() - start;
+
+    start = NowNs();
+    for (UINT32 p = 0; p < nPasses; ++p)
+    {
+        ReadAll(ppszKeys, nKeys, uiSink);
+    }
+    double passNs = (NowNs() - start) / (nPasses ? nPasses : 1);
+
+    printf("%u reads per pass (%u startup settings, %u request timeouts), %u found\n",
+            nStartupKeys + nKeys, nStartupKeys, nKeys, nFound);
+    printf("first pass: %.1f us\n", firstNs / 1000.0);
+    printf("next %u passes: %.1f us/pass, %.0f ns/read [sink %u]\n", nPasses, passNs / 1000.0,
+            passNs / (nStartupKeys + nKeys), uiSink);
+
+    CRepository::Close();
+
+    for (UINT32 i = 0; i < nKeys; ++i)
+    {
+        delete[] ppszKeys[i];
+    }
+    delete[] ppszKeys;
+
+    return 0;
+}
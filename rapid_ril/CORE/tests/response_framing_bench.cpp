@@ -0,0 +1,260 @@
+////////////////////////////////////////////////////////////////////////////
+// response_framing_bench.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Measures how fast CResponse frames modem traffic into responses, the
+//    way CChannel::ProcessModemData() drives it: Append() each read() chunk,
+//    then IsCompleteResponse()/TransferData() until no response is left.
+//
+//    Usage: response_framing_bench [-c <chunk bytes>] [-n <passes>] [<capture>]
+//
+//    <capture> is raw bytes as read from a channel. Without it, a recorded
+//    session is replayed: phonebook read, +COPS=? scan, neighbour cell
+//    list, URC bursts and short command/response pairs. The framed
+//    responses are counted and hashed so that runs of different builds can
+//    be compared.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "rril.h"
+#include "silo.h"
+#include "response.h"
+#include "channel_URC.h"
+
+//  URC prefixes seen on the URC channel; all treated as unrecognized so that
+//  only the framing cost is measured.
+class CBenchSilo : public CSilo
+{
+public:
+    CBenchSilo(CChannel* pChannel) : CSilo(pChannel, NULL)
+    {
+        static ATRSPTABLE pATRspTable[] =
+        {
+            { "+XCSQ:"      , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+XCESQI:"    , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+CREG: "     , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+CGREG: "    , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+CEREG: "    , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+XREG: "     , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+CGEV: "     , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+XCIEV: "    , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+XMETRIC: "  , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { "+CTZV: "     , (PFN_ATRSP_PARSE)&CBenchSilo::ParseUnrecognized },
+            { ""            , (PFN_ATRSP_PARSE)&CBenchSilo::ParseNULL         }
+        };
+
+        m_pATRspTable = pATRspTable;
+    }
+};
+
+static char* s_pTrace = NULL;
+static UINT32 s_uiTraceSize = 0;
+static UINT32 s_uiTraceAlloc = 0;
+
+static void TraceAppend(const char* pData, UINT32 uiLen)
+{
+    if (s_uiTraceSize + uiLen > s_uiTraceAlloc)
+    {
+        UINT32 uiAlloc = (s_uiTraceAlloc ? s_uiTraceAlloc * 2 : 65536) + uiLen;
+        char* pNew = new char[uiAlloc];
+        memcpy(pNew, s_pTrace, s_uiTraceSize);
+        delete[] s_pTrace;
+        s_pTrace = pNew;
+        s_uiTraceAlloc = uiAlloc;
+    }
+    memcpy(s_pTrace + s_uiTraceSize, pData, uiLen);
+    s_uiTraceSize += uiLen;
+}
+
+static void TraceAdd(const char* szFormat, ...)
+{
+    char szBuf[1024];
+    va_list args;
+
+    va_start(args, szFormat);
+    int len = vsnprintf(szBuf, sizeof(szBuf), szFormat, args);
+    va_end(args);
+
+    if (len > 0)
+    {
+        TraceAppend(szBuf, len < (int)sizeof(szBuf) ? len : sizeof(szBuf) - 1);
+    }
+}
+
+static void BuildSession()
+{
+    //  AT+CPBR=1,250
+    for (int i = 1; i <= 250; ++i)
+    {
+        TraceAdd("\r\n+CPBR: %d,\"+1555%07d\",145,\"Contact %03d\"", i, i * 7919, i);
+    }
+    TraceAdd("\r\n\r\nOK\r\n");
+
+    //  AT+COPS=?
+    TraceAdd("\r\n+COPS: ");
+    for (int i = 0; i < 24; ++i)
+    {
+        TraceAdd("%s(%d,\"Operator %02d\",\"OP%02d\",\"310%03d\",%d)", i ? "," : "",
+                1 + i % 3, i, i, 260 + i, (i % 3) * 2);
+    }
+    TraceAdd(",,(0,1,3,4),(0,1,2)\r\n\r\nOK\r\n");
+
+    //  AT+XCELLINFO?
+    for (int i = 0; i < 16; ++i)
+    {
+        TraceAdd("\r\n+XCELLINFO: %d,310,260,\"1A2B\",\"%08X\",%d,%d\r\n", i < 1 ? 4 : 5,
+                0x1C3D5 + i, 300 + i * 25, 40 - i);
+    }
+    TraceAdd("\r\nOK\r\n");
+
+    //  URC burst after a handover
+    for (int i = 0; i < 40; ++i)
+    {
+        switch (i % 5)
+        {
+            case 0: TraceAdd("\r\n+XCSQ: %d,99\r\n", 15 + i % 10); break;
+            case 1: TraceAdd("\r\n+CREG: 1,\"1A2B\",\"%08X\",7\r\n", 0x1C3D5 + i); break;
+            case 2: TraceAdd("\r\n+CGREG: 1,\"1A2B\",\"%08X\",7,\"01\"\r\n", 0x1C3D5 + i); break;
+            case 3: TraceAdd("\r\n+CEREG: 1,\"1A2B\",\"%08X\",7\r\n", 0x1C3D5 + i); break;
+            case 4: TraceAdd("\r\n+XCESQI: 99,99,255,255,%d,62\r\n", 30 + i % 8); break;
+        }
+    }
+
+    //  Short command/response pairs
+    for (int i = 0; i < 20; ++i)
+    {
+        TraceAdd("\r\n+CSQ: %d,99\r\n\r\nOK\r\n", 10 + i);
+        TraceAdd("\r\nOK\r\n");
+        TraceAdd("\r\n+CME ERROR: %d\r\n", 100 + i % 3);
+        TraceAdd("\r\n+CGACT: 1,1\r\n+CGACT: 2,0\r\n\r\nOK\r\n");
+        TraceAdd("\r\nERROR\r\n");
+        TraceAdd("\r\nCONNECT\r\n");
+    }
+}
+
+static BOOL LoadCapture(const char* szFile)
+{
+    FILE* fp = fopen(szFile, "rb");
+    char buf[4096];
+    size_t n;
+
+    if (NULL == fp)
+    {
+        return FALSE;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        TraceAppend(buf, n);
+    }
+    fclose(fp);
+    return s_uiTraceSize > 0;
+}
+
+static double NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char** argv)
+{
+    UINT32 uiChunk = 64;
+    UINT32 nPasses = 200;
+    const char* szFile = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-c") && i + 1 < argc)
+        {
+            uiChunk = strtoul(argv[++i], NULL, 10);
+        }
+        else if (0 == strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            nPasses = strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            szFile = argv[i];
+        }
+    }
+
+    if (szFile ? !LoadCapture(szFile) : (BuildSession(), FALSE))
+    {
+        fprintf(stderr, "Cannot read capture %s\n", szFile);
+        return 1;
+    }
+    if (0 == uiChunk)
+    {
+        uiChunk = s_uiTraceSize;
+    }
+
+    CChannel_URC channel(RIL_CHANNEL_URC);
+    channel.AddSilo(new CBenchSilo(&channel));
+
+    UINT32 nResponses = 0;
+    UINT32 nUnsolicited = 0;
+    UINT32 nErrors = 0;
+    UINT32 nFailed = 0;
+    UINT32 uiHash = 2166136261u;
+    UINT32 uiLeft = 0;
+
+    double start = NowNs();
+    for (UINT32 p = 0; p < nPasses; ++p)
+    {
+        CResponse* pRspIn = new CResponse(&channel);
+
+        for (UINT32 uiPos = 0; uiPos < s_uiTraceSize; uiPos += uiChunk)
+        {
+            UINT32 uiLen = s_uiTraceSize - uiPos < uiChunk ? s_uiTraceSize - uiPos : uiChunk;
+
+            pRspIn->Append(s_pTrace + uiPos, uiLen);
+            while (pRspIn->IsCompleteResponse())
+            {
+                CResponse* pRspOut = NULL;
+                if (!CResponse::TransferData(pRspIn, pRspOut))
+                {
+                    //  ProcessModemData() gives up on this chunk the same way
+                    nFailed += (0 == p) ? 1 : 0;
+                    break;
+                }
+
+                if (0 == p)
+                {
+                    ++nResponses;
+                    nUnsolicited += pRspOut->IsUnsolicitedFlag() ? 1 : 0;
+                    nErrors += (RIL_E_SUCCESS != pRspOut->GetResultCode()) ? 1 : 0;
+                    for (UINT32 i = 0; i < pRspOut->Size(); ++i)
+                    {
+                        uiHash = (uiHash ^ (BYTE)pRspOut->Data()[i]) * 16777619u;
+                    }
+                }
+                delete pRspOut;
+            }
+        }
+
+        uiLeft = pRspIn->Size();
+        delete pRspIn;
+    }
+    double elapsedNs = NowNs() - start;
+
+    printf("%u bytes in %u byte chunks, %u passes\n", s_uiTraceSize, uiChunk, nPasses);
+    printf("%u responses (%u unsolicited, %u errors), %u transfer failures, %u bytes left,"
+            " hash %08x\n", nResponses, nUnsolicited, nErrors, nFailed, uiLeft, uiHash);
+    printf("%.1f MB/s, %.0f ns/response\n",
+            (double)s_uiTraceSize * nPasses * 1000.0 / elapsedNs,
+            nResponses ? elapsedNs / nPasses / nResponses : 0.0);
+
+    delete[] s_pTrace;
+    return 0;
+}
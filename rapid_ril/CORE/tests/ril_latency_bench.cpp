@@ -0,0 +1,568 @@
+////////////////////////////////////////////////////////////////////////////
+// ril_latency_bench.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Measures request latency end to end, from onRequest() to
+//    OnRequestComplete(), through the real channel/silo/command stack talking
+//    to a CModemSim instead of the modem.
+//
+//    Usage: ril_latency_bench [-m 6260|6360|7160|7260] [-i <iterations>]
+//                             [-j <clients>] [-l <min ms>[:<max ms>]]
+//                             [-e <error per-mille>] [-x <drop per-mille>]
+//                             [-u <channel>:<period ms>:<burst>:<URC>]...
+//                             [<script>]
+//
+//    The simulated modem gets one pty per channel. The mmgr client calls
+//    made by CSystemManager are answered here, and MODEM_UP is sent as soon
+//    as the RIL connects, so neither mmgr nor a modem is needed. Once the
+//    radio is on, <clients> threads each send the workload <iterations>
+//    times, one request at a time, and the latency percentiles of every
+//    request ID are printed.
+//
+//    The repository file and modem type selection are those of the device,
+//    -m must match the terminal equipment the RIL picks.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <telephony/ril.h>
+
+#include "types.h"
+#include "mmgr_cli.h"
+#include "modem_sim.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//  mmgr client library replacement; these definitions take precedence over
+//  libmmgrcli's for librapid-ril-core.
+//
+static event_handler s_pfnModemUp = NULL;
+static void* s_pMMgrContext = NULL;
+static int s_iMMgrHandle = 0;
+
+static void* SendModemUp(void*)
+{
+    mmgr_cli_event_t event;
+
+    usleep(100 * 1000);
+    memset(&event, 0, sizeof(event));
+    event.id = E_MMGR_EVENT_MODEM_UP;
+    event.context = s_pMMgrContext;
+    s_pfnModemUp(&event);
+    return NULL;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_create_handle(mmgr_cli_handle_t** handle,
+        const char* /*client_name*/, void* context)
+{
+    *handle = (mmgr_cli_handle_t*)&s_iMMgrHandle;
+    s_pMMgrContext = context;
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_delete_handle(mmgr_cli_handle_t* /*handle*/)
+{
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_subscribe_event(mmgr_cli_handle_t* /*handle*/,
+        event_handler func, e_mmgr_events_t id)
+{
+    if (E_MMGR_EVENT_MODEM_UP == id)
+    {
+        s_pfnModemUp = func;
+    }
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_unsubscribe_event(mmgr_cli_handle_t* /*handle*/,
+        e_mmgr_events_t /*id*/)
+{
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_connect(mmgr_cli_handle_t* /*handle*/)
+{
+    pthread_t thread;
+
+    if (NULL == s_pfnModemUp || 0 != pthread_create(&thread, NULL, SendModemUp, NULL))
+    {
+        return E_ERR_CLI_FAILED;
+    }
+    pthread_detach(thread);
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_disconnect(mmgr_cli_handle_t* /*handle*/)
+{
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_lock(mmgr_cli_handle_t* /*handle*/)
+{
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_unlock(mmgr_cli_handle_t* /*handle*/)
+{
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" e_err_mmgr_cli_t mmgr_cli_send_msg(mmgr_cli_handle_t* /*handle*/,
+        const mmgr_cli_requests_t* /*request*/)
+{
+    return E_ERR_CLI_SUCCEED;
+}
+
+extern "C" int mmgr_cli_get_fd(mmgr_cli_handle_t* /*handle*/)
+{
+    return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  Workload and latency records
+//
+struct REQUEST
+{
+    int         iRequestId;
+    const char* szName;
+    int         iData;
+    BOOL        bHasData;
+};
+
+//  What the framework sends while the phone is idle and the screen toggles
+static const REQUEST s_rgWorkload[] =
+{
+    { RIL_REQUEST_SCREEN_STATE,                 "SCREEN_STATE",             1,  TRUE  },
+    { RIL_REQUEST_SIGNAL_STRENGTH,              "SIGNAL_STRENGTH",          0,  FALSE },
+    { RIL_REQUEST_OPERATOR,                     "OPERATOR",                 0,  FALSE },
+    { RIL_REQUEST_VOICE_REGISTRATION_STATE,     "VOICE_REGISTRATION_STATE", 0,  FALSE },
+    { RIL_REQUEST_DATA_REGISTRATION_STATE,      "DATA_REGISTRATION_STATE",  0,  FALSE },
+    { RIL_REQUEST_QUERY_NETWORK_SELECTION_MODE, "QUERY_NETWORK_SEL_MODE",   0,  FALSE },
+    { RIL_REQUEST_GET_CURRENT_CALLS,            "GET_CURRENT_CALLS",        0,  FALSE },
+    { RIL_REQUEST_GET_IMEI,                     "GET_IMEI",                 0,  FALSE },
+    { RIL_REQUEST_BASEBAND_VERSION,             "BASEBAND_VERSION",         0,  FALSE },
+    { RIL_REQUEST_SCREEN_STATE,                 "SCREEN_STATE",             0,  TRUE  },
+};
+
+static const UINT32 s_nWorkload = sizeof(s_rgWorkload) / sizeof(s_rgWorkload[0]);
+
+//  One per request sent; the RIL_Token handed to onRequest(). uiWorkload is
+//  s_nWorkload for requests outside of the workload, which are not recorded.
+struct PENDING
+{
+    UINT32          uiWorkload;
+    double          startNs;
+    BOOL            bDone;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+};
+
+struct STATS
+{
+    UINT32*     puiSamplesUs;
+    UINT32      nSamples;
+    UINT32      nErrors;
+};
+
+static const RIL_RadioFunctions* s_pRadioFuncs = NULL;
+static pthread_mutex_t s_statsLock = PTHREAD_MUTEX_INITIALIZER;
+static STATS s_rgStats[sizeof(s_rgWorkload) / sizeof(s_rgWorkload[0])];
+static UINT32 s_nTimedOut = 0;
+
+static double NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  RIL_Env
+//
+static void OnRequestComplete(RIL_Token t, RIL_Errno e, void* /*response*/,
+        size_t /*responselen*/)
+{
+    PENDING* pPending = (PENDING*)t;
+    double endNs = NowNs();
+
+    //  Completions of requests sent by the RIL itself, if any, are not ours
+    if (NULL == pPending)
+    {
+        return;
+    }
+
+    if (pPending->uiWorkload < s_nWorkload)
+    {
+        pthread_mutex_lock(&s_statsLock);
+        STATS& rStats = s_rgStats[pPending->uiWorkload];
+        rStats.puiSamplesUs[rStats.nSamples++] = (UINT32)((endNs - pPending->startNs) / 1000.0);
+        rStats.nErrors += (RIL_E_SUCCESS != e) ? 1 : 0;
+        pthread_mutex_unlock(&s_statsLock);
+    }
+
+    pthread_mutex_lock(&pPending->lock);
+    pPending->bDone = TRUE;
+    pthread_cond_signal(&pPending->cond);
+    pthread_mutex_unlock(&pPending->lock);
+}
+
+static void OnUnsolicitedResponse(int /*unsolResponse*/, const void* /*data*/,
+        size_t /*datalen*/)
+{
+}
+
+struct TIMED_CALLBACK
+{
+    RIL_TimedCallback   pfnCallback;
+    void*               pParam;
+    struct timeval      delay;
+};
+
+static void* RunTimedCallback(void* pArg)
+{
+    TIMED_CALLBACK* pTimed = (TIMED_CALLBACK*)pArg;
+
+    usleep(pTimed->delay.tv_sec * 1000000 + pTimed->delay.tv_usec);
+    pTimed->pfnCallback(pTimed->pParam);
+    delete pTimed;
+    return NULL;
+}
+
+static void RequestTimedCallback(RIL_TimedCallback callback, void* param,
+        const struct timeval* relativeTime)
+{
+    TIMED_CALLBACK* pTimed = new TIMED_CALLBACK;
+    pthread_t thread;
+
+    pTimed->pfnCallback = callback;
+    pTimed->pParam = param;
+    pTimed->delay.tv_sec = relativeTime ? relativeTime->tv_sec : 0;
+    pTimed->delay.tv_usec = relativeTime ? relativeTime->tv_usec : 0;
+
+    if (0 != pthread_create(&thread, NULL, RunTimedCallback, pTimed))
+    {
+        delete pTimed;
+        return;
+    }
+    pthread_detach(thread);
+}
+
+static const struct RIL_Env s_rilEnv =
+{
+    OnRequestComplete,
+    OnUnsolicitedResponse,
+    RequestTimedCallback
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//  Clients
+//
+static BOOL WaitForRadioState(BOOL bOn, UINT32 uiTimeoutMs)
+{
+    for (UINT32 uiWaitedMs = 0; uiWaitedMs < uiTimeoutMs; uiWaitedMs += 100)
+    {
+        RIL_RadioState state = s_pRadioFuncs->onStateRequest();
+        if (bOn ? (RADIO_STATE_ON == state) : (RADIO_STATE_UNAVAILABLE != state))
+        {
+            return TRUE;
+        }
+        usleep(100 * 1000);
+    }
+    return FALSE;
+}
+
+//  Sends one request and waits for its completion; the RIL's own timeouts
+//  complete requests the modem never answers, 60 s is only a last resort.
+static BOOL SendRequest(UINT32 uiWorkload, int iRequestId, int* piData)
+{
+    PENDING* pPending = new PENDING;
+    struct timespec deadline;
+    BOOL bDone;
+
+    pPending->uiWorkload = uiWorkload;
+    pPending->bDone = FALSE;
+    pthread_mutex_init(&pPending->lock, NULL);
+    pthread_cond_init(&pPending->cond, NULL);
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 60;
+
+    pPending->startNs = NowNs();
+    s_pRadioFuncs->onRequest(iRequestId, piData, piData ? sizeof(int) : 0,
+            (RIL_Token)pPending);
+
+    pthread_mutex_lock(&pPending->lock);
+    while (!pPending->bDone &&
+            0 == pthread_cond_timedwait(&pPending->cond, &pPending->lock, &deadline));
+    bDone = pPending->bDone;
+    pthread_mutex_unlock(&pPending->lock);
+
+    if (!bDone)
+    {
+        //  Leak it: the RIL still holds the token
+        __sync_fetch_and_add(&s_nTimedOut, 1);
+        return FALSE;
+    }
+
+    pthread_cond_destroy(&pPending->cond);
+    pthread_mutex_destroy(&pPending->lock);
+    delete pPending;
+    return TRUE;
+}
+
+static void* RunClient(void* pArg)
+{
+    UINT32 nIterations = *(UINT32*)pArg;
+
+    for (UINT32 i = 0; i < nIterations; ++i)
+    {
+        for (UINT32 w = 0; w < s_nWorkload; ++w)
+        {
+            int iData = s_rgWorkload[w].iData;
+            SendRequest(w, s_rgWorkload[w].iRequestId,
+                    s_rgWorkload[w].bHasData ? &iData : NULL);
+        }
+    }
+    return NULL;
+}
+
+static int CompareUInt32(const void* pA, const void* pB)
+{
+    UINT32 a = *(const UINT32*)pA;
+    UINT32 b = *(const UINT32*)pB;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+static UINT32 Percentile(const UINT32* puiSorted, UINT32 n, UINT32 uiPercent)
+{
+    return n ? puiSorted[(n - 1) * uiPercent / 100] : 0;
+}
+
+static void PrintStats()
+{
+    printf("%-28s %6s %6s %9s %9s %9s %9s\n", "request", "count", "errors", "p50 us",
+            "p90 us", "p99 us", "max us");
+
+    //  SCREEN_STATE is in the workload twice; merge by request ID
+    for (UINT32 w = 0; w < s_nWorkload; ++w)
+    {
+        UINT32 nSamples = 0;
+        UINT32 nErrors = 0;
+        BOOL bSeen = FALSE;
+
+        for (UINT32 v = 0; v < w; ++v)
+        {
+            bSeen = bSeen || (s_rgWorkload[v].iRequestId == s_rgWorkload[w].iRequestId);
+        }
+        if (bSeen)
+        {
+            continue;
+        }
+
+        for (UINT32 v = w; v < s_nWorkload; ++v)
+        {
+            if (s_rgWorkload[v].iRequestId == s_rgWorkload[w].iRequestId)
+            {
+                nSamples += s_rgStats[v].nSamples;
+            }
+        }
+
+        UINT32* puiSorted = new UINT32[nSamples ? nSamples : 1];
+        nSamples = 0;
+        for (UINT32 v = w; v < s_nWorkload; ++v)
+        {
+            if (s_rgWorkload[v].iRequestId == s_rgWorkload[w].iRequestId)
+            {
+                memcpy(puiSorted + nSamples, s_rgStats[v].puiSamplesUs,
+                        s_rgStats[v].nSamples * sizeof(UINT32));
+                nSamples += s_rgStats[v].nSamples;
+                nErrors += s_rgStats[v].nErrors;
+            }
+        }
+        qsort(puiSorted, nSamples, sizeof(UINT32), CompareUInt32);
+
+        printf("%-28s %6u %6u %9u %9u %9u %9u\n", s_rgWorkload[w].szName, nSamples, nErrors,
+                Percentile(puiSorted, nSamples, 50), Percentile(puiSorted, nSamples, 90),
+                Percentile(puiSorted, nSamples, 99), Percentile(puiSorted, nSamples, 100));
+        delete[] puiSorted;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    //  RIL_Init() port options in channel order, as rild passes them
+    static const char* const rgszOptions[] =
+    {
+        "-a", "-n", "-m", "-c", "-u", "-o", "-d", "-d", "-d"
+    };
+    const UINT32 nChannels = sizeof(rgszOptions) / sizeof(rgszOptions[0]);
+
+    CModemSim sim;
+    UINT32 nIterations = 200;
+    UINT32 nClients = 1;
+    UINT32 uiErrorPermille = 0;
+    UINT32 uiDropPermille = 0;
+    char* rgszRilArgs[2 * nChannels + 3];
+    int nRilArgs = 0;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "m:i:j:l:e:x:u:")))
+    {
+        switch (opt)
+        {
+            case 'm':
+                if (!sim.SetModem(optarg))
+                {
+                    fprintf(stderr, "Unknown modem %s\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case 'i':
+                nIterations = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'j':
+                nClients = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'l':
+            {
+                char* pEnd = NULL;
+                UINT32 uiMin = strtoul(optarg, &pEnd, 10);
+                UINT32 uiMax = (':' == *pEnd) ? strtoul(pEnd + 1, NULL, 10) : uiMin;
+                sim.SetLatency(uiMin, uiMax);
+                break;
+            }
+
+            case 'e':
+                uiErrorPermille = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'x':
+                uiDropPermille = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'u':
+            {
+                char* pEnd = NULL;
+                UINT32 uiChannel = strtoul(optarg, &pEnd, 10);
+                UINT32 uiPeriodMs = (':' == *pEnd) ? strtoul(pEnd + 1, &pEnd, 10) : 0;
+                UINT32 uiBurst = (':' == *pEnd) ? strtoul(pEnd + 1, &pEnd, 10) : 0;
+                if (':' != *pEnd || !sim.AddUrcStorm(uiChannel, uiPeriodMs, uiBurst, pEnd + 1))
+                {
+                    fprintf(stderr, "Invalid URC storm %s\n", optarg);
+                    return 1;
+                }
+                break;
+            }
+
+            default:
+                fprintf(stderr, "Usage: %s [-m 6260|6360|7160|7260] [-i <iterations>]"
+                        " [-j <clients>] [-l <min ms>[:<max ms>]] [-e <error per-mille>]"
+                        " [-x <drop per-mille>] [-u <channel>:<period ms>:<burst>:<URC>]..."
+                        " [<script>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind < argc && !sim.LoadScript(argv[optind]))
+    {
+        return 1;
+    }
+    if (0 == nClients)
+    {
+        nClients = 1;
+    }
+
+    //  Bring the RIL up against an error-free modem; injection starts with the workload
+    if (!sim.Start(nChannels, NULL))
+    {
+        return 1;
+    }
+
+    rgszRilArgs[nRilArgs++] = argv[0];
+    for (UINT32 i = 0; i < nChannels; ++i)
+    {
+        rgszRilArgs[nRilArgs++] = const_cast<char*>(rgszOptions[i]);
+        rgszRilArgs[nRilArgs++] = const_cast<char*>(sim.GetPortName(i));
+    }
+#if defined(M2_DUALSIM_FEATURE_ENABLED)
+    rgszRilArgs[nRilArgs++] = const_cast<char*>("-i");
+    rgszRilArgs[nRilArgs++] = const_cast<char*>("0");
+#endif
+
+    optind = 1;
+    s_pRadioFuncs = RIL_Init(&s_rilEnv, nRilArgs, rgszRilArgs);
+    if (NULL == s_pRadioFuncs)
+    {
+        fprintf(stderr, "RIL_Init() failed\n");
+        return 1;
+    }
+
+    if (!WaitForRadioState(FALSE, 60000))
+    {
+        fprintf(stderr, "The RIL did not initialize the modem\n");
+        return 1;
+    }
+
+    int iRadioOn = 1;
+    double startNs = NowNs();
+    SendRequest(s_nWorkload, RIL_REQUEST_RADIO_POWER, &iRadioOn);
+    if (!WaitForRadioState(TRUE, 60000))
+    {
+        fprintf(stderr, "The radio did not turn on\n");
+        return 1;
+    }
+    printf("radio on in %.1f ms\n", (NowNs() - startNs) / 1e6);
+
+    for (UINT32 w = 0; w < s_nWorkload; ++w)
+    {
+        s_rgStats[w].puiSamplesUs = new UINT32[nIterations * nClients];
+        s_rgStats[w].nSamples = 0;
+        s_rgStats[w].nErrors = 0;
+    }
+
+    sim.SetErrorRate(uiErrorPermille, uiDropPermille);
+    UINT32 uiCommandsBefore = sim.GetCommandCount();
+    pthread_t* pThreads = new pthread_t[nClients];
+
+    startNs = NowNs();
+    for (UINT32 i = 0; i < nClients; ++i)
+    {
+        if (0 != pthread_create(&pThreads[i], NULL, RunClient, &nIterations))
+        {
+            fprintf(stderr, "Cannot create client thread\n");
+            return 1;
+        }
+    }
+    for (UINT32 i = 0; i < nClients; ++i)
+    {
+        pthread_join(pThreads[i], NULL);
+    }
+    double elapsedNs = NowNs() - startNs;
+
+    printf("%u clients x %u iterations x %u requests in %.1f ms, %u AT commands,"
+            " %u errors injected, %u dropped, %u URCs, %u requests never completed\n",
+            nClients, nIterations, s_nWorkload, elapsedNs / 1e6,
+            sim.GetCommandCount() - uiCommandsBefore, sim.GetErrorCount(),
+            sim.GetDroppedCount(), sim.GetUrcCount(), s_nTimedOut);
+    PrintStats();
+
+    delete[] pThreads;
+
+    //  The RIL keeps its threads and ports; exit without tearing them down
+    fflush(stdout);
+    _exit(0);
+}
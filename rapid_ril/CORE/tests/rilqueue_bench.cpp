@@ -0,0 +1,350 @@
+////////////////////////////////////////////////////////////////////////////
+// rilqueue_bench.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Checks that CRilQueue hands out commands in the same order as the former
+//    single sorted list, then measures queueing cost during a command burst.
+//
+//    Usage: rilqueue_bench [-n <passes>] [-d <depth>] [-s <seed>]
+//
+//    The order check runs random Enqueue() (with and without bFront, at
+//    several priorities, including duplicates), Dequeue() and DequeueByObj()
+//    against both queues and compares every result and the final contents.
+//    Any difference is reported and the tool exits with a non-zero status.
+//
+//    The timing run queues <depth> commands the way SIM initialization and a
+//    network scan do (mostly normal priority, a few high priority and a few
+//    queued at the front), then drains the queue, <passes> times.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "rilqueue.h"
+
+//  The list CRilQueue used to keep, without the locking: one node allocated per
+//  Enqueue(), a walk for duplicates and a walk for the priority insertion point.
+class CListQueue
+{
+public:
+    CListQueue() : m_pFront(NULL), m_pBack(NULL) { }
+    ~CListQueue()
+    {
+        int* pObj;
+        while (Dequeue(pObj));
+    }
+
+    BOOL Enqueue(int* pObj, UINT32 uiPriority, BOOL bFront)
+    {
+        CMutex::Lock(&m_cMutex);
+
+        for (ListNode* node = m_pFront; node != NULL; node = node->m_pNext)
+        {
+            if (pObj == node->m_pObj)
+            {
+                CMutex::Unlock(&m_cMutex);
+                return TRUE;
+            }
+        }
+
+        ListNode* newNode = new ListNode;
+        newNode->m_pObj = pObj;
+        newNode->m_uiPriority = uiPriority;
+        newNode->m_pNext = NULL;
+
+        if (NULL == m_pFront)
+        {
+            m_pFront = m_pBack = newNode;
+        }
+        else if (bFront)
+        {
+            newNode->m_pNext = m_pFront;
+            m_pFront = newNode;
+        }
+        else if (0 == uiPriority)
+        {
+            m_pBack->m_pNext = newNode;
+            m_pBack = newNode;
+        }
+        else
+        {
+            ListNode* node;
+            ListNode* previous;
+            for (previous = node = m_pFront;
+                 node != NULL && node->m_uiPriority >= uiPriority;
+                 previous = node, node = node->m_pNext);
+            if (NULL == node)
+            {
+                m_pBack->m_pNext = newNode;
+                m_pBack = newNode;
+            }
+            else if (m_pFront == node)
+            {
+                newNode->m_pNext = m_pFront;
+                m_pFront = newNode;
+            }
+            else
+            {
+                newNode->m_pNext = node;
+                previous->m_pNext = newNode;
+            }
+        }
+
+        CMutex::Unlock(&m_cMutex);
+        return TRUE;
+    }
+
+    BOOL Dequeue(int*& rpObj)
+    {
+        CMutex::Lock(&m_cMutex);
+
+        ListNode* pOld = m_pFront;
+        if (NULL == pOld)
+        {
+            CMutex::Unlock(&m_cMutex);
+            return FALSE;
+        }
+        rpObj = pOld->m_pObj;
+        m_pFront = pOld->m_pNext;
+        if (NULL == m_pFront)
+        {
+            m_pBack = NULL;
+        }
+        delete pOld;
+
+        CMutex::Unlock(&m_cMutex);
+        return TRUE;
+    }
+
+    BOOL DequeueByObj(int* pObj)
+    {
+        CMutex::Lock(&m_cMutex);
+
+        ListNode* previous = NULL;
+        for (ListNode* node = m_pFront; node != NULL; previous = node, node = node->m_pNext)
+        {
+            if (pObj == node->m_pObj)
+            {
+                if (NULL == previous)
+                {
+                    m_pFront = node->m_pNext;
+                }
+                else
+                {
+                    previous->m_pNext = node->m_pNext;
+                }
+                if (m_pBack == node)
+                {
+                    m_pBack = previous;
+                }
+                delete node;
+                CMutex::Unlock(&m_cMutex);
+                return TRUE;
+            }
+        }
+
+        CMutex::Unlock(&m_cMutex);
+        return FALSE;
+    }
+
+    int GetAll(int** ppObjs)
+    {
+        int nCount = 0;
+        for (ListNode* node = m_pFront; node != NULL; node = node->m_pNext)
+        {
+            ppObjs[nCount++] = node->m_pObj;
+        }
+        return nCount;
+    }
+
+private:
+    struct ListNode
+    {
+        int*        m_pObj;
+        UINT32      m_uiPriority;
+        ListNode*   m_pNext;
+    };
+
+    ListNode*   m_pFront;
+    ListNode*   m_pBack;
+    CMutex      m_cMutex;
+};
+
+static UINT32 s_uiSeed = 1;
+
+static UINT32 Rand()
+{
+    s_uiSeed = s_uiSeed * 1103515245 + 12345;
+    return (s_uiSeed >> 16) & 0x7FFF;
+}
+
+static double NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//  Random operations on both queues; returns the number of differences.
+static UINT32 CheckOrder(int* pObjs, UINT32 nObjs, UINT32 nOps)
+{
+    CRilQueue<int*> queue;
+    CListQueue list;
+    UINT32 nMismatch = 0;
+
+    for (UINT32 i = 0; i < nOps; ++i)
+    {
+        UINT32 uiOp = Rand() % 100;
+        int* pObj = &pObjs[Rand() % nObjs];
+
+        if (uiOp < 55)
+        {
+            //  Mostly normal priority, as CCommand::IsHighPriority() gives 0 or 1
+            UINT32 uiPriority = (uiOp < 35) ? 0 : (uiOp < 50) ? 1 : Rand() % 4;
+            BOOL bFront = (0 == Rand() % 6);
+
+            queue.Enqueue(pObj, uiPriority, bFront);
+            list.Enqueue(pObj, uiPriority, bFront);
+        }
+        else if (uiOp < 90)
+        {
+            int* pA = NULL;
+            int* pB = NULL;
+            BOOL fA = list.Dequeue(pA);
+            BOOL fB = queue.Dequeue(pB);
+
+            if (fA != fB || pA != pB)
+            {
+                printf("MISMATCH at op %u: Dequeue() %d/%d %d/%d\n", i, fA, fB,
+                        fA ? (int)(pA - pObjs) : -1, fB ? (int)(pB - pObjs) : -1);
+                ++nMismatch;
+            }
+        }
+        else
+        {
+            BOOL fA = list.DequeueByObj(pObj);
+            BOOL fB = queue.DequeueByObj(pObj);
+
+            if (fA != fB)
+            {
+                printf("MISMATCH at op %u: DequeueByObj(%d) %d/%d\n", i, (int)(pObj - pObjs),
+                        fA, fB);
+                ++nMismatch;
+            }
+        }
+    }
+
+    int** ppA = new int*[nObjs];
+    int* pA = NULL;
+    int nA = list.GetAll(ppA);
+    int** ppB = NULL;
+    int nB = 0;
+
+    queue.GetAllQueuedObjects(ppB, nB);
+    if (nA != nB || (int)queue.GetCount() != nB ||
+            (nA > 0 && 0 != memcmp(ppA, ppB, nA * sizeof(int*))))
+    {
+        printf("MISMATCH: final contents (%d/%d objects)\n", nA, nB);
+        ++nMismatch;
+    }
+    delete[] ppA;
+    delete[] ppB;
+
+    while (list.Dequeue(pA));
+    return nMismatch;
+}
+
+//  Queue nDepth commands as a burst and drain them, nPasses times.
+template <class Queue>
+static double Burst(Queue& rQueue, int* pObjs, const UINT32* puiPriority, const BOOL* pbFront,
+        UINT32 nDepth, UINT32 nPasses, UINT32& ruiSink)
+{
+    double start = NowNs();
+
+    for (UINT32 p = 0; p < nPasses; ++p)
+    {
+        for (UINT32 i = 0; i < nDepth; ++i)
+        {
+            rQueue.Enqueue(&pObjs[i], puiPriority[i], pbFront[i]);
+        }
+
+        int* pObj = NULL;
+        while (rQueue.Dequeue(pObj))
+        {
+            ruiSink += *pObj;
+        }
+    }
+
+    return (NowNs() - start) / ((double)nPasses * nDepth);
+}
+
+int main(int argc, char** argv)
+{
+    UINT32 nPasses = 2000;
+    UINT32 nDepth = 300;
+    UINT32 nMismatch = 0;
+    UINT32 uiSink = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            nPasses = strtoul(argv[++i], NULL, 10);
+        }
+        else if (0 == strcmp(argv[i], "-d") && i + 1 < argc)
+        {
+            nDepth = strtoul(argv[++i], NULL, 10);
+        }
+        else if (0 == strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            s_uiSeed = strtoul(argv[++i], NULL, 10);
+        }
+    }
+    if (0 == nDepth)
+    {
+        nDepth = 1;
+    }
+
+    int* pObjs = new int[nDepth];
+    UINT32* puiPriority = new UINT32[nDepth];
+    BOOL* pbFront = new BOOL[nDepth];
+
+    for (UINT32 i = 0; i < nDepth; ++i)
+    {
+        pObjs[i] = i;
+    }
+
+    //  Small sets force duplicates, large ones a deep queue
+    nMismatch += CheckOrder(pObjs, nDepth < 8 ? nDepth : 8, 20000);
+    nMismatch += CheckOrder(pObjs, nDepth, 200000);
+
+    for (UINT32 i = 0; i < nDepth; ++i)
+    {
+        puiPriority[i] = (0 == Rand() % 10) ? 1 : 0;
+        pbFront[i] = (0 == Rand() % 25);
+    }
+
+    CListQueue list;
+    CRilQueue<int*> queue;
+
+    double listNs = Burst(list, pObjs, puiPriority, pbFront, nDepth, nPasses, uiSink);
+    double queueNs = Burst(queue, pObjs, puiPriority, pbFront, nDepth, nPasses, uiSink);
+
+    printf("%u commands per burst, %u passes\n", nDepth, nPasses);
+    printf("list:  %.1f ns/command\n", listNs);
+    printf("queue: %.1f ns/command (%.2fx)\n", queueNs, queueNs > 0 ? listNs / queueNs : 0.0);
+    printf("%u mismatches [sink %u]\n", nMismatch, uiSink);
+
+    delete[] pObjs;
+    delete[] puiPriority;
+    delete[] pbFront;
+
+    return nMismatch ? 1 : 0;
+}
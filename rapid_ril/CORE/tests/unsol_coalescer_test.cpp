@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////
+// unsol_coalescer_test.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Unit test of CUnsolCoalescer. The notifications it sends and the flush
+//    it schedules are captured here instead of going to the framework, and
+//    the test fires the flush itself.
+//
+//    Usage: unsol_coalescer_test
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "rril.h"
+#include "rildmain.h"
+#include "unsol_coalescer.h"
+
+static const UINT32 WINDOW_MS = 50;
+static const UINT32 MAX_SENT = 64;
+
+static int s_nErrors = 0;
+
+#define CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+        { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_nErrors++; \
+        } \
+    } while (0)
+
+//  What the coalescer sent, in order
+static pthread_mutex_t s_sentMutex = PTHREAD_MUTEX_INITIALIZER;
+static int s_rgSentID[MAX_SENT];
+static int s_rgSentStrength[MAX_SENT];
+static UINT32 s_nSent = 0;
+
+//  Set while a flush is in the middle of sending
+static volatile BOOL s_bSlowFlush = FALSE;
+static volatile BOOL s_bFlushSending = FALSE;
+
+static RIL_TimedCallback s_pfnFlush = NULL;
+static void* s_pFlushParam = NULL;
+
+void RIL_onCoalescedUnsolicitedResponse(int unsolResponseID, const void* pData, size_t dataSize)
+{
+    int iStrength = -1;
+
+    if (RIL_UNSOL_SIGNAL_STRENGTH == unsolResponseID && sizeof(RIL_SignalStrength_v6) == dataSize)
+    {
+        iStrength = ((const RIL_SignalStrength_v6*)pData)->GW_SignalStrength.signalStrength;
+    }
+
+    if (s_bSlowFlush)
+    {
+        //  Leave the other thread time to send a newer notification.
+        s_bFlushSending = TRUE;
+        usleep(100 * 1000);
+    }
+
+    pthread_mutex_lock(&s_sentMutex);
+    if (s_nSent < MAX_SENT)
+    {
+        s_rgSentID[s_nSent] = unsolResponseID;
+        s_rgSentStrength[s_nSent] = iStrength;
+        s_nSent++;
+    }
+    pthread_mutex_unlock(&s_sentMutex);
+}
+
+void RIL_requestTimedCallback(RIL_TimedCallback callback, void* pParam,
+        const unsigned long /*seconds*/, const unsigned long /*microSeconds*/)
+{
+    s_pfnFlush = callback;
+    s_pFlushParam = pParam;
+}
+
+static RIL_SignalStrength_v6 SignalStrength(int iStrength)
+{
+    RIL_SignalStrength_v6 ss;
+
+    memset(&ss, 0, sizeof(ss));
+    ss.GW_SignalStrength.signalStrength = iStrength;
+    ss.LTE_SignalStrength.rsrp = INT_MAX;
+    return ss;
+}
+
+static BOOL CoalesceStrength(CUnsolCoalescer& rCoalescer, int iStrength)
+{
+    RIL_SignalStrength_v6 ss = SignalStrength(iStrength);
+    return rCoalescer.Coalesce(RIL_UNSOL_SIGNAL_STRENGTH, &ss, sizeof(ss));
+}
+
+static int LastSentStrength()
+{
+    return s_nSent ? s_rgSentStrength[s_nSent - 1] : -1;
+}
+
+static void RunFlush()
+{
+    RIL_TimedCallback pfnFlush = s_pfnFlush;
+
+    s_pfnFlush = NULL;
+    if (NULL != pfnFlush)
+    {
+        pfnFlush(s_pFlushParam);
+    }
+}
+
+static void* FlushThread(void* /*pArg*/)
+{
+    RunFlush();
+    return NULL;
+}
+
+static void TestCoalescing()
+{
+    CUnsolCoalescer coalescer;
+    UINT32 uiDelivered = 0;
+    UINT32 uiSuppressed = 0;
+
+    coalescer.SetWindow(WINDOW_MS);
+    coalescer.SetSignalStrengthDelta(2);
+    s_nSent = 0;
+
+    //  Sent at once, then dropped as identical
+    CHECK(CoalesceStrength(coalescer, 20));
+    CHECK(1 == s_nSent && 20 == LastSentStrength());
+    CHECK(CoalesceStrength(coalescer, 20));
+    CHECK(1 == s_nSent);
+
+    //  A small change is held back until the window ends
+    CHECK(CoalesceStrength(coalescer, 21));
+    CHECK(1 == s_nSent && NULL != s_pfnFlush);
+
+    //  A change of the delta is sent at once and replaces the held one
+    CHECK(CoalesceStrength(coalescer, 23));
+    CHECK(2 == s_nSent && 23 == LastSentStrength());
+
+    CHECK(CoalesceStrength(coalescer, 24));
+    CHECK(CoalesceStrength(coalescer, 22));
+    CHECK(2 == s_nSent);
+    usleep(WINDOW_MS * 1000);
+    RunFlush();
+    CHECK(3 == s_nSent && 22 == LastSentStrength());
+
+    //  Losing the signal is always sent at once
+    CHECK(CoalesceStrength(coalescer, 99));
+    CHECK(4 == s_nSent && 99 == LastSentStrength());
+
+    //  Other notifications are left to the caller; a radio state change
+    //  forgets what was sent
+    CHECK(!coalescer.Coalesce(RIL_UNSOL_RESPONSE_RADIO_STATE_CHANGED, NULL, 0));
+    CHECK(CoalesceStrength(coalescer, 99));
+    CHECK(5 == s_nSent);
+
+    coalescer.GetCounters(uiDelivered, uiSuppressed);
+    CHECK(5 == uiDelivered);
+    CHECK(3 == uiSuppressed);
+}
+
+//  A notification sent at once while an older one is being flushed must be
+//  sent after it, else the framework is left with the older data.
+static void TestFlushOrder()
+{
+    CUnsolCoalescer coalescer;
+    pthread_t thread;
+
+    coalescer.SetWindow(WINDOW_MS);
+    coalescer.SetSignalStrengthDelta(2);
+    s_nSent = 0;
+
+    CHECK(CoalesceStrength(coalescer, 20));
+    CHECK(CoalesceStrength(coalescer, 21));
+    usleep(WINDOW_MS * 1000);
+
+    s_bSlowFlush = TRUE;
+    s_bFlushSending = FALSE;
+    CHECK(0 == pthread_create(&thread, NULL, FlushThread, NULL));
+    while (!s_bFlushSending)
+    {
+        usleep(1000);
+    }
+    s_bSlowFlush = FALSE;
+
+    CHECK(CoalesceStrength(coalescer, 30));
+    pthread_join(thread, NULL);
+
+    CHECK(3 == s_nSent);
+    CHECK(30 == LastSentStrength());
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    TestCoalescing();
+    TestFlushOrder();
+
+    if (s_nErrors)
+    {
+        printf("FAILED: %d errors\n", s_nErrors);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,322 @@
+////////////////////////////////////////////////////////////////////////////
+// urc_dispatch_bench.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Replays a trace of modem responses through the URC lookup of a channel
+//    and compares the prefix trie against the former silo-by-silo table scan.
+//
+//    Usage: urc_dispatch_bench [-n <passes>] [<trace file>]
+//
+//    The trace file holds one response per line, as seen after the leading
+//    CRLF has been skipped. Without a trace file, a recorded idle/handover
+//    trace from the URC channel is used. Every line is looked up with both
+//    methods; any disagreement on silo, parse function or end of prefix is
+//    reported and the tool exits with a non-zero status.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "silo.h"
+#include "urc_dispatcher.h"
+#include "initializer.h"
+#include "silo_voice.h"
+#include "silo_sim.h"
+#include "silo_sms.h"
+#include "silo_data.h"
+#include "silo_network.h"
+#include "silo_phonebook.h"
+#include "silo_misc.h"
+#include "silo_ims.h"
+#include "silo_common.h"
+
+//  Mix of unsolicited and solicited lines, in the proportions seen on the URC
+//  channel of an XMM7160 camped on LTE with periodic cell info reporting.
+static const char* s_rgszTrace[] =
+{
+    "+XCSQ: 21,99",
+    "+XCESQI: 99,99,255,255,35,62",
+    "+CREG: 1,\"1A2B\",\"0001C3D5\",7",
+    "+CGREG: 1,\"1A2B\",\"0001C3D5\",7,\"01\"",
+    "+CEREG: 1,\"1A2B\",\"0001C3D5\",7",
+    "+XREG: 1,7,\"1A2B\",\"0001C3D5\"",
+    "+XCSQ: 20,99",
+    "+XMETRIC: 3,21,\"-96\"",
+    "+XCESQI: 99,99,255,255,34,60",
+    "+CGEV: NW MODIFY 5,0",
+    "+XDATASTAT: 1",
+    "+CTZV: +08,1",
+    "+XNITZINFO: \"13/06/12,09:41:22\",+08,0",
+    "+XCIEV: 1,2",
+    "+XCIEV:3",
+    "+CIREPH: 1",
+    "+CIREGU: 1,3",
+    "+XCSQ: 22,99",
+    "+XNRTCWSI: 1",
+    "+CMTI: \"SM\",3",
+    "+CRING: VOICE",
+    "+XCALLSTAT: 1,4",
+    "+CLCC: 1,1,4,0,0,\"+15555550123\",145",
+    "+XCALLSTAT: 1,0",
+    "CONNECT",
+    "+XCALLINFO: 1,0,0,1,\"+15555550123\",145",
+    "NO CARRIER",
+    "DISCONNECT",
+    "+XCEER: \"CC\",16",
+    "+CSSU: 2",
+    "+XCSQ: 19,99",
+    "  +CREG: 2,\"1A2B\",\"0001C3D6\",7",
+    "+CEREG: 1,\"1A2C\",\"0001C3D6\",7",
+    "+XLEMA: 1,2,112",
+    "+XSIM: 7",
+    "+PBREADY",
+    "+XLOCK: \"PN\",0,0",
+    "+SATI: D02E8103",
+    "+STKCTRLIND: 0,1,",
+    "OK",
+    "ERROR",
+    "+CME ERROR: 100",
+    "+CSQ: 21,99",
+    "+CGACT: 1,1",
+    "RING",
+    "RING CTM",
+    "CTM CALL",
+    "BUSY",
+    "NO ANSWER",
+    "+XDRVI: 0,1,1",
+    "+IMSCALLSTAT: 1,0",
+    "+XISRVCCI: 1",
+};
+
+//  Silo types in the order CInitializer::CreateSilos() adds them
+static CSilo* CreateSilo(int siloType)
+{
+    switch (siloType)
+    {
+        case SILO_TYPE_VOICE:       return new CSilo_Voice(NULL, NULL);
+        case SILO_TYPE_SIM:         return new CSilo_SIM(NULL, NULL);
+        case SILO_TYPE_SMS:         return new CSilo_SMS(NULL, NULL);
+        case SILO_TYPE_DATA:        return new CSilo_Data(NULL, NULL);
+        case SILO_TYPE_NETWORK:     return new CSilo_Network(NULL, NULL);
+        case SILO_TYPE_PHONEBOOK:   return new CSilo_Phonebook(NULL, NULL);
+        case SILO_TYPE_MISC:        return new CSilo_MISC(NULL, NULL);
+        case SILO_TYPE_IMS:         return new CSilo_IMS(NULL, NULL);
+        case SILO_TYPE_COMMON:      return new CSilo_Common(NULL, NULL);
+        default:                    return NULL;
+    }
+}
+
+//  The lookup CChannelBase::ParseUnsolicitedResponse() used to do: each silo in
+//  turn, each row of its tables in turn, SkipString() on the prefix.
+static BOOL LinearFind(CSilo* const* ppSilos, UINT32 nSilos, const char* szStr,
+        CSilo*& rpSilo, PFN_ATRSP_PARSE& rpfnParser, const char*& rszEnd)
+{
+    szStr += strspn(szStr, " ");
+    rszEnd = szStr;
+
+    for (UINT32 i = 0; i < nSilos; ++i)
+    {
+        const ATRSPTABLE* rgpTables[2] = { ppSilos[i]->GetATRspTable(),
+                ppSilos[i]->GetATRspTableExt() };
+
+        for (int t = 0; t < 2; ++t)
+        {
+            const ATRSPTABLE* pTable = rgpTables[t];
+            for (int nRow = 0; NULL != pTable && NULL != pTable[nRow].szATResponse &&
+                    '\0' != pTable[nRow].szATResponse[0]; ++nRow)
+            {
+                size_t len = strlen(pTable[nRow].szATResponse);
+                if (0 == strncmp(szStr, pTable[nRow].szATResponse, len))
+                {
+                    rpSilo = ppSilos[i];
+                    rpfnParser = pTable[nRow].pfnATParseRsp;
+                    rszEnd = szStr + len;
+                    return TRUE;
+                }
+            }
+        }
+    }
+    return FALSE;
+}
+
+static double NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static char** LoadTrace(const char* szFile, UINT32& rnLines)
+{
+    FILE* fp = fopen(szFile, "r");
+    char szLine[1024];
+    char** ppszLines = NULL;
+    UINT32 nAlloc = 0;
+
+    rnLines = 0;
+    if (NULL == fp)
+    {
+        return NULL;
+    }
+
+    while (fgets(szLine, sizeof(szLine) - 2, fp))
+    {
+        szLine[strcspn(szLine, "\r\n")] = '\0';
+        if ('\0' == szLine[0])
+        {
+            continue;
+        }
+
+        if (rnLines == nAlloc)
+        {
+            nAlloc = nAlloc ? nAlloc * 2 : 256;
+            char** ppszNew = new char*[nAlloc];
+            if (rnLines)
+            {
+                memcpy(ppszNew, ppszLines, rnLines * sizeof(char*));
+            }
+            delete[] ppszLines;
+            ppszLines = ppszNew;
+        }
+
+        strcat(szLine, "\r\n");
+        ppszLines[rnLines] = new char[strlen(szLine) + 1];
+        strcpy(ppszLines[rnLines], szLine);
+        ++rnLines;
+    }
+
+    fclose(fp);
+    return ppszLines;
+}
+
+int main(int argc, char** argv)
+{
+    const int rgSiloTypes[] = { SILO_TYPE_VOICE, SILO_TYPE_SIM, SILO_TYPE_SMS, SILO_TYPE_DATA,
+            SILO_TYPE_NETWORK, SILO_TYPE_PHONEBOOK, SILO_TYPE_MISC, SILO_TYPE_IMS,
+            SILO_TYPE_COMMON };
+    const UINT32 nSilos = sizeof(rgSiloTypes) / sizeof(rgSiloTypes[0]);
+    CSilo* rgpSilos[nSilos];
+    CUrcDispatcher dispatcher;
+    char** ppszLines = NULL;
+    UINT32 nLines = 0;
+    UINT32 nPasses = 20000;
+    UINT32 nMismatch = 0;
+    UINT32 nHits = 0;
+    const char* szFile = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            nPasses = strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            szFile = argv[i];
+        }
+    }
+
+    if (szFile)
+    {
+        ppszLines = LoadTrace(szFile, nLines);
+        if (0 == nLines)
+        {
+            fprintf(stderr, "Cannot read trace %s\n", szFile);
+            return 1;
+        }
+    }
+    else
+    {
+        nLines = sizeof(s_rgszTrace) / sizeof(s_rgszTrace[0]);
+        ppszLines = new char*[nLines];
+        for (UINT32 i = 0; i < nLines; ++i)
+        {
+            ppszLines[i] = new char[strlen(s_rgszTrace[i]) + 3];
+            sprintf(ppszLines[i], "%s\r\n", s_rgszTrace[i]);
+        }
+    }
+
+    for (UINT32 i = 0; i < nSilos; ++i)
+    {
+        rgpSilos[i] = CreateSilo(rgSiloTypes[i]);
+    }
+
+    double start = NowNs();
+    if (!dispatcher.Build(rgpSilos, nSilos))
+    {
+        fprintf(stderr, "Failed to build dispatcher\n");
+        return 1;
+    }
+    double buildNs = NowNs() - start;
+
+    //  Both lookups must agree on every line before timing anything
+    for (UINT32 i = 0; i < nLines; ++i)
+    {
+        CSilo* pSiloA = NULL;
+        CSilo* pSiloB = NULL;
+        PFN_ATRSP_PARSE pfnA = NULL;
+        PFN_ATRSP_PARSE pfnB = NULL;
+        const char* pEndA = NULL;
+        const char* pEndB = NULL;
+
+        BOOL fA = LinearFind(rgpSilos, nSilos, ppszLines[i], pSiloA, pfnA, pEndA);
+        BOOL fB = dispatcher.Find(ppszLines[i], pSiloB, pfnB, pEndB);
+
+        if (fA != fB || pEndA != pEndB || (fA && (pSiloA != pSiloB || pfnA != pfnB)))
+        {
+            printf("MISMATCH: \"%.*s\"\n", (int)strcspn(ppszLines[i], "\r\n"), ppszLines[i]);
+            ++nMismatch;
+        }
+        nHits += fA ? 1 : 0;
+    }
+
+    CSilo* pSilo = NULL;
+    PFN_ATRSP_PARSE pfn = NULL;
+    const char* pEnd = NULL;
+    UINT32 uiSink = 0;
+
+    start = NowNs();
+    for (UINT32 p = 0; p < nPasses; ++p)
+    {
+        for (UINT32 i = 0; i < nLines; ++i)
+        {
+            uiSink += LinearFind(rgpSilos, nSilos, ppszLines[i], pSilo, pfn, pEnd);
+        }
+    }
+    double linearNs = (NowNs() - start) / ((double)nPasses * nLines);
+
+    start = NowNs();
+    for (UINT32 p = 0; p < nPasses; ++p)
+    {
+        for (UINT32 i = 0; i < nLines; ++i)
+        {
+            uiSink += dispatcher.Find(ppszLines[i], pSilo, pfn, pEnd);
+        }
+    }
+    double trieNs = (NowNs() - start) / ((double)nPasses * nLines);
+
+    printf("%u lines (%u matched), %u passes, build %.1f us\n", nLines, nHits, nPasses,
+            buildNs / 1000.0);
+    printf("linear: %.1f ns/line\n", linearNs);
+    printf("trie:   %.1f ns/line (%.2fx)\n", trieNs, trieNs > 0 ? linearNs / trieNs : 0.0);
+    printf("%u mismatches [sink %u]\n", nMismatch, uiSink);
+
+    for (UINT32 i = 0; i < nSilos; ++i)
+    {
+        delete rgpSilos[i];
+    }
+    for (UINT32 i = 0; i < nLines; ++i)
+    {
+        delete[] ppszLines[i];
+    }
+    delete[] ppszLines;
+
+    return nMismatch ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////
+// xmm_modem_sim.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Stand-alone simulated XMM modem, to run rild or a test client against
+//    on any Linux box.
+//
+//    Usage: xmm_modem_sim [-m 6260|6360|7160|7260] [-n <channels>]
+//                         [-s <socket dir>] [-l <min ms>[:<max ms>]]
+//                         [-e <error per-mille>] [-x <drop per-mille>]
+//                         [-u <channel>:<period ms>:<burst>:<URC>]...
+//                         [<script>]
+//
+//    Channels are ptys unless -s is given. The RIL arguments matching the
+//    channels (in the -a -n -m -c -u -o -d... order) are printed once the
+//    channels are up, with -s instead of -a in socket mode: rild only
+//    opens its channels as sockets when the AT channel comes with -s. The
+//    counters are printed on SIGINT or SIGTERM.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "modem_sim.h"
+
+static volatile sig_atomic_t s_bQuit = 0;
+
+static void OnSignal(int)
+{
+    s_bQuit = 1;
+}
+
+static void Usage(const char* szProgName)
+{
+    fprintf(stderr, "Usage: %s [-m 6260|6360|7160|7260] [-n <channels>] [-s <socket dir>]\n"
+            "        [-l <min ms>[:<max ms>]] [-e <error per-mille>] [-x <drop per-mille>]\n"
+            "        [-u <channel>:<period ms>:<burst>:<URC>]... [<script>]\n", szProgName);
+}
+
+int main(int argc, char** argv)
+{
+    static const char* const rgszOptions[] =
+    {
+        "-a", "-n", "-m", "-c", "-u", "-o", "-d", "-d", "-d", "-d", "-d", "-d"
+    };
+
+    CModemSim sim;
+    UINT32 nChannels = 9;
+    const char* szSocketDir = NULL;
+    UINT32 uiErrorPermille = 0;
+    UINT32 uiDropPermille = 0;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "m:n:s:l:e:x:u:")))
+    {
+        switch (opt)
+        {
+            case 'm':
+                if (!sim.SetModem(optarg))
+                {
+                    fprintf(stderr, "Unknown modem %s\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case 'n':
+                nChannels = strtoul(optarg, NULL, 10);
+                break;
+
+            case 's':
+                szSocketDir = optarg;
+                break;
+
+            case 'l':
+            {
+                char* pEnd = NULL;
+                UINT32 uiMin = strtoul(optarg, &pEnd, 10);
+                UINT32 uiMax = (':' == *pEnd) ? strtoul(pEnd + 1, NULL, 10) : uiMin;
+                sim.SetLatency(uiMin, uiMax);
+                break;
+            }
+
+            case 'e':
+                uiErrorPermille = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'x':
+                uiDropPermille = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'u':
+            {
+                char* pEnd = NULL;
+                UINT32 uiChannel = strtoul(optarg, &pEnd, 10);
+                UINT32 uiPeriodMs = (':' == *pEnd) ? strtoul(pEnd + 1, &pEnd, 10) : 0;
+                UINT32 uiBurst = (':' == *pEnd) ? strtoul(pEnd + 1, &pEnd, 10) : 0;
+                if (':' != *pEnd || !sim.AddUrcStorm(uiChannel, uiPeriodMs, uiBurst, pEnd + 1))
+                {
+                    fprintf(stderr, "Invalid URC storm %s\n", optarg);
+                    return 1;
+                }
+                break;
+            }
+
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind < argc && !sim.LoadScript(argv[optind]))
+    {
+        return 1;
+    }
+    sim.SetErrorRate(uiErrorPermille, uiDropPermille);
+
+    if (nChannels > sizeof(rgszOptions) / sizeof(rgszOptions[0]) ||
+            !sim.Start(nChannels, szSocketDir))
+    {
+        fprintf(stderr, "Cannot start %u channels\n", nChannels);
+        return 1;
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    for (UINT32 i = 0; i < nChannels; ++i)
+    {
+        const char* szOption = (0 == i && NULL != szSocketDir) ? "-s" : rgszOptions[i];
+        printf("%s%s %s", i ? " " : "", szOption, sim.GetPortName(i));
+    }
+    printf("\n");
+    fflush(stdout);
+
+    while (!s_bQuit)
+    {
+        pause();
+    }
+
+    sim.Stop();
+    printf("%u commands, %u errors injected, %u dropped, %u URCs\n", sim.GetCommandCount(),
+            sim.GetErrorCount(), sim.GetDroppedCount(), sim.GetUrcCount());
+    return 0;
+}
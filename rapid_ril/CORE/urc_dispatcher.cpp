@@ -0,0 +1,243 @@
+////////////////////////////////////////////////////////////////////////////
+// urc_dispatcher.cpp
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Implements the prefix trie a channel uses to find the silo and parse
+//    function for an unsolicited response in a single pass.
+//
+//    Every line read on a channel used to be strncmp'd against each row of
+//    each silo's response table in turn. The trie walks the line once and
+//    remembers the earliest registered prefix seen along the way, which
+//    gives the same answer as the row-by-row scan.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "types.h"
+#include "rillog.h"
+#include "urc_dispatcher.h"
+
+CUrcDispatcher::CUrcDispatcher() :
+    m_pNodes(NULL),
+    m_nNodes(0),
+    m_nNodesAlloc(0),
+    m_pEntries(NULL),
+    m_nEntries(0),
+    m_nEntriesAlloc(0)
+{
+}
+
+CUrcDispatcher::~CUrcDispatcher()
+{
+    Clear();
+}
+
+void CUrcDispatcher::Clear()
+{
+    delete[] m_pNodes;
+    m_pNodes = NULL;
+    m_nNodes = m_nNodesAlloc = 0;
+
+    delete[] m_pEntries;
+    m_pEntries = NULL;
+    m_nEntries = m_nEntriesAlloc = 0;
+}
+
+INT32 CUrcDispatcher::NewNode(char cChar)
+{
+    if (m_nNodes == m_nNodesAlloc)
+    {
+        UINT32 nAlloc = m_nNodesAlloc ? m_nNodesAlloc * 2 : 64;
+        NODE* pNodes = new NODE[nAlloc];
+        if (NULL == pNodes)
+        {
+            return -1;
+        }
+        if (m_nNodes)
+        {
+            memcpy(pNodes, m_pNodes, m_nNodes * sizeof(NODE));
+        }
+        delete[] m_pNodes;
+        m_pNodes = pNodes;
+        m_nNodesAlloc = nAlloc;
+    }
+
+    NODE* pNode = &m_pNodes[m_nNodes];
+    pNode->cChar = cChar;
+    pNode->iFirstChild = -1;
+    pNode->iNextSibling = -1;
+    pNode->iEntry = -1;
+    return (INT32)m_nNodes++;
+}
+
+BOOL CUrcDispatcher::AddPrefix(const char* szPrefix, CSilo* pSilo, PFN_ATRSP_PARSE pfnParser)
+{
+    if (m_nEntries == m_nEntriesAlloc)
+    {
+        UINT32 nAlloc = m_nEntriesAlloc ? m_nEntriesAlloc * 2 : 64;
+        ENTRY* pEntries = new ENTRY[nAlloc];
+        if (NULL == pEntries)
+        {
+            return FALSE;
+        }
+        if (m_nEntries)
+        {
+            memcpy(pEntries, m_pEntries, m_nEntries * sizeof(ENTRY));
+        }
+        delete[] m_pEntries;
+        m_pEntries = pEntries;
+        m_nEntriesAlloc = nAlloc;
+    }
+
+    INT32 iNode = 0;
+    for (const char* p = szPrefix; '\0' != *p; ++p)
+    {
+        //  Find the child for *p, keeping the sibling list sorted
+        INT32* piLink = &m_pNodes[iNode].iFirstChild;
+        while (-1 != *piLink && m_pNodes[*piLink].cChar < *p)
+        {
+            piLink = &m_pNodes[*piLink].iNextSibling;
+        }
+
+        if (-1 == *piLink || m_pNodes[*piLink].cChar != *p)
+        {
+            //  piLink may move when m_pNodes grows, so remember where it was
+            INT32 iParent = iNode;
+            INT32 iPrev = (&m_pNodes[iNode].iFirstChild == piLink) ? -1 :
+                    (INT32)(((char*)piLink - (char*)m_pNodes) / sizeof(NODE));
+            INT32 iNext = *piLink;
+            INT32 iChild = NewNode(*p);
+            if (-1 == iChild)
+            {
+                return FALSE;
+            }
+            m_pNodes[iChild].iNextSibling = iNext;
+            if (-1 == iPrev)
+            {
+                m_pNodes[iParent].iFirstChild = iChild;
+            }
+            else
+            {
+                m_pNodes[iPrev].iNextSibling = iChild;
+            }
+            iNode = iChild;
+        }
+        else
+        {
+            iNode = *piLink;
+        }
+    }
+
+    //  An earlier row with the same prefix shadows this one
+    if (-1 == m_pNodes[iNode].iEntry)
+    {
+        m_pNodes[iNode].iEntry = (INT32)m_nEntries;
+    }
+
+    m_pEntries[m_nEntries].pSilo = pSilo;
+    m_pEntries[m_nEntries].pfnParser = pfnParser;
+    ++m_nEntries;
+    return TRUE;
+}
+
+BOOL CUrcDispatcher::AddTable(const ATRSPTABLE* pTable, CSilo* pSilo)
+{
+    if (NULL == pTable)
+    {
+        return TRUE;
+    }
+
+    //  Tables end with a NULL or empty prefix, as in CSilo::FindParser()
+    for (int nRow = 0; NULL != pTable[nRow].szATResponse &&
+            '\0' != pTable[nRow].szATResponse[0]; ++nRow)
+    {
+        if (!AddPrefix(pTable[nRow].szATResponse, pSilo, pTable[nRow].pfnATParseRsp))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+BOOL CUrcDispatcher::Build(CSilo* const* ppSilos, UINT32 nSilos)
+{
+    Clear();
+
+    if (-1 == NewNode('\0'))
+    {
+        goto Error;
+    }
+
+    for (UINT32 i = 0; i < nSilos; ++i)
+    {
+        if (NULL == ppSilos[i])
+        {
+            continue;
+        }
+
+        if (!AddTable(ppSilos[i]->GetATRspTable(), ppSilos[i]) ||
+                !AddTable(ppSilos[i]->GetATRspTableExt(), ppSilos[i]))
+        {
+            goto Error;
+        }
+    }
+
+    RIL_LOG_VERBOSE("CUrcDispatcher::Build() - %u prefixes, %u nodes\r\n", m_nEntries, m_nNodes);
+    return TRUE;
+
+Error:
+    RIL_LOG_CRITICAL("CUrcDispatcher::Build() - Out of memory\r\n");
+    Clear();
+    return FALSE;
+}
+
+BOOL CUrcDispatcher::Find(const char* szStr, CSilo*& rpSilo, PFN_ATRSP_PARSE& rpfnParser,
+        const char*& rszEnd) const
+{
+    INT32 iBest = -1;
+    const char* pBestEnd = NULL;
+
+    //  Skip over any spaces, like SkipString()
+    szStr += strspn(szStr, " ");
+    rszEnd = szStr;
+
+    if (0 == m_nNodes)
+    {
+        return FALSE;
+    }
+
+    INT32 iNode = 0;
+    for (const char* p = szStr; '\0' != *p; ++p)
+    {
+        INT32 iChild = m_pNodes[iNode].iFirstChild;
+        while (-1 != iChild && m_pNodes[iChild].cChar < *p)
+        {
+            iChild = m_pNodes[iChild].iNextSibling;
+        }
+        if (-1 == iChild || m_pNodes[iChild].cChar != *p)
+        {
+            break;
+        }
+
+        iNode = iChild;
+        if (-1 != m_pNodes[iNode].iEntry && (-1 == iBest || m_pNodes[iNode].iEntry < iBest))
+        {
+            iBest = m_pNodes[iNode].iEntry;
+            pBestEnd = p + 1;
+        }
+    }
+
+    if (-1 == iBest)
+    {
+        return FALSE;
+    }
+
+    rpSilo = m_pEntries[iBest].pSilo;
+    rpfnParser = m_pEntries[iBest].pfnParser;
+    rszEnd = pBestEnd;
+    return TRUE;
+}
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////
+// urc_dispatcher.h
+//
+// Copyright 2013 Intel Corporation.  All rights reserved.
+//
+//
+// Description:
+//    Defines the prefix trie a channel uses to find the silo and parse
+//    function for an unsolicited response in a single pass.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef RRIL_URC_DISPATCHER_H
+#define RRIL_URC_DISPATCHER_H
+
+#include "types.h"
+#include "silo.h"
+
+class CUrcDispatcher
+{
+public:
+    CUrcDispatcher();
+    ~CUrcDispatcher();
+
+private:
+    //  Prevent assignment: Declared but not implemented.
+    CUrcDispatcher(const CUrcDispatcher& rhs);  // Copy Constructor
+    CUrcDispatcher& operator=(const CUrcDispatcher& rhs);  //  Assignment operator
+
+public:
+    //  Index the AT response tables of ppSilos. Matching order is the one the
+    //  silos used to be polled in: silos in array order, then each silo's
+    //  m_pATRspTable rows followed by its m_pATRspTableExt rows. The first
+    //  row whose prefix matches wins, even when a later row is longer.
+    BOOL Build(CSilo* const* ppSilos, UINT32 nSilos);
+
+    //  Find the parser for szStr, ignoring leading spaces.
+    //  Return values:
+    //  TRUE if a prefix matched; rpSilo and rpfnParser are set and rszEnd
+    //  points past the prefix.
+    //  FALSE otherwise; rszEnd points past the leading spaces.
+    BOOL Find(const char* szStr, CSilo*& rpSilo, PFN_ATRSP_PARSE& rpfnParser,
+            const char*& rszEnd) const;
+
+    BOOL IsEmpty() const { return 0 == m_nEntries; }
+
+private:
+    //  Trie node. Children of a node form a list sorted by character.
+    struct NODE
+    {
+        char cChar;
+        INT32 iFirstChild;
+        INT32 iNextSibling;
+        INT32 iEntry;           //  Entry whose prefix ends here, or -1
+    };
+
+    struct ENTRY
+    {
+        CSilo* pSilo;
+        PFN_ATRSP_PARSE pfnParser;
+    };
+
+    void Clear();
+    BOOL AddPrefix(const char* szPrefix, CSilo* pSilo, PFN_ATRSP_PARSE pfnParser);
+    BOOL AddTable(const ATRSPTABLE* pTable, CSilo* pSilo);
+    INT32 NewNode(char cChar);
+
+    NODE* m_pNodes;
+    UINT32 m_nNodes;
+    UINT32 m_nNodesAlloc;
+
+    ENTRY* m_pEntries;
+    UINT32 m_nEntries;
+    UINT32 m_nEntriesAlloc;
+};
+
+#endif // RRIL_URC_DISPATCHER_H
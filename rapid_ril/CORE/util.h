@@ -925,15 +925,24 @@ private:
 
 public:
     BOOL            Append(const char* szIn, UINT32 nLength);
-    const char*     Data() const    { return m_szBuffer; };
-    UINT32          Size() const    { return m_uiUsed; };
-    void            Flush()         { delete[] m_szBuffer; m_szBuffer = NULL; m_uiUsed = 0; };
+    const char*     Data() const    { return m_szBuffer + m_uiHead; };
+    UINT32          Size() const    { return m_uiUsed - m_uiHead; };
+    void            Flush()
+    {
+        delete[] m_szBuffer; m_szBuffer = NULL; m_uiUsed = 0; m_uiHead = 0; m_nCapacity = 0;
+    };
+
+protected:
+    //  Drop nLength bytes from the front without moving the rest. The space is
+    //  reclaimed the next time the buffer has to grow, or once it is empty.
+    void            Consume(UINT32 nLength);
 
 private:
     static const UINT32 m_nChunkSize = 1024;
 
 protected:
     char*   m_szBuffer;
+    UINT32  m_uiHead;
     UINT32  m_uiUsed;
     UINT32  m_nCapacity;
 };
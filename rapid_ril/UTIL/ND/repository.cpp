@@ -28,6 +28,8 @@
 #include <fcntl.h>
 #include <ctype.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "types.h"
 #include "rril.h"
@@ -61,6 +63,8 @@ const char   g_szTimeoutThresholdForRetry[]    = "TimeoutThresholdForRetry";
 const char   g_szOpenPortRetries[]             = "OpenPortRetries";
 const char   g_szOpenPortInterval[]            = "OpenPortInterval";
 const char   g_szPinCacheMode[]                = "PinCacheMode";
+const char   g_szUnsolCoalesceWindow[]         = "UnsolCoalesceWindow";
+const char   g_szSignalStrengthDelta[]         = "SignalStrengthDelta";
 
 /////////////////////////////////////////////////
 
@@ -142,24 +146,11 @@ const char   g_szSilosURC[]             = "SilosURCChannel";
 const char   g_szSilosOEM[]             = "SilosOEMChannel";
 const char   g_szSilosData[]            = "SilosDataChannel";
 
-//////////////////////////////////////////////////////////////////////////
-// Structs and Enums.
-
-enum
-{
-    E_ERROR     = -1,
-    E_OK        =  0,
-    E_NOT_FOUND =  1,
-    E_EOF       =  2
-};
-
-
 //////////////////////////////////////////////////////////////////////////
 // Class-Specific Strings
 
 static const char* REPO_DIR = "/system/etc/rril/";
 static const char* REPO_FILE = "/system/etc/rril/repository.txt";
-static const char* REPO_TMP_FILE = "/system/etc/rril/repository.tmp";
 static const char* GROUP_MARKER = "Group";
 static const int   GROUP_MARKER_LEN = 5;
 
@@ -167,7 +158,8 @@ static const int   GROUP_MARKER_LEN = 5;
 //////////////////////////////////////////////////////////////////////////
 // Variable Initialization
 
-struct CRepository::CRepLock CRepository::m_stLock = {{0}, {0}, 0, 0};
+pthread_mutex_t CRepository::m_stLock;
+struct CRepository::RepCache CRepository::m_stCache;
 bool CRepository::m_bInitialized = FALSE;
 char CRepository::m_cRepoPath[MAX_MODEM_NAME_LEN];
 
@@ -175,7 +167,7 @@ char CRepository::m_cRepoPath[MAX_MODEM_NAME_LEN];
 //////////////////////////////////////////////////////////////////////////
 // CRepository Class Implementation
 
-CRepository::CRepository() : m_iFd(-1)
+CRepository::CRepository()
 {
 }
 
@@ -190,15 +182,9 @@ BOOL CRepository::Init()
     tcs_handle_t* h = NULL;
     tcs_cfg_t* cfg = NULL;
 
-    CRepository::m_stLock.iReaders = 0;
-    CRepository::m_stLock.iReadWaiters = 0;
+    memset(&m_stCache, 0, sizeof(m_stCache));
 
-    if (0 != pthread_mutex_init(&m_stLock.stLock, NULL))
-    {
-        goto Error;
-    }
-
-    if (0 != pthread_cond_init(&m_stLock.stRead, NULL))
+    if (0 != pthread_mutex_init(&m_stLock, NULL))
     {
         goto Error;
     }
@@ -230,8 +216,7 @@ Error:
     //in case tcs init/get config failed, release the mutex
     if ((m_bInitialized) && ((!h) || (!cfg)))
     {
-        pthread_mutex_destroy(&m_stLock.stLock);
-        pthread_cond_destroy(&m_stLock.stRead);
+        pthread_mutex_destroy(&m_stLock);
         m_bInitialized = FALSE;
     }
     return m_bInitialized;
@@ -241,55 +226,35 @@ BOOL CRepository::Close()
 {
     if (m_bInitialized)
     {
-        pthread_mutex_destroy(&m_stLock.stLock);
-        pthread_cond_destroy(&m_stLock.stRead);
+        pthread_mutex_lock(&m_stLock);
+        FreeCache();
+        pthread_mutex_unlock(&m_stLock);
+
+        pthread_mutex_destroy(&m_stLock);
         m_bInitialized = FALSE;
     }
 
     return TRUE;
 }
 
-BOOL CRepository::OpenRepositoryFile()
+BOOL CRepository::Read(const char* szGroup, const char* szKey, int& iRes)
 {
     BOOL fRetVal = FALSE;
+    char szBuf[MAX_INT_LEN];
 
-    m_iLine = 1;
-    m_iFd   = open(m_cRepoPath, O_RDONLY);
-
-    if (m_iFd < 0)
+    fRetVal = Read(szGroup, szKey, szBuf, MAX_INT_LEN);
+    if (fRetVal)
     {
-        //Try to open repository file using old format and update the file path
-        snprintf(m_cRepoPath, MAX_MODEM_NAME_LEN, "%s", REPO_FILE);
-        m_iFd = open(m_cRepoPath, O_RDONLY);
+        char* remaining;
 
-        if (m_iFd < 0)
-        {
-            int iErrCode = errno;
-            RIL_LOG_CRITICAL("OpenRepositoryFile()-Could not open file \"%s\" - %s\r\n",
-                m_cRepoPath, strerror(iErrCode));
-            goto Error;
-        }
+        iRes = strtol(szBuf, &remaining, 0); // 0: base used is determined by format in sequence
+        fRetVal = (szBuf != remaining);
     }
 
-    // seek to beginning of file
-    ResetFile();
-
-    fRetVal = TRUE;
-
-Error:
     return fRetVal;
 }
 
-void CRepository::CloseRepositoryFile()
-{
-    if (m_iFd >= 0)
-    {
-        close(m_iFd);
-        m_iFd = -1;
-    }
-}
-
-BOOL CRepository::Read(const char* szGroup, const char* szKey, int& iRes)
+BOOL CRepository::Read(const char* szGroup, const char* szKey, UINT32& ruiRes)
 {
     BOOL fRetVal = FALSE;
     char szBuf[MAX_INT_LEN];
@@ -299,60 +264,84 @@ BOOL CRepository::Read(const char* szGroup, const char* szKey, int& iRes)
     {
         char* remaining;
 
-        iRes = strtol(szBuf, &remaining, 0); // 0: base used is determined by format in sequence
+        ruiRes = strtoul(szBuf, &remaining, 0);
         fRetVal = (szBuf != remaining);
     }
 
     return fRetVal;
 }
 
+// Any non-zero integer value is TRUE.
+BOOL CRepository::Read(const char* szGroup, const char* szKey, BOOL& rbRes)
+{
+    int iValue = 0;
+
+    if (!Read(szGroup, szKey, iValue))
+    {
+        return FALSE;
+    }
+
+    rbRes = (0 != iValue);
+    return TRUE;
+}
+
 BOOL CRepository::Read(const char* szGroup, const char* szKey, char* szRes, int iMaxLen)
 {
-    char  szBuf[MAX_LINE_LEN];
-    char* pBuf = szBuf;
-    int   iRetVal = E_ERROR;
-    int   iRes;
+    BOOL fRetVal = FALSE;
+    const RepEntry* pEntry = NULL;
+    int iGroup;
+    UINT32 uiLen;
 
     if (!m_bInitialized)
     {
         RIL_LOG_CRITICAL("CRepository::Read() - Repository has not been initialized.\r\n");
-        goto Error;
+        return FALSE;
+    }
+
+    if (NULL == szRes || iMaxLen <= 0)
+    {
+        return FALSE;
     }
 
-    // grab lock before accessing the NVM file
-    ReaderLock();
+    pthread_mutex_lock(&m_stLock);
 
-    if (!OpenRepositoryFile())
+    if (!Refresh())
     {
         RIL_LOG_CRITICAL("CRepository::Read() - Could not open the Repository file.\r\n");
         goto Error;
     }
 
     // look for group
-    iRes = LocateGroup(szGroup);
-    if (E_OK != iRes)
+    iGroup = FindGroup(szGroup);
+    if (iGroup < 0)
     {
         RIL_LOG_INFO("CRepository::Read() - Could not locate the \"%s\" group.\r\n", szGroup);
         goto Error;
     }
 
     // look for key in group
-    iRes = LocateKey(szKey, pBuf);
-    if (E_OK != iRes)
+    pEntry = FindKey(iGroup, szKey);
+    if (NULL == pEntry)
     {
         RIL_LOG_VERBOSE("CRepository::Read() - Could not locate the \"%s\" key.\r\n", szKey);
         goto Error;
     }
 
-    // get value associated to key
-    RemoveComment(pBuf);
-    iRetVal = ExtractValue(pBuf, szRes, iMaxLen);
+    // copy value associated to key
+    uiLen = strlen(pEntry->szValue);
+    if (uiLen >= (UINT32)iMaxLen)
+    {
+        uiLen = iMaxLen - 1;
+    }
+    memcpy(szRes, pEntry->szValue, uiLen);
+    szRes[uiLen] = '\0';
+
+    fRetVal = TRUE;
 
 Error:
-    CloseRepositoryFile();
-    ReaderUnlock();
+    pthread_mutex_unlock(&m_stLock);
 
-    return (E_OK == iRetVal);
+    return fRetVal;
 }
 
 // Read Fast Dormancy parameters from repository
@@ -383,119 +372,326 @@ BOOL CRepository::ReadFDParam(const char* szGroup, const char* szKey, char* szRe
                 "FD Parameter \"%s\" not found, use NVRAM modem value.\r\n", szKey);
     }
 
-    return (E_OK);
+    return TRUE;
 }
 
-int CRepository::DumpLines(int iFd, int iFrom, int iTo)
+// Make sure the index matches the repository file, parsing the file again if
+// it changed since it was last loaded.
+BOOL CRepository::Refresh()
 {
-    int iRetVal = E_ERROR;
-
-    if (E_OK != GotoLine(iFrom))
-        goto Error;
+    BOOL fRetVal = FALSE;
+    struct stat stFile;
+    int iFd = -1;
 
-    while (m_iLine != iTo)
+    if (0 != stat(m_cRepoPath, &stFile))
     {
-        char szBuf[MAX_LINE_LEN];
-        int  iSize;
-        int  iRes;
-
-        iRes = ReadLine(szBuf, FALSE);
-        if (E_OK != iRes && E_EOF != iRes)
+        //Try to open repository file using old format and update the file path
+        snprintf(m_cRepoPath, MAX_MODEM_NAME_LEN, "%s", REPO_FILE);
+        if (0 != stat(m_cRepoPath, &stFile))
+        {
+            int iErrCode = errno;
+            RIL_LOG_CRITICAL("CRepository::Refresh() - Could not open file \"%s\" - %s\r\n",
+                m_cRepoPath, strerror(iErrCode));
             goto Error;
+        }
+    }
 
-        iSize = strlen(szBuf);
-        if (write(iFd, szBuf, iSize) != iSize)
-            goto Error;
+    if (NULL != m_stCache.pData && stFile.st_mtime == m_stCache.tMTime &&
+            stFile.st_size == m_stCache.tSize && stFile.st_ino == m_stCache.tInode)
+    {
+        // up to date
+        fRetVal = TRUE;
+        goto Error;
+    }
 
-        if (E_EOF == iRes)
-            break;
+    iFd = open(m_cRepoPath, O_RDONLY);
+    if (iFd < 0)
+    {
+        int iErrCode = errno;
+        RIL_LOG_CRITICAL("CRepository::Refresh() - Could not open file \"%s\" - %s\r\n",
+            m_cRepoPath, strerror(iErrCode));
+        goto Error;
+    }
+
+    // stat again through the descriptor, in case the file was replaced meanwhile
+    if (0 != fstat(iFd, &stFile))
+    {
+        goto Error;
     }
 
-    iRetVal = E_OK;
+    fRetVal = Load(iFd, stFile);
 
 Error:
-    return iRetVal;
+    if (iFd >= 0)
+    {
+        close(iFd);
+    }
+    return fRetVal;
 }
 
-void CRepository::ResetFile()
+// Parse the repository file into a new index, replacing the current one on
+// success.
+BOOL CRepository::Load(int iFd, const struct stat& rStat)
 {
-    lseek(m_iFd, 0, SEEK_SET);
-    m_iLine = 1;
-}
+    BOOL fRetVal = FALSE;
+    RepCache stNew;
+    UINT32 uiSize = (UINT32)rStat.st_size;
+    UINT32 uiRead = 0;
+    UINT32 uiLines = 1;
+    int iGroup = -1;
+    char* pCur;
+    char* pEnd;
+
+    memset(&stNew, 0, sizeof(stNew));
+
+    stNew.pData = new char[uiSize + 1];
+    if (NULL == stNew.pData)
+    {
+        goto Error;
+    }
 
-int CRepository::GotoLine(int iLine)
-{
-    int iRetVal = E_ERROR;
+    while (uiRead < uiSize)
+    {
+        ssize_t iRes = read(iFd, stNew.pData + uiRead, uiSize - uiRead);
+        if (iRes < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (iRes <= 0)
+        {
+            break;
+        }
+        uiRead += iRes;
+    }
+    stNew.pData[uiRead] = '\0';
+
+    for (UINT32 i = 0; i < uiRead; i++)
+    {
+        if ('\n' == stNew.pData[i] || '\r' == stNew.pData[i])
+        {
+            uiLines++;
+        }
+    }
 
-    if (iLine < m_iLine)
-        ResetFile();
+    for (stNew.uiHashSize = 16; stNew.uiHashSize < 2 * uiLines; stNew.uiHashSize *= 2);
 
-    while (m_iLine != iLine)
+    stNew.pGroups = new RepGroup[uiLines];
+    stNew.pEntries = new RepEntry[uiLines];
+    stNew.puiGroupHash = new UINT32[stNew.uiHashSize];
+    stNew.puiEntryHash = new UINT32[stNew.uiHashSize];
+    if (NULL == stNew.pGroups || NULL == stNew.pEntries || NULL == stNew.puiGroupHash ||
+            NULL == stNew.puiEntryHash)
     {
-        if (E_OK != ReadLine())
-            goto Error;
+        goto Error;
     }
+    memset(stNew.puiGroupHash, 0, stNew.uiHashSize * sizeof(UINT32));
+    memset(stNew.puiEntryHash, 0, stNew.uiHashSize * sizeof(UINT32));
 
-    iRetVal = E_OK;
+    pEnd = stNew.pData + uiRead;
+    for (pCur = stNew.pData; pCur < pEnd; )
+    {
+        // terminate the line in place
+        char* szLine = pCur;
+        for (; pCur < pEnd && '\n' != *pCur && '\r' != *pCur; ++pCur);
+        *pCur++ = '\0';
 
-Error:
-    return iRetVal;
-}
+        szLine = SkipSpace(szLine);
 
-int CRepository::ReadLine(char* szBuf, bool bRemoveCRAndLF)
-{
-    int  iRetVal = E_ERROR;
-    int  iCount = 0;
-    char cCh;
+        if (0 == strncmp(szLine, GROUP_MARKER, GROUP_MARKER_LEN))
+        {
+            RepGroup& rGroup = stNew.pGroups[stNew.uiGroups];
+            UINT32 uiBucket;
+            UINT32 uiIdx;
+
+            rGroup.szName = SkipSpace(szLine + GROUP_MARKER_LEN);
+            rGroup.uiNameLen = SkipAlphaNum((char*)rGroup.szName) - rGroup.szName;
+            rGroup.uiFirstEntry = stNew.uiEntries;
+            rGroup.uiEntries = 0;
+            rGroup.uiHashNext = 0;
+
+            // the line-by-line lookup stopped at the first group starting
+            // with the name it was given, which may be a longer name
+            rGroup.uiFirstMatch = stNew.uiGroups;
+            for (uiIdx = 0; uiIdx < stNew.uiGroups; uiIdx++)
+            {
+                if (0 == strncmp(stNew.pGroups[uiIdx].szName, rGroup.szName, rGroup.uiNameLen))
+                {
+                    rGroup.uiFirstMatch = uiIdx;
+                    break;
+                }
+            }
 
-    // TODO: limit to 256 characters
+            // only the first group of a given name is hashed
+            uiBucket = HashName(0, rGroup.szName, rGroup.uiNameLen) & (stNew.uiHashSize - 1);
+            for (uiIdx = stNew.puiGroupHash[uiBucket]; 0 != uiIdx;
+                 uiIdx = stNew.pGroups[uiIdx - 1].uiHashNext)
+            {
+                const RepGroup& rOther = stNew.pGroups[uiIdx - 1];
+                if (rOther.uiNameLen == rGroup.uiNameLen &&
+                        0 == strncmp(rOther.szName, rGroup.szName, rGroup.uiNameLen))
+                {
+                    break;
+                }
+            }
+            if (0 == uiIdx)
+            {
+                rGroup.uiHashNext = stNew.puiGroupHash[uiBucket];
+                stNew.puiGroupHash[uiBucket] = stNew.uiGroups + 1;
+            }
 
-    while(1)
-    {
-        switch(read(m_iFd, &cCh, 1))
+            iGroup = stNew.uiGroups++;
+        }
+        else if (iGroup >= 0 && isalnum(*szLine))
         {
-        case 1:
-            if (cCh == '\n' || cCh == '\r')
+            RepEntry& rEntry = stNew.pEntries[stNew.uiEntries];
+            UINT32 uiBucket;
+            UINT32 uiIdx;
+
+            rEntry.szLine = szLine;
+            rEntry.uiKeyLen = SkipAlphaNum(szLine) - szLine;
+            rEntry.uiGroup = iGroup;
+            rEntry.uiHashNext = 0;
+
+            // same as groups, for the lines of the group
+            rEntry.uiFirstMatch = stNew.uiEntries;
+            for (uiIdx = stNew.pGroups[iGroup].uiFirstEntry; uiIdx < stNew.uiEntries; uiIdx++)
             {
-                if (szBuf)
+                if (0 == strncmp(stNew.pEntries[uiIdx].szLine, rEntry.szLine, rEntry.uiKeyLen))
                 {
-                    if (!bRemoveCRAndLF)
-                        szBuf[iCount++] = cCh;
+                    rEntry.uiFirstMatch = uiIdx;
+                    break;
+                }
+            }
 
-                    szBuf[iCount] = '\0';
+            RemoveComment(szLine);
+            rEntry.szValue = ExtractValue(szLine);
+
+            // only the first line of a key in its group is hashed
+            uiBucket = HashName(iGroup + 1, szLine, rEntry.uiKeyLen) & (stNew.uiHashSize - 1);
+            for (uiIdx = stNew.puiEntryHash[uiBucket]; 0 != uiIdx;
+                 uiIdx = stNew.pEntries[uiIdx - 1].uiHashNext)
+            {
+                const RepEntry& rOther = stNew.pEntries[uiIdx - 1];
+                if (rOther.uiGroup == rEntry.uiGroup && rOther.uiKeyLen == rEntry.uiKeyLen &&
+                        0 == strncmp(rOther.szLine, rEntry.szLine, rEntry.uiKeyLen))
+                {
+                    break;
                 }
-                iRetVal = E_OK;
-                ++m_iLine;
-                goto Done;
             }
-            else if (szBuf)
+            if (0 == uiIdx)
             {
-                szBuf[iCount++] = cCh;
+                rEntry.uiHashNext = stNew.puiEntryHash[uiBucket];
+                stNew.puiEntryHash[uiBucket] = stNew.uiEntries + 1;
             }
-            break;
 
-        case 0:
-            // end of file
-            if (szBuf)
-                szBuf[iCount] = '\0';
+            stNew.pGroups[iGroup].uiEntries++;
+            stNew.uiEntries++;
+        }
+    }
+
+    stNew.tMTime = rStat.st_mtime;
+    stNew.tSize = rStat.st_size;
+    stNew.tInode = rStat.st_ino;
+
+    RIL_LOG_INFO("CRepository::Load() - Loaded \"%s\": %u groups, %u keys\r\n", m_cRepoPath,
+            stNew.uiGroups, stNew.uiEntries);
+
+    FreeCache();
+    m_stCache = stNew;
+    memset(&stNew, 0, sizeof(stNew));
+    fRetVal = TRUE;
+
+Error:
+    if (!fRetVal)
+    {
+        RIL_LOG_CRITICAL("CRepository::Load() - Cannot allocate memory for the index\r\n");
+    }
+    delete[] stNew.pData;
+    delete[] stNew.pGroups;
+    delete[] stNew.pEntries;
+    delete[] stNew.puiGroupHash;
+    delete[] stNew.puiEntryHash;
+    return fRetVal;
+}
+
+void CRepository::FreeCache()
+{
+    delete[] m_stCache.pData;
+    delete[] m_stCache.pGroups;
+    delete[] m_stCache.pEntries;
+    delete[] m_stCache.puiGroupHash;
+    delete[] m_stCache.puiEntryHash;
+    memset(&m_stCache, 0, sizeof(m_stCache));
+}
+
+// Return the index of the first group whose name starts with szGroup, as the
+// line-by-line lookup did, or -1 if not found. The hash finds names used in
+// full; a partial name is looked for in every group.
+int CRepository::FindGroup(const char* szGroup)
+{
+    UINT32 uiLen = strlen(szGroup);
+    UINT32 uiIdx = m_stCache.puiGroupHash[HashName(0, szGroup, uiLen) &
+            (m_stCache.uiHashSize - 1)];
+
+    for (; 0 != uiIdx; uiIdx = m_stCache.pGroups[uiIdx - 1].uiHashNext)
+    {
+        const RepGroup& rGroup = m_stCache.pGroups[uiIdx - 1];
+        if (rGroup.uiNameLen == uiLen && 0 == strncmp(rGroup.szName, szGroup, uiLen))
+        {
+            return rGroup.uiFirstMatch;
+        }
+    }
+
+    for (UINT32 i = 0; i < m_stCache.uiGroups; i++)
+    {
+        if (0 == strncmp(m_stCache.pGroups[i].szName, szGroup, uiLen))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
 
-            iRetVal = E_EOF;
-            goto Done;
-            break;  // unreachable
+// Same as FindGroup(), for a key within a group.
+const CRepository::RepEntry* CRepository::FindKey(int iGroup, const char* szKey)
+{
+    const RepGroup& rGroup = m_stCache.pGroups[iGroup];
+    UINT32 uiLen = strlen(szKey);
+    UINT32 uiIdx = m_stCache.puiEntryHash[HashName(iGroup + 1, szKey, uiLen) &
+            (m_stCache.uiHashSize - 1)];
 
-        default:
-            // error
-            if (szBuf)
-                szBuf[iCount] = '\0';
+    for (; 0 != uiIdx; uiIdx = m_stCache.pEntries[uiIdx - 1].uiHashNext)
+    {
+        const RepEntry& rEntry = m_stCache.pEntries[uiIdx - 1];
+        if ((int)rEntry.uiGroup == iGroup && rEntry.uiKeyLen == uiLen &&
+                0 == strncmp(rEntry.szLine, szKey, uiLen))
+        {
+            return &m_stCache.pEntries[rEntry.uiFirstMatch];
+        }
+    }
 
-            iRetVal = E_ERROR;
-            goto Done;
-            break;  // unreachable
+    for (UINT32 i = rGroup.uiFirstEntry; i < rGroup.uiFirstEntry + rGroup.uiEntries; i++)
+    {
+        if (0 == strncmp(m_stCache.pEntries[i].szLine, szKey, uiLen))
+        {
+            return &m_stCache.pEntries[i];
         }
     }
 
-Done:
-    return iRetVal;
+    return NULL;
+}
+
+// FNV-1a, seeded with the group index for keys
+UINT32 CRepository::HashName(UINT32 uiSeed, const char* szName, UINT32 uiLen)
+{
+    UINT32 uiHash = 2166136261u ^ uiSeed;
+
+    for (UINT32 i = 0; i < uiLen; i++)
+    {
+        uiHash = (uiHash ^ (BYTE)szName[i]) * 16777619u;
+    }
+    return uiHash;
 }
 
 
@@ -552,103 +748,8 @@ char* CRepository::SkipAlphaNum(char* szIn)
     return szIn;
 }
 
-int CRepository::LocateGroup(const char* szGroup)
-{
-    char  szBuf[MAX_LINE_LEN];
-    char* pBuf;
-    int   iCount = 0;
-    int   iRetVal = E_ERROR;
-
-    while (1)
-    {
-        int iRes = ReadLine(szBuf);
-        switch(iRes)
-        {
-            case E_OK:
-            case E_EOF:
-                pBuf= SkipSpace(szBuf);
-                if (strncmp(pBuf, GROUP_MARKER, GROUP_MARKER_LEN) == 0)
-                {
-                    // is this our group?
-                    pBuf += GROUP_MARKER_LEN;
-                    pBuf = SkipSpace(pBuf);
-                    if (strncmp(pBuf, szGroup, strlen(szGroup)) == 0)
-                    {
-                        // group found
-                        iRetVal = E_OK;
-                        goto Done;
-                    }
-                }
-                if (E_EOF == iRes)
-                {
-                    iRetVal = E_NOT_FOUND;
-                    goto Done;
-                }
-                break;
-
-            default:
-                iRetVal = E_ERROR;
-                goto Done;
-                break;  // unreachable
-        }
-    }
-
-Done:
-    return iRetVal;
-}
-
-
-int CRepository::LocateKey(const char* szKey, char* szOut)
-{
-    char  szBuf[MAX_LINE_LEN];
-    char* pBuf;
-    int   iRetVal = E_ERROR;
-    int   iKeyLen = strlen(szKey);
-
-    while (1)
-    {
-        int iRes = ReadLine(szBuf);
-        switch(iRes)
-        {
-            case E_OK:
-            case E_EOF:
-                pBuf= SkipSpace(szBuf);
-                if (strncmp(pBuf, szKey, iKeyLen) == 0)
-                {
-                    if (szOut)
-                    {
-                        strcpy(szOut, szBuf);
-                    }
-
-                    iRetVal = E_OK;
-                    goto Done;
-                }
-                else if (strncmp(pBuf, GROUP_MARKER, GROUP_MARKER_LEN) == 0)
-                {
-                    // into next group
-                    iRetVal = E_NOT_FOUND;
-                    goto Done;
-                }
-
-                if (E_EOF == iRes)
-                {
-                    iRetVal = E_NOT_FOUND;
-                    goto Done;
-                }
-                break;
-
-            default:
-                iRetVal = E_ERROR;
-                goto Done;
-                break;  // unreachable
-        }
-    }
-
-Done:
-    return iRetVal;
-}
-
-int CRepository::ExtractValue(char* szIn, char* szRes, UINT32 iMaxLen)
+// Return the value part of a key line, with trailing spaces removed in place.
+char* CRepository::ExtractValue(char* szIn)
 {
     // skip key
     szIn = SkipSpace(szIn);
@@ -656,45 +757,5 @@ int CRepository::ExtractValue(char* szIn, char* szRes, UINT32 iMaxLen)
     szIn = SkipSpace(szIn);
     RemoveTrailingSpaces(szIn);
 
-    // copy value
-    if (strlen(szIn) >= iMaxLen)
-    {
-        strncpy(szRes, szIn, iMaxLen - 1);
-        szRes[iMaxLen - 1] = '\0';
-    }
-    else
-    {
-        strcpy(szRes, szIn);
-    }
-
-    return E_OK;
-}
-
-int CRepository::ReaderLock()
-{
-    int iRetVal = E_ERROR;
-
-    if (0 == pthread_mutex_lock(&m_stLock.stLock))
-    {
-        ++m_stLock.iReaders;
-        iRetVal = (pthread_mutex_unlock(&m_stLock.stLock) == 0) ? E_OK : E_ERROR;
-    }
-
-Error:
-    return iRetVal;
-}
-
-int CRepository::ReaderUnlock()
-{
-    int iRetVal = E_ERROR;
-
-    if (0 != pthread_mutex_lock(&m_stLock.stLock))
-        goto Error;
-
-    --m_stLock.iReaders;
-    iRetVal = (pthread_mutex_unlock(&m_stLock.stLock) == 0) ? E_OK : E_ERROR;
-
-Error:
-    return iRetVal;
+    return szIn;
 }
-
@@ -220,7 +220,7 @@ int ucs2_to_utf8(const unsigned char* ucs2, int ucs2len, unsigned char* buf)
 }
 
 
-CSelfExpandBuffer::CSelfExpandBuffer() : m_szBuffer(NULL), m_uiUsed(0), m_nCapacity(0)
+CSelfExpandBuffer::CSelfExpandBuffer() : m_szBuffer(NULL), m_uiHead(0), m_uiUsed(0), m_nCapacity(0)
 {
 }
 
@@ -248,18 +248,23 @@ BOOL CSelfExpandBuffer::Append(const char* szIn, UINT32 nLength)
             m_nCapacity = m_nChunkSize;
         }
 
-        for (nNewSize = m_nCapacity; (nNewSize - m_uiUsed) <= nLength; nNewSize += m_nChunkSize);
-        if (nNewSize != m_nCapacity)
+        if ((m_nCapacity - m_uiUsed) <= nLength)
         {
-            // allocate more space for the data
+            // allocate more space for the data; consumed bytes are not carried over
+            UINT32 uiLive = m_uiUsed - m_uiHead;
+            for (nNewSize = m_nChunkSize; nNewSize <= uiLive + nLength;
+                    nNewSize += m_nChunkSize);
+
             char* tmp = new char[nNewSize];
             if (NULL == tmp)
                 goto Error;
 
-            memcpy(tmp, m_szBuffer, m_uiUsed);
+            memcpy(tmp, m_szBuffer + m_uiHead, uiLive);
             delete[] m_szBuffer;
             m_szBuffer = tmp;
             m_nCapacity = nNewSize;
+            m_uiHead = 0;
+            m_uiUsed = uiLive;
         }
         memcpy(m_szBuffer + m_uiUsed, szIn, nLength);
         m_uiUsed += nLength;
@@ -272,6 +277,23 @@ Error:
     return bRet;
 }
 
+void CSelfExpandBuffer::Consume(UINT32 nLength)
+{
+    if (nLength >= m_uiUsed - m_uiHead)
+    {
+        m_uiHead = 0;
+        m_uiUsed = 0;
+        if (m_szBuffer)
+        {
+            m_szBuffer[0] = '\0';
+        }
+    }
+    else
+    {
+        m_uiHead += nLength;
+    }
+}
+
 BOOL CopyStringNullTerminate(char* const pszOut, const char* pszIn, const UINT32 cbOut)
 {
     BOOL fRet = TRUE;
@@ -384,29 +406,30 @@ CRLFExpandedString::CRLFExpandedString(const char* const pszIn, const int nInLen
     {
         return;
     }
-    memset(m_pszString, 0, nNewLen);
-
+    // Append at a running end; strncat() would rescan the string for each character
+    pszNewString = m_pszString;
     for (int nWalk = 0; nWalk < nInLen; nWalk++)
     {
         if (0x0A == pszIn[nWalk])
         {
-            strncat(m_pszString, "<lf>", nNewLen - strlen(m_pszString) - 1);
+            memcpy(pszNewString, "<lf>", 4);
+            pszNewString += 4;
         }
         else if (0x0D == pszIn[nWalk])
         {
-            strncat(m_pszString, "<cr>", nNewLen - strlen(m_pszString) - 1);
+            memcpy(pszNewString, "<cr>", 4);
+            pszNewString += 4;
         }
         else if ((pszIn[nWalk] >= 0x20) && (pszIn[nWalk] <= 0x7E))
         {
-            strncat(m_pszString, &pszIn[nWalk], 1);
+            *pszNewString++ = pszIn[nWalk];
         }
         else
         {
-            char szTmp[5] = {0};
-            snprintf(szTmp, 5, "[%02X]", pszIn[nWalk]);
-            strncat(m_pszString, szTmp, nNewLen - strlen(m_pszString) - 1);
+            pszNewString += snprintf(pszNewString, 5, "[%02X]", (BYTE)pszIn[nWalk]);
         }
     }
+    *pszNewString = '\0';
 }
 
 CRLFExpandedString::~CRLFExpandedString()
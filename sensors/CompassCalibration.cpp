@@ -20,14 +20,47 @@ typedef struct {
     double bfield;
 } CompassCalData;
 
-typedef mat<double, 3, DS_SIZE> mat_input_t;
+/* Recursive least squares fit of the ellipsoid
+ *     x^2 = p0 x + p1 y + p2 z - p3 xy - p4 xz - p5 yz - p6 y^2 - p7 z^2 + p8
+ * one accepted sample at a time, in place of a batch fit every DS_SIZE
+ * samples. Samples are scaled by FIELD_SCALE so that the regressors are
+ * close to 1. The forgetting factor gives the fit a memory of about
+ * DS_SIZE samples; it is not applied while the covariance is already
+ * large, so that it can't blow up when the device doesn't move. */
+#define NUM_PARAMS 9
+#define FIELD_SCALE 64.0
+#define FORGET (1.0 - 1.0 / DS_SIZE)
+#define P_INIT 100.0
+#define P_MAX_TRACE (NUM_PARAMS * P_INIT)
+#define FIT_INTERVAL 8
+#define ERR_WEIGHT (1.0 / 16)
+
+typedef struct {
+    double param[NUM_PARAMS];
+    double P[NUM_PARAMS][NUM_PARAMS];
+    int count;
+} RlsState;
 
 #define MIN_DIFF 1.5f
 #define MAX_SQR_ERR 2.0f
 #define LOOKBACK_COUNT 6
 
-static float select_points[DS_SIZE][3];
-static int select_point_count = 0;
+static float lookback_points[LOOKBACK_COUNT][3];
+static int lookback_count = 0;
+static int lookback_index = 0;
+
+static RlsState rls;
+
+/* Every FIT_INTERVAL samples the parameters give a candidate calibration,
+ * which replaces cal_data if its squared field error on the next
+ * FIT_INTERVAL samples is lower. cal_err is a moving average of the error
+ * of cal_data, -1 until measured; it gives the accuracy. */
+static CompassCalData new_cal_data;
+static int new_caled = 0;
+static int new_err_count = 0;
+static double new_err = 0;
+static double cal_err = -1;
+static int fit_count = 0;
 
 #ifdef DBG_RAW_DATA
 #define MAX_RAW_DATA_COUNT 2000
@@ -111,45 +144,26 @@ calc_evector(const mat<double, 3, 3> &A, double eig)
     return evector;
 }
 
-bool ellipsoid_fit(const mat_input_t &M, mat<double, 1, 3> &offset,
-    mat<double, 3, 3> &w_invert, double &bfield)
+/* hard and soft iron from the ellipsoid parameters, the same way as the
+ * batch fit did; false if they don't describe an ellipsoid */
+static bool ellipsoid_from_params(const double P[NUM_PARAMS],
+    mat<double, 1, 3> &offset, mat<double, 3, 3> &w_invert, double &bfield)
 {
-    int i, j;
-    mat<double, 9, DS_SIZE> H;
-    mat<double, 1, DS_SIZE> W;
-
-    for (i = 0; i < DS_SIZE; ++i) {
-        W[0][i] = M[0][i] * M[0][i];
-        H[0][i] = M[0][i];
-        H[1][i] = M[1][i];
-        H[2][i] = M[2][i];
-        H[3][i] = -1 * M[0][i] * M[1][i];
-        H[4][i] = -1 * M[0][i] * M[2][i];
-        H[5][i] = -1 * M[1][i] * M[2][i];
-        H[6][i] = -1 * M[1][i] * M[1][i];
-        H[7][i] = -1 * M[2][i] * M[2][i];
-        H[8][i] = 1;
-    }
-
-    mat<double, DS_SIZE, 9> H_trans = transpose(H);
-    mat<double, 9, 9> P_temp1 = invert(H_trans * H);
-    mat<double, DS_SIZE, 9> P_temp2 = P_temp1 * H_trans;
-    mat<double, 1, 9> P = P_temp2 * W;
     mat<double, 3, 3> temp1;
     temp1[0][0] = 2;
-    temp1[1][0] = P[0][3];
-    temp1[2][0] = P[0][4];
-    temp1[0][1] = P[0][3];
-    temp1[1][1] = 2 * P[0][6];
-    temp1[2][1] = P[0][5];
-    temp1[0][2] = P[0][4];
-    temp1[1][2] = P[0][5];
-    temp1[2][2] = 2 * P[0][7];
+    temp1[1][0] = P[3];
+    temp1[2][0] = P[4];
+    temp1[0][1] = P[3];
+    temp1[1][1] = 2 * P[6];
+    temp1[2][1] = P[5];
+    temp1[0][2] = P[4];
+    temp1[1][2] = P[5];
+    temp1[2][2] = 2 * P[7];
 
     mat<double, 1, 3> temp2;
-    temp2[0][0] = P[0][0];
-    temp2[0][1] = P[0][1];
-    temp2[0][2] = P[0][2];
+    temp2[0][0] = P[0];
+    temp2[0][1] = P[1];
+    temp2[0][2] = P[2];
 
     offset = invert(temp1) * temp2;
     double off_x = offset[0][0];
@@ -157,21 +171,23 @@ bool ellipsoid_fit(const mat_input_t &M, mat<double, 1, 3> &offset,
     double off_z = offset[0][2];
 
     mat<double, 3, 3> A;
-    A[0][0] = 1.0 / (P[0][8] + off_x * off_x + P[0][6] * off_y * off_y
-            + P[0][7] * off_z * off_z + P[0][3] * off_x * off_y
-            + P[0][4] * off_x * off_z + P[0][5] * off_y * off_z);
-
-    A[1][0] = P[0][3] * A[0][0] / 2;
-    A[2][0] = P[0][4] * A[0][0] / 2;
-    A[2][1] = P[0][5] * A[0][0] / 2;
-    A[1][1] = P[0][6] * A[0][0];
-    A[2][2] = P[0][7] * A[0][0];
+    A[0][0] = 1.0 / (P[8] + off_x * off_x + P[6] * off_y * off_y
+            + P[7] * off_z * off_z + P[3] * off_x * off_y
+            + P[4] * off_x * off_z + P[5] * off_y * off_z);
+
+    A[1][0] = P[3] * A[0][0] / 2;
+    A[2][0] = P[4] * A[0][0] / 2;
+    A[2][1] = P[5] * A[0][0] / 2;
+    A[1][1] = P[6] * A[0][0];
+    A[2][2] = P[7] * A[0][0];
     A[1][2] = A[2][1];
     A[0][1] = A[1][0];
     A[0][2] = A[2][0];
 
     double eig1, eig2, eig3;
     compute_eigenvalues(A, eig1, eig2, eig3);
+    if (!(eig1 > EPSILON && eig2 > EPSILON && eig3 > EPSILON))
+        return false;
 
     mat<double, 3, 3> sqrt_evals;
     sqrt_evals[0][0] = sqrt(eig1);
@@ -191,16 +207,89 @@ bool ellipsoid_fit(const mat_input_t &M, mat<double, 1, 3> &offset,
     bfield = pow(sqrt(1/eig1) * sqrt(1/eig2) * sqrt(1/eig3), 1.0/3.0);
     w_invert = w_invert * bfield;
 
-    return true;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            if (isnan(w_invert[i][j]))
+                return false;
+
+    return !isnan(bfield);
 }
 
 /* reset calibration algorithm */
 static void reset()
 {
-    select_point_count = 0;
-    for (int i = 0; i < DS_SIZE; ++i)
-        for (int j=0; j < 3; ++j)
-            select_points[i][j] = 0;
+    lookback_count = 0;
+    lookback_index = 0;
+
+    memset(&rls, 0, sizeof(rls));
+    for (int i = 0; i < NUM_PARAMS; ++i)
+        rls.P[i][i] = P_INIT;
+
+    new_caled = 0;
+    new_err_count = 0;
+    new_err = 0;
+    fit_count = 0;
+}
+
+/* one RLS step with the sample x, y, z already scaled; O(1) in time and
+ * memory, P is kept symmetric by updating its upper half only */
+static void rls_update(double x, double y, double z)
+{
+    double h[NUM_PARAMS] = {x, y, z, -x * y, -x * z, -y * z, -y * y, -z * z, 1};
+    double Ph[NUM_PARAMS], k[NUM_PARAMS];
+    double denom = 0, predict = 0, trace = 0, forget;
+    int i, j;
+
+    for (i = 0; i < NUM_PARAMS; ++i) {
+        Ph[i] = 0;
+        for (j = 0; j < NUM_PARAMS; ++j)
+            Ph[i] += rls.P[i][j] * h[j];
+        denom += h[i] * Ph[i];
+        predict += h[i] * rls.param[i];
+        trace += rls.P[i][i];
+    }
+    forget = trace < P_MAX_TRACE ? FORGET : 1.0;
+    denom += forget;
+
+    // P lost its positive definiteness: start over rather than diverge
+    if (!(denom > EPSILON) || isnan(denom)) {
+        E("CompassCalibration: RLS covariance degenerated, reset");
+        reset();
+        return;
+    }
+
+    for (i = 0; i < NUM_PARAMS; ++i) {
+        k[i] = Ph[i] / denom;
+        rls.param[i] += k[i] * (x * x - predict);
+    }
+
+    for (i = 0; i < NUM_PARAMS; ++i)
+        for (j = i; j < NUM_PARAMS; ++j)
+            rls.P[j][i] = rls.P[i][j] = (rls.P[i][j] - k[i] * Ph[j]) / forget;
+
+    rls.count++;
+}
+
+// squared error of the calibrated field strength for one sample
+static double field_err(const CompassCalData &data, const float raw_data[3])
+{
+    mat<double, 1, 3> raw, result;
+    raw[0][0] = raw_data[0];
+    raw[0][1] = raw_data[1];
+    raw[0][2] = raw_data[2];
+    result = data.w_invert * (raw - data.offset);
+    double diff = sqrt(result[0][0] * result[0][0] + result[0][1] * result[0][1]
+        + result[0][2] * result[0][2]) - data.bfield;
+    return diff * diff;
+}
+
+// moving average of the error of the calibration in use
+static void update_cal_err(double sample_err)
+{
+    if (cal_err < 0)
+        cal_err = sample_err;
+    else
+        cal_err += (sample_err - cal_err) * ERR_WEIGHT;
 }
 
 void CompassCal_init(FILE *calDataFile)
@@ -229,6 +318,7 @@ void CompassCal_init(FILE *calDataFile)
     reset();
 
     g_caled = 0;
+    cal_err = -1;
     double x, y, z, w11, w12, w13, w21, w22, w23, w31, w32, w33, bfield;
     if (calDataFile != NULL) {
         int ret = fscanf(calDataFile, "%d %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
@@ -315,91 +405,91 @@ int CompassCal_collectData(float rawMagX, float rawMagY, float rawMagZ, long cur
 
     // For the current point to be accepted, each x/y/z value must be different enough
     // to the last several collected points
-    if (select_point_count > 0 && select_point_count < DS_SIZE) {
-        int lookback = LOOKBACK_COUNT < select_point_count ? LOOKBACK_COUNT : select_point_count;
-        for (int index = 0; index < lookback; ++index){
-            for (int j = 0; j < 3; ++j) {
-                if (fabsf(data[j] - select_points[select_point_count-1-index][j]) < MIN_DIFF) {
-                    D("CompassCalibration:point reject: [%f,%f,%f], selected_count=%d",
-                       (double)data[0], (double)data[1], (double)data[2], select_point_count);
-                        return 0;
-                }
+    for (int index = 0; index < lookback_count; ++index) {
+        for (int j = 0; j < 3; ++j) {
+            if (fabsf(data[j] - lookback_points[index][j]) < MIN_DIFF) {
+                D("CompassCalibration:point reject: [%f,%f,%f], count=%d",
+                   (double)data[0], (double)data[1], (double)data[2], rls.count);
+                return 0;
             }
         }
     }
 
-    if (select_point_count < DS_SIZE) {
-        memcpy(select_points[select_point_count], data, sizeof(float) * 3);
-        ++select_point_count;
-        D("CompassCalibration:point collected [%f,%f,%f], selected_count=%d",
-            (double)data[0], (double)data[1], (double)data[2], select_point_count);
-#ifdef DBG_RAW_DATA
-        if (raw_data_selected) {
-            fprintf(raw_data_selected, "%f %f %f\n", (double)data[0], (double)data[1], (double)data[2]);
-        }
-#endif
+    memcpy(lookback_points[lookback_index], data, sizeof(float) * 3);
+    lookback_index = (lookback_index + 1) % LOOKBACK_COUNT;
+    if (lookback_count < LOOKBACK_COUNT)
+        ++lookback_count;
+
+    // errors of both fits are measured on samples they were not fitted on
+    if (g_caled)
+        update_cal_err(field_err(cal_data, data));
+    if (new_caled) {
+        new_err += field_err(new_cal_data, data);
+        ++new_err_count;
     }
-   return 1;
-}
-
 
-// use second data set to calculate square error
-double calc_square_err(const CompassCalData &data)
-{
-    double err = 0;
-    mat<double, 1, 3> raw, result;
-    for (int i = 0; i < DS_SIZE; ++i) {
-        raw[0][0] = select_points[i][0];
-        raw[0][1] = select_points[i][1];
-        raw[0][2] = select_points[i][2];
-        result = data.w_invert * (raw - data.offset);
-         double diff = sqrt(result[0][0] * result[0][0] + result[0][1] * result[0][1]
-             + result[0][2] * result[0][2]) - data.bfield;
-         err += diff * diff;
+    rls_update(data[0] / FIELD_SCALE, data[1] / FIELD_SCALE, data[2] / FIELD_SCALE);
+    D("CompassCalibration:point collected [%f,%f,%f], count=%d",
+        (double)data[0], (double)data[1], (double)data[2], rls.count);
+#ifdef DBG_RAW_DATA
+    if (raw_data_selected) {
+        fprintf(raw_data_selected, "%f %f %f\n", (double)data[0], (double)data[1], (double)data[2]);
     }
-    err /= DS_SIZE;
-    return err;
+#endif
+   return 1;
 }
 
 /* check if calibration complete */
 int CompassCal_readyCheck()
 {
-    mat_input_t mat;
-
-    if (select_point_count < DS_SIZE)
+    if (rls.count < DS_SIZE || rls.count < fit_count + FIT_INTERVAL)
         return g_caled;
 
-    // enough points have been collected, do the ellipsoid calibration
-    for (int i = 0; i < DS_SIZE; ++i) {
-        mat[0][i] = select_points[i][0];
-        mat[1][i] = select_points[i][1];
-        mat[2][i] = select_points[i][2];
+    // the candidate has been checked on the samples that came after it
+    if (new_caled && new_err_count > 0) {
+        double err_new = new_err / new_err_count;
+        if (err_new < MAX_SQR_ERR && (!g_caled || err_new < cal_err)) {
+            // new cal_data is better, so we switch to the new
+            cal_data = new_cal_data;
+            cal_err = err_new;
+            g_caled = 1;
+            D("CompassCalibration: ready check success, caldata: %f %f %f %f %f %f %f %f %f %f %f %f %f, err %f",
+              cal_data.offset[0][0], cal_data.offset[0][1], cal_data.offset[0][2], cal_data.w_invert[0][0],
+              cal_data.w_invert[1][0], cal_data.w_invert[2][0], cal_data.w_invert[0][1],cal_data.w_invert[1][1],
+              cal_data.w_invert[2][1], cal_data.w_invert[0][2], cal_data.w_invert[1][2], cal_data.w_invert[2][2],
+              cal_data.bfield, err_new);
+        }
     }
 
-    /* check if result is good */
-    CompassCalData new_cal_data;
-    if (ellipsoid_fit(mat, new_cal_data.offset,
-                      new_cal_data.w_invert, new_cal_data.bfield)) {
-        double err_new = calc_square_err(new_cal_data);
-        if (err_new < MAX_SQR_ERR) {
-            double err = calc_square_err(cal_data);
-            if (err_new < err) {
-              // new cal_data is better, so we switch to the new
-              cal_data = new_cal_data;
-              g_caled = 1;
-              D("CompassCalibration: ready check success, caldata: %f %f %f %f %f %f %f %f %f %f %f %f %f, err %f",
-                cal_data.offset[0][0], cal_data.offset[0][1], cal_data.offset[0][2], cal_data.w_invert[0][0],
-                cal_data.w_invert[1][0], cal_data.w_invert[2][0], cal_data.w_invert[0][1],cal_data.w_invert[1][1],
-                cal_data.w_invert[2][1], cal_data.w_invert[0][2], cal_data.w_invert[1][2], cal_data.w_invert[2][2],
-                cal_data.bfield, err_new);
-            }
-        }
+    // next candidate from the current parameters, in a constant time
+    CompassCalData fit;
+    new_caled = ellipsoid_from_params(rls.param, fit.offset, fit.w_invert, fit.bfield);
+    if (new_caled) {
+        // the parameters are fitted on scaled samples
+        new_cal_data.offset = fit.offset * FIELD_SCALE;
+        new_cal_data.w_invert = fit.w_invert;
+        new_cal_data.bfield = fit.bfield * FIELD_SCALE;
     }
+    new_err = 0;
+    new_err_count = 0;
+    fit_count = rls.count;
 
-    reset();
     return g_caled;
 }
 
+int CompassCal_getAccuracy()
+{
+    if (!g_caled)
+        return SENSOR_STATUS_ACCURACY_LOW;
+
+    // not measured yet after loading it, trust the stored calibration
+    if (cal_err < 0 || cal_err < MAX_SQR_ERR / 4)
+        return SENSOR_STATUS_ACCURACY_HIGH;
+
+    return cal_err < MAX_SQR_ERR ? SENSOR_STATUS_ACCURACY_MEDIUM
+                                 : SENSOR_STATUS_ACCURACY_LOW;
+}
+
 void CompassCal_computeCal(float rawX, float rawY, float rawZ,
                 float *resultX, float *resultY, float *resultZ)
 {
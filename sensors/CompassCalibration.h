@@ -30,13 +30,20 @@ int CompassCal_collectData(float rawMagX, float rawMagY, float rawMagZ,
 
 /* CompassCal_readyCheck
  * Check if enough raw data has been collected
- * to generate a calibration result.
+ * to generate a calibration result. Every call
+ * takes a short, constant time.
  *
  * Return 1 if enough raw data has been collected
  * otherwise return 0.
  */
 int CompassCal_readyCheck();
 
+/* CompassCal_getAccuracy
+ * Return how well the current calibration fits the
+ * latest raw data, as a SENSOR_STATUS_ACCURACY_* value.
+ */
+int CompassCal_getAccuracy();
+
 /* CompassCal_computeCal
  * Calibrate the raw compass data with current
  * calibration determinants and output the calibrated
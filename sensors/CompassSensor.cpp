@@ -251,7 +251,7 @@ void CompassSensor::calibration(int64_t time)
         mMagneticEvent.magnetic.y, mMagneticEvent.magnetic.z,
         &mMagneticEvent.magnetic.x, &mMagneticEvent.magnetic.y,
         &mMagneticEvent.magnetic.z);
-        mMagneticEvent.magnetic.status = SENSOR_STATUS_ACCURACY_HIGH;
+        mMagneticEvent.magnetic.status = CompassCal_getAccuracy();
     } else {
         mMagneticEvent.magnetic.status = SENSOR_STATUS_ACCURACY_LOW;
     }
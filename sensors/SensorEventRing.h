@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SENSOR_EVENT_RING_H
+#define ANDROID_SENSOR_EVENT_RING_H
+
+#include "sensors.h"
+
+/* Events of one sensor, written by its reader thread and read by the poll
+ * thread. There is a single writer and a single reader, so no lock is
+ * taken: mHead is only moved by the writer, mTail only by the reader. */
+class SensorEventRing
+{
+public:
+    enum { CAPACITY = 256 };    /* power of two */
+
+    SensorEventRing() : mHead(0), mTail(0), mDropped(0) { }
+
+    /* writer side: return 1 if the reader had read everything before and
+     * must be woken up, 0 if not, -1 if the ring is full and the event
+     * dropped */
+    int push(const sensors_event_t& event, int64_t arrival)
+    {
+        uint32_t head = mHead;
+
+        if (head - mTail >= CAPACITY) {
+            mDropped++;
+            return -1;
+        }
+
+        Entry& entry = mEntries[head & (CAPACITY - 1)];
+        entry.event = event;
+        entry.arrival = arrival;
+
+        /* the entry is visible before the new head, the new head before
+         * mTail is read again; pairs with pop() */
+        __sync_synchronize();
+        mHead = head + 1;
+        __sync_synchronize();
+
+        return mTail == head;
+    }
+
+    /* reader side: front() and arrival() are valid while size() > 0 */
+    uint32_t size() const
+    {
+        uint32_t n = mHead - mTail;
+
+        __sync_synchronize();
+        return n;
+    }
+
+    const sensors_event_t& front() const
+    {
+        return mEntries[mTail & (CAPACITY - 1)].event;
+    }
+
+    /* when the event was read from the driver, CLOCK_MONOTONIC */
+    int64_t arrival() const
+    {
+        return mEntries[mTail & (CAPACITY - 1)].arrival;
+    }
+
+    void pop()
+    {
+        __sync_synchronize();
+        mTail = mTail + 1;
+        __sync_synchronize();
+    }
+
+    uint32_t dropped() const
+    {
+        return mDropped;
+    }
+
+private:
+    struct Entry {
+        sensors_event_t event;
+        int64_t arrival;
+    };
+
+    Entry mEntries[CAPACITY];
+    volatile uint32_t mHead;
+    volatile uint32_t mTail;
+    volatile uint32_t mDropped;
+};
+
+#endif  // ANDROID_SENSOR_EVENT_RING_H
@@ -4,7 +4,7 @@ ifeq ($(USE_GENERAL_SENSOR_DRIVER),true)
 LOCAL_PATH := $(call my-dir)
 
 include $(CLEAR_VARS)
-LOCAL_SRC_FILES := sensor_parser.c
+LOCAL_SRC_FILES := sensor_parser.c sensor_action_vm.c
 LOCAL_C_INCLUDES +=  $(COMMON_INCLUDES) \
                 $(call include-path-for, icu4c-common) \
                 $(call include-path-for, libxml2)
@@ -15,6 +15,14 @@ LOCAL_SHARED_LIBRARIES := libicuuc-host
 LOCAL_MODULE := sensor_parser
 include $(BUILD_HOST_EXECUTABLE)
 
+#bytecode vm against the reference walk of lowlevel actions
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := sensor_action_bench.c sensor_action_vm.c
+LOCAL_CFLAGS += -O2 -Wall
+LOCAL_MODULE := sensor_action_bench
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
+
 #XML driver config for each platform
 SENSOR_DRIVER_XML := $(DEVICE_CONF_PATH)/sensors/sensor_driver_config.xml
 
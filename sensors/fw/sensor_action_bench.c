@@ -0,0 +1,652 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Runs the lowlevel actions of sensor configs with the bytecode vm and
+ * with a reference interpreter walking the actions as the driver does,
+ * checks both give the same results and i2c accesses, and reports the
+ * time per run and the size of the programs.
+ *
+ * Without -f, programs of a lis3dh like accelerometer are used.
+ *
+ * usage: sensor_action_bench [-n loops] [-f sensor_config.bin] [-d]
+ */
+
+#define _LARGEFILE64_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <linux/types.h>
+#include "sensor_driver_config.h"
+#include "sensor_action_vm.h"
+
+#define MAX_PROGRAMS		0x100
+#define DEFAULT_LOOPS		100000
+
+struct program {
+	char name[48];
+	const struct lowlevel_action *actions;
+	int num;
+	int entry;
+	/*sysfs store and range setting take an input*/
+	int has_input;
+};
+
+static struct program programs[MAX_PROGRAMS];
+static int num_programs;
+static struct sensor_vm_prog vm_prog;
+
+/*fake i2c device, every access is hashed to compare the two runs*/
+struct fake_i2c {
+	__u8 regs[VM_REGBUF_SIZE];
+	__u32 hash;
+	int accesses;
+};
+
+static void trace(struct fake_i2c *i2c, int v)
+{
+	i2c->hash = (i2c->hash ^ (__u32)v) * 16777619u;
+	i2c->accesses++;
+}
+
+static int fake_read(void *data, __u8 addr, __u8 flag, __u8 *buf, int len)
+{
+	struct fake_i2c *i2c = data;
+
+	trace(i2c, addr | flag << 8 | len << 16);
+	memcpy(buf, &i2c->regs[addr], len);
+	return 0;
+}
+
+static int fake_write(void *data, __u8 addr, __u8 flag, __u8 *buf, int len)
+{
+	struct fake_i2c *i2c = data;
+	int i;
+
+	trace(i2c, addr | flag << 8 | len << 16 | 1 << 24);
+	for (i = 0; i < len; i++) {
+		i2c->regs[addr + i] = buf[i];
+		trace(i2c, buf[i]);
+	}
+	return 0;
+}
+
+static void fake_sleep(void *data, int ms)
+{
+	trace(data, ms | 1 << 30);
+}
+
+/*reference: decode every action each time, as the driver walks them*/
+struct ref_ctx {
+	struct fake_i2c *i2c;
+	__s32 priv[PRIVATE_MAX_SIZE];
+	__u8 regbuf[VM_REGBUF_SIZE];
+};
+
+static __s32 ref_regbuf(struct ref_ctx *ctx, const struct operand *oper)
+{
+	__s32 v = 0;
+	int len = oper->data.reg.len < 4 ? oper->data.reg.len : 4;
+
+	memcpy(&v, &ctx->regbuf[oper->data.reg.addr], len);
+	return v;
+}
+
+static __s32 ref_operand(struct ref_ctx *ctx,
+			const struct operand *oper, __s32 before)
+{
+	switch (oper->type) {
+	case OPT_IMM:
+		return oper->data.immediate;
+	case OPT_INDEX:
+		return ctx->priv[oper->data.index];
+	case OPT_REG_BUF:
+		return ref_regbuf(ctx, oper);
+	case OPT_BEFORE:
+	default:
+		return before;
+	}
+}
+
+static __s32 ref_access(struct ref_ctx *ctx,
+		const struct data_action *data, __s32 before)
+{
+	const struct operand *op1 = &data->operand1;
+	const struct operand *op2 = &data->operand2;
+	__s32 v;
+
+	if (op2->type == OPT_REG) {
+		fake_read(ctx->i2c, op2->data.reg.addr, op2->data.reg.flag,
+			&ctx->regbuf[op2->data.reg.addr], op2->data.reg.len);
+		if (op1->data.reg.addr != op2->data.reg.addr)
+			memmove(&ctx->regbuf[op1->data.reg.addr],
+				&ctx->regbuf[op2->data.reg.addr],
+				op1->data.reg.len);
+		return ref_regbuf(ctx, op1);
+	}
+
+	v = ref_operand(ctx, op2, before);
+	if (op1->type == OPT_INDEX) {
+		ctx->priv[op1->data.index] = v;
+	} else {
+		__s32 le = v;
+		int i;
+
+		for (i = 0; i < op1->data.reg.len; i++, le >>= 8)
+			ctx->regbuf[op1->data.reg.addr + i] = le & 0xff;
+		if (op1->type == OPT_REG)
+			fake_write(ctx->i2c, op1->data.reg.addr,
+				op1->data.reg.flag,
+				&ctx->regbuf[op1->data.reg.addr],
+				op1->data.reg.len);
+	}
+
+	return v;
+}
+
+/*return 1 after a return action*/
+static int ref_run(struct ref_ctx *ctx, const struct lowlevel_action *actions,
+			int num, __s32 *before)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		const struct lowlevel_action *action = &actions[i];
+		const struct data_action *data = &action->action.data;
+		const struct ifelse_action *ifelse = &action->action.ifelse;
+
+		switch (action->type) {
+		case DATA:
+			if (data->op == OP_ACCESS)
+				*before = ref_access(ctx, data, *before);
+			else
+				*before = sensor_vm_eval(data->op,
+					ref_operand(ctx, &data->operand1, *before),
+					ref_operand(ctx, &data->operand2, *before));
+			break;
+
+		case SLEEP:
+			fake_sleep(ctx->i2c, action->action.sleep.ms);
+			break;
+
+		case IFELSE:
+			if (ref_run(ctx, action + 1, ifelse->num_con, before))
+				return 1;
+			if (*before) {
+				if (ref_run(ctx, action + 1 + ifelse->num_con,
+						ifelse->num_if, before))
+					return 1;
+			} else {
+				if (ref_run(ctx, action + 1 + ifelse->num_con +
+						ifelse->num_if,
+						ifelse->num_else, before))
+					return 1;
+			}
+			i += ifelse->num_con + ifelse->num_if + ifelse->num_else;
+			break;
+
+		case RETURN:
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*built-in programs*/
+static struct lowlevel_action builtin_actions[MAX_LL_ACTION_NUM];
+static int builtin_num;
+
+static struct lowlevel_action *add_action(int type)
+{
+	struct lowlevel_action *action = &builtin_actions[builtin_num++];
+
+	memset(action, 0, sizeof(*action));
+	action->type = type;
+	return action;
+}
+
+static void set_reg(struct operand *oper, int type, int addr, int flag, int len)
+{
+	oper->type = type;
+	oper->data.reg.addr = addr;
+	oper->data.reg.flag = flag;
+	oper->data.reg.len = len;
+}
+
+static void set_value(struct operand *oper, int type, int value)
+{
+	oper->type = type;
+	oper->data.immediate = value;
+}
+
+static void add_data(int op, int type1, int v1, int type2, int v2)
+{
+	struct data_action *data = &add_action(DATA)->action.data;
+
+	data->op = op;
+	set_value(&data->operand1, type1, v1);
+	set_value(&data->operand2, type2, v2);
+}
+
+static void add_readreg(int addr, int flag, int len)
+{
+	struct data_action *data = &add_action(DATA)->action.data;
+
+	data->op = OP_ACCESS;
+	set_reg(&data->operand1, OPT_REG_BUF, addr, 0, len);
+	set_reg(&data->operand2, OPT_REG, addr, flag, len);
+}
+
+static void add_writereg(int addr, int type, int value)
+{
+	struct data_action *data = &add_action(DATA)->action.data;
+
+	data->op = OP_ACCESS;
+	set_reg(&data->operand1, OPT_REG, addr, 0, 1);
+	set_value(&data->operand2, type, value);
+}
+
+static struct ifelse_action *add_if(void)
+{
+	return &add_action(IFELSE)->action.ifelse;
+}
+
+static void add_program(const char *name, int start, int has_input)
+{
+	struct program *program = &programs[num_programs++];
+
+	snprintf(program->name, sizeof(program->name), "%s", name);
+	program->actions = &builtin_actions[start];
+	program->num = builtin_num - start;
+	program->has_input = has_input;
+}
+
+static void builtin_programs(void)
+{
+	static const char *axis_names[] = { "get_data_x", "get_data_y",
+					"get_data_z" };
+	struct ifelse_action *ifelse, *inner;
+	int start, axis, mark;
+
+	/*readreg_0x28_0x80_2; le16_to_cpu(regbuf_0x28_2) >> 4; return*/
+	for (axis = 0; axis < 3; axis++) {
+		start = builtin_num;
+		add_readreg(0x28 + axis * 2, 0x80, 2);
+		add_data(OP_ENDIAN_LE16, OPT_REG_BUF, 0, OPT_IMM, 0);
+		set_reg(&builtin_actions[builtin_num - 1].action.data.operand1,
+			OPT_REG_BUF, 0x28 + axis * 2, 0, 2);
+		add_data(OP_BIT_LSR, OPT_BEFORE, 0, OPT_IMM, 4);
+		add_data(OP_ARI_ADD, OPT_BEFORE, 0, OPT_IMM, 0);
+		add_action(RETURN);
+		add_program(axis_names[axis], start, 0);
+	}
+
+	/*if ((readreg_0x31 & 0x40) != 0) return 1 else return 0 endif*/
+	start = builtin_num;
+	ifelse = add_if();
+	add_readreg(0x31, 0, 1);
+	add_data(OP_BIT_AND, OPT_BEFORE, 0, OPT_IMM, 0x40);
+	add_data(OP_LOGIC_NEQ, OPT_BEFORE, 0, OPT_IMM, 0);
+	ifelse->num_con = 3;
+	add_data(OP_ARI_ADD, OPT_IMM, 1, OPT_IMM, 0);
+	add_action(RETURN);
+	ifelse->num_if = 2;
+	add_data(OP_ARI_ADD, OPT_IMM, 0, OPT_IMM, 0);
+	add_action(RETURN);
+	ifelse->num_else = 2;
+	add_program("int_ack", start, 0);
+
+	/*local_0 = input;
+	* if (local_0 == 2) writereg_0x23 = 0x08
+	* else if (local_0 == 4) writereg_0x23 = 0x18
+	* else writereg_0x23 = (local_0 / 8 + 1) << 4 | 0x08 endif endif
+	*/
+	start = builtin_num;
+	add_data(OP_ACCESS, OPT_INDEX, 0, OPT_BEFORE, 0);
+	ifelse = add_if();
+	mark = builtin_num;
+	add_data(OP_LOGIC_EQ, OPT_INDEX, 0, OPT_IMM, 2);
+	ifelse->num_con = 1;
+	add_writereg(0x23, OPT_IMM, 0x08);
+	ifelse->num_if = 1;
+	inner = add_if();
+	add_data(OP_LOGIC_EQ, OPT_INDEX, 0, OPT_IMM, 4);
+	inner->num_con = 1;
+	add_writereg(0x23, OPT_IMM, 0x18);
+	inner->num_if = 1;
+	add_data(OP_ARI_DIV, OPT_INDEX, 0, OPT_IMM, 8);
+	add_data(OP_ARI_ADD, OPT_BEFORE, 0, OPT_IMM, 1);
+	add_data(OP_BIT_LSL, OPT_BEFORE, 0, OPT_IMM, 4);
+	add_data(OP_BIT_OR, OPT_BEFORE, 0, OPT_IMM, 0x08);
+	add_writereg(0x23, OPT_BEFORE, 0);
+	inner->num_else = 5;
+	ifelse->num_else = builtin_num - mark - 2;
+	add_program("set_range", start, 1);
+
+	/*writereg_0x20 = (readreg_0x20 & 0x0f) | 0x50*/
+	start = builtin_num;
+	add_readreg(0x20, 0, 1);
+	add_data(OP_BIT_AND, OPT_BEFORE, 0, OPT_IMM, 0x0f);
+	add_data(OP_BIT_OR, OPT_BEFORE, 0, OPT_IMM, 0x50);
+	add_writereg(0x20, OPT_BEFORE, 0);
+	add_program("odr_100hz", start, 0);
+
+	/*writereg_0x20 = 0x57; sleep_10; global_0 = 1 + 0*/
+	start = builtin_num;
+	add_writereg(0x20, OPT_IMM, 0x57);
+	add_action(SLEEP)->action.sleep.ms = 10;
+	add_data(OP_ACCESS, OPT_INDEX, PRIVATE_MAX_SIZE / 2, OPT_IMM, 1);
+	add_program("enable", start, 0);
+}
+
+static const char *image_end;
+
+static void add_image_program(const struct lowlevel_action *table,
+		const struct lowlevel_action_index *index,
+		const char *sensor, const char *name, int has_input)
+{
+	struct program *program;
+
+	if (!index->num || num_programs >= MAX_PROGRAMS)
+		return;
+
+	if ((const char *)&table[index->index + index->num] > image_end) {
+		printf("%s:%s: actions out of the image\n", sensor, name);
+		return;
+	}
+
+	program = &programs[num_programs++];
+	snprintf(program->name, sizeof(program->name), "%s:%s", sensor, name);
+	program->actions = &table[index->index];
+	program->num = index->num;
+	program->has_input = has_input;
+}
+
+static void *load_image(const char *path)
+{
+	static const char *action_names[] = {
+		"init", "deinit", "enable", "disable", "int_ack",
+		"get_data_x", "get_data_y", "get_data_z",
+		"get_range", "set_range", "get_selftest", "set_selftest",
+	};
+	struct sensor_config_image *image;
+	struct sensor_config *config;
+	char name[32];
+	char *buf;
+	int fd, size, i, j;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		printf("open file error %s\n", path);
+		return NULL;
+	}
+
+	size = lseek64(fd, 0, SEEK_END);
+	lseek64(fd, 0, SEEK_SET);
+	buf = malloc(size);
+	if (!buf || read(fd, buf, size) != size) {
+		printf("read file error %s\n", path);
+		close(fd);
+		free(buf);
+		return NULL;
+	}
+	close(fd);
+
+	image = (struct sensor_config_image *)buf;
+	image_end = buf + size;
+	if (size < (int)sizeof(*image) || image->magic != 0x1234) {
+		printf("wrong firmware image\n");
+		free(buf);
+		return NULL;
+	}
+
+	config = (struct sensor_config *)&image->configs;
+	for (i = 0; i < image->num; i++) {
+		struct lowlevel_action *table =
+			(struct lowlevel_action *)&config->actions;
+		const char *sensor = (const char *)config->name;
+
+		for (j = 0; j < SENSOR_ACTION_RESERVE; j++)
+			add_image_program(table, &config->indexs[j], sensor,
+				action_names[j], j == SET_RANGE || j == SET_SELFTEST);
+
+		for (j = 0; j < config->odr_entries; j++) {
+			snprintf(name, sizeof(name), "odr_%dhz",
+					config->odr_table[j].hz);
+			add_image_program(table, &config->odr_table[j].index,
+					sensor, name, 0);
+		}
+
+		for (j = 0; j < config->range_entries; j++) {
+			snprintf(name, sizeof(name), "range_%d",
+					config->range_table[j].range);
+			add_image_program(table, &config->range_table[j].index,
+					sensor, name, 0);
+		}
+
+		for (j = 0; j < config->sysfs_entries; j++) {
+			struct sysfs_entry *entry = &config->sysfs_table[j];
+
+			if (entry->type != DATA_ACTION)
+				continue;
+			snprintf(name, sizeof(name), "%.*s_show",
+				MAX_ATTR_NAME_BYTES, entry->name);
+			add_image_program(table, &entry->action.data.index_show,
+					sensor, name, 0);
+			snprintf(name, sizeof(name), "%.*s_store",
+				MAX_ATTR_NAME_BYTES, entry->name);
+			add_image_program(table, &entry->action.data.index_store,
+					sensor, name, 1);
+		}
+
+		config = (struct sensor_config *)((char *)config + config->size);
+	}
+
+	return buf;
+}
+
+static int64_t now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static void randomize(struct fake_i2c *i2c, unsigned int *seed)
+{
+	int i;
+
+	for (i = 0; i < VM_REGBUF_SIZE; i++)
+		i2c->regs[i] = rand_r(seed);
+	i2c->hash = 2166136261u;
+	i2c->accesses = 0;
+}
+
+/*return the number of mismatches*/
+static int check_program(struct program *program, int loops)
+{
+	static const struct sensor_vm_ops ops_template = {
+		fake_read, fake_write, fake_sleep, NULL,
+	};
+	struct sensor_vm_ops ops = ops_template;
+	struct fake_i2c ref_i2c, vm_i2c;
+	struct ref_ctx ctx;
+	struct sensor_vm vm;
+	unsigned int seed = 1;
+	int i, errors = 0;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.i2c = &ref_i2c;
+	ops.data = &vm_i2c;
+	sensor_vm_init(&vm, &vm_prog, &ops);
+
+	for (i = 0; i < loops; i++) {
+		__s32 input = program->has_input ? rand_r(&seed) % 20 : 0;
+		__s32 ref_out = input;
+		int vm_out = 0;
+		unsigned int regs_seed = seed;
+
+		randomize(&ref_i2c, &regs_seed);
+		regs_seed = seed;
+		randomize(&vm_i2c, &regs_seed);
+		seed = regs_seed;
+
+		ref_run(&ctx, program->actions, program->num, &ref_out);
+		sensor_vm_run(&vm, program->entry, input, &vm_out);
+
+		if (ref_out != vm_out || ref_i2c.hash != vm_i2c.hash ||
+			ref_i2c.accesses != vm_i2c.accesses ||
+			memcmp(ctx.priv, vm.slots, sizeof(ctx.priv))) {
+			if (!errors)
+				printf("  %s: mismatch input %d, output %d/%d, "
+					"i2c %d/%d accesses\n", program->name,
+					input, ref_out, vm_out,
+					ref_i2c.accesses, vm_i2c.accesses);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+static double time_program(struct program *program, int loops, int use_vm)
+{
+	static const struct sensor_vm_ops ops_template = {
+		fake_read, fake_write, fake_sleep, NULL,
+	};
+	struct sensor_vm_ops ops = ops_template;
+	struct fake_i2c i2c;
+	struct ref_ctx ctx;
+	struct sensor_vm vm;
+	unsigned int seed = 1;
+	int64_t start;
+	int i, out;
+
+	randomize(&i2c, &seed);
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.i2c = &i2c;
+	ops.data = &i2c;
+	sensor_vm_init(&vm, &vm_prog, &ops);
+
+	start = now_ns();
+	for (i = 0; i < loops; i++) {
+		__s32 input = program->has_input ? i % 20 : 0;
+
+		if (use_vm) {
+			sensor_vm_run(&vm, program->entry, input, &out);
+		} else {
+			ref_run(&ctx, program->actions, program->num, &input);
+			out = input;
+		}
+		i2c.hash += out;
+	}
+
+	return (double)(now_ns() - start) / loops;
+}
+
+static void usage(void)
+{
+	printf("usage: sensor_action_bench [-n loops] "
+		"[-f sensor_config.bin] [-d]\n");
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *image_file = NULL;
+	void *image = NULL;
+	double ref_total = 0, vm_total = 0;
+	int loops = DEFAULT_LOOPS;
+	int actions = 0, insns = 0;
+	int errors = 0;
+	int dump = 0;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "n:f:dh")) != -1) {
+		switch (opt) {
+		case 'n':
+			loops = atoi(optarg);
+			break;
+		case 'f':
+			image_file = optarg;
+			break;
+		case 'd':
+			dump = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (loops <= 0)
+		usage();
+
+	if (image_file) {
+		image = load_image(image_file);
+		if (!image)
+			return EXIT_FAILURE;
+	} else {
+		builtin_programs();
+	}
+
+	sensor_vm_prog_init(&vm_prog);
+	for (i = 0; i < num_programs; i++) {
+		programs[i].entry = sensor_vm_compile(&vm_prog,
+				programs[i].actions, programs[i].num);
+		if (programs[i].entry < 0) {
+			printf("%s: not valid\n", programs[i].name);
+			return EXIT_FAILURE;
+		}
+	}
+	if (dump)
+		sensor_vm_dump(&vm_prog);
+
+	printf("%-28s %7s %7s %10s %10s\n", "program", "actions",
+		"insns", "walk ns", "vm ns");
+	for (i = 0; i < num_programs; i++) {
+		struct program *program = &programs[i];
+		int end = i + 1 < num_programs ?
+			programs[i + 1].entry : vm_prog.num_insns;
+		double ref_ns, vm_ns;
+
+		errors += check_program(program, loops / 10 + 1);
+
+		ref_ns = time_program(program, loops, 0);
+		vm_ns = time_program(program, loops, 1);
+		ref_total += ref_ns;
+		vm_total += vm_ns;
+		actions += program->num;
+		insns += end - program->entry;
+
+		printf("%-28s %7d %7d %10.1f %10.1f\n", program->name,
+			program->num, end - program->entry, ref_ns, vm_ns);
+	}
+
+	printf("%d programs, %d actions (%d bytes) -> %d insns + %d constants"
+		" (%d bytes)\n", num_programs, actions,
+		actions * (int)sizeof(struct lowlevel_action), insns,
+		vm_prog.num_consts, insns * (int)sizeof(struct sensor_vm_insn) +
+		vm_prog.num_consts * (int)sizeof(__s32));
+	printf("walk %.1f ns, vm %.1f ns per run of all programs, %s\n",
+		ref_total, vm_total, errors ? "MISMATCH" : "same results");
+
+	free(image);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
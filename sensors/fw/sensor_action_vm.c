@@ -0,0 +1,635 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Bytecode compiler and interpreter of sensor lowlevel actions
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <linux/types.h>
+#include "sensor_driver_config.h"
+#include "sensor_action_vm.h"
+
+#define INT_MIN_S32		((__s32)0x80000000)
+
+static const char *vm_op_names[] = {
+	"ld", "mov", "ldbuf", "stbuf", "rdreg", "wrreg",
+	"jz", "jmp", "sleep", "ret",
+};
+
+static const char *vm_data_names[] = {
+	"access", "min", "max",
+	"eq", "neq", "greater", "less", "ge", "le", "and", "or",
+	"add", "sub", "mul", "div", "mod",
+	"bor", "band", "lsl", "lsr", "nor",
+	"be16", "be16u", "be24", "be32",
+	"le16", "le16u", "le24", "le32",
+};
+
+int sensor_vm_eval(int op, int op1, int op2)
+{
+	__u32 v = op1;
+
+	switch (op) {
+	case OP_MIN:
+		return op1 < op2 ? op1 : op2;
+	case OP_MAX:
+		return op1 > op2 ? op1 : op2;
+
+	case OP_LOGIC_EQ:
+		return op1 == op2;
+	case OP_LOGIC_NEQ:
+		return op1 != op2;
+	case OP_LOGIC_GREATER:
+		return op1 > op2;
+	case OP_LOGIC_LESS:
+		return op1 < op2;
+	case OP_LOGIC_GE:
+		return op1 >= op2;
+	case OP_LOGIC_LE:
+		return op1 <= op2;
+	case OP_LOGIC_AND:
+		return op1 && op2;
+	case OP_LOGIC_OR:
+		return op1 || op2;
+
+	/*wrap around as the driver does, no overflow trap*/
+	case OP_ARI_ADD:
+		return (__u32)op1 + (__u32)op2;
+	case OP_ARI_SUB:
+		return (__u32)op1 - (__u32)op2;
+	case OP_ARI_MUL:
+		return (__u32)op1 * (__u32)op2;
+	case OP_ARI_DIV:
+		if (!op2)
+			return 0;
+		if (op1 == INT_MIN_S32 && op2 == -1)
+			return op1;
+		return op1 / op2;
+	case OP_ARI_MOD:
+		if (!op2 || op2 == -1)
+			return 0;
+		return op1 % op2;
+
+	case OP_BIT_OR:
+		return op1 | op2;
+	case OP_BIT_AND:
+		return op1 & op2;
+	case OP_BIT_LSL:
+		return (__u32)op1 << (op2 & 31);
+	case OP_BIT_LSR:
+		return op1 >> (op2 & 31);
+	case OP_BIT_NOR:
+		return ~op1;
+
+	/*op1 is the bytes of registers in cpu order*/
+	case OP_ENDIAN_BE16:
+		return (__s16)(((v & 0xff) << 8) | ((v >> 8) & 0xff));
+	case OP_ENDIAN_BE16_UN:
+		return ((v & 0xff) << 8) | ((v >> 8) & 0xff);
+	case OP_ENDIAN_BE24:
+		return ((v & 0xff) << 16) | (v & 0xff00) | ((v >> 16) & 0xff);
+	case OP_ENDIAN_BE32:
+		return ((v & 0xff) << 24) | ((v & 0xff00) << 8) |
+			((v >> 8) & 0xff00) | (v >> 24);
+	case OP_ENDIAN_LE16:
+		return (__s16)(v & 0xffff);
+	case OP_ENDIAN_LE16_UN:
+		return v & 0xffff;
+	case OP_ENDIAN_LE24:
+		return v & 0xffffff;
+	case OP_ENDIAN_LE32:
+		return op1;
+
+	default:
+		return 0;
+	}
+}
+
+static inline __s32 vm_regbuf_value(const __u8 *buf, int len)
+{
+	switch (len) {
+	case 1:
+		return buf[0];
+	case 2:
+		return buf[0] | (buf[1] << 8);
+	case 3:
+		return buf[0] | (buf[1] << 8) | (buf[2] << 16);
+	default:
+		return buf[0] | (buf[1] << 8) | (buf[2] << 16) |
+			((__u32)buf[3] << 24);
+	}
+}
+
+static inline void vm_regbuf_store(__u8 *buf, int len, __s32 value)
+{
+	int i;
+
+	for (i = 0; i < len; i++, value >>= 8)
+		buf[i] = value & 0xff;
+}
+
+void sensor_vm_prog_init(struct sensor_vm_prog *prog)
+{
+	prog->num_insns = 0;
+	prog->num_consts = 0;
+}
+
+static int vm_emit(struct sensor_vm_prog *prog, int op,
+			int len, int flag, int a, int b)
+{
+	struct sensor_vm_insn *insn;
+
+	if (prog->num_insns >= VM_MAX_INSNS) {
+		printf("[%d]%s Error, exceeds max %d insns\n",
+				__LINE__, __func__, VM_MAX_INSNS);
+		return -1;
+	}
+
+	insn = &prog->insns[prog->num_insns];
+	insn->op = op;
+	insn->len = len;
+	insn->flag = flag;
+	insn->pad = 0;
+	insn->a = a;
+	insn->b = b;
+
+	return prog->num_insns++;
+}
+
+/*slot of a constant, equal constants share one slot*/
+static int vm_const(struct sensor_vm_prog *prog, __s32 value)
+{
+	int i;
+
+	for (i = 0; i < prog->num_consts; i++)
+		if (prog->consts[i] == value)
+			return VM_SLOT_CONST + i;
+
+	if (prog->num_consts >= VM_MAX_CONSTS) {
+		printf("[%d]%s Error, exceeds max %d constants\n",
+				__LINE__, __func__, VM_MAX_CONSTS);
+		return -1;
+	}
+
+	prog->consts[prog->num_consts] = value;
+
+	return VM_SLOT_CONST + prog->num_consts++;
+}
+
+static int vm_reg_valid(const struct operand *oper, int max_len)
+{
+	int addr = oper->data.reg.addr;
+	int len = oper->data.reg.len;
+
+	if (len < 1 || len > max_len || addr + len > VM_REGBUF_SIZE) {
+		printf("[%d]%s Error, register 0x%x len %d\n",
+				__LINE__, __func__, addr, len);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*slot holding the value of a source operand, registers are not allowed*/
+static int vm_operand(struct sensor_vm_prog *prog,
+			const struct operand *oper, int tmp)
+{
+	switch (oper->type) {
+	case OPT_IMM:
+		return vm_const(prog, oper->data.immediate);
+
+	case OPT_INDEX:
+		if (oper->data.index < 0 || oper->data.index >= PRIVATE_MAX_SIZE) {
+			printf("[%d]%s Error, index %d\n",
+					__LINE__, __func__, oper->data.index);
+			return -1;
+		}
+		return oper->data.index;
+
+	case OPT_BEFORE:
+		return VM_SLOT_BEFORE;
+
+	case OPT_REG_BUF:
+		if (!vm_reg_valid(oper, sizeof(__s32)))
+			return -1;
+		if (vm_emit(prog, VM_LDBUF, oper->data.reg.len, 0,
+				tmp, oper->data.reg.addr) < 0)
+			return -1;
+		return tmp;
+
+	default:
+		printf("[%d]%s Error, operand type %d\n",
+				__LINE__, __func__, oper->type);
+		return -1;
+	}
+}
+
+static int vm_compile_access(struct sensor_vm_prog *prog,
+		const struct operand *op1, const struct operand *op2)
+{
+	int b;
+
+	/*readreg*/
+	if (op2->type == OPT_REG) {
+		if (op1->type != OPT_REG_BUF ||
+			!vm_reg_valid(op2, DATA_STACK_MAX_SIZE))
+			goto err;
+
+		if (vm_emit(prog, VM_RDREG, op2->data.reg.len,
+			op2->data.reg.flag, op2->data.reg.addr, 0) < 0)
+			goto err;
+
+		if (op1->data.reg.addr == op2->data.reg.addr &&
+			op1->data.reg.len == op2->data.reg.len)
+			return 0;
+
+		/*copy to another place of regbuf*/
+		if (!vm_reg_valid(op1, sizeof(__s32)) ||
+			vm_emit(prog, VM_LDBUF, op1->data.reg.len, 0,
+				VM_SLOT_TMP1, op2->data.reg.addr) < 0 ||
+			vm_emit(prog, VM_STBUF, op1->data.reg.len, 0,
+				op1->data.reg.addr, VM_SLOT_TMP1) < 0)
+			goto err;
+
+		return 0;
+	}
+
+	b = vm_operand(prog, op2, VM_SLOT_TMP1);
+	if (b < 0)
+		goto err;
+
+	switch (op1->type) {
+	case OPT_REG:
+		if (!vm_reg_valid(op1, sizeof(__s32)))
+			goto err;
+		b = vm_emit(prog, VM_WRREG, op1->data.reg.len,
+			op1->data.reg.flag, op1->data.reg.addr, b);
+		break;
+
+	case OPT_REG_BUF:
+		if (!vm_reg_valid(op1, sizeof(__s32)))
+			goto err;
+		b = vm_emit(prog, VM_STBUF, op1->data.reg.len, 0,
+				op1->data.reg.addr, b);
+		break;
+
+	case OPT_INDEX:
+		if (op1->data.index < 0 || op1->data.index >= PRIVATE_MAX_SIZE)
+			goto err;
+		b = vm_emit(prog, VM_MOV, 0, 0, op1->data.index, b);
+		break;
+
+	default:
+		goto err;
+	}
+
+	return b < 0 ? -1 : 0;
+err:
+	printf("[%d]%s Error, access %d = %d\n",
+			__LINE__, __func__, op1->type, op2->type);
+	return -1;
+}
+
+static int vm_compile_data(struct sensor_vm_prog *prog,
+			const struct data_action *data)
+{
+	const struct operand *op1 = &data->operand1;
+	const struct operand *op2 = &data->operand2;
+	int unary = data->op >= OP_BIT_NOR;
+	int a, b;
+
+	if (data->op >= OP_RESERVE) {
+		printf("[%d]%s Error, data op %d\n",
+				__LINE__, __func__, data->op);
+		return -1;
+	}
+
+	if (data->op == OP_ACCESS)
+		return vm_compile_access(prog, op1, op2);
+
+	/*constant folding*/
+	if (op1->type == OPT_IMM && (unary || op2->type == OPT_IMM)) {
+		a = vm_const(prog, sensor_vm_eval(data->op,
+			op1->data.immediate, unary ? 0 : op2->data.immediate));
+		if (a < 0)
+			return -1;
+		return vm_emit(prog, VM_LD, 0, 0, a, 0) < 0 ? -1 : 0;
+	}
+
+	/*before + 0 of return and the like leave before as it is*/
+	if (op1->type == OPT_BEFORE && op2->type == OPT_IMM &&
+		!op2->data.immediate && (data->op == OP_ARI_ADD ||
+		data->op == OP_ARI_SUB || data->op == OP_BIT_OR ||
+		data->op == OP_BIT_LSL || data->op == OP_BIT_LSR))
+		return 0;
+
+	/*endian of registers reads regbuf directly*/
+	if (data->op >= OP_ENDIAN_BE16 && op1->type == OPT_REG_BUF) {
+		if (!vm_reg_valid(op1, sizeof(__s32)))
+			return -1;
+		return vm_emit(prog, VM_DATA + data->op, op1->data.reg.len,
+			VM_FLAG_REGBUF, op1->data.reg.addr, 0) < 0 ? -1 : 0;
+	}
+
+	a = vm_operand(prog, op1, VM_SLOT_TMP1);
+	b = unary ? a : vm_operand(prog, op2, VM_SLOT_TMP2);
+	if (a < 0 || b < 0)
+		return -1;
+
+	return vm_emit(prog, VM_DATA + data->op, 0, 0, a, b) < 0 ? -1 : 0;
+}
+
+static int vm_compile_actions(struct sensor_vm_prog *prog,
+		const struct lowlevel_action *actions, int num, int depth);
+
+/*condition, jz else, if branch, jmp end, else branch
+* a constant condition keeps only the taken branch
+*/
+static int vm_compile_ifelse(struct sensor_vm_prog *prog,
+		const struct lowlevel_action *action, int num, int depth)
+{
+	const struct ifelse_action *ifelse = &action->action.ifelse;
+	const struct lowlevel_action *branch;
+	int num_con = ifelse->num_con;
+	int num_if = ifelse->num_if;
+	int num_else = ifelse->num_else;
+	int start = prog->num_insns;
+	int jz, jmp;
+
+	if (depth >= VM_MAX_IF_DEPTH || num_con < 0 || num_if < 0 ||
+		num_else < 0 || num_con + num_if + num_else >= num) {
+		printf("[%d]%s Error, ifelse %d:%d:%d of %d depth %d\n",
+				__LINE__, __func__, num_con, num_if,
+				num_else, num, depth);
+		return -1;
+	}
+
+	if (vm_compile_actions(prog, action + 1, num_con, depth + 1))
+		return -1;
+
+	/*dead branch elimination*/
+	if (prog->num_insns == start + 1 && prog->insns[start].op == VM_LD &&
+		prog->insns[start].a >= VM_SLOT_CONST) {
+		int cond = prog->consts[prog->insns[start].a - VM_SLOT_CONST];
+		int ret;
+
+		branch = action + 1 + num_con;
+		if (cond)
+			ret = vm_compile_actions(prog, branch, num_if, depth + 1);
+		else
+			ret = vm_compile_actions(prog, branch + num_if,
+						num_else, depth + 1);
+
+		/*still validate the dropped branch*/
+		if (!ret) {
+			int end = prog->num_insns;
+			int consts = prog->num_consts;
+
+			if (cond)
+				ret = vm_compile_actions(prog, branch + num_if,
+							num_else, depth + 1);
+			else
+				ret = vm_compile_actions(prog, branch, num_if,
+							depth + 1);
+			prog->num_insns = end;
+			prog->num_consts = consts;
+		}
+
+		return ret;
+	}
+
+	jz = vm_emit(prog, VM_JZ, 0, 0, 0, 0);
+	if (jz < 0)
+		return -1;
+
+	branch = action + 1 + num_con;
+	if (vm_compile_actions(prog, branch, num_if, depth + 1))
+		return -1;
+
+	if (!num_else) {
+		prog->insns[jz].a = prog->num_insns;
+		return 0;
+	}
+
+	jmp = vm_emit(prog, VM_JMP, 0, 0, 0, 0);
+	if (jmp < 0)
+		return -1;
+	prog->insns[jz].a = prog->num_insns;
+
+	if (vm_compile_actions(prog, branch + num_if, num_else, depth + 1))
+		return -1;
+	prog->insns[jmp].a = prog->num_insns;
+
+	return 0;
+}
+
+static int vm_compile_actions(struct sensor_vm_prog *prog,
+		const struct lowlevel_action *actions, int num, int depth)
+{
+	int c;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		const struct lowlevel_action *action = &actions[i];
+
+		switch (action->type) {
+		case DATA:
+			if (vm_compile_data(prog, &action->action.data))
+				return -1;
+			break;
+
+		case SLEEP:
+			c = vm_const(prog, action->action.sleep.ms);
+			if (c < 0 || vm_emit(prog, VM_SLEEP, 0, 0, c, 0) < 0)
+				return -1;
+			break;
+
+		case IFELSE:
+			if (vm_compile_ifelse(prog, action, num - i, depth))
+				return -1;
+			i += action->action.ifelse.num_con +
+				action->action.ifelse.num_if +
+				action->action.ifelse.num_else;
+			break;
+
+		case RETURN:
+			if (vm_emit(prog, VM_RET, 0, 0, 0, 0) < 0)
+				return -1;
+			break;
+
+		default:
+			printf("[%d]%s Error, lowlevel action %d\n",
+					__LINE__, __func__, action->type);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int sensor_vm_compile(struct sensor_vm_prog *prog,
+		const struct lowlevel_action *actions, int num)
+{
+	int entry = prog->num_insns;
+
+	if (num < 0 || num > MAX_LL_ACTION_NUM) {
+		printf("[%d]%s Error, %d actions\n", __LINE__, __func__, num);
+		return -1;
+	}
+
+	if (vm_compile_actions(prog, actions, num, 0) ||
+		vm_emit(prog, VM_RET, 0, 0, 0, 0) < 0)
+		return -1;
+
+	return entry;
+}
+
+int sensor_vm_validate(const struct lowlevel_action *actions, int num)
+{
+	static struct sensor_vm_prog prog;
+
+	sensor_vm_prog_init(&prog);
+
+	return sensor_vm_compile(&prog, actions, num) < 0 ? -1 : 0;
+}
+
+void sensor_vm_init(struct sensor_vm *vm, const struct sensor_vm_prog *prog,
+		const struct sensor_vm_ops *ops)
+{
+	memset(vm, 0, sizeof(*vm));
+	vm->prog = prog;
+	vm->ops = ops;
+	memcpy(&vm->slots[VM_SLOT_CONST], prog->consts,
+			prog->num_consts * sizeof(__s32));
+}
+
+#define X	s[insn->a]
+#define Y	s[insn->b]
+#define VM_ALU(op, expr)				\
+	case VM_DATA + op:				\
+		s[VM_SLOT_BEFORE] = (expr);		\
+		break
+
+int sensor_vm_run(struct sensor_vm *vm, int entry, int input, int *output)
+{
+	const struct sensor_vm_insn *insns = vm->prog->insns;
+	const struct sensor_vm_ops *ops = vm->ops;
+	__s32 *s = vm->slots;
+	__u8 *regbuf = vm->regbuf;
+	int pc = entry;
+	int ret;
+
+	s[VM_SLOT_BEFORE] = input;
+
+	for (;;) {
+		const struct sensor_vm_insn *insn = &insns[pc++];
+		__s32 x;
+
+		switch (insn->op) {
+		case VM_LD:
+			s[VM_SLOT_BEFORE] = X;
+			break;
+		case VM_MOV:
+			s[insn->a] = s[VM_SLOT_BEFORE] = Y;
+			break;
+		case VM_LDBUF:
+			s[insn->a] = vm_regbuf_value(regbuf + insn->b, insn->len);
+			break;
+		case VM_STBUF:
+			vm_regbuf_store(regbuf + insn->a, insn->len, Y);
+			s[VM_SLOT_BEFORE] = Y;
+			break;
+
+		case VM_RDREG:
+			ret = ops->read(ops->data, insn->a, insn->flag,
+					regbuf + insn->a, insn->len);
+			if (ret < 0)
+				return ret;
+			s[VM_SLOT_BEFORE] = vm_regbuf_value(regbuf + insn->a,
+				insn->len < 4 ? insn->len : 4);
+			break;
+		case VM_WRREG:
+			vm_regbuf_store(regbuf + insn->a, insn->len, Y);
+			ret = ops->write(ops->data, insn->a, insn->flag,
+					regbuf + insn->a, insn->len);
+			if (ret < 0)
+				return ret;
+			s[VM_SLOT_BEFORE] = Y;
+			break;
+
+		case VM_JZ:
+			if (!s[VM_SLOT_BEFORE])
+				pc = insn->a;
+			break;
+		case VM_JMP:
+			pc = insn->a;
+			break;
+		case VM_SLEEP:
+			ops->sleep(ops->data, X);
+			break;
+		case VM_RET:
+			*output = s[VM_SLOT_BEFORE];
+			return 0;
+
+		/*the frequent ones inline, the others through eval*/
+		VM_ALU(OP_LOGIC_EQ, X == Y);
+		VM_ALU(OP_LOGIC_NEQ, X != Y);
+		VM_ALU(OP_ARI_ADD, (__u32)X + (__u32)Y);
+		VM_ALU(OP_ARI_SUB, (__u32)X - (__u32)Y);
+		VM_ALU(OP_ARI_MUL, (__u32)X * (__u32)Y);
+		VM_ALU(OP_BIT_OR, X | Y);
+		VM_ALU(OP_BIT_AND, X & Y);
+		VM_ALU(OP_BIT_LSL, (__u32)X << (Y & 31));
+		VM_ALU(OP_BIT_LSR, X >> (Y & 31));
+
+		default:
+			if (insn->flag & VM_FLAG_REGBUF)
+				x = vm_regbuf_value(regbuf + insn->a, insn->len);
+			else
+				x = X;
+			s[VM_SLOT_BEFORE] = sensor_vm_eval(insn->op - VM_DATA, x, Y);
+			break;
+		}
+	}
+}
+
+#undef X
+#undef Y
+#undef VM_ALU
+
+void sensor_vm_dump(const struct sensor_vm_prog *prog)
+{
+	const struct sensor_vm_insn *insn = prog->insns;
+	int i;
+
+	printf("Compiled to %d insns, %d constants, %d bytes\n",
+		prog->num_insns, prog->num_consts,
+		(int)(prog->num_insns * sizeof(*insn) +
+			prog->num_consts * sizeof(__s32)));
+
+	for (i = 0; i < prog->num_insns; i++, insn++) {
+		if (insn->op >= VM_DATA)
+			printf("%4d %-8s", i, vm_data_names[insn->op - VM_DATA]);
+		else
+			printf("%4d %-8s", i, vm_op_names[insn->op]);
+
+		printf("a:%-4d b:%-4d len:%d flag:0x%x\n",
+			insn->a, insn->b, insn->len, insn->flag);
+	}
+
+	for (i = 0; i < prog->num_consts; i++)
+		printf("  const %d: %d\n", VM_SLOT_CONST + i, prog->consts[i]);
+}
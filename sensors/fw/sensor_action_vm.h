@@ -0,0 +1,108 @@
+#ifndef SENSOR_ACTION_VM_H
+#define SENSOR_ACTION_VM_H
+/*
+* Register based bytecode for the lowlevel actions of sensor_config
+*
+* A lowlevel_action program is a tree, ifelse nests its branches, and
+* every data action decodes its typed operands again each time it runs.
+* The vm compiles the programs of a sensor once into a flat bytecode:
+* every operand becomes an index in the slot array (private data, output
+* of before operation, temporaries, constants), ifelse becomes conditional
+* jumps, constant operations are folded and the branches of a constant
+* condition dropped.
+*
+* Compiling validates the actions too, sensor_parser doesn't generate an
+* image which the vm can't load.
+*/
+
+#define VM_REGBUF_SIZE		0x100
+
+/*slots: private data, before, temporaries, then constants*/
+#define VM_SLOT_BEFORE		PRIVATE_MAX_SIZE
+#define VM_SLOT_TMP1		(PRIVATE_MAX_SIZE + 1)
+#define VM_SLOT_TMP2		(PRIVATE_MAX_SIZE + 2)
+#define VM_SLOT_CONST		(PRIVATE_MAX_SIZE + 3)
+#define VM_MAX_SLOTS		0x100
+#define VM_MAX_CONSTS		(VM_MAX_SLOTS - VM_SLOT_CONST)
+
+#define VM_MAX_INSNS		0x800
+#define VM_MAX_IF_DEPTH		0x10
+
+/*endian op reads regbuf[a] instead of slot a*/
+#define VM_FLAG_REGBUF		0x1
+
+enum vm_opcode {
+	/*before = slot a*/
+	VM_LD = 0,
+	/*slot a = before = slot b*/
+	VM_MOV,
+	/*slot a = len bytes at regbuf[b]*/
+	VM_LDBUF,
+	/*len bytes at regbuf[a] = before = slot b*/
+	VM_STBUF,
+	/*regbuf[a] = i2c register a, before = regbuf[a]*/
+	VM_RDREG,
+	/*regbuf[a] = i2c register a = before = slot b*/
+	VM_WRREG,
+	/*if before == 0 goto a*/
+	VM_JZ,
+	VM_JMP,
+	/*sleep slot a ms*/
+	VM_SLEEP,
+	/*return before*/
+	VM_RET,
+	/*before = data_op(slot a, slot b), VM_DATA + OP_MIN ...*/
+	VM_DATA,
+	VM_OPCODE_RESERVE = VM_DATA + OP_RESERVE,
+};
+
+/*size: 8B*/
+struct sensor_vm_insn {
+	__u8 op;
+	__u8 len;
+	__u8 flag;
+	__u8 pad;
+	__u16 a;
+	__u16 b;
+};
+
+/*all programs of a sensor share the insns and constants*/
+struct sensor_vm_prog {
+	int num_insns;
+	int num_consts;
+	struct sensor_vm_insn insns[VM_MAX_INSNS];
+	__s32 consts[VM_MAX_CONSTS];
+};
+
+/*i2c access and sleep of the driver, return < 0 on error*/
+struct sensor_vm_ops {
+	int (*read)(void *data, __u8 addr, __u8 flag, __u8 *buf, int len);
+	int (*write)(void *data, __u8 addr, __u8 flag, __u8 *buf, int len);
+	void (*sleep)(void *data, int ms);
+	void *data;
+};
+
+struct sensor_vm {
+	const struct sensor_vm_prog *prog;
+	const struct sensor_vm_ops *ops;
+	__s32 slots[VM_MAX_SLOTS];
+	__u8 regbuf[VM_REGBUF_SIZE];
+};
+
+/*value of a data_op, the same when folded and when run*/
+int sensor_vm_eval(int op, int op1, int op2);
+
+void sensor_vm_prog_init(struct sensor_vm_prog *prog);
+/*return the entry of the program, or -1 if actions are not valid*/
+int sensor_vm_compile(struct sensor_vm_prog *prog,
+		const struct lowlevel_action *actions, int num);
+int sensor_vm_validate(const struct lowlevel_action *actions, int num);
+
+void sensor_vm_init(struct sensor_vm *vm, const struct sensor_vm_prog *prog,
+		const struct sensor_vm_ops *ops);
+/*run from entry with input as before, return 0 or i2c error*/
+int sensor_vm_run(struct sensor_vm *vm, int entry, int input, int *output);
+
+void sensor_vm_dump(const struct sensor_vm_prog *prog);
+
+#endif
@@ -36,6 +36,7 @@
 #include <libxml/tree.h>
 #include "sensor_driver_config.h"
 #include "sensor_parser.h"
+#include "sensor_action_vm.h"
 
 #define SENSOR_PARSER_DBG
 
@@ -575,6 +576,62 @@ static void dump_sensor_config(struct sensor_config *config)
 		dump_ll_action(&action_table[config->indexs[i].index],
 						config->indexs[i].num, 0);
 	}
+
+	dump_sensor_vm(config);
+}
+
+/*bytecode of all actions of a sensor, as the driver loads them*/
+static void dump_sensor_vm(struct sensor_config *config)
+{
+	static struct sensor_vm_prog prog;
+	struct lowlevel_action *action_table =
+			(struct lowlevel_action *)&config->actions;
+	int i;
+
+	sensor_vm_prog_init(&prog);
+
+	for (i = 0; i < SENSOR_ACTION_RESERVE; i++)
+		if (sensor_vm_compile(&prog,
+			&action_table[config->indexs[i].index],
+			config->indexs[i].num) < 0)
+			goto err;
+
+	for (i = 0; i < config->odr_entries; i++)
+		if (sensor_vm_compile(&prog,
+			&action_table[config->odr_table[i].index.index],
+			config->odr_table[i].index.num) < 0)
+			goto err;
+
+	for (i = 0; i < config->range_entries; i++)
+		if (sensor_vm_compile(&prog,
+			&action_table[config->range_table[i].index.index],
+			config->range_table[i].index.num) < 0)
+			goto err;
+
+	for (i = 0; i < config->sysfs_entries; i++) {
+		struct sysfs_entry *entry = &config->sysfs_table[i];
+
+		if (entry->type != DATA_ACTION)
+			continue;
+
+		if (sensor_vm_compile(&prog,
+			&action_table[entry->action.data.index_show.index],
+			entry->action.data.index_show.num) < 0 ||
+			sensor_vm_compile(&prog,
+			&action_table[entry->action.data.index_store.index],
+			entry->action.data.index_store.num) < 0)
+			goto err;
+	}
+
+	printf("Bytecode: \t\t%d insns, %d constants\n",
+			prog.num_insns, prog.num_consts);
+#ifdef SENSOR_PARSER_DBG
+	if (dbg_level >= LEVEL1)
+		sensor_vm_dump(&prog);
+#endif
+	return;
+err:
+	printf("Error, actions of %s are not valid\n", config->name);
 }
 
 static int sensor_xmlnode_sort(xmlNodePtr node,
@@ -1526,6 +1583,14 @@ static int parser_high2ll_actions(struct sensor_parser *parser, char *high_actio
 		goto err;
 	}
 
+	/*the driver loads the actions as bytecode, check it can*/
+	ret = sensor_vm_validate(parser->ll_actions, parser->ll_num);
+	if (ret) {
+		printf("[%d]%s Error when sensor_vm_validate\n",
+					__LINE__, __func__);
+		goto err;
+	}
+
 	if ((parser->ll_action_num + parser->ll_num) >= MAX_LL_ACTION_NUM) {
 		printf("Error, exceeds max action num\n");
 		ret = -1;
@@ -2045,6 +2110,18 @@ static int sensor_high2im_multi(struct sensor_parser *parser,
 		break;
 	}
 
+	/*if (local_0): nothing computes the condition, compare it with 0*/
+	if (isif && op_stack_empty(&parser->op_stack) &&
+		!operand_stack_empty(&parser->oper_stack) &&
+		parser->oper_stack.data[parser->oper_stack.top].type != IM_BEFORE) {
+		struct im_operand operand;
+
+		operand.type = IM_IMM;
+		operand.data.immediate = 0;
+		push_operand(&parser->oper_stack, &operand);
+		push_op(&parser->op_stack, IM_LOGIC_NEQ);
+	}
+
 	ret = sensor_tran_last_im_op(parser);
 	if (ret) {
 		printf("[%d]%s Error parser last im\n", __LINE__, __func__);
@@ -2460,77 +2537,38 @@ err:
 	return ret;
 }
 
+/*fold constant operation, the same as the driver computes it*/
 static int sensor_parser_preprocess(enum im_op_type type, int op1, int op2, int *output)
 {
 	int ret = 0;
+	int index;
+	enum data_op op;
 
-	switch (type) {
-	case IM_LOGIC_EQ:
-		ret = (op1 == op2);
-		break;
-	case IM_LOGIC_NEQ:
-		ret = (op1 != op2);
-		break;
-	case IM_LOGIC_GREATER:
-		ret = (op1 > op2);
-		break;
-	case IM_LOGIC_LESS:
-		ret = (op1 < op2);
-		break;
-	case IM_LOGIC_GE:
-		ret = (op1 >= op2);
-		break;
-	case IM_LOGIC_LE:
-		ret = (op1 <= op2);
-		break;
-
-	case IM_LOGIC_AND:
-		ret = (op1 && op2);
-		break;
-	case IM_LOGIC_OR:
-		ret = (op1 || op2);
-		break;
-
-	case IM_ARI_ADD:
-		ret = (op1 + op2);
-		break;
-	case IM_ARI_SUB:
-		ret = (op1 - op2);
-		break;
-	case IM_ARI_MUL:
-		ret = (op1 * op2);
-		break;
-	case IM_ARI_DIV:
-		ret = (op1 / op2);
-		break;
-	case IM_ARI_MOD:
-		ret = (op1 % op2);
-		break;
-
-	case IM_BIT_OR:
-		ret = (op1 | op2);
-		break;
-	case IM_BIT_AND:
-		ret = (op1 & op2);
-		break;
-	case IM_BIT_LSL:
-		ret = (op1 << op2);
-		break;
-	case IM_BIT_LSR:
-		ret = (op1 >> op2);
-		break;
-	case IM_BIT_NOR:
-		ret = (~op2);
-		break;
+	index = search_imops_by_type(type);
+	if (index < 0) {
+		printf("[%d]%s Error im tpye:%d\n", __LINE__, __func__, type);
+		ret = -1;
+		goto err;
+	}
 
-	default:
+	op = im_op_attrs[index].ll_type;
+	if (op == OP_ACCESS || op == OP_RESERVE) {
 		printf("[%d]%s Error im tpye:%d\n", __LINE__, __func__, type);
 		ret = -1;
 		goto err;
 	}
 
-	*output = ret;
-	ret = 0;
+	if ((op == OP_ARI_DIV || op == OP_ARI_MOD) && !op2) {
+		printf("[%d]%s Error divided by 0\n", __LINE__, __func__);
+		ret = -1;
+		goto err;
+	}
+
+	/*single operand is the last one*/
+	if (im_op_attrs[index].op_num == 1)
+		*output = sensor_vm_eval(op, op2, 0);
+	else
+		*output = sensor_vm_eval(op, op1, op2);
 err:
 	return ret;
 }
@@ -171,5 +171,6 @@ static void dump_im_actions(struct sensor_parser *parser);
 static void dump_ll_actions(struct sensor_parser *parser);
 
 static void dump_sensor_config(struct sensor_config *config);
+static void dump_sensor_vm(struct sensor_config *config);
 
 #endif
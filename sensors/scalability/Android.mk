@@ -41,7 +41,14 @@ LOCAL_SRC_FILES := SensorHAL.cpp    \
                    PhysicalActivitySensor.cpp \
                    GestureSensor.cpp \
                    utils.cpp \
-                   AudioClassifierSensor.cpp
+                   AudioClassifierSensor.cpp \
+                   FusionSensor.cpp \
+                   sensorfusion/FusionFilter.cpp
+
+# gravity, linear acceleration and rotation vector fused in Q29 fixed point
+ifeq ($(SENSOR_FUSION_FIXED_POINT),true)
+LOCAL_CFLAGS += -DFUSION_FIXED_POINT
+endif
 
 LOCAL_C_INCLUDES := $(COMMON_INCLUDES) \
                     $(call include-path-for, stlport) \
@@ -0,0 +1,354 @@
+#include "FusionSensor.hpp"
+
+/* SENSOR_DELAY_NORMAL */
+#define FUSION_DEFAULT_DELAY    200000000LL
+
+SensorFusion::SensorFusion()
+{
+        static const int types[FUSION_OUTPUT_MAX] = {
+                SENSOR_TYPE_GRAVITY,
+                SENSOR_TYPE_LINEAR_ACCELERATION,
+                SENSOR_TYPE_ROTATION_VECTOR,
+        };
+
+        for (int i = 0; i < FUSION_INPUT_MAX; i++) {
+                inputs[i].sensor = NULL;
+                inputs[i].clientEnabled = false;
+                inputs[i].clientDelay = FUSION_DEFAULT_DELAY;
+                inputs[i].enabled = false;
+                inputs[i].delay = -1;
+                inputs[i].samples.count = 0;
+        }
+
+        for (int i = 0; i < FUSION_OUTPUT_MAX; i++) {
+                outputs[i].enabled = false;
+                outputs[i].delay = FUSION_DEFAULT_DELAY;
+                outputs[i].lastTimestamp = 0;
+                memset(&outputs[i].event, 0, sizeof(sensors_event_t));
+                outputs[i].event.version = sizeof(sensors_event_t);
+                outputs[i].event.type = types[i];
+        }
+}
+
+int SensorFusion::getOutput(int type)
+{
+        switch (type) {
+        case SENSOR_TYPE_GRAVITY:
+                return FUSION_GRAVITY;
+        case SENSOR_TYPE_LINEAR_ACCELERATION:
+                return FUSION_LINEAR_ACCELERATION;
+        case SENSOR_TYPE_ROTATION_VECTOR:
+                return FUSION_ROTATION_VECTOR;
+        default:
+                return -1;
+        }
+}
+
+bool SensorFusion::addInput(Sensor *sensor)
+{
+        int input;
+
+        switch (sensor->getDevice().getType()) {
+        case SENSOR_TYPE_ACCELEROMETER:
+                input = FUSION_ACCEL;
+                break;
+        case SENSOR_TYPE_GYROSCOPE:
+                input = FUSION_GYRO;
+                break;
+        case SENSOR_TYPE_MAGNETIC_FIELD:
+                input = FUSION_MAG;
+                break;
+        default:
+                return false;
+        }
+
+        if (inputs[input].sensor != NULL) {
+                LOGW("%s: line: %d: %s is not a fusion input, %s already is",
+                     __FUNCTION__, __LINE__, sensor->getDevice().getName(),
+                     inputs[input].sensor->getDevice().getName());
+                return false;
+        }
+
+        inputs[input].sensor = sensor;
+        return true;
+}
+
+bool SensorFusion::canProvide(int output)
+{
+        if (inputs[FUSION_ACCEL].sensor == NULL || inputs[FUSION_GYRO].sensor == NULL)
+                return false;
+        /* the heading */
+        if (output == FUSION_ROTATION_VECTOR && inputs[FUSION_MAG].sensor == NULL)
+                return false;
+        return output >= 0 && output < FUSION_OUTPUT_MAX;
+}
+
+int SensorFusion::findInput(int handle)
+{
+        for (int i = 0; i < FUSION_INPUT_MAX; i++)
+                if (inputs[i].sensor != NULL && inputs[i].sensor->getDevice().getHandle() == handle)
+                        return i;
+        return -1;
+}
+
+/* the driver runs while the client or a fused sensor needs it, at the
+ * fastest rate of them */
+int SensorFusion::updateInput(int input)
+{
+        struct Input &in = inputs[input];
+        int handle = in.sensor->getDevice().getHandle();
+        bool enabled = in.clientEnabled;
+        int64_t delay = in.clientEnabled ? in.clientDelay : -1;
+
+        for (int i = 0; i < FUSION_OUTPUT_MAX; i++) {
+                if (!outputs[i].enabled)
+                        continue;
+                if (input == FUSION_MAG && i != FUSION_ROTATION_VECTOR)
+                        continue;
+                enabled = true;
+                if (delay < 0 || outputs[i].delay < delay)
+                        delay = outputs[i].delay;
+        }
+        if (delay < 0)
+                delay = in.clientDelay;
+
+        if (delay != in.delay) {
+                if (in.sensor->setDelay(handle, delay)) {
+                        LOGE("%s: line: %d: %s set delay error! delay: %lld",
+                             __FUNCTION__, __LINE__, in.sensor->getDevice().getName(), delay);
+                        return -1;
+                }
+                in.delay = delay;
+        }
+
+        if (enabled != in.enabled) {
+                if (in.sensor->activate(handle, enabled)) {
+                        LOGE("%s: line: %d: %s enable error! arg: %d",
+                             __FUNCTION__, __LINE__, in.sensor->getDevice().getName(), enabled);
+                        return -1;
+                }
+                in.enabled = enabled;
+                in.samples.count = 0;
+        }
+
+        return 0;
+}
+
+int SensorFusion::activateInput(int handle, int enabled)
+{
+        int input = findInput(handle);
+
+        if (input < 0)
+                return -1;
+
+        inputs[input].clientEnabled = enabled != 0;
+        return updateInput(input);
+}
+
+int SensorFusion::setInputDelay(int handle, int64_t ns)
+{
+        int input = findInput(handle);
+
+        if (input < 0)
+                return -1;
+
+        inputs[input].clientDelay = ns;
+        return updateInput(input);
+}
+
+int SensorFusion::activateOutput(int output, int handle, int enabled)
+{
+        bool running = false;
+        int ret = 0;
+
+        for (int i = 0; i < FUSION_OUTPUT_MAX; i++)
+                running = running || outputs[i].enabled;
+
+        /* a new session starts from the next accelerometer sample */
+        if (!running && enabled)
+                filter.reset();
+
+        outputs[output].enabled = enabled != 0;
+        outputs[output].event.sensor = handle;
+        outputs[output].lastTimestamp = 0;
+
+        for (int i = 0; i < FUSION_INPUT_MAX; i++)
+                if (inputs[i].sensor != NULL && updateInput(i))
+                        ret = -1;
+
+        return ret;
+}
+
+int SensorFusion::setOutputDelay(int output, int64_t ns)
+{
+        int ret = 0;
+
+        outputs[output].delay = ns;
+
+        for (int i = 0; i < FUSION_INPUT_MAX; i++)
+                if (inputs[i].sensor != NULL && updateInput(i))
+                        ret = -1;
+
+        return ret;
+}
+
+/* each fused sensor reports at its own rate, a sample up to an eighth of the
+ * period early is due: the timestamps of the inputs jitter */
+bool SensorFusion::isDue(int output, int64_t timestamp)
+{
+        struct Output &out = outputs[output];
+
+        if (!out.enabled)
+                return false;
+        if (out.lastTimestamp != 0 && timestamp - out.lastTimestamp < out.delay - out.delay / 8
+            && timestamp >= out.lastTimestamp)
+                return false;
+
+        out.lastTimestamp = timestamp;
+        return true;
+}
+
+void SensorFusion::processBatch(int input, std::queue<sensors_event_t> &eventQue)
+{
+        struct FusionSamples &samples = inputs[input].samples;
+        float gravity[3];
+
+        switch (input) {
+        case FUSION_ACCEL:
+                filter.updateAccel(samples);
+                if (!filter.isReady())
+                        break;
+
+                filter.getGravity(gravity);
+                for (int i = 0; i < samples.count; i++) {
+                        if (isDue(FUSION_GRAVITY, samples.timestamp[i])) {
+                                sensors_event_t &event = outputs[FUSION_GRAVITY].event;
+
+                                event.timestamp = samples.timestamp[i];
+                                event.data[0] = gravity[0];
+                                event.data[1] = gravity[1];
+                                event.data[2] = gravity[2];
+                                event.acceleration.status = SENSOR_STATUS_ACCURACY_MEDIUM;
+                                eventQue.push(event);
+                        }
+                        if (isDue(FUSION_LINEAR_ACCELERATION, samples.timestamp[i])) {
+                                sensors_event_t &event = outputs[FUSION_LINEAR_ACCELERATION].event;
+
+                                event.timestamp = samples.timestamp[i];
+                                event.data[0] = samples.x[i] - gravity[0];
+                                event.data[1] = samples.y[i] - gravity[1];
+                                event.data[2] = samples.z[i] - gravity[2];
+                                event.acceleration.status = SENSOR_STATUS_ACCURACY_MEDIUM;
+                                eventQue.push(event);
+                        }
+                }
+                break;
+        case FUSION_GYRO:
+                filter.updateGyro(samples, attitude);
+                if (!filter.hasHeading())
+                        break;
+
+                for (int i = 0; i < samples.count; i++) {
+                        if (isDue(FUSION_ROTATION_VECTOR, samples.timestamp[i])) {
+                                sensors_event_t &event = outputs[FUSION_ROTATION_VECTOR].event;
+                                /* same rotation, with cos(angle / 2) >= 0 */
+                                float sign = attitude.w[i] < 0 ? -1.0f : 1.0f;
+
+                                event.timestamp = samples.timestamp[i];
+                                event.data[0] = sign * attitude.x[i];
+                                event.data[1] = sign * attitude.y[i];
+                                event.data[2] = sign * attitude.z[i];
+                                event.data[3] = sign * attitude.w[i];
+                                /* heading accuracy unknown */
+                                event.data[4] = -1;
+                                eventQue.push(event);
+                        }
+                }
+                break;
+        case FUSION_MAG:
+                filter.updateMag(samples);
+                break;
+        }
+
+        samples.count = 0;
+}
+
+int SensorFusion::getInputData(Sensor *sensor, std::queue<sensors_event_t> &eventQue)
+{
+        int input = findInput(sensor->getDevice().getHandle());
+        bool running = false;
+        int ret;
+
+        if (input < 0)
+                return sensor->getData(eventQue);
+
+        struct Input &in = inputs[input];
+        ret = sensor->getData(in.eventQue);
+
+        for (int i = 0; i < FUSION_OUTPUT_MAX; i++)
+                running = running || outputs[i].enabled;
+
+        while (in.eventQue.size() > 0) {
+                const sensors_event_t &event = in.eventQue.front();
+                struct FusionSamples &samples = in.samples;
+
+                if (in.clientEnabled)
+                        eventQue.push(event);
+
+                if (running) {
+                        samples.timestamp[samples.count] = event.timestamp;
+                        samples.x[samples.count] = event.data[0];
+                        samples.y[samples.count] = event.data[1];
+                        samples.z[samples.count] = event.data[2];
+                        if (++samples.count == FUSION_BATCH_MAX)
+                                processBatch(input, eventQue);
+                }
+
+                in.eventQue.pop();
+        }
+
+        if (in.samples.count > 0)
+                processBatch(input, eventQue);
+
+        return ret;
+}
+
+FusionSensor::FusionSensor(SensorDevice &mDevice, SensorFusion &mFusion)
+        :Sensor(mDevice),
+         fusion(mFusion)
+{
+        output = SensorFusion::getOutput(device.getType());
+}
+
+int FusionSensor::activate(int handle, int enabled)
+{
+        if (handle != device.getHandle()) {
+                LOGE("%s: line: %d: %s handle not match! handle: %d required handle: %d",
+                     __FUNCTION__, __LINE__, device.getName(), device.getHandle(), handle);
+                return -1;
+        }
+
+        return fusion.activateOutput(output, handle, enabled);
+}
+
+int FusionSensor::setDelay(int handle, int64_t ns)
+{
+        /* the minDelay of the platform config bounds the rate */
+        int64_t minDelay = static_cast<int64_t>(device.getMinDelay()) * 1000;
+
+        if (handle != device.getHandle()) {
+                LOGE("%s: line: %d: %s handle not match! handle: %d required handle: %d",
+                     __FUNCTION__, __LINE__, device.getName(), device.getHandle(), handle);
+                return -1;
+        }
+
+        if (ns < minDelay)
+                ns = minDelay;
+
+        return fusion.setOutputDelay(output, ns);
+}
+
+bool FusionSensor::selftest()
+{
+        return output >= 0 && fusion.canProvide(output);
+}
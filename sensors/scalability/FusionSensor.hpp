@@ -0,0 +1,80 @@
+#ifndef _FUSION_SENSOR_HPP_
+#define _FUSION_SENSOR_HPP_
+#include "Sensor.hpp"
+#include "sensorfusion/FusionFilter.h"
+
+typedef enum {
+        FUSION_ACCEL = 0,
+        FUSION_GYRO,
+        FUSION_MAG,
+        FUSION_INPUT_MAX
+} fusion_input_t;
+
+typedef enum {
+        FUSION_GRAVITY = 0,
+        FUSION_LINEAR_ACCELERATION,
+        FUSION_ROTATION_VECTOR,
+        FUSION_OUTPUT_MAX
+} fusion_output_t;
+
+/* Fusion of the accelerometer, gyroscope and compass on the AP, for the
+ * platforms without sensor hub. The inputs are the usual direct sensors:
+ * the HAL routes their activate, setDelay and getData through the fusion,
+ * which keeps them running while a fused sensor needs them, and forwards
+ * their events only when the client enabled them too.
+ */
+class SensorFusion {
+        struct Input {
+                Sensor *sensor;
+                bool clientEnabled;
+                int64_t clientDelay;
+                bool enabled;
+                int64_t delay;
+                std::queue<sensors_event_t> eventQue;
+                struct FusionSamples samples;
+        };
+        struct Output {
+                bool enabled;
+                int64_t delay;
+                int64_t lastTimestamp;
+                sensors_event_t event;
+        };
+        struct Input inputs[FUSION_INPUT_MAX];
+        struct Output outputs[FUSION_OUTPUT_MAX];
+        struct FusionAttitude attitude;
+#ifdef FUSION_FIXED_POINT
+        FusionFilterFixed filter;
+#else
+        FusionFilter filter;
+#endif
+        int findInput(int handle);
+        int updateInput(int input);
+        bool isDue(int output, int64_t timestamp);
+        void processBatch(int input, std::queue<sensors_event_t> &eventQue);
+public:
+        SensorFusion();
+        static int getOutput(int type);
+        bool addInput(Sensor *sensor);
+        bool canProvide(int output);
+        bool isInput(int handle) { return findInput(handle) >= 0; }
+        int activateInput(int handle, int enabled);
+        int setInputDelay(int handle, int64_t ns);
+        int getInputData(Sensor *sensor, std::queue<sensors_event_t> &eventQue);
+        int activateOutput(int output, int handle, int enabled);
+        int setOutputDelay(int output, int64_t ns);
+};
+
+class FusionSensor : public Sensor {
+        SensorFusion &fusion;
+        int output;
+public:
+        FusionSensor(SensorDevice &mDevice, SensorFusion &mFusion);
+        /* the events come with the ones of the inputs */
+        int getPollfd() { return -1; }
+        int activate(int handle, int enabled);
+        int setDelay(int handle, int64_t ns);
+        int getData(std::queue<sensors_event_t> &eventQue) { return 0; }
+        bool selftest();
+};
+
+#endif
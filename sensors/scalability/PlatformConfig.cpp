@@ -1,16 +1,120 @@
 #include <iostream>
 #include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <cutils/properties.h>
 #include "PlatformConfig.hpp"
 #include "VirtualSensor.hpp"
+#include "utils.hpp"
+
+/* The XML config is compiled into a flat binary cache the first time the
+ * HAL loads it, and later loads map the cache instead of parsing the XML.
+ * The cache is rebuilt when its version, the size of struct sensor_t or
+ * the size and content hash of the XML file don't match. The mtime is not
+ * used: OTA and factory images give every file the same one.
+ *
+ * Layout: CacheHeader, CacheDevice[deviceCount], CachePlatformData[dataCount],
+ * then the strings, each NUL terminated, referenced by offset.
+ */
+#define CONFIG_CACHE_DIR        "/data/system/"
+#define CONFIG_CACHE_MAGIC      0x43434853      /* "SHCC" */
+#define CONFIG_CACHE_VERSION    2
+#define CACHE_NO_STRING         0xffffffff
+
+struct CacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t sensorSize;
+        uint32_t size;
+        int64_t xmlSize;
+        uint64_t xmlHash;
+        uint32_t deviceCount;
+        uint32_t dataCount;
+        uint32_t stringsSize;
+        uint32_t reserved;
+};
+
+struct CacheDevice {
+        uint32_t name;
+        uint32_t vendor;
+        int32_t id;
+        int32_t handle;
+        int32_t type;
+        int32_t version;
+        int32_t minDelay;
+        float maxRange;
+        float resolution;
+        float power;
+        int32_t category;
+        int32_t eventProperty;
+        int32_t subname;
+        int32_t mapper[AXIS_MAX];
+        float scale[AXIS_MAX];
+};
+
+enum {
+        DATA_NAME = 0,
+        DATA_ACTIVATE,
+        DATA_SET_DELAY,
+        DATA_DATA,
+        DATA_CALIBRATION_FILE,
+        DATA_CALIBRATION_FUNC,
+        DATA_DRIVER_CALIBRATION,
+        DATA_DRIVER_CALIBRATION_FILE,
+        DATA_DRIVER_CALIBRATION_FUNC,
+        DATA_STRINGS
+};
+
+struct CachePlatformData {
+        int32_t id;
+        int32_t driverNodeType;
+        int32_t filterLength;
+        uint32_t strings[DATA_STRINGS];
+};
+
+static std::string PlatformData::* const dataStrings[DATA_STRINGS] = {
+        &PlatformData::name,
+        &PlatformData::activateInterface,
+        &PlatformData::setDelayInterface,
+        &PlatformData::dataInterface,
+        &PlatformData::calibrationFile,
+        &PlatformData::calibrationFunc,
+        &PlatformData::driverCalibrationInterface,
+        &PlatformData::driverCalibrationFile,
+        &PlatformData::driverCalibrationFunc,
+};
+
+/* FNV-1a of the whole file, a few kB: much cheaper than parsing it */
+static bool hashFile(const std::string &file, uint64_t &hash)
+{
+        unsigned char buf[4096];
+        ssize_t len;
+        int fd;
+
+        fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+                return false;
+
+        hash = 14695981039346656037ULL;
+        while ((len = read(fd, buf, sizeof(buf))) > 0) {
+                for (ssize_t i = 0; i < len; i++)
+                        hash = (hash ^ buf[i]) * 1099511628211ULL;
+        }
+        close(fd);
+
+        return len == 0;
+}
 
 PlatformConfig::PlatformConfig()
 {
-        xmlDocPtr doc;
-        xmlNodePtr root;
         std::string file;
+        std::string cache;
         std::string prop;
         char buf[PROPERTY_VALUE_MAX];
+        struct stat xmlStat;
+        uint64_t xmlHash;
+        int64_t start;
         int ret=-1;
 
         ret = property_get("ro.sensors.mapper", buf, NULL);
@@ -22,29 +126,268 @@ PlatformConfig::PlatformConfig()
                 prop=buf;
         }
         file="/system/etc/sensor_hal_config_"+prop+".xml";
+        cache=CONFIG_CACHE_DIR "sensor_hal_config_"+prop+".bin";
+
+        if (stat(file.c_str(), &xmlStat) != 0) {
+                LOGE("Cannot stat %s\n", file.c_str());
+                return;
+        }
+
+        start = getTimestamp();
+        if (!hashFile(file, xmlHash)) {
+                LOGE("Cannot read %s\n", file.c_str());
+                return;
+        }
+        if (loadCache(cache, xmlStat, xmlHash)) {
+                LOGI("%u sensors loaded from %s in %lld us", size(),
+                     cache.c_str(), (getTimestamp() - start) / 1000);
+                return;
+        }
+
+        start = getTimestamp();
+        if (!loadXML(file))
+                return;
+        LOGI("%u sensors parsed from %s in %lld us", size(),
+             file.c_str(), (getTimestamp() - start) / 1000);
+
+        saveCache(cache, xmlStat, xmlHash);
+}
+
+bool PlatformConfig::loadXML(const std::string &file)
+{
+        xmlDocPtr doc;
+        xmlNodePtr root;
 
         doc = xmlReadFile(file.c_str(), NULL, XML_PARSE_NOBLANKS);
         if (doc==NULL) {
                 LOGE("XML Document not parsed successfully.\n");
-                return;
+                return false;
         }
 
         root=xmlDocGetRootElement(doc);
         if (root==NULL) {
                 LOGE("Empty XML document\n");
                 xmlFreeDoc(doc);
-                return;
+                return false;
         }
 
         if (xmlStrcmp(root->name, (const xmlChar *)"sensor_hal_config")) {
                 LOGE("Wrong XML document, cannot find \"sensor_hal_config\" element!\n");
                 xmlFreeDoc(doc);
-                return;
+                return false;
         }
 
         initXML(root->xmlChildrenNode);
 
         xmlFreeDoc(doc);
+
+        return true;
+}
+
+static const char* cacheString(const char *strings, uint32_t size, uint32_t offset)
+{
+        if (offset == CACHE_NO_STRING || offset >= size)
+                return NULL;
+        return strings + offset;
+}
+
+bool PlatformConfig::loadCache(const std::string &cache, const struct stat &xmlStat, uint64_t xmlHash)
+{
+        const struct CacheHeader *header;
+        const struct CacheDevice *cachedDevices;
+        const struct CachePlatformData *cachedData;
+        const char *strings;
+        struct stat cacheStat;
+        void *map;
+        int fd;
+        bool valid;
+
+        fd = open(cache.c_str(), O_RDONLY);
+        if (fd < 0)
+                return false;
+
+        if (fstat(fd, &cacheStat) != 0 || cacheStat.st_size < (off_t)sizeof(*header)) {
+                close(fd);
+                return false;
+        }
+
+        map = mmap(NULL, cacheStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED)
+                return false;
+
+        header = reinterpret_cast<const struct CacheHeader *>(map);
+        cachedDevices = reinterpret_cast<const struct CacheDevice *>(header + 1);
+        cachedData = reinterpret_cast<const struct CachePlatformData *>(cachedDevices + header->deviceCount);
+        strings = reinterpret_cast<const char *>(cachedData + header->dataCount);
+
+        valid = header->magic == CONFIG_CACHE_MAGIC &&
+                header->version == CONFIG_CACHE_VERSION &&
+                header->sensorSize == sizeof(struct sensor_t) &&
+                header->size == cacheStat.st_size &&
+                header->xmlSize == xmlStat.st_size &&
+                header->xmlHash == xmlHash &&
+                header->deviceCount <= header->size / sizeof(*cachedDevices) &&
+                header->dataCount <= header->size / sizeof(*cachedData) &&
+                sizeof(*header) + header->deviceCount * sizeof(*cachedDevices) +
+                header->dataCount * sizeof(*cachedData) + header->stringsSize == header->size &&
+                header->stringsSize > 0 && strings[header->stringsSize - 1] == '\0';
+        if (!valid) {
+                LOGW("%s is out of date, parsing the XML config", cache.c_str());
+                munmap(map, cacheStat.st_size);
+                return false;
+        }
+
+        devices.reserve(header->deviceCount);
+        for (uint32_t i = 0; i < header->deviceCount; i++) {
+                const struct CacheDevice *cached = &cachedDevices[i];
+                const char *str;
+                SensorDevice mSensor;
+
+                str = cacheString(strings, header->stringsSize, cached->name);
+                if (str != NULL)
+                        mSensor.setName(str);
+                str = cacheString(strings, header->stringsSize, cached->vendor);
+                if (str != NULL)
+                        mSensor.setVendor(str);
+                mSensor.setId(cached->id);
+                mSensor.setHandle(cached->handle);
+                mSensor.setType(cached->type);
+                mSensor.setVersion(cached->version);
+                mSensor.setMinDelay(cached->minDelay);
+                mSensor.setMaxRange(cached->maxRange);
+                mSensor.setResolution(cached->resolution);
+                mSensor.setPower(cached->power);
+                mSensor.setCategory(static_cast<sensor_category_t>(cached->category));
+                mSensor.setEventProperty(static_cast<sensors_event_property_t>(cached->eventProperty));
+                mSensor.setSubname(static_cast<sensors_subname>(cached->subname));
+                for (int axis = 0; axis < AXIS_MAX; axis++) {
+                        mSensor.setMapper(axis, cached->mapper[axis]);
+                        mSensor.setScale(axis, cached->scale[axis]);
+                }
+
+                devices.push_back(mSensor);
+        }
+
+        for (uint32_t i = 0; i < header->dataCount; i++) {
+                const struct CachePlatformData *cached = &cachedData[i];
+                struct PlatformData mData;
+
+                for (int j = 0; j < DATA_STRINGS; j++) {
+                        const char *str = cacheString(strings, header->stringsSize, cached->strings[j]);
+                        if (str != NULL)
+                                mData.*dataStrings[j] = str;
+                }
+                mData.driverNodeType = static_cast<sensor_driver_node_type>(cached->driverNodeType);
+                mData.filterLength = cached->filterLength != 0;
+
+                configs.insert(std::map<int,struct PlatformData>::value_type(cached->id, mData));
+        }
+
+        munmap(map, cacheStat.st_size);
+
+        return true;
+}
+
+static uint32_t addCacheString(std::string &strings, const char *str)
+{
+        uint32_t offset;
+
+        if (str == NULL)
+                return CACHE_NO_STRING;
+
+        offset = strings.size();
+        strings.append(str);
+        strings.push_back('\0');
+
+        return offset;
+}
+
+bool PlatformConfig::saveCache(const std::string &cache, const struct stat &xmlStat, uint64_t xmlHash)
+{
+        struct CacheHeader header;
+        std::vector<struct CacheDevice> cachedDevices(devices.size());
+        std::vector<struct CachePlatformData> cachedData;
+        std::string strings;
+        std::string tmp = cache + ".tmp";
+        bool written;
+        int fd;
+
+        for (unsigned int i = 0; i < devices.size(); i++) {
+                SensorDevice &device = devices[i];
+                struct CacheDevice &cached = cachedDevices[i];
+
+                memset(&cached, 0, sizeof(cached));
+                cached.name = addCacheString(strings, device.getName());
+                cached.vendor = addCacheString(strings, device.getVendor());
+                cached.id = device.getId();
+                cached.handle = device.getHandle();
+                cached.type = device.getType();
+                cached.version = device.getVersion();
+                cached.minDelay = device.getMinDelay();
+                cached.maxRange = device.getMaxRange();
+                cached.resolution = device.getResolution();
+                cached.power = device.getPower();
+                cached.category = device.getCategory();
+                cached.eventProperty = device.getEventProperty();
+                cached.subname = device.getSubname();
+                for (int axis = 0; axis < AXIS_MAX; axis++) {
+                        cached.mapper[axis] = device.getMapper(axis);
+                        cached.scale[axis] = device.getScale(axis);
+                }
+        }
+
+        for (std::map<int,struct PlatformData>::iterator it = configs.begin(); it != configs.end(); it++) {
+                struct CachePlatformData cached;
+
+                memset(&cached, 0, sizeof(cached));
+                cached.id = it->first;
+                cached.driverNodeType = it->second.driverNodeType;
+                cached.filterLength = it->second.filterLength;
+                for (int j = 0; j < DATA_STRINGS; j++)
+                        cached.strings[j] = addCacheString(strings, (it->second.*dataStrings[j]).c_str());
+                cachedData.push_back(cached);
+        }
+        /* never empty, so the last byte can be checked for NUL */
+        strings.push_back('\0');
+
+        memset(&header, 0, sizeof(header));
+        header.magic = CONFIG_CACHE_MAGIC;
+        header.version = CONFIG_CACHE_VERSION;
+        header.sensorSize = sizeof(struct sensor_t);
+        header.xmlSize = xmlStat.st_size;
+        header.xmlHash = xmlHash;
+        header.deviceCount = cachedDevices.size();
+        header.dataCount = cachedData.size();
+        header.stringsSize = strings.size();
+        header.size = sizeof(header) + cachedDevices.size() * sizeof(struct CacheDevice) +
+                cachedData.size() * sizeof(struct CachePlatformData) + strings.size();
+
+        fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+                LOGW("Cannot create %s", tmp.c_str());
+                return false;
+        }
+
+        written = write(fd, &header, sizeof(header)) == sizeof(header) &&
+                (cachedDevices.empty() || write(fd, &cachedDevices[0],
+                        cachedDevices.size() * sizeof(struct CacheDevice)) ==
+                        (ssize_t)(cachedDevices.size() * sizeof(struct CacheDevice))) &&
+                (cachedData.empty() || write(fd, &cachedData[0],
+                        cachedData.size() * sizeof(struct CachePlatformData)) ==
+                        (ssize_t)(cachedData.size() * sizeof(struct CachePlatformData))) &&
+                write(fd, strings.data(), strings.size()) == (ssize_t)strings.size() &&
+                fsync(fd) == 0;
+        close(fd);
+
+        /* a reader never sees a partial cache */
+        if (!written || rename(tmp.c_str(), cache.c_str()) != 0) {
+                LOGW("Cannot write %s", cache.c_str());
+                unlink(tmp.c_str());
+                return false;
+        }
+
+        return true;
 }
 
 bool PlatformConfig::initXML(xmlNodePtr node)
@@ -3,6 +3,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <sys/stat.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include "SensorDevice.hpp"
@@ -14,6 +15,9 @@ class PlatformConfig {
         std::vector<SensorDevice> devices;
         int count;
         bool initialized;
+        bool loadXML(const std::string &file);
+        bool loadCache(const std::string &cache, const struct stat &xmlStat, uint64_t xmlHash);
+        bool saveCache(const std::string &cache, const struct stat &xmlStat, uint64_t xmlHash);
         bool initXML(xmlNodePtr node);
         bool addPlatformData(xmlNodePtr node, std::string type);
         bool addSensorDevice(xmlNodePtr node, std::string type, std::string category);
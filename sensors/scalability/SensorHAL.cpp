@@ -7,6 +7,7 @@
 #include "PhysicalActivitySensor.hpp"
 #include "GestureSensor.hpp"
 #include "AudioClassifierSensor.hpp"
+#include "FusionSensor.hpp"
 #include <poll.h>
 
 static int open(const struct hw_module_t* module, const char* id,
@@ -20,6 +21,7 @@ struct SensorModule {
         struct sensor_t* list;
         std::vector<Sensor*> sensors;
         struct pollfd *pollfds;
+        SensorFusion *fusion;
         int count;
 };
 
@@ -46,12 +48,50 @@ common: {
 get_sensors_list: get_sensors_list,
 };
 
+/* the fused sensors of the platform config, once the direct sensors are
+ * there to feed them */
+static void initFusion(PlatformConfig &mConfig, std::vector<int> &fusionIds, int &newId)
+{
+        SensorDevice mDevice;
+        Sensor* mSensor;
+        int count = 0;
+
+        mModule.fusion = new SensorFusion();
+        for (unsigned int i = 0; i < mModule.sensors.size(); i++)
+                if (mModule.sensors[i]->getDevice().getCategory() == LINUX_DRIVER)
+                        mModule.fusion->addInput(mModule.sensors[i]);
+
+        for (unsigned int i = 0; i < fusionIds.size(); i++) {
+                if (!mConfig.getSensorDevice(fusionIds[i], mDevice))
+                        continue;
+
+                mSensor = new FusionSensor(mDevice, *mModule.fusion);
+                if (!mSensor->selftest()) {
+                        LOGW("%s: no inputs to fuse %s", __FUNCTION__, mDevice.getName());
+                        delete mSensor;
+                        continue;
+                }
+                mSensor->getDevice().setId(newId);
+                mSensor->getDevice().setHandle(SensorDevice::idToHandle(newId));
+                mSensor->resetEventHandle();
+                mModule.sensors.push_back(mSensor);
+                newId++;
+                count++;
+        }
+
+        if (count == 0) {
+                delete mModule.fusion;
+                mModule.fusion = NULL;
+        }
+}
+
 static bool initSensors()
 {
         PlatformConfig mConfig;
         SensorDevice mDevice;
         struct PlatformData mData;
         Sensor* mSensor = NULL;
+        std::vector<int> fusionIds;
         unsigned int size;
 
         size = mConfig.size();
@@ -106,6 +146,9 @@ static bool initSensors()
                                 LOGE("%s Unsupported sensor type: %d\n", __FUNCTION__, mDevice.getType());
                                 return false;
                         }
+                } else if (SensorFusion::getOutput(mDevice.getType()) >= 0) {
+                        fusionIds.push_back(i);
+                        continue;
                 } else {
                         if (!mConfig.getPlatformData(i, mData)) {
                                 LOGE("Get Platform Data config error\n");
@@ -147,6 +190,9 @@ static bool initSensors()
                 }
         }
 
+        if (fusionIds.size() > 0)
+                initFusion(mConfig, fusionIds, newId);
+
         mModule.count = mModule.sensors.size();
         mModule.list = new sensor_t[mModule.count];
 
@@ -173,6 +219,8 @@ int sensorActivate(struct sensors_poll_device_t *dev, int handle, int enabled)
                 return -1;
         }
 
+        if (mModule.fusion != NULL && mModule.fusion->isInput(handle))
+                return mModule.fusion->activateInput(handle, enabled);
         return mModule.sensors[id]->activate(handle, enabled);
 }
 
@@ -184,6 +232,8 @@ int sensorSetDelay(struct sensors_poll_device_t *dev, int handle, int64_t ns)
                      __FUNCTION__, __LINE__, handle, id);
                 return -1;
         }
+        if (mModule.fusion != NULL && mModule.fusion->isInput(handle))
+                return mModule.fusion->setInputDelay(handle, ns);
         return mModule.sensors[id]->setDelay(handle, ns);
 
 }
@@ -211,7 +261,9 @@ int sensorPoll(struct sensors_poll_device_t *dev, sensors_event_t* data, int cou
                         return -err;
                 }
                 for (int i = 0; i < mModule.count; i++) {
-                        if (mModule.pollfds[i].revents & POLLIN)
+                        if ((mModule.pollfds[i].revents & POLLIN) && mModule.fusion != NULL)
+                                mModule.fusion->getInputData(mModule.sensors[i], eventQue);
+                        else if (mModule.pollfds[i].revents & POLLIN)
                                 mModule.sensors[i]->getData(eventQue);
                         else if (mModule.pollfds[i].revents != 0)
                                 LOGE("%s: line: %d poll error: %d fd: %d type: %d", __FUNCTION__, __LINE__, mModule.pollfds[i].revents, mModule.pollfds[i].fd, mModule.sensors[i]->getDevice().getType());
@@ -232,6 +284,8 @@ int close(struct hw_device_t* device)
         }
         if (mModule.pollfds)
                 delete [] mModule.pollfds;
+        if (mModule.fusion)
+                delete mModule.fusion;
 
         return 0;
 }
@@ -0,0 +1,381 @@
+#include <math.h>
+#include <string.h>
+#include "FusionFilter.h"
+
+/* feedback gains: tilt and heading converge in about 1/kp seconds */
+#define FUSION_KP               0.2f
+#define FUSION_KI               0.02f
+/* bound of the estimated gyroscope bias, rad/s */
+#define FUSION_MAX_BIAS         0.1f
+/* a larger gap between two samples is a restart of the sensor */
+#define FUSION_MAX_DT_NS        100000000LL
+/* accelerometer samples further than this from 1g carry motion, not tilt */
+#define FUSION_ACCEL_TOLERANCE  0.2f
+
+FusionFloat::value FusionFloat::renorm(value n)
+{
+        return 1.0f / sqrtf(n);
+}
+
+static void normalize(float v[3])
+{
+        float n = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+        if (n > 0) {
+                v[0] /= n;
+                v[1] /= n;
+                v[2] /= n;
+        }
+}
+
+static void cross(const float a[3], const float b[3], float c[3])
+{
+        c[0] = a[1] * b[2] - a[2] * b[1];
+        c[1] = a[2] * b[0] - a[0] * b[2];
+        c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/* rows of the rotation from the device frame to the world frame */
+static void attitudeToMatrix(const float q[4], float r[3][3])
+{
+        float w = q[0], x = q[1], y = q[2], z = q[3];
+
+        r[0][0] = 1 - 2 * (y * y + z * z);
+        r[0][1] = 2 * (x * y - w * z);
+        r[0][2] = 2 * (x * z + w * y);
+        r[1][0] = 2 * (x * y + w * z);
+        r[1][1] = 1 - 2 * (x * x + z * z);
+        r[1][2] = 2 * (y * z - w * x);
+        r[2][0] = 2 * (x * z - w * y);
+        r[2][1] = 2 * (y * z + w * x);
+        r[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+static void matrixToAttitude(const float r[3][3], float q[4])
+{
+        float trace = r[0][0] + r[1][1] + r[2][2];
+        float s;
+
+        if (trace > 0) {
+                s = sqrtf(trace + 1) * 2;
+                q[0] = s / 4;
+                q[1] = (r[2][1] - r[1][2]) / s;
+                q[2] = (r[0][2] - r[2][0]) / s;
+                q[3] = (r[1][0] - r[0][1]) / s;
+        } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+                s = sqrtf(1 + r[0][0] - r[1][1] - r[2][2]) * 2;
+                q[0] = (r[2][1] - r[1][2]) / s;
+                q[1] = s / 4;
+                q[2] = (r[0][1] + r[1][0]) / s;
+                q[3] = (r[0][2] + r[2][0]) / s;
+        } else if (r[1][1] > r[2][2]) {
+                s = sqrtf(1 + r[1][1] - r[0][0] - r[2][2]) * 2;
+                q[0] = (r[0][2] - r[2][0]) / s;
+                q[1] = (r[0][1] + r[1][0]) / s;
+                q[2] = s / 4;
+                q[3] = (r[1][2] + r[2][1]) / s;
+        } else {
+                s = sqrtf(1 + r[2][2] - r[0][0] - r[1][1]) * 2;
+                q[0] = (r[1][0] - r[0][1]) / s;
+                q[1] = (r[0][2] + r[2][0]) / s;
+                q[2] = (r[1][2] + r[2][1]) / s;
+                q[3] = s / 4;
+        }
+}
+
+template <class A>
+FusionFilterBase<A>::FusionFilterBase()
+{
+        kp = FUSION_KP;
+        ki = FUSION_KI;
+        reset();
+}
+
+template <class A>
+void FusionFilterBase<A>::reset()
+{
+        q[0] = A::one();
+        q[1] = q[2] = q[3] = 0;
+        memset(feedback, 0, sizeof(feedback));
+        memset(integral, 0, sizeof(integral));
+        memset(accelError, 0, sizeof(accelError));
+        memset(magError, 0, sizeof(magError));
+        memset(mag, 0, sizeof(mag));
+        lastAccel = 0;
+        lastGyro = 0;
+        lastMag = 0;
+        ready = false;
+        hasMag = false;
+        magInit = false;
+}
+
+/* attitude straight from gravity, and north when the magnetometer is there,
+ * as SensorManager.getRotationMatrix() */
+template <class A>
+void FusionFilterBase<A>::init(const float a[3])
+{
+        float r[3][3], attitude[4];
+        float up[3] = { a[0], a[1], a[2] };
+        float y[3] = { 0, 1, 0 };
+
+        normalize(up);
+        if (hasMag)
+                cross(mag, up, r[0]);
+        else
+                cross(y, up, r[0]);
+        /* device y axis vertical, or the field along gravity */
+        if (r[0][0] * r[0][0] + r[0][1] * r[0][1] + r[0][2] * r[0][2] < 1e-6f) {
+                float x[3] = { 1, 0, 0 };
+                cross(up, x, r[0]);
+        }
+        normalize(r[0]);
+        cross(up, r[0], r[1]);
+        memcpy(r[2], up, sizeof(up));
+
+        matrixToAttitude(r, attitude);
+        for (int i = 0; i < 4; i++)
+                q[i] = A::fromFloat(attitude[i]);
+
+        memset(accelError, 0, sizeof(accelError));
+        memset(magError, 0, sizeof(magError));
+        updateFeedback();
+        magInit = hasMag;
+        ready = true;
+}
+
+/* the integral of the error is the gyroscope bias */
+template <class A>
+void FusionFilterBase<A>::integrate(const float error[3], float dt)
+{
+        for (int i = 0; i < 3; i++) {
+                integral[i] += ki * error[i] * dt;
+                if (integral[i] > FUSION_MAX_BIAS)
+                        integral[i] = FUSION_MAX_BIAS;
+                else if (integral[i] < -FUSION_MAX_BIAS)
+                        integral[i] = -FUSION_MAX_BIAS;
+        }
+}
+
+template <class A>
+void FusionFilterBase<A>::updateFeedback()
+{
+        for (int i = 0; i < 3; i++)
+                feedback[i] = kp * (accelError[i] + magError[i]) + integral[i];
+}
+
+template <class A>
+void FusionFilterBase<A>::updateAccel(const FusionSamples &accel)
+{
+        int count = accel.count;
+        float attitude[4], v[3];
+        float ex = 0, ey = 0, ez = 0, used = 0;
+
+        if (count <= 0)
+                return;
+
+        if (!ready || (hasMag && !magInit)) {
+                float a[3] = { accel.x[count - 1], accel.y[count - 1], accel.z[count - 1] };
+
+                init(a);
+                lastAccel = accel.timestamp[count - 1];
+                return;
+        }
+
+        /* gravity direction in the device frame, the attitude doesn't move
+         * during the batch */
+        getAttitude(attitude);
+        v[0] = 2 * (attitude[1] * attitude[3] - attitude[0] * attitude[2]);
+        v[1] = 2 * (attitude[2] * attitude[3] + attitude[0] * attitude[1]);
+        v[2] = 1 - 2 * (attitude[1] * attitude[1] + attitude[2] * attitude[2]);
+
+        for (int i = 0; i < count; i++) {
+                float norm = sqrtf(accel.x[i] * accel.x[i] + accel.y[i] * accel.y[i]
+                                   + accel.z[i] * accel.z[i]);
+                float weight = fabsf(norm - FUSION_G) < FUSION_G * FUSION_ACCEL_TOLERANCE ?
+                               1.0f / norm : 0.0f;
+                float ax = accel.x[i] * weight;
+                float ay = accel.y[i] * weight;
+                float az = accel.z[i] * weight;
+
+                ex += ay * v[2] - az * v[1];
+                ey += az * v[0] - ax * v[2];
+                ez += ax * v[1] - ay * v[0];
+                used += weight > 0 ? 1.0f : 0.0f;
+        }
+
+        if (used > 0) {
+                int64_t span = accel.timestamp[count - 1] - lastAccel;
+                float dt = 0;
+
+                if (lastAccel != 0 && span > 0 && span < FUSION_MAX_DT_NS * count)
+                        dt = span * 1e-9f;
+
+                accelError[0] = ex / used;
+                accelError[1] = ey / used;
+                accelError[2] = ez / used;
+                integrate(accelError, dt);
+        } else {
+                memset(accelError, 0, sizeof(accelError));
+        }
+        lastAccel = accel.timestamp[count - 1];
+
+        updateFeedback();
+}
+
+template <class A>
+void FusionFilterBase<A>::updateMag(const FusionSamples &samples)
+{
+        int count = samples.count;
+        float attitude[4], r[3][3], v[3];
+        float ex = 0, ey = 0, ez = 0, dot;
+        int64_t span;
+
+        if (count <= 0)
+                return;
+
+        mag[0] = samples.x[count - 1];
+        mag[1] = samples.y[count - 1];
+        mag[2] = samples.z[count - 1];
+        normalize(mag);
+        hasMag = true;
+
+        /* the next accelerometer batch initializes the heading */
+        if (!ready || !magInit) {
+                lastMag = 0;
+                return;
+        }
+
+        getAttitude(attitude);
+        attitudeToMatrix(attitude, r);
+        v[0] = r[2][0];
+        v[1] = r[2][1];
+        v[2] = r[2][2];
+
+        for (int i = 0; i < count; i++) {
+                float norm = sqrtf(samples.x[i] * samples.x[i] + samples.y[i] * samples.y[i]
+                                   + samples.z[i] * samples.z[i]);
+                float inv = norm > 0 ? 1.0f / norm : 0.0f;
+                float mx = samples.x[i] * inv;
+                float my = samples.y[i] * inv;
+                float mz = samples.z[i] * inv;
+                /* field in the world frame, then turned to the north */
+                float hx = r[0][0] * mx + r[0][1] * my + r[0][2] * mz;
+                float hy = r[1][0] * mx + r[1][1] * my + r[1][2] * mz;
+                float hz = r[2][0] * mx + r[2][1] * my + r[2][2] * mz;
+                float by = sqrtf(hx * hx + hy * hy);
+                /* back in the device frame */
+                float wx = by * r[1][0] + hz * r[2][0];
+                float wy = by * r[1][1] + hz * r[2][1];
+                float wz = by * r[1][2] + hz * r[2][2];
+
+                ex += my * wz - mz * wy;
+                ey += mz * wx - mx * wz;
+                ez += mx * wy - my * wx;
+        }
+
+        /* only the heading, around the vertical: disturbed fields don't
+         * tilt the attitude */
+        dot = (ex * v[0] + ey * v[1] + ez * v[2]) / count;
+        for (int i = 0; i < 3; i++)
+                magError[i] = dot * v[i];
+
+        span = samples.timestamp[count - 1] - lastMag;
+        if (lastMag != 0 && span > 0 && span < FUSION_MAX_DT_NS * count)
+                integrate(magError, span * 1e-9f);
+        lastMag = samples.timestamp[count - 1];
+
+        updateFeedback();
+}
+
+template <class A>
+void FusionFilterBase<A>::updateGyro(const FusionSamples &gyro, FusionAttitude &out)
+{
+        int count = gyro.count;
+        float dt[FUSION_BATCH_MAX];
+        value hx[FUSION_BATCH_MAX], hy[FUSION_BATCH_MAX], hz[FUSION_BATCH_MAX];
+        value w = q[0], x = q[1], y = q[2], z = q[3];
+        value n, s;
+
+        if (count <= 0)
+                return;
+
+        /* half of the time step, 0 across gaps */
+        for (int i = 0; i < count; i++) {
+                int64_t d = gyro.timestamp[i] - (i > 0 ? gyro.timestamp[i - 1] : lastGyro);
+
+                dt[i] = d > 0 && d < FUSION_MAX_DT_NS ? d * 0.5e-9f : 0.0f;
+        }
+        if (lastGyro == 0 || !ready)
+                dt[0] = 0;
+        lastGyro = gyro.timestamp[count - 1];
+
+        if (!ready) {
+                for (int i = 0; i < count; i++) {
+                        out.w[i] = 1;
+                        out.x[i] = out.y[i] = out.z[i] = 0;
+                }
+                return;
+        }
+
+        /* half rotation vector of each sample, corrected by the feedback */
+        for (int i = 0; i < count; i++) {
+                hx[i] = A::fromFloat((gyro.x[i] + feedback[0]) * dt[i]);
+                hy[i] = A::fromFloat((gyro.y[i] + feedback[1]) * dt[i]);
+                hz[i] = A::fromFloat((gyro.z[i] + feedback[2]) * dt[i]);
+        }
+
+        /* q = q * (1 - |h|^2 / 2, h), accurate to |h|^4; the norm drifts as
+         * little and is restored once per batch */
+        for (int i = 0; i < count; i++) {
+                value dw = A::one() - A::half(A::mul(hx[i], hx[i]) + A::mul(hy[i], hy[i])
+                                              + A::mul(hz[i], hz[i]));
+                value nw = A::mul(w, dw) - A::mul(x, hx[i]) - A::mul(y, hy[i]) - A::mul(z, hz[i]);
+                value nx = A::mul(w, hx[i]) + A::mul(x, dw) + A::mul(y, hz[i]) - A::mul(z, hy[i]);
+                value ny = A::mul(w, hy[i]) - A::mul(x, hz[i]) + A::mul(y, dw) + A::mul(z, hx[i]);
+                value nz = A::mul(w, hz[i]) + A::mul(x, hy[i]) - A::mul(y, hx[i]) + A::mul(z, dw);
+
+                w = nw;
+                x = nx;
+                y = ny;
+                z = nz;
+                out.w[i] = A::toFloat(w);
+                out.x[i] = A::toFloat(x);
+                out.y[i] = A::toFloat(y);
+                out.z[i] = A::toFloat(z);
+        }
+
+        n = A::mul(w, w) + A::mul(x, x) + A::mul(y, y) + A::mul(z, z);
+        s = A::renorm(n);
+        q[0] = A::mul(w, s);
+        q[1] = A::mul(x, s);
+        q[2] = A::mul(y, s);
+        q[3] = A::mul(z, s);
+}
+
+template <class A>
+void FusionFilterBase<A>::getAttitude(float attitude[4])
+{
+        float n = 0;
+
+        for (int i = 0; i < 4; i++) {
+                attitude[i] = A::toFloat(q[i]);
+                n += attitude[i] * attitude[i];
+        }
+        n = 1.0f / sqrtf(n);
+        for (int i = 0; i < 4; i++)
+                attitude[i] *= n;
+}
+
+template <class A>
+void FusionFilterBase<A>::getGravity(float gravity[3])
+{
+        float attitude[4];
+
+        getAttitude(attitude);
+        gravity[0] = FUSION_G * 2 * (attitude[1] * attitude[3] - attitude[0] * attitude[2]);
+        gravity[1] = FUSION_G * 2 * (attitude[2] * attitude[3] + attitude[0] * attitude[1]);
+        gravity[2] = FUSION_G * (1 - 2 * (attitude[1] * attitude[1] + attitude[2] * attitude[2]));
+}
+
+template class FusionFilterBase<FusionFloat>;
+template class FusionFilterBase<FusionQ29>;
@@ -0,0 +1,107 @@
+#ifndef __FUSION_FILTER_H__
+#define __FUSION_FILTER_H__
+#include <stdint.h>
+
+/* Complementary quaternion filter over accelerometer, gyroscope and
+ * magnetometer, for platforms which have no sensor hub to do the fusion.
+ *
+ * The gyroscope propagates the attitude, the accelerometer corrects the
+ * tilt and the magnetometer the heading only, both through a proportional
+ * and integral feedback on the angular rate (the integral is the gyroscope
+ * bias). The attitude rotates the device frame to the east-north-up frame,
+ * as the Android rotation vector.
+ *
+ * Samples come in batches of one sensor, as the drivers report them, and
+ * are kept as structure of arrays: the per sample work of a batch is done
+ * in loops over whole arrays, which the compiler vectorizes, only the
+ * quaternion product chain of the gyroscope is sequential.
+ */
+
+#define FUSION_BATCH_MAX        32
+#define FUSION_G                9.80665f
+
+struct FusionSamples {
+        int count;
+        int64_t timestamp[FUSION_BATCH_MAX];
+        float x[FUSION_BATCH_MAX];
+        float y[FUSION_BATCH_MAX];
+        float z[FUSION_BATCH_MAX];
+};
+
+/* attitude after each gyroscope sample of a batch */
+struct FusionAttitude {
+        float w[FUSION_BATCH_MAX];
+        float x[FUSION_BATCH_MAX];
+        float y[FUSION_BATCH_MAX];
+        float z[FUSION_BATCH_MAX];
+};
+
+/* arithmetic of the attitude propagation */
+struct FusionFloat {
+        typedef float value;
+        static value fromFloat(float f) { return f; }
+        static float toFloat(value v) { return v; }
+        static value one() { return 1.0f; }
+        static value mul(value a, value b) { return a * b; }
+        static value half(value a) { return a * 0.5f; }
+        /* scale of a quaternion of squared norm n back to unit */
+        static value renorm(value n);
+};
+
+/* Q29 fixed point, for cores where the float unit is slow or shared */
+struct FusionQ29 {
+        typedef int32_t value;
+        static value fromFloat(float f) { return static_cast<value>(f * (1 << 29)); }
+        static float toFloat(value v) { return v * (1.0f / (1 << 29)); }
+        static value one() { return 1 << 29; }
+        static value mul(value a, value b) { return static_cast<value>((static_cast<int64_t>(a) * b) >> 29); }
+        static value half(value a) { return a >> 1; }
+        /* one Newton step of 1/sqrt(n) at 1, n stays close to 1 */
+        static value renorm(value n) { return static_cast<value>(((3LL << 29) - n) >> 1); }
+};
+
+template <class A>
+class FusionFilterBase {
+        typedef typename A::value value;
+        value q[4];
+        float feedback[3];
+        float integral[3];
+        float accelError[3];
+        float magError[3];
+        float mag[3];
+        int64_t lastAccel;
+        int64_t lastGyro;
+        int64_t lastMag;
+        float kp;
+        float ki;
+        bool ready;
+        bool hasMag;
+        bool magInit;
+
+        void init(const float a[3]);
+        void integrate(const float error[3], float dt);
+        void updateFeedback();
+public:
+        FusionFilterBase();
+        void reset();
+        void setGains(float mKp, float mKi) { kp = mKp; ki = mKi; }
+        /* attitude is valid once an accelerometer sample came */
+        bool isReady() { return ready; }
+        /* and north is known */
+        bool hasHeading() { return ready && magInit; }
+        /* m/s^2 */
+        void updateAccel(const FusionSamples &accel);
+        /* any unit, only the direction is used */
+        void updateMag(const FusionSamples &mag);
+        /* rad/s, attitude after each sample is stored in out */
+        void updateGyro(const FusionSamples &gyro, FusionAttitude &out);
+        /* w, x, y, z */
+        void getAttitude(float attitude[4]);
+        /* m/s^2 in the device frame */
+        void getGravity(float gravity[3]);
+};
+
+typedef FusionFilterBase<FusionFloat> FusionFilter;
+typedef FusionFilterBase<FusionQ29> FusionFilterFixed;
+
+#endif
@@ -14,7 +14,11 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+#include <cutils/properties.h>
+
 #include "sensors.h"
+#include "SensorEventRing.h"
 
 static int open_sensors(const struct hw_module_t* module, const char* id,
                         struct hw_device_t** device);
@@ -46,6 +50,23 @@ struct sensors_module_t HAL_MODULE_INFO_SYM = {
     get_sensors_list: sensors_get_sensors_list,
 };
 
+/* Each sensor has a reader thread which reads its events into a ring as
+ * soon as the driver reports them. pollEvents() merges the rings by
+ * timestamp. With a max report latency, the events of continuous sensors
+ * are kept in their ring until the oldest one has waited that long or the
+ * ring is half full, so that the caller is woken up once per batch. */
+#define MAX_LATENCY_PROPERTY    "persist.sensors.max_latency_ms"
+#define READ_BATCH              16
+
+static int64_t now_ns()
+{
+    struct timespec t;
+    t.tv_sec = t.tv_nsec = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return timespec_to_ns(&t);
+}
+
 struct sensors_poll_context_t {
     struct sensors_poll_device_t device; // must be first
 
@@ -56,35 +77,52 @@ struct sensors_poll_context_t {
     int pollEvents(sensors_event_t* data, int count);
 
 private:
-    size_t wake;
+    struct reader_t {
+        sensors_poll_context_t *ctx;
+        SensorBase *sensor;
+        bool batched;
+        bool started;
+        pthread_t thread;
+        SensorEventRing ring;
+    };
+
     static const char WAKE_MESSAGE = 'W';
-    struct pollfd mPollFds[SENSORS_HANDLE_MAX + 1]; // plus 1 for wakefd
+    struct pollfd mWakePollFd;
     int mWritePipeFd;
+    int mQuitPipeFds[2];
     int mNumSensors;
+    int64_t mMaxLatencyNs;
+    reader_t *mReaders;
     SensorBase* mSensors[SENSORS_HANDLE_MAX + 1]; // reserved 0 for SENSORS_HANDLE_BASE
     const struct sensor_t *sensor_list;
+
+    static void *readerThread(void *arg);
+    void readEvents(reader_t *reader);
+    void wakePoll();
+    bool isReady(int count, int *timeout);
+    int mergeEvents(sensors_event_t* data, int count);
 };
 
 sensors_poll_context_t::sensors_poll_context_t()
+    : mWritePipeFd(-1),
+      mNumSensors(0),
+      mMaxLatencyNs(0),
+      mReaders(NULL)
 {
+    char value[PROPERTY_VALUE_MAX];
+
+    mQuitPipeFds[0] = mQuitPipeFds[1] = -1;
+    mWakePollFd.fd = -1;
+
     sensor_list = get_platform_sensor_list(&mNumSensors);
 
     SensorBase **sensors = get_platform_sensors();
     if (!sensors) {
         LOGE("Get platform sensors error!");
+        mNumSensors = 0;
         return;
     }
 
-    for (int i = 0; i < mNumSensors; i++) {
-        int handle = sensor_list[i].handle;
-        mSensors[handle] = sensors[i];
-
-        mPollFds[i].fd = mSensors[handle]->getFd();
-        mPollFds[i].events = POLLIN;
-        mPollFds[i].revents = 0;
-    }
-
-    wake = mNumSensors;
     int wakeFds[2];
     int result = pipe(wakeFds);
     LOGE_IF(result<0, "error creating wake pipe (%s)", strerror(errno));
@@ -92,18 +130,73 @@ sensors_poll_context_t::sensors_poll_context_t()
     fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
     mWritePipeFd = wakeFds[1];
 
-    mPollFds[wake].fd = wakeFds[0];
-    mPollFds[wake].events = POLLIN;
-    mPollFds[wake].revents = 0;
+    mWakePollFd.fd = wakeFds[0];
+    mWakePollFd.events = POLLIN;
+    mWakePollFd.revents = 0;
+
+    result = pipe(mQuitPipeFds);
+    LOGE_IF(result<0, "error creating quit pipe (%s)", strerror(errno));
+
+    property_get(MAX_LATENCY_PROPERTY, value, "0");
+    mMaxLatencyNs = atoi(value) * 1000000LL;
+    if (mMaxLatencyNs < 0)
+        mMaxLatencyNs = 0;
+
+    mReaders = new reader_t[mNumSensors];
+
+    for (int i = 0; i < mNumSensors; i++) {
+        int handle = sensor_list[i].handle;
+        int type = sensor_list[i].type;
+        reader_t *reader = &mReaders[i];
+
+        mSensors[handle] = sensors[i];
+
+        reader->ctx = this;
+        reader->sensor = sensors[i];
+        reader->batched = type == SENSOR_TYPE_ACCELEROMETER
+                || type == SENSOR_TYPE_MAGNETIC_FIELD
+                || type == SENSOR_TYPE_GYROSCOPE
+                || type == SENSOR_TYPE_PRESSURE;
+        reader->started = false;
+
+        if (reader->sensor->getFd() < 0)
+            continue;
+
+        result = pthread_create(&reader->thread, NULL, readerThread, reader);
+        LOGE_IF(result, "error creating reader of sensor %d (%s)",
+                handle, strerror(result));
+        reader->started = !result;
+    }
+
+    D("sensors_poll_context_t: max report latency %lld ms",
+      mMaxLatencyNs / 1000000);
 }
 
 sensors_poll_context_t::~sensors_poll_context_t()
 {
+    const char quitMessage(WAKE_MESSAGE);
+
+    /* never read, so it stays readable for every reader */
+    if (mQuitPipeFds[1] >= 0)
+        write(mQuitPipeFds[1], &quitMessage, 1);
+
+    for (int i = 0 ; i < mNumSensors; i++)
+        if (mReaders[i].started)
+            pthread_join(mReaders[i].thread, NULL);
+
     for (int i = 0 ; i < mNumSensors; i++)
         delete mSensors[sensor_list[i].handle];
 
-    close(mPollFds[wake].fd);
-    close(mWritePipeFd);
+    delete [] mReaders;
+
+    if (mQuitPipeFds[0] >= 0) {
+        close(mQuitPipeFds[0]);
+        close(mQuitPipeFds[1]);
+    }
+    if (mWakePollFd.fd >= 0) {
+        close(mWakePollFd.fd);
+        close(mWritePipeFd);
+    }
 }
 
 int sensors_poll_context_t::activate(int handle, int enabled)
@@ -115,11 +208,8 @@ int sensors_poll_context_t::activate(int handle, int enabled)
         return (handle > 0 ? -handle : handle);
 
     int err =  mSensors[handle]->enable(handle, enabled);
-    if (enabled && !err) {
-        const char wakeMessage(WAKE_MESSAGE);
-        int result = write(mWritePipeFd, &wakeMessage, 1);
-        LOGE_IF(result < 0, "error sending wake message (%s)", strerror(errno));
-    }
+    if (enabled && !err)
+        wakePoll();
     return err;
 }
 
@@ -131,47 +221,175 @@ int sensors_poll_context_t::setDelay(int handle, int64_t ns)
     return mSensors[handle]->setDelay(handle, ns);
 }
 
-int sensors_poll_context_t::pollEvents(sensors_event_t* data, int count)
+void sensors_poll_context_t::wakePoll()
 {
-    int nbEvents = 0;
-    int n = 0;
-
-    do {
-        /* see if we have some leftover from the last poll() */
-        for (int i = 0; count && i < mNumSensors; i++) {
-            SensorBase* const sensor(mSensors[sensor_list[i].handle]);
-            if ((mPollFds[i].revents & POLLIN) || sensor->hasPendingEvents()) {
-                int nb = sensor->readEvents(data, count);
-                if (nb < count) {
-                    /* no more data or error for this sensor */
-                    mPollFds[i].revents = 0;
-                    if (nb < 0)
-                        continue;
-                }
-                count -= nb;
-                nbEvents += nb;
-                data += nb;
-            }
-        }
-        if (count) {
-            /* we still have some room, so try to see if we can get some events
-             * immediately or just wait if we don't have anything to return */
-            n = poll(mPollFds, mNumSensors + 1, nbEvents ? 0 : -1);
+    const char wakeMessage(WAKE_MESSAGE);
+    int result = write(mWritePipeFd, &wakeMessage, 1);
+
+    /* a full pipe wakes the poll thread up anyway */
+    LOGE_IF(result < 0 && errno != EAGAIN,
+            "error sending wake message (%s)", strerror(errno));
+}
+
+void *sensors_poll_context_t::readerThread(void *arg)
+{
+    reader_t *reader = (reader_t *)arg;
+
+    reader->ctx->readEvents(reader);
+    return NULL;
+}
+
+void sensors_poll_context_t::readEvents(reader_t *reader)
+{
+    sensors_event_t events[READ_BATCH];
+    struct pollfd fds[2];
+    bool more = false;
+
+    fds[0].fd = reader->sensor->getFd();
+    fds[0].events = POLLIN;
+    fds[1].fd = mQuitPipeFds[0];
+    fds[1].events = POLLIN;
+
+    while (1) {
+        /* see if we have some leftover from the last read */
+        if (!more && !reader->sensor->hasPendingEvents()) {
+            int n = poll(fds, 2, -1);
             if (n < 0) {
+                if (errno == EINTR)
+                    continue;
                 E("poll() failed (%s)", strerror(errno));
-                return -errno;
+                return;
+            }
+            if (fds[1].revents)
+                return;
+            if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                E("sensor fd %d closed or in error", fds[0].fd);
+                return;
             }
-            if (mPollFds[wake].revents & POLLIN) {
-                char msg;
-                int result = read(mPollFds[wake].fd, &msg, 1);
-                LOGE_IF(result < 0, "error reading from wake pipe (%s)",
-                        strerror(errno));
-                LOGE_IF(msg != WAKE_MESSAGE,
-                        "unknown message on wake queue (0x%02x)", int(msg));
-                mPollFds[wake].revents = 0;
+        }
+
+        int nb = reader->sensor->readEvents(events, READ_BATCH);
+        more = nb == READ_BATCH;
+        if (nb <= 0)
+            continue;
+
+        int64_t arrival = now_ns();
+        bool wake = false;
+
+        for (int i = 0; i < nb; i++) {
+            int result = reader->ring.push(events[i], arrival);
+
+            if (result < 0) {
+                if (reader->ring.dropped() % SensorEventRing::CAPACITY == 1)
+                    E("sensor %d: %u events dropped, poll() is too late",
+                      events[i].sensor, reader->ring.dropped());
+                continue;
             }
+            /* the poll thread sees the event by itself unless it had
+             * read everything before; a half full ring ends the batch */
+            if (result || (reader->batched && mMaxLatencyNs
+                    && reader->ring.size() == SensorEventRing::CAPACITY / 2))
+                wake = true;
         }
-    } while (n && count);
+
+        if (wake)
+            wakePoll();
+    }
+}
+
+/* return true if pollEvents() has to return now; otherwise *timeout is
+ * how long the oldest batched event can still wait, in ms, or -1 */
+bool sensors_poll_context_t::isReady(int count, int *timeout)
+{
+    int64_t now = now_ns();
+    int64_t wait = -1;
+    uint32_t total = 0;
+
+    for (int i = 0; i < mNumSensors; i++) {
+        reader_t *reader = &mReaders[i];
+        uint32_t n = reader->ring.size();
+
+        if (!n)
+            continue;
+
+        if (!reader->batched || !mMaxLatencyNs
+                || n >= SensorEventRing::CAPACITY / 2)
+            return true;
+
+        int64_t left = reader->ring.arrival() + mMaxLatencyNs - now;
+        if (left <= 0)
+            return true;
+        if (wait < 0 || left < wait)
+            wait = left;
+        total += n;
+    }
+
+    if (total >= (uint32_t)count)
+        return true;
+
+    *timeout = wait < 0 ? -1 : (int)((wait + 999999) / 1000000);
+    return false;
+}
+
+/* oldest event first, among the events present when called */
+int sensors_poll_context_t::mergeEvents(sensors_event_t* data, int count)
+{
+    uint32_t available[SENSORS_HANDLE_MAX + 1];
+    int nbEvents = 0;
+
+    for (int i = 0; i < mNumSensors; i++)
+        available[i] = mReaders[i].ring.size();
+
+    while (nbEvents < count) {
+        int oldest = -1;
+
+        for (int i = 0; i < mNumSensors; i++) {
+            if (!available[i])
+                continue;
+            if (oldest < 0 || mReaders[i].ring.front().timestamp
+                    < mReaders[oldest].ring.front().timestamp)
+                oldest = i;
+        }
+        if (oldest < 0)
+            break;
+
+        *data++ = mReaders[oldest].ring.front();
+        mReaders[oldest].ring.pop();
+        available[oldest]--;
+        nbEvents++;
+    }
+
+    return nbEvents;
+}
+
+int sensors_poll_context_t::pollEvents(sensors_event_t* data, int count)
+{
+    int timeout = -1;
+
+    if (count < 1)
+        return -EINVAL;
+
+    /* wait if we don't have anything to return yet */
+    while (!isReady(count, &timeout)) {
+        int n = poll(&mWakePollFd, 1, timeout);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            E("poll() failed (%s)", strerror(errno));
+            return -errno;
+        }
+        if (mWakePollFd.revents & POLLIN) {
+            char msg[16];
+            int result = read(mWakePollFd.fd, msg, sizeof(msg));
+            LOGE_IF(result < 0, "error reading from wake pipe (%s)",
+                    strerror(errno));
+            LOGE_IF(result > 0 && msg[0] != WAKE_MESSAGE,
+                    "unknown message on wake queue (0x%02x)", int(msg[0]));
+            mWakePollFd.revents = 0;
+        }
+    }
+
+    int nbEvents = mergeEvents(data, count);
     D("sensors_poll_context_t::pollEvents(), return: nbEvents = %d", nbEvents);
     return nbEvents;
 }
@@ -0,0 +1,87 @@
+# Copyright (C) 2013 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+LOCAL_PATH := $(call my-dir)
+
+ifneq ($(TARGET_SIMULATOR),true)
+
+# poll path benchmark: accelerometer, gyroscope and compass fed at 200Hz by
+# uinput devices, through the common sensors.cpp poll context
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := sensors_poll_bench
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -DLOG_TAG=\"SensorsBench\"
+LOCAL_SRC_FILES := sensors_poll_bench.cpp       \
+                   ../InputEventReader.cpp      \
+                   ../sensors.cpp               \
+                   ../SensorBase.cpp            \
+                   ../AccelSensor.cpp           \
+                   ../CompassSensor.cpp         \
+                   ../CompassCalibration.cpp    \
+                   ../GyroSensor.cpp
+
+LOCAL_C_INCLUDES := $(COMMON_INCLUDES)
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+
+include $(BUILD_EXECUTABLE)
+
+# compass calibration replay: the recursive fit of CompassCalibration.cpp and
+# the batch ellipsoid fit, on the same traces
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := compass_cal_bench
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -DLOG_TAG=\"CompassCalBench\"
+LOCAL_SRC_FILES := compass_cal_bench.cpp        \
+                   ../CompassCalibration.cpp
+
+LOCAL_C_INCLUDES := $(COMMON_INCLUDES)
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := compass_cal_bench_batch
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -DLOG_TAG=\"CompassCalBench\" -DBATCH_SOLVER
+LOCAL_SRC_FILES := compass_cal_bench.cpp        \
+                   ../scalability/sensorcalibration/CompassGenericCalibration/CompassGenericCalibration.cpp
+
+LOCAL_C_INCLUDES := $(COMMON_INCLUDES)
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+
+include $(BUILD_EXECUTABLE)
+
+# fusion filter replay of the scalability HAL: CPU time per sample and drift
+# of the float and fixed point filters
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := fusion_bench
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -DLOG_TAG=\"FusionBench\"
+LOCAL_SRC_FILES := fusion_bench.cpp             \
+                   ../scalability/sensorfusion/FusionFilter.cpp
+
+LOCAL_C_INCLUDES := $(COMMON_INCLUDES)
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+
+include $(BUILD_EXECUTABLE)
+
+endif # !TARGET_SIMULATOR
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Replays magnetometer traces through the compass calibration, the way
+ * CompassSensor::calibration() calls it, and reports its accuracy and the
+ * CPU time of each call. Built twice: compass_cal_bench with the recursive
+ * fit of ../CompassCalibration.cpp, compass_cal_bench_batch with the batch
+ * ellipsoid fit kept in scalability/.
+ *
+ * A trace is a text file of "x y z time_ms" lines in uT, as written by
+ * CompassCalibration.cpp with DBG_RAW_DATA. Without a trace, a device
+ * turning in a 45 uT field with known hard and soft iron is simulated; the
+ * hard iron moves halfway through, as near a magnet.
+ *
+ * usage: compass_cal_bench [-n loops] [trace...]
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef BATCH_SOLVER
+#include "../scalability/sensorcalibration/CompassGenericCalibration/CompassGenericCalibration.h"
+#else
+#include "../CompassCalibration.h"
+#endif
+
+#define SIM_RATE_HZ     50
+#define SIM_SECONDS     120
+#define SIM_FIELD       45.0
+#define SIM_NOISE       0.4
+
+struct sample {
+    float x, y, z;
+    long time_ms;
+};
+
+struct trace {
+    const char *name;
+    struct sample *samples;
+    int count;
+    double field;       /* true field strength, 0 if unknown */
+};
+
+struct result {
+    int first_cal;      /* index of the first calibrated sample, -1 if none */
+    int calibrated;
+    double err_sum, sum, sqr_sum;
+    double cpu_ns;
+    double *call_ns;    /* CPU time of each sample */
+};
+
+static int64_t thread_ns()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static int load_trace(const char *path, struct trace *trace)
+{
+    FILE *file = fopen(path, "r");
+    struct sample s;
+    int size = 0;
+
+    if (!file) {
+        printf("can't open %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+
+    memset(trace, 0, sizeof(*trace));
+    trace->name = path;
+    while (fscanf(file, "%f %f %f %ld", &s.x, &s.y, &s.z, &s.time_ms) == 4) {
+        if (trace->count == size) {
+            size = size ? size * 2 : 1024;
+            trace->samples = (struct sample *)realloc(trace->samples,
+                    size * sizeof(*trace->samples));
+        }
+        trace->samples[trace->count++] = s;
+    }
+    fclose(file);
+
+    if (!trace->count) {
+        printf("no samples in %s\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static double gaussian(unsigned int *seed)
+{
+    double u = (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/* rotate v by the angle |w| around w */
+static void rotate(double v[3], const double w[3])
+{
+    double angle = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+    double k[3], kv[3], dot, c, s;
+
+    if (angle == 0)
+        return;
+
+    for (int i = 0; i < 3; i++)
+        k[i] = w[i] / angle;
+    kv[0] = k[1] * v[2] - k[2] * v[1];
+    kv[1] = k[2] * v[0] - k[0] * v[2];
+    kv[2] = k[0] * v[1] - k[1] * v[0];
+    dot = k[0] * v[0] + k[1] * v[1] + k[2] * v[2];
+    c = cos(angle);
+    s = sin(angle);
+
+    for (int i = 0; i < 3; i++)
+        v[i] = v[i] * c + kv[i] * s + k[i] * dot * (1 - c);
+}
+
+static void simulate_trace(struct trace *trace)
+{
+    static const double soft_iron[3][3] = {
+        { 1.10,  0.05,  0.02 },
+        { 0.05,  0.92, -0.04 },
+        { 0.02, -0.04,  1.03 },
+    };
+    double hard_iron[3] = { 20, -35, 12 };
+    double field[3] = { SIM_FIELD, 0, 0 };
+    double rate[3] = { 0, 0, 0 };
+    double dt = 1.0 / SIM_RATE_HZ;
+    unsigned int seed = 1;
+
+    trace->name = "simulated";
+    trace->count = SIM_RATE_HZ * SIM_SECONDS;
+    trace->samples = (struct sample *)malloc(trace->count * sizeof(*trace->samples));
+    trace->field = SIM_FIELD;
+
+    for (int n = 0; n < trace->count; n++) {
+        double step[3], raw[3];
+
+        if (n == trace->count / 2) {
+            hard_iron[0] += 8;
+            hard_iron[1] -= 5;
+            hard_iron[2] += 3;
+        }
+
+        /* angular rate wandering around 1 rad/s */
+        for (int i = 0; i < 3; i++) {
+            rate[i] += gaussian(&seed) * 0.3 - rate[i] * 0.02;
+            step[i] = rate[i] * dt;
+        }
+        /* the device turns, the field turns the other way in its frame */
+        for (int i = 0; i < 3; i++)
+            step[i] = -step[i];
+        rotate(field, step);
+
+        for (int i = 0; i < 3; i++) {
+            raw[i] = hard_iron[i] + gaussian(&seed) * SIM_NOISE;
+            for (int j = 0; j < 3; j++)
+                raw[i] += soft_iron[i][j] * field[j];
+        }
+
+        trace->samples[n].x = raw[0];
+        trace->samples[n].y = raw[1];
+        trace->samples[n].z = raw[2];
+        trace->samples[n].time_ms = n * 1000 / SIM_RATE_HZ;
+    }
+}
+
+/* as CompassSensor::calibration() */
+static void replay(const struct trace *trace, struct result *result)
+{
+    double *call_ns = result->call_ns;
+
+    memset(result, 0, sizeof(*result));
+    result->first_cal = -1;
+    result->call_ns = call_ns;
+
+    CompassCal_init(NULL);
+
+    for (int n = 0; n < trace->count; n++) {
+        const struct sample *s = &trace->samples[n];
+        float x = s->x, y = s->y, z = s->z;
+        int64_t start = thread_ns();
+        int ready;
+
+        CompassCal_collectData(x, y, z, s->time_ms);
+        ready = CompassCal_readyCheck();
+        if (ready)
+            CompassCal_computeCal(x, y, z, &x, &y, &z);
+
+        result->call_ns[n] = thread_ns() - start;
+        result->cpu_ns += result->call_ns[n];
+
+        if (!ready)
+            continue;
+
+        double strength = sqrt((double)x * x + (double)y * y + (double)z * z);
+        if (result->first_cal < 0)
+            result->first_cal = n;
+        result->calibrated++;
+        result->sum += strength;
+        result->sqr_sum += strength * strength;
+        if (trace->field)
+            result->err_sum += (strength - trace->field) * (strength - trace->field);
+    }
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+
+    return da < db ? -1 : da > db;
+}
+
+static void usage()
+{
+    printf("usage: compass_cal_bench [-n loops] [trace...]\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            loops = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (loops <= 0)
+        usage();
+
+#ifdef BATCH_SOLVER
+    printf("batch ellipsoid fit, %d loops\n", loops);
+#else
+    printf("recursive least squares fit, %d loops\n", loops);
+#endif
+
+    for (int t = optind; t < argc || t == optind; t++) {
+        struct trace trace;
+        struct result result;
+        double cpu_ns = 0, p99_ns = 0, max_ns = 0;
+
+        if (t < argc) {
+            if (load_trace(argv[t], &trace) < 0)
+                return EXIT_FAILURE;
+        } else {
+            simulate_trace(&trace);
+        }
+
+        result.call_ns = (double *)malloc(trace.count * sizeof(double));
+        for (int loop = 0; loop < loops; loop++) {
+            replay(&trace, &result);
+            cpu_ns += result.cpu_ns;
+
+            /* the spikes are what the sensor thread notices */
+            qsort(result.call_ns, trace.count, sizeof(double), compare_double);
+            if (result.call_ns[trace.count * 99 / 100] > p99_ns)
+                p99_ns = result.call_ns[trace.count * 99 / 100];
+            /* the lowest max of the loops leaves out interrupts and
+             * page faults, the solver spikes are there every loop */
+            if (loop == 0 || result.call_ns[trace.count - 1] < max_ns)
+                max_ns = result.call_ns[trace.count - 1];
+        }
+
+        printf("%s: %d samples\n", trace.name, trace.count);
+        if (result.first_cal < 0) {
+            printf("  never calibrated\n");
+        } else {
+            double mean = result.sum / result.calibrated;
+            double spread = sqrt(result.sqr_sum / result.calibrated - mean * mean);
+
+            printf("  calibrated from sample %d, field %.2f uT, spread %.3f uT\n",
+                   result.first_cal, mean, spread);
+            if (trace.field)
+                printf("  rms error to the true %.1f uT field %.3f uT\n",
+                       trace.field, sqrt(result.err_sum / result.calibrated));
+        }
+        printf("  cpu per sample %.2f us mean, %.2f us 99th percentile, %.2f us max\n",
+               cpu_ns / loops / trace.count / 1000, p99_ns / 1000, max_ns / 1000);
+
+        free(result.call_ns);
+        free(trace.samples);
+    }
+
+    return EXIT_SUCCESS;
+}
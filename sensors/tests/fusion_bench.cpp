@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Replays accelerometer, gyroscope and magnetometer streams through the
+ * fusion filter of the scalability HAL, in batches as the drivers report
+ * them, and reports the CPU time per sample and the drift of the attitude.
+ * The float filter, the fixed point one and the float one without
+ * correction (plain gyroscope integration) run on the same streams.
+ *
+ * A trace is a text file of "sensor timestamp_ns x y z" lines, sensor is
+ * a, g or m; there is no true attitude, the fixed point filter is compared
+ * to the float one. Without a trace, a device at rest then turning is
+ * simulated, with gyroscope bias and noise on every sensor.
+ *
+ * usage: fusion_bench [-n loops] [-b batch] [trace...]
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../scalability/sensorfusion/FusionFilter.h"
+
+#define SIM_RATE_HZ     200
+#define SIM_MAG_DIV     4
+#define SIM_SECONDS     120
+#define SIM_STILL       10
+#define SIM_SETTLE      5
+#define NUM_FILTERS     3
+
+struct sample {
+    char sensor;
+    int64_t timestamp;
+    float x, y, z;
+    float truth[4];     /* true attitude w, x, y, z, gyroscope samples */
+};
+
+struct trace {
+    const char *name;
+    struct sample *samples;
+    int count;
+    struct sample **gyro;   /* the gyroscope samples, in order */
+    int gyro_count;
+    bool has_truth;
+};
+
+struct result {
+    double cpu_ns;
+    double max_batch_ns;    /* per sample, worst batch */
+    /* attitude, and tilt alone which needs no magnetometer */
+    double err_sum[2], err_max[2], err_last[2];
+    int err_count;
+    float *attitude;        /* after each gyroscope sample, for comparison */
+};
+
+static const char *filter_names[NUM_FILTERS] = {
+    "float", "fixed Q29", "gyroscope only",
+};
+
+static int64_t thread_ns()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/* reading the thread clock is a system call, as long as a small batch */
+static double timer_ns;
+
+static void calibrate_timer()
+{
+    int64_t best = 0;
+
+    for (int i = 0; i < 1000; i++) {
+        int64_t start = thread_ns();
+        int64_t ns = thread_ns() - start;
+
+        if (i == 0 || ns < best)
+            best = ns;
+    }
+    timer_ns = best;
+}
+
+static void add_sample(struct trace *trace, int *size, const struct sample *s)
+{
+    if (trace->count == *size) {
+        *size = *size ? *size * 2 : 4096;
+        trace->samples = (struct sample *)realloc(trace->samples,
+                *size * sizeof(*trace->samples));
+    }
+    trace->samples[trace->count++] = *s;
+}
+
+static int load_trace(const char *path, struct trace *trace)
+{
+    FILE *file = fopen(path, "r");
+    struct sample s;
+    long long timestamp;
+    int size = 0;
+
+    if (!file) {
+        printf("can't open %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+
+    memset(trace, 0, sizeof(*trace));
+    memset(&s, 0, sizeof(s));
+    trace->name = path;
+    while (fscanf(file, " %c %lld %f %f %f", &s.sensor, &timestamp, &s.x, &s.y, &s.z) == 5) {
+        if (s.sensor != 'a' && s.sensor != 'g' && s.sensor != 'm')
+            continue;
+        s.timestamp = timestamp;
+        add_sample(trace, &size, &s);
+    }
+    fclose(file);
+
+    if (!trace->count) {
+        printf("no samples in %s\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static double gaussian(unsigned int *seed)
+{
+    double u = (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/* world vector in the device frame, q rotates the device to the world */
+static void to_device(const double q[4], const double world[3], double device[3])
+{
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+
+    device[0] = (1 - 2 * (y * y + z * z)) * world[0] + 2 * (x * y + w * z) * world[1]
+            + 2 * (x * z - w * y) * world[2];
+    device[1] = 2 * (x * y - w * z) * world[0] + (1 - 2 * (x * x + z * z)) * world[1]
+            + 2 * (y * z + w * x) * world[2];
+    device[2] = 2 * (x * z + w * y) * world[0] + 2 * (y * z - w * x) * world[1]
+            + (1 - 2 * (x * x + y * y)) * world[2];
+}
+
+static void simulate_trace(struct trace *trace)
+{
+    static const double bias[3] = { 0.02, -0.015, 0.01 };
+    static const double field[3] = { 0, 22, -40 };
+    static const double up[3] = { 0, 0, FUSION_G };
+    /* on a table, screen up, pointing north east */
+    double q[4] = { cos(M_PI / 8), 0, 0, -sin(M_PI / 8) };
+    double rate[3] = { 0, 0, 0 };
+    double dt = 1.0 / SIM_RATE_HZ;
+    unsigned int seed = 1;
+    int size = 0;
+
+    memset(trace, 0, sizeof(*trace));
+    trace->name = "simulated";
+    trace->has_truth = true;
+
+    for (int n = 0; n < SIM_RATE_HZ * SIM_SECONDS; n++) {
+        struct sample s;
+        double v[3], h[3], angle, dq[4], nq[4];
+        int64_t timestamp = 1000000000LL + n * 1000000000LL / SIM_RATE_HZ;
+
+        /* angular rate wandering around 1 rad/s after a still start */
+        if (n >= SIM_STILL * SIM_RATE_HZ)
+            for (int i = 0; i < 3; i++)
+                rate[i] += gaussian(&seed) * 0.3 - rate[i] * 0.02;
+
+        for (int i = 0; i < 3; i++)
+            h[i] = rate[i] * dt / 2;
+        angle = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+        dq[0] = cos(angle);
+        for (int i = 0; i < 3; i++)
+            dq[i + 1] = angle > 0 ? h[i] * sin(angle) / angle : 0;
+        nq[0] = q[0] * dq[0] - q[1] * dq[1] - q[2] * dq[2] - q[3] * dq[3];
+        nq[1] = q[0] * dq[1] + q[1] * dq[0] + q[2] * dq[3] - q[3] * dq[2];
+        nq[2] = q[0] * dq[2] - q[1] * dq[3] + q[2] * dq[0] + q[3] * dq[1];
+        nq[3] = q[0] * dq[3] + q[1] * dq[2] - q[2] * dq[1] + q[3] * dq[0];
+        memcpy(q, nq, sizeof(q));
+
+        memset(&s, 0, sizeof(s));
+        s.timestamp = timestamp;
+        for (int i = 0; i < 4; i++)
+            s.truth[i] = q[i];
+
+        /* gravity, and the motion of a hand when turning */
+        to_device(q, up, v);
+        s.sensor = 'a';
+        s.x = v[0] + gaussian(&seed) * (rate[0] ? 0.3 : 0.05);
+        s.y = v[1] + gaussian(&seed) * (rate[0] ? 0.3 : 0.05);
+        s.z = v[2] + gaussian(&seed) * (rate[0] ? 0.3 : 0.05);
+        add_sample(trace, &size, &s);
+
+        s.sensor = 'g';
+        s.x = rate[0] + bias[0] + gaussian(&seed) * 0.01;
+        s.y = rate[1] + bias[1] + gaussian(&seed) * 0.01;
+        s.z = rate[2] + bias[2] + gaussian(&seed) * 0.01;
+        add_sample(trace, &size, &s);
+
+        if (n % SIM_MAG_DIV == 0) {
+            to_device(q, field, v);
+            s.sensor = 'm';
+            s.x = v[0] + gaussian(&seed) * 0.4;
+            s.y = v[1] + gaussian(&seed) * 0.4;
+            s.z = v[2] + gaussian(&seed) * 0.4;
+            add_sample(trace, &size, &s);
+        }
+    }
+}
+
+/* angle between two attitudes, degrees */
+static double attitude_error(const float a[4], const float b[4])
+{
+    double dot = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+
+    return dot >= 1 ? 0 : 2 * acos(dot) * 180 / M_PI;
+}
+
+/* angle between the verticals of two attitudes, degrees */
+static double tilt_error(const float a[4], const float b[4])
+{
+    double va[3] = { 2 * (a[1] * a[3] - a[0] * a[2]), 2 * (a[2] * a[3] + a[0] * a[1]),
+                     1 - 2 * (a[1] * a[1] + a[2] * a[2]) };
+    double vb[3] = { 2 * (b[1] * b[3] - b[0] * b[2]), 2 * (b[2] * b[3] + b[0] * b[1]),
+                     1 - 2 * (b[1] * b[1] + b[2] * b[2]) };
+    double dot = (va[0] * vb[0] + va[1] * vb[1] + va[2] * vb[2])
+            / sqrt((va[0] * va[0] + va[1] * va[1] + va[2] * va[2])
+                   * (vb[0] * vb[0] + vb[1] * vb[1] + vb[2] * vb[2]));
+
+    return dot >= 1 ? 0 : acos(dot) * 180 / M_PI;
+}
+
+template <class F>
+static void replay(F &filter, const struct trace *trace, int batch, struct result *result)
+{
+    static FusionSamples samples[3];
+    static FusionAttitude attitude;
+    const char *sensors = "agm";
+    int64_t settle = trace->samples[0].timestamp + (SIM_STILL + SIM_SETTLE) * 1000000000LL;
+    int gyro = 0;
+
+    filter.reset();
+    result->cpu_ns = result->max_batch_ns = 0;
+    memset(result->err_sum, 0, sizeof(result->err_sum));
+    memset(result->err_max, 0, sizeof(result->err_max));
+    memset(result->err_last, 0, sizeof(result->err_last));
+    result->err_count = 0;
+
+    /* the samples of each sensor are batched as the driver reports them,
+     * a batch goes to the filter when full or at the end */
+    for (int n = 0; n <= trace->count; n++) {
+        const struct sample *s = n < trace->count ? &trace->samples[n] : NULL;
+
+        for (int k = 0; k < 3; k++) {
+            FusionSamples *b = &samples[k];
+            int64_t start;
+            double ns;
+
+            if (b->count == 0 || (s && (s->sensor != sensors[k] || b->count < batch)))
+                continue;
+
+            start = thread_ns();
+            if (k == 0)
+                filter.updateAccel(*b);
+            else if (k == 1)
+                filter.updateGyro(*b, attitude);
+            else
+                filter.updateMag(*b);
+            ns = thread_ns() - start - timer_ns;
+            if (ns < 0)
+                ns = 0;
+            result->cpu_ns += ns;
+            if (ns / b->count > result->max_batch_ns && n > trace->count / 10)
+                result->max_batch_ns = ns / b->count;
+
+            if (k == 1) {
+                for (int i = 0; i < b->count; i++, gyro++) {
+                    float *a = &result->attitude[gyro * 4];
+                    const struct sample *g;
+
+                    a[0] = attitude.w[i];
+                    a[1] = attitude.x[i];
+                    a[2] = attitude.y[i];
+                    a[3] = attitude.z[i];
+
+                    if (!trace->has_truth)
+                        continue;
+                    g = trace->gyro[gyro];
+                    if (g->timestamp < settle)
+                        continue;
+                    double err[2] = { attitude_error(a, g->truth), tilt_error(a, g->truth) };
+                    for (int e = 0; e < 2; e++) {
+                        result->err_sum[e] += err[e] * err[e];
+                        if (err[e] > result->err_max[e])
+                            result->err_max[e] = err[e];
+                        result->err_last[e] = err[e];
+                    }
+                    result->err_count++;
+                }
+            }
+            b->count = 0;
+        }
+
+        if (s) {
+            FusionSamples *b = &samples[strchr(sensors, s->sensor) - sensors];
+
+            b->timestamp[b->count] = s->timestamp;
+            b->x[b->count] = s->x;
+            b->y[b->count] = s->y;
+            b->z[b->count] = s->z;
+            b->count++;
+        }
+    }
+}
+
+static void usage()
+{
+    printf("usage: fusion_bench [-n loops] [-b batch] [trace...]\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 10, batch = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:b:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            loops = atoi(optarg);
+            break;
+        case 'b':
+            batch = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (loops <= 0 || batch <= 0 || batch > FUSION_BATCH_MAX)
+        usage();
+
+    calibrate_timer();
+    printf("%d loops, batches of %d samples, %.0f ns of timer per batch left out\n",
+           loops, batch, timer_ns);
+
+    for (int t = optind; t < argc || t == optind; t++) {
+        struct trace trace;
+        struct result results[NUM_FILTERS];
+        int gyro_count;
+
+        if (t < argc) {
+            if (load_trace(argv[t], &trace) < 0)
+                return EXIT_FAILURE;
+        } else {
+            simulate_trace(&trace);
+        }
+
+        trace.gyro = (struct sample **)malloc(trace.count * sizeof(*trace.gyro));
+        trace.gyro_count = 0;
+        for (int n = 0; n < trace.count; n++)
+            if (trace.samples[n].sensor == 'g')
+                trace.gyro[trace.gyro_count++] = &trace.samples[n];
+        gyro_count = trace.gyro_count;
+        printf("%s: %d samples, %d of gyroscope\n", trace.name, trace.count, gyro_count);
+
+        for (int f = 0; f < NUM_FILTERS; f++) {
+            struct result *result = &results[f];
+            double cpu_ns = 0, max_ns = 0;
+
+            result->attitude = (float *)calloc(gyro_count * 4, sizeof(float));
+            for (int loop = 0; loop < loops; loop++) {
+                if (f == 0) {
+                    FusionFilter filter;
+                    replay(filter, &trace, batch, result);
+                } else if (f == 1) {
+                    FusionFilterFixed filter;
+                    replay(filter, &trace, batch, result);
+                } else {
+                    FusionFilter filter;
+                    filter.setGains(0, 0);
+                    replay(filter, &trace, batch, result);
+                }
+                cpu_ns += result->cpu_ns;
+                /* the lowest of the loops leaves out interrupts */
+                if (loop == 0 || result->max_batch_ns < max_ns)
+                    max_ns = result->max_batch_ns;
+            }
+
+            printf("  %-15s cpu per sample %6.1f ns mean, %6.1f ns worst batch\n",
+                   filter_names[f], cpu_ns / loops / trace.count, max_ns);
+            if (result->err_count) {
+                printf("  %-15s attitude error %6.2f deg rms, %6.2f max, %6.2f at the end\n",
+                       "", sqrt(result->err_sum[0] / result->err_count),
+                       result->err_max[0], result->err_last[0]);
+                printf("  %-15s tilt error     %6.2f deg rms, %6.2f max, %6.2f at the end\n",
+                       "", sqrt(result->err_sum[1] / result->err_count),
+                       result->err_max[1], result->err_last[1]);
+            }
+        }
+
+        /* the fixed point filter against the float one */
+        double diff_sum = 0, diff_max = 0;
+        for (int n = 0; n < gyro_count; n++) {
+            double diff = attitude_error(&results[0].attitude[n * 4], &results[1].attitude[n * 4]);
+
+            diff_sum += diff * diff;
+            if (diff > diff_max)
+                diff_max = diff;
+        }
+        printf("  fixed to float  %6.3f deg rms, %6.3f max\n",
+               gyro_count ? sqrt(diff_sum / gyro_count) : 0.0, diff_max);
+
+        for (int f = 0; f < NUM_FILTERS; f++)
+            free(results[f].attitude);
+        free(trace.gyro);
+        free(trace.samples);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2013 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Measures the wakeups and the CPU time of the sensors HAL poll path.
+ * uinput devices stand for the accelerometer, gyroscope and compass drivers
+ * and report at the given rate; the sysfs files of the drivers are plain
+ * files in a temporary directory. The poll context of ../sensors.cpp reads
+ * them through the usual AccelSensor, GyroSensor and CompassSensor.
+ *
+ * usage: sensors_poll_bench [-r rate_hz] [-t seconds] [-l max_latency_ms]
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <linux/uinput.h>
+#include <cutils/properties.h>
+
+#include "../sensors.h"
+#include "../AccelSensor.h"
+#include "../CompassSensor.h"
+#include "../GyroSensor.h"
+
+#define BENCH_DIR               "/data/local/tmp/sensors_bench"
+#define MAX_LATENCY_PROPERTY    "persist.sensors.max_latency_ms"
+#define NUM_DEVICES             3
+#define POLL_BUFFER             64
+
+struct bench_device {
+    const char *name;
+    int handle;
+    int type;
+    int codes[3];
+    int fd;
+};
+
+static struct bench_device devices[NUM_DEVICES] = {
+    { "bench_accel", SENSORS_HANDLE_ACCELEROMETER, SENSOR_TYPE_ACCELEROMETER,
+      { EVENT_TYPE_ACCEL_X, EVENT_TYPE_ACCEL_Y, EVENT_TYPE_ACCEL_Z }, -1 },
+    { "bench_compass", SENSORS_HANDLE_MAGNETIC_FIELD, SENSOR_TYPE_MAGNETIC_FIELD,
+      { EVENT_TYPE_MAGV_X, EVENT_TYPE_MAGV_Y, EVENT_TYPE_MAGV_Z }, -1 },
+    { "bench_gyro", SENSORS_HANDLE_GYROSCOPE, SENSOR_TYPE_GYROSCOPE,
+      { EVENT_TYPE_GYRO_X, EVENT_TYPE_GYRO_Y, EVENT_TYPE_GYRO_Z }, -1 },
+};
+
+static sensor_platform_config_t bench_configs[NUM_DEVICES];
+static struct sensor_t bench_sensors[NUM_DEVICES];
+static SensorBase *bench_platform_sensors[NUM_DEVICES];
+void (* sensor_platform_finalize)();
+
+extern struct sensors_module_t HAL_MODULE_INFO_SYM;
+
+static volatile int running = 1;
+static int rate_hz = 200;
+static struct rusage generator_usage;
+
+/* platform config of the bench, in place of config.cpp */
+const struct sensor_t* get_platform_sensor_list(int *num)
+{
+    *num = NUM_DEVICES;
+    return bench_sensors;
+}
+
+SensorBase** get_platform_sensors()
+{
+    bench_platform_sensors[0] = new AccelSensor(&bench_configs[0]);
+    bench_platform_sensors[1] = new CompassSensor(&bench_configs[1]);
+    bench_platform_sensors[2] = new GyroSensor(&bench_configs[2]);
+
+    return bench_platform_sensors;
+}
+
+static char *bench_file(const char *device, const char *node)
+{
+    char path[PATH_MAX_LEN];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s_%s", BENCH_DIR, device, node);
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd >= 0)
+        close(fd);
+
+    return strdup(path);
+}
+
+static int setup_configs()
+{
+    mkdir(BENCH_DIR, 0700);
+
+    for (int i = 0; i < NUM_DEVICES; i++) {
+        sensor_platform_config_t *config = &bench_configs[i];
+        struct sensor_t *sensor = &bench_sensors[i];
+
+        memset(config, 0, sizeof(*config));
+        config->handle = devices[i].handle;
+        config->name = devices[i].name;
+        config->activate_path = bench_file(devices[i].name, "enable");
+        config->poll_path = bench_file(devices[i].name, "poll");
+        config->config_path = bench_file(devices[i].name, "config");
+        for (int axis = 0; axis < 3; axis++) {
+            config->mapper[axis] = axis;
+            config->scale[axis] = 1;
+        }
+        config->range[1] = 1000;
+
+        memset(sensor, 0, sizeof(*sensor));
+        sensor->name = devices[i].name;
+        sensor->vendor = "bench";
+        sensor->version = 1;
+        sensor->handle = devices[i].handle;
+        sensor->type = devices[i].type;
+        sensor->maxRange = 1000;
+        sensor->resolution = 1;
+        sensor->minDelay = 1000000 / rate_hz;
+    }
+
+    return 0;
+}
+
+static int create_device(struct bench_device *device)
+{
+    struct uinput_user_dev dev;
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+
+    if (fd < 0) {
+        printf("can't open /dev/uinput (%s)\n", strerror(errno));
+        return -1;
+    }
+
+    ioctl(fd, UI_SET_EVBIT, EV_SYN);
+    ioctl(fd, UI_SET_EVBIT, EV_REL);
+    for (int axis = 0; axis < 3; axis++)
+        ioctl(fd, UI_SET_RELBIT, device->codes[axis]);
+
+    memset(&dev, 0, sizeof(dev));
+    strncpy(dev.name, device->name, UINPUT_MAX_NAME_SIZE - 1);
+    dev.id.bustype = BUS_VIRTUAL;
+
+    if (write(fd, &dev, sizeof(dev)) != sizeof(dev)
+            || ioctl(fd, UI_DEV_CREATE) < 0) {
+        printf("can't create %s (%s)\n", device->name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    device->fd = fd;
+    return 0;
+}
+
+static void write_event(int fd, int type, int code, int value)
+{
+    struct input_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    write(fd, &event, sizeof(event));
+}
+
+/* one sample per device and per period, at absolute times */
+static void *generator_thread(void *arg)
+{
+    struct timespec next;
+    long period_ns = 1000000000L / rate_hz;
+    int n = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (running) {
+        /* the input core drops relative events of value 0 */
+        int value = 1 + n++ % 100;
+
+        for (int i = 0; i < NUM_DEVICES; i++) {
+            for (int axis = 0; axis < 3; axis++)
+                write_event(devices[i].fd, EV_REL, devices[i].codes[axis],
+                            value + axis);
+            write_event(devices[i].fd, EV_SYN, SYN_REPORT, 0);
+        }
+
+        next.tv_nsec += period_ns;
+        if (next.tv_nsec >= NSEC_PER_SEC) {
+            next.tv_nsec -= NSEC_PER_SEC;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    getrusage(RUSAGE_THREAD, &generator_usage);
+    return NULL;
+}
+
+static int64_t now_ns()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return timespec_to_ns(&t);
+}
+
+static int64_t timeval_to_us(const struct timeval *tv)
+{
+    return tv->tv_sec * 1000000LL + tv->tv_usec;
+}
+
+static void usage()
+{
+    printf("usage: sensors_poll_bench [-r rate_hz] [-t seconds] "
+           "[-l max_latency_ms]\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    char old_latency[PROPERTY_VALUE_MAX];
+    const char *latency = NULL;
+    sensors_event_t buffer[POLL_BUFFER];
+    struct hw_device_t *hw_device;
+    struct sensors_poll_device_t *dev;
+    struct rusage start_usage, end_usage;
+    pthread_t generator;
+    int64_t start, end, cpu_us;
+    unsigned long long polls = 0, events = 0;
+    unsigned long long per_sensor[SENSORS_HANDLE_MAX + 1];
+    int seconds = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:t:l:h")) != -1) {
+        switch (opt) {
+        case 'r':
+            rate_hz = atoi(optarg);
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        case 'l':
+            latency = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (rate_hz <= 0 || seconds <= 0)
+        usage();
+
+    /* the poll context reads it when it is opened */
+    property_get(MAX_LATENCY_PROPERTY, old_latency, "0");
+    if (latency)
+        property_set(MAX_LATENCY_PROPERTY, latency);
+
+    setup_configs();
+    for (int i = 0; i < NUM_DEVICES; i++)
+        if (create_device(&devices[i]) < 0)
+            return EXIT_FAILURE;
+
+    /* let ueventd create the /dev/input nodes */
+    usleep(500000);
+
+    if (HAL_MODULE_INFO_SYM.common.methods->open(&HAL_MODULE_INFO_SYM.common,
+                SENSORS_HARDWARE_POLL, &hw_device) != 0) {
+        printf("can't open the sensors poll device\n");
+        return EXIT_FAILURE;
+    }
+    dev = (struct sensors_poll_device_t *)hw_device;
+
+    for (int i = 0; i < NUM_DEVICES; i++) {
+        dev->setDelay(dev, devices[i].handle, NSEC_PER_SEC / rate_hz);
+        dev->activate(dev, devices[i].handle, 1);
+    }
+
+    memset(per_sensor, 0, sizeof(per_sensor));
+    pthread_create(&generator, NULL, generator_thread, NULL);
+
+    getrusage(RUSAGE_SELF, &start_usage);
+    start = end = now_ns();
+
+    do {
+        int n = dev->poll(dev, buffer, POLL_BUFFER);
+
+        if (n < 0) {
+            printf("poll() failed: %d\n", n);
+            break;
+        }
+
+        polls++;
+        events += n;
+        for (int i = 0; i < n; i++)
+            if (buffer[i].sensor > 0 && buffer[i].sensor <= SENSORS_HANDLE_MAX)
+                per_sensor[buffer[i].sensor]++;
+
+        end = now_ns();
+    } while (end - start < seconds * NSEC_PER_SEC);
+
+    running = 0;
+    pthread_join(generator, NULL);
+    getrusage(RUSAGE_SELF, &end_usage);
+
+    for (int i = 0; i < NUM_DEVICES; i++)
+        dev->activate(dev, devices[i].handle, 0);
+    hw_device->close(hw_device);
+
+    for (int i = 0; i < NUM_DEVICES; i++) {
+        ioctl(devices[i].fd, UI_DEV_DESTROY);
+        close(devices[i].fd);
+    }
+    property_set(MAX_LATENCY_PROPERTY, old_latency);
+
+    /* CPU of the HAL and of the poll loop, the generator is not counted */
+    cpu_us = timeval_to_us(&end_usage.ru_utime) + timeval_to_us(&end_usage.ru_stime)
+            - timeval_to_us(&start_usage.ru_utime) - timeval_to_us(&start_usage.ru_stime)
+            - timeval_to_us(&generator_usage.ru_utime)
+            - timeval_to_us(&generator_usage.ru_stime);
+
+    double elapsed = (end - start) / 1e9;
+
+    printf("%d Hz, %d s, max report latency %s ms\n", rate_hz, seconds,
+           latency ? latency : old_latency);
+    for (int i = 0; i < NUM_DEVICES; i++)
+        printf("  %-14s %8.1f events/s\n", devices[i].name,
+               per_sensor[devices[i].handle] / elapsed);
+    printf("  poll() returns  %8.1f /s, %.1f events per return\n",
+           polls / elapsed, polls ? (double)events / polls : 0.0);
+    printf("  context switches %7.1f /s\n",
+           (end_usage.ru_nvcsw + end_usage.ru_nivcsw - start_usage.ru_nvcsw
+            - start_usage.ru_nivcsw - generator_usage.ru_nvcsw
+            - generator_usage.ru_nivcsw) / elapsed);
+    printf("  CPU time        %8.2f %%\n", cpu_us / (elapsed * 1e4));
+
+    return EXIT_SUCCESS;
+}